@@ -44,6 +44,8 @@
  XkwNstartFrame          Int              int             0
  XkwNendFrame            Int              int             numFrames-1
  XkwNnewFrameCallback    Callback         Callback        NULL
+ XkwNprecomputeCallback  Callback         Callback        NULL
+ XkwNprecomputeFrames    Int              int             0
 
 ------------------------------------------------------------------------*/
 
@@ -60,9 +62,12 @@ typedef struct _AnimateControlRec *AnimateControlWidget;
 #define XkwNstartFrame "startFrame"
 #define XkwNendFrame "endFrame"
 #define XkwNnewFrameCallback "newFrameCallback"
+#define XkwNprecomputeCallback "precomputeCallback"
+#define XkwNprecomputeFrames "precomputeFrames"
 
 #define XkwCNumFrames "NumFrames"
 #define XkwCStartFrame "StartFrame"
 #define XkwCEndFrame "EndFrame"
+#define XkwCPrecomputeFrames "PrecomputeFrames"
 
 #endif
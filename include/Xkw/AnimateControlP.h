@@ -5,6 +5,7 @@
 #include <X11/IntrinsicP.h>
 #include <X11/ShellP.h>
 #include <X11/StringDefs.h>
+#include <sys/time.h>
 
 #include <Xkw/AnimateControl.h>
 #include <karma.h>
@@ -17,6 +18,8 @@ typedef struct _AnimateControlPart
     int numFrames;
     int startFrame;
     int endFrame;
+    XtCallbackList precomputeCallback;
+    int precomputeFrames;
     /*  Private resources  */
     KWorldCanvas position_wc;
     int currentFrame;
@@ -29,6 +32,13 @@ typedef struct _AnimateControlPart
     Widget start_frame_sld;
     Widget end_frame_sld;
     Widget current_frame_sld;
+    Widget rate_lbl;
+    struct timeval deadline;      /*  When the next frame is due  */
+    struct timeval stats_start;
+    int frames_shown;
+    int frames_dropped;
+    int num_precomputed;
+    flag precompute_active;
 } AnimateControlPart, *AnimateControlPartPtr;
 
 typedef struct _AnimateControlRec
@@ -68,6 +68,7 @@ typedef struct _DataclipPart
     KPixCanvas pixcanvas;
     KWorldCanvas worldcanvas;
     KCallbackFunc iarr_destroy_callback;
+    KHistogram histogram;
     double *histogram_array;
     unsigned hist_arr_length;
     unsigned hist_buf_length;
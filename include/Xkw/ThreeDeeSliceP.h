@@ -75,6 +75,7 @@ typedef struct _ThreeDeeSlicePart
     int           z_mag;
     KCallbackFunc iarr_destroy_func;
     struct XkwThreeDeeSliceCursor cursor;
+    XtIntervalId  refresh_timer;
 } ThreeDeeSlicePart, *ThreeDeeSlicePartPtr;
 
 typedef struct _ThreeDeeSliceRec
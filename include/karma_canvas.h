@@ -81,6 +81,7 @@ typedef struct worldcanvas_type * KWorldCanvas;
 #define CANVAS_ATT_ISCALE_INFO      16  /*  (void *)                         */
 #define CANVAS_ATT_AUTO_MIN_SAT     17  /*  (flag)                           */
 #define CANVAS_ATT_AUTO_MAX_SAT     18  /*  (flag)                           */
+#define CANVAS_ATT_LAYERS_RETAINED  19  /*  (flag) read-only                 */
 
 #ifndef NEW_WIN_SCALE
 #define CANVAS_ATT_X_MIN            CANVAS_ATT_LEFT_X
@@ -182,6 +183,8 @@ EXTERN_FUNCTION (flag canvas_get_colour,
 EXTERN_FUNCTION (void canvas_set_dressing, (KWorldCanvas canvas, ...) );
 EXTERN_FUNCTION (void canvas_sequence_dressing_refresh, (KWorldCanvas canvas));
 EXTERN_FUNCTION (void canvas_draw_dressing, (KWorldCanvas canvas) );
+EXTERN_FUNCTION (void canvas_retain_lower_layers, (KWorldCanvas canvas) );
+EXTERN_FUNCTION (flag canvas_refresh_upper_layers, (KWorldCanvas canvas) );
 EXTERN_FUNCTION (Kcolourmap canvas_get_cmap, (KWorldCanvas canvas) );
 
 
@@ -95,6 +95,26 @@ EXTERN_FUNCTION (flag ch_create_pipe, (Channel *read_ch, Channel *write_ch) );
 EXTERN_FUNCTION (Channel ch_create_sink, () );
 EXTERN_FUNCTION (KCallbackFunc ch_tap_io_events,
 		 ( void (*tap_func) (), void *info ) );
+EXTERN_FUNCTION (flag ch_advise,
+		 (Channel channel, unsigned int advice, unsigned long position,
+		  unsigned long length) );
+EXTERN_FUNCTION (flag ch_set_disc_buffer,
+		 (Channel channel, unsigned int size, flag direct) );
+
+
+/*  File:  ch_async.c  */
+EXTERN_FUNCTION (void ch_register_async_managers,
+		 ( flag (*manage) (), void (*unmanage) () ) );
+EXTERN_FUNCTION (flag ch_read_async,
+		 (Channel channel, unsigned long position, char *buffer,
+		  unsigned int length,
+		  void (*func) (Channel channel, void *info, char *buffer,
+				int num_read),
+		  void *info) );
+EXTERN_FUNCTION (flag ch_prefetch_async,
+		 (CONST char *address, uaddr length,
+		  void (*func) (void *info), void *info) );
+EXTERN_FUNCTION (void ch_wait_async, (Channel channel) );
 
 
 /*  File:  ch_misc.c  */
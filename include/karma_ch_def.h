@@ -51,5 +51,12 @@ typedef struct _converter_struct * ChConverter;
 #define K_CH_MAP_IF_AVAILABLE (unsigned int) 4  /*  Map if OS supports it    */
 #define K_CH_MAP_ALWAYS       (unsigned int) 5  /*  Always map               */
 
+/*  Access pattern advice for disc and mapped channels  */
+#define K_CH_ADVISE_NORMAL     (unsigned int) 0  /*  No special treatment    */
+#define K_CH_ADVISE_SEQUENTIAL (unsigned int) 1  /*  Read ahead aggressively */
+#define K_CH_ADVISE_RANDOM     (unsigned int) 2  /*  Do not read ahead       */
+#define K_CH_ADVISE_WILLNEED   (unsigned int) 3  /*  Read region now         */
+#define K_CH_ADVISE_DONTNEED   (unsigned int) 4  /*  Discard cached region   */
+
 
 #endif /*  KARMA_CH_DEF_H  */
@@ -380,6 +380,28 @@ EXTERN_FUNCTION (flag ds_list_unfragment, (packet_desc *list_desc,
 EXTERN_FUNCTION (flag ds_list_fragment, (packet_desc *list_desc,
 					 list_header *list_head) );
 
+/*  File:  mask.c  */
+EXTERN_FUNCTION (KRegionMask ds_mask_create_polygon,
+		 (CONST dim_desc *abs_dim_desc, CONST dim_desc *ord_dim_desc,
+		  CONST edit_coord *coords, unsigned int num_points,
+		  flag antialias) );
+EXTERN_FUNCTION (KRegionMask ds_mask_create_ellipse,
+		 (CONST dim_desc *abs_dim_desc, CONST dim_desc *ord_dim_desc,
+		  double centre_abs, double centre_ord,
+		  double radius_abs, double radius_ord, flag antialias) );
+EXTERN_FUNCTION (void ds_mask_destroy, (KRegionMask mask) );
+EXTERN_FUNCTION (CONST mask_run *ds_mask_get_runs,
+		 (KRegionMask mask, unsigned int *num_runs) );
+EXTERN_FUNCTION (flag ds_mask_fill,
+		 (KRegionMask mask, char *array, unsigned int elem_type,
+		  unsigned int abs_stride, unsigned int ord_stride,
+		  double value[2]) );
+EXTERN_FUNCTION (flag ds_mask_get_stats,
+		 (KRegionMask mask, CONST char *array, unsigned int elem_type,
+		  unsigned int abs_stride, unsigned int ord_stride,
+		  double *weight, double *sum, double *sum_squares,
+		  double *min, double *max) );
+
 /*  File:  misc.c  */
 EXTERN_FUNCTION (void ds_format_unit, (char unit[STRING_LENGTH], double *scale,
 				       CONST char *value_name) );
@@ -261,6 +261,17 @@ typedef struct
     double ordinate;
 } edit_coord;
 
+/*  This structure describes a run of elements in a region mask.  */
+typedef struct
+{
+    unsigned long ord;      /*  Ordinate co-ordinate number of the row       */
+    unsigned long abs;      /*  First abscissa co-ordinate number            */
+    unsigned long length;   /*  Number of elements in the run                */
+    float coverage;         /*  Fraction of each element inside the region   */
+} mask_run;
+
+typedef struct regionmask_type * KRegionMask;
+
 /*  This is the Karma Fixed String structure.  */
 typedef struct
 {
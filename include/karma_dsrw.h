@@ -51,6 +51,12 @@
 #define KARMA_DSRW_H
 
 
+/*  Array compression codecs  */
+#define DSRW_COMPRESSION_NONE       0
+#define DSRW_COMPRESSION_SHUFFLE_LZ 1
+
+
+
 /*  File:   dsrw.c   */
 EXTERN_FUNCTION (flag dsrw_write_multi,
 		 (Channel channel, CONST multi_array *multi_desc) );
@@ -102,6 +108,16 @@ EXTERN_FUNCTION (flag dsrw_read_packets,
 		  char *dest, unsigned long num_packets) );
 EXTERN_FUNCTION (flag dsrw_read_flag, (Channel channel, flag *logical) );
 EXTERN_FUNCTION (flag dsrw_read_type, (Channel channel, unsigned int *type) );
+EXTERN_FUNCTION (void dsrw_set_array_compression, (unsigned int codec) );
+
+/*  File:   compress.c   */
+EXTERN_FUNCTION (unsigned long dsrw_compress_block,
+		 (CONST char *input, unsigned long length, unsigned int stride,
+		  char *output, unsigned long max_length, char *workspace) );
+EXTERN_FUNCTION (flag dsrw_decompress_block,
+		 (CONST char *input, unsigned long input_length, char *output,
+		  unsigned long length, unsigned int stride,
+		  char *workspace) );
 
 
 #endif /*  KARMA_DSRW_H  */
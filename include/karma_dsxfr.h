@@ -61,6 +61,11 @@ EXTERN_FUNCTION (multi_array *dsxfr_get_multi, (CONST char *object, flag cache,
 						flag writeable) );
 EXTERN_FUNCTION (void dsxfr_register_read_func, ( void (*read_func) () ) );
 EXTERN_FUNCTION (void dsxfr_register_close_func, ( void (*close_func) () ) );
+EXTERN_FUNCTION (void dsxfr_set_cache_limit, (unsigned long max_bytes) );
+EXTERN_FUNCTION (void dsxfr_get_cache_statistics,
+		 (unsigned long *hits, unsigned long *misses,
+		  unsigned long *invalidations, unsigned long *evictions,
+		  unsigned long *num_bytes) );
 
 
 #endif /*  KARMA_DSXFR_H  */
@@ -70,14 +70,17 @@ typedef struct miriad_data_context_type * KMiriadDataContext;
 
 #define FA_FITS_READ_DATA_END          0
 #define FA_FITS_READ_DATA_NUM_BLANKS   1
+#define FA_FITS_READ_DATA_FIRST_INDEX  2
 
 
 #define FA_FITS_GENERATE_HEADER_END    0
 
 
 #define FA_FITS_WRITE_END              0
+#define FA_FITS_WRITE_QUANTISE         1
 
 #define FA_FITS_WRITE_DATA_END         0
+#define FA_FITS_WRITE_DATA_FIRST_INDEX 1
 
 
 #define FA_MIRIAD_READ_HEADER_END      0
@@ -113,6 +116,7 @@ typedef struct miriad_data_context_type * KMiriadDataContext;
 
 #define FA_GUESS_READ_END              0
 #define FA_GUESS_READ_FITS_TO_FLOAT    1
+#define FA_GUESS_READ_SANITISE         2
 
 
 #define FA_SUNRAS_READ_END             0
@@ -262,11 +266,21 @@ EXTERN_FUNCTION (flag foreign_sunras_write_rgb,
 /*  File:  misc.c  */
 EXTERN_FUNCTION (unsigned int foreign_guess_format_from_filename,
 		 (CONST char *filename) );
+EXTERN_FUNCTION (double foreign_fits_dither_offset,
+		 (unsigned long seed, uaddr index) );
 
 /*  File:  guess_read.c  */
 EXTERN_FUNCTION (multi_array *foreign_guess_and_read,
 		 (CONST char *filename, unsigned int mmap_option,
 		  flag writeable, unsigned int *ftype, ...) );
+EXTERN_FUNCTION (flag foreign_guess_and_read_many,
+		 (CONST char **filenames, unsigned int num_files,
+		  unsigned int mmap_option, flag writeable,
+		  unsigned int num_jobs,
+		  flag (*func) (void *info, unsigned int index,
+				CONST char *filename, multi_array *multi_desc,
+				unsigned int ftype),
+		  void *info, ...) );
 EXTERN_FUNCTION (flag foreign_read_and_setup,
 		 (CONST char *filename, unsigned int mmap_option,
 		  flag writeable, unsigned int *ftype, flag inform,
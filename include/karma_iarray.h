@@ -144,6 +144,25 @@
 #define iarray_value_name(a) (a)->arr_desc->packet->element_desc[(a)->elem_index]
 #define iarray_register_destroy_func(a,func,o) c_register_callback (&(a)->destroy_callbacks, (func), (a), (o), FALSE, NULL, FALSE, FALSE)
 
+
+typedef struct histogram_type * KHistogram;
+
+/*  Attributes for histograms  */
+#define IARRAY_HIST_ATT_END           0
+#define IARRAY_HIST_ATT_MIN           1
+#define IARRAY_HIST_ATT_MAX           2
+#define IARRAY_HIST_ATT_NUM_VALUES    3
+#define IARRAY_HIST_ATT_SAMPLE_STRIDE 4
+#define IARRAY_HIST_ATT_BIN_WIDTH     5
+#define IARRAY_HIST_ATT_BINNED_MIN    6
+#define IARRAY_HIST_ATT_BINNED_MAX    7
+#define IARRAY_HIST_ATT_FIXED_RANGE   8
+
+/*  Variable bindings for iarray_eval  */
+#define IARRAY_EVAL_END               0
+#define IARRAY_EVAL_ARRAY             1
+#define IARRAY_EVAL_SCALAR            2
+
 /*  File:  main.c  */
 EXTERN_FUNCTION (iarray iarray_read_nD,
 		 (CONST char *arrayfile, flag cache, CONST char *arrayname,
@@ -326,4 +345,35 @@ EXTERN_FUNCTION (unsigned int iarray_contour,
 		  double **x1_arr, double **y1_arr) );
 
 
+/*  File: histogram.c  */
+EXTERN_FUNCTION (KHistogram iarray_histogram_create,
+		 (iarray array, unsigned int conv_type,
+		  unsigned long sample_stride) );
+EXTERN_FUNCTION (flag iarray_histogram_add_array,
+		 (KHistogram histogram, iarray array) );
+EXTERN_FUNCTION (flag iarray_histogram_refine,
+		 (KHistogram histogram, iarray array, double min, double max) );
+EXTERN_FUNCTION (flag iarray_histogram_merge,
+		 (KHistogram dest, KHistogram src) );
+EXTERN_FUNCTION (void iarray_histogram_get_attributes,
+		 (KHistogram histogram, ...) );
+EXTERN_FUNCTION (flag iarray_histogram_rebin,
+		 (KHistogram histogram, double min, double max,
+		  unsigned long num_bins, unsigned long *histogram_array,
+		  unsigned long *histogram_peak,
+		  unsigned long *histogram_mode) );
+EXTERN_FUNCTION (double iarray_histogram_percentile,
+		 (KHistogram histogram, double fraction) );
+EXTERN_FUNCTION (void iarray_histogram_destroy, (KHistogram histogram) );
+
+/*  File: moments.c  */
+EXTERN_FUNCTION (flag iarray_compute_moments,
+		 (iarray cube, iarray mom0, iarray mom1, iarray mom2,
+		  iarray peak, iarray median, CONST double *velocities,
+		  double lower_clip, double sum_clip) );
+
+/*  File: eval.c  */
+EXTERN_FUNCTION (flag iarray_eval, (iarray out, CONST char *expression, ...) );
+
+
 #endif /*  KARMA_IARRAY_H  */
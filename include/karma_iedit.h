@@ -53,6 +53,18 @@
 
 typedef struct instruction_list_type * KImageEditList;
 
+typedef struct  /*  Compiled form of an edit instruction  */
+{
+    unsigned int code;
+    double value[2];
+    unsigned int num_coords;
+    edit_coord *coords;
+    double min_abscissa;
+    double max_abscissa;
+    double min_ordinate;
+    double max_ordinate;
+} edit_instruction;
+
 
 /*  File:   image_edit.c   */
 EXTERN_FUNCTION (KImageEditList iedit_create_list,
@@ -73,6 +85,14 @@ EXTERN_FUNCTION (flag iedit_apply_instructions, (KImageEditList ilist) );
 EXTERN_FUNCTION (list_header *iedit_get_list, (KImageEditList ilist) );
 EXTERN_FUNCTION (void iedit_make_list_default_master, (KImageEditList ilist) );
 EXTERN_FUNCTION (void iedit_make_list_default_slave, (KImageEditList ilist) );
+EXTERN_FUNCTION (CONST edit_instruction *iedit_get_instructions,
+		 (KImageEditList ilist, unsigned int *num_instructions) );
+EXTERN_FUNCTION (flag iedit_draw_pending,
+		 (KImageEditList ilist, char *array, unsigned int elem_type,
+		  CONST dim_desc *abs_dim_desc, unsigned int abs_stride,
+		  CONST dim_desc *ord_dim_desc, unsigned int ord_stride,
+		  CONST edit_instruction **drawn, unsigned int *num_drawn) );
+EXTERN_FUNCTION (void iedit_reset_drawn, (KImageEditList ilist) );
 
 
 #endif /*  KARMA_IEDIT_H  */
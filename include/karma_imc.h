@@ -51,6 +51,13 @@ EXTERN_FUNCTION (flag imc_24to8, (unsigned int image_size,
 				  unsigned char *out_image, int stride8,
 				  unsigned int max_colours, unsigned int speed,
 				  packet_desc **pack_desc, char **packet) );
+EXTERN_FUNCTION (flag imc_24to8_dither,
+		 (unsigned int width, unsigned int height,
+		  unsigned char *image_reds, unsigned char *image_greens,
+		  unsigned char *image_blues, int stride24,
+		  unsigned char *out_image, int stride8,
+		  unsigned int max_colours, unsigned int speed,
+		  packet_desc **pack_desc, char **packet) );
 
 
 #endif /*  KARMA_IMC_H  */
@@ -89,6 +89,11 @@
 #define KWIN_ATT_LOWER_HANDLE    14
 #define KWIN_ATT_USER_PTR        15
 #define KWIN_ATT_LINEWIDTH       16
+#define KWIN_ATT_CACHE_ONLY      17
+#define KWIN_ATT_REFRESH_INTERVAL    18
+#define KWIN_ATT_REFRESHES_REQUESTED 19
+#define KWIN_ATT_REFRESHES_PERFORMED 20
+#define KWIN_ATT_REFRESH_PENDING     21
 
 #define KWIN_STRING_END       0  /*  End of varargs list                     */
 #define KWIN_STRING_WIDTH     1  /*  (int *)                                 */
@@ -104,6 +109,10 @@
 typedef struct pixcanvas_type * KPixCanvas;
 typedef struct cache_data_type * KPixCanvasImageCache;
 typedef struct pixfont_type * KPixCanvasFont;
+#ifndef KDISPLAY_DEFINED
+#  define KDISPLAY_DEFINED
+typedef struct kdisplay_handle_type * Kdisplay;
+#endif
 typedef struct  /*  Experimental structure  */
 {
     int startx;
@@ -167,6 +176,7 @@ EXTERN_FUNCTION (flag kwin_refresh_if_visible,
 EXTERN_FUNCTION (flag kwin_partial_refresh,
 		 (KPixCanvas canvas, unsigned int num_areas,
 		  KPixCanvasRefreshArea *areas, flag clear_all) );
+EXTERN_FUNCTION (flag kwin_flush_refresh, (KPixCanvas canvas) );
 EXTERN_FUNCTION (flag kwin_process_position_event, (KPixCanvas canvas,
 						    int x, int y, flag clip,
 						    unsigned int event_code,
@@ -215,6 +225,8 @@ EXTERN_FUNCTION (flag kwin_draw_cached_image, (KPixCanvasImageCache cache,
 EXTERN_FUNCTION (flag kwin_draw_cached_subimages,
 		 (KPixCanvasImageCache cache, int x_off, int y_off,
 		  unsigned int num_areas, KPixCanvasRefreshArea *areas) );
+EXTERN_FUNCTION (flag kwin_draw_into_cache,
+		 (KPixCanvas canvas, KPixCanvasImageCache *cache_ptr) );
 EXTERN_FUNCTION (flag kwin_draw_point, (KPixCanvas canvas,
 					double x, double y,
 					unsigned long pixel_value) );
@@ -304,5 +316,25 @@ EXTERN_FUNCTION (flag kwin_hersey_draw_string,
 		  double x, double y, double angle, unsigned long pixel_value,
 		  double *width, double *height) );
 
+/*  File: memory.c  */
+EXTERN_FUNCTION (KPixCanvas kwin_create_memory,
+		 (unsigned char *buffer, int width, int height,
+		  unsigned int depth, unsigned int stride) );
+EXTERN_FUNCTION (Kdisplay kwin_memory_get_dpy_handle, (KPixCanvas canvas) );
+EXTERN_FUNCTION (unsigned int kwin_memory_alloc_colours,
+		 (unsigned int num_cells, unsigned long *pixel_values,
+		  unsigned int min_cells, Kdisplay dpy_handle) );
+EXTERN_FUNCTION (void kwin_memory_free_colours,
+		 (unsigned int num_cells, unsigned long *pixel_values,
+		  Kdisplay dpy_handle) );
+EXTERN_FUNCTION (void kwin_memory_store_colours,
+		 (unsigned int num_cells, unsigned long *pixel_values,
+		  unsigned short *reds, unsigned short *greens,
+		  unsigned short *blues, unsigned int stride,
+		  Kdisplay dpy_handle) );
+EXTERN_FUNCTION (void kwin_memory_get_location,
+		 (Kdisplay dpy_handle, unsigned long *serv_hostaddr,
+		  unsigned long *serv_display_num) );
+
 
 #endif /*  KARMA_KWIN_H  */
@@ -65,6 +65,10 @@
 #define KWIN_FUNC_RESIZE            10017
 #define KWIN_FUNC_DRAW_POINTS       10018
 #define KWIN_FUNC_SET_LINEWIDTH     10019
+#define KWIN_FUNC_DRAW_INTO_CACHE   10020
+
+/*  Codes for optional driver capabilities  */
+#define KWIN_CAPABILITY_CACHE_ONLY  11000
 
 /*  Mandatory function types  */
 typedef flag (*KPixFuncDrawPoint) (KPixHookCanvas info, double x, double y,
@@ -99,6 +103,9 @@ typedef flag (*KPixFuncDrawCachedImage)
       int image_x_off, int image_y_off, int canvas_x_off, int canvas_y_off,
       int canvas_width, int canvas_height);
 typedef void (*KPixFuncFreeCacheData) (KPixCanvasImageCache cache);
+typedef flag (*KPixFuncDrawIntoCache)
+     (KPixHookCanvas info, KPixCanvasImageCache *cache_ptr,
+      int x_off, int y_off, int width, int height);
 typedef flag (*KPixFuncDrawLine) (KPixHookCanvas info, double x0, double y0,
 				  double x1, double y1,
 				  unsigned long pixel_value);
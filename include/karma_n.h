@@ -43,10 +43,23 @@
 #define KARMA_N_H
 
 
+typedef struct randomstream_type * KRandomStream;
 
-/*  For the file: numbers.c  */
+
+/*  For the file: misc.c  */
 EXTERN_FUNCTION (double n_gaussian, () );
 EXTERN_FUNCTION (double n_uniform, () );
+EXTERN_FUNCTION (void n_set_seed, (unsigned long seed) );
+EXTERN_FUNCTION (KRandomStream n_create_stream,
+		 (unsigned long seed, unsigned long stream_number) );
+EXTERN_FUNCTION (void n_destroy_stream, (KRandomStream stream) );
+EXTERN_FUNCTION (void n_stream_seek, (KRandomStream stream, uaddr position) );
+EXTERN_FUNCTION (double n_stream_uniform, (KRandomStream stream) );
+EXTERN_FUNCTION (double n_stream_gaussian, (KRandomStream stream) );
+EXTERN_FUNCTION (void n_fill_uniform,
+		 (KRandomStream stream, double *values, uaddr num_values) );
+EXTERN_FUNCTION (void n_fill_gaussian,
+		 (KRandomStream stream, double *values, uaddr num_values) );
 
 
 #endif /*  KARMA_N_H  */
@@ -54,12 +54,21 @@
 #define PSW_ATT_END                0
 #define PSW_ATT_LINEWIDTH_MM       1
 #define PSW_ATT_LINEWIDTH_RELATIVE 2
+#define PSW_ATT_IMAGE_ENCODING     3
+
+#define PSW_ENCODING_HEX           0
+#define PSW_ENCODING_ASCII85       1
+#define PSW_ENCODING_RUNLENGTH     2
+#define PSW_ENCODING_FLATE         3
 
 
 /*  File:   ps_write.c   */
 EXTERN_FUNCTION (PostScriptPage psw_va_create,
 		 (Channel channel, double hoffset, double voffset,
 		  double hsize, double vsize, flag portrait, flag eps, ...) );
+EXTERN_FUNCTION (PostScriptPage psw_va_create_pdf,
+		 (Channel channel, double hoffset, double voffset,
+		  double hsize, double vsize, flag portrait, ...) );
 EXTERN_FUNCTION (PostScriptPage psw_create, (Channel channel,
 					     double hoffset, double voffset,
 					     double hsize, double vsize,
@@ -124,5 +133,13 @@ EXTERN_FUNCTION (flag psw_rgb_text,
 		  double angle) );
 EXTERN_FUNCTION (flag psw_set_attributes, (PostScriptPage pspage, ...) );
 
+/*  File:   filter.c   */
+EXTERN_FUNCTION (PostScriptFilter psw_filter_create,
+		 (Channel channel, unsigned int encoding, flag ascii) );
+EXTERN_FUNCTION (flag psw_filter_write,
+		 (PostScriptFilter filter, CONST unsigned char *data,
+		  uaddr length) );
+EXTERN_FUNCTION (flag psw_filter_close, (PostScriptFilter filter) );
+
 
 #endif /*  KARMA_PSW_H  */
@@ -40,6 +40,7 @@
 
 
 typedef struct pspage_type * PostScriptPage;
+typedef struct psw_filter_type * PostScriptFilter;
 
 
 #endif /*  KARMA_PSW_DEF_H  */
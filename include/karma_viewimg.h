@@ -66,6 +66,13 @@ typedef struct viewableimage_type * ViewableImage;
 #define VIEWIMG_ATT_PAN_CENTRE_X      9
 #define VIEWIMG_ATT_PAN_CENTRE_Y      10
 #define VIEWIMG_ATT_PAN_MAGNIFICATION 11
+#define VIEWIMG_ATT_CACHE_BUDGET      12
+#define VIEWIMG_ATT_DECIMATION        13
+
+/*  Values for the VIEWIMG_ATT_DECIMATION attribute  */
+#define VIEWIMG_DECIMATION_NONE       0
+#define VIEWIMG_DECIMATION_MEAN       1
+#define VIEWIMG_DECIMATION_MAXIMUM    2
 
 
 #define VIEWIMG_VATT_END             0
@@ -127,6 +134,7 @@ EXTERN_FUNCTION (ViewableImage *viewimg_create_rgb_sequence,
 EXTERN_FUNCTION (flag viewimg_make_active, (ViewableImage vimage) );
 EXTERN_FUNCTION (flag viewimg_set_active,
 		 (ViewableImage vimage, flag refresh) );
+EXTERN_FUNCTION (flag viewimg_precompute, (ViewableImage vimage) );
 EXTERN_FUNCTION (void viewimg_control_autoscaling,
 		 (KWorldCanvas canvas,
 		  flag auto_x, flag auto_y, flag auto_v,
@@ -145,6 +153,8 @@ EXTERN_FUNCTION (flag viewimg_fill_polygon, (ViewableImage vimage,
 					     edit_coord *coords,
 					     unsigned int num_vertices,
 					     double value[2]) );
+EXTERN_FUNCTION (flag viewimg_draw_edit_pending,
+		 (ViewableImage vimage, KImageEditList ilist) );
 EXTERN_FUNCTION (void viewimg_get_canvas_attributes,
 		 (KWorldCanvas canvas, ...) );
 EXTERN_FUNCTION (void viewimg_set_canvas_attributes,
@@ -184,6 +194,12 @@ EXTERN_FUNCTION (flag viewimg_statistics_position_func,
 EXTERN_FUNCTION (flag viewimg_statistics_compute,
 		 (ViewableImage vimage,
 		  double lx0, double ly0, double lx1, double ly1) );
+EXTERN_FUNCTION (flag viewimg_statistics_find,
+		 (ViewableImage vimage,
+		  double lx0, double ly0, double lx1, double ly1,
+		  double *min, double *max, double *mean, double *stddev,
+		  double *sum, double *sumsq, unsigned long *npoints) );
+EXTERN_FUNCTION (void viewimg_statistics_discard, (ViewableImage vimage) );
 
 /*  File: track.c  */
 EXTERN_FUNCTION (void viewimg_track_compute,
@@ -0,0 +1 @@
+../packages/ch/async.c
\ No newline at end of file
@@ -0,0 +1 @@
+../packages/ds/mask.c
\ No newline at end of file
@@ -0,0 +1 @@
+../packages/dsrw/compress.c
\ No newline at end of file
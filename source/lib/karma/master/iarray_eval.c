@@ -0,0 +1 @@
+../packages/iarray/eval.c
\ No newline at end of file
@@ -0,0 +1 @@
+../packages/iarray/histogram.c
\ No newline at end of file
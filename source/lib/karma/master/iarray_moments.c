@@ -0,0 +1 @@
+../packages/iarray/moments.c
\ No newline at end of file
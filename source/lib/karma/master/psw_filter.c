@@ -0,0 +1 @@
+../packages/psw/filter.c
\ No newline at end of file
@@ -0,0 +1,491 @@
+/*LINTLIBRARY*/
+/*  async.c
+
+    This code provides asynchronous reading of channel objects.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains the routines which read disc channels and page in
+    mapped memory without blocking the caller. The reads are performed by a
+    pool of helper threads. Each thread writes a byte into a pipe when it
+    completes a request, and the read end of the pipe is managed by the
+    channel manager (see the <chm> package), so that completion callbacks are
+    called from the event loop. Only the calling thread modifies the list of
+    requests.
+
+
+*/
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <karma.h>
+#include <karma_ch.h>
+#include <karma_chm.h>
+#include <karma_mt.h>
+#include <karma_m.h>
+#include <karma_a.h>
+#include <os.h>
+
+#define DRAIN_BUF_SIZE 256
+#define TOUCH_STRIDE 4096
+
+#define REQUEST_READ (unsigned int) 0
+#define REQUEST_TOUCH (unsigned int) 1
+
+
+/*  Internal definition of a request  */
+struct request_type
+{
+    unsigned int type;
+    Channel channel;
+    int fd;
+    unsigned long position;
+    char *buffer;
+    CONST char *address;
+    uaddr length;
+    void (*func) ();
+    void *info;
+    flag launched;
+    volatile int num_read;
+    volatile flag done;
+    struct request_type *next;
+};
+
+
+/*  Private data follows  */
+static flag (*manage_func) () = NULL;
+static void (*unmanage_func) () = NULL;
+static KThreadPool pool = NULL;
+static unsigned int max_launched = 0;
+static unsigned int num_launched = 0;
+static int notify_fds[2] = {-1, -1};
+static Channel notify_channel = NULL;
+static struct request_type *first_request = NULL;
+static struct request_type *last_request = NULL;
+
+
+/*  Private functions  */
+STATIC_FUNCTION (flag initialise, () );
+STATIC_FUNCTION (flag add_request, (struct request_type *request) );
+STATIC_FUNCTION (void launch_requests, () );
+STATIC_FUNCTION (void request_job,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (flag notify_input_func, (Channel channel, void **info) );
+STATIC_FUNCTION (void process_completions, (Channel channel) );
+STATIC_FUNCTION (flag have_requests, (Channel channel, flag running_only) );
+STATIC_FUNCTION (void wait_for_notify, () );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void ch_register_async_managers (flag (*manage) (), void (*unmanage) ())
+/*  [SUMMARY] Register the channel management functions for asynchronous I/O.
+    [PURPOSE] This routine will register the functions used to manage the
+    channel on which completion of asynchronous requests is signalled. If
+    this routine is not called, [<chm_manage>] and [<chm_unmanage>] are used.
+    <manage> The routine to manage channels. See the [<chm_manage>] routine
+    for the interface definition.
+    <unmanage> The routine to unmanage channels. See the [<chm_unmanage>]
+    routine for the interface definition.
+    [NOTE] This routine must be called before any asynchronous requests are
+    made.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "ch_register_async_managers";
+
+    if (notify_channel != NULL)
+    {
+	(void) fprintf (stderr, "Asynchronous requests already made\n");
+	a_prog_bug (function_name);
+    }
+    manage_func = manage;
+    unmanage_func = unmanage;
+}   /*  End Function ch_register_async_managers  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag ch_read_async (Channel channel, unsigned long position, char *buffer,
+		    unsigned int length,
+		    void (*func) (Channel channel, void *info, char *buffer,
+				  int num_read),
+		    void *info)
+/*  [SUMMARY] Read from a disc channel without waiting.
+    [PURPOSE] This routine will start reading a number of bytes from a disc
+    channel or memory mapped disc channel. The routine returns immediately and
+    a callback is called from the event loop when the read completes.
+    <channel> The channel object.
+    <position> The position (relative to the start of the channel data) to
+    read from.
+    <buffer> The buffer to write the data into. This must not be used until
+    the callback is called.
+    <length> The number of bytes to read.
+    <func> The function which is called when the read completes. The prototype
+    function is [<CH_PROTO_async_func>].
+    <info> An arbitrary pointer passed to <<func>>.
+    [NOTE] The read and write positions of the channel are not changed and
+    the channel buffers are not used. The channel must not be closed until all
+    requests for it have completed. See [<ch_wait_async>].
+    [NOTE] If there are no helper threads the data is read before this routine
+    returns, although the callback is still called from the event loop.
+    [RETURNS] TRUE if the read was started, else FALSE.
+*/
+{
+    int fd;
+    struct request_type *request;
+    static char function_name[] = "ch_read_async";
+
+    if ( (channel == NULL) || (buffer == NULL) || (func == NULL) )
+    {
+	(void) fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
+    }
+    if ( ( fd = ch_get_descriptor (channel) ) < 0 ) return (FALSE);
+    /*  Connections are not seekable  */
+    if ( ch_test_for_connection (channel) ||
+	 ch_test_for_asynchronous (channel) ) return (FALSE);
+    if ( ( request = (struct request_type *) m_alloc (sizeof *request) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "request");
+	return (FALSE);
+    }
+    request->type = REQUEST_READ;
+    request->channel = channel;
+    request->fd = fd;
+    request->position = position;
+    request->buffer = buffer;
+    request->address = NULL;
+    request->length = length;
+    request->func = func;
+    request->info = info;
+    return ( add_request (request) );
+}   /*  End Function ch_read_async  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag ch_prefetch_async (CONST char *address, uaddr length,
+			void (*func) (void *info), void *info)
+/*  [SUMMARY] Page in mapped memory without waiting.
+    [PURPOSE] This routine will start paging in a region of memory which is
+    mapped from a disc file (for example by [<ch_map_disc>]), so that later
+    accesses to the region do not wait for the disc. The routine returns
+    immediately.
+    <address> The start of the region.
+    <length> The length of the region in bytes.
+    <func> The function which is called from the event loop when the region
+    has been paged in. The prototype function is
+    [<CH_PROTO_prefetch_func>]. This may be NULL.
+    <info> An arbitrary pointer passed to <<func>>.
+    [NOTE] The region must not be unmapped until the request has completed.
+    See [<ch_wait_async>].
+    [RETURNS] TRUE if the prefetch was started, else FALSE.
+*/
+{
+    struct request_type *request;
+    static char function_name[] = "ch_prefetch_async";
+
+    if (address == NULL)
+    {
+	(void) fprintf (stderr, "NULL pointer passed\n");
+	a_prog_bug (function_name);
+    }
+    if ( ( request = (struct request_type *) m_alloc (sizeof *request) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "request");
+	return (FALSE);
+    }
+    request->type = REQUEST_TOUCH;
+    request->channel = NULL;
+    request->fd = -1;
+    request->position = 0;
+    request->buffer = NULL;
+    request->address = address;
+    request->length = length;
+    request->func = func;
+    request->info = info;
+    return ( add_request (request) );
+}   /*  End Function ch_prefetch_async  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void ch_wait_async (Channel channel)
+/*  [SUMMARY] Wait for asynchronous requests to complete.
+    [PURPOSE] This routine will wait until asynchronous requests have
+    completed, calling their callbacks.
+    <channel> Only requests for this channel are waited for. If this is NULL
+    all requests (including prefetches) are waited for.
+    [RETURNS] Nothing.
+*/
+{
+    /*  Another wait may already have drained the notification for a request
+	on this channel, so only block while a request is still running  */
+    process_completions (channel);
+    while ( have_requests (channel, FALSE) )
+    {
+	if ( have_requests (channel, TRUE) ) wait_for_notify ();
+	process_completions (channel);
+    }
+}   /*  End Function ch_wait_async  */
+
+
+/*  Private functions follow  */
+
+static flag initialise ()
+/*  [SUMMARY] Initialise the helper threads and notification channel.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    extern char *sys_errlist[];
+
+    if (notify_channel != NULL) return (TRUE);
+    if (pipe (notify_fds) != 0)
+    {
+	(void) fprintf (stderr, "Error creating pipe\t%s\n",
+			sys_errlist[errno]);
+	return (FALSE);
+    }
+    /*  The pipe is drained until empty. If the pipe is full a notification
+	may be dropped, since there are already unread notifications  */
+    (void) fcntl (notify_fds[0], F_SETFL,
+		  fcntl (notify_fds[0], F_GETFL, 0) | O_NONBLOCK);
+    (void) fcntl (notify_fds[1], F_SETFL,
+		  fcntl (notify_fds[1], F_GETFL, 0) | O_NONBLOCK);
+    if ( ( notify_channel =
+	   ch_attach_to_asynchronous_descriptor (notify_fds[0]) ) == NULL )
+    {
+	(void) close (notify_fds[0]);
+	(void) close (notify_fds[1]);
+	return (FALSE);
+    }
+    if (manage_func == NULL)
+    {
+	manage_func = ( flag (*) () ) chm_manage;
+	unmanage_func = chm_unmanage;
+    }
+    if ( !(*manage_func) (notify_channel, NULL, notify_input_func,
+			  ( void (*) () ) NULL, ( flag (*) () ) NULL,
+			  ( flag (*) () ) NULL) )
+    {
+	(void) ch_close (notify_channel);
+	notify_channel = NULL;
+	(void) close (notify_fds[0]);
+	(void) close (notify_fds[1]);
+	return (FALSE);
+    }
+    if ( ( pool = mt_create_pool (NULL) ) == NULL )
+    {
+	(*unmanage_func) (notify_channel);
+	(void) ch_close (notify_channel);
+	notify_channel = NULL;
+	(void) close (notify_fds[0]);
+	(void) close (notify_fds[1]);
+	return (FALSE);
+    }
+    if ( ( max_launched = mt_num_threads (pool) ) < 1 ) max_launched = 1;
+    return (TRUE);
+}   /*  End Function initialise  */
+
+static flag add_request (struct request_type *request)
+/*  [SUMMARY] Add a request to the list and launch it if possible.
+    <request> The request. This is deallocated on failure.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    if ( !initialise () )
+    {
+	m_free ( (char *) request );
+	return (FALSE);
+    }
+    request->launched = FALSE;
+    request->num_read = 0;
+    request->done = FALSE;
+    request->next = NULL;
+    if (last_request == NULL) first_request = request;
+    else last_request->next = request;
+    last_request = request;
+    launch_requests ();
+    return (TRUE);
+}   /*  End Function add_request  */
+
+static void launch_requests ()
+/*  [SUMMARY] Launch waiting requests while there are idle helper threads.
+    [PURPOSE] The number of requests launched is limited so that
+    <<mt_launch_job>> never blocks.
+    [RETURNS] Nothing.
+*/
+{
+    struct request_type *request;
+
+    for (request = first_request;
+	 (request != NULL) && (num_launched < max_launched);
+	 request = request->next)
+    {
+	if (request->launched) continue;
+	request->launched = TRUE;
+	++num_launched;
+	mt_launch_job (pool, request_job, (void *) request, NULL, NULL, NULL);
+    }
+}   /*  End Function launch_requests  */
+
+static void request_job (void *pool_info,
+			 void *call_info1, void *call_info2,
+			 void *call_info3, void *call_info4,
+			 void *thread_info)
+/*  [SUMMARY] Perform a request.
+    <pool_info> The pool information pointer.
+    <call_info1> The request.
+    <call_info2> Unused.
+    <call_info3> Unused.
+    <call_info4> Unused.
+    <thread_info> Unused.
+    [RETURNS] Nothing.
+*/
+{
+    int bytes_read, total = 0;
+    uaddr count;
+    char sum = 0;
+    struct request_type *request = (struct request_type *) call_info1;
+
+    switch (request->type)
+    {
+      case REQUEST_READ:
+	while ( (uaddr) total < request->length )
+	{
+	    bytes_read = pread (request->fd, request->buffer + total,
+				request->length - total,
+				(off_t) (request->position + total) );
+	    if (bytes_read < 0)
+	    {
+		if (errno == EINTR) continue;
+		if (total < 1) total = -1;
+		break;
+	    }
+	    if (bytes_read == 0) break;
+	    total += bytes_read;
+	}
+	break;
+      case REQUEST_TOUCH:
+	/*  Read one byte from each page  */
+	for (count = 0; count < request->length; count += TOUCH_STRIDE)
+	{
+	    sum += ( (CONST volatile char *) request->address )[count];
+	}
+	if (request->length > 0)
+	{
+	    sum += ( (CONST volatile char *) request->address )
+		[request->length - 1];
+	}
+	total = sum;
+	break;
+    }
+    request->num_read = total;
+    request->done = TRUE;
+    (void) write (notify_fds[1], "", 1);
+}   /*  End Function request_job  */
+
+static flag notify_input_func (Channel channel, void **info)
+/*  [SUMMARY] Process completion notifications.
+    <channel> The notification channel.
+    <info> A pointer to the arbitrary information pointer.
+    [RETURNS] TRUE, so that the channel remains managed.
+*/
+{
+    char buffer[DRAIN_BUF_SIZE];
+
+    while (read (notify_fds[0], buffer, DRAIN_BUF_SIZE) == DRAIN_BUF_SIZE);
+    process_completions (NULL);
+    return (TRUE);
+}   /*  End Function notify_input_func  */
+
+static void process_completions (Channel channel)
+/*  [SUMMARY] Call the callbacks for completed requests.
+    <channel> If not NULL, only requests for this channel are processed.
+    [RETURNS] Nothing.
+*/
+{
+    struct request_type *request, *prev;
+
+    /*  Callbacks may add requests, so start again after each one  */
+    for (prev = NULL, request = first_request; request != NULL; )
+    {
+	if ( !request->done ||
+	     ( (channel != NULL) && (request->channel != channel) ) )
+	{
+	    prev = request;
+	    request = request->next;
+	    continue;
+	}
+	if (prev == NULL) first_request = request->next;
+	else prev->next = request->next;
+	if (last_request == request) last_request = prev;
+	--num_launched;
+	launch_requests ();
+	if (request->type == REQUEST_READ)
+	{
+	    (*request->func) (request->channel, request->info,
+			      request->buffer, request->num_read);
+	}
+	else if (request->func != NULL) (*request->func) (request->info);
+	m_free ( (char *) request );
+	prev = NULL;
+	request = first_request;
+    }
+}   /*  End Function process_completions  */
+
+static flag have_requests (Channel channel, flag running_only)
+/*  [SUMMARY] Test if there are outstanding requests.
+    <channel> If not NULL, only requests for this channel are tested.
+    <running_only> If TRUE, requests which have completed but whose callbacks
+    have not yet been called are ignored.
+    [RETURNS] TRUE if there are outstanding requests, else FALSE.
+*/
+{
+    struct request_type *request;
+
+    for (request = first_request; request != NULL; request = request->next)
+    {
+	if (running_only && request->done) continue;
+	if ( (channel == NULL) || (request->channel == channel) )
+	{
+	    return (TRUE);
+	}
+    }
+    return (FALSE);
+}   /*  End Function have_requests  */
+
+static void wait_for_notify ()
+/*  [SUMMARY] Wait until a completion has been signalled and drain the pipe.
+    [RETURNS] Nothing.
+*/
+{
+    fd_set read_fds;
+    char buffer[DRAIN_BUF_SIZE];
+
+    FD_ZERO (&read_fds);
+    FD_SET (notify_fds[0], &read_fds);
+    if (select (notify_fds[0] + 1, &read_fds, NULL, NULL, NULL) < 0) return;
+    while (read (notify_fds[0], buffer, DRAIN_BUF_SIZE) == DRAIN_BUF_SIZE);
+}   /*  End Function wait_for_notify  */
@@ -150,6 +150,10 @@
 
 */
 
+#ifdef OS_Linux
+/*  Needed for O_DIRECT  */
+#  define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <ctype.h>
 #include <sys/types.h>
@@ -212,6 +216,7 @@ if (ch->magic_number != CHANNEL_MAGIC_NUMBER) \
 #define CONV_BUF_SIZE (unsigned int) 4096
 
 #define MMAP_LARGE_SIZE 1048576
+#define DEFAULT_PAGE_SIZE 4096
 
 #define CHANNEL_TYPE_DISC (unsigned int) 0
 #define CHANNEL_TYPE_CONNECTION (unsigned int) 1
@@ -263,6 +268,10 @@ struct channel_type
     unsigned int mmap_access_count;
     unsigned int abs_read_pos;
     unsigned int abs_write_pos;
+    char *read_buf_alloc;
+    char *write_buf_alloc;
+    unsigned int io_alignment;
+    flag direct_io;
     ChConverter top_converter;
     ChConverter next_converter;
     struct channel_type *prev;
@@ -293,6 +302,11 @@ STATIC_FUNCTION (unsigned int ch_write_descriptor,
 		 (Channel channel, CONST char *buffer, unsigned int length) );
 STATIC_FUNCTION (int mywrite_raw,
 		 (Channel channel, CONST char *buffer, unsigned int length) );
+STATIC_FUNCTION (int read_via_buffer,
+		 (Channel channel, char *buffer, unsigned int length) );
+STATIC_FUNCTION (char *alloc_aligned,
+		 (unsigned int size, unsigned int alignment, char **alloc) );
+STATIC_FUNCTION (unsigned int get_page_size, () );
 
 
 /*  Public functions follow  */
@@ -1023,11 +1037,13 @@ flag ch_close (Channel channel)
     }
 #endif
     /*  Deallocate buffers  */
-    if (channel->read_buffer != NULL)
+    if (channel->read_buf_alloc != NULL) m_free (channel->read_buf_alloc);
+    else if (channel->read_buffer != NULL)
     {
 	m_free (channel->read_buffer);
     }
-    if (channel->write_buffer != NULL)
+    if (channel->write_buf_alloc != NULL) m_free (channel->write_buf_alloc);
+    else if (channel->write_buffer != NULL)
     {
 	m_free (channel->write_buffer);
     }
@@ -2147,6 +2163,189 @@ KCallbackFunc ch_tap_io_events (void (*tap_func) (), void *info)
 				  info, NULL, FALSE, NULL, FALSE, FALSE) );
 }   /*  End Function ch_tap_io_events  */
 
+/*EXPERIMENTAL_FUNCTION*/
+flag ch_advise (Channel channel, unsigned int advice, unsigned long position,
+		unsigned long length)
+/*  [SUMMARY] Advise the operating system of the access pattern for a channel.
+    [PURPOSE] This routine will tell the operating system how a disc channel
+    or a memory mapped channel will be accessed, so that it may schedule
+    read-ahead and discard cached pages appropriately.
+    <channel> The channel object.
+    <advice> The advice. See [<CH_ADVICE>] for a list of legal values.
+    <position> The position (relative to the start of the channel data) of the
+    region the advice applies to.
+    <length> The length of the region. If this is 0 the region extends to the
+    end of the channel data.
+    [NOTE] The advice does not change the meaning of any operation on the
+    channel. It is ignored for other channel types.
+    [RETURNS] TRUE if the advice was given to the operating system, else FALSE.
+*/
+{
+#ifdef HAS_MMAP
+#  ifdef MADV_NORMAL
+    int madvice = MADV_NORMAL;
+    unsigned long page_offset;
+#  endif
+#endif
+#ifdef POSIX_FADV_NORMAL
+    int fadvice = POSIX_FADV_NORMAL;
+#endif
+    static char function_name[] = "ch_advise";
+
+    VERIFY_CHANNEL (channel);
+    if (advice > K_CH_ADVISE_DONTNEED)
+    {
+	(void) fprintf (stderr, "Illegal value of: advice : %u\n", advice);
+	a_prog_bug (function_name);
+    }
+    switch (channel->type)
+    {
+      case CHANNEL_TYPE_DISC:
+#ifdef POSIX_FADV_NORMAL
+	switch (advice)
+	{
+	  case K_CH_ADVISE_SEQUENTIAL:
+	    fadvice = POSIX_FADV_SEQUENTIAL;
+	    break;
+	  case K_CH_ADVISE_RANDOM:
+	    fadvice = POSIX_FADV_RANDOM;
+	    break;
+	  case K_CH_ADVISE_WILLNEED:
+	    fadvice = POSIX_FADV_WILLNEED;
+	    break;
+	  case K_CH_ADVISE_DONTNEED:
+	    /*  Dirty pages cannot be discarded  */
+	    if ( !ch_flush (channel) ) return (FALSE);
+	    fadvice = POSIX_FADV_DONTNEED;
+	    break;
+	}
+	return ( (posix_fadvise (channel->fd, (off_t) position, (off_t) length,
+				 fadvice) == 0) ? TRUE : FALSE );
+#else
+	return (FALSE);
+#endif
+      case CHANNEL_TYPE_MMAP:
+#ifdef HAS_MMAP
+#  ifdef MADV_NORMAL
+	if (position >= channel->mem_buf_len) return (TRUE);
+	if ( (length < 1) || (length > channel->mem_buf_len - position) )
+	{
+	    length = channel->mem_buf_len - position;
+	}
+	/*  The start of the region must be on a page boundary  */
+	page_offset = position % get_page_size ();
+	position -= page_offset;
+	length += page_offset;
+	switch (advice)
+	{
+	  case K_CH_ADVISE_SEQUENTIAL:
+	    madvice = MADV_SEQUENTIAL;
+	    break;
+	  case K_CH_ADVISE_RANDOM:
+	    madvice = MADV_RANDOM;
+	    break;
+	  case K_CH_ADVISE_WILLNEED:
+	    madvice = MADV_WILLNEED;
+	    break;
+	  case K_CH_ADVISE_DONTNEED:
+	    madvice = MADV_DONTNEED;
+	    break;
+	}
+	return ( (madvise (channel->memory_buffer + position, length, madvice)
+		  == 0) ? TRUE : FALSE );
+#  endif
+#endif
+	return (FALSE);
+      default:
+	break;
+    }
+    return (FALSE);
+}   /*  End Function ch_advise  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag ch_set_disc_buffer (Channel channel, unsigned int size, flag direct)
+/*  [SUMMARY] Change the buffers used for a disc channel.
+    [PURPOSE] This routine will replace the read and write buffers of a disc
+    channel with page aligned buffers of a specified size, and optionally
+    enable direct I/O which bypasses the operating system cache. Large buffers
+    reduce the number of system calls when streaming large files, and direct
+    I/O avoids filling the cache with data which will only be read once.
+    <channel> The channel object. This must be a disc channel which has not
+    yet been read from or written to.
+    <size> The size of the buffers in bytes. This is rounded up to a multiple
+    of the page size.
+    <direct> If TRUE, direct I/O is enabled. This is only permitted for
+    channels opened for reading only.
+    [NOTE] With direct I/O, data read into buffers which are not page aligned
+    is copied through the channel buffer.
+    [RETURNS] TRUE on success, else FALSE. If FALSE is returned the channel may
+    still be used.
+*/
+{
+    unsigned int page_size;
+    char *buffer, *alloc;
+#ifdef O_DIRECT
+    int flags;
+#endif
+    static char function_name[] = "ch_set_disc_buffer";
+
+    VERIFY_CHANNEL (channel);
+    FLAG_VERIFY (direct);
+    if (channel->type != CHANNEL_TYPE_DISC) return (FALSE);
+    if ( (channel->abs_read_pos > 0) || (channel->abs_write_pos > 0) ||
+	 (channel->bytes_read > 0) || (channel->write_buf_pos > 0) )
+    {
+	(void) fprintf (stderr, "Channel has already been used\n");
+	a_prog_bug (function_name);
+    }
+    if (direct && (channel->write_buffer != NULL) )
+    {
+	(void) fprintf (stderr,
+			"Direct I/O only for read-only channels\n");
+	a_prog_bug (function_name);
+    }
+    page_size = get_page_size ();
+    if (size < page_size) size = page_size;
+    if (size % page_size != 0) size += page_size - size % page_size;
+    if (channel->read_buffer != NULL)
+    {
+	if ( ( buffer = alloc_aligned (size, page_size, &alloc) ) == NULL )
+	{
+	    m_error_notify (function_name, "read buffer");
+	    return (FALSE);
+	}
+	if (channel->read_buf_alloc != NULL) m_free (channel->read_buf_alloc);
+	else m_free (channel->read_buffer);
+	channel->read_buffer = buffer;
+	channel->read_buf_alloc = alloc;
+	channel->read_buf_len = size;
+    }
+    if (channel->write_buffer != NULL)
+    {
+	if ( ( buffer = alloc_aligned (size, page_size, &alloc) ) == NULL )
+	{
+	    m_error_notify (function_name, "write buffer");
+	    return (FALSE);
+	}
+	if (channel->write_buf_alloc != NULL) m_free(channel->write_buf_alloc);
+	else m_free (channel->write_buffer);
+	channel->write_buffer = buffer;
+	channel->write_buf_alloc = alloc;
+	channel->write_buf_len = size;
+    }
+    channel->io_alignment = page_size;
+    if (!direct) return (TRUE);
+#ifdef O_DIRECT
+    if ( ( flags = fcntl (channel->fd, F_GETFL, 0) ) == -1 ) return (FALSE);
+    /*  This fails for filesystems which do not support direct I/O  */
+    if (fcntl (channel->fd, F_SETFL, flags | O_DIRECT) == -1) return (FALSE);
+    channel->direct_io = TRUE;
+    return (TRUE);
+#else
+    return (FALSE);
+#endif
+}   /*  End Function ch_set_disc_buffer  */
+
 
 /*  Private functions follow  */
 
@@ -2199,6 +2398,10 @@ static Channel ch_alloc ()
     channel->mmap_access_count = 0;
     channel->abs_read_pos = 0;
     channel->abs_write_pos = 0;
+    channel->read_buf_alloc = NULL;
+    channel->write_buf_alloc = NULL;
+    channel->io_alignment = 0;
+    channel->direct_io = FALSE;
     channel->top_converter = NULL;
     channel->next_converter = NULL;
     /*  Place channel object into list  */
@@ -2272,9 +2475,15 @@ static unsigned int ch_read_disc (Channel channel, char *buffer,
 	c_call_callbacks (tap_list, NULL);
 	/*  Read an intregal number of blocks directly  */
 	bytes_to_read -= bytes_to_read % (int) channel->read_buf_len;
-	if ( ( bytes_read = read (channel->fd, buffer + read_pos,
-				  bytes_to_read) )
-	    < 0 )
+	/*  Direct I/O requires an aligned destination  */
+	if ( channel->direct_io &&
+	     ( (uaddr) (buffer + read_pos) % channel->io_alignment != 0 ) )
+	{
+	    bytes_read = read_via_buffer (channel, buffer + read_pos,
+					  bytes_to_read);
+	}
+	else bytes_read = read (channel->fd, buffer + read_pos, bytes_to_read);
+	if (bytes_read < 0)
 	{
 	    /*  Error occurred  */
 	    channel->ch_errno = errno;
@@ -2654,3 +2863,68 @@ static int mywrite_raw (Channel channel, CONST char *buffer,
     }
     return (-1);
 }   /*  End Function mywrite_raw  */
+
+static int read_via_buffer (Channel channel, char *buffer, unsigned int length)
+/*  [SUMMARY] Read blocks from a disc channel through the read buffer.
+    [PURPOSE] This routine will read a number of whole blocks from a disc
+    channel, copying them from the read buffer. This is used with direct I/O
+    when the destination is not aligned.
+    <channel> The channel object.
+    <buffer> The buffer to write the data into.
+    <length> The number of bytes to read. This must be a multiple of the read
+    buffer length.
+    [RETURNS] The number of bytes read, or -1 if an error occurred before any
+    data were read.
+*/
+{
+    int bytes_read;
+    unsigned int read_pos;
+
+    for (read_pos = 0; read_pos < length; read_pos += bytes_read)
+    {
+	if ( ( bytes_read = read (channel->fd, channel->read_buffer,
+				  channel->read_buf_len) ) < 0 )
+	{
+	    return ( (read_pos > 0) ? (int) read_pos : -1 );
+	}
+	m_copy (buffer + read_pos, channel->read_buffer, bytes_read);
+	if (bytes_read < channel->read_buf_len)
+	{
+	    /*  Hit End-Of-File  */
+	    return (read_pos + bytes_read);
+	}
+    }
+    return (read_pos);
+}   /*  End Function read_via_buffer  */
+
+static char *alloc_aligned (unsigned int size, unsigned int alignment,
+			    char **alloc)
+/*  [SUMMARY] Allocate an aligned buffer.
+    <size> The size of the buffer in bytes.
+    <alignment> The alignment required. This must be a power of 2.
+    <alloc> The pointer to the allocated memory is written here. This must be
+    passed to [<m_free>] to deallocate the buffer.
+    [RETURNS] The aligned buffer on success, else NULL.
+*/
+{
+    uaddr offset;
+
+    if ( ( *alloc = m_alloc (size + alignment) ) == NULL ) return (NULL);
+    offset = (uaddr) *alloc & (alignment - 1);
+    return ( (offset == 0) ? *alloc : *alloc + alignment - offset );
+}   /*  End Function alloc_aligned  */
+
+static unsigned int get_page_size ()
+/*  [SUMMARY] Get the system page size.
+    [RETURNS] The page size in bytes.
+*/
+{
+    static unsigned int page_size = 0;
+
+    if (page_size > 0) return (page_size);
+#ifdef _SC_PAGESIZE
+    page_size = sysconf (_SC_PAGESIZE);
+#endif
+    if (page_size < 1) page_size = DEFAULT_PAGE_SIZE;
+    return (page_size);
+}   /*  End Function get_page_size  */
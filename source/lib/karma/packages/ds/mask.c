@@ -0,0 +1,919 @@
+/*LINTLIBRARY*/
+/*  mask.c
+
+    This code provides a rasteriser for region masks.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains the various utility routines for rasterising polygons
+    and ellipses into region masks. A region mask is a list of runs of
+    elements along the abscissa, sorted by ordinate and then abscissa. An
+    anti-aliased mask also has runs for elements which are partly inside the
+    region, giving the fraction of each element which is covered. The same
+    mask may be used to write values into an array and to compute statistics
+    for the region, so the region need only be rasterised once.
+
+
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <karma.h>
+#include <karma_ds.h>
+#include <karma_m.h>
+#include <karma_a.h>
+
+
+#if __STDC__ == 1
+#  define MAGIC_NUMBER 1480726395U
+#else
+#  define MAGIC_NUMBER (unsigned int) 1480726395
+#endif
+
+#define VERIFY_MASK(mask) if (mask == NULL) \
+{fprintf (stderr, "NULL region mask passed\n"); \
+ a_prog_bug (function_name); } \
+if (mask->magic_number != MAGIC_NUMBER) \
+{fprintf (stderr, "Invalid region mask object\n"); \
+ a_prog_bug (function_name); }
+
+#define SUBSAMPLES 4          /*  Scanlines per element when anti-aliasing  */
+#define FULL_COVERAGE 0.999   /*  Coverage above this is rounded up to 1  */
+#define MIN_COVERAGE 0.001    /*  Coverage below this is discarded  */
+#define MIN_COPY_LENGTH 16    /*  Shorter runs are filled element by element */
+#define STATS_BUFFER_LENGTH 256
+
+typedef struct
+{
+    double ymin;
+    double ymax;
+    double x;      /*  Abscissa at  ymin   */
+    double dx;     /*  Change in abscissa per unit ordinate  */
+} Edge;
+
+typedef struct
+{
+    double x;      /*  Abscissa at the current scanline  */
+    Edge *edge;
+} ActiveEdge;
+
+struct regionmask_type
+{
+    unsigned int magic_number;
+    unsigned long abs_length;
+    unsigned long ord_length;
+    flag antialias;
+    mask_run *runs;
+    unsigned int num_runs;
+    unsigned int max_runs;
+    float *coverage;           /*  Row accumulator for anti-aliasing  */
+    unsigned long cov_start;   /*  First element touched in accumulator  */
+    unsigned long cov_end;     /*  Last element touched plus 1  */
+};
+
+
+/*  Private functions  */
+STATIC_FUNCTION (KRegionMask create_mask,
+		 (CONST dim_desc *abs_dim_desc, CONST dim_desc *ord_dim_desc,
+		  flag antialias) );
+STATIC_FUNCTION (flag scan_polygon,
+		 (KRegionMask mask, CONST double *x_arr, CONST double *y_arr,
+		  unsigned int num_points) );
+STATIC_FUNCTION (int compare_edges, (CONST void *a, CONST void *b) );
+STATIC_FUNCTION (flag add_run,
+		 (KRegionMask mask, unsigned long ord, unsigned long abs,
+		  unsigned long length, float coverage) );
+STATIC_FUNCTION (flag add_span,
+		 (KRegionMask mask, unsigned long ord, double left,
+		  double right) );
+STATIC_FUNCTION (void accumulate_span,
+		 (KRegionMask mask, double left, double right,
+		  double weight) );
+STATIC_FUNCTION (flag flush_row, (KRegionMask mask, unsigned long ord) );
+STATIC_FUNCTION (double get_position,
+		 (CONST dim_desc *dimension, double coordinate) );
+STATIC_FUNCTION (flag fill_run,
+		 (char *data, unsigned int elem_type, unsigned int stride,
+		  double value[2], unsigned long length) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+KRegionMask ds_mask_create_polygon (CONST dim_desc *abs_dim_desc,
+				    CONST dim_desc *ord_dim_desc,
+				    CONST edit_coord *coords,
+				    unsigned int num_points, flag antialias)
+/*  [SUMMARY] Rasterise a polygon into a region mask.
+    [PURPOSE] This routine will rasterise a concave non-simple polygon into a
+    region mask. Inside-outside test done by Jordan's rule: a point is
+    considered inside if an emanating ray intersects the polygon an odd
+    number of times. The polygon can be clockwise or anti-clockwise.
+    <abs_dim_desc> The abscissa dimension descriptor.
+    <ord_dim_desc> The ordinate dimension descriptor.
+    <coords> The world co-ordinates of the vertices.
+    <num_points> The number of vertices.
+    <antialias> If TRUE, elements along the edges are given the fraction of
+    the element which is inside the polygon. If FALSE, vertices are snapped
+    to the lower co-ordinate and the region includes every element touched by
+    the polygon along each row, as with [<ds_draw_polygon>].
+    [MT-LEVEL] Safe.
+    [RETURNS] A KRegionMask object on success, else NULL.
+*/
+{
+    KRegionMask mask;
+    unsigned int count;
+    double *positions;
+    static char function_name[] = "ds_mask_create_polygon";
+
+    if ( (abs_dim_desc == NULL) || (ord_dim_desc == NULL) ||
+	 ( (coords == NULL) && (num_points > 0) ) )
+    {
+	fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
+    }
+    if ( ( mask = create_mask (abs_dim_desc, ord_dim_desc, antialias) )
+	 == NULL ) return (NULL);
+    if (num_points < 3) return (mask);
+    /*  Abscissa positions are followed by ordinate positions  */
+    if ( ( positions = (double *)
+	   m_alloc (sizeof *positions * num_points * 2) ) == NULL )
+    {
+	m_error_notify (function_name, "vertex array");
+	ds_mask_destroy (mask);
+	return (NULL);
+    }
+    for (count = 0; count < num_points; ++count)
+    {
+	if (antialias)
+	{
+	    positions[count] = get_position (abs_dim_desc,
+					     coords[count].abscissa);
+	    positions[num_points + count] =
+		get_position (ord_dim_desc, coords[count].ordinate);
+	}
+	else
+	{
+	    positions[count] = ds_get_coord_num (abs_dim_desc,
+						 coords[count].abscissa,
+						 SEARCH_BIAS_LOWER);
+	    positions[num_points + count] =
+		ds_get_coord_num (ord_dim_desc, coords[count].ordinate,
+				  SEARCH_BIAS_LOWER);
+	}
+    }
+    if ( !scan_polygon (mask, positions, positions + num_points,
+			num_points) )
+    {
+	m_free ( (char *) positions );
+	ds_mask_destroy (mask);
+	return (NULL);
+    }
+    m_free ( (char *) positions );
+    return (mask);
+}   /*  End Function ds_mask_create_polygon  */
+
+/*EXPERIMENTAL_FUNCTION*/
+KRegionMask ds_mask_create_ellipse (CONST dim_desc *abs_dim_desc,
+				    CONST dim_desc *ord_dim_desc,
+				    double centre_abs, double centre_ord,
+				    double radius_abs, double radius_ord,
+				    flag antialias)
+/*  [SUMMARY] Rasterise an ellipse into a region mask.
+    <abs_dim_desc> The abscissa dimension descriptor.
+    <ord_dim_desc> The ordinate dimension descriptor.
+    <centre_abs> The centre of the ellipse in abscissa real-world co-ordinates.
+    <centre_ord> The centre of the ellipse in ordinate real-world co-ordinates.
+    <radius_abs> The abscissa radius. This must be greater than 0.0.
+    <radius_ord> The ordinate radius. This must be greater than 0.0.
+    <antialias> If TRUE, elements along the edge are given the fraction of the
+    element which is inside the ellipse. If FALSE, each row whose co-ordinate
+    lies inside the ellipse includes the elements closest to the ends of the
+    chord across the ellipse, as with [<ds_draw_ellipse>].
+    [MT-LEVEL] Safe.
+    [RETURNS] A KRegionMask object on success, else NULL.
+*/
+{
+    KRegionMask mask;
+    long first_row, last_row, row, count;
+    unsigned long start, end, swap;
+    double y, dy, half_width, left, right, abs_min, abs_max, tmp;
+    double centre_x, centre_y, radius_x, radius_y;
+    static char function_name[] = "ds_mask_create_ellipse";
+
+    if ( (abs_dim_desc == NULL) || (ord_dim_desc == NULL) )
+    {
+	fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
+    }
+    if (radius_abs <= 0.0)
+    {
+	fprintf (stderr, "Illegal abscissa radius: %e\n", radius_abs);
+	a_prog_bug (function_name);
+    }
+    if (radius_ord <= 0.0)
+    {
+	fprintf (stderr, "Illegal ordinate radius: %e\n", radius_ord);
+	a_prog_bug (function_name);
+    }
+    if ( ( mask = create_mask (abs_dim_desc, ord_dim_desc, antialias) )
+	 == NULL ) return (NULL);
+    /*  Work in co-ordinate numbers  */
+    centre_x = get_position (abs_dim_desc, centre_abs);
+    centre_y = get_position (ord_dim_desc, centre_ord);
+    radius_x = fabs (get_position (abs_dim_desc, centre_abs + radius_abs) -
+		     centre_x);
+    radius_y = fabs (get_position (ord_dim_desc, centre_ord + radius_ord) -
+		     centre_y);
+    first_row = floor (centre_y - radius_y - 0.5);
+    last_row = ceil (centre_y + radius_y + 0.5);
+    if (first_row < 0) first_row = 0;
+    if (last_row >= (long) mask->ord_length) last_row = mask->ord_length - 1;
+    if (antialias)
+    {
+	for (row = first_row; row <= last_row; ++row)
+	{
+	    for (count = 0; count < SUBSAMPLES; ++count)
+	    {
+		y = (double) row - 0.5 + ( (double) count + 0.5 ) / SUBSAMPLES;
+		dy = (y - centre_y) / radius_y;
+		if (fabs (dy) >= 1.0) continue;
+		half_width = radius_x * sqrt (1.0 - dy * dy);
+		accumulate_span (mask, centre_x - half_width,
+				 centre_x + half_width, 1.0 / SUBSAMPLES);
+	    }
+	    if ( !flush_row (mask, row) )
+	    {
+		ds_mask_destroy (mask);
+		return (NULL);
+	    }
+	}
+	return (mask);
+    }
+    abs_min = abs_dim_desc->first_coord;
+    abs_max = abs_dim_desc->last_coord;
+    if (abs_min > abs_max)
+    {
+	tmp = abs_min;
+	abs_min = abs_max;
+	abs_max = tmp;
+    }
+    for (row = first_row; row <= last_row; ++row)
+    {
+	dy = (ds_get_coordinate (ord_dim_desc, row) - centre_ord) / radius_ord;
+	if (fabs (dy) > 1.0) continue;
+	half_width = radius_abs * sqrt (1.0 - dy * dy);
+	left = centre_abs - half_width;
+	right = centre_abs + half_width;
+	if ( (right < abs_min) || (left > abs_max) ) continue;
+	start = ds_get_coord_num (abs_dim_desc, left, SEARCH_BIAS_CLOSEST);
+	end = ds_get_coord_num (abs_dim_desc, right, SEARCH_BIAS_CLOSEST);
+	if (start > end)
+	{
+	    swap = start;
+	    start = end;
+	    end = swap;
+	}
+	if ( !add_run (mask, row, start, end - start + 1, 1.0) )
+	{
+	    ds_mask_destroy (mask);
+	    return (NULL);
+	}
+    }
+    return (mask);
+}   /*  End Function ds_mask_create_ellipse  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void ds_mask_destroy (KRegionMask mask)
+/*  [SUMMARY] Destroy a region mask.
+    <mask> The KRegionMask object.
+    [MT-LEVEL] Safe.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "ds_mask_destroy";
+
+    VERIFY_MASK (mask);
+    if (mask->runs != NULL) m_free ( (char *) mask->runs );
+    if (mask->coverage != NULL) m_free ( (char *) mask->coverage );
+    mask->magic_number = 0;
+    m_free ( (char *) mask );
+}   /*  End Function ds_mask_destroy  */
+
+/*EXPERIMENTAL_FUNCTION*/
+CONST mask_run *ds_mask_get_runs (KRegionMask mask, unsigned int *num_runs)
+/*  [SUMMARY] Get the runs of elements in a region mask.
+    <mask> The KRegionMask object.
+    <num_runs> The number of runs is written here.
+    [MT-LEVEL] Safe.
+    [RETURNS] The runs, sorted by ordinate and then abscissa. Runs do not
+    overlap. The runs must not be modified.
+*/
+{
+    static char function_name[] = "ds_mask_get_runs";
+
+    VERIFY_MASK (mask);
+    *num_runs = mask->num_runs;
+    return (mask->runs);
+}   /*  End Function ds_mask_get_runs  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag ds_mask_fill (KRegionMask mask, char *array, unsigned int elem_type,
+		   unsigned int abs_stride, unsigned int ord_stride,
+		   double value[2])
+/*  [SUMMARY] Write a value into the region of a 2 dimensional array.
+    <mask> The KRegionMask object. The array must have the same dimensions
+    as were used to create the mask.
+    <array> The start of the array (plane) data.
+    <elem_type> The type of the element to draw.
+    <abs_stride> The stride of abscissa co-ordinates in memory (in bytes).
+    <ord_stride> The stride of ordinate co-ordinates in memory (in bytes).
+    <value> The value to write into the array. Elements which are only partly
+    inside the region are blended with this value in proportion to their
+    coverage. Blank elements are overwritten.
+    [MT-LEVEL] Safe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int run_count;
+    unsigned long count;
+    double coverage;
+    double old[2], new[2];
+    char *data;
+    mask_run *run;
+    static char function_name[] = "ds_mask_fill";
+
+    VERIFY_MASK (mask);
+    if ( (array == NULL) || (value == NULL) )
+    {
+	fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
+    }
+    for (run_count = 0, run = mask->runs; run_count < mask->num_runs;
+	 ++run_count, ++run)
+    {
+	data = array + run->ord * ord_stride + run->abs * abs_stride;
+	if (run->coverage >= 1.0)
+	{
+	    if ( !fill_run (data, elem_type, abs_stride, value,
+			    run->length) ) return (FALSE);
+	    continue;
+	}
+	/*  Blend partly covered elements  */
+	coverage = run->coverage;
+	for (count = 0; count < run->length; ++count, data += abs_stride)
+	{
+	    if ( !ds_get_element (data, elem_type, old,
+				  (flag *) NULL) ) return (FALSE);
+	    if (old[0] >= TOOBIG)
+	    {
+		new[0] = value[0];
+		new[1] = value[1];
+	    }
+	    else
+	    {
+		new[0] = old[0] + (value[0] - old[0]) * coverage;
+		new[1] = old[1] + (value[1] - old[1]) * coverage;
+	    }
+	    if (ds_put_element (data, elem_type, new) == NULL) return (FALSE);
+	}
+    }
+    return (TRUE);
+}   /*  End Function ds_mask_fill  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag ds_mask_get_stats (KRegionMask mask, CONST char *array,
+			unsigned int elem_type,
+			unsigned int abs_stride, unsigned int ord_stride,
+			double *weight, double *sum, double *sum_squares,
+			double *min, double *max)
+/*  [SUMMARY] Compute statistics for the region of a 2 dimensional array.
+    [PURPOSE] This routine will compute statistics for the real component of
+    the elements in a region. Each element is weighted by the fraction of the
+    element inside the region. Blank elements are ignored.
+    <mask> The KRegionMask object. The array must have the same dimensions
+    as were used to create the mask.
+    <array> The start of the array (plane) data.
+    <elem_type> The type of the elements.
+    <abs_stride> The stride of abscissa co-ordinates in memory (in bytes).
+    <ord_stride> The stride of ordinate co-ordinates in memory (in bytes).
+    <weight> The sum of the weights is written here. This is the number of
+    elements for a mask which is not anti-aliased.
+    <sum> The weighted sum of the values is written here.
+    <sum_squares> The weighted sum of the squares of the values is written
+    here.
+    <min> The minimum value is written here. If there are no values, TOOBIG
+    is written here.
+    <max> The maximum value is written here. If there are no values, -TOOBIG
+    is written here.
+    [MT-LEVEL] Safe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int run_count, num_values, count;
+    unsigned long done;
+    double run_weight, run_sum, run_sum_squares, val;
+    double values[2 * STATS_BUFFER_LENGTH];
+    CONST char *data;
+    mask_run *run;
+    static char function_name[] = "ds_mask_get_stats";
+
+    VERIFY_MASK (mask);
+    if (array == NULL)
+    {
+	fprintf (stderr, "NULL array pointer passed\n");
+	a_prog_bug (function_name);
+    }
+    *weight = 0.0;
+    *sum = 0.0;
+    *sum_squares = 0.0;
+    *min = TOOBIG;
+    *max = -TOOBIG;
+    for (run_count = 0, run = mask->runs; run_count < mask->num_runs;
+	 ++run_count, ++run)
+    {
+	data = array + run->ord * ord_stride + run->abs * abs_stride;
+	run_weight = 0.0;
+	run_sum = 0.0;
+	run_sum_squares = 0.0;
+	for (done = 0; done < run->length; done += num_values)
+	{
+	    num_values = run->length - done;
+	    if (num_values > STATS_BUFFER_LENGTH)
+	    {
+		num_values = STATS_BUFFER_LENGTH;
+	    }
+	    if ( !ds_get_elements (data + done * abs_stride, elem_type,
+				   abs_stride, values, (flag *) NULL,
+				   num_values) ) return (FALSE);
+	    for (count = 0; count < num_values; ++count)
+	    {
+		if ( ( val = values[count * 2] ) >= TOOBIG ) continue;
+		run_weight += 1.0;
+		run_sum += val;
+		run_sum_squares += val * val;
+		if (val < *min) *min = val;
+		if (val > *max) *max = val;
+	    }
+	}
+	*weight += run_weight * run->coverage;
+	*sum += run_sum * run->coverage;
+	*sum_squares += run_sum_squares * run->coverage;
+    }
+    return (TRUE);
+}   /*  End Function ds_mask_get_stats  */
+
+
+/*  Private functions follow  */
+
+static KRegionMask create_mask (CONST dim_desc *abs_dim_desc,
+				CONST dim_desc *ord_dim_desc, flag antialias)
+/*  [SUMMARY] Create an empty region mask.
+    <abs_dim_desc> The abscissa dimension descriptor.
+    <ord_dim_desc> The ordinate dimension descriptor.
+    <antialias> If TRUE, the mask will be anti-aliased.
+    [RETURNS] A KRegionMask object on success, else NULL.
+*/
+{
+    KRegionMask mask;
+    static char function_name[] = "create_mask";
+
+    if ( ( mask = (KRegionMask) m_alloc (sizeof *mask) ) == NULL )
+    {
+	m_error_notify (function_name, "region mask");
+	return (NULL);
+    }
+    mask->abs_length = abs_dim_desc->length;
+    mask->ord_length = ord_dim_desc->length;
+    mask->antialias = antialias;
+    mask->runs = NULL;
+    mask->num_runs = 0;
+    mask->max_runs = 0;
+    mask->coverage = NULL;
+    mask->cov_start = mask->abs_length;
+    mask->cov_end = 0;
+    mask->magic_number = MAGIC_NUMBER;
+    if (!antialias) return (mask);
+    if ( ( mask->coverage = (float *)
+	   m_alloc (sizeof *mask->coverage * mask->abs_length) ) == NULL )
+    {
+	m_error_notify (function_name, "coverage row");
+	m_free ( (char *) mask );
+	return (NULL);
+    }
+    m_clear ( (char *) mask->coverage,
+	      sizeof *mask->coverage * mask->abs_length );
+    return (mask);
+}   /*  End Function create_mask  */
+
+static flag scan_polygon (KRegionMask mask, CONST double *x_arr,
+			  CONST double *y_arr, unsigned int num_points)
+/*  [SUMMARY] Rasterise a polygon into a region mask.
+    [PURPOSE] This routine will rasterise a polygon using an active edge list.
+    The edges are sorted once by their lowest ordinate, and the active edges
+    are kept in abscissa order from one scanline to the next, so few
+    exchanges are needed per scanline. The algorithm is modified from the
+    Concave Polygon Scan Conversion  by Paul Heckbert from "Graphics Gems",
+    Academic Press, 1990.
+    <mask> The KRegionMask object.
+    <x_arr> The abscissa co-ordinate numbers of the vertices.
+    <y_arr> The ordinate co-ordinate numbers of the vertices.
+    <num_points> The number of vertices.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag keep_last;
+    unsigned int num_edges, num_active, next_edge, count, pos;
+    unsigned int sample, num_samples, lower, upper;
+    long first_row, last_row, row;
+    double y, ymin, ymax;
+    Edge *edges, *edge;
+    ActiveEdge *active;
+    ActiveEdge tmp;
+    static char function_name[] = "scan_polygon";
+
+    if ( ( edges = (Edge *) m_alloc (sizeof *edges * num_points) ) == NULL )
+    {
+	m_error_notify (function_name, "edge array");
+	return (FALSE);
+    }
+    if ( ( active = (ActiveEdge *) m_alloc (sizeof *active * num_points) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "active edge array");
+	m_free ( (char *) edges );
+	return (FALSE);
+    }
+    /*  Build the edge list, dropping horizontal edges  */
+    ymin = y_arr[0];
+    ymax = y_arr[0];
+    for (count = 0, num_edges = 0; count < num_points; ++count)
+    {
+	if (y_arr[count] < ymin) ymin = y_arr[count];
+	if (y_arr[count] > ymax) ymax = y_arr[count];
+	lower = count;
+	upper = (count + 1 < num_points) ? count + 1 : 0;
+	if (y_arr[lower] == y_arr[upper]) continue;
+	if (y_arr[lower] > y_arr[upper])
+	{
+	    lower = upper;
+	    upper = count;
+	}
+	edge = edges + num_edges++;
+	edge->ymin = y_arr[lower];
+	edge->ymax = y_arr[upper];
+	edge->x = x_arr[lower];
+	edge->dx = ( (x_arr[upper] - x_arr[lower]) /
+		     (y_arr[upper] - y_arr[lower]) );
+    }
+    qsort ( (char *) edges, num_edges, sizeof *edges, compare_edges );
+    /*  Without anti-aliasing one scanline is taken through each row, and
+	edges ending on the last row are kept so that the top of the polygon
+	is drawn  */
+    if (mask->antialias)
+    {
+	num_samples = SUBSAMPLES;
+	keep_last = FALSE;
+	first_row = floor (ymin + 0.5);
+	last_row = floor (ymax + 0.5);
+    }
+    else
+    {
+	num_samples = 1;
+	keep_last = TRUE;
+	first_row = ceil (ymin);
+	last_row = floor (ymax);
+    }
+    if (first_row < 0) first_row = 0;
+    if (last_row >= (long) mask->ord_length) last_row = mask->ord_length - 1;
+    num_active = 0;
+    next_edge = 0;
+    for (row = first_row; row <= last_row; ++row)
+    {
+	for (sample = 0; sample < num_samples; ++sample)
+	{
+	    if (mask->antialias)
+	    {
+		y = (double) row - 0.5 + ( (double) sample + 0.5 ) /
+		    (double) num_samples;
+	    }
+	    else y = row;
+	    /*  Add edges which start at or below this scanline  */
+	    for (; (next_edge < num_edges) && (edges[next_edge].ymin <= y);
+		 ++next_edge)
+	    {
+		active[num_active++].edge = edges + next_edge;
+	    }
+	    /*  Remove finished edges and find the intersections, keeping the
+		order of the remaining edges  */
+	    for (count = 0, pos = 0; count < num_active; ++count)
+	    {
+		edge = active[count].edge;
+		if ( (edge->ymax <= y) &&
+		     ( !keep_last || (edge->ymax < ymax) || (y < ymax) ) )
+		{
+		    continue;
+		}
+		active[pos].edge = edge;
+		active[pos].x = edge->x + (y - edge->ymin) * edge->dx;
+		++pos;
+	    }
+	    num_active = pos;
+	    /*  Insertion sort: the list is almost sorted already  */
+	    for (count = 1; count < num_active; ++count)
+	    {
+		tmp = active[count];
+		for (pos = count; (pos > 0) && (active[pos - 1].x > tmp.x);
+		     --pos) active[pos] = active[pos - 1];
+		active[pos] = tmp;
+	    }
+	    /*  Spans between pairs of intersections are inside  */
+	    for (count = 0; count + 1 < num_active; count += 2)
+	    {
+		if (mask->antialias)
+		{
+		    accumulate_span (mask, active[count].x,
+				     active[count + 1].x,
+				     1.0 / (double) num_samples);
+		}
+		else if ( !add_span (mask, row, active[count].x,
+				     active[count + 1].x) )
+		{
+		    m_free ( (char *) edges );
+		    m_free ( (char *) active );
+		    return (FALSE);
+		}
+	    }
+	}
+	if ( mask->antialias && !flush_row (mask, row) )
+	{
+	    m_free ( (char *) edges );
+	    m_free ( (char *) active );
+	    return (FALSE);
+	}
+    }
+    m_free ( (char *) edges );
+    m_free ( (char *) active );
+    return (TRUE);
+}   /*  End Function scan_polygon  */
+
+static int compare_edges (CONST void *a, CONST void *b)
+/*  [SUMMARY] Compare the lowest ordinates of two edges for qsort(3).
+    <a> The first edge.
+    <b> The second edge.
+    [RETURNS] -1, 0 or 1.
+*/
+{
+    CONST Edge *edge_a = (CONST Edge *) a;
+    CONST Edge *edge_b = (CONST Edge *) b;
+
+    if (edge_a->ymin < edge_b->ymin) return (-1);
+    if (edge_a->ymin > edge_b->ymin) return (1);
+    return (0);
+}   /*  End Function compare_edges  */
+
+static flag add_run (KRegionMask mask, unsigned long ord, unsigned long abs,
+		     unsigned long length, float coverage)
+/*  [SUMMARY] Add a run to a region mask.
+    [PURPOSE] This routine will append a run to a region mask. A fully covered
+    run which overlaps or adjoins the previous fully covered run is merged
+    with it.
+    <mask> The KRegionMask object.
+    <ord> The ordinate co-ordinate number.
+    <abs> The first abscissa co-ordinate number. This must not be less than
+    the start of the previous run on the same row.
+    <length> The number of elements.
+    <coverage> The fraction of each element inside the region.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int new_max;
+    mask_run *run;
+    mask_run *new_runs;
+    static char function_name[] = "add_run";
+
+    if (mask->num_runs > 0)
+    {
+	run = mask->runs + mask->num_runs - 1;
+	if ( (run->ord == ord) && (run->coverage >= 1.0) &&
+	     (coverage >= 1.0) && (abs <= run->abs + run->length) )
+	{
+	    if (abs + length > run->abs + run->length)
+	    {
+		run->length = abs + length - run->abs;
+	    }
+	    return (TRUE);
+	}
+    }
+    if (mask->num_runs >= mask->max_runs)
+    {
+	new_max = (mask->max_runs < 1) ? 256 : mask->max_runs * 2;
+	if ( ( new_runs = (mask_run *) m_alloc (sizeof *new_runs * new_max) )
+	     == NULL )
+	{
+	    m_error_notify (function_name, "run array");
+	    return (FALSE);
+	}
+	if (mask->runs != NULL)
+	{
+	    m_copy ( (char *) new_runs, (CONST char *) mask->runs,
+		     sizeof *new_runs * mask->num_runs );
+	    m_free ( (char *) mask->runs );
+	}
+	mask->runs = new_runs;
+	mask->max_runs = new_max;
+    }
+    run = mask->runs + mask->num_runs++;
+    run->ord = ord;
+    run->abs = abs;
+    run->length = length;
+    run->coverage = coverage;
+    return (TRUE);
+}   /*  End Function add_run  */
+
+static flag add_span (KRegionMask mask, unsigned long ord, double left,
+		      double right)
+/*  [SUMMARY] Add every element touched by a span to a region mask.
+    <mask> The KRegionMask object.
+    <ord> The ordinate co-ordinate number.
+    <left> The left end of the span in abscissa co-ordinate numbers.
+    <right> The right end of the span in abscissa co-ordinate numbers.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    double start, end;
+
+    start = floor (left);
+    end = ceil (right);
+    if (start < 0.0) start = 0.0;
+    if (end > (double) mask->abs_length - 1.0)
+    {
+	end = (double) mask->abs_length - 1.0;
+    }
+    if (start > end) return (TRUE);
+    return ( add_run (mask, ord, (unsigned long) start,
+		      (unsigned long) (end - start) + 1, 1.0) );
+}   /*  End Function add_span  */
+
+static void accumulate_span (KRegionMask mask, double left, double right,
+			     double weight)
+/*  [SUMMARY] Add the coverage of a span to the row accumulator.
+    [PURPOSE] This routine will add the coverage of a span along one
+    scanline to the row accumulator of an anti-aliased mask. Element  i
+    covers co-ordinate numbers  i - 0.5  to  i + 0.5  .
+    <mask> The KRegionMask object.
+    <left> The left end of the span in abscissa co-ordinate numbers.
+    <right> The right end of the span in abscissa co-ordinate numbers.
+    <weight> The weight of the scanline.
+    [RETURNS] Nothing.
+*/
+{
+    long start, end, count;
+    float *coverage = mask->coverage;
+
+    start = floor (left + 0.5);
+    end = floor (right + 0.5);
+    if (start < 0)
+    {
+	start = 0;
+	left = -0.5;
+    }
+    if (end >= (long) mask->abs_length)
+    {
+	end = mask->abs_length - 1;
+	right = (double) end + 0.5;
+    }
+    if (start > end) return;
+    if ( (unsigned long) start < mask->cov_start) mask->cov_start = start;
+    if ( (unsigned long) end >= mask->cov_end) mask->cov_end = end + 1;
+    if (start == end)
+    {
+	coverage[start] += (right - left) * weight;
+	return;
+    }
+    /*  Partial elements at the ends, full elements in between  */
+    coverage[start] += ( (double) start + 0.5 - left ) * weight;
+    coverage[end] += ( right - (double) end + 0.5 ) * weight;
+    for (count = start + 1; count < end; ++count) coverage[count] += weight;
+}   /*  End Function accumulate_span  */
+
+static flag flush_row (KRegionMask mask, unsigned long ord)
+/*  [SUMMARY] Convert the row accumulator to runs and clear it.
+    <mask> The KRegionMask object.
+    <ord> The ordinate co-ordinate number of the row.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned long count, start;
+    float *coverage = mask->coverage;
+
+    for (count = mask->cov_start; count < mask->cov_end;)
+    {
+	if (coverage[count] >= FULL_COVERAGE)
+	{
+	    for (start = count;
+		 (count < mask->cov_end) && (coverage[count] >= FULL_COVERAGE);
+		 ++count) coverage[count] = 0.0;
+	    if ( !add_run (mask, ord, start, count - start, 1.0) )
+	    {
+		return (FALSE);
+	    }
+	    continue;
+	}
+	if ( (coverage[count] >= MIN_COVERAGE) &&
+	     !add_run (mask, ord, count, 1, coverage[count]) ) return (FALSE);
+	coverage[count++] = 0.0;
+    }
+    mask->cov_start = mask->abs_length;
+    mask->cov_end = 0;
+    return (TRUE);
+}   /*  End Function flush_row  */
+
+static double get_position (CONST dim_desc *dimension, double coordinate)
+/*  [SUMMARY] Get the fractional co-ordinate number of a co-ordinate.
+    <dimension> The dimension descriptor.
+    <coordinate> The co-ordinate. Co-ordinates outside the dimension are
+    extrapolated.
+    [RETURNS] The co-ordinate number.
+*/
+{
+    flag ascending;
+    unsigned long low, high, mid;
+    CONST double *coords = dimension->coordinates;
+
+    if (dimension->length < 2) return (0.0);
+    if (coords == NULL)
+    {
+	/*  Dimension co-ordinates are regularly spaced  */
+	return ( (coordinate - dimension->first_coord) /
+		 (dimension->last_coord - dimension->first_coord) *
+		 (double) (dimension->length - 1) );
+    }
+    /*  Binary search for the interval containing the co-ordinate  */
+    ascending = (dimension->first_coord < dimension->last_coord) ? TRUE :
+	FALSE;
+    low = 0;
+    high = dimension->length - 1;
+    while (high - low > 1)
+    {
+	mid = (low + high) / 2;
+	if ( ( (coords[mid] <= coordinate) && ascending ) ||
+	     ( (coords[mid] > coordinate) && !ascending ) ) low = mid;
+	else high = mid;
+    }
+    return ( (double) low +
+	     (coordinate - coords[low]) / (coords[high] - coords[low]) );
+}   /*  End Function get_position  */
+
+static flag fill_run (char *data, unsigned int elem_type, unsigned int stride,
+		      double value[2], unsigned long length)
+/*  [SUMMARY] Write a value to a run of elements.
+    [PURPOSE] This routine will write a value to a run of elements. Long runs
+    of contiguous elements are filled by writing one element and then copying
+    blocks of doubling size, which uses the wide copies in [<m_copy>] for any
+    element type.
+    <data> The first element.
+    <elem_type> The type of the elements.
+    <stride> The stride of the elements in memory (in bytes).
+    <value> The value to write.
+    <length> The number of elements.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    uaddr size, filled, num;
+    extern char host_type_sizes[NUMTYPES];
+
+    size = host_type_sizes[elem_type];
+    if ( (length < MIN_COPY_LENGTH) || (stride != size) )
+    {
+	return ( ds_put_element_many_times (data, elem_type, stride, value,
+					    length) );
+    }
+    if (ds_put_element (data, elem_type, value) == NULL) return (FALSE);
+    for (filled = 1; filled < length; filled += num)
+    {
+	num = (filled < length - filled) ? filled : length - filled;
+	m_copy (data + filled * size, data, num * size);
+    }
+    return (TRUE);
+}   /*  End Function fill_run  */
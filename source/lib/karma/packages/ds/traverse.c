@@ -58,9 +58,52 @@
 #include <math.h>
 #include <karma.h>
 #include <karma_ds.h>
+#include <karma_mt.h>
 #include <karma_m.h>
 #include <karma_a.h>
 
+#define LEAF_BYTES 16384
+#define PARALLEL_BYTES 1048576
+
+
+/*  Structure declarations follow  */
+
+typedef struct
+{
+    CONST char *in;
+    char *out;
+    unsigned int num_dim;
+    unsigned long *lengths;      /*  Lengths of the new dimensions         */
+    unsigned long *in_strides;   /*  Old array strides (bytes) for each    */
+    unsigned long *out_strides;  /*  New array strides (bytes) for each    */
+    unsigned long block_size;    /*  Bytes which are copied as one unit    */
+} reorder_info_type;
+
+typedef struct
+{
+    unsigned int v[2];
+} block8_type;
+
+typedef struct
+{
+    unsigned int v[4];
+} block16_type;
+
+
+/*  Private functions  */
+STATIC_FUNCTION (void reorder_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (void reorder_box,
+		 (reorder_info_type *info, unsigned long *lo,
+		  unsigned long *hi, unsigned long *coordinates) );
+STATIC_FUNCTION (void reorder_tile,
+		 (reorder_info_type *info, CONST unsigned long *lo,
+		  CONST unsigned long *hi, unsigned long *coordinates) );
+STATIC_FUNCTION (flag reorder_in_place,
+		 (reorder_info_type *info, char *array,
+		  unsigned long num_blocks) );
+
 /*PUBLIC_FUNCTION*/
 flag ds_reorder_array (array_desc *arr_desc, unsigned int order_list[],
 		       char *array, flag mod_desc)
@@ -75,21 +118,31 @@ flag ds_reorder_array (array_desc *arr_desc, unsigned int order_list[],
     re-ordered, else they will not be. This is useful to traverse a data
     structure, re-ordering the data, and then finally re-ordering the array
     descriptor to match.
+    [NOTE] The data are copied into a temporary array in cache-sized tiles
+    using the shared thread pool, and then copied back. If the temporary array
+    cannot be allocated, the data are instead permuted in place by following
+    the cycles of the permutation, which only requires one bit of workspace per
+    block of data but is much slower.
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    flag next = TRUE;
+    KThreadPool pool;
     unsigned int num_dim;
     unsigned int dim_count = 0;
     unsigned int start_dim;
     unsigned int end_dim;
-    unsigned int block_size;
-    unsigned int packet_size;
-    unsigned int array_size;
+    unsigned int split_dim;
+    unsigned int num_jobs, job_count;
+    unsigned long packet_size;
+    unsigned long array_size;
+    unsigned long block_size;
+    unsigned long stride;
+    unsigned long start, end;
     char *new_array;
-    char *out_array;
-    unsigned long *coordinates;
+    unsigned long *buffer, *box;
+    unsigned long *lengths, *in_strides, *out_strides;
     dim_desc **new_dim_list;
+    reorder_info_type info;
     static char function_name[] = "ds_reorder_array";
 
     if ( (arr_desc == NULL) || (order_list == NULL) )
@@ -140,59 +193,107 @@ flag ds_reorder_array (array_desc *arr_desc, unsigned int order_list[],
 	/*  Array data needs to be re-ordered  */
 	array_size = ds_get_array_size (arr_desc);
 	packet_size = ds_get_packet_size (arr_desc->packet);
-	if ( ( new_array = m_alloc (packet_size * array_size) ) == NULL )
+	/*  Determine size of block we can copy
+	    (bottom dimensions with same order)  */
+	block_size = packet_size;
+	for (dim_count = end_dim; dim_count < num_dim; ++dim_count)
 	{
-	    m_error_notify (function_name, "temporary array");
-	    return (FALSE);
+	    block_size *= arr_desc->dimensions[dim_count]->length;
 	}
-	if ( ( coordinates = (unsigned long *) m_alloc (sizeof *coordinates *
-							num_dim) ) == NULL )
+	/*  Share the largest re-ordered dimension between the jobs  */
+	for (dim_count = 1, split_dim = 0; dim_count < end_dim; ++dim_count)
 	{
-	    m_error_notify (function_name, "co-ordinate counter array");
-	    m_free (new_array);
+	    if (arr_desc->dimensions[ order_list[dim_count] ]->length >
+		arr_desc->dimensions[ order_list[split_dim] ]->length)
+	    {
+		split_dim = dim_count;
+	    }
+	}
+	pool = mt_get_shared_pool ();
+	num_jobs = mt_num_threads (pool);
+	if (packet_size * array_size < PARALLEL_BYTES) num_jobs = 1;
+	if (num_jobs > arr_desc->dimensions[ order_list[split_dim] ]->length)
+	{
+	    num_jobs = arr_desc->dimensions[ order_list[split_dim] ]->length;
+	}
+	/*  Allocate the length and stride arrays plus the box and co-ordinate
+	    counter arrays for each job  */
+	if ( ( buffer = (unsigned long *)
+	       m_alloc (sizeof *buffer * end_dim * (3 + num_jobs * 3) ) )
+	     == NULL )
+	{
+	    m_error_notify (function_name, "stride arrays");
 	    return (FALSE);
 	}
-	for (dim_count = 0; dim_count < num_dim; ++dim_count)
+	lengths = buffer;
+	in_strides = buffer + end_dim;
+	out_strides = buffer + end_dim * 2;
+	/*  Compute the strides (in bytes) through the old array, then arrange
+	    the lengths and old strides in the new order  */
+	for (dim_count = end_dim, stride = block_size; dim_count > 0;
+	     --dim_count)
 	{
-	    coordinates[dim_count] = 0;
+	    out_strides[dim_count - 1] = stride;
+	    stride *= arr_desc->dimensions[dim_count - 1]->length;
 	}
-	/*  Determine size of block we can copy
-	    (bottom dimensions with same order)  */
-	block_size = packet_size;
-	for (dim_count = end_dim; dim_count < num_dim; ++dim_count)
+	for (dim_count = 0; dim_count < end_dim; ++dim_count)
 	{
-	    block_size *= arr_desc->dimensions[dim_count]->length;
+	    lengths[dim_count] =
+		arr_desc->dimensions[ order_list[dim_count] ]->length;
+	    in_strides[dim_count] = out_strides[ order_list[dim_count] ];
 	}
-	out_array = new_array;
-	while (next == TRUE)
+	for (dim_count = end_dim, stride = block_size; dim_count > 0;
+	     --dim_count)
 	{
-	    /*  Process this co-ordinate  */
-	    m_copy (out_array,
-		    array + ds_get_array_offset (arr_desc,
-						 coordinates) * packet_size,
-		    block_size);
-	    out_array += block_size;
-	    /*  Increment the dimension co-ordinate(s)  */
-	    next = FALSE;
-	    dim_count = end_dim;
-	    while ( !next && (dim_count > 0) )
+	    out_strides[dim_count - 1] = stride;
+	    stride *= lengths[dim_count - 1];
+	}
+	info.in = array;
+	info.num_dim = end_dim;
+	info.lengths = lengths;
+	info.in_strides = in_strides;
+	info.out_strides = out_strides;
+	info.block_size = block_size;
+	if ( ( new_array = m_alloc (packet_size * array_size) ) == NULL )
+	{
+	    /*  Not enough memory for a copy: permute in place  */
+	    if ( !reorder_in_place (&info, array,
+				    packet_size * array_size / block_size) )
 	    {
-		if (++coordinates[ order_list[dim_count - 1] ] >=
-		    arr_desc->dimensions[order_list[dim_count-1]]->length)
+		m_free ( (char *) buffer );
+		return (FALSE);
+	    }
+	}
+	else
+	{
+	    info.out = new_array;
+	    for (job_count = 0; job_count < num_jobs; ++job_count)
+	    {
+		start = lengths[split_dim] * job_count / num_jobs;
+		end = lengths[split_dim] * (job_count + 1) / num_jobs;
+		box = buffer + end_dim * (3 + job_count * 3);
+		for (dim_count = 0; dim_count < end_dim; ++dim_count)
 		{
-		    coordinates[ order_list[dim_count - 1] ] = 0;
-		    --dim_count;
+		    box[dim_count] = 0;
+		    box[end_dim + dim_count] = lengths[dim_count];
 		}
-		else
+		box[split_dim] = start;
+		box[end_dim + split_dim] = end;
+		if (num_jobs < 2)
 		{
-		    next = TRUE;
+		    reorder_job_func (NULL, &info, box, box + end_dim,
+				      box + end_dim * 2, NULL);
 		}
+		else mt_launch_job (pool, reorder_job_func, &info, box,
+				    box + end_dim, box + end_dim * 2);
 	    }
+	    if (num_jobs > 1) mt_wait_for_all_jobs (pool);
+	    /*  Copy re-ordered array back to old array and free temporary
+		array  */
+	    m_copy (array, new_array, array_size * packet_size);
+	    m_free (new_array);
 	}
-	m_free ( (char *) coordinates );
-	/*  Copy re-ordered array back to old array and free temporary array */
-	m_copy (array, new_array, array_size * packet_size);
-	m_free (new_array);
+	m_free ( (char *) buffer );
     }
     if (mod_desc == TRUE)
     {
@@ -1045,3 +1146,220 @@ flag ds_traverse_list ( packet_desc *desc1, list_header *head1,
     }
     return (TRUE);
 }   /*  End Function ds_traverse_list  */
+
+
+/*  Private functions follow  */
+
+static void reorder_job_func (void *pool_info,
+			      void *call_info1, void *call_info2,
+			      void *call_info3, void *call_info4,
+			      void *thread_info)
+/*  [SUMMARY] Re-order a box of an array.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The re-ordering information.
+    <call_info2> The first co-ordinates of the box, in the new order.
+    <call_info3> The last co-ordinates plus 1 of the box, in the new order.
+    <call_info4> A co-ordinate counter array for the job.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    reorder_box ( (reorder_info_type *) call_info1,
+		  (unsigned long *) call_info2, (unsigned long *) call_info3,
+		  (unsigned long *) call_info4 );
+}   /*  End Function reorder_job_func  */
+
+static void reorder_box (reorder_info_type *info, unsigned long *lo,
+			 unsigned long *hi, unsigned long *coordinates)
+/*  [SUMMARY] Recursively re-order a box of an array.
+    [PURPOSE] This routine will split a box in half along its longest side
+    until it is small enough for the old and new data to fit in the cache,
+    whatever the cache size is, and then copy it.
+    <info> The re-ordering information.
+    <lo> The first co-ordinates of the box, in the new order. This is modified
+    but restored before returning.
+    <hi> The last co-ordinates plus 1 of the box. This is modified but
+    restored before returning.
+    <coordinates> A co-ordinate counter array.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int dim_count, split_dim = 0;
+    unsigned long extent, saved;
+    unsigned long max_extent = 0;
+    unsigned long num_bytes = info->block_size;
+
+    for (dim_count = 0; dim_count < info->num_dim; ++dim_count)
+    {
+	extent = hi[dim_count] - lo[dim_count];
+	num_bytes *= extent;
+	if (extent > max_extent)
+	{
+	    max_extent = extent;
+	    split_dim = dim_count;
+	}
+    }
+    if ( (num_bytes <= LEAF_BYTES) || (max_extent < 2) )
+    {
+	reorder_tile (info, lo, hi, coordinates);
+	return;
+    }
+    saved = hi[split_dim];
+    hi[split_dim] = lo[split_dim] + max_extent / 2;
+    reorder_box (info, lo, hi, coordinates);
+    hi[split_dim] = saved;
+    saved = lo[split_dim];
+    lo[split_dim] += max_extent / 2;
+    reorder_box (info, lo, hi, coordinates);
+    lo[split_dim] = saved;
+}   /*  End Function reorder_box  */
+
+static void reorder_tile (reorder_info_type *info, CONST unsigned long *lo,
+			  CONST unsigned long *hi, unsigned long *coordinates)
+/*  [SUMMARY] Copy a small box of an array into the new order.
+    <info> The re-ordering information.
+    <lo> The first co-ordinates of the box, in the new order.
+    <hi> The last co-ordinates plus 1 of the box.
+    <coordinates> A co-ordinate counter array.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int dim_count;
+    unsigned long count, num_values;
+    unsigned int last = info->num_dim - 1;
+    unsigned long in_stride = info->in_strides[last];
+    unsigned long block_size = info->block_size;
+    CONST char *in;
+    char *out;
+
+    num_values = hi[last] - lo[last];
+    for (dim_count = 0; dim_count < last; ++dim_count)
+    {
+	coordinates[dim_count] = lo[dim_count];
+    }
+    while (TRUE)
+    {
+	in = info->in + lo[last] * in_stride;
+	out = info->out + lo[last] * block_size;
+	for (dim_count = 0; dim_count < last; ++dim_count)
+	{
+	    in += coordinates[dim_count] * info->in_strides[dim_count];
+	    out += coordinates[dim_count] * info->out_strides[dim_count];
+	}
+	/*  Copy one line using the natural type for common block sizes  */
+	switch (block_size)
+	{
+	  case 1:
+	    for (count = 0; count < num_values; ++count)
+	    {
+		out[count] = in[count * in_stride];
+	    }
+	    break;
+	  case 2:
+	    for (count = 0; count < num_values; ++count)
+	    {
+		( (unsigned short *) out )[count] =
+		    *(CONST unsigned short *) (in + count * in_stride);
+	    }
+	    break;
+	  case 4:
+	    for (count = 0; count < num_values; ++count)
+	    {
+		( (unsigned int *) out )[count] =
+		    *(CONST unsigned int *) (in + count * in_stride);
+	    }
+	    break;
+	  case 8:
+	    for (count = 0; count < num_values; ++count)
+	    {
+		( (block8_type *) out )[count] =
+		    *(CONST block8_type *) (in + count * in_stride);
+	    }
+	    break;
+	  case 16:
+	    for (count = 0; count < num_values; ++count)
+	    {
+		( (block16_type *) out )[count] =
+		    *(CONST block16_type *) (in + count * in_stride);
+	    }
+	    break;
+	  default:
+	    for (count = 0; count < num_values; ++count)
+	    {
+		m_copy (out + count * block_size, in + count * in_stride,
+			block_size);
+	    }
+	    break;
+	}
+	/*  Increment the co-ordinate counters  */
+	for (dim_count = last; dim_count > 0; --dim_count)
+	{
+	    if (++coordinates[dim_count - 1] < hi[dim_count - 1]) break;
+	    coordinates[dim_count - 1] = lo[dim_count - 1];
+	}
+	if (dim_count < 1) return;
+    }
+}   /*  End Function reorder_tile  */
+
+static flag reorder_in_place (reorder_info_type *info, char *array,
+			      unsigned long num_blocks)
+/*  [SUMMARY] Re-order an array in place.
+    [PURPOSE] This routine will re-order an array without a temporary copy,
+    by following each cycle of the permutation. A bitmap records the blocks
+    which have already been moved.
+    <info> The re-ordering information.
+    <array> The array.
+    <num_blocks> The number of blocks in the array.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int dim_count;
+    unsigned long first, current, source, remainder, offset;
+    unsigned long block_size = info->block_size;
+    unsigned char *done;
+    char *saved;
+    static char function_name[] = "ds_reorder_array";
+
+    if ( ( done = (unsigned char *) m_alloc (num_blocks / 8 + 1) ) == NULL )
+    {
+	m_error_notify (function_name, "in-place bitmap");
+	return (FALSE);
+    }
+    if ( ( saved = m_alloc (block_size) ) == NULL )
+    {
+	m_error_notify (function_name, "in-place block");
+	m_free ( (char *) done );
+	return (FALSE);
+    }
+    m_clear ( (char *) done, num_blocks / 8 + 1 );
+    for (first = 0; first < num_blocks; ++first)
+    {
+	if (done[first >> 3] & (1 << (first & 7) ) ) continue;
+	m_copy (saved, array + first * block_size, block_size);
+	current = first;
+	while (TRUE)
+	{
+	    done[current >> 3] |= 1 << (current & 7);
+	    /*  Find where the new block at this position comes from  */
+	    for (dim_count = info->num_dim, remainder = current, offset = 0;
+		 dim_count > 0; --dim_count)
+	    {
+		offset += remainder % info->lengths[dim_count - 1] *
+		    info->in_strides[dim_count - 1];
+		remainder /= info->lengths[dim_count - 1];
+	    }
+	    source = offset / block_size;
+	    if (source == first)
+	    {
+		m_copy (array + current * block_size, saved, block_size);
+		break;
+	    }
+	    m_copy (array + current * block_size, array + source * block_size,
+		    block_size);
+	    current = source;
+	}
+    }
+    m_free (saved);
+    m_free ( (char *) done );
+    return (TRUE);
+}   /*  End Function reorder_in_place  */
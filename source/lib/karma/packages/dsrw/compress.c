@@ -0,0 +1,318 @@
+/*LINTLIBRARY*/
+/*  compress.c
+
+    This code provides a fast block compressor for array data.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains the routines which compress and decompress blocks of
+    array data. The bytes of each value are first shuffled so that bytes of
+    equal significance are adjacent (the high-order bytes of noisy data are
+    often very similar), and then a simple LZ77 coder is applied. The coded
+    format is a sequence of tokens, each of which gives a run of literal bytes
+    followed by a match with earlier output:
+
+    token:             literal length (high 4 bits), match length - 4 (low 4)
+    [literal length]:  extra bytes of 255 and a final byte if the field was 15
+    literals:          the literal bytes
+    offset:            2 bytes, least significant first
+    [match length]:    extra bytes of 255 and a final byte if the field was 15
+
+    The final token has only literals. The last MIN_TAIL bytes of a block are
+    always coded as literals.
+
+
+*/
+#include <stdio.h>
+#include <karma.h>
+#include <karma_dsrw.h>
+#include <karma_a.h>
+
+
+#define HASH_BITS 12
+#define MIN_MATCH 4
+#define MIN_TAIL 12
+#define MAX_OFFSET 65535
+
+#define READ32(p) ( (unsigned int) (p)[0] | ( (unsigned int) (p)[1] << 8 ) | \
+		    ( (unsigned int) (p)[2] << 16 ) | \
+		    ( (unsigned int) (p)[3] << 24 ) )
+#define HASH(v) ( ( (v) * 2654435761U ) >> (32 - HASH_BITS) )
+
+
+/*  Private functions  */
+STATIC_FUNCTION (unsigned char *write_length,
+		 (unsigned char *out, unsigned long length) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+unsigned long dsrw_compress_block (CONST char *input, unsigned long length,
+				   unsigned int stride, char *output,
+				   unsigned long max_length, char *workspace)
+/*  [SUMMARY] Compress a block of data.
+    <input> The data to compress.
+    <length> The length of the data in bytes.
+    <stride> The size of each value in bytes. The bytes of the values are
+    shuffled before compression. If this is 1 no shuffling is done.
+    <output> The compressed data are written here.
+    <max_length> The maximum number of bytes to write to the output.
+    <workspace> A buffer of <<length>> bytes for the shuffled data.
+    [MT-LEVEL] Safe.
+    [RETURNS] The compressed length in bytes, or 0 if the data could not be
+    compressed into <<max_length>> bytes.
+*/
+{
+    unsigned int hash, value;
+    unsigned long num_values, count, byte_count, pos, ref, anchor, limit;
+    unsigned long match_length, literal_length, step;
+    CONST unsigned char *in;
+    unsigned char *out = (unsigned char *) output;
+    unsigned char *out_end = out + max_length;
+    unsigned char *token;
+    unsigned long table[1 << HASH_BITS];
+
+    /*  Shuffle the bytes  */
+    if ( (stride > 1) && (length >= stride) )
+    {
+	num_values = length / stride;
+	for (byte_count = 0; byte_count < stride; ++byte_count)
+	{
+	    for (count = 0; count < num_values; ++count)
+	    {
+		workspace[byte_count * num_values + count] =
+		    input[count * stride + byte_count];
+	    }
+	}
+	for (pos = num_values * stride; pos < length; ++pos)
+	{
+	    workspace[pos] = input[pos];
+	}
+	in = (CONST unsigned char *) workspace;
+    }
+    else in = (CONST unsigned char *) input;
+    /*  Table entries hold the position plus 1, so 0 means no entry  */
+    for (hash = 0; hash < (1 << HASH_BITS); ++hash) table[hash] = 0;
+    anchor = 0;
+    pos = 0;
+    limit = (length > MIN_TAIL) ? length - MIN_TAIL : 0;
+    while (pos < limit)
+    {
+	value = READ32 (in + pos);
+	hash = HASH (value);
+	ref = table[hash];
+	table[hash] = pos + 1;
+	if ( (ref < 1) || (pos + 1 - ref > MAX_OFFSET) ||
+	     (READ32 (in + ref - 1) != value) )
+	{
+	    /*  No match: skip faster through data which do not compress  */
+	    step = 1 + ( (pos - anchor) >> 6 );
+	    pos += step;
+	    continue;
+	}
+	--ref;
+	/*  Extend the match  */
+	for (match_length = MIN_MATCH;
+	     (pos + match_length < limit) &&
+		 (in[ref + match_length] == in[pos + match_length]);
+	     ++match_length);
+	/*  Write the token, literals and match  */
+	literal_length = pos - anchor;
+	if (out + 1 + literal_length + literal_length / 255 + 8 > out_end)
+	{
+	    return (0);
+	}
+	token = out++;
+	*token = ( (literal_length < 15) ? literal_length : 15 ) << 4;
+	if (literal_length >= 15)
+	{
+	    out = write_length (out, literal_length - 15);
+	}
+	for (count = 0; count < literal_length; ++count)
+	{
+	    out[count] = in[anchor + count];
+	}
+	out += literal_length;
+	*out++ = (pos - ref) & 0xff;
+	*out++ = (pos - ref) >> 8;
+	if (match_length - MIN_MATCH < 15) *token |= match_length - MIN_MATCH;
+	else
+	{
+	    *token |= 15;
+	    if (out + (match_length - MIN_MATCH) / 255 + 1 > out_end)
+	    {
+		return (0);
+	    }
+	    out = write_length (out, match_length - MIN_MATCH - 15);
+	}
+	pos += match_length;
+	anchor = pos;
+    }
+    /*  Write the final literals  */
+    literal_length = length - anchor;
+    if (out + 1 + literal_length + literal_length / 255 + 1 > out_end)
+    {
+	return (0);
+    }
+    token = out++;
+    *token = ( (literal_length < 15) ? literal_length : 15 ) << 4;
+    if (literal_length >= 15) out = write_length (out, literal_length - 15);
+    for (count = 0; count < literal_length; ++count)
+    {
+	out[count] = in[anchor + count];
+    }
+    out += literal_length;
+    return (out - (unsigned char *) output);
+}   /*  End Function dsrw_compress_block  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag dsrw_decompress_block (CONST char *input, unsigned long input_length,
+			    char *output, unsigned long length,
+			    unsigned int stride, char *workspace)
+/*  [SUMMARY] Decompress a block of data.
+    <input> The compressed data.
+    <input_length> The length of the compressed data in bytes.
+    <output> The decompressed data are written here.
+    <length> The length of the decompressed data in bytes.
+    <stride> The size of each value in bytes. This must be the same as the
+    value given to [<dsrw_compress_block>].
+    <workspace> A buffer of <<length>> bytes for the shuffled data.
+    [MT-LEVEL] Safe.
+    [RETURNS] TRUE on success, else FALSE if the compressed data are corrupt.
+*/
+{
+    unsigned int token;
+    unsigned long num_values, count, byte_count, pos;
+    unsigned long literal_length, match_length, offset;
+    unsigned char extra;
+    CONST unsigned char *in = (CONST unsigned char *) input;
+    CONST unsigned char *in_end = in + input_length;
+    unsigned char *out;
+    static char function_name[] = "dsrw_decompress_block";
+
+    out = (unsigned char *) ( (stride > 1) ? workspace : output );
+    pos = 0;
+    while (in < in_end)
+    {
+	token = *in++;
+	literal_length = token >> 4;
+	if (literal_length == 15)
+	{
+	    do
+	    {
+		if (in >= in_end) break;
+		extra = *in++;
+		literal_length += extra;
+	    }
+	    while (extra == 255);
+	}
+	if ( (in + literal_length > in_end) ||
+	     (pos + literal_length > length) )
+	{
+	    (void) fprintf (stderr, "%s: corrupt literal run\n",
+			    function_name);
+	    return (FALSE);
+	}
+	for (count = 0; count < literal_length; ++count)
+	{
+	    out[pos + count] = in[count];
+	}
+	in += literal_length;
+	pos += literal_length;
+	/*  The final token has no match  */
+	if (in >= in_end) break;
+	if (in + 2 > in_end)
+	{
+	    (void) fprintf (stderr, "%s: truncated match\n", function_name);
+	    return (FALSE);
+	}
+	offset = in[0] | (in[1] << 8);
+	in += 2;
+	match_length = token & 15;
+	if (match_length == 15)
+	{
+	    do
+	    {
+		if (in >= in_end) break;
+		extra = *in++;
+		match_length += extra;
+	    }
+	    while (extra == 255);
+	}
+	match_length += MIN_MATCH;
+	if ( (offset < 1) || (offset > pos) || (pos + match_length > length) )
+	{
+	    (void) fprintf (stderr, "%s: corrupt match\n", function_name);
+	    return (FALSE);
+	}
+	/*  Byte copy, since the match may overlap the output  */
+	for (count = 0; count < match_length; ++count)
+	{
+	    out[pos + count] = out[pos - offset + count];
+	}
+	pos += match_length;
+    }
+    if (pos != length)
+    {
+	(void) fprintf (stderr, "%s: decompressed: %lu bytes, wanted: %lu\n",
+			function_name, pos, length);
+	return (FALSE);
+    }
+    /*  Unshuffle the bytes  */
+    if ( (stride > 1) && (length >= stride) )
+    {
+	num_values = length / stride;
+	for (byte_count = 0; byte_count < stride; ++byte_count)
+	{
+	    for (count = 0; count < num_values; ++count)
+	    {
+		output[count * stride + byte_count] =
+		    workspace[byte_count * num_values + count];
+	    }
+	}
+	for (pos = num_values * stride; pos < length; ++pos)
+	{
+	    output[pos] = workspace[pos];
+	}
+    }
+    else if (stride > 1)
+    {
+	for (pos = 0; pos < length; ++pos) output[pos] = workspace[pos];
+    }
+    return (TRUE);
+}   /*  End Function dsrw_decompress_block  */
+
+
+/*  Private functions follow  */
+
+static unsigned char *write_length (unsigned char *out, unsigned long length)
+/*  [SUMMARY] Write the extra bytes of a long literal or match length.
+    <out> The output pointer.
+    <length> The length beyond the 15 held in the token.
+    [RETURNS] The new output pointer.
+*/
+{
+    for (; length >= 255; length -= 255) *out++ = 255;
+    *out++ = length;
+    return (out);
+}   /*  End Function write_length  */
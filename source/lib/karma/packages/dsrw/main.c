@@ -169,6 +169,7 @@
 #include <karma_ds.h>
 #include <karma_m.h>
 #include <karma_a.h>
+#include <karma_mt.h>
 #define OS_H_VARIABLES
 #include <os.h>
 
@@ -176,6 +177,13 @@
 #define VERSION_NUMBER (unsigned long) 0
 #define ARRAY_BOUNDARY (unsigned int) 16
 #define VXMVX_REMOTE_MEMCPY_BOUNDARY 16
+#define BULK_BUF_SIZE 65536
+#define BULK_READ_LENGTH 4194304  /*  4 MBytes  */
+#define COMPRESSED_ARRAY_FLAG 0x80000000  /*  Set in the pad size      */
+#define RAW_CHUNK_FLAG 0x80000000         /*  Set in the chunk length  */
+#define CHUNK_SIZE 262144
+#define MIN_COMPRESS_BYTES 65536
+#define MAX_SHUFFLE_STRIDE 64
 
 #define ARRAYP        6    /*Obsolete*/
 
@@ -209,15 +217,65 @@
 #endif
 
 
+/*  Structure declarations follow  */
+
+/*  A chunk of a compressed array. When writing, the packets are converted to
+    network format in <raw> and compressed into <buffer>. When reading, the
+    compressed data are read into <buffer> and decompressed into the array  */
+typedef struct
+{
+    CONST char *array;            /*  The uncompressed data in the array  */
+    unsigned long length;         /*  Uncompressed length (bytes)          */
+    unsigned long stored_length;  /*  Length in the file (bytes)           */
+    flag stored_raw;              /*  Chunk could not be compressed        */
+    flag ok;
+    char *raw;
+    char *buffer;
+    char *workspace;
+} chunk_type;
+
+
 /*  Private functions  */
 STATIC_FUNCTION (flag transmit_array_local,
 		 (Channel channel, char *array, unsigned int length) );
 STATIC_FUNCTION (flag receive_array_local,
 		 (Channel channel, char *array, unsigned int length) );
-STATIC_FUNCTION (flag read_array_padding, (Channel channel) );
+STATIC_FUNCTION (flag read_array_padding,
+		 (Channel channel, flag *compressed) );
+STATIC_FUNCTION (flag can_swaptransfer_packet,
+		 (CONST packet_desc *pack_desc) );
+STATIC_FUNCTION (void swap_packets,
+		 (CONST packet_desc *pack_desc, char *packets,
+		  unsigned long num_packets) );
+STATIC_FUNCTION (flag write_swapped_packets,
+		 (Channel channel, CONST packet_desc *pack_desc,
+		  CONST char *source, unsigned long num_packets) );
+STATIC_FUNCTION (flag write_swapped_fragments,
+		 (Channel channel, CONST packet_desc *pack_desc,
+		  CONST list_entry *entry) );
+STATIC_FUNCTION (flag read_swapped_packets,
+		 (Channel channel, CONST packet_desc *pack_desc, char *dest,
+		  unsigned long num_packets) );
+STATIC_FUNCTION (flag write_compressed_array,
+		 (Channel channel, CONST packet_desc *pack_desc,
+		  CONST char *array, unsigned long num_packets) );
+STATIC_FUNCTION (flag read_compressed_array,
+		 (Channel channel, CONST packet_desc *pack_desc, char *array,
+		  unsigned long num_packets) );
+STATIC_FUNCTION (chunk_type *alloc_chunks,
+		 (unsigned int num_chunks, unsigned long chunk_bytes) );
+STATIC_FUNCTION (void free_chunks,
+		 (chunk_type *chunks, unsigned int num_chunks) );
+STATIC_FUNCTION (void compress_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (void decompress_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
 
 
 static char magic_string[] = "KarmaRHD Version";
+static unsigned int array_compression = DSRW_COMPRESSION_NONE;
 
 
 /*  Public functions follow  */
@@ -676,6 +734,10 @@ flag dsrw_write_packet (Channel channel, CONST packet_desc *pack_desc,
 	}
 	return (TRUE);
     }
+    if ( can_swaptransfer_packet (pack_desc) )
+    {
+	return ( write_swapped_packets (channel, pack_desc, packet, 1) );
+    }
     /*  Write packet data   */
     while (element_count < pack_desc->num_elements)
     {
@@ -893,6 +955,7 @@ flag dsrw_write_array (Channel channel, CONST array_desc *arr_desc,
 {
     flag block_transfer;
     flag local;
+    flag compress;
     unsigned int bytes_to_write;
     unsigned int array_size;
     unsigned int packet_size;
@@ -933,6 +996,15 @@ flag dsrw_write_array (Channel channel, CONST array_desc *arr_desc,
     block_transfer = ds_can_transfer_packet_as_block (pack_desc);
     local = ch_test_for_local_connection (channel);
     bytes_to_write = packet_size * array_size;
+    /*  Only arrays written to files are compressed, and only if the packets
+	contain atomic elements  */
+    compress = FALSE;
+    if ( pad && !local && (array_compression != DSRW_COMPRESSION_NONE) &&
+	 (bytes_to_write >= MIN_COMPRESS_BYTES) &&
+	 ( block_transfer || can_swaptransfer_packet (pack_desc) ) )
+    {
+	compress = TRUE;
+    }
     /*  Pad array if needed  */
     if (pad)
     {
@@ -946,7 +1018,9 @@ flag dsrw_write_array (Channel channel, CONST array_desc *arr_desc,
 	/*  Add 4 bytes for pad size  */
 	write_pos += 4;
 	bytes_to_pad = ARRAY_BOUNDARY - write_pos % ARRAY_BOUNDARY;
-	if ( !pio_write32 (channel, (unsigned long) bytes_to_pad) )
+	/*  The top bit of the pad size flags a compressed array  */
+	if ( !pio_write32 (channel, (unsigned long) bytes_to_pad |
+			   (compress ? COMPRESSED_ARRAY_FLAG : 0) ) )
 	{
 	    fprintf (stderr, "Error writing pad size\n");
 	    return (FALSE);
@@ -961,6 +1035,11 @@ flag dsrw_write_array (Channel channel, CONST array_desc *arr_desc,
 	    }
 	}
     }
+    if (compress)
+    {
+	return ( write_compressed_array (channel, pack_desc, array,
+					 array_size) );
+    }
     if (block_transfer && local)
     {
 	return ( transmit_array_local (channel, array, bytes_to_write) );
@@ -1046,6 +1125,11 @@ flag dsrw_write_list (Channel channel, CONST packet_desc *pack_desc,
 	    return (FALSE);
     }
     /*  Write out fragmented section of list  */
+    if ( can_swaptransfer_packet (pack_desc) )
+    {
+	return ( write_swapped_fragments (channel, pack_desc,
+					  list_head->first_frag_entry) );
+    }
     for (curr_entry = list_head->first_frag_entry; curr_entry != NULL;
 	 curr_entry = curr_entry->next)
     {
@@ -1118,6 +1202,13 @@ flag dsrw_write_packets (Channel channel, CONST packet_desc *descriptor,
 	}
 	return (TRUE);
     }
+    if ( can_swaptransfer_packet (descriptor) )
+    {
+	/*  All the elements are atomic and only need byte-swapping, so swap
+	    the columns of a block of packets at a time  */
+	return ( write_swapped_packets (channel, descriptor, source,
+					num_packets) );
+    }
     /*  Do recursive save  */
     for (count = 0; count < num_packets; ++count, source += packet_size)
     {
@@ -1731,6 +1822,10 @@ flag dsrw_read_packet (Channel channel, CONST packet_desc *descriptor,
 	}
 	return (TRUE);
     }
+    if ( can_swaptransfer_packet (descriptor) )
+    {
+	return ( read_swapped_packets (channel, descriptor, packet, 1) );
+    }
     while (elem_count < descriptor->num_elements)
     {
 	type = descriptor->element_types[elem_count];
@@ -2008,6 +2103,7 @@ flag dsrw_read_array (Channel channel, CONST array_desc *descriptor,
 {
     flag block_transfer;
     flag local;
+    flag compressed = FALSE;
     unsigned int bytes_to_read;
     unsigned int array_size;
     unsigned int packet_size;
@@ -2060,12 +2156,26 @@ flag dsrw_read_array (Channel channel, CONST array_desc *descriptor,
     bytes_to_read = packet_size * array_size;
     if (pad)
     {
-	if ( !read_array_padding (channel) )
+	if ( !read_array_padding (channel, &compressed) )
 	{
 	    fprintf (stderr, "Error reading array padding\n");
 	    return (FALSE);
 	}
     }
+    if (compressed)
+    {
+	/*  Compressed arrays cannot be memory mapped: allocate if needed  */
+	if ( (alloc_type == K_ARRAY_UNALLOCATED) || (array == NULL) )
+	{
+	    if ( !ds_alloc_array (descriptor, element, FALSE, TRUE) )
+	    {
+		m_error_notify (function_name, "array data");
+		return (FALSE);
+	    }
+	}
+	return ( read_compressed_array (channel, pack_desc,
+					*(char **) element, array_size) );
+    }
     if (block_transfer && local)
     {
 	/*  Read from local connection  */
@@ -2285,6 +2395,13 @@ flag dsrw_read_packets (Channel channel, CONST packet_desc *descriptor,
 	}
 	return (TRUE);
     }
+    if ( can_swaptransfer_packet (descriptor) )
+    {
+	/*  All the elements are atomic and only need byte-swapping, so read
+	    a block of packets at a time and swap the columns  */
+	return ( read_swapped_packets (channel, descriptor, dest,
+				       num_packets) );
+    }
     /*  Do recursive read   */
     for (count = 0; count < num_packets; ++count, dest += packet_size)
     {
@@ -2374,6 +2491,37 @@ flag dsrw_read_type (Channel channel, unsigned int *type)
     return (TRUE);
 }   /*  End Function dsrw_read_type  */
 
+/*EXPERIMENTAL_FUNCTION*/
+void dsrw_set_array_compression (unsigned int codec)
+/*  [SUMMARY] Set the compression used when writing arrays to files.
+    [PURPOSE] This routine will set the compression applied to arrays which
+    are written with padding (i.e. to Karma arrayfiles). Arrays of at least
+    64 kBytes whose packets contain only atomic elements are split into
+    chunks, which are compressed in parallel and written with their lengths,
+    so that readers can find any chunk without decompressing the others.
+    Other arrays are written uncompressed. Compressed arrays are always
+    decompressed when read, whatever this setting.
+    <codec> The compression codec. See [<DSRW_COMPRESSION_CODECS>] for a list
+    of legal values.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "dsrw_set_array_compression";
+
+    switch (codec)
+    {
+      case DSRW_COMPRESSION_NONE:
+      case DSRW_COMPRESSION_SHUFFLE_LZ:
+	break;
+      default:
+	fprintf (stderr, "Illegal compression codec: %u\n", codec);
+	a_prog_bug (function_name);
+	break;
+    }
+    array_compression = codec;
+}   /*  End Function dsrw_set_array_compression  */
+
 
 /*  Private functions follow  */
 
@@ -2551,9 +2699,11 @@ static flag receive_array_local (Channel channel, char *array,
     return (TRUE);
 }   /*  End Function receive_array_local  */
 
-static flag read_array_padding (Channel channel)
+static flag read_array_padding (Channel channel, flag *compressed)
 /*  This routine will read array padding data from a channel.
     The channel must be given by  channel  .
+    The routine will write TRUE to the storage pointed to by  compressed  if
+    the array which follows is compressed, else it will write FALSE.
     The routine returns TRUE on success, else it returns FALSE.
 */
 {
@@ -2565,6 +2715,8 @@ static flag read_array_padding (Channel channel)
 	fprintf (stderr, "Error reading pad size\n");
 	return (FALSE);
     }
+    *compressed = (pad_bytes & COMPRESSED_ARRAY_FLAG) ? TRUE : FALSE;
+    pad_bytes &= ~COMPRESSED_ARRAY_FLAG;
     if (ch_drain (channel, pad_bytes) < pad_bytes)
     {
 	fprintf (stderr, "Error reading byte\t%s\n", sys_errlist[errno]);
@@ -2572,3 +2724,472 @@ static flag read_array_padding (Channel channel)
     }
     return (TRUE);
 }   /*  End Function read_array_padding  */
+
+static flag can_swaptransfer_packet (CONST packet_desc *pack_desc)
+/*  [SUMMARY] Test if packets can be transferred in bulk with byte-swapping.
+    <pack_desc> The packet descriptor.
+    [RETURNS] TRUE if every element of the packet is atomic and only needs
+    byte-swapping between host and network format, and the packet fits in the
+    bulk transfer buffer, else FALSE.
+*/
+{
+    unsigned int elem_count;
+
+    if (ds_get_packet_size (pack_desc) > BULK_BUF_SIZE) return (FALSE);
+    for (elem_count = 0; elem_count < pack_desc->num_elements; ++elem_count)
+    {
+	if ( !ds_can_swaptransfer_element
+	     (pack_desc->element_types[elem_count]) ) return (FALSE);
+    }
+    return (TRUE);
+}   /*  End Function can_swaptransfer_packet  */
+
+static void swap_packets (CONST packet_desc *pack_desc, char *packets,
+			  unsigned long num_packets)
+/*  [SUMMARY] Swap the bytes of each element in many packets.
+    [PURPOSE] This routine will convert packets between host and network
+    format in place, one element (column) at a time.
+    <pack_desc> The packet descriptor. Every element must be atomic.
+    <packets> The packets.
+    <num_packets> The number of packets.
+    [RETURNS] Nothing.
+*/
+{
+#ifdef MACHINE_LITTLE_ENDIAN
+    unsigned int elem_count, type, size;
+    unsigned int packet_size = ds_get_packet_size (pack_desc);
+    extern char host_type_sizes[NUMTYPES];
+
+    for (elem_count = 0; elem_count < pack_desc->num_elements;
+	 packets += size, ++elem_count)
+    {
+	type = pack_desc->element_types[elem_count];
+	size = host_type_sizes[type];
+	if ( ds_element_is_complex (type) )
+	{
+	    if (size < 4) continue;
+	    m_copy_and_swap_blocks (packets, NULL, packet_size, 0, size / 2,
+				    num_packets);
+	    m_copy_and_swap_blocks (packets + size / 2, NULL, packet_size, 0,
+				    size / 2, num_packets);
+	}
+	else if (size > 1)
+	{
+	    m_copy_and_swap_blocks (packets, NULL, packet_size, 0, size,
+				    num_packets);
+	}
+    }
+#endif
+}   /*  End Function swap_packets  */
+
+static flag write_swapped_packets (Channel channel,
+				   CONST packet_desc *pack_desc,
+				   CONST char *source,
+				   unsigned long num_packets)
+/*  [SUMMARY] Write packets of atomic elements in bulk.
+    <channel> The channel object.
+    <pack_desc> The packet descriptor. Every element must be atomic.
+    <source> The packets.
+    <num_packets> The number of packets.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int packet_size = ds_get_packet_size (pack_desc);
+    unsigned long count, bytes_to_write, bytes_written;
+    char buffer[BULK_BUF_SIZE];
+    extern char *sys_errlist[];
+
+    for (; num_packets > 0; num_packets -= count, source += bytes_to_write)
+    {
+	count = BULK_BUF_SIZE / packet_size;
+	if (count > num_packets) count = num_packets;
+	bytes_to_write = count * packet_size;
+	m_copy (buffer, source, bytes_to_write);
+	swap_packets (pack_desc, buffer, count);
+	if ( ( bytes_written = ch_write (channel, buffer, bytes_to_write) )
+	     < bytes_to_write )
+	{
+	    fprintf (stderr, "Error writing packets to channel\t%s\n",
+		     sys_errlist[errno]);
+	    fprintf (stderr, "Wanted: %lu bytes, wrote: %lu bytes\n",
+		     bytes_to_write, bytes_written);
+	    return (FALSE);
+	}
+    }
+    return (TRUE);
+}   /*  End Function write_swapped_packets  */
+
+static flag write_swapped_fragments (Channel channel,
+				     CONST packet_desc *pack_desc,
+				     CONST list_entry *entry)
+/*  [SUMMARY] Write the fragmented section of a list in bulk.
+    [PURPOSE] This routine will gather the packets in the fragmented section of
+    a linked list into a buffer, swap the columns and write the buffer as one
+    block.
+    <channel> The channel object.
+    <pack_desc> The packet descriptor. Every element must be atomic.
+    <entry> The first fragmented list entry.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int packet_size = ds_get_packet_size (pack_desc);
+    unsigned long count, max_packets, bytes_to_write, bytes_written;
+    char buffer[BULK_BUF_SIZE];
+    extern char *sys_errlist[];
+
+    max_packets = BULK_BUF_SIZE / packet_size;
+    while (entry != NULL)
+    {
+	for (count = 0; (entry != NULL) && (count < max_packets);
+	     ++count, entry = entry->next)
+	{
+	    m_copy (buffer + count * packet_size, entry->data, packet_size);
+	}
+	swap_packets (pack_desc, buffer, count);
+	bytes_to_write = count * packet_size;
+	if ( ( bytes_written = ch_write (channel, buffer, bytes_to_write) )
+	     < bytes_to_write )
+	{
+	    fprintf (stderr, "Error writing packets to channel\t%s\n",
+		     sys_errlist[errno]);
+	    fprintf (stderr, "Wanted: %lu bytes, wrote: %lu bytes\n",
+		     bytes_to_write, bytes_written);
+	    return (FALSE);
+	}
+    }
+    return (TRUE);
+}   /*  End Function write_swapped_fragments  */
+
+static flag read_swapped_packets (Channel channel,
+				  CONST packet_desc *pack_desc, char *dest,
+				  unsigned long num_packets)
+/*  [SUMMARY] Read packets of atomic elements in bulk.
+    [PURPOSE] This routine will read packets in large sections, swapping each
+    section while it is still in the cache.
+    <channel> The channel object.
+    <pack_desc> The packet descriptor. Every element must be atomic.
+    <dest> The packets are written here.
+    <num_packets> The number of packets.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int packet_size = ds_get_packet_size (pack_desc);
+    unsigned long count, bytes_to_read, got_bytes;
+    extern char *sys_errlist[];
+
+    for (; num_packets > 0; num_packets -= count, dest += bytes_to_read)
+    {
+	count = BULK_READ_LENGTH / packet_size;
+	if (count > num_packets) count = num_packets;
+	bytes_to_read = count * packet_size;
+	if ( ( got_bytes = ch_read (channel, dest, bytes_to_read) )
+	     < bytes_to_read )
+	{
+	    fprintf (stderr, "Error reading packets\t%s\n",
+		     sys_errlist[errno]);
+	    fprintf (stderr, "Wanted: %lu bytes, got: %lu bytes\n",
+		     bytes_to_read, got_bytes);
+	    return (FALSE);
+	}
+	swap_packets (pack_desc, dest, count);
+    }
+    return (TRUE);
+}   /*  End Function read_swapped_packets  */
+
+static flag write_compressed_array (Channel channel,
+				    CONST packet_desc *pack_desc,
+				    CONST char *array,
+				    unsigned long num_packets)
+/*  [SUMMARY] Write an array of atomic packets as compressed chunks.
+    [PURPOSE] This routine will write the compressed array section, which is
+    the codec, the uncompressed chunk size and the shuffle stride, followed by
+    the length and data of each chunk. The top bit of a chunk length is set if
+    the chunk is stored uncompressed. Chunks contain data in network format.
+    <channel> The channel object.
+    <pack_desc> The packet descriptor. Every element must be atomic.
+    <array> The array data.
+    <num_packets> The number of packets in the array.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KThreadPool pool;
+    unsigned int packet_size, stride, num_slots, count, slot_count;
+    unsigned long chunk_bytes, total_bytes, offset, num_chunks, chunk_count;
+    chunk_type *chunks, *chunk;
+    extern char *sys_errlist[];
+    static char function_name[] = "write_compressed_array";
+
+    packet_size = ds_get_packet_size (pack_desc);
+    chunk_bytes = CHUNK_SIZE / packet_size;
+    if (chunk_bytes < 1) chunk_bytes = 1;
+    chunk_bytes *= packet_size;
+    stride = (packet_size > MAX_SHUFFLE_STRIDE) ? 1 : packet_size;
+    total_bytes = num_packets * packet_size;
+    num_chunks = (total_bytes + chunk_bytes - 1) / chunk_bytes;
+    if ( !pio_write32 (channel, (unsigned long) array_compression) ||
+	 !pio_write32 (channel, chunk_bytes) ||
+	 !pio_write32 (channel, (unsigned long) stride) ) return (FALSE);
+    pool = mt_get_shared_pool ();
+    num_slots = mt_num_threads (pool);
+    if (num_slots > num_chunks) num_slots = num_chunks;
+    if ( ( chunks = alloc_chunks (num_slots, chunk_bytes) ) == NULL )
+    {
+	m_error_notify (function_name, "chunk buffers");
+	return (FALSE);
+    }
+    /*  Compress a batch of chunks in parallel, then write them in order  */
+    for (chunk_count = 0; chunk_count < num_chunks; chunk_count += count)
+    {
+	count = num_chunks - chunk_count;
+	if (count > num_slots) count = num_slots;
+	for (slot_count = 0; slot_count < count; ++slot_count)
+	{
+	    chunk = chunks + slot_count;
+	    offset = (chunk_count + slot_count) * chunk_bytes;
+	    chunk->array = array + offset;
+	    chunk->length = (total_bytes - offset > chunk_bytes) ? chunk_bytes :
+		total_bytes - offset;
+	    if (count < 2)
+	    {
+		compress_job_func (NULL, (void *) pack_desc, chunk,
+				   (void *) (uaddr) stride, NULL, NULL);
+	    }
+	    else mt_launch_job (pool, compress_job_func, (void *) pack_desc,
+				chunk, (void *) (uaddr) stride, NULL);
+	}
+	if (count > 1) mt_wait_for_all_jobs (pool);
+	for (slot_count = 0; slot_count < count; ++slot_count)
+	{
+	    chunk = chunks + slot_count;
+	    if ( !pio_write32 (channel, chunk->stored_length |
+			       (chunk->stored_raw ? RAW_CHUNK_FLAG : 0) ) ||
+		 (ch_write (channel, chunk->stored_raw ? chunk->raw :
+			    chunk->buffer, chunk->stored_length)
+		  < chunk->stored_length) )
+	    {
+		fprintf (stderr, "Error writing compressed chunk\t%s\n",
+			 sys_errlist[errno]);
+		free_chunks (chunks, num_slots);
+		return (FALSE);
+	    }
+	}
+    }
+    free_chunks (chunks, num_slots);
+    return (TRUE);
+}   /*  End Function write_compressed_array  */
+
+static flag read_compressed_array (Channel channel,
+				   CONST packet_desc *pack_desc, char *array,
+				   unsigned long num_packets)
+/*  [SUMMARY] Read an array of atomic packets from compressed chunks.
+    [PURPOSE] This routine will read a batch of compressed chunks and then
+    decompress them in parallel, directly into the array.
+    <channel> The channel object.
+    <pack_desc> The packet descriptor.
+    <array> The array data are written here.
+    <num_packets> The number of packets in the array.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag ok = TRUE;
+    KThreadPool pool;
+    unsigned int packet_size, num_slots, count, slot_count;
+    unsigned long codec, chunk_bytes, stride, header;
+    unsigned long total_bytes, offset, num_chunks, chunk_count;
+    chunk_type *chunks, *chunk;
+    extern char *sys_errlist[];
+    static char function_name[] = "read_compressed_array";
+
+    packet_size = ds_get_packet_size (pack_desc);
+    if ( !pio_read32 (channel, &codec) ||
+	 !pio_read32 (channel, &chunk_bytes) ||
+	 !pio_read32 (channel, &stride) )
+    {
+	fprintf (stderr, "Error reading compressed array header\n");
+	return (FALSE);
+    }
+    if (codec != DSRW_COMPRESSION_SHUFFLE_LZ)
+    {
+	fprintf (stderr, "%s: unknown compression codec: %lu\n",
+		 function_name, codec);
+	return (FALSE);
+    }
+    if ( (chunk_bytes < 1) || (chunk_bytes % packet_size != 0) ||
+	 ( !ds_can_transfer_packet_as_block (pack_desc) &&
+	   !can_swaptransfer_packet (pack_desc) ) )
+    {
+	fprintf (stderr, "%s: bad chunk size: %lu for packet size: %u\n",
+		 function_name, chunk_bytes, packet_size);
+	return (FALSE);
+    }
+    total_bytes = num_packets * packet_size;
+    num_chunks = (total_bytes + chunk_bytes - 1) / chunk_bytes;
+    pool = mt_get_shared_pool ();
+    num_slots = mt_num_threads (pool);
+    if (num_slots > num_chunks) num_slots = num_chunks;
+    if ( ( chunks = alloc_chunks (num_slots, chunk_bytes) ) == NULL )
+    {
+	m_error_notify (function_name, "chunk buffers");
+	return (FALSE);
+    }
+    for (chunk_count = 0; ok && (chunk_count < num_chunks);
+	 chunk_count += count)
+    {
+	count = num_chunks - chunk_count;
+	if (count > num_slots) count = num_slots;
+	/*  Read the compressed data for a batch of chunks  */
+	for (slot_count = 0; slot_count < count; ++slot_count)
+	{
+	    chunk = chunks + slot_count;
+	    offset = (chunk_count + slot_count) * chunk_bytes;
+	    chunk->array = array + offset;
+	    chunk->length = (total_bytes - offset > chunk_bytes) ? chunk_bytes :
+		total_bytes - offset;
+	    if ( !pio_read32 (channel, &header) )
+	    {
+		fprintf (stderr, "Error reading chunk length\n");
+		free_chunks (chunks, num_slots);
+		return (FALSE);
+	    }
+	    chunk->stored_raw = (header & RAW_CHUNK_FLAG) ? TRUE : FALSE;
+	    chunk->stored_length = header & ~RAW_CHUNK_FLAG;
+	    if ( (chunk->stored_length > chunk_bytes) ||
+		 (chunk->stored_raw &&
+		  (chunk->stored_length != chunk->length) ) )
+	    {
+		fprintf (stderr, "%s: bad chunk length: %lu\n",
+			 function_name, chunk->stored_length);
+		free_chunks (chunks, num_slots);
+		return (FALSE);
+	    }
+	    if (ch_read (channel, chunk->buffer, chunk->stored_length) <
+		chunk->stored_length)
+	    {
+		fprintf (stderr, "Error reading compressed chunk\t%s\n",
+			 sys_errlist[errno]);
+		free_chunks (chunks, num_slots);
+		return (FALSE);
+	    }
+	}
+	/*  Decompress the batch  */
+	for (slot_count = 0; slot_count < count; ++slot_count)
+	{
+	    if (count < 2)
+	    {
+		decompress_job_func (NULL, (void *) pack_desc,
+				     chunks + slot_count,
+				     (void *) (uaddr) stride, NULL, NULL);
+	    }
+	    else mt_launch_job (pool, decompress_job_func, (void *) pack_desc,
+				chunks + slot_count, (void *) (uaddr) stride,
+				NULL);
+	}
+	if (count > 1) mt_wait_for_all_jobs (pool);
+	for (slot_count = 0; slot_count < count; ++slot_count)
+	{
+	    if (!chunks[slot_count].ok) ok = FALSE;
+	}
+    }
+    free_chunks (chunks, num_slots);
+    return (ok);
+}   /*  End Function read_compressed_array  */
+
+static chunk_type *alloc_chunks (unsigned int num_chunks,
+				 unsigned long chunk_bytes)
+/*  [SUMMARY] Allocate the buffers for a batch of compressed chunks.
+    <num_chunks> The number of chunks.
+    <chunk_bytes> The uncompressed size of a chunk.
+    [RETURNS] An array of chunk structures on success, else NULL.
+*/
+{
+    unsigned int count;
+    chunk_type *chunks;
+
+    if ( ( chunks = (chunk_type *) m_alloc (sizeof *chunks * num_chunks) )
+	 == NULL ) return (NULL);
+    m_clear ( (char *) chunks, sizeof *chunks * num_chunks );
+    for (count = 0; count < num_chunks; ++count)
+    {
+	if ( ( chunks[count].raw = m_alloc (chunk_bytes * 3) ) == NULL )
+	{
+	    free_chunks (chunks, count);
+	    return (NULL);
+	}
+	chunks[count].buffer = chunks[count].raw + chunk_bytes;
+	chunks[count].workspace = chunks[count].buffer + chunk_bytes;
+    }
+    return (chunks);
+}   /*  End Function alloc_chunks  */
+
+static void free_chunks (chunk_type *chunks, unsigned int num_chunks)
+/*  [SUMMARY] Free the buffers for a batch of compressed chunks.
+    <chunks> The array of chunk structures.
+    <num_chunks> The number of chunks.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+
+    for (count = 0; count < num_chunks; ++count) m_free (chunks[count].raw);
+    m_free ( (char *) chunks );
+}   /*  End Function free_chunks  */
+
+static void compress_job_func (void *pool_info,
+			       void *call_info1, void *call_info2,
+			       void *call_info3, void *call_info4,
+			       void *thread_info)
+/*  [SUMMARY] Convert a chunk to network format and compress it.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The packet descriptor.
+    <call_info2> The chunk.
+    <call_info3> The shuffle stride.
+    <call_info4> Unused.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    CONST packet_desc *pack_desc = (CONST packet_desc *) call_info1;
+    chunk_type *chunk = (chunk_type *) call_info2;
+
+    m_copy (chunk->raw, chunk->array, chunk->length);
+    swap_packets (pack_desc, chunk->raw,
+		  chunk->length / ds_get_packet_size (pack_desc) );
+    chunk->stored_length =
+	dsrw_compress_block (chunk->raw, chunk->length,
+			     (unsigned int) (uaddr) call_info3, chunk->buffer,
+			     chunk->length - 1, chunk->workspace);
+    chunk->stored_raw = (chunk->stored_length < 1) ? TRUE : FALSE;
+    if (chunk->stored_raw) chunk->stored_length = chunk->length;
+}   /*  End Function compress_job_func  */
+
+static void decompress_job_func (void *pool_info,
+				 void *call_info1, void *call_info2,
+				 void *call_info3, void *call_info4,
+				 void *thread_info)
+/*  [SUMMARY] Decompress a chunk into an array and convert to host format.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The packet descriptor.
+    <call_info2> The chunk.
+    <call_info3> The shuffle stride.
+    <call_info4> Unused.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    CONST packet_desc *pack_desc = (CONST packet_desc *) call_info1;
+    chunk_type *chunk = (chunk_type *) call_info2;
+    char *array = (char *) chunk->array;
+
+    if (chunk->stored_raw) m_copy (array, chunk->buffer, chunk->length);
+    else if ( !dsrw_decompress_block (chunk->buffer, chunk->stored_length,
+				      array, chunk->length,
+				      (unsigned int) (uaddr) call_info3,
+				      chunk->workspace) )
+    {
+	chunk->ok = FALSE;
+	return;
+    }
+    swap_packets (pack_desc, array,
+		  chunk->length / ds_get_packet_size (pack_desc) );
+    chunk->ok = TRUE;
+}   /*  End Function decompress_job_func  */
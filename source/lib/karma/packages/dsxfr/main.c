@@ -151,6 +151,8 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <karma.h>
 #include <karma_dsxfr.h>
 #include <karma_conn.h>
@@ -164,6 +166,8 @@
 
 #define MAGIC_NUMBER (unsigned int) 1541229803
 #define PROTOCOL_VERSION (unsigned int) 0
+#define CACHE_HASH_SIZE 64
+#define DEFAULT_CACHE_LIMIT (unsigned long) (128 * 1048576)
 
 /*  Private structures  */
 struct cache_type
@@ -174,8 +178,14 @@ struct cache_type
     Channel channel;
     flag mapped;
     flag writeable;
-    struct cache_type *prev;
+    KCallbackFunc destroy_func;
+    dev_t dev;
+    ino_t inode;
+    off_t size;
+    time_t mtime;
+    struct cache_type *prev;       /*  Least recently used list  */
     struct cache_type *next;
+    struct cache_type *hash_next;
 };
 
 struct conn_type
@@ -189,6 +199,14 @@ struct conn_type
 static void (*read_callback) () = NULL;
 static void (*close_callback) () = NULL;
 static struct cache_type *cache_list = NULL;
+static struct cache_type *cache_tail = NULL;
+static struct cache_type *cache_table[CACHE_HASH_SIZE];
+static unsigned long cache_limit = DEFAULT_CACHE_LIMIT;
+static unsigned long cache_bytes = 0;
+static unsigned long cache_hits = 0;
+static unsigned long cache_misses = 0;
+static unsigned long cache_invalidations = 0;
+static unsigned long cache_evictions = 0;
 static char *default_extension = ".kf";
 
 
@@ -203,6 +221,11 @@ STATIC_FUNCTION (void remove_from_cache_list,
 		  void *call_data, void *client2_data) );
 STATIC_FUNCTION (multi_array *get_cache_entry,
 		 (char *filename, flag *mapped, flag *writeable) );
+STATIC_FUNCTION (unsigned int hash_filename, (CONST char *filename) );
+STATIC_FUNCTION (void unlink_cache_entry, (struct cache_type *entry) );
+STATIC_FUNCTION (void drop_cache_entry, (struct cache_type *entry) );
+STATIC_FUNCTION (void drop_cache_entries, (CONST char *filename) );
+STATIC_FUNCTION (void trim_cache, () );
 STATIC_FUNCTION (void add_mmap_destroy_func,
 		 (multi_array *multi_desc, Channel channel) );
 STATIC_FUNCTION (void close_mmap_channel,
@@ -229,11 +252,19 @@ static flag add_to_cache_list (char *filename, multi_array *multi_desc,
     If the stucture was memory mapped, the value of  mapped  must be TRUE.
     If the structure is memory mapped and writeable, the value of  writeable
     must be TRUE.
+    The identity, size and modification time of the file are recorded so that
+    the entry can later be invalidated if the file changes. The size of the
+    file is charged against the cache limit.
     The routine returns TRUE on success, else it returns FALSE.
 */
 {
+    unsigned int hash;
     struct cache_type *new_entry;
+    struct stat statbuf;
     extern struct cache_type *cache_list;
+    extern struct cache_type *cache_tail;
+    extern struct cache_type *cache_table[CACHE_HASH_SIZE];
+    extern unsigned long cache_bytes;
     static char function_name[] = "add_to_cache_list";
 
     if ( (filename == NULL) || (multi_desc == NULL) )
@@ -241,6 +272,7 @@ static flag add_to_cache_list (char *filename, multi_array *multi_desc,
 	fprintf (stderr, "NULL pointer(s) passed\n");
 	a_prog_bug (function_name);
     }
+    if (stat (filename, &statbuf) != 0) return (FALSE);
     if ( ( new_entry = (struct cache_type *) m_alloc (sizeof *new_entry) )
 	== NULL )
     {
@@ -248,8 +280,6 @@ static flag add_to_cache_list (char *filename, multi_array *multi_desc,
 	return (FALSE);
     }
     new_entry->magic_number = MAGIC_NUMBER;
-    new_entry->prev = NULL;
-    new_entry->next = NULL;
     if ( ( new_entry->filename = st_dup (filename) ) == NULL )
     {
 	m_error_notify (function_name, "filename");
@@ -260,31 +290,38 @@ static flag add_to_cache_list (char *filename, multi_array *multi_desc,
     new_entry->channel = channel;
     new_entry->mapped = mapped;
     new_entry->writeable = writeable;
-    c_register_callback (&multi_desc->destroy_callbacks,
-			 ( flag (*) () ) remove_from_cache_list, new_entry,
-			 NULL, FALSE, NULL, FALSE, FALSE);
-    /*  Add entry to list  */
-    if (cache_list == NULL)
-    {
-	cache_list = new_entry;
-	return (TRUE);
-    }
-    /*  Insert entry at beginning of list  */
+    new_entry->dev = statbuf.st_dev;
+    new_entry->inode = statbuf.st_ino;
+    new_entry->size = statbuf.st_size;
+    new_entry->mtime = statbuf.st_mtime;
+    new_entry->destroy_func =
+	c_register_callback (&multi_desc->destroy_callbacks,
+			     ( flag (*) () ) remove_from_cache_list, new_entry,
+			     NULL, FALSE, NULL, FALSE, FALSE);
+    /*  Insert entry at the head of its hash chain, so that a newer entry for
+	the same file is found first  */
+    hash = hash_filename (filename);
+    new_entry->hash_next = cache_table[hash];
+    cache_table[hash] = new_entry;
+    /*  Insert entry at beginning of list (most recently used)  */
+    new_entry->prev = NULL;
     new_entry->next = cache_list;
-    (*cache_list).prev = new_entry;
+    if (cache_list == NULL) cache_tail = new_entry;
+    else cache_list->prev = new_entry;
     cache_list = new_entry;
+    cache_bytes += new_entry->size;
     return (TRUE);
 }   /*  End Function add_to_cache_list  */
 
 static void remove_from_cache_list (void *object, void *client1_data,
 				    void *call_data, void *client2_data)
-/*  This routine will remove a cache list entry.
+/*  This routine will remove a cache list entry when its data structure is
+    destroyed.
     The entry must be pointed to by  entry  .
     The routine returns nothing.
 */
 {
     struct cache_type *entry = object;
-    extern struct cache_type *cache_list;
     extern char *sys_errlist[];
     static char function_name[] = "remove_from_cache_list";
 
@@ -293,14 +330,6 @@ static void remove_from_cache_list (void *object, void *client1_data,
 	fprintf (stderr, "Cache list entry is not valid\n");
 	a_prog_bug (function_name);
     }
-    entry->magic_number = 0;
-    if (cache_list == entry)
-    {
-	cache_list = NULL;
-	return;
-    }
-    if (entry->prev != NULL) entry->prev->next = entry->next;
-    if (entry->next != NULL) entry->next->prev = entry->prev;
     if (entry->channel != NULL)
     {
 	if ( !ch_close (entry->channel) )
@@ -309,7 +338,7 @@ static void remove_from_cache_list (void *object, void *client1_data,
 		     sys_errlist[errno]);
 	}
     }
-    m_free ( (char *) entry );
+    unlink_cache_entry (entry);
 }   /*  End Function remove_from_cache_list  */
 
 static multi_array *get_cache_entry (char *filename, flag *mapped,
@@ -323,25 +352,172 @@ static multi_array *get_cache_entry (char *filename, flag *mapped,
     If the data structure is memory mapped and writeable, the value TRUE will
     be written to the storage pointed to by  writeable  ,else FALSE will be
     written here.
+    If the file has been replaced or modified since it was cached, the entry
+    is dropped from the cache.
     The routine returns a pointed to the data structure on sucess,
     else it returns NULL (indicating that the file was not cached).
 */
 {
     struct cache_type *curr_entry;
+    struct stat statbuf;
+    extern struct cache_type *cache_list;
+    extern struct cache_type *cache_tail;
+    extern struct cache_type *cache_table[CACHE_HASH_SIZE];
+    extern unsigned long cache_hits;
+    extern unsigned long cache_misses;
+    extern unsigned long cache_invalidations;
+
+    for (curr_entry = cache_table[hash_filename (filename)];
+	 curr_entry != NULL; curr_entry = curr_entry->hash_next)
+    {
+	if (strcmp (filename, curr_entry->filename) == 0) break;
+    }
+    if (curr_entry == NULL)
+    {
+	++cache_misses;
+	return (NULL);
+    }
+    /*  If the file cannot be examined any more, the cached data are the best
+	available  */
+    if ( (stat (filename, &statbuf) == 0) &&
+	 ( (statbuf.st_dev != curr_entry->dev) ||
+	   (statbuf.st_ino != curr_entry->inode) ||
+	   (statbuf.st_size != curr_entry->size) ||
+	   (statbuf.st_mtime != curr_entry->mtime) ) )
+    {
+	/*  File has changed  */
+	++cache_invalidations;
+	++cache_misses;
+	drop_cache_entries (filename);
+	return (NULL);
+    }
+    ++cache_hits;
+    /*  Move entry to the head of the list  */
+    if (curr_entry != cache_list)
+    {
+	curr_entry->prev->next = curr_entry->next;
+	if (curr_entry->next == NULL) cache_tail = curr_entry->prev;
+	else curr_entry->next->prev = curr_entry->prev;
+	curr_entry->prev = NULL;
+	curr_entry->next = cache_list;
+	cache_list->prev = curr_entry;
+	cache_list = curr_entry;
+    }
+    *mapped = curr_entry->mapped;
+    *writeable = curr_entry->writeable;
+    return (curr_entry->multi_desc);
+}   /*  End Function get_cache_entry  */
+
+static unsigned int hash_filename (CONST char *filename)
+/*  This routine will compute the hash table index for a filename.
+    The filename must be pointed to by  filename  .
+    The routine returns the index.
+*/
+{
+    unsigned int hash = 0;
+
+    for (; *filename != '\0'; ++filename)
+    {
+	hash = hash * 31 + (unsigned char) *filename;
+    }
+    return (hash % CACHE_HASH_SIZE);
+}   /*  End Function hash_filename  */
+
+static void unlink_cache_entry (struct cache_type *entry)
+/*  This routine will remove an entry from the cache list and hash table and
+    deallocate it. The data structure and channel are not touched.
+    The entry must be pointed to by  entry  .
+    The routine returns nothing.
+*/
+{
+    struct cache_type **link;
     extern struct cache_type *cache_list;
+    extern struct cache_type *cache_tail;
+    extern struct cache_type *cache_table[CACHE_HASH_SIZE];
+    extern unsigned long cache_bytes;
+
+    entry->magic_number = 0;
+    for (link = cache_table + hash_filename (entry->filename); *link != entry;
+	 link = &(*link)->hash_next);
+    *link = entry->hash_next;
+    if (entry->prev == NULL) cache_list = entry->next;
+    else entry->prev->next = entry->next;
+    if (entry->next == NULL) cache_tail = entry->prev;
+    else entry->next->prev = entry->prev;
+    cache_bytes -= entry->size;
+    m_free (entry->filename);
+    m_free ( (char *) entry );
+}   /*  End Function unlink_cache_entry  */
+
+static void drop_cache_entry (struct cache_type *entry)
+/*  This routine will remove an entry from the cache. If the data structure is
+    not attached to anything other than the cache it is deallocated, otherwise
+    the reference held by the cache is released and the data structure will be
+    deallocated when it is no longer used.
+    The entry must be pointed to by  entry  .
+    The routine returns nothing.
+*/
+{
+    multi_array *multi_desc = entry->multi_desc;
 
-    for (curr_entry = cache_list; curr_entry != NULL;
-	 curr_entry = (*curr_entry).next)
+    if (multi_desc->attachments < 1)
     {
-	if (strcmp (filename, (*curr_entry).filename) == 0)
+	/*  The destroy callback will remove the entry  */
+	ds_dealloc_multi (multi_desc);
+	return;
+    }
+    c_unregister_callback (entry->destroy_func);
+    if (entry->channel != NULL)
+    {
+	add_mmap_destroy_func (multi_desc, entry->channel);
+    }
+    --multi_desc->attachments;
+    unlink_cache_entry (entry);
+}   /*  End Function drop_cache_entry  */
+
+static void drop_cache_entries (CONST char *filename)
+/*  This routine will remove all cache entries for a file.
+    The filename must be pointed to by  filename  .
+    The routine returns nothing.
+*/
+{
+    struct cache_type *curr_entry, *next_entry;
+    extern struct cache_type *cache_table[CACHE_HASH_SIZE];
+
+    for (curr_entry = cache_table[hash_filename (filename)];
+	 curr_entry != NULL; curr_entry = next_entry)
+    {
+	next_entry = curr_entry->hash_next;
+	if (strcmp (filename, curr_entry->filename) == 0)
 	{
-	    *mapped = (*curr_entry).mapped;
-	    *writeable = (*curr_entry).writeable;
-	    return ( (*curr_entry).multi_desc );
+	    drop_cache_entry (curr_entry);
 	}
     }
-    return (NULL);
-}   /*  End Function get_cache_entry  */
+}   /*  End Function drop_cache_entries  */
+
+static void trim_cache ()
+/*  This routine will deallocate the least recently used data structures which
+    are held only by the cache until the cache is within its limit.
+    The routine returns nothing.
+*/
+{
+    struct cache_type *curr_entry, *prev_entry;
+    extern struct cache_type *cache_tail;
+    extern unsigned long cache_limit;
+    extern unsigned long cache_bytes;
+    extern unsigned long cache_evictions;
+
+    if (cache_limit < 1) return;
+    for (curr_entry = cache_tail;
+	 (curr_entry != NULL) && (cache_bytes > cache_limit);
+	 curr_entry = prev_entry)
+    {
+	prev_entry = curr_entry->prev;
+	if (curr_entry->multi_desc->attachments > 0) continue;
+	++cache_evictions;
+	ds_dealloc_multi (curr_entry->multi_desc);
+    }
+}   /*  End Function trim_cache  */
 
 static flag serv_open_func (Connection connection, void **info)
 /*  [PURPOSE] This function will register the opening of a connection.
@@ -1059,6 +1235,8 @@ flag dsxfr_put_multi (CONST char *object, multi_array *multi_desc)
 	m_free (filename);
 	return (FALSE);
     }
+    /*  Any cached copies of the old file are now stale  */
+    drop_cache_entries (filename);
     m_free (filename);
     if ( !dsrw_write_multi (channel, multi_desc) )
     {
@@ -1088,7 +1266,10 @@ multi_array *dsxfr_get_multi (CONST char *object, flag cache,
     <cache> If TRUE and the data is read from a disc, the data structure and
     filename relationship is cached. This means that a subsequent attempt to
     read the data will not require the disc to be accessed. This relationship
-    is lost if the data structure is destroyed. Also, in both this case and the
+    is lost if the data structure is destroyed, if the file is modified or
+    replaced, or if the data structure is not otherwise in use and is evicted
+    to keep the cache within its limit (see [<dsxfr_set_cache_limit>]). Also,
+    in both this case and the
     case where the data structure is "read" from a connection, the attachment
     count for the data structure is incremented *every time* this routine is
     called. Read the documentation for the <ds_dealloc_multi> routine for
@@ -1251,6 +1432,7 @@ multi_array *dsxfr_get_multi (CONST char *object, flag cache,
 	}
 	/*  Increment the attachment count  */
 	++multi_desc->attachments;
+	trim_cache ();
     }
     else
     {
@@ -1313,3 +1495,53 @@ void dsxfr_register_close_func ( void (*close_func) () )
     }
     close_callback = close_func;
 }   /*  End Function dsxfr_register_close_func  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void dsxfr_set_cache_limit (unsigned long max_bytes)
+/*  [SUMMARY] Set the size limit for the cache of data structures.
+    [PURPOSE] This routine will set the limit on the total size of the files
+    whose data structures are held in the cache by [<dsxfr_get_multi>]. When
+    the limit is exceeded, the least recently used data structures which are
+    not in use elsewhere are deallocated. Data structures which are in use are
+    never deallocated. The default limit is 128 MBytes.
+    <max_bytes> The limit in bytes. If this is 0 the cache size is not limited.
+    [RETURNS] Nothing.
+*/
+{
+    extern unsigned long cache_limit;
+
+    cache_limit = max_bytes;
+    trim_cache ();
+}   /*  End Function dsxfr_set_cache_limit  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void dsxfr_get_cache_statistics (unsigned long *hits, unsigned long *misses,
+				 unsigned long *invalidations,
+				 unsigned long *evictions,
+				 unsigned long *num_bytes)
+/*  [SUMMARY] Get statistics for the cache of data structures.
+    <hits> The number of reads of disc files satisfied from the cache is
+    written here. If this is NULL nothing is written here.
+    <misses> The number of reads of disc files which were not satisfied from
+    the cache is written here. If this is NULL nothing is written here.
+    <invalidations> The number of cache entries dropped because the file had
+    changed is written here. If this is NULL nothing is written here.
+    <evictions> The number of cache entries dropped to keep within the size
+    limit is written here. If this is NULL nothing is written here.
+    <num_bytes> The total size of the files currently cached is written here.
+    If this is NULL nothing is written here.
+    [RETURNS] Nothing.
+*/
+{
+    extern unsigned long cache_bytes;
+    extern unsigned long cache_hits;
+    extern unsigned long cache_misses;
+    extern unsigned long cache_invalidations;
+    extern unsigned long cache_evictions;
+
+    if (hits != NULL) *hits = cache_hits;
+    if (misses != NULL) *misses = cache_misses;
+    if (invalidations != NULL) *invalidations = cache_invalidations;
+    if (evictions != NULL) *evictions = cache_evictions;
+    if (num_bytes != NULL) *num_bytes = cache_bytes;
+}   /*  End Function dsxfr_get_cache_statistics  */
@@ -117,6 +117,7 @@
 #define CARD_WIDTH 80
 #define CARD_LENGTH 36
 #define EQUALS_POSITION 8
+#define BUF_LENGTH 4096
 
 
 struct keyword_type
@@ -490,23 +491,31 @@ flag foreign_fits_read_data (Channel channel, multi_array *multi_desc,
     attribute-value pairs. This list must be terminated with
     FA_FITS_READ_DATA_END. See [<FOREIGN_ATT_FITS_READ_DATA>] for a list of
     defined attributes.
+    [NOTE] If integer data are converted to floating point and the header
+    contains a "ZDITHER0" keyword, the dither offset added when the data were
+    quantised is removed (see [<foreign_fits_dither_offset>]).
     [RETURNS] TRUE on success, else FALSE.
 */
 {
     va_list argp;
     KforeignFITSinfo finfo;
+    flag raw = FALSE;
+    flag dither;
     uaddr toobig_count = 0;
-    long long_data;
-    unsigned char uchar_data;
+    uaddr value_count, first_index = 0;
     unsigned int att_key;
-    unsigned int value_count;
     unsigned int elem_type, elem_size;
-    unsigned int type;
+    unsigned int type, bytes_per_value, block_length, count;
+    unsigned long seed;
     float f_toobig = TOOBIG;
+    double d_data;
     double value[2];
     char *packet;
     unsigned long *blank_count = NULL;
-    float f_data;
+    float *f_data;
+    unsigned char *ptr;
+    long l_values[BUF_LENGTH];
+    unsigned char buffer[BUF_LENGTH * 4];
     packet_desc *pack_desc;
     array_desc *arr_desc;
     extern char *sys_errlist[];
@@ -527,6 +536,9 @@ flag foreign_fits_read_data (Channel channel, multi_array *multi_desc,
 	  case FA_FITS_READ_DATA_NUM_BLANKS:
 	    blank_count = va_arg (argp, unsigned long *);
 	    break;
+	  case FA_FITS_READ_DATA_FIRST_INDEX:
+	    first_index = va_arg (argp, uaddr);
+	    break;
 	  default:
 	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -570,6 +582,18 @@ flag foreign_fits_read_data (Channel channel, multi_array *multi_desc,
 	finfo.have_blank = TRUE;
     }
     else finfo.have_blank = FALSE;
+    /*  Quantised data may have been dithered  */
+    if ( ds_get_unique_named_value (pack_desc, packet, "ZDITHER0", &type,
+				    value) )
+    {
+	seed = value[0];
+	dither = TRUE;
+    }
+    else
+    {
+	seed = 0;
+	dither = FALSE;
+    }
     if ( ds_get_unique_named_value (pack_desc, packet, "BITPIX", &type,value) )
     {
 	finfo.bitpix = value[0];
@@ -602,139 +626,115 @@ flag foreign_fits_read_data (Channel channel, multi_array *multi_desc,
 	if (blank_count != NULL) *blank_count = toobig_count;
 	return (TRUE);
     }
+    switch (finfo.bitpix)
+    {
+      case 8:
+	raw = (elem_type == K_UBYTE) ? TRUE : FALSE;
+	break;
+      case 16:
+	raw = (elem_type == K_SHORT) ? TRUE : FALSE;
+	break;
+      case 32:
+	raw = (elem_type == K_INT) ? TRUE : FALSE;
+	break;
+      default:
+	fprintf (stderr, "Illegal value for BITPIX: %d\n", finfo.bitpix);
+	a_prog_bug (function_name);
+	break;
+    }
+    bytes_per_value = finfo.bitpix / 8;
+    /*  Read blocks of integer values and convert them  */
     for (value_count = 0; value_count < num_values;
-	 ++value_count, data += elem_size)
+	 value_count += block_length, data += elem_size * block_length)
     {
+	block_length = num_values - value_count;
+	if (block_length > BUF_LENGTH) block_length = BUF_LENGTH;
+	if (ch_read (channel, (char *) buffer, block_length * bytes_per_value)
+	    < block_length * bytes_per_value)
+	{
+	    fprintf (stderr, "Error reading from file\t%s\n",
+		     sys_errlist[errno]);
+	    fprintf (stderr, "Read in: %lu points\n",
+		     (unsigned long) value_count);
+	    return (FALSE);
+	}
+	/*  Decode big-endian values  */
 	switch (finfo.bitpix)
 	{
-#ifdef OBSOLETE
-	  case -32:
-	    if ( !pio_read_float_nantrap (channel, &f_data, &was_nan) )
-	    {
-		fprintf (stderr, "Error reading FITS file\n");
-		return (FALSE);
-	    }
-	    if (was_nan)
-	    {
-		f_data = f_toobig;
-		++toobig_count;
-	    }
-	    else
+	  case 8:
+	    for (count = 0; count < block_length; ++count)
 	    {
-		f_data = finfo.bzero + f_data * finfo.bscale;
+		l_values[count] = buffer[count];
 	    }
-	    *(float *) data = f_data;
 	    break;
-	  case -64:
-	    if ( !pio_read_double_nantrap (channel, &d_data, &was_nan) )
-	    {
-		fprintf (stderr, "Error reading FITS file\n");
-		return (FALSE);
-	    }
-	    if (was_nan)
-	    {
-		d_data = d_toobig;
-		++toobig_count;
-	    }
-	    else
+	  case 16:
+	    for (count = 0, ptr = buffer; count < block_length;
+		 ++count, ptr += 2)
 	    {
-		d_data = finfo.bzero + d_data * finfo.bscale;
+		l_values[count] = (long) (signed char) ptr[0] * 256 | ptr[1];
 	    }
-	    *(double *) data = d_data;
 	    break;
-#endif
-	  case 8:
-	    if (ch_read (channel, (char *) &uchar_data, 1) < 1)
-	    {
-		fprintf (stderr, "Error reading from file\t%s\n",
-			 sys_errlist[errno]);
-		fprintf (stderr, "Read in: %u points\n", value_count);
-		return (FALSE);
-	    }
-	    if (elem_type == K_UBYTE) *(unsigned char *) data = uchar_data;
-	    else
+	  case 32:
+	    for (count = 0, ptr = buffer; count < block_length;
+		 ++count, ptr += 4)
 	    {
-		/*  Convert to float  */
-		if ( finfo.have_blank && (uchar_data == finfo.blank) )
-		{
-		    f_data = f_toobig;
-		    ++toobig_count;
-		}
-		else
-		{
-		    f_data = (float) uchar_data * finfo.bscale + finfo.bzero;
-		}
-		*(float *) data = f_data;
+		l_values[count] = (long) (signed char) ptr[0] * 16777216 |
+		    (long) ptr[1] << 16 | (long) ptr[2] << 8 | ptr[3];
 	    }
 	    break;
-	  case 16:
-	    if ( !pio_read16s (channel, &long_data) )
-	    {
-		fprintf (stderr, "Error reading from file\t%s\n",
-			 sys_errlist[errno]);
-		fprintf (stderr, "Read in: %u points\n", value_count);
-		return (FALSE);
-	    }
-	    if (elem_type == K_SHORT)
+	}
+	if (raw)
+	{
+	    switch (elem_type)
 	    {
-		if ( finfo.have_blank && (long_data == finfo.blank) )
+	      case K_UBYTE:
+		for (count = 0; count < block_length; ++count)
 		{
-		    long_data = -32768;
-		    ++toobig_count;
+		    ( (unsigned char *) data )[count] = l_values[count];
 		}
-		*(short *) data = long_data;
-	    }
-	    else
-	    {
-		/*  Convert to float  */
-		if ( finfo.have_blank && (long_data == finfo.blank) )
+		break;
+	      case K_SHORT:
+		for (count = 0; count < block_length; ++count)
 		{
-		    f_data = f_toobig;
-		    ++toobig_count;
+		    if ( finfo.have_blank && (l_values[count] == finfo.blank) )
+		    {
+			l_values[count] = -32768;
+			++toobig_count;
+		    }
+		    ( (short *) data )[count] = l_values[count];
 		}
-		else
+		break;
+	      case K_INT:
+		for (count = 0; count < block_length; ++count)
 		{
-		    f_data = (float) long_data * finfo.bscale + finfo.bzero;
+		    if ( finfo.have_blank && (l_values[count] == finfo.blank) )
+		    {
+			l_values[count] = 0x80000000;
+			++toobig_count;
+		    }
+		    ( (int *) data )[count] = l_values[count];
 		}
-		*(float *) data = f_data;
-	    }
-	    break;
-	  case 32:
-	    if ( !pio_read32s (channel, &long_data) )
-	    {
-		fprintf (stderr, "Error reading from file\t%s\n",
-			 sys_errlist[errno]);
-		fprintf (stderr, "Read in: %u points\n", value_count);
-		return (FALSE);
+		break;
 	    }
-	    if (elem_type == K_INT)
+	    continue;
+	}
+	/*  Convert to float, removing any dither  */
+	f_data = (float *) data;
+	for (count = 0; count < block_length; ++count)
+	{
+	    if ( finfo.have_blank && (l_values[count] == finfo.blank) )
 	    {
-		if ( finfo.have_blank && (long_data == finfo.blank) )
-		{
-		    long_data = 0x80000000;
-		    ++toobig_count;
-		}
-		*(int *) data = long_data;
+		f_data[count] = f_toobig;
+		++toobig_count;
+		continue;
 	    }
-	    else
+	    d_data = l_values[count];
+	    if (dither)
 	    {
-		/*  Convert to float  */
-		if ( finfo.have_blank && (long_data == finfo.blank) )
-		{
-		    f_data = f_toobig;
-		    ++toobig_count;
-		}
-		else
-		{
-		    f_data = (float) long_data * finfo.bscale + finfo.bzero;
-		}
-		*(float *) data = f_data;
+		d_data -= foreign_fits_dither_offset (seed, first_index +
+						      value_count + count);
 	    }
-	    break;
-	  default:
-	    fprintf (stderr, "Illegal value for BITPIX: %u\n", finfo.bitpix);
-	    a_prog_bug (function_name);
-	    break;
+	    f_data[count] = d_data * finfo.bscale + finfo.bzero;
 	}
     }
     if (blank_count != NULL) *blank_count = toobig_count;
@@ -74,6 +74,10 @@
 #define EQUALS_POSITION 8
 #define CARD_SIZE (CARD_WIDTH * CARD_LENGTH)
 #define BUF_LENGTH 4096
+#define NOISE_SAMPLES 8192
+#define QUANTISE_LEVELS 65000.0
+#define QUANTISE_BLANK -32768
+#define DITHER_SEED 1
 
 
 /*  Declarations of private functions follow  */
@@ -87,6 +91,10 @@ STATIC_FUNCTION (flag write_fits_header,
 		  CONST char *header_packet, CONST history *first_hist) );
 STATIC_FUNCTION (flag write_fits_header_line,
 		 (Channel channel, CONST char *line) );
+STATIC_FUNCTION (flag set_quantisation,
+		 (packet_desc *header_pack_desc, char **header_packet,
+		  multi_array *multi_desc, double levels_per_sigma) );
+STATIC_FUNCTION (int compare_doubles, (CONST void *a, CONST void *b) );
 
 
 /*  Public functions follow  */
@@ -174,20 +182,30 @@ flag foreign_fits_write_data (Channel channel, multi_array *multi_desc,
     attribute-value pairs. This list must be terminated with
     FA_FITS_WRITE_DATA_END. See [<FOREIGN_ATT_FITS_WRITE_DATA>] for a list of
     defined attributes.
+    [NOTE] Floating point data written to an integer FITS file are quantised
+    using the "BSCALE" and "BZERO" keywords in the header. Blank values are
+    written as the "BLANK" value. If the header contains a "ZDITHER0" keyword,
+    a dither offset is added to each value before it is rounded (see
+    [<foreign_fits_dither_offset>]).
     [RETURNS] TRUE on success, else FALSE.
 */
 {
     va_list argp;
+    flag quantise, dither;
     int bitpix;
     unsigned int att_key, remainder;
     unsigned int elem_type, elem_size, block_length, count;
-    unsigned long read_pos, write_pos;
-    double bscale, bzero, d_val;
+    long blank;
+    unsigned long read_pos, write_pos, seed;
+    uaddr index = 0;
+    double bscale, bzero, d_val, min, max;
     packet_desc *top_pack_desc;
     array_desc *arr_desc;
     char *top_packet;
-    unsigned char ub_values[BUF_LENGTH];
+    unsigned char *ptr;
     double d_value[2];
+    long l_values[BUF_LENGTH];
+    unsigned char buffer[BUF_LENGTH * 4];
     double d_values[BUF_LENGTH * 2];
     extern char host_type_sizes[NUMTYPES];
     static char function_name[] = "foreign_fits_write_data";
@@ -205,6 +223,9 @@ flag foreign_fits_write_data (Channel channel, multi_array *multi_desc,
     {
 	switch (att_key)
 	{
+	  case FA_FITS_WRITE_DATA_FIRST_INDEX:
+	    index = va_arg (argp, uaddr);
+	    break;
 	  default:
 	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -262,8 +283,47 @@ flag foreign_fits_write_data (Channel channel, multi_array *multi_desc,
 	bzero = d_value[0];
     }
     else bzero = 0.0;
+    switch (bitpix)
+    {
+      case 8:
+	min = 0.0;
+	max = 255.0;
+	break;
+      case 16:
+	min = -32768.0;
+	max = 32767.0;
+	break;
+      case 32:
+	min = -2147483648.0;
+	max = 2147483647.0;
+	break;
+      default:
+	min = 0.0;
+	max = 0.0;
+	break;
+    }
+    if ( ds_get_unique_named_value (header_pack_desc, header_packet, "BLANK",
+				    NULL, d_value) )
+    {
+	blank = d_value[0];
+    }
+    else blank = max;
+    if ( ds_get_unique_named_value (header_pack_desc, header_packet,
+				    "ZDITHER0", NULL, d_value) )
+    {
+	seed = d_value[0];
+	dither = TRUE;
+    }
+    else
+    {
+	seed = 0;
+	dither = FALSE;
+    }
+    quantise = ( (bitpix > 0) &&
+		 ( (elem_type == K_FLOAT) || (elem_type == K_DOUBLE) ) ) ?
+	TRUE : FALSE;
     /*  Convert blocks of values  */
-    while (num_values > 0)
+    for (; num_values > 0; index += block_length)
     {
 	block_length = (num_values > BUF_LENGTH) ? BUF_LENGTH : num_values;
 	if ( !ds_get_elements (data, elem_type, elem_size, d_values, NULL,
@@ -272,38 +332,67 @@ flag foreign_fits_write_data (Channel channel, multi_array *multi_desc,
 	    fprintf (stderr, "Error converting data\n");
 	    a_prog_bug (function_name);
 	}
-	/*  TODO: test for TOOBIGs  */
-	switch (bitpix)
+	if (quantise)
 	{
-	  case 8:
 	    for (count = 0; count < block_length; ++count)
 	    {
-		ub_values[count] = d_values[count * 2];
+		d_val = d_values[count * 2];
+		if (d_val >= TOOBIG)
+		{
+		    l_values[count] = blank;
+		    continue;
+		}
+		d_val = (d_val - bzero) / bscale + 0.5;
+		if (dither)
+		{
+		    d_val += foreign_fits_dither_offset (seed, index + count);
+		}
+		d_val = floor (d_val);
+		if (d_val < min) d_val = min;
+		else if (d_val > max) d_val = max;
+		l_values[count] = d_val;
 	    }
-	    if (ch_write (channel, (CONST char *) ub_values, count) < count)
+	}
+	else if (bitpix > 0)
+	{
+	    /*  TODO: test for TOOBIGs  */
+	    for (count = 0; count < block_length; ++count)
 	    {
-		return (FALSE);
+		l_values[count] = d_values[count * 2];
 	    }
+	}
+	/*  Integer values are packed big-endian and written in one go  */
+	switch (bitpix)
+	{
+	  case 8:
+	    for (count = 0; count < block_length; ++count)
+	    {
+		buffer[count] = l_values[count];
+	    }
+	    if (ch_write (channel, (CONST char *) buffer, block_length)
+		< block_length) return (FALSE);
 	    break;
 	  case 16:
-	    for (count = 0; count < block_length; ++count)
+	    for (count = 0, ptr = buffer; count < block_length;
+		 ++count, ptr += 2)
 	    {
-		if ( !pio_write16s (channel,
-				    (signed long) d_values[count * 2]) )
-		{
-		    return (FALSE);
-		}
+		ptr[0] = l_values[count] >> 8;
+		ptr[1] = l_values[count];
 	    }
+	    if (ch_write (channel, (CONST char *) buffer, block_length * 2)
+		< block_length * 2) return (FALSE);
 	    break;
 	  case 32:
-	    for (count = 0; count < block_length; ++count)
+	    for (count = 0, ptr = buffer; count < block_length;
+		 ++count, ptr += 4)
 	    {
-		if ( !pio_write32s (channel,
-				    (signed long) d_values[count * 2]) )
-		{
-		    return (FALSE);
-		}
+		ptr[0] = l_values[count] >> 24;
+		ptr[1] = l_values[count] >> 16;
+		ptr[2] = l_values[count] >> 8;
+		ptr[3] = l_values[count];
 	    }
+	    if (ch_write (channel, (CONST char *) buffer, block_length * 4)
+		< block_length * 4) return (FALSE);
 	    break;
 	  case -32:
 	    for (count = 0; count < block_length; ++count)
@@ -735,6 +824,7 @@ flag foreign_fits_generate_header (packet_desc **header_pack_desc,
 	if (strcmp (elem_desc, "BZERO") == 0) continue;
 	if (strcmp (elem_desc, "BUNIT") == 0) continue;
 	if (strcmp (elem_desc, "BLANK") == 0) continue;
+	if (strcmp (elem_desc, "ZDITHER0") == 0) continue;
 	if (discard_axes_info)
 	{
 	    if (strncmp (elem_desc, "CTYPE", 5) == 0) continue;
@@ -775,6 +865,7 @@ static flag fits_write (Channel channel, multi_array *multi_desc, va_list argp)
 {
     flag ok;
     unsigned int att_key;
+    double levels_per_sigma = 0.0;
     char *header_packet;
     packet_desc *header_pack_desc;
     static char function_name[] = "fits_write";
@@ -789,6 +880,9 @@ static flag fits_write (Channel channel, multi_array *multi_desc, va_list argp)
     {
 	switch (att_key)
 	{
+	  case FA_FITS_WRITE_QUANTISE:
+	    levels_per_sigma = va_arg (argp, double);
+	    break;
 	  default:
 	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -801,6 +895,13 @@ static flag fits_write (Channel channel, multi_array *multi_desc, va_list argp)
     {
 	return (FALSE);
     }
+    if ( (levels_per_sigma > 0.0) &&
+	 !set_quantisation (header_pack_desc, &header_packet, multi_desc,
+			    levels_per_sigma) )
+    {
+	ds_dealloc_packet (header_pack_desc, header_packet);
+	return (FALSE);
+    }
     if ( !write_fits_header (channel, header_pack_desc, header_packet,
 			     multi_desc->first_hist) )
     {
@@ -940,3 +1041,146 @@ static flag write_fits_header_line (Channel channel, CONST char *line)
     if (ch_write (channel, txt, CARD_WIDTH) < CARD_WIDTH) return (FALSE);
     return (TRUE);
 }   /*  End Function write_fits_header_line  */
+
+static flag set_quantisation (packet_desc *header_pack_desc,
+			      char **header_packet, multi_array *multi_desc,
+			      double levels_per_sigma)
+/*  [SUMMARY] Set up a FITS header for quantised floating point data.
+    [PURPOSE] This routine estimates the noise in floating point data and
+    changes a FITS header so that the data will be written as 16 bit integers
+    with a quantisation step of a fraction of the noise. The noise is
+    estimated from the median absolute difference between a sample of
+    neighbouring values. The quantisation step is increased if required to fit
+    the range of the data.
+    <header_pack_desc> The header packet descriptor. This is modified.
+    <header_packet> The header packet. This is modified.
+    <multi_desc> The Karma data structure containing the data. If the data are
+    not floating point the header is not changed.
+    <levels_per_sigma> The number of quantisation levels per noise sigma.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int elem_type, elem_size, block_length, count;
+    unsigned long num_diffs;
+    uaddr num_values, remaining, index;
+    double min, max, sigma, bscale, bzero, d_val;
+    char *data;
+    double *diffs;
+    array_desc *arr_desc;
+    double value[2], value2[2];
+    double d_values[BUF_LENGTH * 2];
+    extern char host_type_sizes[NUMTYPES];
+    static char function_name[] = "set_quantisation";
+
+    arr_desc = (array_desc *) multi_desc->headers[0]->element_desc[0];
+    elem_type = arr_desc->packet->element_types[0];
+    if ( (elem_type != K_FLOAT) && (elem_type != K_DOUBLE) ) return (TRUE);
+    elem_size = host_type_sizes[elem_type];
+    data = *(char **) multi_desc->data[0];
+    num_values = ds_get_array_size (arr_desc);
+    /*  Find the range of the data  */
+    min = TOOBIG;
+    max = -TOOBIG;
+    for (remaining = num_values, index = 0; remaining > 0;
+	 remaining -= block_length, index += block_length)
+    {
+	block_length = (remaining > BUF_LENGTH) ? BUF_LENGTH : remaining;
+	if ( !ds_get_elements (data + index * elem_size, elem_type, elem_size,
+			       d_values, NULL, block_length) )
+	{
+	    fprintf (stderr, "Error converting data\n");
+	    a_prog_bug (function_name);
+	}
+	for (count = 0; count < block_length; ++count)
+	{
+	    d_val = d_values[count * 2];
+	    if (d_val >= TOOBIG) continue;
+	    if (d_val < min) min = d_val;
+	    if (d_val > max) max = d_val;
+	}
+    }
+    /*  Estimate the noise from a sample of neighbouring differences  */
+    if ( ( diffs = (double *) m_alloc (sizeof *diffs * NOISE_SAMPLES) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "difference array");
+	return (FALSE);
+    }
+    num_diffs = 0;
+    for (count = 0; (num_values > 1) && (count < NOISE_SAMPLES); ++count)
+    {
+	index = (double) (num_values - 1) * (double) count / NOISE_SAMPLES;
+	(void) ds_get_element (data + index * elem_size, elem_type, value,
+			       NULL);
+	(void) ds_get_element (data + (index + 1) * elem_size, elem_type,
+			       value2, NULL);
+	if ( (value[0] >= TOOBIG) || (value2[0] >= TOOBIG) ) continue;
+	diffs[num_diffs++] = fabs (value[0] - value2[0]);
+    }
+    if (num_diffs > 0)
+    {
+	qsort (diffs, num_diffs, sizeof *diffs, compare_doubles);
+	/*  Difference of two Gaussian values has sigma * sqrt (2) and the
+	    median absolute deviation is 0.6745 sigma  */
+	sigma = diffs[num_diffs / 2] / (0.6745 * sqrt (2.0) );
+    }
+    else sigma = 0.0;
+    m_free ( (char *) diffs );
+    if (min > max)
+    {
+	/*  All values are blank  */
+	min = 0.0;
+	max = 0.0;
+    }
+    bscale = sigma / levels_per_sigma;
+    if (bscale < (max - min) / QUANTISE_LEVELS)
+    {
+	bscale = (max - min) / QUANTISE_LEVELS;
+    }
+    if (bscale <= 0.0) bscale = 1.0;
+    bzero = (max + min) / 2.0;
+    value[1] = 0.0;
+    value[0] = 16.0;
+    if ( !ds_put_unique_named_value (header_pack_desc, header_packet,
+				     "BITPIX", K_INT, value, TRUE) )
+    {
+	return (FALSE);
+    }
+    value[0] = bscale;
+    if ( !ds_put_unique_named_value (header_pack_desc, header_packet,
+				     "BSCALE", K_DOUBLE, value, TRUE) )
+    {
+	return (FALSE);
+    }
+    value[0] = bzero;
+    if ( !ds_put_unique_named_value (header_pack_desc, header_packet,
+				     "BZERO", K_DOUBLE, value, TRUE) )
+    {
+	return (FALSE);
+    }
+    value[0] = QUANTISE_BLANK;
+    if ( !ds_put_unique_named_value (header_pack_desc, header_packet,
+				     "BLANK", K_INT, value, TRUE) )
+    {
+	return (FALSE);
+    }
+    value[0] = DITHER_SEED;
+    return ( ds_put_unique_named_value (header_pack_desc, header_packet,
+					"ZDITHER0", K_INT, value, TRUE) );
+}   /*  End Function set_quantisation  */
+
+static int compare_doubles (CONST void *a, CONST void *b)
+/*  [SUMMARY] Compare two double values for <<qsort>>.
+    <a> A pointer to the first value.
+    <b> A pointer to the second value.
+    [RETURNS] -1, 0 or 1 if the first value is less than, equal to or greater
+    than the second value.
+*/
+{
+    double d1 = *(CONST double *) a;
+    double d2 = *(CONST double *) b;
+
+    if (d1 < d2) return (-1);
+    if (d1 > d2) return (1);
+    return (0);
+}   /*  End Function compare_doubles  */
@@ -70,9 +70,33 @@
 #include <karma_wcs.h>
 #include <karma_ds.h>
 #include <karma_ch.h>
+#include <karma_mt.h>
+#include <karma_m.h>
 #include <karma_a.h>
 
 
+/*  Private structures  */
+struct ingest_type
+{
+    CONST char *filename;
+    unsigned int filetype;
+    multi_array *multi_desc;
+    Channel channel;
+    KMiriadDataContext context;
+    flag ok;
+};
+
+
+/*  Private functions  */
+STATIC_FUNCTION (void start_read,
+		 (struct ingest_type *file, KThreadPool pool,
+		  unsigned int mmap_option, flag writeable,
+		  flag fits_convert_to_float, flag sanitise) );
+STATIC_FUNCTION (void read_job,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (void finish_read, (struct ingest_type *file) );
+
 
 /*  Public functions follow  */
 
@@ -98,6 +122,7 @@ multi_array *foreign_guess_and_read (CONST char *filename,
 {
     Channel inp;
     flag fits_convert_to_float = FALSE;
+    flag sanitise = TRUE;
     unsigned int att_key, filetype;
     va_list argp;
     multi_array *multi_desc = NULL;  /*  Initialised to keep compiler happy  */
@@ -114,6 +139,10 @@ multi_array *foreign_guess_and_read (CONST char *filename,
 	    fits_convert_to_float = va_arg (argp, flag);
 	    FLAG_VERIFY (fits_convert_to_float);
 	    break;
+	  case FA_GUESS_READ_SANITISE:
+	    sanitise = va_arg (argp, flag);
+	    FLAG_VERIFY (sanitise);
+	    break;
 	  default:
 	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -184,7 +213,7 @@ multi_array *foreign_guess_and_read (CONST char *filename,
 	}
 	if ( ( multi_desc =foreign_fits_read_header (inp, TRUE,
 						     fits_convert_to_float,
-						     TRUE,
+						     sanitise,
 						     FA_FITS_READ_HEADER_END) )
 	    == NULL )
 	{
@@ -220,7 +249,7 @@ multi_array *foreign_guess_and_read (CONST char *filename,
 	ch_close (inp);
 	break;
       case FOREIGN_FILE_FORMAT_MIRIAD:
-	if ( ( multi_desc = foreign_miriad_read (filename, TRUE,
+	if ( ( multi_desc = foreign_miriad_read (filename, sanitise,
 						 FA_MIRIAD_READ_END) )
 	    == NULL )
 	{
@@ -229,7 +258,7 @@ multi_array *foreign_guess_and_read (CONST char *filename,
 	}
 	break;
       case FOREIGN_FILE_FORMAT_GIPSY:
-	if ( ( multi_desc = foreign_gipsy_read (filename, TRUE,
+	if ( ( multi_desc = foreign_gipsy_read (filename, sanitise,
 						FA_GIPSY_READ_END) )
 	    == NULL )
 	{
@@ -245,6 +274,137 @@ multi_array *foreign_guess_and_read (CONST char *filename,
     return (multi_desc);
 }   /*  End Function foreign_guess_and_read  */
 
+/*EXPERIMENTAL_FUNCTION*/
+flag foreign_guess_and_read_many (CONST char **filenames,
+				  unsigned int num_files,
+				  unsigned int mmap_option, flag writeable,
+				  unsigned int num_jobs,
+				  flag (*func) (void *info, unsigned int index,
+						CONST char *filename,
+						multi_array *multi_desc,
+						unsigned int ftype),
+				  void *info, ...)
+/*  [SUMMARY] Guess file types and read many files in parallel.
+    [PURPOSE] This routine will read a list of files as with
+    [<foreign_guess_and_read>], reading the data for several files at once
+    using the shared thread pool. The files are delivered to a callback in the
+    order given, and the data for the next batch of files is read while the
+    callback processes the current batch. At most 2 * <<num_jobs>> files are
+    held in memory at any time.
+    <filenames> The array of filenames to read.
+    <num_files> The number of files.
+    <mmap_option> This has the same meaning as for the <dsxfr_get_multi>
+    routine.
+    <writeable> This has the same meaning as for the <dsxfr_get_multi> routine.
+    <num_jobs> The number of files to read at once. If this is 0 the number of
+    threads in the shared thread pool is used.
+    <func> The function which is called for each file. The prototype function
+    is [<FOREIGN_PROTO_read_func>].
+    <info> An arbitrary pointer passed to <<func>>.
+    [VARARGS] The optional attributes are given as pairs of attribute-key
+    attribute-value pairs. This list must terminated with FA_GUESS_READ_END.
+    See [<FOREIGN_ATT_GUESS>] for a list of defined attributes.
+    [NOTE] Headers are read and files opened and closed by the calling thread.
+    Only the reading and conversion of data is performed by other threads.
+    [RETURNS] TRUE if all files were delivered to the callback, else FALSE if
+    the callback stopped processing or memory could not be allocated.
+*/
+{
+    KThreadPool pool;
+    flag ok = TRUE;
+    flag fits_convert_to_float = FALSE;
+    flag sanitise = TRUE;
+    unsigned int att_key, count, first, next, num_current, num_pending;
+    va_list argp;
+    struct ingest_type *files, *current, *pending, *tmp;
+    static char function_name[] = "foreign_guess_and_read_many";
+
+    va_start (argp, info);
+    /*  Process attributes  */
+    while ( ( att_key = va_arg (argp, unsigned int) ) != FA_GUESS_READ_END )
+    {
+	switch (att_key)
+	{
+	  case FA_GUESS_READ_FITS_TO_FLOAT:
+	    fits_convert_to_float = va_arg (argp, flag);
+	    FLAG_VERIFY (fits_convert_to_float);
+	    break;
+	  case FA_GUESS_READ_SANITISE:
+	    sanitise = va_arg (argp, flag);
+	    FLAG_VERIFY (sanitise);
+	    break;
+	  default:
+	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
+	    a_prog_bug (function_name);
+	    break;
+	}
+    }
+    va_end (argp);
+    if (num_files < 1) return (TRUE);
+    pool = mt_get_shared_pool ();
+    if (num_jobs < 1) num_jobs = mt_num_threads (pool);
+    if (num_jobs < 1) num_jobs = 1;
+    if (num_jobs > num_files) num_jobs = num_files;
+    if ( ( files = (struct ingest_type *)
+	   m_alloc (sizeof *files * 2 * num_jobs) ) == NULL )
+    {
+	m_error_notify (function_name, "file list");
+	return (FALSE);
+    }
+    current = files;
+    pending = files + num_jobs;
+    /*  Start reading the first batch  */
+    num_current = num_jobs;
+    for (count = 0; count < num_current; ++count)
+    {
+	current[count].filename = filenames[count];
+	start_read (current + count, pool, mmap_option, writeable,
+		    fits_convert_to_float, sanitise);
+    }
+    for (first = 0; num_current > 0; first = next, num_current = num_pending)
+    {
+	mt_wait_for_all_jobs (pool);
+	for (count = 0; count < num_current; ++count)
+	{
+	    finish_read (current + count);
+	}
+	/*  Start reading the next batch before delivering this one  */
+	next = first + num_current;
+	num_pending = ok ? num_files - next : 0;
+	if (num_pending > num_jobs) num_pending = num_jobs;
+	for (count = 0; count < num_pending; ++count)
+	{
+	    pending[count].filename = filenames[next + count];
+	    start_read (pending + count, pool, mmap_option, writeable,
+			fits_convert_to_float, sanitise);
+	}
+	/*  Deliver this batch  */
+	for (count = 0; count < num_current; ++count)
+	{
+	    if (ok)
+	    {
+		if (current[count].multi_desc == NULL)
+		{
+		    fprintf (stderr, "Error reading file: \"%s\"\n",
+			     current[count].filename);
+		}
+		ok = (*func) (info, first + count, current[count].filename,
+			      current[count].multi_desc,
+			      current[count].filetype);
+	    }
+	    else if (current[count].multi_desc != NULL)
+	    {
+		ds_dealloc_multi (current[count].multi_desc);
+	    }
+	}
+	tmp = current;
+	current = pending;
+	pending = tmp;
+    }
+    m_free ( (char *) files );
+    return (ok);
+}   /*  End Function foreign_guess_and_read_many  */
+
 /*EXPERIMENTAL_FUNCTION*/
 flag foreign_read_and_setup (CONST char *filename, unsigned int mmap_option,
 			     flag writeable, unsigned int *ftype, flag inform,
@@ -353,3 +513,171 @@ flag foreign_read_and_setup (CONST char *filename, unsigned int mmap_option,
     }
     return (TRUE);
 }   /*  End Function foreign_read_and_setup  */
+
+
+/*  Private functions follow  */
+
+static void start_read (struct ingest_type *file, KThreadPool pool,
+			unsigned int mmap_option, flag writeable,
+			flag fits_convert_to_float, flag sanitise)
+/*  [SUMMARY] Read the header of a file and start reading its data.
+    [PURPOSE] This routine will open a file and read its header and will then
+    launch a job which reads the data. Formats which may not be read in pieces
+    are read completely.
+    <file> The file.
+    <pool> The thread pool to launch the job in.
+    <mmap_option> This has the same meaning as for the <dsxfr_get_multi>
+    routine.
+    <writeable> This has the same meaning as for the <dsxfr_get_multi> routine.
+    <fits_convert_to_float> If TRUE, FITS data is converted to floating point.
+    <sanitise> If TRUE, axes with length 1 are ignored.
+    [RETURNS] Nothing.
+*/
+{
+    Channel channel;
+    char *ptr;
+    char fname[STRING_LENGTH];
+    char header_name[STRING_LENGTH];
+    char image_name[STRING_LENGTH];
+    extern char *sys_errlist[];
+
+    file->multi_desc = NULL;
+    file->channel = NULL;
+    file->context = NULL;
+    file->ok = FALSE;
+    file->filetype = foreign_guess_format_from_filename (file->filename);
+    switch (file->filetype)
+    {
+      case FOREIGN_FILE_FORMAT_FITS:
+	if ( ( file->channel = ch_open_file (file->filename, "r") ) == NULL )
+	{
+	    fprintf (stderr, "Error opening file: \"%s\"\t%s\n",
+		     file->filename, sys_errlist[errno]);
+	    return;
+	}
+	if ( ( file->multi_desc =
+	       foreign_fits_read_header (file->channel, TRUE,
+					 fits_convert_to_float, sanitise,
+					 FA_FITS_READ_HEADER_END) ) == NULL )
+	{
+	    fprintf (stderr, "Error reading FITS file header\n");
+	    return;
+	}
+	break;
+      case FOREIGN_FILE_FORMAT_MIRIAD:
+	sprintf (header_name, "%s/header", file->filename);
+	if ( ( channel = ch_open_file (header_name, "r") ) == NULL )
+	{
+	    fprintf (stderr, "Error opening: \"%s\"\t%s\n",
+		     header_name, sys_errlist[errno]);
+	    return;
+	}
+	file->multi_desc =
+	    foreign_miriad_read_header (channel, TRUE, sanitise,
+					FA_MIRIAD_READ_HEADER_END);
+	ch_close (channel);
+	if (file->multi_desc == NULL) return;
+	if ( ( file->context =
+	       foreign_miriad_create_data_context (file->filename) ) == NULL )
+	{
+	    fprintf (stderr, "Error creating KMiriadDataContext object\n");
+	    return;
+	}
+	break;
+      case FOREIGN_FILE_FORMAT_GIPSY:
+	strcpy (fname, file->filename);
+	if ( ( ptr = strrchr (fname, '.') ) == NULL ) return;
+	*ptr = '\0';
+	sprintf (header_name, "%s.descr", fname);
+	sprintf (image_name, "%s.image", fname);
+	if ( ( channel = ch_open_file (header_name, "r") ) == NULL )
+	{
+	    fprintf (stderr, "Error opening: \"%s\"\t%s\n",
+		     header_name, sys_errlist[errno]);
+	    return;
+	}
+	file->multi_desc =
+	    foreign_gipsy_read_header (channel, TRUE, sanitise,
+				       FA_GIPSY_READ_HEADER_END);
+	ch_close (channel);
+	if (file->multi_desc == NULL) return;
+	if ( ( file->channel = ch_open_file (image_name, "r") ) == NULL )
+	{
+	    fprintf (stderr, "Error opening: \"%s\"\t%s\n",
+		     image_name, sys_errlist[errno]);
+	    return;
+	}
+	break;
+      default:
+	/*  Read the whole file now  */
+	file->multi_desc =
+	    foreign_guess_and_read (file->filename, mmap_option, writeable,
+				    NULL,
+				    FA_GUESS_READ_FITS_TO_FLOAT,
+				    fits_convert_to_float,
+				    FA_GUESS_READ_SANITISE, sanitise,
+				    FA_GUESS_READ_END);
+	if (file->multi_desc != NULL) file->ok = TRUE;
+	return;
+    }
+    mt_launch_job (pool, read_job, (void *) file, NULL, NULL, NULL);
+}   /*  End Function start_read  */
+
+static void read_job (void *pool_info,
+		      void *call_info1, void *call_info2,
+		      void *call_info3, void *call_info4,
+		      void *thread_info)
+/*  [SUMMARY] Read the data for a file.
+    <pool_info> The pool information pointer.
+    <call_info1> The file.
+    <call_info2> Unused.
+    <call_info3> Unused.
+    <call_info4> Unused.
+    <thread_info> Unused.
+    [RETURNS] Nothing.
+*/
+{
+    struct ingest_type *file = (struct ingest_type *) call_info1;
+
+    switch (file->filetype)
+    {
+      case FOREIGN_FILE_FORMAT_FITS:
+	file->ok = foreign_fits_read_data (file->channel, file->multi_desc,
+					   NULL, 0, FA_FITS_READ_DATA_END);
+	break;
+      case FOREIGN_FILE_FORMAT_MIRIAD:
+	file->ok = foreign_miriad_read_data (file->context, file->multi_desc,
+					     NULL, 0, FA_MIRIAD_READ_DATA_END);
+	break;
+      case FOREIGN_FILE_FORMAT_GIPSY:
+	file->ok = foreign_gipsy_read_data (file->channel, file->multi_desc,
+					    NULL, 0, FA_GIPSY_READ_DATA_END);
+	break;
+    }
+}   /*  End Function read_job  */
+
+static void finish_read (struct ingest_type *file)
+/*  [SUMMARY] Finish reading a file.
+    [PURPOSE] This routine will close any channel or context used for reading
+    a file and will deallocate the data structure if the read failed.
+    <file> The file.
+    [RETURNS] Nothing.
+*/
+{
+    if (file->channel != NULL) ch_close (file->channel);
+    file->channel = NULL;
+    if (file->context != NULL)
+    {
+	foreign_miriad_close_data_context (file->context);
+	file->context = NULL;
+	if (file->ok)
+	{
+	    foreign_miriad_read_history (file->filename, file->multi_desc);
+	}
+    }
+    if (!file->ok && (file->multi_desc != NULL) )
+    {
+	ds_dealloc_multi (file->multi_desc);
+	file->multi_desc = NULL;
+    }
+}   /*  End Function finish_read  */
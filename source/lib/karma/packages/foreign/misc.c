@@ -95,3 +95,28 @@ unsigned int foreign_guess_format_from_filename (CONST char *filename)
     if ( foreign_gipsy_test (filename) ) return (FOREIGN_FILE_FORMAT_GIPSY);
     return (FOREIGN_FILE_FORMAT_UNKNOWN);
 }   /*  End Function foreign_guess_format_from_filename  */
+
+/*EXPERIMENTAL_FUNCTION*/
+double foreign_fits_dither_offset (unsigned long seed, uaddr index)
+/*  [SUMMARY] Compute the dither offset for a quantised FITS data value.
+    [PURPOSE] This routine computes the pseudo-random offset which is added to
+    a value before it is quantised, and which must be subtracted from the
+    quantised value when it is restored. The offset depends only on the seed
+    and the position of the value, so data may be processed in any order.
+    <seed> The dither seed, written to the "ZDITHER0" keyword.
+    <index> The index of the value in the data section.
+    [MT-LEVEL] Safe.
+    [RETURNS] The offset, which lies in the range -0.5 to 0.5
+*/
+{
+    unsigned int hash;
+
+    hash = (unsigned int) index ^ ( (unsigned int) seed * 0x9e3779b9U );
+    hash ^= (unsigned int) ( (index >> 16) >> 16 ) * 0x85ebca6bU;
+    hash ^= hash >> 16;
+    hash *= 0x7feb352dU;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bU;
+    hash ^= hash >> 16;
+    return ( (double) (hash >> 8) / 16777216.0 - 0.5 );
+}   /*  End Function foreign_fits_dither_offset  */
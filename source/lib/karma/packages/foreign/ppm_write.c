@@ -189,7 +189,10 @@ flag foreign_ppm_write_pseudo (Channel channel, flag binary,
     double d_data;
     CONST char *inp_line;
     double *values, *val_ptr;
-    unsigned char pixel[3];
+    unsigned int num_colours;
+    unsigned char *pixel;
+    unsigned char *line = NULL;
+    unsigned char colours[256 * 3];
     extern char module_lib_version[STRING_LENGTH + 1];
     extern char karma_library_version[STRING_LENGTH + 1];
     static char function_name[] = "foreign_ppm_write_pseudo";
@@ -242,9 +245,33 @@ flag foreign_ppm_write_pseudo (Channel channel, flag binary,
 		     "# max value follows, then comes the image data\n") )
 	return (FALSE);
     if ( !ch_printf (channel, "255\n") ) return (FALSE);
+    /*  Convert the colourmap to bytes once, rather than for every pixel  */
+    num_colours = (cmap_size > 2) ? cmap_size : 256;
+    for (ival = 0; ival < num_colours; ++ival)
+    {
+	pixel = colours + ival * 3;
+	if (cmap_size > 2)
+	{
+	    pixel[0] = (cmap_reds[ival * cmap_stride] >> 8) & 0xff;
+	    pixel[1] = (cmap_greens[ival * cmap_stride] >> 8) & 0xff;
+	    pixel[2] = (cmap_blues[ival * cmap_stride] >> 8) & 0xff;
+	}
+	else
+	{
+	    pixel[0] = ival;
+	    pixel[1] = ival;
+	    pixel[2] = ival;
+	}
+    }
+    /*  Binary lines are assembled and written in one go  */
+    if ( binary && ( ( line = (unsigned char *) m_alloc (3 * width) )
+		     == NULL ) )
+    {
+	m_error_notify (function_name, "line buffer");
+	return (FALSE);
+    }
     /*  Loop through the image lines  */
-    if (cmap_size > 2) d_mul = (cmap_size - 1) / (i_max - i_min);
-    else d_mul = 255.0 / (i_max - i_min);
+    d_mul = (num_colours - 1) / (i_max - i_min);
     for (vcount = height - 1; vcount >= 0; --vcount)
     {
 	inp_line = image + voffsets[vcount];
@@ -255,6 +282,7 @@ flag foreign_ppm_write_pseudo (Channel channel, flag binary,
 					 values, &complex, width) )
 	{
 	    (void) fprintf (stderr, "Error converting data\n");
+	    if (binary) m_free ( (char *) line );
 	    return (FALSE);
 	}
 	/*  Loop for each value  */
@@ -262,24 +290,15 @@ flag foreign_ppm_write_pseudo (Channel channel, flag binary,
 	     ++hcount, val_ptr += 2)
 	{
 	    if ( (d_data = *val_ptr) < i_min ) ival = 0;
-	    else if (d_data >= d_toobig) ival = cmap_size - 1;
-	    else if (d_data > i_max) ival = cmap_size - 1;
+	    else if (d_data >= d_toobig) ival = num_colours - 1;
+	    else if (d_data > i_max) ival = num_colours - 1;
 	    else ival = (int) ( (d_data - i_min) * d_mul + 0.5 );
-	    if (cmap_size > 2)
-	    {
-		pixel[0] = (cmap_reds[ival * cmap_stride] >> 8) & 0xff;
-		pixel[1] = (cmap_greens[ival * cmap_stride] >> 8) & 0xff;
-		pixel[2] = (cmap_blues[ival * cmap_stride] >> 8) & 0xff;
-	    }
-	    else
-	    {
-		pixel[0] = ival;
-		pixel[1] = ival;
-		pixel[2] = ival;
-	    }
+	    pixel = colours + ival * 3;
 	    if (binary)
 	    {
-		if (ch_write (channel, (char *) pixel, 3) < 3) return (FALSE);
+		line[hcount * 3] = pixel[0];
+		line[hcount * 3 + 1] = pixel[1];
+		line[hcount * 3 + 2] = pixel[2];
 	    }
 	    else
 	    {
@@ -287,7 +306,14 @@ flag foreign_ppm_write_pseudo (Channel channel, flag binary,
 				 pixel[0], pixel[1],pixel[2]) ) return (FALSE);
 	    }
 	}
+	if ( binary && (ch_write (channel, (char *) line, 3 * width) <
+			3 * width) )
+	{
+	    m_free ( (char *) line );
+	    return (FALSE);
+	}
     }
+    if (binary) m_free ( (char *) line );
     return (TRUE);
 }   /*  End Function foreign_ppm_write_pseudo  */
 
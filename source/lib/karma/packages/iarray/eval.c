@@ -0,0 +1,907 @@
+/*LINTLIBRARY*/
+/*  eval.c
+
+    This code provides fused element-wise expressions on Intelligent Arrays.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains all routines needed to evaluate an arithmetic
+  expression over Intelligent Arrays in a single pass.
+
+
+*/
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <karma.h>
+#include <karma_iarray.h>
+#include <karma_ds.h>
+#include <karma_mt.h>
+#include <karma_a.h>
+#include <karma_m.h>
+
+
+#define BLOCK_SIZE 1024
+#define MAX_INSTRUCTIONS 256
+#define MAX_DEPTH 16
+#define MAX_ARRAYS 26
+#define MIN_JOB_VALUES 65536
+
+#define OP_ARRAY 0
+#define OP_CONSTANT 1
+#define OP_ADD 2
+#define OP_SUB 3
+#define OP_MUL 4
+#define OP_DIV 5
+#define OP_NEGATE 6
+#define OP_ABS 7
+#define OP_SQRT 8
+#define OP_MIN 9
+#define OP_MAX 10
+
+#define VERIFY_IARRAY(array) if (array == NULL) \
+{(void) fprintf (stderr, "NULL iarray passed\n"); \
+ a_prog_bug (function_name); }
+
+
+/*  Structure declarations follow  */
+
+typedef struct
+{
+    unsigned int opcode;
+    unsigned int index;      /*  Array number for OP_ARRAY  */
+    double value;            /*  Value for OP_CONSTANT      */
+} instruction_type;
+
+typedef struct
+{
+    /*  Variable bindings, indexed by letter  */
+    flag bound[26];
+    flag is_array[26];
+    iarray arrays[26];
+    double values[26];
+    /*  The compiled program  */
+    unsigned int num_instructions;
+    instruction_type code[MAX_INSTRUCTIONS];
+    unsigned int depth;
+    unsigned int max_depth;
+    /*  The arrays used, in the order they were first referenced  */
+    unsigned int num_arrays;
+    iarray inputs[MAX_ARRAYS];
+    int slot[26];
+    CONST char *expression;
+    CONST char *pos;
+} program_type;
+
+typedef struct
+{
+    program_type *program;
+    iarray out;
+    unsigned int num_dim;
+    uaddr row_length;
+    flag failed;
+} eval_info_type;
+
+
+/*  Private functions  */
+STATIC_FUNCTION (flag parse_expression, (program_type *program) );
+STATIC_FUNCTION (flag parse_term, (program_type *program) );
+STATIC_FUNCTION (flag parse_factor, (program_type *program) );
+STATIC_FUNCTION (flag emit,
+		 (program_type *program, unsigned int opcode,
+		  unsigned int index, double value) );
+STATIC_FUNCTION (void skip_space, (program_type *program) );
+STATIC_FUNCTION (flag parse_error, (program_type *program, char *message) );
+STATIC_FUNCTION (void eval_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (flag eval_rows,
+		 (eval_info_type *info, double *buffer, uaddr start_row,
+		  uaddr num_rows) );
+STATIC_FUNCTION (CONST char *get_row,
+		 (iarray array, unsigned int num_dim, uaddr row) );
+STATIC_FUNCTION (flag load_values,
+		 (iarray array, CONST char *row, uaddr first, unsigned int num,
+		  double *values, double *tmp, char *blank) );
+STATIC_FUNCTION (flag store_values,
+		 (iarray array, char *row, uaddr first, unsigned int num,
+		  double *values, double *tmp, CONST char *blank) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iarray_eval (iarray out, CONST char *expression, ...)
+/*  [SUMMARY] Evaluate an element-wise expression over Intelligent Arrays.
+    [PURPOSE] This routine will evaluate an arithmetic expression for every
+    element of an output array, reading the corresponding elements of any
+    number of input arrays. The expression is compiled once and then run over
+    blocks of values, so a chain of operations (for example a scale, offset
+    and clip) needs only one pass through the data. The rows of the arrays are
+    shared between the threads of the shared thread pool.
+    <out> The output Intelligent Array. This may also be used as an input.
+    <expression> The expression. Variables are single lowercase letters, bound
+    by the varargs list. The operators "+", "-", "*" and "/", parentheses,
+    numeric constants and the functions "abs(x)", "sqrt(x)", "min(x,y)" and
+    "max(x,y)" are supported. For example: "(a - b) * s + 1.5".
+    [VARARGS] The list of variable bindings follows. Each binding is an
+    IARRAY_EVAL_ARRAY or IARRAY_EVAL_SCALAR key, the variable letter (as an
+    int) and either an iarray or a double. The list must be terminated with
+    IARRAY_EVAL_END. All arrays must have the same dimension lengths as the
+    output array. Complex arrays are not supported.
+    [NOTE] Blank input values, division by zero and the square root of a
+    negative number produce blank output values. Integer outputs are rounded
+    to the nearest integer and clipped to the range of the type.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KThreadPool pool;
+    va_list argp;
+    int letter;
+    unsigned int key, dim_count, count, num_jobs, job_count;
+    uaddr num_rows, start, block_size;
+    iarray array;
+    double **buffers;
+    program_type program;
+    eval_info_type info;
+    static char function_name[] = "iarray_eval";
+
+    VERIFY_IARRAY (out);
+    if (expression == NULL)
+    {
+	(void) fprintf (stderr, "NULL expression passed\n");
+	a_prog_bug (function_name);
+    }
+    m_clear ( (char *) &program, sizeof program );
+    va_start (argp, expression);
+    while ( ( key = va_arg (argp, unsigned int) ) != IARRAY_EVAL_END )
+    {
+	letter = va_arg (argp, int);
+	if ( (letter < 'a') || (letter > 'z') )
+	{
+	    (void) fprintf (stderr, "Illegal variable name: '%c'\n", letter);
+	    a_prog_bug (function_name);
+	}
+	letter -= 'a';
+	switch (key)
+	{
+	  case IARRAY_EVAL_ARRAY:
+	    array = va_arg (argp, iarray);
+	    VERIFY_IARRAY (array);
+	    program.is_array[letter] = TRUE;
+	    program.arrays[letter] = array;
+	    break;
+	  case IARRAY_EVAL_SCALAR:
+	    program.is_array[letter] = FALSE;
+	    program.values[letter] = va_arg (argp, double);
+	    break;
+	  default:
+	    (void) fprintf (stderr, "Illegal binding key: %u\n", key);
+	    a_prog_bug (function_name);
+	    break;
+	}
+	program.bound[letter] = TRUE;
+    }
+    va_end (argp);
+    /*  Compile the expression  */
+    for (count = 0; count < 26; ++count) program.slot[count] = -1;
+    program.expression = expression;
+    program.pos = expression;
+    if ( !parse_expression (&program) ) return (FALSE);
+    skip_space (&program);
+    if (*program.pos != '\0')
+    {
+	return ( parse_error (&program, "unexpected character") );
+    }
+    /*  Check the arrays  */
+    info.num_dim = iarray_num_dim (out);
+    if ( ds_element_is_complex ( iarray_type (out) ) )
+    {
+	(void) fprintf (stderr, "%s: complex arrays not supported\n",
+			function_name);
+	return (FALSE);
+    }
+    for (count = 0; count < program.num_arrays; ++count)
+    {
+	array = program.inputs[count];
+	if ( ds_element_is_complex ( iarray_type (array) ) )
+	{
+	    (void) fprintf (stderr, "%s: complex arrays not supported\n",
+			    function_name);
+	    return (FALSE);
+	}
+	if (iarray_num_dim (array) != info.num_dim)
+	{
+	    (void) fprintf (stderr,
+			    "%s: input array has: %u dimensions whilst output array has: %u\n",
+			    function_name, iarray_num_dim (array),
+			    info.num_dim);
+	    return (FALSE);
+	}
+	for (dim_count = 0; dim_count < info.num_dim; ++dim_count)
+	{
+	    if (array->lengths[dim_count] != out->lengths[dim_count])
+	    {
+		(void) fprintf (stderr,
+				"%s: dimension: %u lengths differ: %lu and %lu\n",
+				function_name, dim_count,
+				array->lengths[dim_count],
+				out->lengths[dim_count]);
+		return (FALSE);
+	    }
+	}
+    }
+    info.program = &program;
+    info.out = out;
+    info.row_length = out->lengths[info.num_dim - 1];
+    info.failed = FALSE;
+    for (dim_count = 0, num_rows = 1; dim_count + 1 < info.num_dim;
+	 ++dim_count) num_rows *= out->lengths[dim_count];
+    pool = mt_get_shared_pool ();
+    num_jobs = mt_num_threads (pool);
+    if (num_rows * info.row_length / MIN_JOB_VALUES < num_jobs)
+    {
+	num_jobs = num_rows * info.row_length / MIN_JOB_VALUES;
+    }
+    if (num_jobs > num_rows) num_jobs = num_rows;
+    if (num_jobs < 1) num_jobs = 1;
+    /*  Each job needs its own value stack and conversion buffer  */
+    if ( ( buffers = (double **) m_alloc (sizeof *buffers * num_jobs) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "array of buffer pointers");
+	return (FALSE);
+    }
+    for (job_count = 0; job_count < num_jobs; ++job_count)
+    {
+	if ( ( buffers[job_count] = (double *)
+	       m_alloc (sizeof **buffers * BLOCK_SIZE *
+			(program.max_depth + 3) ) ) == NULL )
+	{
+	    m_error_notify (function_name, "value stack");
+	    while (job_count > 0) m_free ( (char *) buffers[--job_count] );
+	    m_free ( (char *) buffers );
+	    return (FALSE);
+	}
+    }
+    if (num_jobs < 2)
+    {
+	if ( !eval_rows (&info, buffers[0], 0, num_rows) ) info.failed = TRUE;
+    }
+    else
+    {
+	block_size = num_rows / num_jobs;
+	for (job_count = 0, start = 0; job_count < num_jobs;
+	     ++job_count, start += block_size)
+	{
+	    if (job_count + 1 == num_jobs) block_size = num_rows - start;
+	    mt_launch_job (pool, eval_job_func, &info, buffers[job_count],
+			   (void *) start, (void *) block_size);
+	}
+	mt_wait_for_all_jobs (pool);
+    }
+    for (job_count = 0; job_count < num_jobs; ++job_count)
+    {
+	m_free ( (char *) buffers[job_count] );
+    }
+    m_free ( (char *) buffers );
+    return (info.failed ? FALSE : TRUE);
+}   /*  End Function iarray_eval  */
+
+
+/*  Private functions follow  */
+
+static flag parse_expression (program_type *program)
+/*  [SUMMARY] Compile a sum or difference of terms.
+    <program> The program.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    char op;
+
+    if ( !parse_term (program) ) return (FALSE);
+    while (TRUE)
+    {
+	skip_space (program);
+	op = *program->pos;
+	if ( (op != '+') && (op != '-') ) return (TRUE);
+	++program->pos;
+	if ( !parse_term (program) ) return (FALSE);
+	if ( !emit (program, (op == '+') ? OP_ADD : OP_SUB, 0, 0.0) )
+	{
+	    return (FALSE);
+	}
+    }
+}   /*  End Function parse_expression  */
+
+static flag parse_term (program_type *program)
+/*  [SUMMARY] Compile a product or quotient of factors.
+    <program> The program.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    char op;
+
+    if ( !parse_factor (program) ) return (FALSE);
+    while (TRUE)
+    {
+	skip_space (program);
+	op = *program->pos;
+	if ( (op != '*') && (op != '/') ) return (TRUE);
+	++program->pos;
+	if ( !parse_factor (program) ) return (FALSE);
+	if ( !emit (program, (op == '*') ? OP_MUL : OP_DIV, 0, 0.0) )
+	{
+	    return (FALSE);
+	}
+    }
+}   /*  End Function parse_term  */
+
+static flag parse_factor (program_type *program)
+/*  [SUMMARY] Compile a factor.
+    [PURPOSE] A factor is a negated factor, a number, a variable, a
+    parenthesised expression or a function call.
+    <program> The program.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int letter;
+    unsigned int length, opcode, num_args, count;
+    double value;
+    char *end;
+    CONST char *name;
+
+    skip_space (program);
+    if (*program->pos == '-')
+    {
+	++program->pos;
+	if ( !parse_factor (program) ) return (FALSE);
+	return ( emit (program, OP_NEGATE, 0, 0.0) );
+    }
+    if (*program->pos == '(')
+    {
+	++program->pos;
+	if ( !parse_expression (program) ) return (FALSE);
+	skip_space (program);
+	if (*program->pos != ')')
+	{
+	    return ( parse_error (program, "missing )") );
+	}
+	++program->pos;
+	return (TRUE);
+    }
+    if ( isdigit (*program->pos) || (*program->pos == '.') )
+    {
+	value = strtod (program->pos, &end);
+	if (end == program->pos)
+	{
+	    return ( parse_error (program, "bad number") );
+	}
+	program->pos = end;
+	return ( emit (program, OP_CONSTANT, 0, value) );
+    }
+    if ( !isalpha (*program->pos) )
+    {
+	return ( parse_error (program, "expected a value") );
+    }
+    name = program->pos;
+    for (length = 0; isalnum (name[length]); ++length);
+    program->pos += length;
+    if (length == 1)
+    {
+	/*  A variable  */
+	letter = *name - 'a';
+	if ( (letter < 0) || (letter >= 26) || !program->bound[letter] )
+	{
+	    return ( parse_error (program, "unbound variable") );
+	}
+	if (!program->is_array[letter])
+	{
+	    return ( emit (program, OP_CONSTANT, 0, program->values[letter]) );
+	}
+	if (program->slot[letter] < 0)
+	{
+	    program->slot[letter] = program->num_arrays;
+	    program->inputs[program->num_arrays++] = program->arrays[letter];
+	}
+	return ( emit (program, OP_ARRAY, program->slot[letter], 0.0) );
+    }
+    /*  A function  */
+    if ( (length == 3) && (strncmp (name, "abs", 3) == 0) )
+    {
+	opcode = OP_ABS;
+	num_args = 1;
+    }
+    else if ( (length == 4) && (strncmp (name, "sqrt", 4) == 0) )
+    {
+	opcode = OP_SQRT;
+	num_args = 1;
+    }
+    else if ( (length == 3) && (strncmp (name, "min", 3) == 0) )
+    {
+	opcode = OP_MIN;
+	num_args = 2;
+    }
+    else if ( (length == 3) && (strncmp (name, "max", 3) == 0) )
+    {
+	opcode = OP_MAX;
+	num_args = 2;
+    }
+    else return ( parse_error (program, "unknown function") );
+    skip_space (program);
+    if (*program->pos != '(') return ( parse_error (program, "missing (") );
+    ++program->pos;
+    for (count = 0; count < num_args; ++count)
+    {
+	if (count > 0)
+	{
+	    skip_space (program);
+	    if (*program->pos != ',')
+	    {
+		return ( parse_error (program, "missing ,") );
+	    }
+	    ++program->pos;
+	}
+	if ( !parse_expression (program) ) return (FALSE);
+    }
+    skip_space (program);
+    if (*program->pos != ')') return ( parse_error (program, "missing )") );
+    ++program->pos;
+    return ( emit (program, opcode, 0, 0.0) );
+}   /*  End Function parse_factor  */
+
+static flag emit (program_type *program, unsigned int opcode,
+		  unsigned int index, double value)
+/*  [SUMMARY] Append an instruction to a program.
+    [PURPOSE] This routine will append an instruction to a program, keeping
+    track of the depth of the value stack. Operations on constants are folded.
+    <program> The program.
+    <opcode> The operation.
+    <index> The array number.
+    <value> The constant value.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    instruction_type *prev;
+
+    switch (opcode)
+    {
+      case OP_ARRAY:
+      case OP_CONSTANT:
+	if (++program->depth > MAX_DEPTH)
+	{
+	    return ( parse_error (program, "expression too deep") );
+	}
+	if (program->depth > program->max_depth)
+	{
+	    program->max_depth = program->depth;
+	}
+	break;
+      case OP_NEGATE:
+      case OP_ABS:
+      case OP_SQRT:
+	prev = program->code + program->num_instructions - 1;
+	if ( (prev->opcode == OP_CONSTANT) && (opcode == OP_NEGATE) )
+	{
+	    prev->value = -prev->value;
+	    return (TRUE);
+	}
+	if ( (prev->opcode == OP_CONSTANT) && (opcode == OP_ABS) )
+	{
+	    prev->value = fabs (prev->value);
+	    return (TRUE);
+	}
+	break;
+      default:
+	/*  Binary operations  */
+	prev = program->code + program->num_instructions - 1;
+	--program->depth;
+	if ( (prev[0].opcode == OP_CONSTANT) &&
+	     (prev[-1].opcode == OP_CONSTANT) &&
+	     (opcode != OP_DIV) )
+	{
+	    switch (opcode)
+	    {
+	      case OP_ADD:
+		prev[-1].value += prev[0].value;
+		break;
+	      case OP_SUB:
+		prev[-1].value -= prev[0].value;
+		break;
+	      case OP_MUL:
+		prev[-1].value *= prev[0].value;
+		break;
+	      case OP_MIN:
+		if (prev[0].value < prev[-1].value)
+		{
+		    prev[-1].value = prev[0].value;
+		}
+		break;
+	      case OP_MAX:
+		if (prev[0].value > prev[-1].value)
+		{
+		    prev[-1].value = prev[0].value;
+		}
+		break;
+	    }
+	    --program->num_instructions;
+	    return (TRUE);
+	}
+	break;
+    }
+    if (program->num_instructions >= MAX_INSTRUCTIONS)
+    {
+	return ( parse_error (program, "expression too long") );
+    }
+    program->code[program->num_instructions].opcode = opcode;
+    program->code[program->num_instructions].index = index;
+    program->code[program->num_instructions].value = value;
+    ++program->num_instructions;
+    return (TRUE);
+}   /*  End Function emit  */
+
+static void skip_space (program_type *program)
+/*  [SUMMARY] Skip whitespace in the expression.
+    <program> The program.
+    [RETURNS] Nothing.
+*/
+{
+    while ( isspace (*program->pos) ) ++program->pos;
+}   /*  End Function skip_space  */
+
+static flag parse_error (program_type *program, char *message)
+/*  [SUMMARY] Report an error in an expression.
+    <program> The program.
+    <message> The error message.
+    [RETURNS] FALSE.
+*/
+{
+    (void) fprintf (stderr, "iarray_eval: %s at position %d of: \"%s\"\n",
+		    message, (int) (program->pos - program->expression),
+		    program->expression);
+    return (FALSE);
+}   /*  End Function parse_error  */
+
+static void eval_job_func (void *pool_info,
+			   void *call_info1, void *call_info2,
+			   void *call_info3, void *call_info4,
+			   void *thread_info)
+/*  [SUMMARY] Perform an expression evaluation job.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The evaluation information.
+    <call_info2> The value stack and conversion buffer for the job.
+    <call_info3> The first row.
+    <call_info4> The number of rows.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    eval_info_type *info = (eval_info_type *) call_info1;
+
+    if ( !eval_rows (info, (double *) call_info2, (uaddr) call_info3,
+		     (uaddr) call_info4) ) info->failed = TRUE;
+}   /*  End Function eval_job_func  */
+
+static flag eval_rows (eval_info_type *info, double *buffer, uaddr start_row,
+		       uaddr num_rows)
+/*  [SUMMARY] Evaluate the expression over some rows.
+    <info> The evaluation information.
+    <buffer> The value stack and conversion buffer. This must have space for
+    (max_depth + 3) * BLOCK_SIZE values.
+    <start_row> The first row.
+    <num_rows> The number of rows.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    program_type *program = info->program;
+    unsigned int num, i, sp, pc, count;
+    uaddr row, first;
+    double value;
+    double *a, *b;
+    CONST char *rows[MAX_ARRAYS];
+    char *out_row;
+    CONST instruction_type *instr;
+    double *stack = buffer;
+    double *tmp = buffer + BLOCK_SIZE * program->max_depth;
+    char *blank = (char *) (tmp + 2 * BLOCK_SIZE);
+
+    for (row = start_row; row < start_row + num_rows; ++row)
+    {
+	for (count = 0; count < program->num_arrays; ++count)
+	{
+	    rows[count] = get_row (program->inputs[count], info->num_dim, row);
+	}
+	out_row = (char *) get_row (info->out, info->num_dim, row);
+	for (first = 0; first < info->row_length; first += num)
+	{
+	    num = info->row_length - first;
+	    if (num > BLOCK_SIZE) num = BLOCK_SIZE;
+	    m_clear (blank, num);
+	    /*  Run the program over the block  */
+	    for (pc = 0, sp = 0, instr = program->code;
+		 pc < program->num_instructions; ++pc, ++instr)
+	    {
+		/*  Top two entries on the stack  */
+		b = (sp > 0) ? stack + BLOCK_SIZE * (sp - 1) : stack;
+		a = (sp > 1) ? b - BLOCK_SIZE : stack;
+		switch (instr->opcode)
+		{
+		  case OP_ARRAY:
+		    if ( !load_values (program->inputs[instr->index],
+				       rows[instr->index], first, num,
+				       stack + BLOCK_SIZE * sp, tmp,
+				       blank) ) return (FALSE);
+		    ++sp;
+		    break;
+		  case OP_CONSTANT:
+		    a = stack + BLOCK_SIZE * sp;
+		    value = instr->value;
+		    for (i = 0; i < num; ++i) a[i] = value;
+		    ++sp;
+		    break;
+		  case OP_ADD:
+		    for (i = 0; i < num; ++i) a[i] += b[i];
+		    --sp;
+		    break;
+		  case OP_SUB:
+		    for (i = 0; i < num; ++i) a[i] -= b[i];
+		    --sp;
+		    break;
+		  case OP_MUL:
+		    for (i = 0; i < num; ++i) a[i] *= b[i];
+		    --sp;
+		    break;
+		  case OP_DIV:
+		    for (i = 0; i < num; ++i)
+		    {
+			if (b[i] == 0.0) blank[i] = TRUE;
+			else a[i] /= b[i];
+		    }
+		    --sp;
+		    break;
+		  case OP_NEGATE:
+		    for (i = 0; i < num; ++i) b[i] = -b[i];
+		    break;
+		  case OP_ABS:
+		    for (i = 0; i < num; ++i) b[i] = fabs (b[i]);
+		    break;
+		  case OP_SQRT:
+		    for (i = 0; i < num; ++i)
+		    {
+			if (b[i] < 0.0) blank[i] = TRUE;
+			else b[i] = sqrt (b[i]);
+		    }
+		    break;
+		  case OP_MIN:
+		    for (i = 0; i < num; ++i) if (b[i] < a[i]) a[i] = b[i];
+		    --sp;
+		    break;
+		  case OP_MAX:
+		    for (i = 0; i < num; ++i) if (b[i] > a[i]) a[i] = b[i];
+		    --sp;
+		    break;
+		}
+	    }
+	    if ( !store_values (info->out, out_row, first, num, stack, tmp,
+				blank) ) return (FALSE);
+	}
+    }
+    return (TRUE);
+}   /*  End Function eval_rows  */
+
+static CONST char *get_row (iarray array, unsigned int num_dim, uaddr row)
+/*  [SUMMARY] Find the start of a row (line along the last dimension).
+    <array> The array.
+    <num_dim> The number of dimensions.
+    <row> The row number, counting over all but the last dimension.
+    [RETURNS] A pointer to the first element of the row.
+*/
+{
+    unsigned int dim_count;
+    CONST char *ptr = array->data;
+
+    for (dim_count = num_dim - 1; dim_count > 0; --dim_count)
+    {
+	ptr += array->offsets[dim_count - 1][row %
+					      array->lengths[dim_count - 1]];
+	row /= array->lengths[dim_count - 1];
+    }
+    return (ptr);
+}   /*  End Function get_row  */
+
+static flag load_values (iarray array, CONST char *row, uaddr first,
+			 unsigned int num, double *values, double *tmp,
+			 char *blank)
+/*  [SUMMARY] Convert a block of values from a row to double precision.
+    [PURPOSE] This routine will read a block of values, using a loop
+    specialised for the data type where possible, and flag blank values.
+    <array> The array.
+    <row> The start of the row.
+    <first> The index of the first value in the row.
+    <num> The number of values.
+    <values> The values are written here.
+    <tmp> A conversion buffer for 2 * <<num>> values.
+    <blank> Blank values are flagged here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int i;
+    uaddr stride;
+    uaddr *row_offsets = array->offsets[array->num_dim - 1];
+    uaddr *offsets = row_offsets + first;
+    double toobig = TOOBIG;
+
+    if (array->contiguous[array->num_dim - 1])
+    {
+	/*  Take the stride from the start of the row, since the block may end
+	    with the last element. A row of length 1 has only one offset  */
+	stride = (array->lengths[array->num_dim - 1] > 1) ?
+	    row_offsets[1] - row_offsets[0] : 0;
+	row += offsets[0];
+	switch ( iarray_type (array) )
+	{
+	  case K_FLOAT:
+	    for (i = 0; i < num; ++i)
+	    {
+		values[i] = *(float *) (row + i * stride);
+	    }
+	    break;
+	  case K_DOUBLE:
+	    for (i = 0; i < num; ++i)
+	    {
+		values[i] = *(double *) (row + i * stride);
+	    }
+	    break;
+	  case K_SHORT:
+	    for (i = 0; i < num; ++i)
+	    {
+		values[i] = *(signed short *) (row + i * stride);
+	    }
+	    break;
+	  case K_BYTE:
+	    for (i = 0; i < num; ++i)
+	    {
+		values[i] = *(signed char *) (row + i * stride);
+	    }
+	    break;
+	  case K_UBYTE:
+	    for (i = 0; i < num; ++i)
+	    {
+		values[i] = *(unsigned char *) (row + i * stride);
+	    }
+	    break;
+	  default:
+	    if ( !ds_get_elements (row, iarray_type (array), stride, tmp,
+				   NULL, num) ) return (FALSE);
+	    for (i = 0; i < num; ++i) values[i] = tmp[i * 2];
+	    break;
+	}
+    }
+    else
+    {
+	if ( !ds_get_scattered_elements (row, iarray_type (array), offsets,
+					 tmp, NULL, num) ) return (FALSE);
+	for (i = 0; i < num; ++i) values[i] = tmp[i * 2];
+    }
+    for (i = 0; i < num; ++i) if (values[i] >= toobig) blank[i] = TRUE;
+    return (TRUE);
+}   /*  End Function load_values  */
+
+static flag store_values (iarray array, char *row, uaddr first,
+			  unsigned int num, double *values, double *tmp,
+			  CONST char *blank)
+/*  [SUMMARY] Write a block of double precision values to a row.
+    <array> The array.
+    <row> The start of the row.
+    <first> The index of the first value in the row.
+    <num> The number of values.
+    <values> The values. These may be modified.
+    <tmp> A conversion buffer for 2 * <<num>> values.
+    <blank> The flags for blank values.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int i;
+    uaddr stride;
+    double value;
+    uaddr *row_offsets = array->offsets[array->num_dim - 1];
+    uaddr *offsets = row_offsets + first;
+    double toobig = TOOBIG;
+
+    for (i = 0; i < num; ++i) if (blank[i]) values[i] = toobig;
+    if (array->contiguous[array->num_dim - 1])
+    {
+	/*  Take the stride from the start of the row, since the block may end
+	    with the last element. A row of length 1 has only one offset  */
+	stride = (array->lengths[array->num_dim - 1] > 1) ?
+	    row_offsets[1] - row_offsets[0] : 0;
+	row += offsets[0];
+	switch ( iarray_type (array) )
+	{
+	  case K_FLOAT:
+	    for (i = 0; i < num; ++i)
+	    {
+		*(float *) (row + i * stride) = values[i];
+	    }
+	    return (TRUE);
+	    /*break;*/
+	  case K_DOUBLE:
+	    for (i = 0; i < num; ++i)
+	    {
+		*(double *) (row + i * stride) = values[i];
+	    }
+	    return (TRUE);
+	    /*break;*/
+	  case K_SHORT:
+	    for (i = 0; i < num; ++i)
+	    {
+		value = floor (values[i] + 0.5);
+		if (value < -32768.0) value = -32768.0;
+		else if (value > 32767.0) value = 32767.0;
+		*(signed short *) (row + i * stride) = value;
+	    }
+	    return (TRUE);
+	    /*break;*/
+	  case K_BYTE:
+	    for (i = 0; i < num; ++i)
+	    {
+		value = floor (values[i] + 0.5);
+		if (value < -128.0) value = -128.0;
+		else if (value > 127.0) value = 127.0;
+		*(signed char *) (row + i * stride) = value;
+	    }
+	    return (TRUE);
+	    /*break;*/
+	  case K_UBYTE:
+	    for (i = 0; i < num; ++i)
+	    {
+		value = floor (values[i] + 0.5);
+		if (value < 0.0) value = 0.0;
+		else if (value > 255.0) value = 255.0;
+		*(unsigned char *) (row + i * stride) = value;
+	    }
+	    return (TRUE);
+	    /*break;*/
+	}
+    }
+    /*  Generic conversion  */
+    for (i = 0; i < num; ++i)
+    {
+	tmp[i * 2] = values[i];
+	tmp[i * 2 + 1] = 0.0;
+    }
+    if (array->contiguous[array->num_dim - 1])
+    {
+	return ( ds_put_elements (row, iarray_type (array), stride, tmp,
+				  num) );
+    }
+    for (i = 0; i < num; ++i)
+    {
+	if (ds_put_element (row + offsets[i], iarray_type (array),
+			    tmp + i * 2) == NULL) return (FALSE);
+    }
+    return (TRUE);
+}   /*  End Function store_values  */
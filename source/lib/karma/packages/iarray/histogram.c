@@ -0,0 +1,973 @@
+/*LINTLIBRARY*/
+/*  histogram.c
+
+    This code provides incremental histograms of Intelligent Arrays.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains all routines needed to build a histogram of an
+  Intelligent Array once and then re-bin it and query percentiles from it
+  without reading the data again.
+
+
+*/
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdarg.h>
+#include <karma.h>
+#include <karma_iarray.h>
+#include <karma_ds.h>
+#include <karma_mt.h>
+#include <karma_a.h>
+#include <karma_m.h>
+
+
+#define MAGIC_NUMBER 1283748290
+
+#define NUM_FINE_BINS 16384
+#define BLOCK_SIZE 1024
+#define MIN_JOB_VALUES 65536
+
+#define VERIFY_IARRAY(array) if (array == NULL) \
+{(void) fprintf (stderr, "NULL iarray passed\n"); \
+ a_prog_bug (function_name); }
+
+#define VERIFY_HISTOGRAM(hist) if (hist == NULL) \
+{(void) fprintf (stderr, "NULL histogram passed\n"); \
+ a_prog_bug (function_name); } \
+if (hist->magic_number != MAGIC_NUMBER) \
+{(void) fprintf (stderr, "Invalid histogram\n"); \
+ a_prog_bug (function_name); }
+
+
+/*  Structure declarations follow  */
+
+/*  The fine bins of an automatically ranged histogram always lie on a grid
+    whose spacing is a power of two and whose origin is a multiple of the
+    spacing. Growing the range doubles the spacing, so each new bin is the
+    exact union of old bins and histograms built independently (by different
+    threads or from different planes) can be merged without error.  */
+struct histogram_type
+{
+    unsigned int magic_number;
+    unsigned int conv_type;
+    unsigned long sample_stride;
+    flag fixed_range;
+    double first;              /*  Lower edge of the first fine bin   */
+    double width;              /*  Width of the fine bins (0 if none) */
+    double top;                /*  Upper edge of the last fine bin    */
+    double min;                /*  Smallest value seen                */
+    double max;                /*  Largest value seen                 */
+    unsigned long num_values;  /*  Values counted (including tails)   */
+    unsigned long num_below;   /*  Values below <<first>>             */
+    unsigned long num_above;   /*  Values above <<top>>               */
+    unsigned long bins[NUM_FINE_BINS];
+    unsigned long *old_bins;   /*  Scratch space for re-binning       */
+};
+
+typedef struct
+{
+    iarray array;
+    flag full_array;
+    flag failed;
+} fill_info_type;
+
+
+/*  Private functions  */
+STATIC_FUNCTION (KHistogram alloc_histogram,
+		 (unsigned int conv_type, unsigned long sample_stride) );
+STATIC_FUNCTION (void clear_histogram, (KHistogram histogram) );
+STATIC_FUNCTION (flag extend_range,
+		 (KHistogram histogram, double lo, double hi,
+		  double min_width) );
+STATIC_FUNCTION (void add_count,
+		 (KHistogram histogram, double value, unsigned long count) );
+STATIC_FUNCTION (flag add_values,
+		 (KHistogram histogram, CONST double *values,
+		  unsigned int num_values) );
+STATIC_FUNCTION (flag add_data,
+		 (KHistogram histogram, CONST char *data,
+		  unsigned int elem_type, uaddr stride, CONST uaddr *offsets,
+		  uaddr num_values) );
+STATIC_FUNCTION (flag merge_histograms, (KHistogram dest, KHistogram src) );
+STATIC_FUNCTION (flag fill_histogram, (KHistogram histogram, iarray array) );
+STATIC_FUNCTION (flag fill_units,
+		 (KHistogram histogram, iarray array, flag full_array,
+		  uaddr start, uaddr num_units) );
+STATIC_FUNCTION (void fill_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (flag is_full_array, (iarray array) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+KHistogram iarray_histogram_create (iarray array, unsigned int conv_type,
+				    unsigned long sample_stride)
+/*  [SUMMARY] Create a histogram of an Intelligent Array.
+    [PURPOSE] This routine will build a fine-grained histogram of an
+    Intelligent Array in a single pass over the data. The range of the
+    histogram adapts to the data as it is read, so the data minimum and maximum
+    need not be known beforehand. The histogram may later be re-binned, merged
+    and queried for percentiles without touching the data again.
+    <array> The array. If this is NULL an empty histogram is created, which may
+    be filled with [<iarray_histogram_add_array>].
+    <conv_type> The conversion type to use for complex numbers. See
+    [<DS_COMPLEX_CONVERSIONS>] for legal values. CONV_CtoR_ENVELOPE is not
+    legal.
+    <sample_stride> Only every <<sample_stride>> th value is read. A value of 1
+    reads every value and yields an exact histogram. Larger values yield a
+    quick approximation which may be improved later with
+    [<iarray_histogram_refine>].
+    [NOTE] Values which are TOOBIG or larger in magnitude are ignored.
+    [MT-LEVEL] Safe.
+    [RETURNS] A KHistogram object on success, else NULL.
+*/
+{
+    KHistogram histogram;
+    static char function_name[] = "iarray_histogram_create";
+
+    if (sample_stride < 1)
+    {
+	fprintf (stderr, "Illegal sample_stride: %lu\n", sample_stride);
+	a_prog_bug (function_name);
+    }
+    if ( ( histogram = alloc_histogram (conv_type, sample_stride) ) == NULL )
+    {
+	return (NULL);
+    }
+    if (array == NULL) return (histogram);
+    if ( !fill_histogram (histogram, array) )
+    {
+	iarray_histogram_destroy (histogram);
+	return (NULL);
+    }
+    return (histogram);
+}   /*  End Function iarray_histogram_create  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iarray_histogram_add_array (KHistogram histogram, iarray array)
+/*  [SUMMARY] Add the values of an Intelligent Array to a histogram.
+    [PURPOSE] This routine will add the values of an Intelligent Array to a
+    histogram, using the sample stride of the histogram. This may be used to
+    build the histogram of a cube one plane at a time.
+    <histogram> The histogram.
+    <array> The array.
+    [MT-LEVEL] Unsafe per histogram.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    static char function_name[] = "iarray_histogram_add_array";
+
+    VERIFY_HISTOGRAM (histogram);
+    VERIFY_IARRAY (array);
+    return ( fill_histogram (histogram, array) );
+}   /*  End Function iarray_histogram_add_array  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iarray_histogram_refine (KHistogram histogram, iarray array,
+			      double min, double max)
+/*  [SUMMARY] Rebuild a histogram with full resolution over a range.
+    [PURPOSE] This routine will discard the contents of a histogram and read
+    every value of an Intelligent Array again, binning values between <<min>>
+    and <<max>> into the fine bins. Values outside this range are only counted.
+    This is useful when a view zooms in beyond the resolution of the original
+    histogram, or to replace a sampled histogram with an exact one.
+    <histogram> The histogram.
+    <array> The array. Further arrays may be added with
+    [<iarray_histogram_add_array>].
+    <min> The lower edge of the fine bins.
+    <max> The upper edge of the fine bins.
+    [MT-LEVEL] Unsafe per histogram.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    static char function_name[] = "iarray_histogram_refine";
+
+    VERIFY_HISTOGRAM (histogram);
+    VERIFY_IARRAY (array);
+    if (min >= max)
+    {
+	fprintf (stderr, "min: %e is not less than max: %e\n", min, max);
+	a_prog_bug (function_name);
+    }
+    clear_histogram (histogram);
+    histogram->sample_stride = 1;
+    histogram->fixed_range = TRUE;
+    histogram->first = min;
+    histogram->top = max;
+    histogram->width = (max - min) / (double) NUM_FINE_BINS;
+    return ( fill_histogram (histogram, array) );
+}   /*  End Function iarray_histogram_refine  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iarray_histogram_merge (KHistogram dest, KHistogram src)
+/*  [SUMMARY] Merge one histogram into another.
+    <dest> The histogram to add to. If this is automatically ranged it is
+    extended to cover the values in <<src>>.
+    <src> The histogram to add. This is not modified.
+    [NOTE] Merging two automatically ranged histograms is exact. If either has
+    a fixed range (see [<iarray_histogram_refine>]), values are placed at the
+    centres of the source bins.
+    [MT-LEVEL] Unsafe per histogram.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    static char function_name[] = "iarray_histogram_merge";
+
+    VERIFY_HISTOGRAM (dest);
+    VERIFY_HISTOGRAM (src);
+    if (dest == src)
+    {
+	fprintf (stderr, "Cannot merge histogram with itself\n");
+	a_prog_bug (function_name);
+    }
+    return ( merge_histograms (dest, src) );
+}   /*  End Function iarray_histogram_merge  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void iarray_histogram_get_attributes (KHistogram histogram, ...)
+/*  [SUMMARY] Get the attributes of a histogram.
+    <histogram> The histogram.
+    [VARARGS] The list of parameter attribute-key attribute-value-ptr pairs
+    must follow. This list must be terminated with the IARRAY_HIST_ATT_END.
+    See [<IARRAY_HISTOGRAM_ATTRIBUTES>] for the list of attributes.
+    [MT-LEVEL] Safe.
+    [RETURNS] Nothing.
+*/
+{
+    va_list argp;
+    unsigned int att_key;
+    static char function_name[] = "iarray_histogram_get_attributes";
+
+    VERIFY_HISTOGRAM (histogram);
+    va_start (argp, histogram);
+    while ( ( att_key = va_arg (argp, unsigned int) ) != IARRAY_HIST_ATT_END )
+    {
+	switch (att_key)
+	{
+	  case IARRAY_HIST_ATT_MIN:
+	    *( va_arg (argp, double *) ) = histogram->min;
+	    break;
+	  case IARRAY_HIST_ATT_MAX:
+	    *( va_arg (argp, double *) ) = histogram->max;
+	    break;
+	  case IARRAY_HIST_ATT_NUM_VALUES:
+	    *( va_arg (argp, unsigned long *) ) =
+		histogram->num_values * histogram->sample_stride;
+	    break;
+	  case IARRAY_HIST_ATT_SAMPLE_STRIDE:
+	    *( va_arg (argp, unsigned long *) ) = histogram->sample_stride;
+	    break;
+	  case IARRAY_HIST_ATT_BIN_WIDTH:
+	    *( va_arg (argp, double *) ) = histogram->width;
+	    break;
+	  case IARRAY_HIST_ATT_BINNED_MIN:
+	    *( va_arg (argp, double *) ) = histogram->first;
+	    break;
+	  case IARRAY_HIST_ATT_BINNED_MAX:
+	    *( va_arg (argp, double *) ) = histogram->top;
+	    break;
+	  case IARRAY_HIST_ATT_FIXED_RANGE:
+	    *( va_arg (argp, flag *) ) = histogram->fixed_range;
+	    break;
+	  default:
+	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
+	    a_prog_bug (function_name);
+	    break;
+	}
+    }
+    va_end (argp);
+}   /*  End Function iarray_histogram_get_attributes  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iarray_histogram_rebin (KHistogram histogram, double min, double max,
+			     unsigned long num_bins,
+			     unsigned long *histogram_array,
+			     unsigned long *histogram_peak,
+			     unsigned long *histogram_mode)
+/*  [SUMMARY] Produce a coarse histogram from a histogram object.
+    [PURPOSE] This routine will produce a histogram with the same bin layout
+    as [<iarray_compute_histogram>], without reading the data. Counts are
+    scaled by the sample stride of the histogram. Where an output bin is
+    narrower than the fine bins, counts are shared out in proportion to the
+    overlap.
+    <histogram> The histogram.
+    <min> Data values below this will be ignored.
+    <max> Data values above this will be ignored.
+    <num_bins> The number of histogram bins.
+    <histogram_array> A pointer to the histogram array. The values in this
+    array are updated, and hence must be initialised externally.
+    <histogram_peak> The peak of the histogram is written here. This value is
+    updated, and hence must be externally initialised to 0.
+    <histogram_mode> The mode of the histogram (index value of the peak) will
+    be written here. This value is updated, and hence must be externally
+    initialised to 0.
+    [NOTE] Only the range covered by the fine bins (see
+    [<IARRAY_HISTOGRAM_ATTRIBUTES>]) contributes.
+    [MT-LEVEL] Safe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned long bin_count, out_index, last_index;
+    unsigned long hval, hpeak, hmode;
+    double out_width, bin_lo, bin_hi, lo, hi, pos_lo, pos_hi, seg;
+    double scale, count;
+    double *accum;
+    static char function_name[] = "iarray_histogram_rebin";
+
+    VERIFY_HISTOGRAM (histogram);
+    if ( (histogram_array == NULL) || (histogram_peak == NULL) ||
+	 (histogram_mode == NULL) )
+    {
+	fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
+    }
+    if (min >= max)
+    {
+	fprintf (stderr, "min: %e is not less than max: %e\n", min, max);
+	a_prog_bug (function_name);
+    }
+    if (num_bins < 2)
+    {
+	fprintf (stderr, "num_bins: %lu is less than 2\n", num_bins);
+	a_prog_bug (function_name);
+    }
+    if (histogram->width <= 0.0) return (TRUE);
+    if ( ( accum = (double *) m_alloc (sizeof *accum * num_bins) ) == NULL )
+    {
+	m_error_notify (function_name, "accumulation array");
+	return (FALSE);
+    }
+    m_clear ( (char *) accum, sizeof *accum * num_bins );
+    out_width = (max - min) / (double) (num_bins - 1);
+    scale = (double) histogram->sample_stride / histogram->width;
+    for (bin_count = 0; bin_count < NUM_FINE_BINS; ++bin_count)
+    {
+	if (histogram->bins[bin_count] < 1) continue;
+	bin_lo = histogram->first + (double) bin_count * histogram->width;
+	bin_hi = bin_lo + histogram->width;
+	lo = (bin_lo > min) ? bin_lo : min;
+	hi = (bin_hi < max) ? bin_hi : max;
+	if (lo >= hi) continue;
+	count = (double) histogram->bins[bin_count] * scale;
+	/*  Share the count between the output bins the fine bin overlaps  */
+	pos_lo = (lo - min) / out_width;
+	pos_hi = (hi - min) / out_width;
+	last_index = (unsigned long) pos_hi;
+	if (last_index >= num_bins) last_index = num_bins - 1;
+	for (out_index = (unsigned long) pos_lo; out_index <= last_index;
+	     ++out_index)
+	{
+	    seg = ( (pos_hi < out_index + 1) ? pos_hi : out_index + 1 ) -
+		( (pos_lo > out_index) ? pos_lo : out_index );
+	    if (seg > 0.0) accum[out_index] += count * seg * out_width;
+	}
+    }
+    hpeak = *histogram_peak;
+    hmode = *histogram_mode;
+    for (out_index = 0; out_index < num_bins; ++out_index)
+    {
+	hval = histogram_array[out_index] +
+	    (unsigned long) (accum[out_index] + 0.5);
+	histogram_array[out_index] = hval;
+	if (hval > hpeak)
+	{
+	    hpeak = hval;
+	    hmode = out_index;
+	}
+    }
+    *histogram_peak = hpeak;
+    *histogram_mode = hmode;
+    m_free ( (char *) accum );
+    return (TRUE);
+}   /*  End Function iarray_histogram_rebin  */
+
+/*EXPERIMENTAL_FUNCTION*/
+double iarray_histogram_percentile (KHistogram histogram, double fraction)
+/*  [SUMMARY] Find a percentile of the values in a histogram.
+    [PURPOSE] This routine will find the value below which a given fraction
+    of the values in a histogram lie. Within a fine bin values are assumed to
+    be uniformly distributed. This allows, for example, the 0.5% and 99.5%
+    clip levels of a cube to be found in a single pass over the data.
+    <histogram> The histogram.
+    <fraction> The fraction, in the range 0.0 to 1.0
+    [MT-LEVEL] Safe.
+    [RETURNS] The value at the percentile. If the histogram is empty TOOBIG is
+    returned.
+*/
+{
+    unsigned long bin_count, hval;
+    double total, target, cumulative, value;
+    static char function_name[] = "iarray_histogram_percentile";
+
+    VERIFY_HISTOGRAM (histogram);
+    if (histogram->num_values < 1) return (TOOBIG);
+    if (fraction <= 0.0) return (histogram->min);
+    if (fraction >= 1.0) return (histogram->max);
+    total = (double) histogram->num_values;
+    target = fraction * total;
+    cumulative = (double) histogram->num_below;
+    if (target < cumulative)
+    {
+	/*  Lower tail of a fixed range histogram  */
+	return ( histogram->min +
+		 (histogram->first - histogram->min) * target / cumulative );
+    }
+    for (bin_count = 0; bin_count < NUM_FINE_BINS; ++bin_count)
+    {
+	if ( ( hval = histogram->bins[bin_count] ) < 1 ) continue;
+	if (cumulative + (double) hval >= target)
+	{
+	    value = histogram->first + histogram->width *
+		( (double) bin_count + (target - cumulative) / (double) hval );
+	    if (value < histogram->min) value = histogram->min;
+	    if (value > histogram->max) value = histogram->max;
+	    return (value);
+	}
+	cumulative += (double) hval;
+    }
+    /*  Upper tail of a fixed range histogram  */
+    if (histogram->num_above < 1) return (histogram->max);
+    return ( histogram->top + (histogram->max - histogram->top) *
+	     (target - cumulative) / (double) histogram->num_above );
+}   /*  End Function iarray_histogram_percentile  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void iarray_histogram_destroy (KHistogram histogram)
+/*  [SUMMARY] Destroy a histogram.
+    <histogram> The histogram.
+    [MT-LEVEL] Safe.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "iarray_histogram_destroy";
+
+    VERIFY_HISTOGRAM (histogram);
+    histogram->magic_number = 0;
+    m_free ( (char *) histogram->old_bins );
+    m_free ( (char *) histogram );
+}   /*  End Function iarray_histogram_destroy  */
+
+
+/*  Private functions follow  */
+
+static KHistogram alloc_histogram (unsigned int conv_type,
+				   unsigned long sample_stride)
+/*  [SUMMARY] Allocate an empty, automatically ranged histogram.
+    <conv_type> The conversion type to use for complex numbers.
+    <sample_stride> The sample stride.
+    [RETURNS] The histogram on success, else NULL.
+*/
+{
+    KHistogram histogram;
+    static char function_name[] = "__iarray_histogram_alloc_histogram";
+
+    if ( ( histogram = (KHistogram) m_alloc (sizeof *histogram) ) == NULL )
+    {
+	m_error_notify (function_name, "histogram");
+	return (NULL);
+    }
+    /*  Allocated here, since histograms are re-binned inside pool jobs and
+	m_alloc() may not be called there  */
+    if ( ( histogram->old_bins = (unsigned long *)
+	   m_alloc (sizeof histogram->bins) ) == NULL )
+    {
+	m_error_notify (function_name, "bin copy");
+	m_free ( (char *) histogram );
+	return (NULL);
+    }
+    histogram->magic_number = MAGIC_NUMBER;
+    histogram->conv_type = conv_type;
+    histogram->sample_stride = sample_stride;
+    histogram->fixed_range = FALSE;
+    histogram->first = 0.0;
+    histogram->width = 0.0;
+    histogram->top = 0.0;
+    clear_histogram (histogram);
+    return (histogram);
+}   /*  End Function alloc_histogram  */
+
+static void clear_histogram (KHistogram histogram)
+/*  [SUMMARY] Clear the counts in a histogram.
+    <histogram> The histogram.
+    [RETURNS] Nothing.
+*/
+{
+    histogram->min = TOOBIG;
+    histogram->max = -TOOBIG;
+    histogram->num_values = 0;
+    histogram->num_below = 0;
+    histogram->num_above = 0;
+    m_clear ( (char *) histogram->bins, sizeof histogram->bins );
+}   /*  End Function clear_histogram  */
+
+static flag extend_range (KHistogram histogram, double lo, double hi,
+			  double min_width)
+/*  [SUMMARY] Extend the range of an automatically ranged histogram.
+    [PURPOSE] This routine will make sure the fine bins of an automatically
+    ranged histogram cover a range of values, coarsening the bins if needed.
+    <histogram> The histogram.
+    <lo> The lowest value which must be covered.
+    <hi> The highest value which must be covered.
+    <min_width> The minimum bin width required.
+    [NOTE] This routine is called from pool jobs, so it must not allocate.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int exponent;
+    unsigned long bin_count, index;
+    double width, first, factor, offset, span, mantissa;
+    unsigned long *old_bins = histogram->old_bins;
+
+    if (histogram->width <= 0.0)
+    {
+	/*  First values: use the finest grid which can cover them  */
+	if ( ( span = hi - lo ) <= 0.0 )
+	{
+	    span = (lo == 0.0) ? 1.0 : fabs (lo);
+	}
+	mantissa = frexp ( span / (double) (NUM_FINE_BINS - 1), &exponent );
+	width = (mantissa == 0.5) ? ldexp (1.0, exponent - 1) :
+	    ldexp (1.0, exponent);
+	if (width < min_width) width = min_width;
+	histogram->width = width;
+	histogram->first = floor (lo / width) * width;
+	histogram->top = histogram->first + (double) NUM_FINE_BINS * width;
+    }
+    if ( (lo >= histogram->first) && (hi < histogram->top) &&
+	 (histogram->width >= min_width) ) return (TRUE);
+    if (lo > histogram->first) lo = histogram->first;
+    if (hi < histogram->top) hi = histogram->top;
+    width = histogram->width;
+    do
+    {
+	width *= 2.0;
+	first = floor (lo / width) * width;
+    }
+    while ( (first + (double) NUM_FINE_BINS * width <= hi) ||
+	    (width < min_width) );
+    /*  Each old bin falls entirely within one new bin  */
+    m_copy ( (char *) old_bins, (char *) histogram->bins,
+	     sizeof histogram->bins );
+    m_clear ( (char *) histogram->bins, sizeof histogram->bins );
+    factor = width / histogram->width;
+    offset = (histogram->first - first) / histogram->width;
+    for (bin_count = 0; bin_count < NUM_FINE_BINS; ++bin_count)
+    {
+	if (old_bins[bin_count] < 1) continue;
+	index = (unsigned long) ( (offset + (double) bin_count) / factor );
+	if (index >= NUM_FINE_BINS) index = NUM_FINE_BINS - 1;
+	histogram->bins[index] += old_bins[bin_count];
+    }
+    histogram->width = width;
+    histogram->first = first;
+    histogram->top = first + (double) NUM_FINE_BINS * width;
+    return (TRUE);
+}   /*  End Function extend_range  */
+
+static void add_count (KHistogram histogram, double value,
+		       unsigned long count)
+/*  [SUMMARY] Add a number of instances of a value to a histogram.
+    [PURPOSE] This routine will add a number of instances of a value to a
+    histogram. An automatically ranged histogram must already cover the value.
+    <histogram> The histogram.
+    <value> The value.
+    <count> The number of instances.
+    [RETURNS] Nothing.
+*/
+{
+    double pos;
+    unsigned long index;
+
+    if (count < 1) return;
+    histogram->num_values += count;
+    if (value < histogram->first)
+    {
+	histogram->num_below += count;
+	return;
+    }
+    if (value > histogram->top)
+    {
+	histogram->num_above += count;
+	return;
+    }
+    pos = (value - histogram->first) / histogram->width;
+    index = (unsigned long) pos;
+    if (index >= NUM_FINE_BINS) index = NUM_FINE_BINS - 1;
+    histogram->bins[index] += count;
+}   /*  End Function add_count  */
+
+static flag add_values (KHistogram histogram, CONST double *values,
+			unsigned int num_values)
+/*  [SUMMARY] Add a block of real values to a histogram.
+    <histogram> The histogram.
+    <values> The values. These are stored in every second element (the
+    imaginary components are ignored).
+    <num_values> The number of values.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count, num_valid;
+    unsigned long index;
+    double value, lo, hi, first, top, factor, pos;
+    double toobig = TOOBIG;
+    unsigned long *bins = histogram->bins;
+
+    /*  Find the range of valid values  */
+    lo = toobig;
+    hi = -toobig;
+    for (count = 0, num_valid = 0; count < num_values; ++count)
+    {
+	value = values[count * 2];
+	/*  Written this way so that NaNs are also skipped  */
+	if ( !(value < toobig) || (value <= -toobig) ) continue;
+	++num_valid;
+	if (value < lo) lo = value;
+	if (value > hi) hi = value;
+    }
+    if (num_valid < 1) return (TRUE);
+    if (lo < histogram->min) histogram->min = lo;
+    if (hi > histogram->max) histogram->max = hi;
+    histogram->num_values += num_valid;
+    if ( !histogram->fixed_range )
+    {
+	if ( !extend_range (histogram, lo, hi, 0.0) ) return (FALSE);
+    }
+    first = histogram->first;
+    top = histogram->top;
+    factor = 1.0 / histogram->width;
+    for (count = 0; count < num_values; ++count)
+    {
+	value = values[count * 2];
+	if ( !(value < toobig) || (value <= -toobig) ) continue;
+	if (value < first)
+	{
+	    ++histogram->num_below;
+	    continue;
+	}
+	if (value > top)
+	{
+	    ++histogram->num_above;
+	    continue;
+	}
+	pos = (value - first) * factor;
+	index = (unsigned long) pos;
+	if (index >= NUM_FINE_BINS) index = NUM_FINE_BINS - 1;
+	++bins[index];
+    }
+    return (TRUE);
+}   /*  End Function add_values  */
+
+static flag add_data (KHistogram histogram, CONST char *data,
+		      unsigned int elem_type, uaddr stride,
+		      CONST uaddr *offsets, uaddr num_values)
+/*  [SUMMARY] Add raw data values to a histogram.
+    <histogram> The histogram.
+    <data> The data.
+    <elem_type> The type of the data.
+    <stride> If <<offsets>> is NULL, the stride in bytes between values.
+    <offsets> The address offsets of the values. If NULL, <<stride>> is used.
+    <num_values> The number of values.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag complex = FALSE;
+    unsigned int block_size;
+    double values[2 * BLOCK_SIZE];
+
+    while (num_values > 0)
+    {
+	block_size = (num_values > BLOCK_SIZE) ? BLOCK_SIZE : num_values;
+	if (offsets == NULL)
+	{
+	    if ( !ds_get_elements (data, elem_type, stride, values, &complex,
+				   block_size) ) return (FALSE);
+	    data += stride * block_size;
+	}
+	else
+	{
+	    if ( !ds_get_scattered_elements (data, elem_type, offsets, values,
+					     &complex, block_size) )
+	    {
+		return (FALSE);
+	    }
+	    offsets += block_size;
+	}
+	if (complex) ds_complex_to_real_1D (values, 2, values, block_size,
+					    histogram->conv_type);
+	if ( !add_values (histogram, values, block_size) ) return (FALSE);
+	num_values -= block_size;
+    }
+    return (TRUE);
+}   /*  End Function add_data  */
+
+static flag merge_histograms (KHistogram dest, KHistogram src)
+/*  [SUMMARY] Merge one histogram into another.
+    <dest> The histogram to add to.
+    <src> The histogram to add.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag same_stride;
+    unsigned long bin_count, count;
+    double scale, value;
+
+    if (src->num_values < 1) return (TRUE);
+    if ( !dest->fixed_range )
+    {
+	if ( !extend_range (dest, src->min, src->max,
+			    src->fixed_range ? 0.0 : src->width) )
+	{
+	    return (FALSE);
+	}
+    }
+    if (src->min < dest->min) dest->min = src->min;
+    if (src->max > dest->max) dest->max = src->max;
+    same_stride = (src->sample_stride == dest->sample_stride) ? TRUE : FALSE;
+    scale = (double) src->sample_stride / (double) dest->sample_stride;
+    for (bin_count = 0; bin_count < NUM_FINE_BINS; ++bin_count)
+    {
+	if ( ( count = src->bins[bin_count] ) < 1 ) continue;
+	if (!same_stride) count = (unsigned long) ( (double) count * scale +0.5);
+	/*  Bins are represented by their centres, kept within the data range  */
+	value = src->first + ( (double) bin_count + 0.5 ) * src->width;
+	if (value < src->min) value = src->min;
+	if (value > src->max) value = src->max;
+	add_count (dest, value, count);
+    }
+    /*  Tails of a fixed range source are placed at its extremes  */
+    count = src->num_below;
+    if (!same_stride) count = (unsigned long) ( (double) count * scale + 0.5);
+    add_count (dest, src->min, count);
+    count = src->num_above;
+    if (!same_stride) count = (unsigned long) ( (double) count * scale + 0.5);
+    add_count (dest, src->max, count);
+    return (TRUE);
+}   /*  End Function merge_histograms  */
+
+static flag fill_histogram (KHistogram histogram, iarray array)
+/*  [SUMMARY] Add the values of an Intelligent Array to a histogram.
+    [PURPOSE] This routine will add the (sampled) values of an Intelligent
+    Array to a histogram. The work is shared between the threads of the shared
+    thread pool, each building a private histogram which is merged at the end.
+    <histogram> The histogram.
+    <array> The array.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KThreadPool pool;
+    fill_info_type info;
+    unsigned int num_dim, dim_count, num_jobs, job_count;
+    uaddr num_units, unit_values, start, block_size;
+    KHistogram *job_hists;
+    static char function_name[] = "__iarray_histogram_fill_histogram";
+
+    num_dim = iarray_num_dim (array);
+    info.array = array;
+    info.full_array = is_full_array (array);
+    info.failed = FALSE;
+    /*  A unit of work is a sampled value for a full array, else a row  */
+    if (info.full_array)
+    {
+	num_units = ds_get_array_size (array->arr_desc);
+	num_units = (num_units + histogram->sample_stride - 1) /
+	    histogram->sample_stride;
+	unit_values = 1;
+    }
+    else
+    {
+	for (dim_count = 0, num_units = 1; dim_count + 1 < num_dim;
+	     ++dim_count) num_units *= array->lengths[dim_count];
+	unit_values = array->lengths[num_dim - 1] / histogram->sample_stride;
+	if (unit_values < 1) unit_values = 1;
+    }
+    pool = mt_get_shared_pool ();
+    num_jobs = mt_num_threads (pool);
+    if (num_units * unit_values / MIN_JOB_VALUES < num_jobs)
+    {
+	num_jobs = num_units * unit_values / MIN_JOB_VALUES;
+    }
+    if (num_jobs > num_units) num_jobs = num_units;
+    if (num_jobs < 2)
+    {
+	return ( fill_units (histogram, array, info.full_array,
+			     0, num_units) );
+    }
+    /*  Each job needs its own histogram  */
+    if ( ( job_hists = (KHistogram *) m_alloc (sizeof *job_hists * num_jobs) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "array of job histograms");
+	return (FALSE);
+    }
+    for (job_count = 0; job_count < num_jobs; ++job_count)
+    {
+	if ( ( job_hists[job_count] =
+	       alloc_histogram (histogram->conv_type,
+				histogram->sample_stride) ) == NULL )
+	{
+	    while (job_count > 0)
+	    {
+		iarray_histogram_destroy (job_hists[--job_count]);
+	    }
+	    m_free ( (char *) job_hists );
+	    return (FALSE);
+	}
+	if (histogram->fixed_range)
+	{
+	    job_hists[job_count]->fixed_range = TRUE;
+	    job_hists[job_count]->first = histogram->first;
+	    job_hists[job_count]->width = histogram->width;
+	    job_hists[job_count]->top = histogram->top;
+	}
+    }
+    block_size = num_units / num_jobs;
+    for (job_count = 0, start = 0; job_count < num_jobs;
+	 ++job_count, start += block_size)
+    {
+	if (job_count + 1 == num_jobs) block_size = num_units - start;
+	mt_launch_job (pool, fill_job_func, &info, job_hists[job_count],
+		       (void *) start, (void *) block_size);
+    }
+    mt_wait_for_all_jobs (pool);
+    for (job_count = 0; job_count < num_jobs; ++job_count)
+    {
+	if ( !info.failed && !merge_histograms (histogram,
+						  job_hists[job_count]) )
+	{
+	    info.failed = TRUE;
+	}
+	iarray_histogram_destroy (job_hists[job_count]);
+    }
+    m_free ( (char *) job_hists );
+    return (info.failed ? FALSE : TRUE);
+}   /*  End Function fill_histogram  */
+
+static void fill_job_func (void *pool_info,
+			   void *call_info1, void *call_info2,
+			   void *call_info3, void *call_info4,
+			   void *thread_info)
+/*  [SUMMARY] Perform a histogram filling job.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The fill information.
+    <call_info2> The private histogram for the job.
+    <call_info3> The first unit of work.
+    <call_info4> The number of units of work.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    fill_info_type *info = (fill_info_type *) call_info1;
+
+    if ( !fill_units ( (KHistogram) call_info2, info->array, info->full_array,
+		       (uaddr) call_info3, (uaddr) call_info4 ) )
+    {
+	info->failed = TRUE;
+    }
+}   /*  End Function fill_job_func  */
+
+static flag fill_units (KHistogram histogram, iarray array, flag full_array,
+			uaddr start, uaddr num_units)
+/*  [SUMMARY] Add some of the values of an Intelligent Array to a histogram.
+    <histogram> The histogram.
+    <array> The array.
+    <full_array> If TRUE the array is the same size as the underlying array
+    and the units are sampled values, else the units are rows.
+    <start> The first unit.
+    <num_units> The number of units.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int num_dim, elem_type;
+    int dim_count;
+    uaddr row, coord, row_length, stride, index, num_offsets;
+    uaddr sample_stride = histogram->sample_stride;
+    CONST char *data;
+    CONST uaddr *row_offsets;
+    uaddr offsets[BLOCK_SIZE];
+
+    elem_type = iarray_type (array);
+    if (full_array)
+    {
+	stride = ds_get_packet_size (array->arr_desc->packet);
+	return ( add_data (histogram,
+			   array->data + start * sample_stride * stride,
+			   elem_type, stride * sample_stride, NULL,
+			   num_units) );
+    }
+    num_dim = iarray_num_dim (array);
+    row_length = array->lengths[num_dim - 1];
+    row_offsets = array->offsets[num_dim - 1];
+    for (row = start; row < start + num_units; ++row)
+    {
+	/*  Find the start of the row  */
+	data = array->data;
+	for (dim_count = (int) num_dim - 2, coord = row; dim_count >= 0;
+	     --dim_count)
+	{
+	    data += array->offsets[dim_count][coord %array->lengths[dim_count]];
+	    coord /= array->lengths[dim_count];
+	}
+	if (sample_stride < 2)
+	{
+	    if ( !add_data (histogram, data, elem_type, 0, row_offsets,
+			    row_length) ) return (FALSE);
+	    continue;
+	}
+	/*  Sample every <<sample_stride>> th value counting across rows  */
+	index = (row * row_length) % sample_stride;
+	if (index > 0) index = sample_stride - index;
+	while (index < row_length)
+	{
+	    for (num_offsets = 0;
+		 (num_offsets < BLOCK_SIZE) && (index < row_length);
+		 ++num_offsets, index += sample_stride)
+	    {
+		offsets[num_offsets] = row_offsets[index];
+	    }
+	    if ( !add_data (histogram, data, elem_type, 0, offsets,
+			    num_offsets) ) return (FALSE);
+	}
+    }
+    return (TRUE);
+}   /*  End Function fill_units  */
+
+static flag is_full_array (iarray array)
+/*  [SUMMARY] Test if iarray is the same size as the underlying array.
+    <array> The Intelligent Array.
+    [RETURNS] TRUE if the Intelligent Array is the same size, else FALSE.
+*/
+{
+    unsigned int count;
+
+    if (iarray_num_dim (array) != array->arr_desc->num_dimensions)
+	return (FALSE);
+    for (count = 0; count < iarray_num_dim (array); ++count)
+    {
+	if (array->lengths[count] !=
+	    array->arr_desc->dimensions[count]->length) return (FALSE);
+    }
+    return (TRUE);
+}   /*  End Function is_full_array  */
@@ -0,0 +1,418 @@
+/*LINTLIBRARY*/
+/*  moments.c
+
+    This code provides moment map generation for Intelligent Arrays.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains all routines needed to compute moment maps of cubes
+  stored in Intelligent Arrays.
+
+
+*/
+#include <stdio.h>
+#include <math.h>
+#include <karma.h>
+#include <karma_iarray.h>
+#include <karma_ds.h>
+#include <karma_mt.h>
+#include <karma_a.h>
+#include <karma_m.h>
+
+
+#define TILE_PIXELS 4096
+
+#define VERIFY_IARRAY(array) if (array == NULL) \
+{(void) fprintf (stderr, "NULL iarray passed\n"); \
+ a_prog_bug (function_name); }
+
+
+/*  Structure declarations follow  */
+
+typedef struct
+{
+    iarray cube;
+    iarray mom0;
+    iarray mom1;
+    iarray mom2;
+    iarray peak;
+    iarray median;
+    CONST double *velocities;
+    double lower_clip;
+    double sum_clip;
+    unsigned int xlen;
+    unsigned int ylen;
+    unsigned int zlen;
+    unsigned int tile_xlen;
+    unsigned int tile_ylen;
+    unsigned int num_xtiles;
+    unsigned int num_tiles;
+    unsigned int num_jobs;
+} moment_info_type;
+
+
+/*  Private functions  */
+STATIC_FUNCTION (void moment_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (void compute_tile,
+		 (moment_info_type *info, unsigned int tile, double *buffer) );
+STATIC_FUNCTION (void check_map, (iarray map, iarray cube, char *func_name) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iarray_compute_moments (iarray cube, iarray mom0, iarray mom1,
+			     iarray mom2, iarray peak, iarray median,
+			     CONST double *velocities,
+			     double lower_clip, double sum_clip)
+/*  [SUMMARY] Compute moment maps along the first axis of a cube.
+    [PURPOSE] This routine will compute the moments along the first (Z or
+    velocity) axis of a 3-dimensional Intelligent Array. The cube is read
+    plane by plane over tiles of the moment maps, and the tiles are shared
+    between the threads of the shared thread pool.
+    <cube> The cube. This must be of type K_FLOAT.
+    <mom0> The 0th moment (sum) map is written here. If this is NULL it is not
+    computed.
+    <mom1> The 1st moment (intensity weighted mean velocity) map is written
+    here. If this is NULL it is not computed.
+    <mom2> The 2nd moment (intensity weighted velocity dispersion) map is
+    written here. If this is NULL it is not computed.
+    <peak> The peak value map is written here. If this is NULL it is not
+    computed.
+    <median> The median velocity map is written here. This is the velocity at
+    which the running sum reaches half the 0th moment, interpolating within
+    the channel. If this is NULL it is not computed.
+    [NOTE] The maps must be 2-dimensional arrays of type K_FLOAT with the same
+    lengths as the last two dimensions of the cube.
+    <velocities> The velocity of each channel (plane). If this is NULL the
+    co-ordinates of the first dimension of the cube are used.
+    <lower_clip> Cube values below this are ignored. Pixels where the 0th
+    moment is below this are blanked in all maps.
+    <sum_clip> Pixels where the 0th moment is below this are blanked in the
+    1st moment, 2nd moment and median velocity maps.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KThreadPool pool;
+    unsigned int count, job_count;
+    double *coords = NULL;
+    double **buffers;
+    moment_info_type info;
+    static char function_name[] = "iarray_compute_moments";
+
+    VERIFY_IARRAY (cube);
+    if (iarray_num_dim (cube) != 3)
+    {
+	(void) fprintf (stderr, "Cube must have 3 dimensions\n");
+	a_prog_bug (function_name);
+    }
+    if (iarray_type (cube) != K_FLOAT)
+    {
+	(void) fprintf (stderr, "Cube must be of type K_FLOAT\n");
+	a_prog_bug (function_name);
+    }
+    check_map (mom0, cube, function_name);
+    check_map (mom1, cube, function_name);
+    check_map (mom2, cube, function_name);
+    check_map (peak, cube, function_name);
+    check_map (median, cube, function_name);
+    info.cube = cube;
+    info.mom0 = mom0;
+    info.mom1 = mom1;
+    info.mom2 = mom2;
+    info.peak = peak;
+    info.median = median;
+    info.lower_clip = lower_clip;
+    info.sum_clip = sum_clip;
+    info.xlen = iarray_dim_length (cube, 2);
+    info.ylen = iarray_dim_length (cube, 1);
+    info.zlen = iarray_dim_length (cube, 0);
+    if (velocities == NULL)
+    {
+	/*  Precompute the channel to velocity table  */
+	if ( ( coords = (double *) m_alloc (sizeof *coords * info.zlen) )
+	     == NULL )
+	{
+	    m_error_notify (function_name, "velocity table");
+	    return (FALSE);
+	}
+	for (count = 0; count < info.zlen; ++count)
+	{
+	    coords[count] = iarray_get_coordinate (cube, 0, count);
+	}
+	velocities = coords;
+    }
+    info.velocities = velocities;
+    /*  Tiles span whole lines where possible  */
+    info.tile_xlen = (info.xlen < TILE_PIXELS) ? info.xlen : TILE_PIXELS;
+    info.tile_ylen = TILE_PIXELS / info.tile_xlen;
+    info.num_xtiles = (info.xlen + info.tile_xlen - 1) / info.tile_xlen;
+    info.num_tiles = info.num_xtiles *
+	( (info.ylen + info.tile_ylen - 1) / info.tile_ylen );
+    pool = mt_get_shared_pool ();
+    info.num_jobs = mt_num_threads (pool);
+    if (info.num_jobs > info.num_tiles) info.num_jobs = info.num_tiles;
+    /*  Each job needs its own accumulators  */
+    if ( ( buffers = (double **) m_alloc (sizeof *buffers * info.num_jobs) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "array of buffer pointers");
+	if (coords != NULL) m_free ( (char *) coords );
+	return (FALSE);
+    }
+    for (job_count = 0; job_count < info.num_jobs; ++job_count)
+    {
+	if ( ( buffers[job_count] = (double *)
+	       m_alloc (sizeof **buffers * 5 * TILE_PIXELS) ) == NULL )
+	{
+	    m_error_notify (function_name, "tile accumulators");
+	    while (job_count > 0) m_free ( (char *) buffers[--job_count] );
+	    m_free ( (char *) buffers );
+	    if (coords != NULL) m_free ( (char *) coords );
+	    return (FALSE);
+	}
+    }
+    for (job_count = 0; job_count < info.num_jobs; ++job_count)
+    {
+	mt_launch_job (pool, moment_job_func, &info, buffers[job_count],
+		       (void *) (uaddr) job_count, NULL);
+    }
+    mt_wait_for_all_jobs (pool);
+    for (job_count = 0; job_count < info.num_jobs; ++job_count)
+    {
+	m_free ( (char *) buffers[job_count] );
+    }
+    m_free ( (char *) buffers );
+    if (coords != NULL) m_free ( (char *) coords );
+    return (TRUE);
+}   /*  End Function iarray_compute_moments  */
+
+
+/*  Private functions follow  */
+
+static void moment_job_func (void *pool_info,
+			     void *call_info1, void *call_info2,
+			     void *call_info3, void *call_info4,
+			     void *thread_info)
+/*  [SUMMARY] Perform a moment map job.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The moment information.
+    <call_info2> The accumulators for the job.
+    <call_info3> The job number. The job computes every tile whose number
+    modulo the number of jobs is the job number.
+    <call_info4> Not used.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    moment_info_type *info = (moment_info_type *) call_info1;
+    unsigned int tile;
+
+    for (tile = (uaddr) call_info3; tile < info->num_tiles;
+	 tile += info->num_jobs)
+    {
+	compute_tile (info, tile, (double *) call_info2);
+    }
+}   /*  End Function moment_job_func  */
+
+static void compute_tile (moment_info_type *info, unsigned int tile,
+			  double *buffer)
+/*  [SUMMARY] Compute the moment maps for a tile.
+    [PURPOSE] This routine will compute the moment maps for one tile, reading
+    the cube one plane at a time so that the innermost loop runs along lines.
+    <info> The moment information.
+    <tile> The tile number.
+    <buffer> The accumulators. There must be space for 5 * TILE_PIXELS values.
+    [RETURNS] Nothing.
+*/
+{
+    iarray cube = info->cube;
+    unsigned int x, y, z, xstart, ystart, xend, yend, tile_xlen, index;
+    unsigned int channel;
+    double val, velocity, sum, half, mean, variance, findex;
+    CONST char *line;
+    float *out;
+    double *sum0 = buffer;
+    double *sum1 = buffer + TILE_PIXELS;
+    double *sum2 = buffer + 2 * TILE_PIXELS;
+    double *peak = buffer + 3 * TILE_PIXELS;
+    double *cumulative = buffer + 4 * TILE_PIXELS;
+    CONST double *velocities = info->velocities;
+    uaddr *xoffsets = cube->offsets[2];
+    double lower_clip = info->lower_clip;
+    double toobig = TOOBIG;
+
+    xstart = (tile % info->num_xtiles) * info->tile_xlen;
+    ystart = (tile / info->num_xtiles) * info->tile_ylen;
+    xend = xstart + info->tile_xlen;
+    if (xend > info->xlen) xend = info->xlen;
+    yend = ystart + info->tile_ylen;
+    if (yend > info->ylen) yend = info->ylen;
+    tile_xlen = xend - xstart;
+    for (index = 0; index < (yend - ystart) * tile_xlen; ++index)
+    {
+	sum0[index] = 0.0;
+	sum1[index] = 0.0;
+	sum2[index] = 0.0;
+	peak[index] = -toobig;
+    }
+    /*  Accumulate the moments, one plane at a time  */
+    for (z = 0; z < info->zlen; ++z)
+    {
+	velocity = velocities[z];
+	for (y = ystart, index = 0; y < yend; ++y)
+	{
+	    line = cube->data + cube->offsets[0][z] + cube->offsets[1][y];
+	    for (x = xstart; x < xend; ++x, ++index)
+	    {
+		val = *(float *) (line + xoffsets[x]);
+		if ( (val >= toobig) || (val < lower_clip) ) continue;
+		sum0[index] += val;
+		sum1[index] += val * velocity;
+		sum2[index] += val * velocity * velocity;
+		if (val > peak[index]) peak[index] = val;
+	    }
+	}
+    }
+    /*  Write the maps  */
+    for (y = ystart, index = 0; y < yend; ++y)
+    {
+	for (x = xstart; x < xend; ++x, ++index)
+	{
+	    sum = sum0[index];
+	    if (info->mom0 != NULL)
+	    {
+		out = (float *) (info->mom0->data + info->mom0->offsets[0][y] +
+				 info->mom0->offsets[1][x]);
+		*out = (sum < lower_clip) ? toobig : sum;
+	    }
+	    if (info->peak != NULL)
+	    {
+		out = (float *) (info->peak->data + info->peak->offsets[0][y] +
+				 info->peak->offsets[1][x]);
+		*out = ( (sum < lower_clip) || (peak[index] <= -toobig) ) ?
+		    toobig : peak[index];
+	    }
+	    if ( (sum < lower_clip) || (sum < info->sum_clip) || (sum == 0.0) )
+	    {
+		mean = toobig;
+		variance = toobig;
+	    }
+	    else
+	    {
+		mean = sum1[index] / sum;
+		variance = sum2[index] / sum - mean * mean;
+		if (variance < 0.0) variance = 0.0;
+	    }
+	    if (info->mom1 != NULL)
+	    {
+		out = (float *) (info->mom1->data + info->mom1->offsets[0][y] +
+				 info->mom1->offsets[1][x]);
+		*out = mean;
+	    }
+	    if (info->mom2 != NULL)
+	    {
+		out = (float *) (info->mom2->data + info->mom2->offsets[0][y] +
+				 info->mom2->offsets[1][x]);
+		*out = (variance >= toobig) ? toobig : sqrt (variance);
+	    }
+	}
+    }
+    if (info->median == NULL) return;
+    /*  Second pass for the median velocity: blank until the running sum
+	reaches half the 0th moment  */
+    for (y = ystart, index = 0; y < yend; ++y)
+    {
+	for (x = xstart; x < xend; ++x, ++index)
+	{
+	    cumulative[index] = 0.0;
+	    out = (float *) (info->median->data +
+			     info->median->offsets[0][y] +
+			     info->median->offsets[1][x]);
+	    *out = toobig;
+	    /*  Pixels which will stay blank are marked as done  */
+	    sum = sum0[index];
+	    if ( (sum < lower_clip) || (sum < info->sum_clip) || (sum <= 0.0) )
+	    {
+		cumulative[index] = -1.0;
+	    }
+	}
+    }
+    for (z = 0; z < info->zlen; ++z)
+    {
+	for (y = ystart, index = 0; y < yend; ++y)
+	{
+	    line = cube->data + cube->offsets[0][z] + cube->offsets[1][y];
+	    for (x = xstart; x < xend; ++x, ++index)
+	    {
+		if (cumulative[index] < 0.0) continue;
+		val = *(float *) (line + xoffsets[x]);
+		if ( (val >= toobig) || (val < lower_clip) ) continue;
+		cumulative[index] += val;
+		half = sum0[index] * 0.5;
+		if (cumulative[index] < half) continue;
+		/*  Interpolate within the channel and in the velocity table  */
+		findex = (double) z + (half - cumulative[index] + val) / val -
+		    0.5;
+		if (findex < 0.0) findex = 0.0;
+		else if (findex > info->zlen - 1) findex = info->zlen - 1;
+		channel = (unsigned int) findex;
+		velocity = velocities[channel];
+		if (channel + 1 < info->zlen)
+		{
+		    velocity += (findex - channel) *
+			(velocities[channel + 1] - velocity);
+		}
+		out = (float *) (info->median->data +
+				 info->median->offsets[0][y] +
+				 info->median->offsets[1][x]);
+		*out = velocity;
+		cumulative[index] = -1.0;
+	    }
+	}
+    }
+}   /*  End Function compute_tile  */
+
+static void check_map (iarray map, iarray cube, char *func_name)
+/*  [SUMMARY] Check that a moment map is compatible with a cube.
+    <map> The moment map. If this is NULL nothing is checked.
+    <cube> The cube.
+    <func_name> The name of the calling function.
+    [RETURNS] Nothing. On failure the process aborts.
+*/
+{
+    if (map == NULL) return;
+    if ( (iarray_num_dim (map) != 2) || (iarray_type (map) != K_FLOAT) )
+    {
+	(void) fprintf (stderr, "Moment maps must be 2-dimensional K_FLOAT\n");
+	a_prog_bug (func_name);
+    }
+    if ( (iarray_dim_length (map, 0) != iarray_dim_length (cube, 1)) ||
+	 (iarray_dim_length (map, 1) != iarray_dim_length (cube, 2)) )
+    {
+	(void) fprintf (stderr, "Moment map size does not match cube\n");
+	a_prog_bug (func_name);
+    }
+}   /*  End Function check_map  */
@@ -104,12 +104,25 @@ struct instruction_list_type
     void (*process_loss) ();
     void (*process_apply) ();
     Channel master;
+    edit_instruction *compiled;
+    unsigned int num_compiled;
+    unsigned int num_allocated;
+    unsigned int num_drawn;
 };
 
 /*  Private data  */
 static packet_desc *instruction_desc = NULL;
 static packet_desc *coord_list_desc = NULL;
 static unsigned int edit_coord_list_index = 0;
+static unsigned int coord_list_offset = 0;
+static unsigned int code_offset = 0;
+static unsigned int code_type = NONE;
+static unsigned int value_offset = 0;
+static unsigned int value_type = NONE;
+static unsigned int abscissa_offset = 0;
+static unsigned int abscissa_type = NONE;
+static unsigned int ordinate_offset = 0;
+static unsigned int ordinate_type = NONE;
 static KImageEditList masterable_list = NULL;
 static KImageEditList slaveable_list = NULL;
 static char *str_instruction_desc[] =
@@ -157,6 +170,10 @@ static void register_master_loss (/* connection, info */);
 static flag process_local_instruction (/* ilist, instruction */);
 static flag transmit_to_slaves (/* ilist, instruction */);
 static flag write_list (/* channel, list_desc, list_head */);
+static void find_element (/* pack_desc, name, offset, type */);
+static flag extract_coords (/* list_head, coords */);
+static flag compile_instruction (/* ilist, instruction */);
+static void free_compiled (/* ilist, first */);
 
 
 /*PUBLIC_FUNCTION*/
@@ -200,6 +217,10 @@ KImageEditList iedit_create_list (void (*add_func) (), void (*loss_func) (),
     (*ilist).process_loss = loss_func;
     (*ilist).process_apply = apply_func;
     (*ilist).master = NULL;
+    (*ilist).compiled = NULL;
+    (*ilist).num_compiled = 0;
+    (*ilist).num_allocated = 0;
+    (*ilist).num_drawn = 0;
     if (masterable_list == NULL) masterable_list = ilist;
     if (slaveable_list == NULL) slaveable_list = ilist;
     return (ilist);
@@ -262,40 +283,10 @@ flag iedit_get_edit_coords (list_header *list_head, edit_coord **coords)
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    unsigned int abscissa_type;
-    unsigned int ordinate_type;
-    unsigned int abscissa_offset;
-    unsigned int ordinate_offset;
-    unsigned int elem_index;
-    unsigned int coord_count;
-    unsigned int pack_size;
-    double value[2];
-    char *data;
-    list_entry *curr_entry;
     edit_coord *coord_array;
-    extern packet_desc *coord_list_desc;
     static char function_name[] = "iedit_get_edit_coords";
 
-    /*  Get abscissa info  */
-    if ( ( elem_index = ds_f_elem_in_packet (coord_list_desc,
-					     "Edit Object Abscissa") )
-	>= (*coord_list_desc).num_elements )
-    {
-	(void) fprintf (stderr, "Error finding edit abscissa location\n");
-	a_prog_bug (function_name);
-    }
-    abscissa_type = (*coord_list_desc).element_types[elem_index];
-    abscissa_offset = ds_get_element_offset (coord_list_desc, elem_index);
-    /*  Get ordinate info  */
-    if ( ( elem_index = ds_f_elem_in_packet (coord_list_desc,
-					     "Edit Object Ordinate") )
-	>= (*coord_list_desc).num_elements )
-    {
-	(void) fprintf (stderr, "Error finding edit ordinate location\n");
-	a_prog_bug (function_name);
-    }
-    ordinate_type = (*coord_list_desc).element_types[elem_index];
-    ordinate_offset = ds_get_element_offset (coord_list_desc, elem_index);
+    initialise_iedit_package ();
     /*  Get co-ordinate array  */
     if ( ( coord_array =
 	  iedit_alloc_edit_coords ( (unsigned int) (*list_head).length ) )
@@ -304,43 +295,7 @@ flag iedit_get_edit_coords (list_header *list_head, edit_coord **coords)
 	m_error_notify (function_name, "array of edit co-ordinates");
 	return (FALSE);
     }
-    /*  Now extract co-ordinates  */
-    pack_size = ds_get_packet_size (coord_list_desc);
-    for (coord_count = 0, curr_entry = (*list_head).first_frag_entry,
-	 data = (*list_head).contiguous_data;
-	 coord_count < (*list_head).length;
-	 ++coord_count)
-    {
-	if (coord_count >= (*list_head).contiguous_length)
-	{
-	    /*  Fragmented section of list  */
-	    data = (*curr_entry).data;
-	}
-	if (ds_get_element (abscissa_offset + data,
-			    abscissa_type, value, (flag *) NULL) != TRUE)
-	{
-	    (void) fprintf (stderr, "Error getting edit abscissa value\n");
-	    return (FALSE);
-	}
-	coord_array[coord_count].abscissa = value[0];
-	if (ds_get_element (ordinate_offset + data,
-			    ordinate_type, value, (flag *) NULL) != TRUE)
-	{
-	    (void) fprintf (stderr, "Error getting edit ordinate value\n");
-	    return (FALSE);
-	}
-	coord_array[coord_count].ordinate = value[0];
-	if (coord_count < (*list_head).contiguous_length)
-	{
-	    /*  Contiguous section of list  */
-	    data += pack_size;
-	}
-	else
-	{
-	    /*  Fragmented section of list  */
-	    curr_entry = (*curr_entry).next;
-	}
-    }
+    if ( !extract_coords (list_head, coord_array) ) return (FALSE);
     *coords = coord_array;
     return (TRUE);
 }   /*  End Function iedit_get_edit_coords  */
@@ -368,7 +323,15 @@ flag iedit_add_instruction (KImageEditList ilist,
     char *coord_data;
     list_header *coord_list_head;
     list_entry *instruction;
-    extern unsigned int edit_coord_list_index;
+    extern unsigned int coord_list_offset;
+    extern unsigned int code_offset;
+    extern unsigned int code_type;
+    extern unsigned int value_offset;
+    extern unsigned int value_type;
+    extern unsigned int abscissa_offset;
+    extern unsigned int abscissa_type;
+    extern unsigned int ordinate_offset;
+    extern unsigned int ordinate_type;
     extern packet_desc *instruction_desc;
     extern packet_desc *coord_list_desc;
     static char function_name[] = "iedit_add_instruction";
@@ -382,10 +345,8 @@ flag iedit_add_instruction (KImageEditList ilist,
 	return (FALSE);
     }
     /*  Set up co-ordinate list info  */
-    coord_list_head = ( *(list_header **)
-		       ( (*instruction).data +
-			ds_get_element_offset (instruction_desc,
-					       edit_coord_list_index) ) );
+    coord_list_head = *(list_header **) ( (*instruction).data +
+					   coord_list_offset );
     (*coord_list_head).sort_type = SORT_RANDOM;
     /*  Allocate co-ordinate list  */
     if (ds_alloc_contiguous_list (coord_list_desc, coord_list_head,
@@ -397,46 +358,25 @@ flag iedit_add_instruction (KImageEditList ilist,
 	m_free ( (char *) instruction );
 	return (FALSE);
     }
-    /*  Put instruction information into entry  */
+    /*  Put instruction and intensity information into entry  */
     value[0] = instruction_code;
-    if (ds_put_named_element (instruction_desc, (*instruction).data,
-			      "Edit Instruction", value) != TRUE)
-    {
-	ds_dealloc_data (instruction_desc, (*instruction).data);
-	m_free ( (char *) instruction );
-	return (FALSE);
-    }
-    /*  Put intensity information into entry  */
-    if (ds_put_named_element (instruction_desc, (*instruction).data,
-			      "Edit Object Value", intensity) != TRUE)
-    {
-	ds_dealloc_data (instruction_desc, (*instruction).data);
-	m_free ( (char *) instruction );
-	return (FALSE);
-    }
+    value[1] = 0.0;
+    (void) ds_put_element ( (*instruction).data + code_offset, code_type,
+			    value );
+    (void) ds_put_element ( (*instruction).data + value_offset, value_type,
+			    intensity );
     /*  Put co-ordinates into list  */
     coord_pack_size = ds_get_packet_size (coord_list_desc);
-    value[1] = 0.0;
     for (coord_count = 0, coord_data = (*coord_list_head).contiguous_data;
 	 coord_count < num_coords;
 	 ++coord_count, coord_data += coord_pack_size)
     {
 	value[0] = coords[coord_count].abscissa;
-	if (ds_put_named_element (coord_list_desc, coord_data,
-				  "Edit Object Abscissa", value) != TRUE)
-	{
-	    ds_dealloc_data (instruction_desc, (*instruction).data);
-	    m_free ( (char *) instruction );
-	    return (FALSE);
-	}
+	(void) ds_put_element (coord_data + abscissa_offset, abscissa_type,
+			       value);
 	value[0] = coords[coord_count].ordinate;
-	if (ds_put_named_element (coord_list_desc, coord_data,
-				  "Edit Object Ordinate", value) != TRUE)
-	{
-	    ds_dealloc_data (instruction_desc, (*instruction).data);
-	    m_free ( (char *) instruction );
-	    return (FALSE);
-	}
+	(void) ds_put_element (coord_data + ordinate_offset, ordinate_type,
+			       value);
     }
     /*  Now process instruction entry  */
     if ( (*ilist).master != NULL )
@@ -577,6 +517,141 @@ void iedit_make_list_default_slave (KImageEditList ilist)
     slaveable_list = ilist;
 }   /*  End Function iedit_make_list_default_slave  */
 
+/*EXPERIMENTAL_FUNCTION*/
+CONST edit_instruction *iedit_get_instructions (KImageEditList ilist,
+						unsigned int *num_instructions)
+/*  [SUMMARY] Get the compiled instructions in an image edit list.
+    [PURPOSE] This routine will get the compiled (binary) form of the edit
+    instructions in a managed image edit instruction list. The compiled form
+    holds the same information as the list returned by [<iedit_get_list>],
+    in the same order, but does not require the instruction packets to be
+    decoded.
+    <ilist> The managed list.
+    <num_instructions> The number of instructions is written here.
+    [NOTE] The array is only valid until the next instruction is added to or
+    removed from the list.
+    [RETURNS] A pointer to the array of compiled instructions. This may be NULL
+    if there are no instructions.
+*/
+{
+    static char function_name[] = "iedit_get_instructions";
+
+    VERIFY_ILIST (ilist);
+    *num_instructions = (*ilist).num_compiled;
+    return ( (*ilist).compiled );
+}   /*  End Function iedit_get_instructions  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag iedit_draw_pending (KImageEditList ilist, char *array,
+			 unsigned int elem_type,
+			 CONST dim_desc *abs_dim_desc, unsigned int abs_stride,
+			 CONST dim_desc *ord_dim_desc, unsigned int ord_stride,
+			 CONST edit_instruction **drawn,
+			 unsigned int *num_drawn)
+/*  [SUMMARY] Draw new edit instructions into a 2-dimensional array.
+    [PURPOSE] This routine will draw those instructions in a managed image
+    edit instruction list which have not yet been drawn by this routine. Each
+    call only rasterises the instructions added since the previous call, so
+    the cost of interactive editing is proportional to the area painted rather
+    than the size of the array or the length of the list.
+    <ilist> The managed list.
+    <array> The start of the array.
+    <elem_type> The type of the array elements.
+    <abs_dim_desc> The abscissa dimension descriptor.
+    <abs_stride> The stride (in bytes) between consecutive abscissa elements.
+    <ord_dim_desc> The ordinate dimension descriptor.
+    <ord_stride> The stride (in bytes) between consecutive ordinate elements.
+    <drawn> The pointer to the first instruction drawn is written here. The
+    bounding boxes of the drawn instructions give the regions of the array
+    which were modified. This may be NULL.
+    <num_drawn> The number of instructions drawn is written here. This may be
+    NULL.
+    [NOTE] If instructions which have been drawn are later removed, the
+    application is responsible for restoring the array and then calling
+    [<iedit_reset_drawn>].
+    [RETURNS] TRUE on success, else FALSE. On failure, the instructions which
+    were successfully drawn are still written to <<drawn>> and <<num_drawn>>.
+*/
+{
+    KRegionMask mask;
+    unsigned int first;
+    edit_instruction *instruction;
+    static char function_name[] = "iedit_draw_pending";
+
+    VERIFY_ILIST (ilist);
+    if ( (array == NULL) || (abs_dim_desc == NULL) || (ord_dim_desc == NULL) )
+    {
+	(void) fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
+    }
+    first = (*ilist).num_drawn;
+    if (drawn != NULL) *drawn = (*ilist).compiled + first;
+    if (num_drawn != NULL) *num_drawn = 0;
+    for (; (*ilist).num_drawn < (*ilist).num_compiled; ++(*ilist).num_drawn)
+    {
+	instruction = (*ilist).compiled + (*ilist).num_drawn;
+	switch ( (*instruction).code )
+	{
+	  case EDIT_INSTRUCTION_DAB:
+	    if ( ( (*instruction).num_coords != 2 ) ||
+		 ( (*instruction).coords[1].abscissa <= 0.0 ) ||
+		 ( (*instruction).coords[1].ordinate <= 0.0 ) )
+	    {
+		(void) fprintf (stderr, "Bad dab instruction\n");
+		return (FALSE);
+	    }
+	    mask = ds_mask_create_ellipse (abs_dim_desc, ord_dim_desc,
+					   (*instruction).coords[0].abscissa,
+					   (*instruction).coords[0].ordinate,
+					   (*instruction).coords[1].abscissa,
+					   (*instruction).coords[1].ordinate,
+					   FALSE);
+	    break;
+	  case EDIT_INSTRUCTION_STROKE:
+	  case EDIT_INSTRUCTION_FPOLY:
+	    mask = ds_mask_create_polygon (abs_dim_desc, ord_dim_desc,
+					   (*instruction).coords,
+					   (*instruction).num_coords, FALSE);
+	    break;
+	  default:
+	    (void) fprintf (stderr, "Edit instruction: %u not drawable\n",
+			    (*instruction).code);
+	    return (FALSE);
+/*
+	    break;
+*/
+	}
+	if (mask == NULL) return (FALSE);
+	if ( !ds_mask_fill (mask, array, elem_type, abs_stride, ord_stride,
+			    (*instruction).value) )
+	{
+	    ds_mask_destroy (mask);
+	    return (FALSE);
+	}
+	ds_mask_destroy (mask);
+	if (num_drawn != NULL) *num_drawn = (*ilist).num_drawn - first + 1;
+    }
+    return (TRUE);
+}   /*  End Function iedit_draw_pending  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void iedit_reset_drawn (KImageEditList ilist)
+/*  [SUMMARY] Mark all edit instructions as not yet drawn.
+    [PURPOSE] This routine will mark all instructions in a managed image edit
+    instruction list as not yet drawn, so that the next call to
+    [<iedit_draw_pending>] will draw the whole list. This should be called
+    after the target array has been restored or replaced.
+    <ilist> The managed list.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "iedit_reset_drawn";
+
+    VERIFY_ILIST (ilist);
+    (*ilist).num_drawn = 0;
+}   /*  End Function iedit_reset_drawn  */
+
+
 
 /*  Private functions follow  */
 
@@ -588,6 +663,15 @@ static void initialise_iedit_package ()
     Channel channel;
     unsigned int elem_count;
     extern unsigned int edit_coord_list_index;
+    extern unsigned int coord_list_offset;
+    extern unsigned int code_offset;
+    extern unsigned int code_type;
+    extern unsigned int value_offset;
+    extern unsigned int value_type;
+    extern unsigned int abscissa_offset;
+    extern unsigned int abscissa_type;
+    extern unsigned int ordinate_offset;
+    extern unsigned int ordinate_type;
     extern packet_desc *instruction_desc;
     extern packet_desc *coord_list_desc;
     extern char *str_instruction_desc[];
@@ -627,6 +711,18 @@ static void initialise_iedit_package ()
     }
     coord_list_desc = (packet_desc *)
     (*instruction_desc).element_desc[edit_coord_list_index];
+    /*  Cache element locations so instructions need not be searched by name
+	each time they are built or decoded  */
+    coord_list_offset = ds_get_element_offset (instruction_desc,
+					       edit_coord_list_index);
+    find_element (instruction_desc, "Edit Instruction",
+		  &code_offset, &code_type);
+    find_element (instruction_desc, "Edit Object Value",
+		  &value_offset, &value_type);
+    find_element (coord_list_desc, "Edit Object Abscissa",
+		  &abscissa_offset, &abscissa_type);
+    find_element (coord_list_desc, "Edit Object Ordinate",
+		  &ordinate_offset, &ordinate_type);
     /*  Register protocols  */
     conn_register_server_protocol ("2D_edit", PROTOCOL_VERSION, 0,
 				   register_new_edit_slave,
@@ -660,6 +756,12 @@ list_entry *instruction;
 	(void) fprintf (stderr, "NULL pointer passed\n");
 	a_prog_bug (function_name);
     }
+    if ( !compile_instruction (ilist, instruction) )
+    {
+	ds_dealloc_data (instruction_desc, (*instruction).data);
+	m_free ( (char *) instruction );
+	return (FALSE);
+    }
     ds_list_append ( (*ilist).list_head, instruction );
     if ( (*ilist).process_add != NULL )
     {
@@ -698,6 +800,7 @@ unsigned int num_to_remove;
     {
 	/*  Remove whole list  */
 	ds_dealloc_list_entries (instruction_desc, list_head);
+	free_compiled (ilist, 0);
     }
     else
     {
@@ -722,6 +825,7 @@ unsigned int num_to_remove;
 	{
 	    (*list_head).first_frag_entry = NULL;
 	}
+	free_compiled (ilist, (*list_head).length);
     }
     if ( (*ilist).process_loss != NULL )
     {
@@ -753,6 +857,7 @@ KImageEditList ilist;
     }
     /*  Then remove  */
     ds_dealloc_list_entries (instruction_desc, (*ilist).list_head);
+    free_compiled (ilist, 0);
     if ( (*ilist).process_loss != NULL )
     {
 	/*  Call registered callback  */
@@ -986,25 +1091,23 @@ list_entry *instruction;
 {
     unsigned int instruction_code;
     double value[2];
-    extern unsigned int edit_coord_list_index;
-    extern packet_desc *instruction_desc;
-    extern packet_desc *coord_list_desc;
+    extern unsigned int code_offset;
+    extern unsigned int code_type;
+    extern unsigned int value_offset;
+    extern unsigned int value_type;
     static char function_name[] = "process_local_instruction";
 
     VERIFY_ILIST (ilist);
-    /*  Get instruction code  */
-    if (ds_get_unique_named_value (instruction_desc, (*instruction).data,
-				   "Edit Instruction",
-				   (unsigned int *) NULL, value) != TRUE)
+    /*  Get instruction code and data value  */
+    if ( !ds_get_element ( (*instruction).data + code_offset, code_type,
+			   value, (flag *) NULL ) )
     {
 	(void) fprintf (stderr, "Error getting edit instruction code\n");
 	return (FALSE);
     }
     instruction_code = (unsigned int) value[0];
-    /*  Get data value  */
-    if (ds_get_unique_named_value (instruction_desc, (*instruction).data,
-				   "Edit Object Value",
-				   (unsigned int *) NULL, value) != TRUE)
+    if ( !ds_get_element ( (*instruction).data + value_offset, value_type,
+			   value, (flag *) NULL ) )
     {
 	(void) fprintf (stderr, "Error getting edit object value\n");
 	return (FALSE);
@@ -1088,3 +1191,228 @@ list_header *list_head;
     }
     return ( ch_flush (channel) );
 }   /*  End Function write_list  */
+
+static void find_element (pack_desc, name, offset, type)
+/*  This routine will find the offset and type of a named element in a packet.
+    The packet descriptor must be pointed to by  pack_desc  .
+    The name of the element must be pointed to by  name  .
+    The offset of the element will be written to the storage pointed to by
+    offset  .
+    The type of the element will be written to the storage pointed to by
+    type  .
+    The routine returns nothing.
+*/
+packet_desc *pack_desc;
+char *name;
+unsigned int *offset;
+unsigned int *type;
+{
+    unsigned int elem_index;
+    static char function_name[] = "find_element";
+
+    if ( ( elem_index = ds_f_elem_in_packet (pack_desc, name) )
+	>= (*pack_desc).num_elements )
+    {
+	(void) fprintf (stderr, "Error finding element: \"%s\"\n", name);
+	a_prog_bug (function_name);
+    }
+    *offset = ds_get_element_offset (pack_desc, elem_index);
+    *type = (*pack_desc).element_types[elem_index];
+}   /*  End Function find_element  */
+
+static flag extract_coords (list_head, coords)
+/*  This routine will extract all the co-ordinates in a co-ordinate list.
+    The list header must be pointed to by  list_head  .
+    The co-ordinates will be written to the array pointed to by  coords  .
+    The routine returns TRUE on success, else it returns FALSE.
+*/
+list_header *list_head;
+edit_coord *coords;
+{
+    unsigned int coord_count;
+    unsigned int pack_size;
+    double value[2];
+    char *data;
+    list_entry *curr_entry;
+    extern unsigned int abscissa_offset;
+    extern unsigned int abscissa_type;
+    extern unsigned int ordinate_offset;
+    extern unsigned int ordinate_type;
+    extern packet_desc *coord_list_desc;
+
+    pack_size = ds_get_packet_size (coord_list_desc);
+    for (coord_count = 0, curr_entry = (*list_head).first_frag_entry,
+	 data = (*list_head).contiguous_data;
+	 coord_count < (*list_head).length;
+	 ++coord_count)
+    {
+	if (coord_count >= (*list_head).contiguous_length)
+	{
+	    /*  Fragmented section of list  */
+	    data = (*curr_entry).data;
+	}
+	if (ds_get_element (abscissa_offset + data,
+			    abscissa_type, value, (flag *) NULL) != TRUE)
+	{
+	    (void) fprintf (stderr, "Error getting edit abscissa value\n");
+	    return (FALSE);
+	}
+	coords[coord_count].abscissa = value[0];
+	if (ds_get_element (ordinate_offset + data,
+			    ordinate_type, value, (flag *) NULL) != TRUE)
+	{
+	    (void) fprintf (stderr, "Error getting edit ordinate value\n");
+	    return (FALSE);
+	}
+	coords[coord_count].ordinate = value[0];
+	if (coord_count < (*list_head).contiguous_length)
+	{
+	    /*  Contiguous section of list  */
+	    data += pack_size;
+	}
+	else
+	{
+	    /*  Fragmented section of list  */
+	    curr_entry = (*curr_entry).next;
+	}
+    }
+    return (TRUE);
+}   /*  End Function extract_coords  */
+
+static flag compile_instruction (ilist, instruction)
+/*  This routine will append the compiled form of an edit instruction to a
+    managed image edit instruction list.
+    The instruction list must be given by  ilist  .
+    The edit instruction must be pointed to by  instruction  .
+    The routine returns TRUE on success, else it returns FALSE.
+*/
+KImageEditList ilist;
+list_entry *instruction;
+{
+    unsigned int count;
+    unsigned int num_allocated;
+    double value[2];
+    list_header *coord_list_head;
+    edit_coord *coords = NULL;
+    edit_instruction *compiled;
+    extern unsigned int coord_list_offset;
+    extern unsigned int code_offset;
+    extern unsigned int code_type;
+    extern unsigned int value_offset;
+    extern unsigned int value_type;
+    static char function_name[] = "compile_instruction";
+
+    if ( (*ilist).num_compiled >= (*ilist).num_allocated )
+    {
+	/*  Grow compiled instruction array  */
+	num_allocated = ( (*ilist).num_allocated < 1 ) ?
+	    16 : (*ilist).num_allocated * 2;
+	if ( ( compiled = (edit_instruction *)
+	       m_alloc (sizeof *compiled * num_allocated) ) == NULL )
+	{
+	    m_error_notify (function_name, "compiled instruction array");
+	    return (FALSE);
+	}
+	if ( (*ilist).compiled != NULL )
+	{
+	    m_copy ( (char *) compiled, (char *) (*ilist).compiled,
+		     sizeof *compiled * (*ilist).num_compiled );
+	    m_free ( (char *) (*ilist).compiled );
+	}
+	(*ilist).compiled = compiled;
+	(*ilist).num_allocated = num_allocated;
+    }
+    compiled = (*ilist).compiled + (*ilist).num_compiled;
+    if ( !ds_get_element ( (*instruction).data + code_offset, code_type,
+			   value, (flag *) NULL ) )
+    {
+	(void) fprintf (stderr, "Error getting edit instruction code\n");
+	return (FALSE);
+    }
+    (*compiled).code = (unsigned int) value[0];
+    if ( !ds_get_element ( (*instruction).data + value_offset, value_type,
+			   (*compiled).value, (flag *) NULL ) )
+    {
+	(void) fprintf (stderr, "Error getting edit object value\n");
+	return (FALSE);
+    }
+    coord_list_head = *(list_header **) ( (*instruction).data +
+					   coord_list_offset );
+    (*compiled).num_coords = (*coord_list_head).length;
+    (*compiled).coords = NULL;
+    (*compiled).min_abscissa = TOOBIG;
+    (*compiled).max_abscissa = -TOOBIG;
+    (*compiled).min_ordinate = TOOBIG;
+    (*compiled).max_ordinate = -TOOBIG;
+    if ( (*compiled).num_coords > 0 )
+    {
+	if ( ( coords = (edit_coord *)
+	       m_alloc (sizeof *coords * (*compiled).num_coords) ) == NULL )
+	{
+	    m_error_notify (function_name, "edit co-ordinates");
+	    return (FALSE);
+	}
+	if ( !extract_coords (coord_list_head, coords) )
+	{
+	    m_free ( (char *) coords );
+	    return (FALSE);
+	}
+	(*compiled).coords = coords;
+    }
+    /*  Compute bounding box in world co-ordinates  */
+    if ( ( (*compiled).code == EDIT_INSTRUCTION_DAB ) &&
+	 ( (*compiled).num_coords == 2 ) )
+    {
+	/*  Centre and radii  */
+	(*compiled).min_abscissa = coords[0].abscissa -
+	    fabs (coords[1].abscissa);
+	(*compiled).max_abscissa = coords[0].abscissa +
+	    fabs (coords[1].abscissa);
+	(*compiled).min_ordinate = coords[0].ordinate -
+	    fabs (coords[1].ordinate);
+	(*compiled).max_ordinate = coords[0].ordinate +
+	    fabs (coords[1].ordinate);
+    }
+    else
+    {
+	for (count = 0; count < (*compiled).num_coords; ++count)
+	{
+	    if (coords[count].abscissa < (*compiled).min_abscissa)
+		(*compiled).min_abscissa = coords[count].abscissa;
+	    if (coords[count].abscissa > (*compiled).max_abscissa)
+		(*compiled).max_abscissa = coords[count].abscissa;
+	    if (coords[count].ordinate < (*compiled).min_ordinate)
+		(*compiled).min_ordinate = coords[count].ordinate;
+	    if (coords[count].ordinate > (*compiled).max_ordinate)
+		(*compiled).max_ordinate = coords[count].ordinate;
+	}
+    }
+    ++(*ilist).num_compiled;
+    return (TRUE);
+}   /*  End Function compile_instruction  */
+
+static void free_compiled (ilist, first)
+/*  This routine will remove compiled instructions from the end of a managed
+    image edit instruction list.
+    The instruction list must be given by  ilist  .
+    The index of the first compiled instruction to remove must be given by
+    first  .If this is 0, the compiled instruction array is also deallocated.
+    The routine returns nothing.
+*/
+KImageEditList ilist;
+unsigned int first;
+{
+    while ( (*ilist).num_compiled > first )
+    {
+	--(*ilist).num_compiled;
+	if ( (*ilist).compiled[(*ilist).num_compiled].coords != NULL )
+	{
+	    m_free ( (char *) (*ilist).compiled[(*ilist).num_compiled].coords );
+	}
+    }
+    if ( (*ilist).num_drawn > first ) (*ilist).num_drawn = first;
+    if ( (first > 0) || ( (*ilist).compiled == NULL ) ) return;
+    m_free ( (char *) (*ilist).compiled );
+    (*ilist).compiled = NULL;
+    (*ilist).num_allocated = 0;
+}   /*  End Function free_compiled  */
@@ -49,40 +49,110 @@
 #include <karma.h>
 #include <karma_imc.h>
 #include <karma_ds.h>
+#include <karma_mt.h>
 #include <karma_m.h>
 #include <karma_a.h>
 
-#define MIN_COLOUR_DIFFERENCE /*64*/ 16
 #define MAX_INTENSITY 255
 #define MAX_NORM 196608 /* (256*256)*3 */
 #define MAX_COLOURS 256
+#define NUM_CELLS 32768  /*  A 5-5-5 bit grid of colours  */
+#define CELL_INDEX(r,g,b) ( ( (r) >> 3 ) << 10 | ( (g) >> 3 ) << 5 | (b) >> 3 )
+#define MIN_JOB_PIXELS 65536
+#define NUM_REFINEMENT_LEVELS 6
+#define EXACT_TABLE_SIZE 1024  /*  Power of 2, at least 2 * MAX_COLOURS  */
+
+typedef struct
+{
+    unsigned long count;
+    double red;
+    double green;
+    double blue;
+} cell_type;
+
+typedef struct
+{
+    int lo[3];
+    int hi[3];
+    unsigned long count;
+} box_type;
+
+typedef struct
+{
+    unsigned char *image_reds;
+    unsigned char *image_greens;
+    unsigned char *image_blues;
+    int stride24;
+    unsigned char *out_image;
+    int stride8;
+    unsigned int width;
+    int spread;
+    CONST cell_type *cells;
+    unsigned char *lut;
+    unsigned int num_colours;
+    CONST unsigned char *palette_reds;
+    CONST unsigned char *palette_greens;
+    CONST unsigned char *palette_blues;
+} quantise_info_type;
+
+/*  Iterations of palette refinement for each speed  */
+static unsigned int refinements[NUM_REFINEMENT_LEVELS] = {6, 4, 2, 1, 0, 0};
+
+/*  4x4 ordered dither matrix  */
+static int dither_matrix[4][4] =
+{
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5}
+};
 
 
 /*  Private functions  */
-STATIC_FUNCTION (unsigned int c_24_to_8, (int image_size,
-					  unsigned char *image_reds,
-					  unsigned char *image_greens,
-					  unsigned char *image_blues,
-					  int stride24,
-					  unsigned char *out_image,
-					  int stride8,
-					  unsigned int max_colours,
-					  unsigned char *palette_reds,
-					  unsigned char *palette_greens,
-					  unsigned char *palette_blues,
-					  unsigned int speed) );
-STATIC_FUNCTION (unsigned int c_24_to_8_slow, (int image_size,
-					       unsigned char *image_reds,
-					       unsigned char *image_greens,
-					       unsigned char *image_blues,
-					       int stride24,
-					       unsigned char *out_image,
-					       int stride8,
-					       unsigned int max_colours,
-					       unsigned char *palette_reds,
-					       unsigned char *palette_greens,
-					       unsigned char *palette_blues,
-					       unsigned int speed) );
+STATIC_FUNCTION (unsigned int quantise,
+		 (unsigned int image_size, unsigned int width,
+		  unsigned char *image_reds, unsigned char *image_greens,
+		  unsigned char *image_blues, int stride24,
+		  unsigned char *out_image, int stride8,
+		  unsigned int max_colours, unsigned char *palette_reds,
+		  unsigned char *palette_greens, unsigned char *palette_blues,
+		  unsigned int speed) );
+STATIC_FUNCTION (unsigned int exact_palette,
+		 (quantise_info_type *info, unsigned int image_size,
+		  unsigned int max_colours, unsigned char *palette_reds,
+		  unsigned char *palette_greens, unsigned char *palette_blues) );
+STATIC_FUNCTION (flag compute_histogram,
+		 (quantise_info_type *info, unsigned int image_size,
+		  cell_type *cells) );
+STATIC_FUNCTION (void histogram_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (unsigned int median_cut,
+		 (CONST cell_type *cells, unsigned int max_colours,
+		  unsigned char *palette_reds, unsigned char *palette_greens,
+		  unsigned char *palette_blues) );
+STATIC_FUNCTION (void shrink_box, (CONST cell_type *cells, box_type *box) );
+STATIC_FUNCTION (void refine_palette,
+		 (CONST cell_type *cells, unsigned int num_colours,
+		  unsigned char *palette_reds, unsigned char *palette_greens,
+		  unsigned char *palette_blues) );
+STATIC_FUNCTION (unsigned int find_closest,
+		 (int red, int green, int blue, unsigned int num_colours,
+		  CONST unsigned char *palette_reds,
+		  CONST unsigned char *palette_greens,
+		  CONST unsigned char *palette_blues) );
+STATIC_FUNCTION (void lut_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (void map_job_func,
+		 (void *pool_info, void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4, void *thread_info) );
+STATIC_FUNCTION (flag make_colourmap,
+		 (unsigned int cmap_size, CONST unsigned char *palette_reds,
+		  CONST unsigned char *palette_greens,
+		  CONST unsigned char *palette_blues,
+		  packet_desc **pack_desc, char **packet) );
+
 
 /*  Public functions follow  */
 
@@ -113,12 +183,15 @@ flag imc_24to8 (unsigned int image_size, unsigned char *image_reds,
     data structure which contains the colourmap will be written here.
     <packet> The pointer to the top level packet of the general data structure
     which contains the colourmap will be written here.
+    [NOTE] Images with no more than <<max_colours>> distinct colours are
+    reproduced exactly. Otherwise, for speeds up to 5 the palette is chosen by
+    median cut on a 5-5-5 bit colour histogram, refined by a few k-means
+    iterations at the lower speeds. Faster speeds use a fixed 128 colour
+    palette.
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    unsigned int count;
     unsigned int cmap_size;
-    unsigned short *cmap;
     unsigned char palette_reds[MAX_COLOURS];
     unsigned char palette_greens[MAX_COLOURS];
     unsigned char palette_blues[MAX_COLOURS];
@@ -138,102 +211,175 @@ flag imc_24to8 (unsigned int image_size, unsigned char *image_reds,
 			max_colours, MAX_COLOURS);
 	a_prog_bug (function_name);
     }
-    if ( ( cmap_size = c_24_to_8 ( (int) image_size, image_reds, image_greens,
-				  image_blues, stride24, out_image, stride8,
-				  max_colours, palette_reds, palette_greens,
-				  palette_blues, speed ) ) < 2 )
+    if ( ( cmap_size = quantise (image_size, 0, image_reds, image_greens,
+				 image_blues, stride24, out_image, stride8,
+				 max_colours, palette_reds, palette_greens,
+				 palette_blues, speed) ) < 2 )
     {
 	(void) fprintf (stderr, "Error compressing 24bit TrueColour image\n");
 	return (FALSE);
     }
-    if ( ( cmap = ds_cmap_alloc_colourmap (cmap_size, (multi_array **) NULL,
-					   pack_desc, packet) ) == NULL )
+    return ( make_colourmap (cmap_size, palette_reds, palette_greens,
+			     palette_blues, pack_desc, packet) );
+}   /*  End Function imc_24to8  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag imc_24to8_dither (unsigned int width, unsigned int height,
+		       unsigned char *image_reds, unsigned char *image_greens,
+		       unsigned char *image_blues, int stride24,
+		       unsigned char *out_image, int stride8,
+		       unsigned int max_colours, unsigned int speed,
+		       packet_desc **pack_desc, char **packet)
+/*  [SUMMARY] Convert a 24 bit truecolour image to a dithered 8 bit image.
+    [PURPOSE] This routine will convert a 24 bit truecolour image to an 8 bit
+    pseudocolour image in the same way as [<imc_24to8>], except that an
+    ordered dither is applied when mapping pixels to the colour palette. This
+    hides the contouring of smooth colour gradients.
+    <width> The width of the image (in pixels).
+    <height> The height of the image (in pixels).
+    <image_reds> The red component data of the truecolour image.
+    <image_greens> The green component data of the truecolour image.
+    <image_blues> The blue component data of the truecolour image.
+    <stride24> The stride (in bytes) between adjacent pixels in the truecolour
+    image. Lines must follow each other without gaps.
+    <out_image> The output (8 bit pseudocolour) image data.
+    <stride8> The stride (in bytes) between adjacent pixels in the pseudocolour
+    image.
+    <max_colours> The maximum number of unique colours permitted.
+    <speed> The desired speed of the routine. See [<imc_24to8>].
+    <pack_desc> The pointer to the top level packet descriptor of the general
+    data structure which contains the colourmap will be written here.
+    <packet> The pointer to the top level packet of the general data structure
+    which contains the colourmap will be written here.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int cmap_size;
+    unsigned char palette_reds[MAX_COLOURS];
+    unsigned char palette_greens[MAX_COLOURS];
+    unsigned char palette_blues[MAX_COLOURS];
+    static char function_name[] = "imc_24to8_dither";
+
+    if ( (image_reds == NULL) || (image_greens == NULL) ||
+	(image_blues == NULL) || (out_image == NULL) ||
+	(pack_desc == NULL) || (packet == NULL) )
     {
-	m_error_notify (function_name, "RGBcolourmap");
-	return (FALSE);
+	(void) fprintf (stderr, "NULL pointer(s) passed\n");
+	a_prog_bug (function_name);
     }
-    for (count = 0; count < cmap_size; ++count)
+    if (max_colours > MAX_COLOURS)
     {
-	*cmap++ = palette_reds[count] << 8;
-	*cmap++ = palette_greens[count] << 8;
-	*cmap++ = palette_blues[count] << 8;
+	(void) fprintf (stderr,
+			"max_colours: %u must not be greater than: %u\n",
+			max_colours, MAX_COLOURS);
+	a_prog_bug (function_name);
     }
-    return (TRUE);
-}   /*  End Function imc_24to8  */
+    if (width < 1)
+    {
+	(void) fprintf (stderr, "Zero width image\n");
+	a_prog_bug (function_name);
+    }
+    if ( ( cmap_size = quantise (width * height, width, image_reds,
+				 image_greens, image_blues, stride24,
+				 out_image, stride8, max_colours, palette_reds,
+				 palette_greens, palette_blues, speed) ) < 2 )
+    {
+	(void) fprintf (stderr, "Error compressing 24bit TrueColour image\n");
+	return (FALSE);
+    }
+    return ( make_colourmap (cmap_size, palette_reds, palette_greens,
+			     palette_blues, pack_desc, packet) );
+}   /*  End Function imc_24to8_dither  */
 
 
 /*  Private functions follow  */
 
-static unsigned int c_24_to_8 (image_size, image_reds, image_greens,
-			       image_blues, stride24, out_image, stride8,
-			       max_colours, palette_reds, palette_greens,
-			       palette_blues, speed)
-/*  This routine will convert a 24 bit truecolour image to an 8 bit
-    pseudocolour image.
-    The size image (in pixels) must be given by  image_size  .
-    The red component data of the truecolour image must be pointed to by
-    image_reds  .
-    The green component data of the truecolour image must be pointed to by
-    image_greens  .
-    The blue component data of the truecolour image must be pointed to by
-    image_blues  .
-    The stride (in bytes) between adjacent pixels in the truecolour image must
-    be given by  stride24  .
-    The output (8 bit pseudocolour) image date must be pointed to by  out_image
-    The stride (in bytes) between adjacent pixels in the pseudocolour image
-    must be given by  stride8  .
-    The maximum number of unique colours (ie. the maximum colour palette size)
-    must be given by  max_colours  .
-    The palette red components must be written to the array pointed to by
-    palette_reds  .
-    The palette green components must be written to the array pointed to by
-    palette_greens  .
-    The palette blue components must be written to the array pointed to by
-    palette_blues  .
-    The desired speed of the routine must be given by  speed  .This value may
-    range from 0 to 9. A value of 0 will result in the slowest but highest
-    quality conversion (ie. the routine tries very hard to choose the best
-    colour palette). A value of 9 will result in the fastest conversion, at the
-    expense of image quality.
-    The routine returns the actual number of unique colours in the palette.
+static unsigned int quantise (unsigned int image_size, unsigned int width,
+			      unsigned char *image_reds,
+			      unsigned char *image_greens,
+			      unsigned char *image_blues, int stride24,
+			      unsigned char *out_image, int stride8,
+			      unsigned int max_colours,
+			      unsigned char *palette_reds,
+			      unsigned char *palette_greens,
+			      unsigned char *palette_blues,
+			      unsigned int speed)
+/*  [SUMMARY] Convert a 24 bit truecolour image to an 8 bit pseudocolour image.
+    [PURPOSE] This routine will choose a colour palette for a truecolour image
+    and then map each pixel to the palette via a lookup table with an entry
+    for each cell of a 5-5-5 bit colour grid. The histogram, lookup table and
+    pixel mapping are shared between the threads of the shared thread pool.
+    <image_size> The size of the image (in pixels).
+    <width> The width of the image. If this is 0 no dithering is done, else an
+    ordered dither is applied.
+    <image_reds> The red component data of the truecolour image.
+    <image_greens> The green component data of the truecolour image.
+    <image_blues> The blue component data of the truecolour image.
+    <stride24> The stride (in bytes) between adjacent pixels in the truecolour
+    image.
+    <out_image> The output (8 bit pseudocolour) image data.
+    <stride8> The stride (in bytes) between adjacent pixels in the pseudocolour
+    image.
+    <max_colours> The maximum number of unique colours.
+    <palette_reds> The palette red components are written here.
+    <palette_greens> The palette green components are written here.
+    <palette_blues> The palette blue components are written here.
+    <speed> The desired speed of the routine, from 0 to 9.
+    [RETURNS] The number of colours in the palette, or 0 on failure.
 */
-int image_size;
-unsigned char *image_reds;
-unsigned char *image_greens;
-unsigned char *image_blues;
-int stride24;
-unsigned char *out_image;
-int stride8;
-unsigned int max_colours;
-unsigned char *palette_reds;
-unsigned char *palette_greens;
-unsigned char *palette_blues;
-unsigned int speed;
 {
-    int red, green, blue;
-    int count;
-    unsigned char pixel;
-/*
-    static char function_name[] = "c_24_to_8";
-*/
+    KThreadPool pool;
+    int red, green, blue, cube;
+    unsigned int count, num_colours, num_jobs, job_count;
+    unsigned int start, block_size;
+    quantise_info_type info;
+    cell_type *cells = NULL;
+    unsigned char *lut;
+    static char function_name[] = "__imc_quantise";
 
-    if (speed > 5)
+    if (image_size < 1) return (0);
+    if ( ( lut = (unsigned char *) m_alloc (NUM_CELLS) ) == NULL )
+    {
+	m_error_notify (function_name, "lookup table");
+	return (0);
+    }
+    info.image_reds = image_reds;
+    info.image_greens = image_greens;
+    info.image_blues = image_blues;
+    info.stride24 = stride24;
+    info.out_image = out_image;
+    info.stride8 = stride8;
+    info.width = width;
+    info.lut = lut;
+    info.palette_reds = palette_reds;
+    info.palette_greens = palette_greens;
+    info.palette_blues = palette_blues;
+    /*  Images with few colours are reproduced exactly  */
+    if ( ( num_colours = exact_palette (&info, image_size, max_colours,
+					 palette_reds, palette_greens,
+					 palette_blues) ) > 0 )
+    {
+	m_free ( (char *) lut );
+	if (num_colours == 1)
+	{
+	    palette_reds[1] = palette_reds[0];
+	    palette_greens[1] = palette_greens[0];
+	    palette_blues[1] = palette_blues[0];
+	    num_colours = 2;
+	}
+	return (num_colours);
+    }
+    pool = mt_get_shared_pool ();
+    if (speed >= NUM_REFINEMENT_LEVELS)
     {
 	if (max_colours < 128)
 	{
 	    (void) fprintf (stderr, "Not enough colours: must have 128\n");
+	    m_free ( (char *) lut );
 	    return (0);
 	}
-	for (count = 0; count < image_size; ++count, image_reds += stride24,
-	     image_greens += stride24, image_blues += stride24,
-	     out_image += stride8)
-	{
-	    pixel = (unsigned char) (*image_reds & 0xe0) >> 5;
-	    pixel |= (unsigned char) (*image_greens & 0xc0) >> 3;
-	    pixel |= (unsigned char) (*image_blues & 0xc0) >> 1;
-	    *out_image = pixel;
-	}
-	/*  Setup palette  */
+	/*  Setup fixed palette: 3 bits red, 2 bits green and 2 bits blue  */
 	for (count = 0; count < 128; ++count)
 	{
 	    red = count & 0x07;
@@ -243,233 +389,624 @@ unsigned int speed;
 	    palette_greens[count] = ( (green * MAX_INTENSITY) / 3 );
 	    palette_blues[count] = ( (blue * MAX_INTENSITY) / 3 );
 	}
-	return (128);
-    }
-    return ( c_24_to_8_slow (image_size, image_reds, image_greens,
-			     image_blues, stride24, out_image, stride8,
-			     max_colours, palette_reds, palette_greens,
-			     palette_blues, speed) );
-}   /*  End Function c_24_to_8  */
-
-static unsigned int c_24_to_8_slow (image_size, image_reds, image_greens,
-				    image_blues, stride24, out_image, stride8,
-				    max_colours, palette_reds, palette_greens,
-				    palette_blues, speed)
-int image_size;
-unsigned char *image_reds;
-unsigned char *image_greens;
-unsigned char *image_blues;
-int stride24;
-unsigned char *out_image;
-int stride8;
-unsigned int max_colours;
-unsigned char *palette_reds;
-unsigned char *palette_greens;
-unsigned char *palette_blues;
-unsigned int speed;
+	num_colours = 128;
+	for (count = 0; count < NUM_CELLS; ++count)
+	{
+	    lut[count] = (count >> 12) | ( (count >> 8) & 0x03 ) << 3 |
+		( (count >> 3) & 0x03 ) << 5;
+	}
+    }
+    else
+    {
+	if ( ( cells = (cell_type *) m_alloc (sizeof *cells * NUM_CELLS) )
+	     == NULL )
+	{
+	    m_error_notify (function_name, "colour histogram");
+	    m_free ( (char *) lut );
+	    return (0);
+	}
+	if ( !compute_histogram (&info, image_size, cells) )
+	{
+	    m_free ( (char *) cells );
+	    m_free ( (char *) lut );
+	    return (0);
+	}
+	num_colours = median_cut (cells, max_colours, palette_reds,
+				  palette_greens, palette_blues);
+	for (count = 0; count < refinements[speed]; ++count)
+	{
+	    refine_palette (cells, num_colours, palette_reds, palette_greens,
+			    palette_blues);
+	}
+	/*  Compute the lookup table, one plane of red cells per job  */
+	info.cells = cells;
+	info.num_colours = num_colours;
+	for (count = 0; count < 32; ++count)
+	{
+	    mt_launch_job (pool, lut_job_func, &info, NULL,
+			   (void *) (uaddr) count, NULL);
+	}
+	mt_wait_for_all_jobs (pool);
+	m_free ( (char *) cells );
+	if (num_colours == 1)
+	{
+	    /*  Callers treat a single colour as failure  */
+	    palette_reds[1] = palette_reds[0];
+	    palette_greens[1] = palette_greens[0];
+	    palette_blues[1] = palette_blues[0];
+	    num_colours = 2;
+	}
+    }
+    /*  The dither amplitude is the approximate spacing of palette colours  */
+    for (cube = 1; cube * cube * cube < num_colours; ++cube);
+    info.spread = 256 / cube;
+    /*  Map the pixels  */
+    num_jobs = mt_num_threads (pool);
+    if (image_size / MIN_JOB_PIXELS < num_jobs)
+    {
+	num_jobs = image_size / MIN_JOB_PIXELS;
+    }
+    if (num_jobs < 1) num_jobs = 1;
+    block_size = image_size / num_jobs;
+    for (job_count = 0, start = 0; job_count < num_jobs;
+	 ++job_count, start += block_size)
+    {
+	if (job_count + 1 == num_jobs) block_size = image_size - start;
+	mt_launch_job (pool, map_job_func, &info, NULL,
+		       (void *) (uaddr) start, (void *) (uaddr) block_size);
+    }
+    mt_wait_for_all_jobs (pool);
+    m_free ( (char *) lut );
+    return (num_colours);
+}   /*  End Function quantise  */
+
+static unsigned int exact_palette (quantise_info_type *info,
+				   unsigned int image_size,
+				   unsigned int max_colours,
+				   unsigned char *palette_reds,
+				   unsigned char *palette_greens,
+				   unsigned char *palette_blues)
+/*  [SUMMARY] Map an image with few colours exactly.
+    [PURPOSE] This routine will collect the distinct colours of a truecolour
+    image in a hash table, writing the palette index of each pixel as it goes.
+    It gives up as soon as there are more than <<max_colours>> colours, in
+    which case the output image is incomplete and must be overwritten.
+    <info> The quantisation information.
+    <image_size> The size of the image (in pixels).
+    <max_colours> The maximum number of unique colours.
+    <palette_reds> The palette red components are written here.
+    <palette_greens> The palette green components are written here.
+    <palette_blues> The palette blue components are written here.
+    [RETURNS] The number of colours in the palette, or 0 if there are too
+    many colours.
+*/
 {
-    int norm;
-    int norm_red;
-    int norm_green;
-    int norm_blue;
-    int min_norm;
-    int cnt_pixel;
-    int cnt1;
-    flag not_matched;
-    unsigned int red, green, blue;
-    unsigned int cnt_mutual;
-    unsigned int cnt_colour;
-    unsigned int cnt_palette;
-    unsigned int palette_num;
-    unsigned int num_colours;
-    unsigned int cnt_freq;
-    unsigned char *reds;
-    unsigned char *greens;
-    unsigned char *blues;
-    unsigned int *frequency;
-    unsigned int max_freq;
-    unsigned int colour_num;
-    static char function_name[] = "c_24_to_8_slow";
-
-    /* Program consists of   stages */
-    (void) fprintf (stderr, "Stage 1: size: %d...\n", (int) image_size);
-    /* Stage 1. Count input palette colour number and calculate frequencies */
-    /* 	of every colour.						*/
-    if ( ( reds = (unsigned char *) m_alloc (sizeof *reds * image_size) )
-	== NULL )
-    {
-	m_abort (function_name, "red array");
-    }
-    if ( ( greens = (unsigned char *) m_alloc (sizeof *greens * image_size) )
-	== NULL )
-    {
-	m_abort (function_name, "green array");
-    }
-    if ( ( blues = (unsigned char *) m_alloc (sizeof *blues * image_size) )
-	== NULL )
-    {
-	m_abort (function_name, "blue array");
-    }
-    if ( ( frequency = (unsigned int *)
-	  m_alloc (sizeof *frequency * image_size) )
-	== NULL )
-    {
-	m_abort (function_name, "frequency array");
-    }
-    *reds = *image_reds;
-    *greens = *image_greens;
-    *blues = *image_blues;
-    *frequency = 1;
-    num_colours = 1;
-    for (cnt_pixel = 1; cnt_pixel < image_size; cnt_pixel++)
-    {
-	cnt1 = cnt_pixel * stride24;
-	red = image_reds[cnt1];
-	green = image_greens[cnt1];
-	blue = image_blues[cnt1];
-	for (cnt_mutual = 0, not_matched = TRUE;
-	     (cnt_mutual < num_colours) && not_matched;
-	     cnt_mutual++)
+    unsigned int count, num_colours = 0;
+    unsigned int red, green, blue, hash;
+    unsigned long key;
+    CONST unsigned char *reds = info->image_reds;
+    CONST unsigned char *greens = info->image_greens;
+    CONST unsigned char *blues = info->image_blues;
+    unsigned char *out = info->out_image;
+    unsigned long keys[EXACT_TABLE_SIZE];  /*  Colour + 1, 0 if unused  */
+    unsigned char indices[EXACT_TABLE_SIZE];
+
+    m_clear ( (char *) keys, sizeof keys );
+    for (count = 0; count < image_size; ++count)
+    {
+	red = *reds;
+	green = *greens;
+	blue = *blues;
+	key = (unsigned long) (red << 16 | green << 8 | blue) + 1;
+	hash = (red * 73 + green * 151 + blue * 211) & (EXACT_TABLE_SIZE - 1);
+	while ( (keys[hash] != 0) && (keys[hash] != key) )
 	{
-#ifndef dummy
-	    norm_red = (int) red - (int) reds[cnt_mutual];
-	    norm_green = (int) green - (int) greens[cnt_mutual];
-	    norm_blue = (int) blue - (int) blues[cnt_mutual];
-	    norm = norm_red*norm_red+norm_green*norm_green+norm_blue*norm_blue;
-	    if (norm < MIN_COLOUR_DIFFERENCE)
-#else
-	    if ( (red == reds[cnt_mutual]) &&
-		(green == greens[cnt_mutual]) &&
-		(blue == blues[cnt_mutual]) )
-#endif
-	    {
-		++frequency[cnt_mutual];
-		/*  Exit this loop  */
-		not_matched = FALSE;
-	    }
+	    hash = (hash + 1) & (EXACT_TABLE_SIZE - 1);
 	}
-	if (not_matched)
+	if (keys[hash] == 0)
 	{
-	    reds[num_colours] = red;
-	    greens[num_colours] = green;
-	    blues[num_colours] = blue;
-	    frequency[num_colours] = 1;
+	    if (num_colours >= max_colours) return (0);
+	    keys[hash] = key;
+	    indices[hash] = num_colours;
+	    palette_reds[num_colours] = red;
+	    palette_greens[num_colours] = green;
+	    palette_blues[num_colours] = blue;
 	    ++num_colours;
 	}
-	if (cnt_pixel % 100000 == 0)
+	*out = indices[hash];
+	reds += info->stride24;
+	greens += info->stride24;
+	blues += info->stride24;
+	out += info->stride8;
+    }
+    return (num_colours);
+}   /*  End Function exact_palette  */
+
+static flag compute_histogram (quantise_info_type *info,
+			       unsigned int image_size, cell_type *cells)
+/*  [SUMMARY] Compute the colour histogram of a truecolour image.
+    [PURPOSE] This routine will count the pixels falling in each cell of a
+    5-5-5 bit colour grid and sum their colours. Each job fills a private
+    histogram which is added to the total at the end.
+    <info> The quantisation information.
+    <image_size> The size of the image (in pixels).
+    <cells> The histogram is written here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KThreadPool pool;
+    unsigned int count, num_jobs, job_count, start, block_size;
+    cell_type *job_cells, *cell;
+    static char function_name[] = "__imc_compute_histogram";
+
+    m_clear ( (char *) cells, sizeof *cells * NUM_CELLS );
+    pool = mt_get_shared_pool ();
+    num_jobs = mt_num_threads (pool);
+    if (image_size / MIN_JOB_PIXELS < num_jobs)
+    {
+	num_jobs = image_size / MIN_JOB_PIXELS;
+    }
+    if (num_jobs < 2)
+    {
+	histogram_job_func (NULL, info, cells, (void *) 0,
+			    (void *) (uaddr) image_size, NULL);
+	return (TRUE);
+    }
+    if ( ( job_cells = (cell_type *)
+	   m_alloc (sizeof *job_cells * NUM_CELLS * num_jobs) ) == NULL )
+    {
+	m_error_notify (function_name, "job histograms");
+	return (FALSE);
+    }
+    m_clear ( (char *) job_cells, sizeof *job_cells * NUM_CELLS * num_jobs );
+    block_size = image_size / num_jobs;
+    for (job_count = 0, start = 0; job_count < num_jobs;
+	 ++job_count, start += block_size)
+    {
+	if (job_count + 1 == num_jobs) block_size = image_size - start;
+	mt_launch_job (pool, histogram_job_func, info,
+		       job_cells + NUM_CELLS * job_count,
+		       (void *) (uaddr) start, (void *) (uaddr) block_size);
+    }
+    mt_wait_for_all_jobs (pool);
+    for (job_count = 0, cell = job_cells; job_count < num_jobs; ++job_count)
+    {
+	for (count = 0; count < NUM_CELLS; ++count, ++cell)
 	{
-	    (void) fprintf (stderr, "Unique colours: %u\tpixel number: %u\n",
-			    num_colours, cnt_pixel);
+	    cells[count].count += cell->count;
+	    cells[count].red += cell->red;
+	    cells[count].green += cell->green;
+	    cells[count].blue += cell->blue;
 	}
     }
+    m_free ( (char *) job_cells );
+    return (TRUE);
+}   /*  End Function compute_histogram  */
+
+static void histogram_job_func (void *pool_info,
+				void *call_info1, void *call_info2,
+				void *call_info3, void *call_info4,
+				void *thread_info)
+/*  [SUMMARY] Perform a histogram job.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The quantisation information.
+    <call_info2> The histogram to add to.
+    <call_info3> The first pixel.
+    <call_info4> The number of pixels.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    quantise_info_type *info = (quantise_info_type *) call_info1;
+    cell_type *cells = (cell_type *) call_info2;
+    unsigned int start = (uaddr) call_info3;
+    unsigned int num_pixels = (uaddr) call_info4;
+    unsigned int count;
+    int red, green, blue;
+    cell_type *cell;
+    int stride24 = info->stride24;
+    CONST unsigned char *reds = info->image_reds + start * stride24;
+    CONST unsigned char *greens = info->image_greens + start * stride24;
+    CONST unsigned char *blues = info->image_blues + start * stride24;
+
+    for (count = 0; count < num_pixels; ++count, reds += stride24,
+	 greens += stride24, blues += stride24)
+    {
+	red = *reds;
+	green = *greens;
+	blue = *blues;
+	cell = cells + CELL_INDEX (red, green, blue);
+	++cell->count;
+	cell->red += red;
+	cell->green += green;
+	cell->blue += blue;
+    }
+}   /*  End Function histogram_job_func  */
+
+static unsigned int median_cut (CONST cell_type *cells,
+				unsigned int max_colours,
+				unsigned char *palette_reds,
+				unsigned char *palette_greens,
+				unsigned char *palette_blues)
+/*  [SUMMARY] Choose a colour palette by median cut.
+    [PURPOSE] This routine will recursively split the populated part of the
+    colour histogram into boxes, each time splitting the box with the largest
+    product of pixel count and length at the median along its longest side.
+    Each palette colour is the mean colour of the pixels in one box.
+    <cells> The colour histogram.
+    <max_colours> The maximum number of colours.
+    <palette_reds> The palette red components are written here.
+    <palette_greens> The palette green components are written here.
+    <palette_blues> The palette blue components are written here.
+    [RETURNS] The number of colours in the palette.
+*/
+{
+    int axis, length, longest, cut, pos;
+    int index[3];
+    unsigned int count, num_boxes, best;
+    unsigned long sum, half;
+    double score, best_score, red, green, blue, total;
+    CONST cell_type *cell;
+    box_type *box;
+    box_type boxes[MAX_COLOURS];
 
-    (void) fprintf (stderr, "1: %d unique colours...\n", (int) num_colours);
-    /* If original palette containes less then maximum allowed colours */
-    /* convert it to output image */
-    if (num_colours <= max_colours)
+    boxes[0].lo[0] = boxes[0].lo[1] = boxes[0].lo[2] = 0;
+    boxes[0].hi[0] = boxes[0].hi[1] = boxes[0].hi[2] = 31;
+    shrink_box (cells, boxes);
+    num_boxes = 1;
+    while (num_boxes < max_colours)
     {
-	for (cnt_colour = 0; cnt_colour < num_colours; cnt_colour++)
+	/*  Find the box to split  */
+	best_score = 0.0;
+	best = num_boxes;
+	for (count = 0; count < num_boxes; ++count)
 	{
-	    palette_reds[cnt_colour] = reds[cnt_colour];
-	    palette_greens[cnt_colour] = greens[cnt_colour];
-	    palette_blues[cnt_colour] = blues[cnt_colour];
+	    box = boxes + count;
+	    for (axis = 0, longest = 0; axis < 3; ++axis)
+	    {
+		length = box->hi[axis] - box->lo[axis];
+		if (length > longest) longest = length;
+	    }
+	    score = (double) box->count * (double) longest;
+	    if (score > best_score)
+	    {
+		best_score = score;
+		best = count;
+	    }
 	}
-	for (cnt_pixel = 0; cnt_pixel < image_size; cnt_pixel++)
+	if (best >= num_boxes) break;
+	box = boxes + best;
+	for (count = 1, axis = 0; count < 3; ++count)
 	{
-	    min_norm = MAX_NORM;
-	    colour_num = 0;
-	    cnt1 = cnt_pixel * stride24;
-	    red = image_reds[cnt1];
-	    green = image_greens[cnt1];
-	    blue = image_blues[cnt1];
-	    for (cnt_colour = 0; cnt_colour < num_colours; cnt_colour++)
+	    if (box->hi[count] - box->lo[count] >
+		box->hi[axis] - box->lo[axis]) axis = count;
+	}
+	/*  Find the median along the axis  */
+	half = box->count / 2;
+	for (cut = box->lo[axis], sum = 0; cut < box->hi[axis]; ++cut)
+	{
+	    for (index[0] = box->lo[0]; index[0] <= box->hi[0]; ++index[0])
 	    {
-		norm_red = (int) red - (int) palette_reds[cnt_colour];
-		norm_green = (int) green - (int) palette_greens[cnt_colour];
-		norm_blue = (int) blue - (int) palette_blues[cnt_colour];
-		norm =
-		norm_red*norm_red+norm_green*norm_green+norm_blue*norm_blue;
-		if (norm < MIN_COLOUR_DIFFERENCE)
-		{
-		    colour_num = cnt_colour;
-		    cnt_colour = num_colours;
-		    continue;
-		}
-		if (norm < min_norm)
+		if ( (axis == 0) && (index[0] != cut) ) continue;
+		for (index[1] = box->lo[1]; index[1] <= box->hi[1];
+		     ++index[1])
 		{
-		    min_norm = norm;
-		    colour_num = cnt_colour;
+		    if ( (axis == 1) && (index[1] != cut) ) continue;
+		    pos = index[0] << 10 | index[1] << 5;
+		    for (index[2] = box->lo[2]; index[2] <= box->hi[2];
+			 ++index[2])
+		    {
+			if ( (axis == 2) && (index[2] != cut) ) continue;
+			sum += cells[pos | index[2]].count;
+		    }
 		}
 	    }
-	    out_image[cnt_pixel * stride8] = colour_num;
-	    if (cnt_pixel % 100000 == 0) (void) fprintf (stderr, ".");
+	    if (sum >= half) break;
 	}
-	m_free ( (char *) reds );
-	m_free ( (char *) greens );
-	m_free ( (char *) blues );
-	m_free ( (char *) frequency );
-	return (num_colours);
+	if (cut >= box->hi[axis]) cut = box->hi[axis] - 1;
+	m_copy ( (char *) (boxes + num_boxes), (char *) box, sizeof *box );
+	box->hi[axis] = cut;
+	boxes[num_boxes].lo[axis] = cut + 1;
+	shrink_box (cells, box);
+	shrink_box (cells, boxes + num_boxes);
+	++num_boxes;
     }
-    (void) fprintf (stderr, "Stage 2...\n");
-    /*				                	*/
-    /* Stage 2. Find  max_colours  colours of highest frequency  */
-    /*							*/
-    for (cnt_palette = 0; cnt_palette < max_colours; cnt_palette++)
+    /*  Compute the mean colour of each box  */
+    for (count = 0; count < num_boxes; ++count)
     {
-	max_freq = *frequency;
-	palette_num = 0;
-	for (cnt_freq = 0; cnt_freq < num_colours; cnt_freq++)
+	box = boxes + count;
+	red = 0.0;
+	green = 0.0;
+	blue = 0.0;
+	total = 0.0;
+	for (index[0] = box->lo[0]; index[0] <= box->hi[0]; ++index[0])
+	    for (index[1] = box->lo[1]; index[1] <= box->hi[1]; ++index[1])
 	{
-	    if (frequency[cnt_freq] > max_freq)
+	    cell = cells + (index[0] << 10 | index[1] << 5);
+	    for (index[2] = box->lo[2]; index[2] <= box->hi[2]; ++index[2])
 	    {
-		max_freq = frequency[cnt_freq];
-		palette_num = cnt_freq;
+		red += cell[index[2]].red;
+		green += cell[index[2]].green;
+		blue += cell[index[2]].blue;
+		total += (double) cell[index[2]].count;
 	    }
 	}
-	palette_reds[cnt_palette] = reds[palette_num];
-	palette_greens[cnt_palette] = greens[palette_num];
-	palette_blues[cnt_palette] = blues[palette_num];
-	frequency[palette_num] = 0;	/* spoil it */
-    }  /* End 8 bit loop */
-    (void) fprintf (stderr, "Stage 3...\n");
-    /*							*/
-    /* Stage 3. Approximate real pixel colour with colour	*/
-    /*	from 8 bit palette.				*/
-    /*    That's where various approximation techniques	*/
-    /* 	can lead to different calculation speeds.	*/
-    for (cnt_pixel = 0; cnt_pixel < image_size; cnt_pixel++)
-    {
-	min_norm = MAX_NORM;
-	colour_num = 0;
-	cnt1 = cnt_pixel * stride24;
-	red = image_reds[cnt1];
-	green = image_greens[cnt1];
-	blue = image_blues[cnt1];
-	for (cnt_colour = 0; cnt_colour < max_colours; cnt_colour++)
+	if (total < 1.0) total = 1.0;
+	palette_reds[count] = (int) (red / total + 0.5);
+	palette_greens[count] = (int) (green / total + 0.5);
+	palette_blues[count] = (int) (blue / total + 0.5);
+    }
+    return (num_boxes);
+}   /*  End Function median_cut  */
+
+static void shrink_box (CONST cell_type *cells, box_type *box)
+/*  [SUMMARY] Shrink a box to the populated cells it contains.
+    <cells> The colour histogram.
+    <box> The box. Its pixel count is also computed.
+    [RETURNS] Nothing.
+*/
+{
+    int axis, red, green, blue;
+    int lo[3], hi[3];
+    unsigned long count;
+    CONST cell_type *cell;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+	lo[axis] = 32;
+	hi[axis] = -1;
+    }
+    box->count = 0;
+    for (red = box->lo[0]; red <= box->hi[0]; ++red)
+	for (green = box->lo[1]; green <= box->hi[1]; ++green)
+    {
+	cell = cells + (red << 10 | green << 5);
+	for (blue = box->lo[2]; blue <= box->hi[2]; ++blue)
 	{
-	    norm_red = (int) red - (int) palette_reds[cnt_colour];
-	    norm_green = (int) green - (int) palette_greens[cnt_colour];
-	    norm_blue = (int) blue - (int) palette_blues[cnt_colour];
-	    norm = norm_red*norm_red+norm_green*norm_green+norm_blue*norm_blue;
-	    if (norm < MIN_COLOUR_DIFFERENCE)
-	    {
-		colour_num = cnt_colour;
-		cnt_colour = max_colours;
-		continue;
-	    }
-	    if (norm < min_norm)
-	    {
-		min_norm = norm;
-		colour_num = cnt_colour;
-	    }
+	    if ( ( count = cell[blue].count ) < 1 ) continue;
+	    box->count += count;
+	    if (red < lo[0]) lo[0] = red;
+	    if (red > hi[0]) hi[0] = red;
+	    if (green < lo[1]) lo[1] = green;
+	    if (green > hi[1]) hi[1] = green;
+	    if (blue < lo[2]) lo[2] = blue;
+	    if (blue > hi[2]) hi[2] = blue;
+	}
+    }
+    /*  An empty box cannot be split further  */
+    if (box->count < 1) return;
+    for (axis = 0; axis < 3; ++axis)
+    {
+	box->lo[axis] = lo[axis];
+	box->hi[axis] = hi[axis];
+    }
+}   /*  End Function shrink_box  */
+
+static void refine_palette (CONST cell_type *cells, unsigned int num_colours,
+			    unsigned char *palette_reds,
+			    unsigned char *palette_greens,
+			    unsigned char *palette_blues)
+/*  [SUMMARY] Perform one k-means iteration on a colour palette.
+    [PURPOSE] This routine will assign the pixels in each populated cell of the
+    colour histogram to the closest palette colour and then move each palette
+    colour to the mean colour of its pixels.
+    <cells> The colour histogram.
+    <num_colours> The number of colours in the palette.
+    <palette_reds> The palette red components. These are updated.
+    <palette_greens> The palette green components. These are updated.
+    <palette_blues> The palette blue components. These are updated.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count, colour;
+    double total;
+    CONST cell_type *cell;
+    double reds[MAX_COLOURS], greens[MAX_COLOURS], blues[MAX_COLOURS];
+    double totals[MAX_COLOURS];
+
+    for (colour = 0; colour < num_colours; ++colour)
+    {
+	reds[colour] = 0.0;
+	greens[colour] = 0.0;
+	blues[colour] = 0.0;
+	totals[colour] = 0.0;
+    }
+    for (count = 0, cell = cells; count < NUM_CELLS; ++count, ++cell)
+    {
+	if (cell->count < 1) continue;
+	total = (double) cell->count;
+	colour = find_closest ( (int) (cell->red / total + 0.5),
+				(int) (cell->green / total + 0.5),
+				(int) (cell->blue / total + 0.5),
+				num_colours, palette_reds, palette_greens,
+				palette_blues );
+	reds[colour] += cell->red;
+	greens[colour] += cell->green;
+	blues[colour] += cell->blue;
+	totals[colour] += total;
+    }
+    for (colour = 0; colour < num_colours; ++colour)
+    {
+	/*  Leave unused colours where they are  */
+	if ( ( total = totals[colour] ) < 1.0 ) continue;
+	palette_reds[colour] = (int) (reds[colour] / total + 0.5);
+	palette_greens[colour] = (int) (greens[colour] / total + 0.5);
+	palette_blues[colour] = (int) (blues[colour] / total + 0.5);
+    }
+}   /*  End Function refine_palette  */
+
+static unsigned int find_closest (int red, int green, int blue,
+				  unsigned int num_colours,
+				  CONST unsigned char *palette_reds,
+				  CONST unsigned char *palette_greens,
+				  CONST unsigned char *palette_blues)
+/*  [SUMMARY] Find the closest palette colour to a colour.
+    <red> The red component.
+    <green> The green component.
+    <blue> The blue component.
+    <num_colours> The number of colours in the palette.
+    <palette_reds> The palette red components.
+    <palette_greens> The palette green components.
+    <palette_blues> The palette blue components.
+    [RETURNS] The index of the closest palette colour.
+*/
+{
+    int norm, norm_red, norm_green, norm_blue;
+    int min_norm = MAX_NORM;
+    unsigned int count, colour_num = 0;
+
+    for (count = 0; count < num_colours; ++count)
+    {
+	norm_red = red - (int) palette_reds[count];
+	norm_green = green - (int) palette_greens[count];
+	norm_blue = blue - (int) palette_blues[count];
+	norm = norm_red*norm_red + norm_green*norm_green + norm_blue*norm_blue;
+	if (norm < min_norm)
+	{
+	    min_norm = norm;
+	    colour_num = count;
+	}
+    }
+    return (colour_num);
+}   /*  End Function find_closest  */
+
+static void lut_job_func (void *pool_info,
+			  void *call_info1, void *call_info2,
+			  void *call_info3, void *call_info4,
+			  void *thread_info)
+/*  [SUMMARY] Compute a plane of the inverse colourmap lookup table.
+    [PURPOSE] This routine will find the closest palette colour for each cell
+    with a given red component. A populated cell is represented by the mean
+    colour of its pixels, otherwise by the centre of the cell.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The quantisation information.
+    <call_info2> Not used.
+    <call_info3> The red component of the cells (0 to 31).
+    <call_info4> Not used.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    quantise_info_type *info = (quantise_info_type *) call_info1;
+    int red = (uaddr) call_info3;
+    int green, blue, index;
+    double total;
+    CONST cell_type *cell;
+
+    for (green = 0; green < 32; ++green) for (blue = 0; blue < 32; ++blue)
+    {
+	index = red << 10 | green << 5 | blue;
+	cell = info->cells + index;
+	if (cell->count > 0)
+	{
+	    total = (double) cell->count;
+	    info->lut[index] =
+		find_closest ( (int) (cell->red / total + 0.5),
+			       (int) (cell->green / total + 0.5),
+			       (int) (cell->blue / total + 0.5),
+			       info->num_colours, info->palette_reds,
+			       info->palette_greens, info->palette_blues );
+	}
+	else
+	{
+	    info->lut[index] =
+		find_closest (red * 8 + 4, green * 8 + 4, blue * 8 + 4,
+			      info->num_colours, info->palette_reds,
+			      info->palette_greens, info->palette_blues);
+	}
+    }
+}   /*  End Function lut_job_func  */
+
+static void map_job_func (void *pool_info,
+			  void *call_info1, void *call_info2,
+			  void *call_info3, void *call_info4,
+			  void *thread_info)
+/*  [SUMMARY] Map a range of pixels to the colour palette.
+    <pool_info> The arbitrary pool information pointer.
+    <call_info1> The quantisation information.
+    <call_info2> Not used.
+    <call_info3> The first pixel.
+    <call_info4> The number of pixels.
+    <thread_info> The arbitrary thread information pointer.
+    [RETURNS] Nothing.
+*/
+{
+    quantise_info_type *info = (quantise_info_type *) call_info1;
+    unsigned int start = (uaddr) call_info3;
+    unsigned int num_pixels = (uaddr) call_info4;
+    unsigned int count, x, y, width;
+    int red, green, blue, offset;
+    int stride24 = info->stride24;
+    int stride8 = info->stride8;
+    CONST unsigned char *reds = info->image_reds + start * stride24;
+    CONST unsigned char *greens = info->image_greens + start * stride24;
+    CONST unsigned char *blues = info->image_blues + start * stride24;
+    unsigned char *out = info->out_image + start * stride8;
+    CONST unsigned char *lut = info->lut;
+
+    if ( ( width = info->width ) < 1 )
+    {
+	for (count = 0; count < num_pixels; ++count, reds += stride24,
+	     greens += stride24, blues += stride24, out += stride8)
+	{
+	    *out = lut[CELL_INDEX (*reds, *greens, *blues)];
+	}
+	return;
+    }
+    x = start % width;
+    y = start / width;
+    for (count = 0; count < num_pixels; ++count, reds += stride24,
+	 greens += stride24, blues += stride24, out += stride8)
+    {
+	offset = (2 * dither_matrix[y & 3][x & 3] - 15) * info->spread / 32;
+	red = (int) *reds + offset;
+	green = (int) *greens + offset;
+	blue = (int) *blues + offset;
+	if (red < 0) red = 0;
+	else if (red > MAX_INTENSITY) red = MAX_INTENSITY;
+	if (green < 0) green = 0;
+	else if (green > MAX_INTENSITY) green = MAX_INTENSITY;
+	if (blue < 0) blue = 0;
+	else if (blue > MAX_INTENSITY) blue = MAX_INTENSITY;
+	*out = lut[CELL_INDEX (red, green, blue)];
+	if (++x >= width)
+	{
+	    x = 0;
+	    ++y;
 	}
-	out_image[cnt_pixel * stride8] = colour_num;
-	if (cnt_pixel % 100000 == 0) (void) fprintf (stderr, ".");
-    }
-    (void) fprintf (stderr, "\n");
-    m_free( (char *) reds);
-    m_free( (char *) greens);
-    m_free( (char *) blues);
-    m_free( (char *) frequency);
-    return (max_colours);
-}   /*  End Function c_24_to_8_slow  */
+    }
+}   /*  End Function map_job_func  */
+
+static flag make_colourmap (unsigned int cmap_size,
+			    CONST unsigned char *palette_reds,
+			    CONST unsigned char *palette_greens,
+			    CONST unsigned char *palette_blues,
+			    packet_desc **pack_desc, char **packet)
+/*  [SUMMARY] Create a colourmap data structure from a colour palette.
+    <cmap_size> The number of colours in the palette.
+    <palette_reds> The palette red components.
+    <palette_greens> The palette green components.
+    <palette_blues> The palette blue components.
+    <pack_desc> The top level packet descriptor is written here.
+    <packet> The top level packet is written here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count;
+    unsigned short *cmap;
+    static char function_name[] = "__imc_make_colourmap";
+
+    if ( ( cmap = ds_cmap_alloc_colourmap (cmap_size, (multi_array **) NULL,
+					   pack_desc, packet) ) == NULL )
+    {
+	m_error_notify (function_name, "RGBcolourmap");
+	return (FALSE);
+    }
+    for (count = 0; count < cmap_size; ++count)
+    {
+	*cmap++ = palette_reds[count] << 8;
+	*cmap++ = palette_greens[count] << 8;
+	*cmap++ = palette_blues[count] << 8;
+    }
+    return (TRUE);
+}   /*  End Function make_colourmap  */
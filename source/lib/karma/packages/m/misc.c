@@ -322,6 +322,42 @@ void m_copy_and_swap_blocks (char *dest, CONST char *source, uaddr dest_stride,
     if (source == NULL)
     {
 	/*  In-situ  */
+	switch (block_size)
+	{
+	  case 2:
+	    for (; num_blocks > 0; --num_blocks, dest += dest_stride)
+	    {
+		tmp = dest[0];
+		dest[0] = dest[1];
+		dest[1] = tmp;
+	    }
+	    return;
+	    /*break;*/
+	  case 4:
+	    for (; num_blocks > 0; --num_blocks, dest += dest_stride)
+	    {
+		tmp = dest[0];
+		dest[0] = dest[3];
+		dest[3] = tmp;
+		tmp = dest[1];
+		dest[1] = dest[2];
+		dest[2] = tmp;
+	    }
+	    return;
+	    /*break;*/
+	  case 8:
+	    for (; num_blocks > 0; --num_blocks, dest += dest_stride)
+	    {
+		for (count = 0; count < 4; ++count)
+		{
+		    tmp = dest[count];
+		    dest[count] = dest[7 - count];
+		    dest[7 - count] = tmp;
+		}
+	    }
+	    return;
+	    /*break;*/
+	}
 	iter = block_size / 2;
 	/*  Loop over blocks  */
 	for (; num_blocks > 0; --num_blocks, dest += dest_stride)
@@ -344,6 +380,35 @@ void m_copy_and_swap_blocks (char *dest, CONST char *source, uaddr dest_stride,
 	(void) fprintf (stderr, "source_stride must be greater than zero\n");
 	prog_bug (function_name);
     }
+    /*  Common sizes have fixed-length loops which the compiler can unroll  */
+    switch (block_size)
+    {
+      case 2:
+	for (; num_blocks > 0;
+	     --num_blocks, dest += dest_stride, source += source_stride)
+	{
+	    dest[0] = source[1];
+	    dest[1] = source[0];
+	}
+	return;
+	/*break;*/
+      case 4:
+	for (; num_blocks > 0;
+	     --num_blocks, dest += dest_stride, source += source_stride)
+	{
+	    for (count = 0; count < 4; ++count) dest[count] = source[3 - count];
+	}
+	return;
+	/*break;*/
+      case 8:
+	for (; num_blocks > 0;
+	     --num_blocks, dest += dest_stride, source += source_stride)
+	{
+	    for (count = 0; count < 8; ++count) dest[count] = source[7 - count];
+	}
+	return;
+	/*break;*/
+    }
     /*  Loop over blocks  */
     for (; num_blocks > 0;
 	 --num_blocks, dest += dest_stride, source += source_stride)
@@ -55,25 +55,93 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <sys/time.h>
 #include <karma.h>
 #include <karma_n.h>
+#include <karma_m.h>
+#include <karma_a.h>
+#include <os.h>
 
-extern double drand48 ();
+
+/*  Cray PVP machines have no 32 bit integer type. The generator masks every
+    result to 32 bits, so a 64 bit unsigned long gives the same sequence  */
+#if !defined(Kword32u) && defined(MACHINE_crayPVP)
+#  define Kword32u unsigned long
+#endif
+
+#ifndef Kword32u
+***error no 32 bit integer available
+#endif
+
+/*  The generator is Philox4x32-10 (Salmon et al., "Parallel Random Numbers:
+    As Easy as 1, 2, 3", SC11). Each 128 bit counter is mapped to four 32 bit
+    words by ten rounds of a keyed bijection. The key is derived from the seed
+    and the counter holds the block number and the stream number, so the
+    value at any position of any stream may be computed directly, without
+    generating the values before it. This allows threads to generate disjoint
+    parts of a sequence independently and still produce the same result as a
+    single thread.
+*/
+
+#define STREAM_MAGIC_NUMBER (unsigned int) 1529870634
+
+#define VERIFY_STREAM(stream) if (stream == NULL) \
+{fprintf (stderr, "NULL stream passed\n"); \
+ a_prog_bug (function_name); } \
+if (stream->magic_number != STREAM_MAGIC_NUMBER) \
+{fprintf (stderr, "Invalid stream object\n"); \
+ a_prog_bug (function_name); }
+
+#define MASK32 (Kword32u) 0xffffffff
+#define PHILOX_M0 (Kword32u) 0xd2511f53
+#define PHILOX_M1 (Kword32u) 0xcd9e8d57
+#define PHILOX_W0 (Kword32u) 0x9e3779b9
+#define PHILOX_W1 (Kword32u) 0xbb67ae85
+#define PHILOX_ROUNDS 10
+#define TWO_TO_32 4294967296.0
+
+struct randomstream_type
+{
+    unsigned int magic_number;
+    Kword32u key[2];
+    Kword32u stream[2];
+    uaddr position;
+    uaddr block;        /*  The block held in <<words>>  */
+    flag have_block;
+    Kword32u words[4];
+};
+
+
+/*  Private functions  */
+STATIC_FUNCTION (void compute_block, (KRandomStream stream, uaddr block) );
+STATIC_FUNCTION (double word_to_uniform, (Kword32u word) );
+STATIC_FUNCTION (double words_to_gaussian,
+		 (CONST Kword32u *words, unsigned int lane) );
+STATIC_FUNCTION (void set_key,
+		 (KRandomStream stream, unsigned long seed,
+		  unsigned long stream_number) );
+STATIC_FUNCTION (KRandomStream get_default_stream, () );
+
+
+/*  Private data  */
+static struct randomstream_type default_stream;
+static flag default_stream_seeded = FALSE;
+
+
+/*  Public functions follow  */
 
 /*PUBLIC_FUNCTION*/
 double n_gaussian ()
 /*  [SUMMARY] Compute a random number with Gaussian distribution.
     [PURPOSE] This routine will compute a random number with a Gaussian
     distribution. The mean is 0.0 and the variance is 1.0
+    [MT-LEVEL] Unsafe. Use [<n_stream_gaussian>] with a stream per thread
+    instead.
     [RETURNS] The number.
 */
 {   
-    double val = -6.0;
-    int i;
-
-    for (i = 0; i < 12; i++) val += n_uniform ();
-    return (val);
+    return ( n_stream_gaussian ( get_default_stream () ) );
 }   /*  End Function n_gaussian  */
 
 /*PUBLIC_FUNCTION*/
@@ -81,30 +149,337 @@ double n_uniform ()
 /*  [SUMMARY] Compute a random number with Uniform distribution.
     [PURPOSE] This routine will compute a random number with a Uniform
     distribution. The range is from 0.0 to 1.0
+    [MT-LEVEL] Unsafe. Use [<n_stream_uniform>] with a stream per thread
+    instead.
     [RETURNS] The number.
 */
 {   
+    return ( n_stream_uniform ( get_default_stream () ) );
+}   /*  End Function n_uniform  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void n_set_seed (unsigned long seed)
+/*  [SUMMARY] Seed the default random number sequence.
+    [PURPOSE] This routine will seed the sequence used by [<n_uniform>] and
+    [<n_gaussian>] and restart it. If this is not called, the sequence is
+    seeded from the time of day when first used.
+    <seed> The seed.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] Nothing.
+*/
+{
+    KRandomStream stream = &default_stream;
+
+    stream->magic_number = STREAM_MAGIC_NUMBER;
+    set_key (stream, seed, 0);
+    stream->position = 0;
+    stream->have_block = FALSE;
+    default_stream_seeded = TRUE;
+}   /*  End Function n_set_seed  */
+
+/*EXPERIMENTAL_FUNCTION*/
+KRandomStream n_create_stream (unsigned long seed,
+			       unsigned long stream_number)
+/*  [SUMMARY] Create a random number stream.
+    [PURPOSE] This routine will create a random number stream. Streams with
+    the same seed and different stream numbers are statistically independent,
+    so each thread (or each job) may use its own stream. Streams with the same
+    seed and stream number produce the same sequence.
+    <seed> The seed.
+    <stream_number> The stream number.
+    [MT-LEVEL] Safe.
+    [RETURNS] A stream on success, else NULL.
+*/
+{
+    KRandomStream stream;
+    static char function_name[] = "n_create_stream";
+
+    if ( ( stream = (KRandomStream) m_alloc (sizeof *stream) ) == NULL )
+    {
+	m_error_notify (function_name, "random stream");
+	return (NULL);
+    }
+    stream->magic_number = STREAM_MAGIC_NUMBER;
+    set_key (stream, seed, stream_number);
+    stream->position = 0;
+    stream->have_block = FALSE;
+    return (stream);
+}   /*  End Function n_create_stream  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void n_destroy_stream (KRandomStream stream)
+/*  [SUMMARY] Destroy a random number stream.
+    <stream> The stream.
+    [MT-LEVEL] Safe.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "n_destroy_stream";
+
+    VERIFY_STREAM (stream);
+    stream->magic_number = 0;
+    m_free ( (char *) stream );
+}   /*  End Function n_destroy_stream  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void n_stream_seek (KRandomStream stream, uaddr position)
+/*  [SUMMARY] Move to a position in a random number stream.
+    [PURPOSE] This routine will set the position of the next number to be
+    generated from a stream. This takes constant time, so threads may each
+    generate a part of a long sequence by seeking to the start of their part.
+    <stream> The stream.
+    <position> The position.
+    [MT-LEVEL] Safe per stream.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "n_stream_seek";
+
+    VERIFY_STREAM (stream);
+    stream->position = position;
+}   /*  End Function n_stream_seek  */
+
+/*EXPERIMENTAL_FUNCTION*/
+double n_stream_uniform (KRandomStream stream)
+/*  [SUMMARY] Compute a random number with Uniform distribution from a stream.
+    <stream> The stream.
+    [MT-LEVEL] Safe per stream.
+    [RETURNS] The number, which is greater than 0.0 and less than 1.0
+*/
+{
+    uaddr position;
+    static char function_name[] = "n_stream_uniform";
+
+    VERIFY_STREAM (stream);
+    position = stream->position++;
+    compute_block (stream, position >> 2);
+    return ( word_to_uniform (stream->words[position & 3]) );
+}   /*  End Function n_stream_uniform  */
+
+/*EXPERIMENTAL_FUNCTION*/
+double n_stream_gaussian (KRandomStream stream)
+/*  [SUMMARY] Compute a random number with Gaussian distribution from a stream.
+    <stream> The stream.
+    [MT-LEVEL] Safe per stream.
+    [RETURNS] The number. The mean is 0.0 and the variance is 1.0
+*/
+{
+    uaddr position;
+    static char function_name[] = "n_stream_gaussian";
+
+    VERIFY_STREAM (stream);
+    position = stream->position++;
+    compute_block (stream, position >> 2);
+    return ( words_to_gaussian (stream->words, position & 3) );
+}   /*  End Function n_stream_gaussian  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void n_fill_uniform (KRandomStream stream, double *values, uaddr num_values)
+/*  [SUMMARY] Fill an array with random numbers with Uniform distribution.
+    [PURPOSE] This routine will fill an array with random numbers from a
+    stream. The result is the same as calling [<n_stream_uniform>]
+    <<num_values>> times, but is faster.
+    <stream> The stream.
+    <values> The numbers are written here. These are greater than 0.0 and
+    less than 1.0
+    <num_values> The number of values to write.
+    [MT-LEVEL] Safe per stream.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int lane;
+    uaddr count;
+    static char function_name[] = "n_fill_uniform";
+
+    VERIFY_STREAM (stream);
+    for (count = 0; count < num_values; )
+    {
+	compute_block (stream, stream->position >> 2);
+	for (lane = stream->position & 3; (lane < 4) && (count < num_values);
+	     ++lane, ++count, ++stream->position)
+	{
+	    values[count] = word_to_uniform (stream->words[lane]);
+	}
+    }
+}   /*  End Function n_fill_uniform  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void n_fill_gaussian (KRandomStream stream, double *values, uaddr num_values)
+/*  [SUMMARY] Fill an array with random numbers with Gaussian distribution.
+    [PURPOSE] This routine will fill an array with random numbers from a
+    stream, using the Box-Muller transform. The result is the same as calling
+    [<n_stream_gaussian>] <<num_values>> times, but is faster.
+    <stream> The stream.
+    <values> The numbers are written here. The mean is 0.0 and the variance
+    is 1.0
+    <num_values> The number of values to write.
+    [MT-LEVEL] Safe per stream.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int lane;
+    uaddr count;
+    double radius0, radius1, angle0, angle1;
+    static char function_name[] = "n_fill_gaussian";
+
+    VERIFY_STREAM (stream);
+    for (count = 0; count < num_values; )
+    {
+	compute_block (stream, stream->position >> 2);
+	if ( ( (stream->position & 3) == 0 ) && (num_values - count >= 4) )
+	{
+	    /*  Whole block: each transform yields two numbers  */
+	    radius0 = word_to_uniform (stream->words[0]);
+	    radius0 = sqrt (-2.0 * log (radius0) );
+	    angle0 = TWO_PI * word_to_uniform (stream->words[1]);
+	    radius1 = word_to_uniform (stream->words[2]);
+	    radius1 = sqrt (-2.0 * log (radius1) );
+	    angle1 = TWO_PI * word_to_uniform (stream->words[3]);
+	    values[count] = radius0 * cos (angle0);
+	    values[count + 1] = radius0 * sin (angle0);
+	    values[count + 2] = radius1 * cos (angle1);
+	    values[count + 3] = radius1 * sin (angle1);
+	    count += 4;
+	    stream->position += 4;
+	    continue;
+	}
+	for (lane = stream->position & 3; (lane < 4) && (count < num_values);
+	     ++lane, ++count, ++stream->position)
+	{
+	    values[count] = words_to_gaussian (stream->words, lane);
+	}
+    }
+}   /*  End Function n_fill_gaussian  */
+
+
+/*  Private functions follow  */
+
+static void compute_block (KRandomStream stream, uaddr block)
+/*  [SUMMARY] Compute a block of four random words for a stream.
+    <stream> The stream. The words are written to the stream.
+    <block> The block number.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int round;
+    Kword32u ctr0, ctr1, ctr2, ctr3, key0, key1;
+    Kword32u hi0, lo0, hi1, lo1;
+#ifndef Kword64u
+    Kword32u a_hi, a_lo, b_hi, b_lo, cross0, cross1, carry;
+#endif
+
+    if (stream->have_block && (stream->block == block) ) return;
+    ctr0 = block & MASK32;
+    /*  Split the shift so that it is defined for 32 bit addresses  */
+    ctr1 = ( (block >> 16) >> 16 ) & MASK32;
+    ctr2 = stream->stream[0];
+    ctr3 = stream->stream[1];
+    key0 = stream->key[0];
+    key1 = stream->key[1];
+    for (round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+#ifdef Kword64u
+	Kword64u product;
+
+	product = (Kword64u) PHILOX_M0 * (Kword64u) ctr0;
+	hi0 = (product >> 32) & MASK32;
+	lo0 = product & MASK32;
+	product = (Kword64u) PHILOX_M1 * (Kword64u) ctr2;
+	hi1 = (product >> 32) & MASK32;
+	lo1 = product & MASK32;
+#else
+	/*  Form the 64 bit products from 16 bit halves  */
+	a_hi = PHILOX_M0 >> 16;
+	a_lo = PHILOX_M0 & 0xffff;
+	b_hi = ctr0 >> 16;
+	b_lo = ctr0 & 0xffff;
+	cross0 = a_hi * b_lo;
+	cross1 = a_lo * b_hi;
+	lo0 = (a_lo * b_lo) & MASK32;
+	carry = ( (lo0 >> 16) + (cross0 & 0xffff) + (cross1 & 0xffff) ) >> 16;
+	hi0 = (a_hi * b_hi + (cross0 >> 16) + (cross1 >> 16) + carry) & MASK32;
+	lo0 = (PHILOX_M0 * ctr0) & MASK32;
+	a_hi = PHILOX_M1 >> 16;
+	a_lo = PHILOX_M1 & 0xffff;
+	b_hi = ctr2 >> 16;
+	b_lo = ctr2 & 0xffff;
+	cross0 = a_hi * b_lo;
+	cross1 = a_lo * b_hi;
+	lo1 = (a_lo * b_lo) & MASK32;
+	carry = ( (lo1 >> 16) + (cross0 & 0xffff) + (cross1 & 0xffff) ) >> 16;
+	hi1 = (a_hi * b_hi + (cross0 >> 16) + (cross1 >> 16) + carry) & MASK32;
+	lo1 = (PHILOX_M1 * ctr2) & MASK32;
+#endif
+	ctr0 = hi1 ^ ctr1 ^ key0;
+	ctr1 = lo1;
+	ctr2 = hi0 ^ ctr3 ^ key1;
+	ctr3 = lo0;
+	key0 = (key0 + PHILOX_W0) & MASK32;
+	key1 = (key1 + PHILOX_W1) & MASK32;
+    }
+    stream->words[0] = ctr0;
+    stream->words[1] = ctr1;
+    stream->words[2] = ctr2;
+    stream->words[3] = ctr3;
+    stream->block = block;
+    stream->have_block = TRUE;
+}   /*  End Function compute_block  */
+
+static double word_to_uniform (Kword32u word)
+/*  [SUMMARY] Convert a random word to a number in the open interval (0, 1).
+    <word> The random word.
+    [RETURNS] The number.
+*/
+{
+    return ( ( (double) word + 0.5 ) / TWO_TO_32 );
+}   /*  End Function word_to_uniform  */
+
+static double words_to_gaussian (CONST Kword32u *words, unsigned int lane)
+/*  [SUMMARY] Compute one number with Gaussian distribution from a block.
+    [PURPOSE] This routine will apply the Box-Muller transform to a pair of
+    words in a block. Lanes 0 and 1 use words 0 and 1, and lanes 2 and 3 use
+    words 2 and 3.
+    <words> The block of four random words.
+    <lane> The lane within the block.
+    [RETURNS] The number.
+*/
+{
+    double radius, angle;
+
+    radius = sqrt ( -2.0 * log ( word_to_uniform (words[lane & 2]) ) );
+    angle = TWO_PI * word_to_uniform (words[(lane & 2) + 1]);
+    return ( (lane & 1) ? radius * sin (angle) : radius * cos (angle) );
+}   /*  End Function words_to_gaussian  */
+
+static void set_key (KRandomStream stream, unsigned long seed,
+		     unsigned long stream_number)
+/*  [SUMMARY] Set the key and stream number of a stream.
+    <stream> The stream.
+    <seed> The seed.
+    <stream_number> The stream number.
+    [RETURNS] Nothing.
+*/
+{
+    /*  Split the shifts so that they are defined for 32 bit longs  */
+    stream->key[0] = seed & MASK32;
+    stream->key[1] = ( (seed >> 16) >> 16 ) & MASK32;
+    stream->stream[0] = stream_number & MASK32;
+    stream->stream[1] = ( (stream_number >> 16) >> 16 ) & MASK32;
+}   /*  End Function set_key  */
+
+static KRandomStream get_default_stream ()
+/*  [SUMMARY] Get the default stream, seeding it from the time if needed.
+    [RETURNS] The default stream.
+*/
+{
     struct timeval tv;
     struct timezone tz;
-#ifdef OS_ConvexOS
-    long val = 0x7fffffff;
-#endif
-    static int first_time = TRUE;
 
-    if (first_time)
+    if (!default_stream_seeded)
     {
-	first_time = FALSE; 
 	gettimeofday (&tv, &tz);
 	tv.tv_sec ^= tv.tv_usec;
-#ifdef OS_ConvexOS
-	srandom (tv.tv_sec);
-#else
-	srand48 (tv.tv_sec);
-#endif
+	n_set_seed ( (unsigned long) tv.tv_sec );
     }
-#ifdef OS_ConvexOS
-    return ( (double) random () / (double) val );
-#else
-    return ( drand48 () );
-#endif
-}   /*  End Function n_uniform  */
+    return (&default_stream);
+}   /*  End Function get_default_stream  */
@@ -0,0 +1,1061 @@
+/*LINTLIBRARY*/
+/*  filter.c
+
+    This code provides image data encoders for PostScript and PDF output.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains the routines which encode image data for the psw_
+    package. The data may be compressed using the RunLength or Flate (zlib)
+    methods and the result may be written in binary or encoded with ASCII85.
+    Data may also be written with the ASCIIHex encoding. These are the formats
+    read by the standard PostScript (Level 2, or Level 3 for Flate) and PDF
+    decode filters.
+    The Flate compressor codes each block of input independently, with a
+    hash-chained LZ77 search and whichever of dynamic Huffman codes, fixed
+    Huffman codes or stored data is smallest for the block.
+
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <karma.h>
+#include <karma_psw.h>
+#include <karma_ch.h>
+#include <karma_m.h>
+#include <karma_a.h>
+
+
+#define FILTER_MAGIC_NUMBER (unsigned int) 1803726045
+
+#define VERIFY_FILTER(filter) if (filter == NULL) \
+{(void) fprintf (stderr, "NULL filter passed\n"); \
+ a_prog_bug (function_name); } \
+if (filter->magic_number != FILTER_MAGIC_NUMBER) \
+{(void) fprintf (stderr, "Invalid filter object\n"); \
+ a_prog_bug (function_name); }
+
+#define OUTPUT_BUFFER_SIZE 4096
+#define CODED_BUFFER_SIZE 4096
+#define LINE_LENGTH 72
+#define BLOCK_SIZE 32768
+#define HASH_BITS 14
+#define HASH_SIZE (1 << HASH_BITS)
+#define MAX_CHAIN 32
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define MAX_CODE_LENGTH 15
+#define MAX_CL_CODE_LENGTH 7
+#define NUM_LITLEN_CODES 286
+#define NUM_FIXED_LITLEN_CODES 288  /*  Two codes are never used  */
+#define NUM_DIST_CODES 30
+#define NUM_CL_CODES 19
+#define END_OF_BLOCK 256
+#define ADLER_BASE 65521
+#define ADLER_MAX_RUN 5552
+#define MAX_RUN 128
+
+#define HASH(p) ( ( ( (unsigned int) (p)[0] << 10 ) ^ \
+		    ( (unsigned int) (p)[1] << 5 ) ^ (p)[2] ) & \
+		  (HASH_SIZE - 1) )
+
+struct psw_filter_type
+{
+    unsigned int magic_number;
+    Channel channel;
+    unsigned int encoding;
+    flag ascii;
+    /*  Compressed data waiting for the ASCII (or binary) stage  */
+    unsigned char coded[CODED_BUFFER_SIZE];
+    unsigned int coded_length;
+    /*  Output waiting to be written to the channel  */
+    char out[OUTPUT_BUFFER_SIZE];
+    unsigned int out_length;
+    unsigned int column;
+    /*  ASCII85 state  */
+    unsigned char tuple[4];
+    unsigned int tuple_length;
+    /*  Flate state  */
+    unsigned char *block;
+    unsigned int block_length;
+    unsigned short *token_litlen;
+    unsigned short *token_dist;
+    int *head;
+    int *prev;
+    unsigned long adler_a;
+    unsigned long adler_b;
+    unsigned long bit_buffer;
+    unsigned int bit_count;
+    unsigned char length_code[MAX_MATCH + 1];
+};
+
+typedef struct
+{
+    unsigned short code[NUM_FIXED_LITLEN_CODES];
+    unsigned char length[NUM_FIXED_LITLEN_CODES];
+} HuffmanTable;
+
+
+/*  Private data  */
+static CONST unsigned short length_base[29] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static CONST unsigned char length_extra[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static CONST unsigned short dist_base[NUM_DIST_CODES] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static CONST unsigned char dist_extra[NUM_DIST_CODES] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static CONST unsigned char cl_order[NUM_CL_CODES] =
+{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+static CONST char hex_digits[] = "0123456789abcdef";
+
+
+/*  Private functions  */
+STATIC_FUNCTION (void free_filter, (PostScriptFilter filter) );
+STATIC_FUNCTION (flag write_coded,
+		 (PostScriptFilter filter, CONST unsigned char *data,
+		  uaddr length) );
+STATIC_FUNCTION (flag flush_coded, (PostScriptFilter filter) );
+STATIC_FUNCTION (flag put_char, (PostScriptFilter filter, char ch) );
+STATIC_FUNCTION (flag flush_output, (PostScriptFilter filter) );
+STATIC_FUNCTION (flag encode_tuple, (PostScriptFilter filter, flag final) );
+STATIC_FUNCTION (flag runlength_encode,
+		 (PostScriptFilter filter, CONST unsigned char *data,
+		  uaddr length) );
+STATIC_FUNCTION (flag deflate_block, (PostScriptFilter filter, flag final) );
+STATIC_FUNCTION (flag put_bits,
+		 (PostScriptFilter filter, unsigned int value,
+		  unsigned int num_bits) );
+STATIC_FUNCTION (unsigned int get_dist_code, (unsigned int dist) );
+STATIC_FUNCTION (void build_lengths,
+		 (CONST unsigned long *freqs, unsigned int num_symbols,
+		  unsigned int max_length, unsigned char *lengths) );
+STATIC_FUNCTION (void build_codes,
+		 (CONST unsigned char *lengths, unsigned int num_symbols,
+		  unsigned short *codes) );
+STATIC_FUNCTION (unsigned int encode_code_lengths,
+		 (CONST unsigned char *lengths, unsigned int num_lengths,
+		  unsigned char *symbols, unsigned char *extras) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+PostScriptFilter psw_filter_create (Channel channel, unsigned int encoding,
+				    flag ascii)
+/*  [SUMMARY] Create an encoder for image data.
+    <channel> The channel to write encoded data to.
+    <encoding> The encoding. See [<PSW_ENCODINGS>] for a list of encodings.
+    <ascii> If TRUE, compressed data are encoded with ASCII85, else they are
+    written in binary. This is ignored for the ASCIIHex and ASCII85 encodings.
+    [MT-LEVEL] Safe.
+    [RETURNS] A filter object on success, else NULL.
+*/
+{
+    unsigned int code, length;
+    PostScriptFilter filter;
+    static char function_name[] = "psw_filter_create";
+
+    if (encoding > PSW_ENCODING_FLATE)
+    {
+	(void) fprintf (stderr, "Illegal encoding: %u\n", encoding);
+	a_prog_bug (function_name);
+    }
+    FLAG_VERIFY (ascii);
+    if ( ( filter = (PostScriptFilter) m_alloc (sizeof *filter) ) == NULL )
+    {
+	m_error_notify (function_name, "filter object");
+	return (NULL);
+    }
+    filter->channel = channel;
+    filter->encoding = encoding;
+    if ( (encoding == PSW_ENCODING_HEX) ||
+	 (encoding == PSW_ENCODING_ASCII85) ) ascii = TRUE;
+    filter->ascii = ascii;
+    filter->coded_length = 0;
+    filter->out_length = 0;
+    filter->column = 0;
+    filter->tuple_length = 0;
+    filter->block = NULL;
+    filter->token_litlen = NULL;
+    filter->token_dist = NULL;
+    filter->head = NULL;
+    filter->prev = NULL;
+    if (encoding == PSW_ENCODING_FLATE)
+    {
+	filter->block = (unsigned char *) m_alloc (BLOCK_SIZE);
+	filter->token_litlen = (unsigned short *)
+	    m_alloc (sizeof *filter->token_litlen * BLOCK_SIZE);
+	filter->token_dist = (unsigned short *)
+	    m_alloc (sizeof *filter->token_dist * BLOCK_SIZE);
+	filter->head = (int *) m_alloc (sizeof *filter->head * HASH_SIZE);
+	filter->prev = (int *) m_alloc (sizeof *filter->prev * BLOCK_SIZE);
+	if ( (filter->block == NULL) || (filter->token_litlen == NULL) ||
+	     (filter->token_dist == NULL) || (filter->head == NULL) ||
+	     (filter->prev == NULL) )
+	{
+	    m_error_notify (function_name, "compression buffers");
+	    free_filter (filter);
+	    return (NULL);
+	}
+	filter->block_length = 0;
+	filter->adler_a = 1;
+	filter->adler_b = 0;
+	filter->bit_buffer = 0;
+	filter->bit_count = 0;
+	for (code = 0; code < 29; ++code)
+	{
+	    for (length = length_base[code];
+		 (length < length_base[code] + (1 << length_extra[code]) ) &&
+		     (length <= MAX_MATCH);
+		 ++length) filter->length_code[length] = code;
+	}
+	/*  zlib header: deflate with a 32 kByte window, no dictionary  */
+	filter->coded[0] = 0x78;
+	filter->coded[1] = 0x01;
+	filter->coded_length = 2;
+    }
+    filter->magic_number = FILTER_MAGIC_NUMBER;
+    return (filter);
+}   /*  End Function psw_filter_create  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag psw_filter_write (PostScriptFilter filter, CONST unsigned char *data,
+		       uaddr length)
+/*  [SUMMARY] Write data to an encoder.
+    <filter> The filter object.
+    <data> The data.
+    <length> The number of bytes to write.
+    [MT-LEVEL] Safe per filter.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    uaddr num_bytes, count, run;
+    unsigned long a, b;
+    static char function_name[] = "psw_filter_write";
+
+    VERIFY_FILTER (filter);
+    switch (filter->encoding)
+    {
+      case PSW_ENCODING_HEX:
+      case PSW_ENCODING_ASCII85:
+	return ( write_coded (filter, data, length) );
+	/*break;*/
+      case PSW_ENCODING_RUNLENGTH:
+	return ( runlength_encode (filter, data, length) );
+	/*break;*/
+      case PSW_ENCODING_FLATE:
+	break;
+    }
+    /*  Update the Adler-32 checksum  */
+    a = filter->adler_a;
+    b = filter->adler_b;
+    for (count = 0; count < length; count += run)
+    {
+	run = (length - count > ADLER_MAX_RUN) ? ADLER_MAX_RUN :length -count;
+	for (num_bytes = 0; num_bytes < run; ++num_bytes)
+	{
+	    a += data[count + num_bytes];
+	    b += a;
+	}
+	a %= ADLER_BASE;
+	b %= ADLER_BASE;
+    }
+    filter->adler_a = a;
+    filter->adler_b = b;
+    /*  Fill and compress blocks  */
+    while (length > 0)
+    {
+	num_bytes = BLOCK_SIZE - filter->block_length;
+	if (num_bytes > length) num_bytes = length;
+	m_copy ( (char *) filter->block + filter->block_length,
+		 (CONST char *) data, num_bytes );
+	filter->block_length += num_bytes;
+	data += num_bytes;
+	length -= num_bytes;
+	if (filter->block_length >= BLOCK_SIZE)
+	{
+	    if ( !deflate_block (filter, FALSE) ) return (FALSE);
+	}
+    }
+    return (TRUE);
+}   /*  End Function psw_filter_write  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag psw_filter_close (PostScriptFilter filter)
+/*  [SUMMARY] Close an encoder.
+    [PURPOSE] This routine will write any buffered data and the end-of-data
+    markers of the encoding and will destroy the filter object.
+    <filter> The filter object.
+    [NOTE] No end-of-data marker is written for ASCIIHex data, since the
+    PostScript <<readhexstring>> operator does not expect one. PDF readers
+    require a '>' character to be written after the data.
+    [MT-LEVEL] Safe per filter.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag ok = TRUE;
+    unsigned char eod;
+    static char function_name[] = "psw_filter_close";
+
+    VERIFY_FILTER (filter);
+    switch (filter->encoding)
+    {
+      case PSW_ENCODING_RUNLENGTH:
+	eod = MAX_RUN;
+	ok = write_coded (filter, &eod, 1);
+	break;
+      case PSW_ENCODING_FLATE:
+	ok = deflate_block (filter, TRUE);
+	/*  Align to a byte and append the Adler-32 checksum  */
+	if ( ok && (filter->bit_count > 0) )
+	{
+	    ok = put_bits (filter, 0, 8 - filter->bit_count);
+	}
+	if (ok) ok = put_bits (filter, filter->adler_b >> 8 & 0xff, 8);
+	if (ok) ok = put_bits (filter, filter->adler_b & 0xff, 8);
+	if (ok) ok = put_bits (filter, filter->adler_a >> 8 & 0xff, 8);
+	if (ok) ok = put_bits (filter, filter->adler_a & 0xff, 8);
+	break;
+      default:
+	break;
+    }
+    if (ok) ok = flush_coded (filter);
+    if ( ok && (filter->encoding != PSW_ENCODING_HEX) && filter->ascii )
+    {
+	ok = encode_tuple (filter, TRUE);
+	if (ok) ok = put_char (filter, '~');
+	if (ok) ok = put_char (filter, '>');
+    }
+    if ( ok && filter->ascii && (filter->column > 0) )
+    {
+	ok = put_char (filter, '\n');
+    }
+    if (ok) ok = flush_output (filter);
+    filter->magic_number = 0;
+    free_filter (filter);
+    return (ok);
+}   /*  End Function psw_filter_close  */
+
+
+/*  Private functions follow  */
+
+static void free_filter (PostScriptFilter filter)
+/*  [SUMMARY] Free a filter object and its buffers without writing anything.
+    <filter> The filter object.
+    [RETURNS] Nothing.
+*/
+{
+    if (filter->block != NULL) m_free ( (char *) filter->block );
+    if (filter->token_litlen != NULL) m_free ( (char *) filter->token_litlen );
+    if (filter->token_dist != NULL) m_free ( (char *) filter->token_dist );
+    if (filter->head != NULL) m_free ( (char *) filter->head );
+    if (filter->prev != NULL) m_free ( (char *) filter->prev );
+    m_free ( (char *) filter );
+}   /*  End Function free_filter  */
+
+static flag write_coded (PostScriptFilter filter, CONST unsigned char *data,
+			 uaddr length)
+/*  [SUMMARY] Write coded data to the ASCII (or binary) stage of a filter.
+    <filter> The filter object.
+    <data> The data.
+    <length> The number of bytes.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int num_bytes;
+
+    while (length > 0)
+    {
+	if (filter->coded_length >= CODED_BUFFER_SIZE)
+	{
+	    if ( !flush_coded (filter) ) return (FALSE);
+	}
+	num_bytes = CODED_BUFFER_SIZE - filter->coded_length;
+	if (num_bytes > length) num_bytes = length;
+	m_copy ( (char *) filter->coded + filter->coded_length,
+		 (CONST char *) data, num_bytes );
+	filter->coded_length += num_bytes;
+	data += num_bytes;
+	length -= num_bytes;
+    }
+    return (TRUE);
+}   /*  End Function write_coded  */
+
+static flag flush_coded (PostScriptFilter filter)
+/*  [SUMMARY] Encode the coded data of a filter into the output buffer.
+    <filter> The filter object.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count, byte;
+    CONST unsigned char *coded = filter->coded;
+
+    if (!filter->ascii)
+    {
+	if (filter->coded_length < 1) return (TRUE);
+	if ( !flush_output (filter) ) return (FALSE);
+	if (ch_write (filter->channel, (CONST char *) coded,
+		      filter->coded_length) < filter->coded_length)
+	{
+	    return (FALSE);
+	}
+	filter->coded_length = 0;
+	return (TRUE);
+    }
+    for (count = 0; count < filter->coded_length; ++count)
+    {
+	if (filter->encoding == PSW_ENCODING_HEX)
+	{
+	    byte = coded[count];
+	    if (filter->out_length + 3 > OUTPUT_BUFFER_SIZE)
+	    {
+		if ( !flush_output (filter) ) return (FALSE);
+	    }
+	    filter->out[filter->out_length++] = hex_digits[byte >> 4];
+	    filter->out[filter->out_length++] = hex_digits[byte & 0x0f];
+	    if ( (filter->column += 2) >= LINE_LENGTH )
+	    {
+		filter->out[filter->out_length++] = '\n';
+		filter->column = 0;
+	    }
+	    continue;
+	}
+	filter->tuple[filter->tuple_length++] = coded[count];
+	if (filter->tuple_length < 4) continue;
+	if ( !encode_tuple (filter, FALSE) ) return (FALSE);
+    }
+    filter->coded_length = 0;
+    return (TRUE);
+}   /*  End Function flush_coded  */
+
+static flag put_char (PostScriptFilter filter, char ch)
+/*  [SUMMARY] Write a character to the output buffer of a filter.
+    <filter> The filter object.
+    <ch> The character.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    if (filter->out_length + 2 > OUTPUT_BUFFER_SIZE)
+    {
+	if ( !flush_output (filter) ) return (FALSE);
+    }
+    filter->out[filter->out_length++] = ch;
+    if (ch == '\n') filter->column = 0;
+    else if (++filter->column >= LINE_LENGTH)
+    {
+	filter->out[filter->out_length++] = '\n';
+	filter->column = 0;
+    }
+    return (TRUE);
+}   /*  End Function put_char  */
+
+static flag flush_output (PostScriptFilter filter)
+/*  [SUMMARY] Write the output buffer of a filter to its channel.
+    <filter> The filter object.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    if (filter->out_length < 1) return (TRUE);
+    if (ch_write (filter->channel, filter->out,
+		  filter->out_length) < filter->out_length) return (FALSE);
+    filter->out_length = 0;
+    return (TRUE);
+}   /*  End Function flush_output  */
+
+static flag encode_tuple (PostScriptFilter filter, flag final)
+/*  [SUMMARY] Encode a group of up to four bytes with ASCII85.
+    <filter> The filter object.
+    <final> If TRUE, the group may be partial. This is the final group.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count, num_chars;
+    unsigned long value;
+    char chars[5];
+
+    if (filter->tuple_length < 1) return (TRUE);
+    for (count = filter->tuple_length; count < 4; ++count)
+    {
+	filter->tuple[count] = 0;
+    }
+    value = ( (unsigned long) filter->tuple[0] << 24 ) |
+	( (unsigned long) filter->tuple[1] << 16 ) |
+	( (unsigned long) filter->tuple[2] << 8 ) |
+	(unsigned long) filter->tuple[3];
+    num_chars = final ? filter->tuple_length + 1 : 5;
+    filter->tuple_length = 0;
+    if ( (value == 0) && (num_chars == 5) ) return ( put_char (filter, 'z') );
+    for (count = 5; count > 0; --count)
+    {
+	chars[count - 1] = '!' + value % 85;
+	value /= 85;
+    }
+    for (count = 0; count < num_chars; ++count)
+    {
+	if ( !put_char (filter, chars[count]) ) return (FALSE);
+    }
+    return (TRUE);
+}   /*  End Function encode_tuple  */
+
+static flag runlength_encode (PostScriptFilter filter,
+			      CONST unsigned char *data, uaddr length)
+/*  [SUMMARY] Compress data with the RunLength method.
+    <filter> The filter object.
+    <data> The data.
+    <length> The number of bytes.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    uaddr pos, literal_start, run;
+    unsigned char header;
+
+    literal_start = 0;
+    for (pos = 0; pos < length; )
+    {
+	for (run = 1;
+	     (pos + run < length) && (run < MAX_RUN) &&
+		 (data[pos + run] == data[pos]);
+	     ++run);
+	/*  A run of two is only worth coding if it doesn't split a literal  */
+	if ( (run < 3) && !( (run == 2) && (literal_start == pos) ) )
+	{
+	    pos += run;
+	    if (pos - literal_start < MAX_RUN) continue;
+	    run = 0;
+	}
+	/*  Write pending literals (at most MAX_RUN at a time)  */
+	while (literal_start < pos)
+	{
+	    header = (pos - literal_start > MAX_RUN) ?
+		MAX_RUN - 1 : pos - literal_start - 1;
+	    if ( !write_coded (filter, &header, 1) ) return (FALSE);
+	    if ( !write_coded (filter, data + literal_start,
+			       (uaddr) header + 1) ) return (FALSE);
+	    literal_start += (uaddr) header + 1;
+	}
+	if (run < 2) continue;
+	header = 257 - run;
+	if ( !write_coded (filter, &header, 1) ) return (FALSE);
+	if ( !write_coded (filter, data + pos, 1) ) return (FALSE);
+	pos += run;
+	literal_start = pos;
+    }
+    while (literal_start < length)
+    {
+	header = (length - literal_start > MAX_RUN) ?
+	    MAX_RUN - 1 : length - literal_start - 1;
+	if ( !write_coded (filter, &header, 1) ) return (FALSE);
+	if ( !write_coded (filter, data + literal_start,
+			   (uaddr) header + 1) ) return (FALSE);
+	literal_start += (uaddr) header + 1;
+    }
+    return (TRUE);
+}   /*  End Function runlength_encode  */
+
+static flag deflate_block (PostScriptFilter filter, flag final)
+/*  [SUMMARY] Compress the buffered block of a filter with the Flate method.
+    <filter> The filter object.
+    <final> If TRUE, this is the final block.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int candidate;
+    unsigned int pos, count, length, max_length, best_length, best_dist;
+    unsigned int chain, hash, num_tokens, code, sym, num_litlen, num_dist;
+    unsigned int num_cl_symbols, num_cl_codes;
+    unsigned long dynamic_bits, fixed_bits, stored_bits;
+    CONST unsigned char *block = filter->block;
+    unsigned short *token_litlen = filter->token_litlen;
+    unsigned short *token_dist = filter->token_dist;
+    unsigned long litlen_freqs[NUM_LITLEN_CODES];
+    unsigned long dist_freqs[NUM_DIST_CODES];
+    unsigned long cl_freqs[NUM_CL_CODES];
+    unsigned char lengths[NUM_LITLEN_CODES + NUM_DIST_CODES];
+    unsigned char cl_lengths[NUM_CL_CODES];
+    unsigned char cl_symbols[NUM_LITLEN_CODES + NUM_DIST_CODES];
+    unsigned char cl_extras[NUM_LITLEN_CODES + NUM_DIST_CODES];
+    unsigned short cl_codes[NUM_CL_CODES];
+    HuffmanTable litlen_table, dist_table;
+
+    /*  Find matches  */
+    for (hash = 0; hash < HASH_SIZE; ++hash) filter->head[hash] = -1;
+    num_tokens = 0;
+    for (pos = 0; pos < filter->block_length; )
+    {
+	best_length = 0;
+	best_dist = 0;
+	if (pos + MIN_MATCH <= filter->block_length)
+	{
+	    max_length = filter->block_length - pos;
+	    if (max_length > MAX_MATCH) max_length = MAX_MATCH;
+	    hash = HASH (block + pos);
+	    for (candidate = filter->head[hash], chain = 0;
+		 (candidate >= 0) && (chain < MAX_CHAIN);
+		 candidate = filter->prev[candidate], ++chain)
+	    {
+		if (block[candidate + best_length] != block[pos + best_length])
+		{
+		    continue;
+		}
+		for (length = 0; (length < max_length) &&
+			 (block[candidate + length] == block[pos + length]);
+		     ++length);
+		if (length > best_length)
+		{
+		    best_length = length;
+		    best_dist = pos - candidate;
+		    if (length >= max_length) break;
+		}
+	    }
+	    filter->prev[pos] = filter->head[hash];
+	    filter->head[hash] = pos;
+	}
+	if (best_length < MIN_MATCH)
+	{
+	    token_litlen[num_tokens] = block[pos];
+	    token_dist[num_tokens++] = 0;
+	    ++pos;
+	    continue;
+	}
+	token_litlen[num_tokens] = best_length;
+	token_dist[num_tokens++] = best_dist;
+	/*  Insert the positions covered by the match  */
+	for (count = 1; count < best_length; ++count)
+	{
+	    if (pos + count + MIN_MATCH > filter->block_length) break;
+	    hash = HASH (block + pos + count);
+	    filter->prev[pos + count] = filter->head[hash];
+	    filter->head[hash] = pos + count;
+	}
+	pos += best_length;
+    }
+    /*  Count symbols  */
+    for (sym = 0; sym < NUM_LITLEN_CODES; ++sym) litlen_freqs[sym] = 0;
+    for (sym = 0; sym < NUM_DIST_CODES; ++sym) dist_freqs[sym] = 0;
+    for (count = 0; count < num_tokens; ++count)
+    {
+	if (token_dist[count] == 0) ++litlen_freqs[ token_litlen[count] ];
+	else
+	{
+	    ++litlen_freqs[257 + filter->length_code[ token_litlen[count] ] ];
+	    ++dist_freqs[ get_dist_code (token_dist[count]) ];
+	}
+    }
+    litlen_freqs[END_OF_BLOCK] = 1;
+    /*  Some decoders require at least two codes in each tree  */
+    if (litlen_freqs[0] == 0) litlen_freqs[0] = 1;
+    if (dist_freqs[0] == 0) dist_freqs[0] = 1;
+    if (dist_freqs[1] == 0) dist_freqs[1] = 1;
+    build_lengths (litlen_freqs, NUM_LITLEN_CODES, MAX_CODE_LENGTH,
+		   litlen_table.length);
+    build_lengths (dist_freqs, NUM_DIST_CODES, MAX_CODE_LENGTH,
+		   dist_table.length);
+    for (num_litlen = NUM_LITLEN_CODES;
+	 litlen_table.length[num_litlen - 1] == 0; --num_litlen);
+    for (num_dist = NUM_DIST_CODES;
+	 dist_table.length[num_dist - 1] == 0; --num_dist);
+    m_copy ( (char *) lengths, (CONST char *) litlen_table.length,
+	     num_litlen );
+    m_copy ( (char *) lengths + num_litlen, (CONST char *) dist_table.length,
+	     num_dist );
+    num_cl_symbols = encode_code_lengths (lengths, num_litlen + num_dist,
+					  cl_symbols, cl_extras);
+    for (sym = 0; sym < NUM_CL_CODES; ++sym) cl_freqs[sym] = 0;
+    for (count = 0; count < num_cl_symbols; ++count)
+    {
+	++cl_freqs[ cl_symbols[count] ];
+    }
+    /*  The code length code must be complete, so use at least two codes  */
+    for (sym = 0, count = 0; sym < NUM_CL_CODES; ++sym)
+    {
+	if (cl_freqs[sym] > 0) ++count;
+    }
+    for (sym = 0; count < 2; ++sym)
+    {
+	if (cl_freqs[sym] > 0) continue;
+	cl_freqs[sym] = 1;
+	++count;
+    }
+    build_lengths (cl_freqs, NUM_CL_CODES, MAX_CL_CODE_LENGTH, cl_lengths);
+    for (num_cl_codes = NUM_CL_CODES;
+	 (num_cl_codes > 4) && (cl_lengths[ cl_order[num_cl_codes - 1] ] == 0);
+	 --num_cl_codes);
+    /*  Compute the cost of each block type  */
+    dynamic_bits = 3 + 5 + 5 + 4 + 3 * num_cl_codes;
+    for (count = 0; count < num_cl_symbols; ++count)
+    {
+	sym = cl_symbols[count];
+	dynamic_bits += cl_lengths[sym];
+	if (sym == 16) dynamic_bits += 2;
+	else if (sym == 17) dynamic_bits += 3;
+	else if (sym == 18) dynamic_bits += 7;
+    }
+    fixed_bits = 3;
+    for (sym = 0; sym < NUM_LITLEN_CODES; ++sym)
+    {
+	if (litlen_freqs[sym] == 0) continue;
+	length = (sym < 144) ? 8 : (sym < 256) ? 9 : (sym < 280) ? 7 : 8;
+	if (sym > END_OF_BLOCK) length += length_extra[sym - 257];
+	fixed_bits += litlen_freqs[sym] * length;
+	length = litlen_table.length[sym];
+	if (sym > END_OF_BLOCK) length += length_extra[sym - 257];
+	dynamic_bits += litlen_freqs[sym] * length;
+    }
+    for (sym = 0; sym < NUM_DIST_CODES; ++sym)
+    {
+	fixed_bits += dist_freqs[sym] * (5 + dist_extra[sym]);
+	dynamic_bits += dist_freqs[sym] * (dist_table.length[sym] +
+					   dist_extra[sym]);
+    }
+    stored_bits = 3 + 7 + 32 + 8 * (unsigned long) filter->block_length;
+    if ( (stored_bits <= fixed_bits) && (stored_bits <= dynamic_bits) )
+    {
+	/*  Stored block  */
+	if ( !put_bits (filter, final ? 1 : 0, 3) ) return (FALSE);
+	if (filter->bit_count > 0)
+	{
+	    if ( !put_bits (filter, 0, 8 - filter->bit_count) ) return (FALSE);
+	}
+	if ( !put_bits (filter, filter->block_length, 16) ) return (FALSE);
+	if ( !put_bits (filter, ~filter->block_length & 0xffff, 16) )
+	{
+	    return (FALSE);
+	}
+	if ( !write_coded (filter, block, filter->block_length) )
+	{
+	    return (FALSE);
+	}
+	filter->block_length = 0;
+	return (TRUE);
+    }
+    if (fixed_bits <= dynamic_bits)
+    {
+	for (sym = 0; sym < NUM_FIXED_LITLEN_CODES; ++sym)
+	{
+	    litlen_table.length[sym] = (sym < 144) ? 8 : (sym < 256) ? 9 :
+		(sym < 280) ? 7 : 8;
+	}
+	build_codes (litlen_table.length, NUM_FIXED_LITLEN_CODES,
+		     litlen_table.code);
+	for (sym = 0; sym < NUM_DIST_CODES; ++sym) dist_table.length[sym] = 5;
+	if ( !put_bits (filter, (final ? 1 : 0) | (1 << 1), 3) )
+	{
+	    return (FALSE);
+	}
+    }
+    else
+    {
+	build_codes (cl_lengths, NUM_CL_CODES, cl_codes);
+	if ( !put_bits (filter, (final ? 1 : 0) | (2 << 1), 3) ||
+	     !put_bits (filter, num_litlen - 257, 5) ||
+	     !put_bits (filter, num_dist - 1, 5) ||
+	     !put_bits (filter, num_cl_codes - 4, 4) ) return (FALSE);
+	for (count = 0; count < num_cl_codes; ++count)
+	{
+	    if ( !put_bits (filter, cl_lengths[ cl_order[count] ], 3) )
+	    {
+		return (FALSE);
+	    }
+	}
+	for (count = 0; count < num_cl_symbols; ++count)
+	{
+	    sym = cl_symbols[count];
+	    if ( !put_bits (filter, cl_codes[sym], cl_lengths[sym]) )
+	    {
+		return (FALSE);
+	    }
+	    if (sym == 16) length = 2;
+	    else if (sym == 17) length = 3;
+	    else if (sym == 18) length = 7;
+	    else continue;
+	    if ( !put_bits (filter, cl_extras[count], length) ) return (FALSE);
+	}
+	build_codes (litlen_table.length, NUM_LITLEN_CODES,
+		     litlen_table.code);
+    }
+    build_codes (dist_table.length, NUM_DIST_CODES, dist_table.code);
+    /*  Write the tokens  */
+    for (count = 0; count < num_tokens; ++count)
+    {
+	if (token_dist[count] == 0)
+	{
+	    sym = token_litlen[count];
+	    if ( !put_bits (filter, litlen_table.code[sym],
+			    litlen_table.length[sym]) ) return (FALSE);
+	    continue;
+	}
+	length = token_litlen[count];
+	code = filter->length_code[length];
+	if ( !put_bits (filter, litlen_table.code[257 + code],
+			litlen_table.length[257 + code]) ) return (FALSE);
+	if ( !put_bits (filter, length - length_base[code],
+			length_extra[code]) ) return (FALSE);
+	code = get_dist_code (token_dist[count]);
+	if ( !put_bits (filter, dist_table.code[code],
+			dist_table.length[code]) ) return (FALSE);
+	if ( !put_bits (filter, token_dist[count] - dist_base[code],
+			dist_extra[code]) ) return (FALSE);
+    }
+    if ( !put_bits (filter, litlen_table.code[END_OF_BLOCK],
+		    litlen_table.length[END_OF_BLOCK]) ) return (FALSE);
+    filter->block_length = 0;
+    return (TRUE);
+}   /*  End Function deflate_block  */
+
+static flag put_bits (PostScriptFilter filter, unsigned int value,
+		      unsigned int num_bits)
+/*  [SUMMARY] Write bits to the Flate output of a filter.
+    <filter> The filter object.
+    <value> The bits, least significant first.
+    <num_bits> The number of bits. This must not exceed 16.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned char byte;
+
+    filter->bit_buffer |= (unsigned long) (value & ( (1 << num_bits) - 1 ) )
+	<< filter->bit_count;
+    filter->bit_count += num_bits;
+    while (filter->bit_count >= 8)
+    {
+	byte = filter->bit_buffer & 0xff;
+	if (filter->coded_length < CODED_BUFFER_SIZE)
+	{
+	    filter->coded[filter->coded_length++] = byte;
+	}
+	else if ( !write_coded (filter, &byte, 1) ) return (FALSE);
+	filter->bit_buffer >>= 8;
+	filter->bit_count -= 8;
+    }
+    return (TRUE);
+}   /*  End Function put_bits  */
+
+static unsigned int get_dist_code (unsigned int dist)
+/*  [SUMMARY] Get the Flate code for a match distance.
+    <dist> The distance.
+    [RETURNS] The distance code.
+*/
+{
+    unsigned int low = 0, high = NUM_DIST_CODES - 1, mid;
+
+    while (low < high)
+    {
+	mid = (low + high + 1) / 2;
+	if (dist_base[mid] <= dist) low = mid;
+	else high = mid - 1;
+    }
+    return (low);
+}   /*  End Function get_dist_code  */
+
+static void build_lengths (CONST unsigned long *freqs,
+			   unsigned int num_symbols, unsigned int max_length,
+			   unsigned char *lengths)
+/*  [SUMMARY] Compute length-limited Huffman code lengths.
+    [PURPOSE] This routine will compute Huffman code lengths for a set of
+    symbol frequencies. If the longest code exceeds the limit, the frequencies
+    are flattened and the codes are computed again.
+    <freqs> The symbol frequencies.
+    <num_symbols> The number of symbols. This must not exceed
+    NUM_LITLEN_CODES.
+    <max_length> The maximum code length.
+    <lengths> The code lengths are written here. Unused symbols have length 0.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count, num_nodes, num_leaves, first, second, node, depth;
+    unsigned int max_depth;
+    unsigned long weights[NUM_LITLEN_CODES * 2];
+    int parents[NUM_LITLEN_CODES * 2];
+    flag active[NUM_LITLEN_CODES * 2];
+
+    for (count = 0; count < num_symbols; ++count)
+    {
+	weights[count] = freqs[count];
+    }
+    for (; ; )
+    {
+	num_leaves = 0;
+	for (count = 0; count < num_symbols; ++count)
+	{
+	    parents[count] = -1;
+	    active[count] = (weights[count] > 0) ? TRUE : FALSE;
+	    if (active[count]) ++num_leaves;
+	    lengths[count] = 0;
+	}
+	if (num_leaves < 2)
+	{
+	    for (count = 0; count < num_symbols; ++count)
+	    {
+		if (active[count]) lengths[count] = 1;
+	    }
+	    return;
+	}
+	/*  Repeatedly join the two lightest trees  */
+	for (num_nodes = num_symbols; num_leaves > 1;
+	     ++num_nodes, --num_leaves)
+	{
+	    first = second = num_nodes;
+	    for (node = 0; node < num_nodes; ++node)
+	    {
+		if (!active[node]) continue;
+		if ( (first == num_nodes) || (weights[node] < weights[first]) )
+		{
+		    second = first;
+		    first = node;
+		}
+		else if ( (second == num_nodes) ||
+			  (weights[node] < weights[second]) ) second = node;
+	    }
+	    weights[num_nodes] = weights[first] + weights[second];
+	    parents[num_nodes] = -1;
+	    active[num_nodes] = TRUE;
+	    parents[first] = num_nodes;
+	    parents[second] = num_nodes;
+	    active[first] = FALSE;
+	    active[second] = FALSE;
+	}
+	max_depth = 0;
+	for (count = 0; count < num_symbols; ++count)
+	{
+	    if (weights[count] == 0) continue;
+	    for (depth = 0, node = count; parents[node] >= 0;
+		 node = parents[node], ++depth);
+	    lengths[count] = depth;
+	    if (depth > max_depth) max_depth = depth;
+	}
+	if (max_depth <= max_length) return;
+	for (count = 0; count < num_symbols; ++count)
+	{
+	    if (weights[count] > 0) weights[count] = (weights[count] + 1) / 2;
+	}
+    }
+}   /*  End Function build_lengths  */
+
+static void build_codes (CONST unsigned char *lengths,
+			 unsigned int num_symbols, unsigned short *codes)
+/*  [SUMMARY] Compute canonical Huffman codes from code lengths.
+    <lengths> The code lengths.
+    <num_symbols> The number of symbols.
+    <codes> The codes are written here, bit reversed for writing least
+    significant bit first.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count, bit, code, reversed;
+    unsigned int length_counts[MAX_CODE_LENGTH + 1];
+    unsigned int next_code[MAX_CODE_LENGTH + 1];
+
+    for (count = 0; count <= MAX_CODE_LENGTH; ++count)
+    {
+	length_counts[count] = 0;
+    }
+    for (count = 0; count < num_symbols; ++count)
+    {
+	++length_counts[ lengths[count] ];
+    }
+    length_counts[0] = 0;
+    code = 0;
+    for (count = 1; count <= MAX_CODE_LENGTH; ++count)
+    {
+	code = (code + length_counts[count - 1]) << 1;
+	next_code[count] = code;
+    }
+    for (count = 0; count < num_symbols; ++count)
+    {
+	if (lengths[count] == 0) continue;
+	code = next_code[lengths[count]]++;
+	for (bit = 0, reversed = 0; bit < lengths[count]; ++bit)
+	{
+	    reversed = (reversed << 1) | (code >> bit & 1);
+	}
+	codes[count] = reversed;
+    }
+}   /*  End Function build_codes  */
+
+static unsigned int encode_code_lengths (CONST unsigned char *lengths,
+					 unsigned int num_lengths,
+					 unsigned char *symbols,
+					 unsigned char *extras)
+/*  [SUMMARY] Run-length code a sequence of code lengths.
+    <lengths> The code lengths.
+    <num_lengths> The number of code lengths.
+    <symbols> The code length symbols are written here.
+    <extras> The extra bits for each symbol are written here.
+    [RETURNS] The number of symbols.
+*/
+{
+    unsigned int pos, run, num_symbols = 0;
+
+    for (pos = 0; pos < num_lengths; pos += run)
+    {
+	for (run = 1; (pos + run < num_lengths) &&
+		 (lengths[pos + run] == lengths[pos]); ++run);
+	if (lengths[pos] == 0)
+	{
+	    if (run > 138) run = 138;
+	    if (run >= 11)
+	    {
+		symbols[num_symbols] = 18;
+		extras[num_symbols++] = run - 11;
+		continue;
+	    }
+	    if (run >= 3)
+	    {
+		symbols[num_symbols] = 17;
+		extras[num_symbols++] = run - 3;
+		continue;
+	    }
+	    run = 1;
+	    symbols[num_symbols] = 0;
+	    extras[num_symbols++] = 0;
+	    continue;
+	}
+	/*  Write the length, then repeat it  */
+	symbols[num_symbols] = lengths[pos];
+	extras[num_symbols++] = 0;
+	if (run < 4)
+	{
+	    run = 1;
+	    continue;
+	}
+	if (run > 7) run = 7;
+	symbols[num_symbols] = 16;
+	extras[num_symbols++] = run - 4;
+    }
+    return (num_symbols);
+}   /*  End Function encode_code_lengths  */
@@ -99,12 +99,15 @@
 #include <karma_psw.h>
 #include <karma_ch.h>
 #include <karma_r.h>
+#include <karma_st.h>
 #include <karma_m.h>
 #include <karma_a.h>
 
 
 #define LINEWIDTH 0.1  /*  Measured in mm  */
 #define COLOUR_QUANTISATION 0.001  /*  Fraction of full-scale colour  */
+#define MAX_FONTS 16
+#define BEZIER_CIRCLE 0.5522847498  /*  Control point distance for arcs  */
 
 #if __STDC__ == 1
 #  define MAGIC_NUMBER 578942390U
@@ -126,6 +129,35 @@ typedef struct
     double blue;
 } PSColour;
 
+typedef struct
+{
+    CONST unsigned char *image;
+    CONST uaddr *xoffsets;
+    CONST uaddr *yoffsets;
+    CONST unsigned char *imap;
+} ImageComponent;
+
+/*  State for a page written as PDF. Objects are numbered from 1  */
+typedef struct
+{
+    unsigned long start_pos;
+    unsigned long *offsets;
+    unsigned int num_objects;
+    unsigned int max_objects;
+    unsigned long *contents;
+    unsigned int num_contents;
+    unsigned int max_contents;
+    unsigned long *images;
+    unsigned int num_images;
+    unsigned int max_images;
+    char *fonts[MAX_FONTS];
+    unsigned int num_fonts;
+    unsigned int stream_object;  /*  Open content stream, or 0  */
+    unsigned int stream_length_object;
+    unsigned long stream_start;
+    int bbox[4];
+} PDFState;
+
 /*  Internal definition of PostScriptPage object structure type  */
 struct pspage_type
 {
@@ -135,6 +167,8 @@ struct pspage_type
     flag portrait;
     flag eps;
     PSColour colour;
+    unsigned int image_encoding;
+    PDFState *pdf;  /*  NULL if writing PostScript  */
 };
 
 
@@ -142,10 +176,41 @@ struct pspage_type
 STATIC_FUNCTION (flag write_header,
 		 (PostScriptPage pspage,
 		  double hoffset, double voffset, double hsize,double vsize) );
-STATIC_FUNCTION (flag write_mono_line,
-		 (Channel channel, CONST unsigned char *line,
-		  unsigned int length, CONST uaddr *offsets, uaddr stride,
-		  CONST unsigned char imap[256], flag reverse) );
+STATIC_FUNCTION (flag write_image,
+		 (PostScriptPage pspage, CONST char *type_name,
+		  CONST ImageComponent *components,
+		  unsigned int num_components,
+		  unsigned int xlen, unsigned int ylen, uaddr stride,
+		  double xstart, double ystart, double xend, double yend) );
+STATIC_FUNCTION (void fill_row,
+		 (CONST ImageComponent *component, unsigned int row,
+		  flag portrait, unsigned int xlen, unsigned int ylen,
+		  uaddr stride, unsigned char *buffer,
+		  unsigned int buffer_stride) );
+STATIC_FUNCTION (CONST char *get_filter_names,
+		 (unsigned int encoding, flag pdf) );
+STATIC_FUNCTION (flag write_pdf_header,
+		 (PostScriptPage pspage,
+		  double hoffset, double voffset, double hsize,double vsize) );
+STATIC_FUNCTION (flag write_pdf_tail, (PostScriptPage pspage) );
+STATIC_FUNCTION (void free_pdf_state, (PDFState *pdf) );
+STATIC_FUNCTION (flag begin_object,
+		 (PostScriptPage pspage, unsigned int object) );
+STATIC_FUNCTION (unsigned int new_object, (PostScriptPage pspage) );
+STATIC_FUNCTION (flag begin_stream,
+		 (PostScriptPage pspage, unsigned int *length_object) );
+STATIC_FUNCTION (flag end_stream,
+		 (PostScriptPage pspage, unsigned int length_object,
+		  unsigned long start) );
+STATIC_FUNCTION (flag begin_contents, (PostScriptPage pspage) );
+STATIC_FUNCTION (flag end_contents, (PostScriptPage pspage) );
+STATIC_FUNCTION (flag get_position,
+		 (PostScriptPage pspage, unsigned long *position) );
+STATIC_FUNCTION (flag append_value,
+		 (unsigned long **list, unsigned int *length,
+		  unsigned int *max_length, unsigned long value) );
+STATIC_FUNCTION (flag write_pdf_string,
+		 (Channel channel, CONST char *string) );
 STATIC_FUNCTION (flag set_colour, (PostScriptPage pspage,
 				   double red, double green, double blue) );
 STATIC_FUNCTION (flag set_linewidth,
@@ -201,6 +266,8 @@ PostScriptPage psw_va_create (Channel channel, double hoffset, double voffset,
     pspage->colour.red = 0.0;
     pspage->colour.green = 0.0;
     pspage->colour.blue = 0.0;
+    pspage->image_encoding = PSW_ENCODING_RUNLENGTH;
+    pspage->pdf = NULL;
     if ( !write_header (pspage, hoffset, voffset, hsize, vsize) )
     {
 	(void) fprintf (stderr, "Error writing PostScript header\n");
@@ -218,6 +285,82 @@ PostScriptPage psw_va_create (Channel channel, double hoffset, double voffset,
     return (pspage);
 }   /*  End Function psw_va_create  */
 
+/*EXPERIMENTAL_FUNCTION*/
+PostScriptPage psw_va_create_pdf (Channel channel,
+				  double hoffset, double voffset,
+				  double hsize, double vsize,
+				  flag portrait, ...)
+/*  [SUMMARY] Create a PostScriptPage object which writes PDF.
+    [PURPOSE] This routine will create a PostScriptPage object which writes a
+    single page PDF file rather than PostScript. All the drawing routines may
+    be used with the object. The file is completed by [<psw_close>].
+    <channel> The channel to write to. The PDF cross-reference table records
+    positions relative to the channel write position when this routine is
+    called, so nothing else should be written to the channel.
+    <hoffset> The horizontal offset (in centimeters) of the co-ordinate origin.
+    <voffset> The vertical offset (in centimeters) of the co-ordinate origin.
+    <hsize> The desired horizontal size of the co-ordinate system (in
+    centimeters).
+    <vsize> The desired vertical size of the co-ordinate system (in
+    centimeters).
+    <portrait> If TRUE, objects will be drawn in portrait mode (i.e. the x-axis
+    will be horizontal), else they will be drawn in landscape mode (i.e. the
+    x-axis will be vertical).
+    [NOTE] All subsequent objects drawn must lie in the range (0.0, 0.0) to
+    (1.0, 1.0)
+    [VARARGS] The optional list of parameter attribute-key attribute-value
+    pairs must follow. This list must be terminated with the value
+    PSW_ATT_END. See [<PSW_ATTRIBUTES>] for a list of defined attributes.
+    [RETURNS] A PostScriptPage object on success, else NULL
+*/
+{
+    va_list argp;
+    PostScriptPage pspage;
+    PDFState *pdf;
+    static char function_name[] = "psw_va_create_pdf";
+
+    va_start (argp, portrait);
+    FLAG_VERIFY (portrait);
+    if ( ( pspage = (PostScriptPage) m_alloc (sizeof *pspage) ) == NULL )
+    {
+	m_error_notify (function_name, "PostScriptPage object");
+	return (NULL);
+    }
+    if ( ( pdf = (PDFState *) m_alloc (sizeof *pdf) ) == NULL )
+    {
+	m_error_notify (function_name, "PDF state");
+	m_free ( (char *) pspage );
+	return (NULL);
+    }
+    m_clear ( (char *) pdf, sizeof *pdf );
+    pspage->channel = channel;
+    pspage->fsize = sqrt (hsize * hsize + vsize * vsize) / 1.414213562;
+    pspage->portrait = portrait;
+    pspage->eps = FALSE;
+    pspage->colour.red = 0.0;
+    pspage->colour.green = 0.0;
+    pspage->colour.blue = 0.0;
+    pspage->image_encoding = PSW_ENCODING_FLATE;
+    pspage->pdf = pdf;
+    if ( !write_pdf_header (pspage, hoffset, voffset, hsize, vsize) )
+    {
+	(void) fprintf (stderr, "Error writing PDF header\n");
+	free_pdf_state (pdf);
+	m_free ( (char *) pspage );
+	return (NULL);
+    }
+    pspage->magic_number = MAGIC_NUMBER;
+    if ( !process_attributes (pspage, argp) )
+    {
+	pspage->magic_number = 0;
+	free_pdf_state (pdf);
+	m_free ( (char *) pspage );
+	return (NULL);
+    }
+    va_end (argp);
+    return (pspage);
+}   /*  End Function psw_va_create_pdf  */
+
 /*OBSOLETE_FUNCTION*/
 PostScriptPage psw_create (Channel channel, double hoffset, double voffset,
 			   double hsize, double vsize, flag portrait)
@@ -275,64 +418,16 @@ flag psw_mono_image (PostScriptPage pspage, CONST unsigned char *image,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    Channel channel;
-    uaddr voff;
-    unsigned int vcount;
-    unsigned int hlen, vlen;
-    double hos, vos, hss, vss;
+    ImageComponent component;
     static char function_name[] = "psw_mono_image";
 
     VERIFY_PSPAGE (pspage);
-    channel = pspage->channel;
-    if ( !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
-    if (pspage->portrait)
-    {
-	hos = xstart;
-	vos = ystart;
-	hss = xend - xstart;
-	vss = yend - ystart;
-	hlen = xlen;
-	vlen = ylen;
-    }
-    else
-    {
-	hos = ystart;
-	vos = 1.0 - xend;
-	hss = yend - ystart;
-	vss = xend - xstart;
-	hlen = ylen;
-	vlen = xlen;
-    }
-    if ( !ch_printf (channel,
-		     "%% Greyscale image follows at: %e %e to %e %e\n",
-		     xstart, ystart, xend, yend) ) return (FALSE);
-    if ( !ch_printf (channel, "%7.4f  %7.4f translate %7.4f  %7.4f scale\n",
-		     hos, vos, hss, vss) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/nx %5d def /ny %5d def /nbits %3d def /line %5d string def incimage\n",
-		     hlen, vlen, 8, hlen) ) return (FALSE);	
-    /*  Write the image  */
-    if (pspage->portrait)
-    {
-	for (vcount = 0; vcount < ylen; ++vcount)
-	{
-	    voff = (yoffsets == NULL) ? xlen * vcount : yoffsets[vcount];
-	    if ( !write_mono_line (channel, image + voff, xlen, xoffsets, 1,
-				   imap, FALSE) ) return (FALSE);
-	}
-    }
-    else
-    {
-	for (vcount = 0; vcount < xlen; ++vcount)
-	{
-	    voff = (xoffsets ==
-		    NULL) ? xlen - vcount - 1 : xoffsets[xlen - vcount - 1];
-	    if ( !write_mono_line (channel, image + voff, ylen, yoffsets, xlen,
-				   imap, FALSE) ) return (FALSE);
-	}
-    }
-    if ( !ch_puts (channel, "grestore", TRUE) ) return (FALSE);
-    return (TRUE);
+    component.image = image;
+    component.xoffsets = xoffsets;
+    component.yoffsets = yoffsets;
+    component.imap = imap;
+    return ( write_image (pspage, "Greyscale", &component, 1, xlen, ylen, 1,
+			  xstart, ystart, xend, yend) );
 }   /*  End Function psw_mono_image  */
 
 /*PUBLIC_FUNCTION*/
@@ -363,11 +458,7 @@ flag psw_pseudocolour_image (PostScriptPage pspage, CONST unsigned char *image,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    Channel channel;
-    uaddr voff;
-    unsigned int vcount;
-    unsigned int hlen, vlen;
-    double hos, vos, hss, vss;
+    ImageComponent components[3];
     static char function_name[] = "psw_pseudocolour_image";
 
     VERIFY_PSPAGE (pspage);
@@ -376,67 +467,16 @@ flag psw_pseudocolour_image (PostScriptPage pspage, CONST unsigned char *image,
 	(void) fprintf (stderr, "NULL pointer(s) passed\n");
 	a_prog_bug (function_name);
     }
-    channel = pspage->channel;
-    if ( !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
-    if (pspage->portrait)
-    {
-	hos = xstart;
-	vos = ystart;
-	hss = xend - xstart;
-	vss = yend - ystart;
-	hlen = xlen;
-	vlen = ylen;
-    }
-    else
-    {
-	hos = ystart;
-	vos = 1.0 - xend;
-	hss = yend - ystart;
-	vss = xend - xstart;
-	hlen = ylen;
-	vlen = xlen;
-    }
-    if ( !ch_printf (channel,
-		     "%% PseudoColour image follows at: %e %e to %e %e\n",
-		     xstart, ystart, xend, yend) ) return (FALSE);
-    if ( !ch_printf (channel, "%7.4f  %7.4f translate %7.4f  %7.4f scale\n",
-		     hos, vos, hss, vss) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/nx %5d def /ny %5d def /nbits %3d def /rline %5d string def\n",
-		     hlen, vlen, 8, hlen) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/gline %5d string def /bline %5d string def incclrimage\n",
-		     hlen, hlen) ) return (FALSE);	
-    /*  Write the image  */
-    if (pspage->portrait)
-    {
-	for (vcount = 0; vcount < ylen; ++vcount)
-	{
-	    voff = (yoffsets == NULL) ? xlen * vcount : yoffsets[vcount];
-	    if ( !write_mono_line (channel, image + voff, xlen, xoffsets, 1,
-				   imap_red, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image + voff, xlen, xoffsets, 1,
-				   imap_green, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image + voff, xlen, xoffsets, 1,
-				   imap_blue, FALSE) ) return (FALSE);
-	}
-    }
-    else
-    {
-	for (vcount = 0; vcount < xlen; ++vcount)
-	{
-	    voff = (xoffsets ==
-		    NULL) ? xlen - vcount - 1 : xoffsets[xlen - vcount - 1];
-	    if ( !write_mono_line (channel, image + voff, ylen, yoffsets, xlen,
-				   imap_red, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image + voff, ylen, yoffsets, xlen,
-				   imap_green, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image + voff, ylen, yoffsets, xlen,
-				   imap_blue, FALSE) ) return (FALSE);
-	}
-    }
-    if ( !ch_puts (channel, "grestore", TRUE) ) return (FALSE);
-    return (TRUE);
+    components[0].image = image;
+    components[0].xoffsets = xoffsets;
+    components[0].yoffsets = yoffsets;
+    components[0].imap = imap_red;
+    components[1] = components[0];
+    components[1].imap = imap_green;
+    components[2] = components[0];
+    components[2].imap = imap_blue;
+    return ( write_image (pspage, "PseudoColour", components, 3, xlen, ylen, 1,
+			  xstart, ystart, xend, yend) );
 }   /*  End Function psw_pseudocolour_image  */
 
 /*PUBLIC_FUNCTION*/
@@ -477,89 +517,24 @@ flag psw_rgb_image (PostScriptPage pspage, CONST unsigned char *image_reds,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    Channel channel;
-    uaddr voff_red, voff_green, voff_blue;
-    unsigned int vcount, tmp;
-    unsigned int hlen, vlen;
-    double hos, vos, hss, vss;
+    ImageComponent components[3];
     static char function_name[] = "psw_rgb_image";
 
     VERIFY_PSPAGE (pspage);
-    channel = pspage->channel;
-    if ( !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
-    if (pspage->portrait)
-    {
-	hos = xstart;
-	vos = ystart;
-	hss = xend - xstart;
-	vss = yend - ystart;
-	hlen = xlen;
-	vlen = ylen;
-    }
-    else
-    {
-	hos = ystart;
-	vos = 1.0 - xend;
-	hss = yend - ystart;
-	vss = xend - xstart;
-	hlen = ylen;
-	vlen = xlen;
-    }
-    if ( !ch_printf (channel,
-		     "%% TrueColour image follows at: %e %e to %e %e\n",
-		     xstart, ystart, xend, yend) ) return (FALSE);
-    if ( !ch_printf (channel, "%7.4f  %7.4f translate %7.4f  %7.4f scale\n",
-		     hos, vos, hss, vss) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/nx %5d def /ny %5d def /nbits %3d def /rline %5d string def\n",
-		     hlen, vlen, 8, hlen) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/gline %5d string def /bline %5d string def incclrimage\n",
-		     hlen, hlen) ) return (FALSE);
-    /*  Write the image  */
-    if (pspage->portrait)
-    {
-	for (vcount = 0; vcount < ylen; ++vcount)
-	{
-	    tmp = xlen * vcount * stride;
-	    voff_red = (yoffsets_red == NULL) ? tmp : yoffsets_red[vcount];
-	    voff_green = (yoffsets_green==NULL) ? tmp : yoffsets_green[vcount];
-	    voff_blue = (yoffsets_blue == NULL) ? tmp : yoffsets_blue[vcount];
-	    if ( !write_mono_line (channel, image_reds + voff_red, xlen,
-				   xoffsets_red,
-				   stride, NULL, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image_greens + voff_green, xlen,
-				   xoffsets_green,
-				   stride, NULL, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image_blues + voff_blue, xlen,
-				   xoffsets_blue,
-				   stride, NULL, FALSE) ) return (FALSE);
-	}
-    }
-    else
-    {
-	for (vcount = 0; vcount < xlen; ++vcount)
-	{
-	    tmp = stride * (xlen - vcount - 1);
-	    voff_red = (xoffsets_red ==
-			NULL) ? tmp : xoffsets_red[xlen - vcount - 1];
-	    voff_green = (xoffsets_green ==
-			  NULL) ? tmp : xoffsets_green[xlen - vcount - 1];
-	    voff_blue = (xoffsets_blue ==
-			 NULL) ? tmp : xoffsets_blue[xlen - vcount - 1];
-	    if ( !write_mono_line (channel, image_reds + voff_red, ylen,
-				   yoffsets_red,
-				   xlen * stride, NULL, FALSE) ) return(FALSE);
-	    if ( !write_mono_line (channel, image_greens + voff_green, ylen,
-				   yoffsets_green,
-				   xlen * stride, NULL, FALSE) ) return(FALSE);
-	    if ( !write_mono_line (channel, image_blues + voff_blue, ylen,
-				   yoffsets_blue,
-				   xlen * stride, NULL, FALSE) ) return(FALSE);
-	}
-    }
-    if ( !ch_puts (channel, "grestore", TRUE) ) return (FALSE);
-    return (TRUE);
+    components[0].image = image_reds;
+    components[0].xoffsets = xoffsets_red;
+    components[0].yoffsets = yoffsets_red;
+    components[0].imap = NULL;
+    components[1].image = image_greens;
+    components[1].xoffsets = xoffsets_green;
+    components[1].yoffsets = yoffsets_green;
+    components[1].imap = NULL;
+    components[2].image = image_blues;
+    components[2].xoffsets = xoffsets_blue;
+    components[2].yoffsets = yoffsets_blue;
+    components[2].imap = NULL;
+    return ( write_image (pspage, "TrueColour", components, 3, xlen, ylen,
+			  stride, xstart, ystart, xend, yend) );
 }   /*  End Function psw_rgb_image  */
 
 /*PUBLIC_FUNCTION*/
@@ -611,92 +586,24 @@ flag psw_directcolour_image (PostScriptPage pspage,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    Channel channel;
-    uaddr voff_red, voff_green, voff_blue;
-    unsigned int vcount, tmp;
-    unsigned int hlen, vlen;
-    double hos, vos, hss, vss;
+    ImageComponent components[3];
     static char function_name[] = "psw_directcolour_image";
 
     VERIFY_PSPAGE (pspage);
-    channel = pspage->channel;
-    if ( !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
-    if (pspage->portrait)
-    {
-	hos = xstart;
-	vos = ystart;
-	hss = xend - xstart;
-	vss = yend - ystart;
-	hlen = xlen;
-	vlen = ylen;
-    }
-    else
-    {
-	hos = ystart;
-	vos = 1.0 - xend;
-	hss = yend - ystart;
-	vss = xend - xstart;
-	hlen = ylen;
-	vlen = xlen;
-    }
-    if ( !ch_printf (channel,
-		     "%% DirectColour image follows at: %e %e to %e %e\n",
-		     xstart, ystart, xend, yend) ) return (FALSE);
-    if ( !ch_printf (channel, "%7.4f  %7.4f translate %7.4f  %7.4f scale\n",
-		     hos, vos, hss, vss) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/nx %5d def /ny %5d def /nbits %3d def /rline %5d string def\n",
-		     hlen, vlen, 8, hlen) ) return (FALSE);
-    if ( !ch_printf (channel,
-		     "/gline %5d string def /bline %5d string def incclrimage\n",
-		     hlen, hlen) ) return (FALSE);
-    /*  Write the image  */
-    if (pspage->portrait)
-    {
-	for (vcount = 0; vcount < ylen; ++vcount)
-	{
-	    tmp = xlen * vcount * stride;
-	    voff_red = (yoffsets_red == NULL) ? tmp : yoffsets_red[vcount];
-	    voff_green = (yoffsets_green==NULL) ? tmp : yoffsets_green[vcount];
-	    voff_blue = (yoffsets_blue == NULL) ? tmp : yoffsets_blue[vcount];
-	    if ( !write_mono_line (channel, image_reds + voff_red, xlen,
-				   xoffsets_red,
-				   stride, imap_red, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image_greens + voff_green, xlen,
-				   xoffsets_green,
-				   stride, imap_green, FALSE) ) return (FALSE);
-	    if ( !write_mono_line (channel, image_blues + voff_blue, xlen,
-				   xoffsets_blue,
-				   stride, imap_blue, FALSE) ) return (FALSE);
-	}
-    }
-    else
-    {
-	for (vcount = 0; vcount < xlen; ++vcount)
-	{
-	    tmp = stride * (xlen - vcount - 1);
-	    voff_red = (xoffsets_red ==
-			NULL) ? tmp : xoffsets_red[xlen - vcount - 1];
-	    voff_green = (xoffsets_green ==
-			  NULL) ? tmp : xoffsets_green[xlen - vcount - 1];
-	    voff_blue = (xoffsets_blue ==
-			 NULL) ? tmp : xoffsets_blue[xlen - vcount - 1];
-	    if ( !write_mono_line (channel, image_reds + voff_red, ylen,
-				   yoffsets_red,
-				   xlen * stride, imap_red,
-				   FALSE) ) return(FALSE);
-	    if ( !write_mono_line (channel, image_greens + voff_green, ylen,
-				   yoffsets_green,
-				   xlen * stride, imap_green,
-				   FALSE) ) return(FALSE);
-	    if ( !write_mono_line (channel, image_blues + voff_blue, ylen,
-				   yoffsets_blue,
-				   xlen * stride, imap_blue,
-				   FALSE) ) return(FALSE);
-	}
-    }
-    if ( !ch_puts (channel, "grestore", TRUE) ) return (FALSE);
-    return (TRUE);
+    components[0].image = image_reds;
+    components[0].xoffsets = xoffsets_red;
+    components[0].yoffsets = yoffsets_red;
+    components[0].imap = imap_red;
+    components[1].image = image_greens;
+    components[1].xoffsets = xoffsets_green;
+    components[1].yoffsets = yoffsets_green;
+    components[1].imap = imap_green;
+    components[2].image = image_blues;
+    components[2].xoffsets = xoffsets_blue;
+    components[2].yoffsets = yoffsets_blue;
+    components[2].imap = imap_blue;
+    return ( write_image (pspage, "DirectColour", components, 3, xlen, ylen,
+			  stride, xstart, ystart, xend, yend) );
 }   /*  End Function psw_directcolour_image  */
 
 /*PUBLIC_FUNCTION*/
@@ -712,24 +619,43 @@ flag psw_close (PostScriptPage pspage, flag flush, flag close)
 */
 {
     Channel channel;
+    flag eps;
+    PDFState *pdf;
     static char function_name[] = "psw_close";
 
     VERIFY_PSPAGE (pspage);
     channel = pspage->channel;
-    pspage->magic_number = 0;
-    m_free ( (char *) pspage );
-    if ( !ch_puts (channel, "grestore", TRUE) )
+    eps = pspage->eps;
+    pdf = pspage->pdf;
+    if (pdf != NULL)
     {
-	if (close) (void) ch_close (channel);
-	return (FALSE);
+	if ( !write_pdf_tail (pspage) )
+	{
+	    pspage->magic_number = 0;
+	    free_pdf_state (pdf);
+	    m_free ( (char *) pspage );
+	    if (close) (void) ch_close (channel);
+	    return (FALSE);
+	}
+	free_pdf_state (pdf);
     }
-    if (!pspage->eps)
+    pspage->magic_number = 0;
+    m_free ( (char *) pspage );
+    if (pdf == NULL)
     {
-	if ( !ch_puts (channel, "showpage", TRUE) )
+	if ( !ch_puts (channel, "grestore", TRUE) )
 	{
 	    if (close) (void) ch_close (channel);
 	    return (FALSE);
 	}
+	if (!eps)
+	{
+	    if ( !ch_puts (channel, "showpage", TRUE) )
+	    {
+		if (close) (void) ch_close (channel);
+		return (FALSE);
+	    }
+	}
     }
     if (close) return ( ch_close (channel) );
     if (flush) return ( ch_flush (channel) );
@@ -750,7 +676,6 @@ flag psw_finish (PostScriptPage pspage, flag eps, flag flush, flag close)
     object is deallocated (and closed if <<close>> is TRUE).
 */
 {
-    Channel channel;
     static char function_name[] = "psw_finish";
 
     VERIFY_PSPAGE (pspage);
@@ -760,25 +685,8 @@ flag psw_finish (PostScriptPage pspage, flag eps, flag flush, flag close)
 		    function_name);
     (void)fprintf (stderr,
 		   "version 2.0\nUse the <psw_close> routine instead.\n");
-    channel = pspage->channel;
-    pspage->magic_number = 0;
-    m_free ( (char *) pspage );
-    if ( !ch_puts (channel, "grestore", TRUE) )
-    {
-	if (close) (void) ch_close (channel);
-	return (FALSE);
-    }
-    if (!eps)
-    {
-	if ( !ch_puts (channel, "showpage", TRUE) )
-	{
-	    if (close) (void) ch_close (channel);
-	    return (FALSE);
-	}
-    }
-    if (close) return ( ch_close (channel) );
-    if (flush) return ( ch_flush (channel) );
-    return (TRUE);
+    if (pspage->pdf == NULL) pspage->eps = eps;
+    return ( psw_close (pspage, flush, close) );
 }   /*  End Function psw_finish  */
 
 /*PUBLIC_FUNCTION*/
@@ -797,18 +705,29 @@ flag psw_rgb_line (PostScriptPage pspage, double red, double green,double blue,
 */
 {
     Channel channel;
+    double tmp;
     static char function_name[] = "psw_rgb_line";
 
     VERIFY_PSPAGE (pspage);
     channel = pspage->channel;
+    if ( (pspage->pdf != NULL) && !begin_contents (pspage) ) return (FALSE);
     if ( !set_colour (pspage, red, green, blue) ) return (FALSE);
-    if (pspage->portrait)
+    if (!pspage->portrait)
+    {
+	tmp = xstart;
+	xstart = ystart;
+	ystart = 1.0 - tmp;
+	tmp = xend;
+	xend = yend;
+	yend = 1.0 - tmp;
+    }
+    if (pspage->pdf != NULL)
     {
-	return ( ch_printf (channel, "%7.4f  %7.4f M %7.4f  %7.4f D str\n",
+	return ( ch_printf (channel, "%7.4f  %7.4f m %7.4f  %7.4f l S\n",
 			    xstart, ystart, xend, yend) );
     }
     return ( ch_printf (channel, "%7.4f  %7.4f M %7.4f  %7.4f D str\n",
-			ystart, 1.0 - xstart, yend, 1.0 - xend) );
+			xstart, ystart, xend, yend) );
 }   /*  End Function psw_rgb_line  */
 
 /*PUBLIC_FUNCTION*/
@@ -830,6 +749,7 @@ flag psw_rgb_polygon (PostScriptPage pspage,
 {
     Channel channel;
     unsigned int count;
+    char *move, *draw;
     static char function_name[] = "psw_rgb_polygon";
 
     VERIFY_PSPAGE (pspage);
@@ -841,31 +761,37 @@ flag psw_rgb_polygon (PostScriptPage pspage,
     FLAG_VERIFY (fill);
     if (num_points < 2) return (TRUE);
     channel = pspage->channel;
+    if ( (pspage->pdf != NULL) && !begin_contents (pspage) ) return (FALSE);
     if ( !set_colour (pspage, red, green, blue) ) return (FALSE);
+    move = (pspage->pdf == NULL) ? "M" : "m";
+    draw = (pspage->pdf == NULL) ? "D" : "l";
     if (pspage->portrait)
     {
-	if ( !ch_printf (channel, "%7.4f  %7.4f M\n",
-			 x_arr[0], y_arr[0]) ) return (FALSE);
+	if ( !ch_printf (channel, "%7.4f  %7.4f %s\n",
+			 x_arr[0], y_arr[0], move) ) return (FALSE);
     }
     else
     {
-	if ( !ch_printf (channel, "%7.4f  %7.4f M\n",
-			 y_arr[0], 1.0 -x_arr[0]) ) return (FALSE);
+	if ( !ch_printf (channel, "%7.4f  %7.4f %s\n",
+			 y_arr[0], 1.0 -x_arr[0], move) ) return (FALSE);
     }
     for (count = 1; count < num_points; ++count)
     {
 	if (pspage->portrait)
 	{
-	    if ( !ch_printf (channel, "%7.4f  %7.4f D\n",
-			     x_arr[count], y_arr[count]) ) return (FALSE);
+	    if ( !ch_printf (channel, "%7.4f  %7.4f %s\n",
+			     x_arr[count], y_arr[count], draw) ) return (FALSE);
 	}
 	else
 	{
-	    if ( !ch_printf (channel, "%7.4f  %7.4f D\n",
-			     y_arr[count], 1.0 -x_arr[count]) ) return (FALSE);
-	    
+	    if ( !ch_printf (channel, "%7.4f  %7.4f %s\n",
+			     y_arr[count], 1.0 -x_arr[count],
+			     draw) ) return (FALSE);
 	}
     }
+    if (pspage->pdf != NULL) return ( ch_puts (channel, "h", TRUE) &&
+				      ch_puts (channel, fill ? "f" : "S",
+					       TRUE) );
     if (fill) return ( ch_puts (channel, "  closepath  fill", TRUE) );
     return ( ch_puts (channel, "  closepath  stroke", TRUE) );
 }   /*  End Function psw_rgb_polygon  */
@@ -888,14 +814,16 @@ flag psw_rgb_ellipse (PostScriptPage pspage,
 */
 {
     Channel channel;
-    double ch, cv, rh, rv, vscale;
+    double ch, cv, rh, rv, vscale, kh, kv;
     static char function_name[] = "psw_rgb_ellipse";
 
     VERIFY_PSPAGE (pspage);
     FLAG_VERIFY (fill);
     channel = pspage->channel;
+    if ( (pspage->pdf != NULL) && !begin_contents (pspage) ) return (FALSE);
     if ( !set_colour (pspage, red, green, blue) ) return (FALSE);
-    if ( !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
+    if ( (pspage->pdf == NULL) &&
+	 !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
     if (pspage->portrait)
     {
 	ch = cx;
@@ -910,6 +838,25 @@ flag psw_rgb_ellipse (PostScriptPage pspage,
 	rh = ry;
 	rv = rx;
     }
+    if (pspage->pdf != NULL)
+    {
+	/*  Draw the four quadrants with Bezier curves  */
+	kh = rh * BEZIER_CIRCLE;
+	kv = rv * BEZIER_CIRCLE;
+	if ( !ch_printf (channel, "%7.4f %7.4f m\n", ch + rh, cv) ||
+	     !ch_printf (channel, "%7.4f %7.4f %7.4f %7.4f %7.4f %7.4f c\n",
+			 ch + rh, cv + kv, ch + kh, cv + rv, ch, cv + rv) ||
+	     !ch_printf (channel, "%7.4f %7.4f %7.4f %7.4f %7.4f %7.4f c\n",
+			 ch - kh, cv + rv, ch - rh, cv + kv, ch - rh, cv) ||
+	     !ch_printf (channel, "%7.4f %7.4f %7.4f %7.4f %7.4f %7.4f c\n",
+			 ch - rh, cv - kv, ch - kh, cv - rv, ch, cv - rv) ||
+	     !ch_printf (channel, "%7.4f %7.4f %7.4f %7.4f %7.4f %7.4f c\n",
+			 ch + kh, cv - rv, ch + rh, cv - kv, ch + rh, cv) )
+	{
+	    return (FALSE);
+	}
+	return ( ch_puts (channel, fill ? "h f" : "h S", TRUE) );
+    }
     /*  Fiddle scale to make ellipse  */
     vscale = rv / rh;
     if ( !ch_printf (channel,
@@ -941,6 +888,9 @@ flag psw_rgb_text (PostScriptPage pspage, double red, double green,double blue,
 */
 {
     Channel channel;
+    unsigned int font;
+    double tmp, size;
+    PDFState *pdf;
     static char function_name[] = "psw_rgb_text";
 
     VERIFY_PSPAGE (pspage);
@@ -950,6 +900,44 @@ flag psw_rgb_text (PostScriptPage pspage, double red, double green,double blue,
 	a_prog_bug (function_name);
     }
     channel = pspage->channel;
+    if (pspage->pdf != NULL)
+    {
+	pdf = pspage->pdf;
+	if ( !begin_contents (pspage) ) return (FALSE);
+	if ( !set_colour (pspage, red, green, blue) ) return (FALSE);
+	for (font = 0; (font < pdf->num_fonts) &&
+		 (strcmp (pdf->fonts[font], fontname) != 0); ++font);
+	if (font >= pdf->num_fonts)
+	{
+	    if (font >= MAX_FONTS)
+	    {
+		(void) fprintf (stderr, "%s: too many fonts\n", function_name);
+		return (FALSE);
+	    }
+	    if ( ( pdf->fonts[font] = st_dup (fontname) ) == NULL )
+	    {
+		m_error_notify (function_name, "font name");
+		return (FALSE);
+	    }
+	    ++pdf->num_fonts;
+	}
+	if (!pspage->portrait)
+	{
+	    tmp = xstart;
+	    xstart = ystart;
+	    ystart = 1.0 - tmp;
+	    angle += 90.0;
+	}
+	angle *= PI / 180.0;
+	size = (double) fontsize / 10.0 / pspage->fsize;
+	if ( !ch_printf (channel,
+			 "BT /F%u 1 Tf %7.4f %7.4f %7.4f %7.4f %7.4f %7.4f Tm ",
+			 font + 1, size * cos (angle), size * sin (angle),
+			 -size * sin (angle), size * cos (angle),
+			 xstart, ystart) ) return (FALSE);
+	if ( !write_pdf_string (channel, string) ) return (FALSE);
+	return ( ch_puts (channel, " Tj ET", TRUE) );
+    }
     if ( !set_colour (pspage, red, green, blue) ) return (FALSE);
     if ( !ch_puts (channel, "gsave", TRUE) ) return (FALSE);
     if ( !ch_printf (channel, "/%s findfont\n", fontname) ) return (FALSE);
@@ -1141,40 +1129,605 @@ static flag write_header (PostScriptPage pspage,
 		      TRUE) );
 }   /*  End Function write_header  */
 
-static flag write_mono_line (Channel channel, CONST unsigned char *line,
-			     unsigned int length, CONST uaddr *offsets,
-			     uaddr stride, CONST unsigned char imap[256],
-			     flag reverse)
-/*  This routine will write a single line.
+static flag write_image (PostScriptPage pspage, CONST char *type_name,
+			 CONST ImageComponent *components,
+			 unsigned int num_components,
+			 unsigned int xlen, unsigned int ylen, uaddr stride,
+			 double xstart, double ystart, double xend, double yend)
+/*  [SUMMARY] Write an image to a PostScriptPage object.
+    [PURPOSE] This routine will write a greyscale or RGB image. Each row is
+    assembled in a buffer and passed to the encoder in one call. Encodings
+    other than ASCIIHex are written as a single interleaved data source, which
+    requires PostScript Level 2.
+    <pspage> The PostScriptPage object.
+    <type_name> The name of the image type. This is used in a comment.
+    <components> The image components.
+    <num_components> The number of components. This must be 1 or 3.
+    <xlen> The horizontal size of the image (in pixels).
+    <ylen> The vertical size of the image (in pixels).
+    <stride> The stride of successive component values.
+    <xstart> The x starting point (scaled from 0.0 to 1.0).
+    <ystart> The y starting point (scaled from 0.0 to 1.0).
+    <xend> The x ending point (scaled from 0.0 to 1.0).
+    <yend> The y ending point (scaled from 0.0 to 1.0).
+    [RETURNS] TRUE on success, else FALSE.
 */
 {
-    uaddr hoffset;
-    unsigned int hcount;
-    int byte, nibble;
-    char buf[2];
-    static char function_name[] = "write_mono_line";
-
-    FLAG_VERIFY (reverse);
-    for (hcount = 0; hcount < length; ++hcount)
+    Channel channel = pspage->channel;
+    PostScriptFilter filter;
+    flag ok, interleave;
+    unsigned int row, count, hlen, vlen;
+    unsigned int image_object = 0, length_object = 0;
+    unsigned int encoding = pspage->image_encoding;
+    unsigned long start = 0;
+    double hos, vos, hss, vss;
+    unsigned char *buffer;
+    PDFState *pdf = pspage->pdf;
+    static char function_name[] = "write_image";
+
+    if (pspage->portrait)
+    {
+	hos = xstart;
+	vos = ystart;
+	hss = xend - xstart;
+	vss = yend - ystart;
+	hlen = xlen;
+	vlen = ylen;
+    }
+    else
     {
-	hoffset = reverse ? (length - hcount - 1) : hcount;
-	if (offsets == NULL)
+	hos = ystart;
+	vos = 1.0 - xend;
+	hss = yend - ystart;
+	vss = xend - xstart;
+	hlen = ylen;
+	vlen = xlen;
+    }
+    interleave = ( (pdf != NULL) || (encoding != PSW_ENCODING_HEX) ) ?
+	TRUE : FALSE;
+    if ( ( buffer = (unsigned char *) m_alloc (hlen * num_components) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "row buffer");
+	return (FALSE);
+    }
+    if (pdf == NULL)
+    {
+	ok = ch_puts (channel, "gsave", TRUE);
+	if (ok) ok = ch_printf (channel,
+				"%% %s image follows at: %e %e to %e %e\n",
+				type_name, xstart, ystart, xend, yend);
+	if (ok) ok = ch_printf (channel,
+				"%7.4f  %7.4f translate %7.4f  %7.4f scale\n",
+				hos, vos, hss, vss);
+	if (!ok) ;
+	else if (interleave)
 	{
-	    hoffset *= stride;
+	    ok = ch_printf (channel,
+			    "%u %u 8 [%u 0 0 %u 0 0] currentfile %s %s\n",
+			    hlen, vlen, hlen, vlen,
+			    get_filter_names (encoding, FALSE),
+			    (num_components == 1) ? "image" :
+			    "false 3 colorimage");
+	}
+	else if (num_components == 1)
+	{
+	    ok = ch_printf (channel,
+			    "/nx %5d def /ny %5d def /nbits %3d def /line %5d string def incimage\n",
+			    hlen, vlen, 8, hlen);
 	}
 	else
 	{
-	    hoffset = offsets[hoffset];
+	    ok = ch_printf (channel,
+			    "/nx %5d def /ny %5d def /nbits %3d def /rline %5d string def\n",
+			    hlen, vlen, 8, hlen);
+	    if (ok) ok = ch_printf (channel,
+				    "/gline %5d string def /bline %5d string def incclrimage\n",
+				    hlen, hlen);
+	}
+    }
+    else
+    {
+	/*  PDF images are separate objects drawn from the page contents  */
+	ok = end_contents (pspage);
+	if ( ok && ( ( image_object = new_object (pspage) ) == 0 ) ) ok = FALSE;
+	if (ok) ok = begin_object (pspage, image_object);
+	if (ok) ok = ch_printf (channel,
+				"<< /Type /XObject /Subtype /Image /Width %u /Height %u\n",
+				hlen, vlen);
+	if (ok) ok = ch_printf (channel,
+				"/ColorSpace %s /BitsPerComponent 8 /Filter %s\n",
+				(num_components == 1) ? "/DeviceGray" :
+				"/DeviceRGB",
+				get_filter_names (encoding, TRUE) );
+	if (ok) ok = begin_stream (pspage, &length_object);
+	if (ok) ok = get_position (pspage, &start);
+    }
+    if (!ok)
+    {
+	m_free ( (char *) buffer );
+	return (FALSE);
+    }
+    if ( ( filter = psw_filter_create (channel, encoding,
+				       (pdf == NULL) ? TRUE : FALSE) )
+	 == NULL )
+    {
+	m_free ( (char *) buffer );
+	return (FALSE);
+    }
+    for (row = 0; ok && (row < vlen); ++row)
+    {
+	if (interleave)
+	{
+	    for (count = 0; count < num_components; ++count)
+	    {
+		fill_row (components + count, row, pspage->portrait, xlen,
+			  ylen, stride, buffer + count, num_components);
+	    }
+	    ok = psw_filter_write (filter, buffer, hlen * num_components);
+	    continue;
+	}
+	/*  Separate rows for each component  */
+	for (count = 0; ok && (count < num_components); ++count)
+	{
+	    fill_row (components + count, row, pspage->portrait, xlen, ylen,
+		      stride, buffer, 1);
+	    ok = psw_filter_write (filter, buffer, hlen);
+	}
+    }
+    if ( !psw_filter_close (filter) ) ok = FALSE;
+    m_free ( (char *) buffer );
+    if (!ok) return (FALSE);
+    if (pdf == NULL) return ( ch_puts (channel, "grestore", TRUE) );
+    if ( (encoding == PSW_ENCODING_HEX) &&
+	 !ch_puts (channel, ">", FALSE) ) return (FALSE);
+    if ( !end_stream (pspage, length_object, start) ) return (FALSE);
+    if ( !append_value (&pdf->images, &pdf->num_images, &pdf->max_images,
+			image_object) ) return (FALSE);
+    if ( !begin_contents (pspage) ) return (FALSE);
+    /*  PDF puts the first row at the top of the unit square, so flip it  */
+    return ( ch_printf (channel,
+			"q %7.4f 0 0 %7.4f %7.4f %7.4f cm /Im%u Do Q\n",
+			hss, -vss, hos, vos + vss, pdf->num_images) );
+}   /*  End Function write_image  */
+
+static void fill_row (CONST ImageComponent *component, unsigned int row,
+		      flag portrait, unsigned int xlen, unsigned int ylen,
+		      uaddr stride, unsigned char *buffer,
+		      unsigned int buffer_stride)
+/*  [SUMMARY] Copy one output row of an image component into a buffer.
+    <component> The image component.
+    <row> The output row. In landscape mode, rows are image columns, starting
+    from the last.
+    <portrait> If TRUE, the page is in portrait mode, else landscape mode.
+    <xlen> The horizontal size of the image (in pixels).
+    <ylen> The vertical size of the image (in pixels).
+    <stride> The stride of successive component values.
+    <buffer> The values are written here.
+    <buffer_stride> The stride (in bytes) of values in the buffer.
+    [RETURNS] Nothing.
+*/
+{
+    uaddr voff, hstride;
+    unsigned int count, length;
+    CONST uaddr *offsets;
+    CONST unsigned char *line;
+    CONST unsigned char *imap = component->imap;
+
+    if (portrait)
+    {
+	voff = (component->yoffsets == NULL) ?
+	    (uaddr) xlen * row * stride : component->yoffsets[row];
+	length = xlen;
+	offsets = component->xoffsets;
+	hstride = stride;
+    }
+    else
+    {
+	row = xlen - row - 1;
+	voff = (component->xoffsets == NULL) ?
+	    stride * row : component->xoffsets[row];
+	length = ylen;
+	offsets = component->yoffsets;
+	hstride = xlen * stride;
+    }
+    line = component->image + voff;
+    if (offsets == NULL)
+    {
+	if (imap == NULL)
+	{
+	    for (count = 0; count < length; ++count, buffer += buffer_stride)
+	    {
+		*buffer = line[count * hstride];
+	    }
+	}
+	else
+	{
+	    for (count = 0; count < length; ++count, buffer += buffer_stride)
+	    {
+		*buffer = imap[ line[count * hstride] ];
+	    }
+	}
+	return;
+    }
+    if (imap == NULL)
+    {
+	for (count = 0; count < length; ++count, buffer += buffer_stride)
+	{
+	    *buffer = line[ offsets[count] ];
+	}
+    }
+    else
+    {
+	for (count = 0; count < length; ++count, buffer += buffer_stride)
+	{
+	    *buffer = imap[ line[ offsets[count] ] ];
+	}
+    }
+}   /*  End Function fill_row  */
+
+static CONST char *get_filter_names (unsigned int encoding, flag pdf)
+/*  [SUMMARY] Get the decode filters for an image encoding.
+    <encoding> The image encoding.
+    <pdf> If TRUE, the PDF filter names are returned, else the PostScript
+    filter operations are returned. Compressed data are ASCII85 encoded in
+    PostScript and binary in PDF.
+    [RETURNS] The filters.
+*/
+{
+    switch (encoding)
+    {
+      case PSW_ENCODING_HEX:
+	return (pdf ? "/ASCIIHexDecode" : "/ASCIIHexDecode filter");
+	/*break;*/
+      case PSW_ENCODING_ASCII85:
+	return (pdf ? "/ASCII85Decode" : "/ASCII85Decode filter");
+	/*break;*/
+      case PSW_ENCODING_RUNLENGTH:
+	return (pdf ? "/RunLengthDecode" :
+		"/ASCII85Decode filter /RunLengthDecode filter");
+	/*break;*/
+    }
+    return (pdf ? "/FlateDecode" :
+	    "/ASCII85Decode filter /FlateDecode filter");
+}   /*  End Function get_filter_names  */
+
+static flag write_pdf_header (PostScriptPage pspage,
+			      double hoffset, double voffset,
+			      double hsize, double vsize)
+/*  [SUMMARY] Write the PDF header and start the page contents.
+    <pspage> The PostScriptPage object.
+    <hoffset> The horizontal offset of the origin (in centimeters).
+    <voffset> The vertical offset of the origin (in centimeters).
+    <hsize> The horizontal size of the page (in centimeters).
+    <vsize> The vertical size of the page (in centimeters).
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    Channel channel = pspage->channel;
+    unsigned long read_pos;
+    double cm_to_points;
+    PDFState *pdf = pspage->pdf;
+
+    if ( !ch_tell (channel, &read_pos, &pdf->start_pos) ) return (FALSE);
+    cm_to_points = 72.0 / 2.54;
+    pdf->bbox[0] = (int) (cm_to_points * hoffset + 0.5);
+    pdf->bbox[1] = (int) (cm_to_points * voffset + 0.5);
+    pdf->bbox[2] = (int) (cm_to_points * (hoffset + hsize) + 0.5);
+    pdf->bbox[3] = (int) (cm_to_points * (voffset + vsize) + 0.5);
+    if ( !ch_puts (channel, "%PDF-1.4", TRUE) ) return (FALSE);
+    /*  A comment with 8 bit characters tells transfer programs to treat the
+	file as binary  */
+    if ( !ch_puts (channel, "%\342\343\317\323", TRUE) ) return (FALSE);
+    if ( !set_linewidth (pspage, LINEWIDTH, TRUE) ) return (FALSE);
+    if ( !ch_puts (channel, "1 j 1 J", TRUE) ) return (FALSE);
+    /*  Compute translation and scale such that (0.0, 0.0) is the origin and
+	(1.0, 1.0) is the far end of the region  */
+    if ( !ch_printf (channel, "%7.4f 0 0 %7.4f %7.4f %7.4f cm\n",
+		     hsize * cm_to_points, vsize * cm_to_points,
+		     hoffset * cm_to_points,
+		     voffset * cm_to_points) ) return (FALSE);
+    return ( ch_puts (channel, "q", TRUE) );
+}   /*  End Function write_pdf_header  */
+
+static flag write_pdf_tail (PostScriptPage pspage)
+/*  [SUMMARY] Finish the page contents and write the PDF document structure.
+    <pspage> The PostScriptPage object.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    Channel channel = pspage->channel;
+    unsigned int count, first_font, page, pages, catalog, info;
+    unsigned long xref;
+    time_t clock;
+    char txt[STRING_LENGTH];
+    PDFState *pdf = pspage->pdf;
+    extern char module_name[STRING_LENGTH + 1];
+
+    if ( !begin_contents (pspage) ) return (FALSE);
+    if ( !ch_puts (channel, "Q", TRUE) ) return (FALSE);
+    if ( !end_contents (pspage) ) return (FALSE);
+    first_font = pdf->num_objects + 1;
+    for (count = 0; count < pdf->num_fonts; ++count)
+    {
+	if ( !begin_object (pspage, new_object (pspage) ) ) return (FALSE);
+	if ( !ch_printf (channel,
+			 "<< /Type /Font /Subtype /Type1 /BaseFont /%s\n/Encoding /WinAnsiEncoding >>\nendobj\n",
+			 pdf->fonts[count]) ) return (FALSE);
+    }
+    page = new_object (pspage);
+    pages = new_object (pspage);
+    catalog = new_object (pspage);
+    info = new_object (pspage);
+    if (info == 0) return (FALSE);
+    /*  The page  */
+    if ( !begin_object (pspage, page) ) return (FALSE);
+    if ( !ch_printf (channel,
+		     "<< /Type /Page /Parent %u 0 R\n/MediaBox [%d %d %d %d]\n",
+		     pages, pdf->bbox[0], pdf->bbox[1], pdf->bbox[2],
+		     pdf->bbox[3]) ) return (FALSE);
+    if ( !ch_puts (channel,
+		   "/Resources << /ProcSet [/PDF /Text /ImageB /ImageC]",
+		   TRUE) ) return (FALSE);
+    if (pdf->num_images > 0)
+    {
+	if ( !ch_puts (channel, "/XObject <<", TRUE) ) return (FALSE);
+	for (count = 0; count < pdf->num_images; ++count)
+	{
+	    if ( !ch_printf (channel, "/Im%u %lu 0 R\n",
+			     count + 1, pdf->images[count]) ) return (FALSE);
 	}
-	byte = (imap == NULL) ? line[hoffset] : imap[ line[hoffset] ];
-	nibble = byte >> 4;
-	buf[0] = (nibble < 0x0a) ? nibble + '0' : nibble + 'a' - 0x0a;
-	nibble = byte & 0x0f;
-	buf[1] = (nibble < 0x0a) ? nibble + '0' : nibble + 'a' - 0x0a;
-	if (ch_write (channel, buf, 2) < 2) return (FALSE);
+	if ( !ch_puts (channel, ">>", TRUE) ) return (FALSE);
+    }
+    if (pdf->num_fonts > 0)
+    {
+	if ( !ch_puts (channel, "/Font <<", TRUE) ) return (FALSE);
+	for (count = 0; count < pdf->num_fonts; ++count)
+	{
+	    if ( !ch_printf (channel, "/F%u %u 0 R\n",
+			     count + 1, first_font + count) ) return (FALSE);
+	}
+	if ( !ch_puts (channel, ">>", TRUE) ) return (FALSE);
+    }
+    if ( !ch_puts (channel, ">>\n/Contents [", FALSE) ) return (FALSE);
+    for (count = 0; count < pdf->num_contents; ++count)
+    {
+	if ( !ch_printf (channel, "%s%lu 0 R", (count % 8 == 7) ? "\n" : " ",
+			 pdf->contents[count]) ) return (FALSE);
+    }
+    if ( !ch_puts (channel, " ]\n>>\nendobj", TRUE) ) return (FALSE);
+    /*  The page tree, catalogue and document information  */
+    if ( !begin_object (pspage, pages) ) return (FALSE);
+    if ( !ch_printf (channel,
+		     "<< /Type /Pages /Kids [%u 0 R] /Count 1 >>\nendobj\n",
+		     page) ) return (FALSE);
+    if ( !begin_object (pspage, catalog) ) return (FALSE);
+    if ( !ch_printf (channel, "<< /Type /Catalog /Pages %u 0 R >>\nendobj\n",
+		     pages) ) return (FALSE);
+    if ( !begin_object (pspage, info) ) return (FALSE);
+    if ( !ch_puts (channel, "<< /Producer (Karma psw_ package)",
+		   TRUE) ) return (FALSE);
+    if (strcmp (module_name, "<<Unknown>>") != 0)
+    {
+	if ( !ch_puts (channel, "/Creator ", FALSE) ) return (FALSE);
+	if ( !write_pdf_string (channel, module_name) ) return (FALSE);
+	if ( !ch_puts (channel, "", TRUE) ) return (FALSE);
+    }
+    clock = time ( (time_t *) NULL );
+    if (strftime (txt, STRING_LENGTH, "%Y%m%d%H%M%S",
+		  localtime (&clock) ) > 0)
+    {
+	if ( !ch_printf (channel, "/CreationDate (D:%s)\n",
+			 txt) ) return (FALSE);
+    }
+    if ( !ch_puts (channel, ">>\nendobj", TRUE) ) return (FALSE);
+    /*  The cross-reference table and trailer  */
+    if ( !get_position (pspage, &xref) ) return (FALSE);
+    if ( !ch_printf (channel, "xref\n0 %u\n0000000000 65535 f \n",
+		     pdf->num_objects + 1) ) return (FALSE);
+    for (count = 0; count < pdf->num_objects; ++count)
+    {
+	if ( !ch_printf (channel, "%010lu 00000 n \n",
+			 pdf->offsets[count]) ) return (FALSE);
     }
-    return ( ch_puts (channel, "", TRUE) );
-}   /*  End Function write_mono_line  */
+    return ( ch_printf (channel,
+			"trailer\n<< /Size %u /Root %u 0 R /Info %u 0 R >>\nstartxref\n%lu\n%%%%EOF\n",
+			pdf->num_objects + 1, catalog, info, xref) );
+}   /*  End Function write_pdf_tail  */
+
+static void free_pdf_state (PDFState *pdf)
+/*  [SUMMARY] Free the PDF state of a PostScriptPage object.
+    <pdf> The PDF state.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+
+    if (pdf->offsets != NULL) m_free ( (char *) pdf->offsets );
+    if (pdf->contents != NULL) m_free ( (char *) pdf->contents );
+    if (pdf->images != NULL) m_free ( (char *) pdf->images );
+    for (count = 0; count < pdf->num_fonts; ++count)
+    {
+	m_free (pdf->fonts[count]);
+    }
+    m_free ( (char *) pdf );
+}   /*  End Function free_pdf_state  */
+
+static unsigned int new_object (PostScriptPage pspage)
+/*  [SUMMARY] Allocate a PDF object number.
+    <pspage> The PostScriptPage object.
+    [RETURNS] The object number on success, else 0.
+*/
+{
+    PDFState *pdf = pspage->pdf;
+
+    if ( !append_value (&pdf->offsets, &pdf->num_objects, &pdf->max_objects,
+			0) ) return (0);
+    return (pdf->num_objects);
+}   /*  End Function new_object  */
+
+static flag begin_object (PostScriptPage pspage, unsigned int object)
+/*  [SUMMARY] Start writing a PDF object.
+    [PURPOSE] This routine will record the position of a PDF object for the
+    cross-reference table and will write the start of the object.
+    <pspage> The PostScriptPage object.
+    <object> The object number. If this is 0, the routine fails.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    if (object == 0) return (FALSE);
+    if ( !get_position (pspage,
+			pspage->pdf->offsets + object - 1) ) return (FALSE);
+    return ( ch_printf (pspage->channel, "%u 0 obj\n", object) );
+}   /*  End Function begin_object  */
+
+static flag begin_stream (PostScriptPage pspage, unsigned int *length_object)
+/*  [SUMMARY] Finish a PDF stream dictionary and start the stream data.
+    [PURPOSE] This routine will write the stream length (as a reference to an
+    object written by [<end_stream>]) and the end of the dictionary.
+    <pspage> The PostScriptPage object.
+    <length_object> The object number for the stream length is written here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    if ( ( *length_object = new_object (pspage) ) == 0 ) return (FALSE);
+    return ( ch_printf (pspage->channel, "/Length %u 0 R >>\nstream\n",
+			*length_object) );
+}   /*  End Function begin_stream  */
+
+static flag end_stream (PostScriptPage pspage, unsigned int length_object,
+			unsigned long start)
+/*  [SUMMARY] Finish a PDF stream and write its length object.
+    <pspage> The PostScriptPage object.
+    <length_object> The object number for the stream length.
+    <start> The position of the start of the stream data.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned long end;
+
+    if ( !get_position (pspage, &end) ) return (FALSE);
+    if ( !ch_puts (pspage->channel, "\nendstream\nendobj", TRUE) )
+    {
+	return (FALSE);
+    }
+    if ( !begin_object (pspage, length_object) ) return (FALSE);
+    return ( ch_printf (pspage->channel, "%lu\nendobj\n", end - start) );
+}   /*  End Function end_stream  */
+
+static flag begin_contents (PostScriptPage pspage)
+/*  [SUMMARY] Make sure a PDF page content stream is being written.
+    <pspage> The PostScriptPage object.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int object;
+    PDFState *pdf = pspage->pdf;
+
+    if (pdf->stream_object != 0) return (TRUE);
+    if ( ( object = new_object (pspage) ) == 0 ) return (FALSE);
+    if ( !append_value (&pdf->contents, &pdf->num_contents,
+			&pdf->max_contents, object) ) return (FALSE);
+    if ( !begin_object (pspage, object) ) return (FALSE);
+    if ( !ch_puts (pspage->channel, "<< ", FALSE) ) return (FALSE);
+    if ( !begin_stream (pspage, &pdf->stream_length_object) ) return (FALSE);
+    if ( !get_position (pspage, &pdf->stream_start) ) return (FALSE);
+    pdf->stream_object = object;
+    return (TRUE);
+}   /*  End Function begin_contents  */
+
+static flag end_contents (PostScriptPage pspage)
+/*  [SUMMARY] Finish any PDF page content stream being written.
+    <pspage> The PostScriptPage object.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    PDFState *pdf = pspage->pdf;
+
+    if (pdf->stream_object == 0) return (TRUE);
+    pdf->stream_object = 0;
+    return ( end_stream (pspage, pdf->stream_length_object,
+			 pdf->stream_start) );
+}   /*  End Function end_contents  */
+
+static flag get_position (PostScriptPage pspage, unsigned long *position)
+/*  [SUMMARY] Get the position in a PDF file.
+    <pspage> The PostScriptPage object.
+    <position> The number of bytes written since the start of the file is
+    written here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned long read_pos;
+
+    if ( !ch_tell (pspage->channel, &read_pos, position) ) return (FALSE);
+    *position -= pspage->pdf->start_pos;
+    return (TRUE);
+}   /*  End Function get_position  */
+
+static flag append_value (unsigned long **list, unsigned int *length,
+			  unsigned int *max_length, unsigned long value)
+/*  [SUMMARY] Append a value to a list, growing the list if needed.
+    <list> A pointer to the list. This may be updated.
+    <length> A pointer to the length of the list. This is updated.
+    <max_length> A pointer to the allocated length. This may be updated.
+    <value> The value.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int new_max;
+    unsigned long *new_list;
+    static char function_name[] = "append_value";
+
+    if (*length >= *max_length)
+    {
+	new_max = (*max_length < 1) ? 64 : *max_length * 2;
+	if ( ( new_list = (unsigned long *)
+	       m_alloc (sizeof *new_list * new_max) ) == NULL )
+	{
+	    m_error_notify (function_name, "list");
+	    return (FALSE);
+	}
+	if (*list != NULL)
+	{
+	    m_copy ( (char *) new_list, (CONST char *) *list,
+		     sizeof *new_list * *length );
+	    m_free ( (char *) *list );
+	}
+	*list = new_list;
+	*max_length = new_max;
+    }
+    (*list)[(*length)++] = value;
+    return (TRUE);
+}   /*  End Function append_value  */
+
+static flag write_pdf_string (Channel channel, CONST char *string)
+/*  [SUMMARY] Write a PDF string literal.
+    <channel> The channel to write to.
+    <string> The string. Parentheses and backslashes are escaped.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int length = 0;
+    char buffer[STRING_LENGTH];
+
+    buffer[length++] = '(';
+    for (; *string != '\0'; ++string)
+    {
+	if (length + 4 > STRING_LENGTH)
+	{
+	    if (ch_write (channel, buffer, length) < length) return (FALSE);
+	    length = 0;
+	}
+	if ( (*string == '(') || (*string == ')') || (*string == '\\') )
+	{
+	    buffer[length++] = '\\';
+	}
+	buffer[length++] = *string;
+    }
+    buffer[length++] = ')';
+    return (ch_write (channel, buffer, length) == length);
+}   /*  End Function write_pdf_string  */
 
 static flag set_colour (PostScriptPage pspage,
 			double red, double green, double blue)
@@ -1192,8 +1745,15 @@ static flag set_colour (PostScriptPage pspage,
     {
 	return (TRUE);
     }
-    if ( !ch_printf (pspage->channel, "%7.4f  %7.4f  %7.4f  setrgbcolor\n",
-		     red, green, blue) ) return (FALSE);
+    if (pspage->pdf != NULL)
+    {
+	if ( !ch_printf (pspage->channel,
+			 "%7.4f  %7.4f  %7.4f  RG  %7.4f  %7.4f  %7.4f  rg\n",
+			 red, green, blue, red, green, blue) ) return (FALSE);
+    }
+    else if ( !ch_printf (pspage->channel,
+			  "%7.4f  %7.4f  %7.4f  setrgbcolor\n",
+			  red, green, blue) ) return (FALSE);
     pspage->colour.red = red;
     pspage->colour.green = green;
     pspage->colour.blue = blue;
@@ -1226,6 +1786,12 @@ static flag set_linewidth (PostScriptPage pspage, double linewidth, flag mm)
 	linewidth_mm = linewidth * pspage->fsize * 10.0;
 	linewidth_scale = linewidth;
     }
+    if (pspage->pdf != NULL)
+    {
+	if ( !begin_contents (pspage) ) return (FALSE);
+	return ( ch_printf (pspage->channel, "%e w %% %7.4f mm\n",
+			    linewidth_scale, linewidth_mm) );
+    }
     return ( ch_printf (pspage->channel, "%e setlinewidth %% %7.4f mm\n",
 			linewidth_scale, linewidth_mm) );
 }   /*  End Function set_linewidth  */
@@ -1239,7 +1805,7 @@ static flag process_attributes (PostScriptPage pspage, va_list argp)
 */
 {
     double d_val;
-    unsigned int att_key;
+    unsigned int att_key, encoding;
     static char function_name[] = "__psw_process_attributes";
 
     while ( ( att_key = va_arg (argp, unsigned int) ) != PSW_ATT_END )
@@ -1262,6 +1828,16 @@ static flag process_attributes (PostScriptPage pspage, va_list argp)
 		return (FALSE);
 	    }
 	    break;
+	  case PSW_ATT_IMAGE_ENCODING:
+	    encoding = va_arg (argp, unsigned int);
+	    if (encoding > PSW_ENCODING_FLATE)
+	    {
+		(void) fprintf (stderr, "Illegal image encoding: %u\n",
+				encoding);
+		a_prog_bug (function_name);
+	    }
+	    pspage->image_encoding = encoding;
+	    break;
 	  default:
 	    (void) fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
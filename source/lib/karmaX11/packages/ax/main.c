@@ -40,10 +40,13 @@
 
 */
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <karma.h>
 #include <karma_a.h>
 #include <karma_ax.h>
+#include <karma_m.h>
+#include <karma_st.h>
 
 #define MAJOR_TICK_MM (double) 3.0
 #define MEDIUM_TICK_MM (double) 2.0
@@ -61,8 +64,65 @@
 #define ORDINATE_TRACE_SEPARATION_FACTOR (double) 1.05
 
 
+/*  Structures  */
+struct font_cache_type
+{
+    Display *display;
+    char *name;
+    XFontStruct *font_info;
+    struct font_cache_type *next;
+};
+
+
+/*  Private data follows  */
+static struct font_cache_type *font_cache = NULL;
+
+
 /*  Private functions follow  */
 
+static XFontStruct *load_font (display, font_name)
+/*  This routine will load a font, re-using any font previously loaded with the
+    same name on the same display. Fonts are kept loaded so that redrawing
+    the axes does not need a round trip to the server.
+    The display must be given by  display  .
+    The name of the font must be pointed to by  font_name  .
+    The routine returns the font information on success, else it returns NULL.
+*/
+Display *display;
+char *font_name;
+{
+    struct font_cache_type *entry;
+    XFontStruct *font_info;
+    static char function_name[] = "load_font";
+
+    for (entry = font_cache; entry != NULL; entry = (*entry).next)
+    {
+	if ( ( (*entry).display == display ) &&
+	    (strcmp ( (*entry).name, font_name ) == 0) )
+	{
+	    return ( (*entry).font_info );
+	}
+    }
+    if ( ( font_info = XLoadQueryFont (display, font_name) ) == NULL )
+    {
+	return (NULL);
+    }
+    if ( ( entry = (struct font_cache_type *) m_alloc (sizeof *entry) )
+	== NULL )
+    {
+	m_abort (function_name, "font cache entry");
+    }
+    if ( ( (*entry).name = st_dup (font_name) ) == NULL )
+    {
+	m_abort (function_name, "font name");
+    }
+    (*entry).display = display;
+    (*entry).font_info = font_info;
+    (*entry).next = font_cache;
+    font_cache = entry;
+    return (font_info);
+}   /*  End Function load_font  */
+
 static int xverticaltextwidth (font_info, string)
 /*  This routine will determine the width of the widest character in a string.
     The font information must be pointed to by  font_info  .
@@ -204,7 +264,7 @@ void (*error_notify_func) ();
     plot_border_y = (pixels_per_mm_y * PLOT_BORDER_MM + (float) 0.5);
 
     /*  Load title font  */
-    if ( ( title_font = XLoadQueryFont (display, title_font_name) ) == NULL )
+    if ( ( title_font = load_font (display, title_font_name) ) == NULL )
     {
 	(void) sprintf (txt,"cannot open title font: \"%s\"", title_font_name);
 	if (error_notify_func == NULL)
@@ -218,7 +278,7 @@ void (*error_notify_func) ();
 	return (FALSE);
     }
     /*  Load axes font  */
-    if ( ( axes_font = XLoadQueryFont (display, axes_font_name) ) == NULL )
+    if ( ( axes_font = load_font (display, axes_font_name) ) == NULL )
     {
 	(void) sprintf (txt, "cannot open axes font: \"%s\"", axes_font_name);
 	if (error_notify_func == NULL)
@@ -229,12 +289,10 @@ void (*error_notify_func) ();
 	{
 	    (*error_notify_func) (txt);
 	}
-	/*  Free all font info  */
-	XFree ( (char *) title_font );
 	return (FALSE);
     }
     /*  Load scale font  */
-    if ( ( scale_font = XLoadQueryFont (display, scale_font_name) ) == NULL )
+    if ( ( scale_font = load_font (display, scale_font_name) ) == NULL )
     {
 	(void) sprintf (txt,"cannot open scale font: \"%s\"", scale_font_name);
 	if (error_notify_func == NULL)
@@ -245,9 +303,6 @@ void (*error_notify_func) ();
 	{
 	    (*error_notify_func) (txt);
 	}
-	/*  Free all font info  */
-	XFree ( (char *) title_font );
-	XFree ( (char *) axes_font );
 	return (FALSE);
     }
     /*  Determine font heights  */
@@ -0,0 +1 @@
+../packages/kwin/memory.c
\ No newline at end of file
@@ -265,6 +265,25 @@ struct worldcanvas_type
     char *title;
     char *title_colour;
     char *title_fontname;
+    /*  Cached dressing layout  */
+    flag dressing_size_valid;
+    int dressing_left;
+    int dressing_right;
+    int dressing_top;
+    int dressing_bottom;
+    flag dressing_pixel_valid;
+    unsigned long dressing_pixel;
+    flag dressing_box_valid;
+    int dressing_box_x[2];
+    int dressing_box_y[2];
+    /*  Retained lower layers  */
+    KCallbackFunc layer_marker;
+    KPixCanvasImageCache layer_cache;
+    flag layer_valid;
+    flag refresh_upper_only;
+    flag skip_lower_layers;
+    flag in_lower_layers;
+    flag drawing_lower_layers;
 };
 
 struct refresh_struct
@@ -319,6 +338,16 @@ STATIC_FUNCTION (flag negotiate_scale_change,
 STATIC_FUNCTION (void get_dressing_size,
 		 (KWorldCanvas canvas, int *p_left, int *p_right,
 		  int *p_top, int *p_bottom) );
+STATIC_FUNCTION (flag dressing_needs_refresh,
+		 (KWorldCanvas canvas, unsigned int num_areas,
+		  KPixCanvasRefreshArea *areas) );
+STATIC_FUNCTION (void layer_refresh_func,
+		 (KWorldCanvas canvas, int width, int height,
+		  struct win_scale_type *win_scale,
+		  Kcolourmap cmap, flag cmap_resize, void **info,
+		  PostScriptPage pspage,
+		  unsigned int num_areas, KPixCanvasRefreshArea *areas,
+		  flag *honoured_areas) );
 STATIC_FUNCTION (void dressing_refresh_func,
 		 (KWorldCanvas canvas, int width, int height,
 		  struct win_scale_type *win_scale,
@@ -330,6 +359,18 @@ STATIC_FUNCTION (flag position_event_func,
 		 (void *object, void *client1_data,
 		  void *call_data, void *client2_data) );
 STATIC_FUNCTION (void set_sat_pixels, (KWorldCanvas canvas) );
+STATIC_FUNCTION (void clip_world_coords,
+		 (KWorldCanvas canvas, unsigned int num_coords,
+		  CONST double *xin, CONST double *yin,
+		  double *xout, double *yout) );
+STATIC_FUNCTION (void linear_world_to_pixel,
+		 (KWorldCanvas canvas, unsigned int num_coords,
+		  CONST double *xin, CONST double *yin,
+		  double *xout, double *yout) );
+STATIC_FUNCTION (void pixel_to_linear_world,
+		 (KWorldCanvas canvas, unsigned int num_coords,
+		  CONST double *xin, CONST double *yin,
+		  double *xout, double *yout) );
 
 
 /*  Public functions follow  */
@@ -434,6 +475,16 @@ KWorldCanvas canvas_create (KPixCanvas pixcanvas, Kcolourmap cmap,
     canvas->title = NULL;
     canvas->title_colour = NULL;
     canvas->title_fontname = NULL;
+    canvas->dressing_size_valid = FALSE;
+    canvas->dressing_pixel_valid = FALSE;
+    canvas->dressing_box_valid = FALSE;
+    canvas->layer_marker = NULL;
+    canvas->layer_cache = NULL;
+    canvas->layer_valid = FALSE;
+    canvas->refresh_upper_only = FALSE;
+    canvas->skip_lower_layers = FALSE;
+    canvas->in_lower_layers = FALSE;
+    canvas->drawing_lower_layers = FALSE;
     /*  Process refreshes from lower down  */
     kwin_register_refresh_func (pixcanvas, pixcanvas_refresh_func,
 				(void *) canvas);
@@ -606,6 +657,10 @@ void canvas_get_attributes (KWorldCanvas canvas, ...)
 	  case CANVAS_ATT_AUTO_MAX_SAT:
 	    *( va_arg (argp, flag *) ) = canvas->auto_max_sat;
 	    break;
+	  case CANVAS_ATT_LAYERS_RETAINED:
+	    *( va_arg (argp, flag *) ) = (canvas->layer_marker == NULL) ?
+		FALSE : TRUE;
+	    break;
 	  default:
 	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -690,6 +745,10 @@ flag canvas_set_attributes (KWorldCanvas canvas, ...)
 	  case CANVAS_ATT_AUTO_MAX_SAT:
 	    canvas->auto_max_sat = va_arg (argp, flag);
 	    break;
+	  case CANVAS_ATT_LAYERS_RETAINED:
+	    fprintf (stderr, "Use <canvas_retain_lower_layers> instead\n");
+	    a_prog_bug (function_name);
+	    break;
 	  default:
 	    fprintf (stderr, "Unknown attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -934,84 +993,102 @@ void canvas_convert_to_canvas_coords (KWorldCanvas canvas, flag clip,
 {
     flag converted;
     int px, py;
-    unsigned int count;
-    double dx, dy;
+    unsigned int count, num_block;
+    double xmax, ymax;
+    double dx[COORD_BUF_SIZE], dy[COORD_BUF_SIZE];
     struct win_scale_type win_scale;
     static char function_name[] = "canvas_convert_to_canvas_coords";
 
     VERIFY_CANVAS (canvas);
-    for (count = 0; count < num_coords; ++count)
+    xmax = canvas->win_scale.x_offset + canvas->win_scale.x_pixels - 1;
+    ymax = canvas->win_scale.y_offset + canvas->win_scale.y_pixels - 1;
+    /*  Divide request into managable blocks  */
+    for (; num_coords > 0; num_coords -= num_block,
+	     xin += num_block, yin += num_block)
     {
-	dx = xin[count];
-	dy = yin[count];
-	if ( clip && (dx < canvas->win_scale.x_offset) )
-	{
-	    dx = canvas->win_scale.x_offset;
-	}
-	if ( clip && (dx >= canvas->win_scale.x_offset +
-		      canvas->win_scale.x_pixels) )
-	{
-	    dx = canvas->win_scale.x_offset + canvas->win_scale.x_pixels - 1;
-	}
-	if ( clip && (dy < canvas->win_scale.y_offset) )
-	{
-	    dy = canvas->win_scale.y_offset;
-	}
-	if ( clip && (dy >= canvas->win_scale.y_offset +
-		      canvas->win_scale.y_pixels) )
+	num_block = (num_coords > COORD_BUF_SIZE) ? COORD_BUF_SIZE :num_coords;
+	for (count = 0; count < num_block; ++count) dx[count] = xin[count];
+	for (count = 0; count < num_block; ++count) dy[count] = yin[count];
+	if (clip)
 	{
-	    dy = canvas->win_scale.y_offset + canvas->win_scale.y_pixels - 1;
+	    for (count = 0; count < num_block; ++count)
+	    {
+		if (dx[count] < canvas->win_scale.x_offset)
+		    dx[count] = canvas->win_scale.x_offset;
+		if (dx[count] >= xmax + 1.0) dx[count] = xmax;
+		if (dy[count] < canvas->win_scale.y_offset)
+		    dy[count] = canvas->win_scale.y_offset;
+		if (dy[count] >= ymax + 1.0) dy[count] = ymax;
+	    }
 	}
 	converted = FALSE;
 	if (canvas->coords_convert_func != NULL)
 	{
 	    converted = ( (*canvas->coords_convert_func)
-			  (canvas, 1, &dx, &dy, &dx, &dy, TRUE,
-			   &canvas->coord_convert_info) );
-	}
-	else if (canvas->deprecated_coord_d_convert_func != NULL)
-	{
-	    m_copy ( (char *) &win_scale, (char *) &canvas->win_scale,
-		     sizeof win_scale );
-	    converted = ( (*canvas->deprecated_coord_d_convert_func)
-			  (canvas, &win_scale, &dx, &dy, TRUE,
+			  (canvas, num_block, dx, dy, dx, dy, TRUE,
 			   &canvas->coord_convert_info) );
 	}
-	else if (canvas->deprecated_coord_convert_func != NULL)
+	else if ( (canvas->deprecated_coord_d_convert_func != NULL) ||
+		  (canvas->deprecated_coord_convert_func != NULL) )
 	{
-	    m_copy ( (char *) &win_scale, (char *) &canvas->win_scale,
-		     sizeof win_scale );
-	    px = dx;
-	    py = dy;
-	    converted = ( (*canvas->deprecated_coord_convert_func)
-			  (canvas, &win_scale, &px, &py, &dx, &dy, TRUE,
-			   &canvas->coord_convert_info) );
+	    /*  Deprecated interfaces only take one co-ordinate at a time  */
+	    for (count = 0; count < num_block; ++count)
+	    {
+		m_copy ( (char *) &win_scale, (char *) &canvas->win_scale,
+			 sizeof win_scale );
+		if (canvas->deprecated_coord_d_convert_func != NULL)
+		{
+		    converted = ( (*canvas->deprecated_coord_d_convert_func)
+				  (canvas, &win_scale, dx + count, dy + count,
+				   TRUE, &canvas->coord_convert_info) );
+		}
+		else
+		{
+		    px = dx[count];
+		    py = dy[count];
+		    converted = ( (*canvas->deprecated_coord_convert_func)
+				  (canvas, &win_scale, &px, &py,
+				   dx + count, dy + count, TRUE,
+				   &canvas->coord_convert_info) );
+		}
+		if (!converted)
+		{
+		    pixel_to_linear_world (canvas, 1, dx + count, dy + count,
+					   dx + count, dy + count);
+		}
+	    }
+	    converted = TRUE;
 	}
 	if (!converted)
 	{
 	    /*  Convert pixel co-ordinates to world co-ordinates  */
-	    /*  Convert x  */
-	    dx = dx - canvas->win_scale.x_offset;
-	    dx /= (double) (canvas->win_scale.x_pixels - 1);
-	    dx *= (canvas->win_scale.right_x - canvas->win_scale.left_x);
-	    dx += canvas->win_scale.left_x;
-	    /*  Flip vertical  */
-	    dy -= canvas->win_scale.y_offset;
-	    dy = canvas->win_scale.y_pixels - dy - 1;
-	    /*  Convert y  */
-	    dy /= (double) (canvas->win_scale.y_pixels - 1);
-	    dy *= (canvas->win_scale.top_y - canvas->win_scale.bottom_y);
-	    dy += canvas->win_scale.bottom_y;
+	    pixel_to_linear_world (canvas, num_block, dx, dy, dx, dy);
 	}
 	/*  dx and dy should now be linear world co-ordinates  */
-	if (xout_lin != NULL) xout_lin[count] = dx;
-	if (yout_lin != NULL) yout_lin[count] = dy;
+	if (xout_lin != NULL)
+	{
+	    for (count = 0; count < num_block; ++count)
+		xout_lin[count] = dx[count];
+	    xout_lin += num_block;
+	}
+	if (yout_lin != NULL)
+	{
+	    for (count = 0; count < num_block; ++count)
+		yout_lin[count] = dy[count];
+	    yout_lin += num_block;
+	}
+	if ( (xout == NULL) && (yout == NULL) ) continue;
 	/*  Apply non-linear transform function  */
-	if ( (xout != NULL) || (yout != NULL) )
+	canvas_coords_transform (canvas, num_block, dx, FALSE, dy, FALSE);
+	if (xout != NULL)
+	{
+	    for (count = 0; count < num_block; ++count) xout[count] = dx[count];
+	    xout += num_block;
+	}
+	if (yout != NULL)
 	{
-	    canvas_coords_transform (canvas, 1, &dx, FALSE, &dy, FALSE);
-	    if (xout != NULL) xout[count] = dx;
-	    if (yout != NULL) yout[count] = dy;
+	    for (count = 0; count < num_block; ++count) yout[count] = dy[count];
+	    yout += num_block;
 	}
     }
 }   /*  End Function canvas_convert_to_canvas_coords  */
@@ -1053,93 +1130,59 @@ void canvas_convert_from_canvas_coords (KWorldCanvas canvas,
 	for (count = 0; count < num_coords; ++count) xout[count] = xin[count];
 	for (count = 0; count < num_coords; ++count) yout[count] = yin[count];
 	canvas_coords_transform (canvas, num_coords, xout, TRUE, yout, TRUE);
-	if ( !clip && (canvas->coords_convert_func != NULL) )
-	{
-	    if ( (*canvas->coords_convert_func) (canvas, num_coords,
-						 xout, yout, xout, yout, FALSE,
-						 &canvas->coord_convert_info) )
-		return;
-	}
-	/*  Co-ordinates have not been converted to pixel co-ordinates yet  */
 	canvas_convert_from_canvas_coords (canvas, clip, TRUE, num_coords,
 					   xout, yout, xout, yout);
 	return;
     }
     /*  Linear conversion only  */
-    if ( !clip && (canvas->coords_convert_func != NULL) )
+    if (clip)
+    {
+	clip_world_coords (canvas, num_coords, xin, yin, xout, yout);
+	xin = xout;
+	yin = yout;
+    }
+    if (canvas->coords_convert_func != NULL)
     {
 	if ( (*canvas->coords_convert_func) (canvas, num_coords,
 					     xin, yin, xout, yout, FALSE,
 					     &canvas->coord_convert_info) )
 	    return;
     }
-    /*  Have to do this the hard way  */
-    m_copy ( (char *) &win_scale, (char *) &canvas->win_scale,
-	     sizeof win_scale );
-    for (count = 0; count < num_coords; ++count)
+    else if ( (canvas->deprecated_coord_d_convert_func != NULL) ||
+	      (canvas->deprecated_coord_convert_func != NULL) )
     {
-	px = xin[count];
-	py = yin[count];
-	if (clip)
+	/*  Have to do this the hard way  */
+	m_copy ( (char *) &win_scale, (char *) &canvas->win_scale,
+		 sizeof win_scale );
+	for (count = 0; count < num_coords; ++count)
 	{
-	    if (win_scale.left_x < win_scale.right_x)
+	    px = xin[count];
+	    py = yin[count];
+	    if (canvas->deprecated_coord_d_convert_func != NULL)
 	    {
-		if (px < win_scale.left_x) px = win_scale.left_x;
-		else if (px > win_scale.right_x) px = win_scale.right_x;
+		converted = ( (*canvas->deprecated_coord_d_convert_func)
+			      (canvas, &win_scale, &px, &py, FALSE,
+			       &canvas->coord_convert_info) );
 	    }
 	    else
 	    {
-		if (px > win_scale.left_x) px = win_scale.left_x;
-		else if (px < win_scale.right_x) px = win_scale.right_x;
-	    }
-	    if (win_scale.bottom_y < win_scale.top_y)
-	    {
-		if (py < win_scale.bottom_y) py = win_scale.bottom_y;
-		else if (py > win_scale.top_y) py = win_scale.top_y;
+		converted = ( (*canvas->deprecated_coord_convert_func)
+			      (canvas, &win_scale, &ix, &iy, &px, &px, FALSE,
+			       &canvas->coord_convert_info) );
+		px = ix;
+		py = iy;
 	    }
-	    else
+	    if (!converted)
 	    {
-		if (py > win_scale.bottom_y) py = win_scale.bottom_y;
-		else if (py < win_scale.top_y) py = win_scale.top_y;
+		linear_world_to_pixel (canvas, 1, &px, &py, &px, &py);
 	    }
+	    xout[count] = px;
+	    yout[count] = py;
 	}
-	if (canvas->coords_convert_func != NULL)
-	{
-	    converted = ( (*canvas->coords_convert_func)
-			  (canvas, 1, &px, &py, &px, &py, FALSE,
-			   &canvas->coord_convert_info) );
-	}
-	else if (canvas->deprecated_coord_d_convert_func != NULL)
-	{
-	    converted = ( (*canvas->deprecated_coord_d_convert_func)
-			  (canvas, &win_scale, &px, &py, FALSE,
-			   &canvas->coord_convert_info) );
-	}
-	else if (canvas->deprecated_coord_convert_func != NULL)
-	{
-	    converted = ( (*canvas->deprecated_coord_convert_func)
-			  (canvas, &win_scale, &ix, &iy, &px, &px, FALSE,
-			   &canvas->coord_convert_info) );
-	    px = ix;
-	    py = iy;
-	}
-	if (!converted)
-	{
-	    /*  Convert x  */
-	    px = px - (double) canvas->win_scale.left_x;
-	    px /= (double) (canvas->win_scale.right_x - canvas->win_scale.left_x);
-	    px *= (double) (canvas->win_scale.x_pixels - 1);
-	    px += 0.01 + (double) canvas->win_scale.x_offset;
-	    /*  Convert y  */
-	    py = py - canvas->win_scale.bottom_y;
-	    py /= canvas->win_scale.top_y - canvas->win_scale.bottom_y;
-	    py *= (double) (canvas->win_scale.y_pixels - 1);
-	    py = (double) (canvas->win_scale.y_offset +
-			   canvas->win_scale.y_pixels - 1) - (py + 0.01);
-	}
-	xout[count] = px;
-	yout[count] = py;
+	return;
     }
+    /*  Common case: straight linear mapping of the whole array  */
+    linear_world_to_pixel (canvas, num_coords, xin, yin, xout, yout);
 }   /*  End Function canvas_convert_from_canvas_coords  */
 
 /*PUBLIC_FUNCTION*/
@@ -1528,6 +1571,9 @@ void canvas_set_dressing (KWorldCanvas canvas, ...)
     }
     va_end (arg_pointer);
     if (no_changes) return;
+    /*  Cached layout and colour are no longer valid  */
+    canvas->dressing_size_valid = FALSE;
+    canvas->dressing_pixel_valid = FALSE;
     /*  Refresh canvas  */
     canvas_resize (canvas, (struct win_scale_type *) NULL, TRUE);
 }   /*  End Function canvas_set_dressing  */
@@ -1557,7 +1603,8 @@ void canvas_sequence_dressing_refresh (KWorldCanvas canvas)
 void canvas_draw_dressing (KWorldCanvas canvas)
 /*  [SUMMARY] Draw the dressing (axes, etc.) for a world canvas.
     [NOTE] This routine is called automatically each time the canvas is
-    refreshed.
+    refreshed, unless the refresh was limited to areas which do not touch the
+    dressing.
     <canvas> The world canvas object.
     [RETURNS] Nothing.
 */
@@ -1572,18 +1619,25 @@ void canvas_draw_dressing (KWorldCanvas canvas)
     canvas->dressing_drawn = TRUE;
     if (!canvas->display_dressing) return;
     /*  Draw axes  */
-    if ( (colourname = canvas->axes_colour) == NULL )
-    {
-	colourname = def_colourname;
-    }
-    if ( !kwin_get_colour (canvas->pixcanvas, colourname, &pixel_value,
-			   (unsigned short *) NULL, (unsigned short *) NULL,
-			   (unsigned short *) NULL) )
+    if (canvas->dressing_pixel_valid) pixel_value = canvas->dressing_pixel;
+    else
     {
-	fprintf (stderr,
-			"Could not allocate colour: \"%s\" for dressing\n",
-			colourname);
-	return;
+	if ( (colourname = canvas->axes_colour) == NULL )
+	{
+	    colourname = def_colourname;
+	}
+	if ( !kwin_get_colour (canvas->pixcanvas, colourname, &pixel_value,
+			       (unsigned short *) NULL,
+			       (unsigned short *) NULL,
+			       (unsigned short *) NULL) )
+	{
+	    fprintf (stderr,
+			    "Could not allocate colour: \"%s\" for dressing\n",
+			    colourname);
+	    return;
+	}
+	canvas->dressing_pixel = pixel_value;
+	canvas->dressing_pixel_valid = TRUE;
     }
     x[0] = canvas->win_scale.x_offset - 1;
     y[0] = canvas->win_scale.y_offset - 1;
@@ -1596,8 +1650,69 @@ void canvas_draw_dressing (KWorldCanvas canvas)
     x[4] = x[0];
     y[4] = y[0];
     kwin_draw_lines (canvas->pixcanvas, x, y, 5, pixel_value);
+    canvas->dressing_box_x[0] = x[0];
+    canvas->dressing_box_x[1] = x[1];
+    canvas->dressing_box_y[0] = y[0];
+    canvas->dressing_box_y[1] = y[2];
+    canvas->dressing_box_valid = TRUE;
 }   /*  End Function canvas_draw_dressing  */
 
+/*EXPERIMENTAL_FUNCTION*/
+void canvas_retain_lower_layers (KWorldCanvas canvas)
+/*  [SUMMARY] Retain the lower layers of a world canvas in an off-screen image.
+    [PURPOSE] This routine will split the refresh functions for a world canvas
+    into lower and upper layers. The refresh functions registered before this
+    routine is called are the lower layers: on a full refresh they draw into an
+    off-screen image cache, which is then drawn onto the canvas. The refresh
+    functions registered afterwards are the upper layers and draw over it.
+    When only the upper layers have changed, [<canvas_refresh_upper_layers>]
+    redraws them over the retained image without calling the lower layer
+    refresh functions.
+    [NOTE] This routine may only be called once for a canvas. If the pixel
+    canvas cannot draw into an image cache, every refresh is a full refresh.
+    <canvas> The world canvas object.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "canvas_retain_lower_layers";
+
+    VERIFY_CANVAS (canvas);
+    if (canvas->layer_marker != NULL)
+    {
+	fprintf (stderr, "Lower layers already retained\n");
+	a_prog_bug (function_name);
+    }
+    canvas->layer_marker = canvas_register_refresh_func (canvas,
+							  layer_refresh_func,
+							  (void *) NULL);
+}   /*  End Function canvas_retain_lower_layers  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag canvas_refresh_upper_layers (KWorldCanvas canvas)
+/*  [SUMMARY] Refresh the upper layers of a world canvas.
+    [PURPOSE] This routine will refresh a world canvas by drawing the retained
+    image of the lower layers and then calling only the refresh functions
+    registered after [<canvas_retain_lower_layers>] was called. If there is no
+    valid retained image the entire canvas is refreshed.
+    <canvas> The world canvas object.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag ok;
+    static char function_name[] = "canvas_refresh_upper_layers";
+
+    VERIFY_CANVAS (canvas);
+    if (!canvas->layer_valid)
+    {
+	return ( kwin_refresh_if_visible (canvas->pixcanvas, TRUE) );
+    }
+    /*  The retained image covers the whole canvas: no need to clear  */
+    canvas->refresh_upper_only = TRUE;
+    ok = kwin_refresh_if_visible (canvas->pixcanvas, FALSE);
+    canvas->refresh_upper_only = FALSE;
+    return (ok);
+}   /*  End Function canvas_refresh_upper_layers  */
+
 /*PUBLIC_FUNCTION*/
 Kcolourmap canvas_get_cmap (KWorldCanvas canvas)
 /*  [SUMMARY] Get the Kcolourmap object associated with a world canvas.
@@ -2090,9 +2205,9 @@ flag canvas_fill_polygon (KWorldCanvas canvas, edit_coord *coords,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    unsigned int coord_count;
+    unsigned int coord_count, count, num_block;
     unsigned long pixel_value;
-    double px, py;
+    double px[COORD_BUF_SIZE], py[COORD_BUF_SIZE];
     static unsigned int num_points_allocated = 0;
     static int *point_x = NULL;
     static int *point_y = NULL;
@@ -2134,14 +2249,23 @@ flag canvas_fill_polygon (KWorldCanvas canvas, edit_coord *coords,
 	num_points_allocated = num_vertices;
     }
     /*  Convert world co-ordinates to pixel co-ordinates  */
-    for (coord_count = 0; coord_count < num_vertices; ++coord_count)
+    for (coord_count = 0; coord_count < num_vertices;
+	 coord_count += num_block)
     {
-	canvas_convert_from_canvas_coords (canvas, FALSE, FALSE, 1,
-					   &coords[coord_count].abscissa,
-					   &coords[coord_count].ordinate,
-					   &px, &py);
-	point_x[coord_count] = px;
-	point_y[coord_count] = py;
+	num_block = num_vertices - coord_count;
+	if (num_block > COORD_BUF_SIZE) num_block = COORD_BUF_SIZE;
+	for (count = 0; count < num_block; ++count)
+	{
+	    px[count] = coords[coord_count + count].abscissa;
+	    py[count] = coords[coord_count + count].ordinate;
+	}
+	canvas_convert_from_canvas_coords (canvas, FALSE, FALSE, num_block,
+					   px, py, px, py);
+	for (count = 0; count < num_block; ++count)
+	{
+	    point_x[coord_count + count] = px[count];
+	    point_y[coord_count + count] = py[count];
+	}
     }
     pixel_value = get_pixel_from_value (canvas, value, NULL, NULL, NULL);
     return ( kwin_fill_polygon (canvas->pixcanvas,
@@ -2325,12 +2449,15 @@ void canvas_draw_lines_p (KWorldCanvas canvas,
 
     VERIFY_CANVAS (canvas);
     /*  Compute extrema in non-linear world co-ordinates  */
-    wlx = canvas->win_scale.left_x;
-    wby = canvas->win_scale.bottom_y;
-    canvas_coords_transform (canvas, 1, &wlx, FALSE, &wby, FALSE);
-    wrx = canvas->win_scale.right_x;
-    wty = canvas->win_scale.top_y;
-    canvas_coords_transform (canvas, 1, &wrx, FALSE, &wty, FALSE);
+    px[0] = canvas->win_scale.left_x;
+    py[0] = canvas->win_scale.bottom_y;
+    px[1] = canvas->win_scale.right_x;
+    py[1] = canvas->win_scale.top_y;
+    canvas_coords_transform (canvas, 2, px, FALSE, py, FALSE);
+    wlx = px[0];
+    wby = py[0];
+    wrx = px[1];
+    wty = py[1];
     xscale = (wrx - wlx) / (double) (num_points - 1);
     yscale = (wty - wby) / (double) (num_points - 1);
     /*  Divide request into managable blocks  */
@@ -2842,6 +2969,7 @@ static void refresh_canvas (KWorldCanvas canvas, int width, int height,
 
     VERIFY_CANVAS (canvas);
     canvas->dressing_drawn = FALSE;
+    if (cmap_resize) canvas->dressing_pixel_valid = FALSE;
     if (canvas->quash_negotiate)
     {
 	canvas->quash_negotiate = FALSE;
@@ -2862,13 +2990,46 @@ static void refresh_canvas (KWorldCanvas canvas, int width, int height,
     data.num_areas = num_areas;
     data.areas = areas;
     data.honoured_areas = FALSE;
+    canvas->skip_lower_layers = FALSE;
+    canvas->in_lower_layers = (canvas->layer_marker == NULL) ? FALSE : TRUE;
+    if ( canvas->in_lower_layers && (pspage == NULL) )
+    {
+	if (num_areas > 0)
+	{
+	    /*  Lower layers may change the areas they refresh  */
+	    canvas->layer_valid = FALSE;
+	}
+	else if (canvas->refresh_upper_only && canvas->layer_valid)
+	{
+	    canvas->skip_lower_layers = TRUE;
+	}
+	else
+	{
+	    canvas->layer_valid = FALSE;
+	    canvas->drawing_lower_layers =
+		kwin_draw_into_cache (canvas->pixcanvas, &canvas->layer_cache);
+	}
+    }
     c_call_callbacks (canvas->refresh_list, &data);
+    canvas->in_lower_layers = FALSE;
+    canvas->skip_lower_layers = FALSE;
+    if (canvas->drawing_lower_layers)
+    {
+	/*  Should not happen, but never leave drawing redirected  */
+	kwin_draw_into_cache (canvas->pixcanvas,
+			      (KPixCanvasImageCache *) NULL);
+	canvas->drawing_lower_layers = FALSE;
+    }
     if (data.honoured_areas && (honoured_areas != NULL) )
     {
 	*honoured_areas = TRUE;
     }
     if (canvas->dressing_drawn) return;
-    if (canvas->display_dressing) canvas_draw_dressing (canvas);
+    if (!canvas->display_dressing) return;
+    /*  Areas which did not reach the dressing have left it intact  */
+    if ( data.honoured_areas && (pspage == NULL) &&
+	 !dressing_needs_refresh (canvas, num_areas, areas) ) return;
+    canvas_draw_dressing (canvas);
 }   /*  End Function refresh_canvas  */
 
 static unsigned long get_pixel_from_value (KWorldCanvas canvas,double value[2],
@@ -3014,6 +3175,8 @@ static flag refresh_event_func (void *object, void *client1_data,
     VERIFY_CANVAS (canvas);
     data = (struct refresh_struct *) call_data;
     func = ( void (*) () ) client2_data;
+    if ( canvas->skip_lower_layers && canvas->in_lower_layers &&
+	 ( func != ( void (*) () ) layer_refresh_func ) ) return (FALSE);
     m_copy ( (char *) &win_scale, (char *) &canvas->win_scale,
 	    sizeof win_scale );
     honoured_areas = FALSE;
@@ -3220,6 +3383,7 @@ static void get_dressing_size (KWorldCanvas canvas, int *p_left, int *p_right,
     storage pointed to by  p_top  .
     The number of vertical pixels required at the bottom will be written to
     the storage pointed to by  p_bottom  .
+    The size is cached in the canvas until the dressing parameters change.
     [RETURNS] Nothing.
 */
 {
@@ -3231,6 +3395,14 @@ static void get_dressing_size (KWorldCanvas canvas, int *p_left, int *p_right,
 	*p_bottom = 0;
 	return;
     }
+    if (canvas->dressing_size_valid)
+    {
+	*p_left = canvas->dressing_left;
+	*p_right = canvas->dressing_right;
+	*p_top = canvas->dressing_top;
+	*p_bottom = canvas->dressing_bottom;
+	return;
+    }
     /*  Make room for box  */
     *p_left = 1;
     *p_right = 1;
@@ -3269,8 +3441,94 @@ static void get_dressing_size (KWorldCanvas canvas, int *p_left, int *p_right,
 	/*  Show title  */
 	*p_top += 20;   /*  TEMPORARY: get font size later  */
     }
+    canvas->dressing_left = *p_left;
+    canvas->dressing_right = *p_right;
+    canvas->dressing_top = *p_top;
+    canvas->dressing_bottom = *p_bottom;
+    canvas->dressing_size_valid = TRUE;
 }   /*  End Function get_dressing_size  */
 
+static flag dressing_needs_refresh (KWorldCanvas canvas,
+				    unsigned int num_areas,
+				    KPixCanvasRefreshArea *areas)
+/*  [PURPOSE] This routine will determine if a partial refresh has disturbed
+    the dressing for a world canvas.
+    <canvas> The world canvas.
+    <num_areas> The number of areas that were refreshed. If this is 0 the
+    entire pixel canvas was refreshed.
+    <areas> The list of areas that were refreshed.
+    [RETURNS] TRUE if the dressing must be drawn, else FALSE.
+*/
+{
+    unsigned int count;
+    int x0, x1, y0, y1;
+
+    if ( (num_areas < 1) || !canvas->dressing_box_valid ) return (TRUE);
+    x0 = canvas->win_scale.x_offset - 1;
+    x1 = canvas->win_scale.x_offset + canvas->win_scale.x_pixels;
+    y0 = canvas->win_scale.y_offset - 1;
+    y1 = canvas->win_scale.y_offset + canvas->win_scale.y_pixels;
+    /*  The box must be where it was last drawn  */
+    if ( (x0 != canvas->dressing_box_x[0]) ||
+	 (x1 != canvas->dressing_box_x[1]) ||
+	 (y0 != canvas->dressing_box_y[0]) ||
+	 (y1 != canvas->dressing_box_y[1]) ) return (TRUE);
+    for (count = 0; count < num_areas; ++count)
+    {
+	/*  Areas wholly inside the box leave the dressing alone  */
+	if ( (areas[count].startx > x0) && (areas[count].endx < x1) &&
+	     (areas[count].starty > y0) && (areas[count].endy < y1) ) continue;
+	return (TRUE);
+    }
+    return (FALSE);
+}   /*  End Function dressing_needs_refresh  */
+
+static void layer_refresh_func (KWorldCanvas canvas, int width, int height,
+				struct win_scale_type *win_scale,
+				Kcolourmap cmap, flag cmap_resize, void **info,
+				PostScriptPage pspage,
+				unsigned int num_areas,
+				KPixCanvasRefreshArea *areas,
+				flag *honoured_areas)
+/*  [PURPOSE] This routine is a refresh event consumer for a world canvas. It
+    separates the lower layers from the upper layers. The lower layers have
+    either just been drawn into the retained image or are being skipped, and
+    in both cases the retained image is drawn onto the canvas.
+    <canvas> The world canvas.
+    <width> The width of the canvas in pixels.
+    <height> The height of the canvas in pixels.
+    <win_scale> A pointer to the window scaling information.
+    <cmap> The colourmap associated with the canvas.
+    <cmap_resize> TRUE if the refresh function was called as a result of a
+    colourmap resize, else FALSE.
+    <info> A pointer to the arbitrary canvas information pointer.
+    <pspage> If not NULL, the PostScriptPage object the refresh is
+    redirected to.
+    <num_areas> The number of areas that need to be refreshed. If this is
+    0 then the entire pixel canvas needs to be refreshed.
+    <areas> The list of areas that need to be refreshed.
+    <honoured_areas> If the areas were honoured TRUE is written here.
+    [RETURNS] Nothing.
+*/
+{
+    static char function_name[] = "__canvas_layer_refresh_func";
+
+    VERIFY_CANVAS (canvas);
+    canvas->in_lower_layers = FALSE;
+    /*  Nothing is drawn here for a partial refresh  */
+    if (num_areas > 0) *honoured_areas = TRUE;
+    if (canvas->skip_lower_layers)
+    {
+	canvas->skip_lower_layers = FALSE;
+	kwin_draw_cached_image (canvas->layer_cache, 0, 0);
+	return;
+    }
+    if (!canvas->drawing_lower_layers) return;
+    kwin_draw_into_cache (canvas->pixcanvas, (KPixCanvasImageCache *) NULL);
+    canvas->drawing_lower_layers = FALSE;
+    canvas->layer_valid = kwin_draw_cached_image (canvas->layer_cache, 0, 0);
+}   /*  End Function layer_refresh_func  */
+
 static void dressing_refresh_func (KWorldCanvas canvas, int width, int height,
 				   struct win_scale_type *win_scale,
 				   Kcolourmap cmap, flag cmap_resize,
@@ -3317,3 +3575,129 @@ static void set_sat_pixels (KWorldCanvas canvas)
 	}
     }
 }   /*  End Function set_sat_pixels  */
+
+static void clip_world_coords (KWorldCanvas canvas, unsigned int num_coords,
+			       CONST double *xin, CONST double *yin,
+			       double *xout, double *yout)
+/*  [PURPOSE] This routine will clip linear world co-ordinates to the
+    boundaries of a world canvas.
+    <canvas> The world canvas.
+    <num_coords> The number of co-ordinates.
+    <xin> The input horizontal co-ordinates.
+    <yin> The input vertical co-ordinates.
+    <xout> The clipped horizontal co-ordinates are written here. This may be
+    the same as <<xin>>.
+    <yout> The clipped vertical co-ordinates are written here. This may be
+    the same as <<yin>>.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+    double xmin, xmax, ymin, ymax;
+
+    xmin = canvas->win_scale.left_x;
+    xmax = canvas->win_scale.right_x;
+    if (xmin > xmax)
+    {
+	xmin = canvas->win_scale.right_x;
+	xmax = canvas->win_scale.left_x;
+    }
+    ymin = canvas->win_scale.bottom_y;
+    ymax = canvas->win_scale.top_y;
+    if (ymin > ymax)
+    {
+	ymin = canvas->win_scale.top_y;
+	ymax = canvas->win_scale.bottom_y;
+    }
+    for (count = 0; count < num_coords; ++count)
+    {
+	xout[count] = (xin[count] < xmin) ? xmin :
+	    ( (xin[count] > xmax) ? xmax : xin[count] );
+    }
+    for (count = 0; count < num_coords; ++count)
+    {
+	yout[count] = (yin[count] < ymin) ? ymin :
+	    ( (yin[count] > ymax) ? ymax : yin[count] );
+    }
+}   /*  End Function clip_world_coords  */
+
+static void linear_world_to_pixel (KWorldCanvas canvas,
+				   unsigned int num_coords,
+				   CONST double *xin, CONST double *yin,
+				   double *xout, double *yout)
+/*  [PURPOSE] This routine will convert linear world co-ordinates to pixel
+    co-ordinates using the window scaling of a world canvas only. The scale
+    factors are computed once, so the loops are simple enough for the compiler
+    to vectorise.
+    <canvas> The world canvas.
+    <num_coords> The number of co-ordinates.
+    <xin> The input horizontal co-ordinates.
+    <yin> The input vertical co-ordinates.
+    <xout> The output horizontal co-ordinates are written here. This may be
+    the same as <<xin>>.
+    <yout> The output vertical co-ordinates are written here. This may be
+    the same as <<yin>>.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+    double scale, offset, origin;
+
+    scale = (double) (canvas->win_scale.x_pixels - 1) /
+	(canvas->win_scale.right_x - canvas->win_scale.left_x);
+    origin = canvas->win_scale.left_x;
+    offset = 0.01 + (double) canvas->win_scale.x_offset;
+    for (count = 0; count < num_coords; ++count)
+    {
+	xout[count] = (xin[count] - origin) * scale + offset;
+    }
+    /*  Vertical is flipped  */
+    scale = (double) (canvas->win_scale.y_pixels - 1) /
+	(canvas->win_scale.top_y - canvas->win_scale.bottom_y);
+    origin = canvas->win_scale.bottom_y;
+    offset = (double) (canvas->win_scale.y_offset +
+		       canvas->win_scale.y_pixels - 1) - 0.01;
+    for (count = 0; count < num_coords; ++count)
+    {
+	yout[count] = offset - (yin[count] - origin) * scale;
+    }
+}   /*  End Function linear_world_to_pixel  */
+
+static void pixel_to_linear_world (KWorldCanvas canvas,
+				   unsigned int num_coords,
+				   CONST double *xin, CONST double *yin,
+				   double *xout, double *yout)
+/*  [PURPOSE] This routine will convert pixel co-ordinates to linear world
+    co-ordinates using the window scaling of a world canvas only.
+    <canvas> The world canvas.
+    <num_coords> The number of co-ordinates.
+    <xin> The input horizontal co-ordinates.
+    <yin> The input vertical co-ordinates.
+    <xout> The output horizontal co-ordinates are written here. This may be
+    the same as <<xin>>.
+    <yout> The output vertical co-ordinates are written here. This may be
+    the same as <<yin>>.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+    double scale, offset, origin;
+
+    scale = (canvas->win_scale.right_x - canvas->win_scale.left_x) /
+	(double) (canvas->win_scale.x_pixels - 1);
+    origin = canvas->win_scale.x_offset;
+    offset = canvas->win_scale.left_x;
+    for (count = 0; count < num_coords; ++count)
+    {
+	xout[count] = (xin[count] - origin) * scale + offset;
+    }
+    /*  Vertical is flipped  */
+    scale = (canvas->win_scale.top_y - canvas->win_scale.bottom_y) /
+	(double) (canvas->win_scale.y_pixels - 1);
+    origin = canvas->win_scale.y_offset + canvas->win_scale.y_pixels - 1;
+    offset = canvas->win_scale.bottom_y;
+    for (count = 0; count < num_coords; ++count)
+    {
+	yout[count] = (origin - yin[count]) * scale + offset;
+    }
+}   /*  End Function pixel_to_linear_world  */
@@ -201,7 +201,7 @@ static void log_transform_func (KWorldCanvas canvas, unsigned int num_coords,
 */
 {
     unsigned int count;
-    double tmp;
+    double log_range, scale;
     double zero = 0.0;
     struct log_transform_info *log_info;
     static char function_name[] = "__canvas_log_transform_func";
@@ -209,50 +209,42 @@ static void log_transform_func (KWorldCanvas canvas, unsigned int num_coords,
     FLAG_VERIFY (x_to_linear);
     FLAG_VERIFY (y_to_linear);
     log_info = (struct log_transform_info *) *info;
-    if (log_info->x)
+    /*  The logarithm of the range is the same for every co-ordinate, so it is
+	computed once per call rather than once per co-ordinate  */
+    if ( log_info->x && ( (left_x <= zero) || (right_x <= zero) ) )
     {
+	for (count = 0; count < num_coords; ++count) x[count] = left_x;
+    }
+    else if (log_info->x)
+    {
+	log_range = log (right_x / left_x);
+	scale = (right_x - left_x) / log_range;
 	for (count = 0; count < num_coords; ++count)
 	{
-	    if ( (x[count] < left_x) || (left_x <= zero) || (right_x <= zero) )
-	    {
-		x[count] = left_x;
-	    }
-	    else
+	    if (x[count] < left_x) x[count] = left_x;
+	    else if (x_to_linear)
 	    {
-		if (x_to_linear)
-		{
-		    x[count] = log (x[count] / left_x) /
-			log (right_x / left_x) * (right_x - left_x) + left_x;
-		}
-		else
-		{
-		    tmp = (x[count] - left_x) / (right_x - left_x);
-		    x[count] = exp (log (right_x / left_x) * tmp) * left_x;
-		}
+		x[count] = log (x[count] / left_x) * scale + left_x;
 	    }
+	    else x[count] = exp ( (x[count] - left_x) / scale ) * left_x;
 	}
     }
-    if (log_info->y)
+    if ( log_info->y && ( (bottom_y <= zero) || (top_y <= zero) ) )
     {
+	for (count = 0; count < num_coords; ++count) y[count] = bottom_y;
+    }
+    else if (log_info->y)
+    {
+	log_range = log (top_y / bottom_y);
+	scale = (top_y - bottom_y) / log_range;
 	for (count = 0; count < num_coords; ++count)
 	{
-	    if ( (y[count] < bottom_y) || (bottom_y <=zero) || (top_y <=zero) )
-	    {
-		y[count] = bottom_y;
-	    }
-	    else
+	    if (y[count] < bottom_y) y[count] = bottom_y;
+	    else if (y_to_linear)
 	    {
-		if (y_to_linear)
-		{
-		    y[count] = log (y[count] / bottom_y) /
-			log (top_y / bottom_y) * (top_y - bottom_y) + bottom_y;
-		}
-		else
-		{
-		    tmp = (y[count] - bottom_y) / (top_y - bottom_y);
-		    y[count] = exp (log (top_y / bottom_y) * tmp) * bottom_y;
-		}
+		y[count] = log (y[count] / bottom_y) * scale + bottom_y;
 	    }
+	    else y[count] = exp ( (y[count] - bottom_y) / scale ) * bottom_y;
 	}
     }
 }   /*  End Function log_transform_func  */
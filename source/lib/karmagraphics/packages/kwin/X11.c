@@ -123,6 +123,7 @@ typedef struct X11canvas_type
     KPixCanvas pixcanvas;
     Display *display;
     Window window;
+    Drawable drawable;           /*  The window or a cache being drawn into  */
     Colormap cmap;
     XVisualInfo vinfo;
     flag shm_available;
@@ -146,6 +147,8 @@ struct cache_data_type
     Pixmap pixmap;
     unsigned int p_width;        /*  The width of the Pixmap               */
     unsigned int p_height;       /*  The height of the Pixmap              */
+    int p_x_off;                 /*  Position of the image in the Pixmap   */
+    int p_y_off;
 };
 
 struct colourcell_type
@@ -206,6 +209,9 @@ STATIC_FUNCTION (flag draw_cached_image,
 		  int canvas_x_off, int canvas_y_off,
 		  int canvas_width, int canvas_height) );
 STATIC_FUNCTION (void free_cache_data, (KPixCanvasImageCache cache) );
+STATIC_FUNCTION (flag draw_into_cache,
+		 (X11Canvas x11canvas, KPixCanvasImageCache *cache_ptr,
+		  int x_off, int y_off, int width, int height) );
 STATIC_FUNCTION (flag draw_line, (X11Canvas x11canvas,
 				  double x0, double y0, double x1, double y1,
 				  unsigned long pixel_value) );
@@ -317,6 +323,7 @@ KPixCanvas kwin_create_x (Display *display, Window window, GC gc,
     m_clear ( (char *) x11canvas, sizeof *x11canvas );
     x11canvas->display = display;
     x11canvas->window = window;
+    x11canvas->drawable = window;
     x11canvas->cmap = window_attributes.colormap;
     x11canvas->gc = gc;
     /*  Get GCValues  */
@@ -504,6 +511,8 @@ KPixCanvas kwin_create_x (Display *display, Window window, GC gc,
 		   KWIN_FUNC_DRAW_RGB_IMAGE, draw_rgb_image,
 		   KWIN_FUNC_DRAW_CACHED_IMAGE, draw_cached_image,
 		   KWIN_FUNC_FREE_CACHE_DATA, free_cache_data,
+		   KWIN_FUNC_DRAW_INTO_CACHE, draw_into_cache,
+		   KWIN_CAPABILITY_CACHE_ONLY, TRUE,
 		   KWIN_FUNC_DRAW_LINE, draw_line,
 		   KWIN_FUNC_DRAW_ARC, draw_arc,
 		   KWIN_FUNC_DRAW_POLYGON, draw_polygon,
@@ -530,6 +539,8 @@ KPixCanvas kwin_create_x (Display *display, Window window, GC gc,
 		   KWIN_FUNC_DRAW_RGB_IMAGE, draw_rgb_image,
 		   KWIN_FUNC_DRAW_CACHED_IMAGE, draw_cached_image,
 		   KWIN_FUNC_FREE_CACHE_DATA, free_cache_data,
+		   KWIN_FUNC_DRAW_INTO_CACHE, draw_into_cache,
+		   KWIN_CAPABILITY_CACHE_ONLY, TRUE,
 		   KWIN_FUNC_DRAW_LINE, draw_line,
 		   KWIN_FUNC_DRAW_ARC, draw_arc,
 		   KWIN_FUNC_DRAW_POLYGON, draw_polygon,
@@ -639,7 +650,7 @@ static flag draw_point (void *v_canvas, double x, double y,
 
     VERIFY_CANVAS (x11canvas);
     set_pixel_in_gc (x11canvas, pixel_value);
-    XDrawPoint (x11canvas->display, x11canvas->window, x11canvas->gc,
+    XDrawPoint (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		(int) x, (int) y);
     return (TRUE);
 }   /*  End Function draw_point  */
@@ -662,6 +673,7 @@ static void *create_child (void *v_parent, KPixCanvas child)
     }
     m_copy ( (char *) x11child, (char *) x11parent, sizeof *x11child );
     x11child->pixcanvas = child;
+    x11child->drawable = x11child->window;
     /*  Create new Graphics Context  */
     x11child->gc = XCreateGC (x11child->display, x11child->window,
 			      GCFunction | GCPlaneMask |
@@ -690,8 +702,20 @@ static flag clear_area (void *v_canvas, int x, int y, int width, int height)
     static char function_name[] = "__kwin_X11_clear_area";
 
     VERIFY_CANVAS (x11canvas);
-    XClearArea (x11canvas->display, x11canvas->window,
-		x, y, (unsigned int) width, (unsigned int) height, False);
+    if (x11canvas->drawable == x11canvas->window)
+    {
+	XClearArea (x11canvas->display, x11canvas->window,
+		    x, y, (unsigned int) width, (unsigned int) height, False);
+	return (TRUE);
+    }
+    /*  Drawing into a cache: Pixmaps have no background so fill with the
+	background in the GC, which follows the window background  */
+    XSetForeground (x11canvas->display, x11canvas->gc,
+		    x11canvas->gcvalues.background);
+    XFillRectangle (x11canvas->display, x11canvas->drawable, x11canvas->gc,
+		    x, y, (unsigned int) width, (unsigned int) height);
+    XSetForeground (x11canvas->display, x11canvas->gc,
+		    x11canvas->gcvalues.foreground);
     return (TRUE);
 }   /*  End Function clear_area  */
 
@@ -768,6 +792,7 @@ static flag draw_pc_image (X11Canvas x11canvas, int x_off, int y_off,
 */
 {
     KPixCanvasImageCache cache;
+    flag cache_only;
     unsigned int count;
     uaddr im_red_offset, im_green_offset, im_blue_offset;
     unsigned char *ub_ptr;
@@ -928,12 +953,19 @@ static flag draw_pc_image (X11Canvas x11canvas, int x_off, int y_off,
     }
     cache->width = x_pixels;
     cache->height = y_pixels;
+    kwin_get_attributes (x11canvas->pixcanvas,
+			 KWIN_ATT_CACHE_ONLY, &cache_only,
+			 KWIN_ATT_END);
     if (cache->pixmap == (Pixmap) NULL)
     {
-	/*  No pixmap copy: just dump the image  */
-	xi_put_image (x11canvas->display, x11canvas->window, x11canvas->gc,
-		      ximage, 0, 0, x_off, y_off, cache->width, cache->height,
-		      cache->shared, TRUE);
+	/*  No pixmap copy: just dump the image. If only the cache is wanted,
+	    the image data are kept in the cached XImage  */
+	if (!cache_only)
+	{
+	    xi_put_image (x11canvas->display, x11canvas->drawable,
+			  x11canvas->gc, ximage, 0, 0, x_off, y_off,
+			  cache->width, cache->height, cache->shared, TRUE);
+	}
     }
     else
     {
@@ -942,9 +974,12 @@ static flag draw_pc_image (X11Canvas x11canvas, int x_off, int y_off,
 	xi_put_image (x11canvas->display, cache->pixmap, x11canvas->gc,
 		      ximage, 0, 0, 0, 0, cache->width, cache->height,
 		      cache->shared, TRUE);
-	XCopyArea (x11canvas->display, cache->pixmap, x11canvas->window,
-		   x11canvas->gc,
-		   0, 0, cache->width, cache->height, x_off, y_off);
+	if (!cache_only)
+	{
+	    XCopyArea (x11canvas->display, cache->pixmap, x11canvas->drawable,
+		       x11canvas->gc,
+		       0, 0, cache->width, cache->height, x_off, y_off);
+	}
     }
     if ( (ximage->depth == 24) && (getuid () == 465) )
     {
@@ -1000,6 +1035,7 @@ static flag draw_rgb_image (X11Canvas x11canvas,
 */
 {
     KPixCanvasImageCache cache;
+    flag cache_only;
     iaddr pstride;
     uaddr im_red_offset, im_green_offset, im_blue_offset;
     unsigned int count;
@@ -1125,12 +1161,19 @@ static flag draw_rgb_image (X11Canvas x11canvas,
     }
     cache->width = x_pixels;
     cache->height = y_pixels;
+    kwin_get_attributes (x11canvas->pixcanvas,
+			 KWIN_ATT_CACHE_ONLY, &cache_only,
+			 KWIN_ATT_END);
     if (cache->pixmap == (Pixmap) NULL)
     {
-	/*  No pixmap copy: just dump the image  */
-	xi_put_image (x11canvas->display, x11canvas->window, x11canvas->gc,
-		      ximage, 0, 0, x_off, y_off, cache->width, cache->height,
-		      cache->shared, TRUE);
+	/*  No pixmap copy: just dump the image. If only the cache is wanted,
+	    the image data are kept in the cached XImage  */
+	if (!cache_only)
+	{
+	    xi_put_image (x11canvas->display, x11canvas->drawable,
+			  x11canvas->gc, ximage, 0, 0, x_off, y_off,
+			  cache->width, cache->height, cache->shared, TRUE);
+	}
     }
     else
     {
@@ -1139,9 +1182,12 @@ static flag draw_rgb_image (X11Canvas x11canvas,
 	xi_put_image (x11canvas->display, cache->pixmap, x11canvas->gc,
 		      ximage, 0, 0, 0, 0, cache->width, cache->height,
 		      cache->shared, TRUE);
-	XCopyArea (x11canvas->display, cache->pixmap, x11canvas->window,
-		   x11canvas->gc,
-		   0, 0, cache->width, cache->height, x_off, y_off);
+	if (!cache_only)
+	{
+	    XCopyArea (x11canvas->display, cache->pixmap, x11canvas->drawable,
+		       x11canvas->gc,
+		       0, 0, cache->width, cache->height, x_off, y_off);
+	}
     }
 /*
     XBell (canvas->display, 100);
@@ -1241,7 +1287,7 @@ static flag draw_cached_image (KPixCanvasImageCache cache, flag wait,
 	boundaries  */
     if ( (cache->ximage != NULL) && cache->shared )
     {
-	xi_put_image (x11canvas->display, x11canvas->window, x11canvas->gc,
+	xi_put_image (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		      cache->ximage,
 		      image_x_off, image_y_off,
 		      parent_x_off, parent_y_off, image_width, image_height,
@@ -1250,15 +1296,15 @@ static flag draw_cached_image (KPixCanvasImageCache cache, flag wait,
     }
     if (cache->pixmap != (Pixmap) NULL)
     {
-	XCopyArea (x11canvas->display, cache->pixmap, x11canvas->window,
+	XCopyArea (x11canvas->display, cache->pixmap, x11canvas->drawable,
 		   x11canvas->gc,
-		   image_x_off, image_y_off,
+		   cache->p_x_off + image_x_off, cache->p_y_off + image_y_off,
 		   image_width, image_height, parent_x_off, parent_y_off);
 	return (TRUE);
     }
     if (cache->ximage == NULL) return (FALSE);
     /*  Call it again with non-pixmap, non-shared XImage  */
-    xi_put_image (x11canvas->display, x11canvas->window, x11canvas->gc,
+    xi_put_image (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		  cache->ximage,
 		  image_x_off, image_y_off,
 		  parent_x_off, parent_y_off, image_width, image_height,
@@ -1291,12 +1337,98 @@ static void free_cache_data (KPixCanvasImageCache cache)
     }
     if (cache->pixmap != (Pixmap) NULL)
     {
+	if (cache->x11canvas->drawable == cache->pixmap)
+	{
+	    cache->x11canvas->drawable = cache->x11canvas->window;
+	}
 	XFreePixmap (cache->x11canvas->display, cache->pixmap);
     }
     cache->magic_number = 0;
     m_free ( (char *) cache );
 }   /*  End Function free_cache_data  */
 
+static flag draw_into_cache (X11Canvas x11canvas,
+			     KPixCanvasImageCache *cache_ptr,
+			     int x_off, int y_off, int width, int height)
+/*  [PURPOSE] This routine will redirect drawing on an X11 canvas into a Pixmap
+    held in an image cache.
+    <x11canvas> The X11 canvas.
+    <cache_ptr> A pointer to the cache. If the value here is NULL a new cache
+    is created and written here. If this is NULL, drawing is restored to the
+    window.
+    <x_off> The horizontal offset of the canvas in the window.
+    <y_off> The vertical offset of the canvas in the window.
+    <width> The width of the canvas.
+    <height> The height of the canvas.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KPixCanvasImageCache cache;
+    unsigned int p_width, p_height;
+    static char function_name[] = "__kwin_X11_draw_into_cache";
+
+    VERIFY_CANVAS (x11canvas);
+    if (cache_ptr == NULL)
+    {
+	x11canvas->drawable = x11canvas->window;
+	return (TRUE);
+    }
+    if (r_getenv ("KWIN_DISABLE_PIXMAPS") != NULL) return (FALSE);
+    if ( (width < 1) || (height < 1) ) return (FALSE);
+    if ( (cache = *cache_ptr) == NULL )
+    {
+	if ( ( cache = (KPixCanvasImageCache) m_alloc (sizeof *cache) )
+	    == NULL )
+	{
+	    m_error_notify (function_name, "cache data structure");
+	    return (FALSE);
+	}
+	cache->pixcanvas = x11canvas->pixcanvas;
+	cache->x11canvas = x11canvas;
+	cache->magic_number = CACHE_DATA_MAGIC_NUMBER;
+	cache->ximage = NULL;
+	cache->pixmap = (Pixmap) NULL;
+	cache->shared = FALSE;
+	cache->p_width = 0;
+	cache->p_height = 0;
+    }
+    if (cache->magic_number != CACHE_DATA_MAGIC_NUMBER)
+    {
+	fprintf (stderr, "Invalid cache data\n");
+	a_prog_bug (function_name);
+    }
+    if ( (cache->x11canvas != x11canvas) || (cache->ximage != NULL) )
+    {
+	fprintf (stderr, "Cache was not created for drawing into\n");
+	a_prog_bug (function_name);
+    }
+    /*  Drawing co-ordinates are relative to the window, so the Pixmap must
+	reach the far corner of the canvas  */
+    p_width = x_off + width;
+    p_height = y_off + height;
+    if ( (cache->pixmap != (Pixmap) NULL) &&
+	 ( (p_width > cache->p_width) || (p_height > cache->p_height) ) )
+    {
+	XFreePixmap (x11canvas->display, cache->pixmap);
+	cache->pixmap = (Pixmap) NULL;
+    }
+    if (cache->pixmap == (Pixmap) NULL)
+    {
+	cache->p_width = p_width;
+	cache->p_height = p_height;
+	cache->pixmap = XCreatePixmap (x11canvas->display, x11canvas->window,
+				       p_width, p_height,
+				       x11canvas->vinfo.depth);
+    }
+    cache->width = width;
+    cache->height = height;
+    cache->p_x_off = x_off;
+    cache->p_y_off = y_off;
+    *cache_ptr = cache;
+    x11canvas->drawable = cache->pixmap;
+    return ( clear_area (x11canvas, x_off, y_off, width, height) );
+}   /*  End Function draw_into_cache  */
+
 static flag draw_line (X11Canvas x11canvas,
 		       double x0, double y0, double x1, double y1,
 		       unsigned long pixel_value)
@@ -1314,7 +1446,7 @@ static flag draw_line (X11Canvas x11canvas,
 
     VERIFY_CANVAS (x11canvas);
     set_pixel_in_gc (x11canvas, pixel_value);
-    XDrawLine (x11canvas->display, x11canvas->window, x11canvas->gc,
+    XDrawLine (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 	       (int) x0, (int) y0, (int) x1, (int) y1);
     return (TRUE);
 }   /*  End Function draw_line  */
@@ -1343,12 +1475,12 @@ static flag draw_arc (X11Canvas x11canvas,
     set_pixel_in_gc (x11canvas, pixel_value);
     if (fill)
     {
-	XFillArc (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XFillArc (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		  (int) x, (int) y, (int) width, (int) height, angle1, angle2);
     }
     else
     {
-	XDrawArc (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XDrawArc (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		  (int) x, (int) y, (int) width, (int) height, angle1, angle2);
     }
     return (TRUE);
@@ -1405,7 +1537,7 @@ static flag draw_polygon (X11Canvas x11canvas, double *x_arr, double *y_arr,
 	points[coord_count].x = (int) x_arr[coord_count];
 	points[coord_count].y = (int) y_arr[coord_count];
     }
-    XFillPolygon (x11canvas->display, x11canvas->window, x11canvas->gc,
+    XFillPolygon (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		  points, (int) num_vertices, convex ? Convex : Complex,
 		  CoordModeOrigin);
     return (TRUE);
@@ -1435,12 +1567,12 @@ static flag draw_string (X11Canvas x11canvas, double x, double y,
     length = strlen (string);
     if (clear_under)
     {
-	XDrawImageString (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XDrawImageString (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 			  (int) x, (int) y, string, length);
     }
     else
     {
-	XDrawString (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XDrawString (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		     (int) x, (int) y, string, length);
     }
     return (TRUE);
@@ -1466,13 +1598,13 @@ static flag draw_rectangle (X11Canvas x11canvas,
     set_pixel_in_gc (x11canvas, pixel_value);
     if (fill)
     {
-	XFillRectangle (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XFillRectangle (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 			(int) x, (int) y,
 			(unsigned int) width + 1, (unsigned int) height + 1);
     }
     else
     {
-	XDrawRectangle (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XDrawRectangle (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 			(int) x, (int) y,
 			(unsigned int) width, (unsigned int) height);
     }
@@ -1507,7 +1639,7 @@ static flag draw_lines (X11Canvas x11canvas,
 	if (xpoint_count >= num_xpoints_allocated)
 	{
 	    /*  Send some points now  */
-	    XDrawLines (x11canvas->display, x11canvas->window, x11canvas->gc,
+	    XDrawLines (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 			xpoints, xpoint_count, CoordModeOrigin);
 	    xpoints[0].x = (int) x_arr[ipoint_count - 1];
 	    xpoints[0].y = (int) y_arr[ipoint_count - 1];
@@ -1519,7 +1651,7 @@ static flag draw_lines (X11Canvas x11canvas,
     /*  Draw remaining points  */
     if (xpoint_count > 0)
     {
-	XDrawLines (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XDrawLines (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		    xpoints, xpoint_count, CoordModeOrigin);
     }
     return (TRUE);
@@ -1558,9 +1690,9 @@ static flag draw_arcs (X11Canvas x11canvas,
 	if (xarc_count >= num_xarcs_allocated)
 	{
 	    /*  Send some arcs now  */
-	    if (fill) XFillArcs (x11canvas->display, x11canvas->window,
+	    if (fill) XFillArcs (x11canvas->display, x11canvas->drawable,
 				 x11canvas->gc, xarcs, xarc_count);
-	    else XDrawArcs (x11canvas->display, x11canvas->window,
+	    else XDrawArcs (x11canvas->display, x11canvas->drawable,
 			    x11canvas->gc, xarcs, xarc_count);
 	    xarc_count = 0;
 	}
@@ -1574,9 +1706,9 @@ static flag draw_arcs (X11Canvas x11canvas,
     /*  Draw remaining arcs  */
     if (xarc_count > 0)
     {
-	if (fill) XFillArcs (x11canvas->display, x11canvas->window,
+	if (fill) XFillArcs (x11canvas->display, x11canvas->drawable,
 			     x11canvas->gc, xarcs, xarc_count);
-	else XDrawArcs (x11canvas->display, x11canvas->window, x11canvas->gc,
+	else XDrawArcs (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 			xarcs, xarc_count);
     }
     return (TRUE);
@@ -1613,7 +1745,7 @@ static flag draw_segments (X11Canvas x11canvas,
 	if (xsegment_count >= num_xsegments_allocated)
 	{
 	    /*  Send some segments now  */
-	    XDrawSegments (x11canvas->display, x11canvas->window,x11canvas->gc,
+	    XDrawSegments (x11canvas->display, x11canvas->drawable,x11canvas->gc,
 			   xsegments, xsegment_count);
 	    xsegment_count = 0;
 	}
@@ -1625,7 +1757,7 @@ static flag draw_segments (X11Canvas x11canvas,
     /*  Draw remaining segments  */
     if (xsegment_count > 0)
     {
-	XDrawSegments (x11canvas->display, x11canvas->window, x11canvas->gc,
+	XDrawSegments (x11canvas->display, x11canvas->drawable, x11canvas->gc,
 		       xsegments, xsegment_count);
     }
     return (TRUE);
@@ -1916,6 +2048,8 @@ static KPixCanvasImageCache size_cache (X11Canvas x11canvas,
 	cache->height = 0;
 	cache->p_width = 0;
 	cache->p_height = 0;
+	cache->p_x_off = 0;
+	cache->p_y_off = 0;
     }
     else
     {
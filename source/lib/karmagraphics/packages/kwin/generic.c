@@ -300,6 +300,18 @@ struct pixcanvas_type
     KPixCanvas parent;
     void *user_ptr;
     double line_width;
+    flag can_cache_only;
+    flag cache_only;
+    /*  Refresh throttling  */
+    unsigned long refresh_interval;  /*  Milliseconds  */
+    struct timeval last_refresh;
+    flag full_refresh_pending;
+    flag pending_clear;
+    unsigned int num_pending_areas;
+    unsigned int num_pending_allocated;
+    KPixCanvasRefreshArea *pending_areas;
+    unsigned long refreshes_requested;
+    unsigned long refreshes_performed;
     /*  The following are only used for TrueColour and DirectColour visuals  */
     unsigned long pix_red_mask;
     unsigned long pix_green_mask;
@@ -316,6 +328,7 @@ struct pixcanvas_type
     KPixFuncClearArea        clear_area;
     /*  Optional graphics system specific hooks  */
     KPixFuncFreeCacheData    free_cache_data;
+    KPixFuncDrawIntoCache    draw_into_cache;
     KPixFuncGetColour        get_colour;
     KPixFuncLoadFont         load_font;
     KPixFuncGetStringSize    get_string_size;
@@ -363,6 +376,19 @@ typedef struct
 
 /*  Private functions  */
 STATIC_FUNCTION (KPixCanvas alloc_canvas, () );
+STATIC_FUNCTION (flag resize_canvas,
+		 (KPixCanvas canvas, flag clear, int xoff, int yoff,
+		  int width, int height) );
+STATIC_FUNCTION (flag partial_refresh,
+		 (KPixCanvas canvas, unsigned int num_areas,
+		  KPixCanvasRefreshArea *areas, flag clear_all) );
+STATIC_FUNCTION (unsigned int coalesce_areas,
+		 (unsigned int num_areas, KPixCanvasRefreshArea *areas) );
+STATIC_FUNCTION (flag refresh_due, (KPixCanvas canvas) );
+STATIC_FUNCTION (flag queue_areas,
+		 (KPixCanvas canvas, unsigned int num_areas,
+		  KPixCanvasRefreshArea *areas, flag clear_all) );
+STATIC_FUNCTION (void discard_pending_refresh, (KPixCanvas canvas) );
 STATIC_FUNCTION (flag child_position_event_func,
 		 (KPixCanvas parent, int x, int y, unsigned int event_code,
 		  void *event_info, void **f_info) );
@@ -445,6 +471,7 @@ KPixCanvas kwin_create_generic (void *info, int xoff, int yoff,
 {
     va_list argp;
     KPixCanvas canvas;
+    flag bool;
     unsigned int att_key;
     void **ptr;
     static char function_name[] = "kwin_create_generic";
@@ -584,6 +611,10 @@ KPixCanvas kwin_create_generic (void *info, int xoff, int yoff,
 	    ptr = (void **) &canvas->free_cache_data;
 	    *ptr = va_arg (argp, void *);
 	    break;
+	  case KWIN_FUNC_DRAW_INTO_CACHE:
+	    ptr = (void **) &canvas->draw_into_cache;
+	    *ptr = va_arg (argp, void *);
+	    break;
 	  case KWIN_FUNC_DRAW_LINE:
 	    ptr = (void **) &canvas->draw_funcs.line;
 	    *ptr = va_arg (argp, void *);
@@ -644,6 +675,11 @@ KPixCanvas kwin_create_generic (void *info, int xoff, int yoff,
 	    ptr = (void **) &canvas->draw_funcs.set_linewidth;
 	    *ptr = va_arg (argp, void *);
 	    break;
+	  case KWIN_CAPABILITY_CACHE_ONLY:
+	    bool = va_arg (argp, flag);
+	    FLAG_VERIFY (bool);
+	    canvas->can_cache_only = bool;
+	    break;
 	  default:
 	    fprintf (stderr, "Illegal attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -792,6 +828,8 @@ flag kwin_resize (KPixCanvas canvas, flag clear, int xoff, int yoff,
     than 1 canvas is not resized, it is only refreshed.
     <height> The new height (vertical extent) of the canvas. If this is less
     than 1 canvas is not resized, it is only refreshed.
+    [NOTE] The refresh is always performed, and any queued refresh is
+    discarded.
     [RETURNS] TRUE on success, else FALSE.
 */
 {
@@ -799,49 +837,17 @@ flag kwin_resize (KPixCanvas canvas, flag clear, int xoff, int yoff,
 
     VERIFY_CANVAS (canvas);
     FLAG_VERIFY (clear);
-    canvas->pspage = NULL;
-    /*  Resize canvas  */
-    if (xoff < 0)
-    {
-	fprintf (stderr, "xoff: %d  less than 0\n", xoff);
-	return (FALSE);
-    }
-    if (yoff < 0)
-    {
-	fprintf (stderr, "yoff: %d  less than 0\n", yoff);
-	return (FALSE);
-    }
-    if ( (width > 0) && (height > 0) && (xoff >= 0) && (yoff >= 0) )
-    {
-	canvas->width = width;
-	canvas->height = height;
-	canvas->xoff = xoff;
-	canvas->yoff = yoff;
-	if (canvas->parent != NULL)
-	{
-	    canvas->xoff += canvas->parent->xoff;
-	    canvas->yoff += canvas->parent->yoff;
-	}
-    }
-    if (canvas->resize != NULL)
-    {
-	if ( !(*canvas->resize) (canvas->info, canvas->xoff, canvas->yoff,
-				 canvas->width, canvas->height) )
-	{
-	    fprintf (stderr, "%s: error resizing lower level canvas\n",
-		     function_name);
-	    return (FALSE);
-	}
-    }
-    if (clear) kwin_clear (canvas, 0, 0, -1, -1);
-    /*  Call refresh functions  */
-    c_call_callbacks (canvas->refresh_list, NULL);
-    return (TRUE);
+    ++canvas->refreshes_requested;
+    return ( resize_canvas (canvas, clear, xoff, yoff, width, height) );
 }   /*  End Function kwin_resize  */
 
 /*EXPERIMENTAL_FUNCTION*/
 flag kwin_refresh_if_visible (KPixCanvas canvas, flag clear)
 /*  [SUMMARY] Refresh a pixel canvas if it is visible.
+    [NOTE] If a refresh interval is set (see [<KWIN_ATTRIBUTES>]) and the
+    previous refresh was performed within the interval, the refresh is queued
+    rather than performed. Queued refreshes are performed by
+    [<kwin_flush_refresh>].
     <canvas> The pixel canvas.
     <clear> If TRUE the canvas is cleared prior to refreshing.
     [RETURNS] TRUE on success, else FALSE.
@@ -853,6 +859,15 @@ flag kwin_refresh_if_visible (KPixCanvas canvas, flag clear)
     FLAG_VERIFY (clear);
     canvas->pspage = NULL;
     if (!canvas->visible) return (TRUE);
+    if ( (canvas->refresh_interval > 0) && !refresh_due (canvas) )
+    {
+	/*  Too soon after the last refresh: queue it, dropping stale areas  */
+	++canvas->refreshes_requested;
+	canvas->full_refresh_pending = TRUE;
+	if (clear) canvas->pending_clear = TRUE;
+	canvas->num_pending_areas = 0;
+	return (TRUE);
+    }
     return kwin_resize (canvas, clear, 0, 0, 0, 0);
 }   /*  End Function kwin_refresh_if_visible  */
 
@@ -860,81 +875,90 @@ flag kwin_refresh_if_visible (KPixCanvas canvas, flag clear)
 flag kwin_partial_refresh (KPixCanvas canvas, unsigned int num_areas,
 			   KPixCanvasRefreshArea *areas, flag clear_all)
 /*  [SUMMARY] Perform a partial refresh of a pixel canvas.
+    [PURPOSE] This routine will perform a partial refresh of a pixel canvas.
+    Two areas are merged when the box which bounds them both is no larger than
+    the two areas together, such as when one contains the other or they abut
+    or overlap along a side. Other areas are not merged, so where they cross
+    (as a pair of crosshair strips do) the canvas is refreshed twice. If a
+    refresh interval is set (see [<KWIN_ATTRIBUTES>]) and the previous
+    refresh was performed within the interval, the areas are queued and later
+    performed by [<kwin_flush_refresh>]. Areas queued while a full refresh is
+    queued are dropped.
     <canvas> The pixel canvas.
     <num_areas> The number of areas in the pixel canvas to refresh.
     <areas> The list of areas to refresh. The values here are updated to ensure
-    all points lie within the boundaries of the pixel canvas.
+    all points lie within the boundaries of the pixel canvas, and overlapping
+    areas may be merged.
     <clear_all> If TRUE, each refreshed region is first cleared, else the
     <<clear>> field of each area determines whether an area is cleared.
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    KPixCanvasRefreshList refresh_list;
-    unsigned int count;
     static char function_name[] = "kwin_partial_refresh";
 
     VERIFY_CANVAS (canvas);
-    if (canvas->pspage != NULL)
+    FLAG_VERIFY (clear_all);
+    if (num_areas < 1) return (TRUE);
+    ++canvas->refreshes_requested;
+    if (canvas->refresh_interval < 1)
     {
-	fprintf (stderr, "Previous PostScriptPage still active\n");
-	a_prog_bug (function_name);
+	return ( partial_refresh (canvas, num_areas, areas, clear_all) );
     }
-    if (num_areas < 1) return (TRUE);
-    if (areas == NULL)
+    if ( !canvas->full_refresh_pending && (canvas->num_pending_areas < 1) &&
+	 refresh_due (canvas) )
     {
-	fprintf (stderr, "NULL areas pointer passed\n");
-	a_prog_bug (function_name);
+	return ( partial_refresh (canvas, num_areas, areas, clear_all) );
     }
-    /*  Sanitise co-ordinates and optionally clear  */
-    for (count = 0; count < num_areas; ++count)
+    /*  Merge with the queued refresh. A queued full refresh covers these  */
+    if ( !canvas->full_refresh_pending &&
+	 !queue_areas (canvas, num_areas, areas, clear_all) ) return (FALSE);
+    if ( !refresh_due (canvas) ) return (TRUE);
+    return ( kwin_flush_refresh (canvas) );
+}   /*  End Function kwin_partial_refresh  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag kwin_flush_refresh (KPixCanvas canvas)
+/*  [SUMMARY] Perform any queued refresh of a pixel canvas.
+    [PURPOSE] This routine will perform the refresh queued by
+    [<kwin_refresh_if_visible>] or [<kwin_partial_refresh>] when a refresh
+    interval is set. Applications which set a refresh interval should call this
+    routine once the interval has elapsed, for example from a timer.
+    <canvas> The pixel canvas.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag ok;
+    unsigned int num_areas;
+    KPixCanvasRefreshArea *areas;
+    static char function_name[] = "kwin_flush_refresh";
+
+    VERIFY_CANVAS (canvas);
+    if (canvas->full_refresh_pending)
     {
-	FLAG_VERIFY (areas[count].clear);
-	if (areas[count].startx < 0) areas[count].startx = 0;
-	if (areas[count].startx >= canvas->width)
+	/*  This discards the queued refresh  */
+	if (!canvas->visible)
 	{
-	    areas[count].startx = 0;
-	    areas[count].endx = -1;
-	}
-	if (areas[count].endx < 0)
-	{
-	    areas[count].startx = 0;
-	    areas[count].endx = -1;
-	}
-	if (areas[count].endx >= canvas->width)
-	{
-	    areas[count].endx = canvas->width - 1;
-	}
-	if (areas[count].starty < 0) areas[count].starty = 0;
-	if (areas[count].starty >= canvas->height)
-	{
-	    areas[count].starty = 0;
-	    areas[count].endy = -1;
-	}
-	if (areas[count].endy < 0)
-	{
-	    areas[count].starty = 0;
-	    areas[count].endy = -1;
-	}
-	if (areas[count].endy >= canvas->height)
-	{
-	    areas[count].endy = canvas->height - 1;
-	}
-	if (clear_all || areas[count].clear)
-	{
-	    if ( !kwin_clear (canvas, areas[count].startx, areas[count].starty,
-			      areas[count].endx - areas[count].startx + 1,
-			      areas[count].endy - areas[count].starty + 1) )
-	    {
-		fprintf (stderr, "Error clearing area: %u\n", count);
-		return (FALSE);
-	    }
+	    discard_pending_refresh (canvas);
+	    return (TRUE);
 	}
+	return ( resize_canvas (canvas, FALSE, 0, 0, 0, 0) );
     }
-    refresh_list.num_areas = num_areas;
-    refresh_list.areas = areas;
-    c_call_callbacks (canvas->refresh_list, &refresh_list);
-    return (TRUE);
-}   /*  End Function kwin_partial_refresh  */
+    if (canvas->num_pending_areas < 1) return (TRUE);
+    /*  Take the queue so that refresh functions may queue more areas  */
+    num_areas = canvas->num_pending_areas;
+    areas = canvas->pending_areas;
+    canvas->num_pending_areas = 0;
+    canvas->num_pending_allocated = 0;
+    canvas->pending_areas = NULL;
+    ok = partial_refresh (canvas, num_areas, areas, FALSE);
+    if (canvas->pending_areas == NULL)
+    {
+	canvas->pending_areas = areas;
+	canvas->num_pending_allocated = num_areas;
+    }
+    else m_free ( (char *) areas );
+    return (ok);
+}   /*  End Function kwin_flush_refresh  */
 
 /*PUBLIC_FUNCTION*/
 flag kwin_process_position_event (KPixCanvas canvas, int x, int y, flag clip,
@@ -1188,6 +1212,23 @@ void kwin_get_attributes (KPixCanvas canvas, ...)
 	  case KWIN_ATT_LINEWIDTH:
 	    *( va_arg (argp, double *) ) = canvas->line_width;
 	    break;
+	  case KWIN_ATT_CACHE_ONLY:
+	    *( va_arg (argp, flag *) ) = canvas->cache_only;
+	    break;
+	  case KWIN_ATT_REFRESH_INTERVAL:
+	    *( va_arg (argp, unsigned long *) ) = canvas->refresh_interval;
+	    break;
+	  case KWIN_ATT_REFRESHES_REQUESTED:
+	    *( va_arg (argp, unsigned long *) ) = canvas->refreshes_requested;
+	    break;
+	  case KWIN_ATT_REFRESHES_PERFORMED:
+	    *( va_arg (argp, unsigned long *) ) = canvas->refreshes_performed;
+	    break;
+	  case KWIN_ATT_REFRESH_PENDING:
+	    *( va_arg (argp, flag *) ) = ( canvas->full_refresh_pending ||
+					   (canvas->num_pending_areas > 0) ) ?
+		TRUE : FALSE;
+	    break;
 	  default:
 	    fprintf (stderr, "Illegal attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -1257,6 +1298,28 @@ void kwin_set_attributes (KPixCanvas canvas, ...)
 	    (*canvas->draw_funcs.set_linewidth) (canvas->draw_funcs.info,
 						 canvas->line_width);
 	    break;
+	  case KWIN_ATT_CACHE_ONLY:
+	    bool = va_arg (argp, flag);
+	    FLAG_VERIFY (bool);
+	    if (!canvas->can_cache_only)
+	    {
+		fprintf (stderr, "Cache-only drawing not supported\n");
+		continue;
+	    }
+	    canvas->cache_only = bool;
+	    break;
+	  case KWIN_ATT_REFRESH_INTERVAL:
+	    canvas->refresh_interval = va_arg (argp, unsigned long);
+	    break;
+	  case KWIN_ATT_REFRESHES_REQUESTED:
+	  case KWIN_ATT_REFRESHES_PERFORMED:
+	    fprintf (stderr, "Cannot set the refresh counters\n");
+	    a_prog_bug (function_name);
+	    break;
+	  case KWIN_ATT_REFRESH_PENDING:
+	    fprintf (stderr, "Cannot set the refresh pending flag\n");
+	    a_prog_bug (function_name);
+	    break;
 	  default:
 	    fprintf (stderr, "Illegal attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -1461,6 +1524,7 @@ flag kwin_draw_pc_image (KPixCanvas canvas, int x_off, int y_off,
 	a_prog_bug (function_name);
     }
     if (!canvas->visible) return (TRUE);
+    if (canvas->cache_only && (cache_ptr == NULL) ) return (TRUE);
     if (canvas->draw_funcs.pc_image == NULL)
     {
 	fprintf (stderr, "Cannot draw PseudoColour images\n");
@@ -1527,6 +1591,7 @@ flag kwin_draw_rgb_image (KPixCanvas canvas, int x_off, int y_off,
 	a_prog_bug (function_name);
     }
     if (!canvas->visible) return (TRUE);
+    if (canvas->cache_only && (cache_ptr == NULL) ) return (TRUE);
     if (canvas->draw_funcs.rgb_image == NULL)
     {
 	fprintf (stderr, "Cannot draw RGB images\n");
@@ -1649,6 +1714,33 @@ flag kwin_draw_cached_subimages (KPixCanvasImageCache cache,
     return (TRUE);
 }   /*  End Function kwin_draw_cached_subimages  */
 
+/*EXPERIMENTAL_FUNCTION*/
+flag kwin_draw_into_cache (KPixCanvas canvas, KPixCanvasImageCache *cache_ptr)
+/*  [SUMMARY] Redirect drawing on a pixel canvas into an image cache.
+    [PURPOSE] This routine will redirect all subsequent drawing on a pixel
+    canvas into an off-screen image cache covering the canvas, which is first
+    cleared. The cache may later be drawn onto the canvas with
+    [<kwin_draw_cached_image>], so that the result of expensive drawing need
+    not be recomputed.
+    <canvas> The pixel canvas.
+    <cache_ptr> A pointer to the cache. If the value here is NULL a new cache
+    is created and written here, else the existing cache (which must have been
+    created by this routine for the same canvas) is re-used. If this is NULL,
+    drawing is restored to the canvas.
+    [RETURNS] TRUE on success, else FALSE if the canvas cannot draw into a
+    cache, in which case drawing continues to go to the canvas.
+*/
+{
+    static char function_name[] = "kwin_draw_into_cache";
+
+    VERIFY_CANVAS (canvas);
+    if (canvas->draw_into_cache == NULL) return (FALSE);
+    if ( (cache_ptr != NULL) && (canvas->pspage != NULL) ) return (FALSE);
+    return ( (*canvas->draw_into_cache) (canvas->info, cache_ptr,
+					 canvas->xoff, canvas->yoff,
+					 canvas->width, canvas->height) );
+}   /*  End Function kwin_draw_into_cache  */
+
 /*PUBLIC_FUNCTION*/
 flag kwin_draw_point (KPixCanvas canvas, double x, double y,
 		      unsigned long pixel_value)
@@ -2828,10 +2920,310 @@ static KPixCanvas alloc_canvas ()
     canvas->create_child = ( void *(*) () ) NULL;
     canvas->user_ptr = NULL;
     canvas->line_width = 0.0;
+    canvas->can_cache_only = FALSE;
+    canvas->cache_only = FALSE;
+    canvas->refresh_interval = 0;
+    canvas->last_refresh.tv_sec = 0;
+    canvas->last_refresh.tv_usec = 0;
+    canvas->full_refresh_pending = FALSE;
+    canvas->pending_clear = FALSE;
+    canvas->num_pending_areas = 0;
+    canvas->num_pending_allocated = 0;
+    canvas->pending_areas = NULL;
+    canvas->refreshes_requested = 0;
+    canvas->refreshes_performed = 0;
     canvas->magic_number = CANVAS_MAGIC_NUMBER;
     return (canvas);
 }   /*  End Function alloc_canvas  */
 
+static flag resize_canvas (KPixCanvas canvas, flag clear, int xoff, int yoff,
+			  int width, int height)
+/*  [PURPOSE] This routine will resize a pixel canvas and call the refresh
+    functions. See [<kwin_resize>] for details. Any queued refresh is
+    discarded.
+    <canvas> The canvas.
+    <clear> If TRUE, the canvas is first cleared.
+    <xoff> The horizontal offset of the canvas origin.
+    <yoff> The vertical offset of the canvas origin.
+    <width> The new width of the canvas.
+    <height> The new height of the canvas.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    static char function_name[] = "resize_canvas";
+
+    canvas->pspage = NULL;
+    /*  Resize canvas  */
+    if (xoff < 0)
+    {
+	fprintf (stderr, "xoff: %d  less than 0\n", xoff);
+	return (FALSE);
+    }
+    if (yoff < 0)
+    {
+	fprintf (stderr, "yoff: %d  less than 0\n", yoff);
+	return (FALSE);
+    }
+    if ( (width > 0) && (height > 0) && (xoff >= 0) && (yoff >= 0) )
+    {
+	canvas->width = width;
+	canvas->height = height;
+	canvas->xoff = xoff;
+	canvas->yoff = yoff;
+	if (canvas->parent != NULL)
+	{
+	    canvas->xoff += canvas->parent->xoff;
+	    canvas->yoff += canvas->parent->yoff;
+	}
+    }
+    if (canvas->resize != NULL)
+    {
+	if ( !(*canvas->resize) (canvas->info, canvas->xoff, canvas->yoff,
+				 canvas->width, canvas->height) )
+	{
+	    fprintf (stderr, "%s: error resizing lower level canvas\n",
+		     function_name);
+	    return (FALSE);
+	}
+    }
+    if (clear || canvas->pending_clear) kwin_clear (canvas, 0, 0, -1, -1);
+    /*  A full refresh makes any queued refresh stale  */
+    discard_pending_refresh (canvas);
+    /*  Call refresh functions  */
+    c_call_callbacks (canvas->refresh_list, NULL);
+    ++canvas->refreshes_performed;
+    gettimeofday (&canvas->last_refresh, NULL);
+    return (TRUE);
+}   /*  End Function resize_canvas  */
+
+static flag partial_refresh (KPixCanvas canvas, unsigned int num_areas,
+			     KPixCanvasRefreshArea *areas, flag clear_all)
+/*  [PURPOSE] This routine will perform a partial refresh of a pixel canvas
+    immediately. See [<kwin_partial_refresh>] for details.
+    <canvas> The pixel canvas.
+    <num_areas> The number of areas in the pixel canvas to refresh.
+    <areas> The list of areas to refresh. This is modified.
+    <clear_all> If TRUE, each refreshed region is first cleared.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KPixCanvasRefreshList refresh_list;
+    unsigned int count;
+    static char function_name[] = "partial_refresh";
+
+    if (canvas->pspage != NULL)
+    {
+	fprintf (stderr, "Previous PostScriptPage still active\n");
+	a_prog_bug (function_name);
+    }
+    if (areas == NULL)
+    {
+	fprintf (stderr, "NULL areas pointer passed\n");
+	a_prog_bug (function_name);
+    }
+    /*  Sanitise co-ordinates  */
+    for (count = 0; count < num_areas; ++count)
+    {
+	FLAG_VERIFY (areas[count].clear);
+	if (areas[count].startx < 0) areas[count].startx = 0;
+	if (areas[count].startx >= canvas->width)
+	{
+	    areas[count].startx = 0;
+	    areas[count].endx = -1;
+	}
+	if (areas[count].endx < 0)
+	{
+	    areas[count].startx = 0;
+	    areas[count].endx = -1;
+	}
+	if (areas[count].endx >= canvas->width)
+	{
+	    areas[count].endx = canvas->width - 1;
+	}
+	if (areas[count].starty < 0) areas[count].starty = 0;
+	if (areas[count].starty >= canvas->height)
+	{
+	    areas[count].starty = 0;
+	    areas[count].endy = -1;
+	}
+	if (areas[count].endy < 0)
+	{
+	    areas[count].starty = 0;
+	    areas[count].endy = -1;
+	}
+	if (areas[count].endy >= canvas->height)
+	{
+	    areas[count].endy = canvas->height - 1;
+	}
+    }
+    /*  Merge contained and adjoining areas so they are not drawn twice  */
+    if ( ( num_areas = coalesce_areas (num_areas, areas) ) < 1 )
+    {
+	return (TRUE);
+    }
+    for (count = 0; count < num_areas; ++count)
+    {
+	if (clear_all || areas[count].clear)
+	{
+	    if ( !kwin_clear (canvas, areas[count].startx, areas[count].starty,
+			      areas[count].endx - areas[count].startx + 1,
+			      areas[count].endy - areas[count].starty + 1) )
+	    {
+		fprintf (stderr, "Error clearing area: %u\n", count);
+		return (FALSE);
+	    }
+	}
+    }
+    refresh_list.num_areas = num_areas;
+    refresh_list.areas = areas;
+    c_call_callbacks (canvas->refresh_list, &refresh_list);
+    ++canvas->refreshes_performed;
+    gettimeofday (&canvas->last_refresh, NULL);
+    return (TRUE);
+}   /*  End Function partial_refresh  */
+
+static unsigned int coalesce_areas (unsigned int num_areas,
+				    KPixCanvasRefreshArea *areas)
+/*  [PURPOSE] This routine will coalesce a list of refresh areas in place.
+    Empty areas are removed. Two areas are merged when their bounding box is
+    no larger than the two areas together. This merges contained areas and
+    areas which abut or overlap along a side, without refreshing much that was
+    not asked for. Crossing areas are left separate.
+    <num_areas> The number of areas.
+    <areas> The list of areas. This is modified.
+    [RETURNS] The number of areas remaining.
+*/
+{
+    flag merged;
+    int startx, endx, starty, endy;
+    unsigned int count, other;
+    long size0, size1, box_size;
+
+    /*  Remove empty areas  */
+    for (count = 0, other = 0; count < num_areas; ++count)
+    {
+	if (areas[count].endx < areas[count].startx) continue;
+	if (areas[count].endy < areas[count].starty) continue;
+	areas[other++] = areas[count];
+    }
+    num_areas = other;
+    do
+    {
+	merged = FALSE;
+	for (count = 0; count < num_areas; ++count)
+	{
+	    size0 = (long) (areas[count].endx - areas[count].startx + 1) *
+		(long) (areas[count].endy - areas[count].starty + 1);
+	    for (other = count + 1; other < num_areas;)
+	    {
+		size1 = (long) (areas[other].endx - areas[other].startx + 1) *
+		    (long) (areas[other].endy - areas[other].starty + 1);
+		startx = (areas[count].startx < areas[other].startx) ?
+		    areas[count].startx : areas[other].startx;
+		endx = (areas[count].endx > areas[other].endx) ?
+		    areas[count].endx : areas[other].endx;
+		starty = (areas[count].starty < areas[other].starty) ?
+		    areas[count].starty : areas[other].starty;
+		endy = (areas[count].endy > areas[other].endy) ?
+		    areas[count].endy : areas[other].endy;
+		box_size = (long) (endx - startx + 1) *
+		    (long) (endy - starty + 1);
+		if (box_size > size0 + size1)
+		{
+		    ++other;
+		    continue;
+		}
+		areas[count].startx = startx;
+		areas[count].endx = endx;
+		areas[count].starty = starty;
+		areas[count].endy = endy;
+		if (areas[other].clear) areas[count].clear = TRUE;
+		size0 = box_size;
+		areas[other] = areas[--num_areas];
+		merged = TRUE;
+	    }
+	}
+    } while (merged);
+    return (num_areas);
+}   /*  End Function coalesce_areas  */
+
+static flag refresh_due (KPixCanvas canvas)
+/*  [PURPOSE] This routine will determine if the refresh interval for a pixel
+    canvas has elapsed since the last refresh was performed.
+    <canvas> The pixel canvas.
+    [RETURNS] TRUE if the refresh interval has elapsed, else FALSE.
+*/
+{
+    long elapsed;
+    struct timeval now;
+
+    if (canvas->refresh_interval < 1) return (TRUE);
+    gettimeofday (&now, NULL);
+    elapsed = (now.tv_sec - canvas->last_refresh.tv_sec) * 1000 +
+	(now.tv_usec - canvas->last_refresh.tv_usec) / 1000;
+    /*  Also catch the clock going backwards  */
+    if (elapsed < 0) return (TRUE);
+    return ( (unsigned long) elapsed >= canvas->refresh_interval ?
+	     TRUE : FALSE );
+}   /*  End Function refresh_due  */
+
+static flag queue_areas (KPixCanvas canvas, unsigned int num_areas,
+			 KPixCanvasRefreshArea *areas, flag clear_all)
+/*  [PURPOSE] This routine will append areas to the queued partial refresh of a
+    pixel canvas.
+    <canvas> The pixel canvas.
+    <num_areas> The number of areas.
+    <areas> The list of areas.
+    <clear_all> If TRUE, each area is to be cleared when refreshed.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count, num_alloc;
+    KPixCanvasRefreshArea *new_areas;
+    static char function_name[] = "__kwin_queue_areas";
+
+    if (canvas->num_pending_areas + num_areas > canvas->num_pending_allocated)
+    {
+	num_alloc = 2 * (canvas->num_pending_areas + num_areas);
+	if ( ( new_areas = (KPixCanvasRefreshArea *)
+	       m_alloc (num_alloc * sizeof *new_areas) ) == NULL )
+	{
+	    m_error_notify (function_name, "refresh areas");
+	    return (FALSE);
+	}
+	if (canvas->pending_areas != NULL)
+	{
+	    m_copy ( (char *) new_areas, (char *) canvas->pending_areas,
+		     canvas->num_pending_areas * sizeof *new_areas );
+	    m_free ( (char *) canvas->pending_areas );
+	}
+	canvas->pending_areas = new_areas;
+	canvas->num_pending_allocated = num_alloc;
+    }
+    for (count = 0; count < num_areas; ++count)
+    {
+	FLAG_VERIFY (areas[count].clear);
+	new_areas = canvas->pending_areas + canvas->num_pending_areas++;
+	*new_areas = areas[count];
+	if (clear_all) new_areas->clear = TRUE;
+    }
+    /*  Keep the queue short during long bursts  */
+    canvas->num_pending_areas = coalesce_areas (canvas->num_pending_areas,
+						canvas->pending_areas);
+    return (TRUE);
+}   /*  End Function queue_areas  */
+
+static void discard_pending_refresh (KPixCanvas canvas)
+/*  [PURPOSE] This routine will discard any queued refresh for a pixel canvas.
+    <canvas> The pixel canvas.
+    [RETURNS] Nothing.
+*/
+{
+    canvas->full_refresh_pending = FALSE;
+    canvas->pending_clear = FALSE;
+    canvas->num_pending_areas = 0;
+}   /*  End Function discard_pending_refresh  */
+
 static flag child_position_event_func (KPixCanvas parent, int x, int y,
 				       unsigned int event_code,
 				       void *event_info, void **f_info)
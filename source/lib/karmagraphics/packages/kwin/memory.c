@@ -0,0 +1,1335 @@
+/*LINTLIBRARY*/
+/*  memory.c
+
+    This code provides KPixCanvas objects.
+
+    Copyright (C) 1996  Richard Gooch
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This file contains all routines needed for manipulating a simple pixel
+    canvas (window) independent of the graphics system in use. This file
+    contains the memory (framebuffer) code, which draws into a buffer supplied
+    by the application and needs no display.
+
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <karma.h>
+#define KWIN_GENERIC_ONLY
+#include <karma_kwin.h>
+#include <karma_imw.h>
+#include <karma_ds.h>
+#include <karma_st.h>
+#include <karma_a.h>
+#include <karma_m.h>
+
+#define KPixHookCanvas MemCanvas
+
+typedef struct memcanvas_type
+{
+    unsigned int magic_number;
+    KPixCanvas pixcanvas;
+    struct memcanvas_type *root;  /*  The canvas which owns the buffer  */
+    unsigned char *buffer;
+    int width;
+    int height;
+    unsigned int bytes_per_pixel;
+    unsigned int stride;
+    int line_width;
+    /*  The following are only used in the root canvas  */
+    unsigned char *scratch;
+    uaddr scratch_size;
+    unsigned short reds[256];
+    unsigned short greens[256];
+    unsigned short blues[256];
+    flag allocated[256];
+} *MemCanvas;
+
+#include <karma_kwin_hooks.h>
+
+
+#define CANVAS_MAGIC_NUMBER (unsigned int) 1298734561
+#define VERIFY_CANVAS(canvas) if (canvas == NULL) \
+{fprintf (stderr, "NULL canvas passed\n"); \
+ a_prog_bug (function_name); } \
+if (canvas->magic_number != CANVAS_MAGIC_NUMBER) \
+{fprintf (stderr, "Invalid canvas object\n"); \
+ a_prog_bug (function_name); }
+
+#define RED_MASK 0xff
+#define GREEN_MASK 0xff00
+#define BLUE_MASK 0xff0000
+#define PACK_RGB(r,g,b) ( (unsigned long) (r) | ( (unsigned long) (g) << 8 ) |\
+			  ( (unsigned long) (b) << 16 ) )
+#define NUM_SPECIAL_PIXELS 3
+#define MIN_ARC_SEGMENTS 16
+#define MAX_ARC_SEGMENTS 2048
+
+/*  Structure declarations  */
+
+struct named_colour_type
+{
+    char *name;
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+};
+
+
+/*  Private data  */
+static struct named_colour_type named_colours[] =
+{
+    {"black", 0, 0, 0},
+    {"white", 255, 255, 255},
+    {"red", 255, 0, 0},
+    {"green", 0, 255, 0},
+    {"blue", 0, 0, 255},
+    {"yellow", 255, 255, 0},
+    {"cyan", 0, 255, 255},
+    {"magenta", 255, 0, 255},
+    {"orange", 255, 165, 0},
+    {"purple", 160, 32, 240},
+    {"grey", 190, 190, 190},
+    {"gray", 190, 190, 190},
+    {"grey50", 127, 127, 127},
+    {"gray50", 127, 127, 127},
+    {"aquamarine", 127, 255, 212},
+    {"turquoise", 64, 224, 208},
+    {"pink", 255, 192, 203},
+    {"brown", 165, 42, 42},
+    {"navy", 0, 0, 128},
+    {NULL, 0, 0, 0}
+};
+
+
+/*  Mandatory functions  */
+STATIC_FUNCTION (flag draw_point, (MemCanvas memcanvas, double x, double y,
+				   unsigned long pixel_value) );
+STATIC_FUNCTION (MemCanvas create_child,
+		 (MemCanvas parent, KPixCanvas child) );
+STATIC_FUNCTION (flag clear_area, (MemCanvas memcanvas, int x, int y,
+				   int width, int height) );
+/*  Optional hook functions  */
+STATIC_FUNCTION (flag draw_pc_image,
+		 (MemCanvas memcanvas,
+		  int x_off, int y_off, int x_pixels, int y_pixels,
+		  CONST char *slice,
+		  CONST uaddr *hoffsets, CONST uaddr *voffsets,
+		  unsigned int width, unsigned int height,
+		  unsigned int type, unsigned int conv_type,
+		  unsigned int num_pixels, unsigned long *pixel_values,
+		  unsigned long blank_pixel,
+		  unsigned long min_sat_pixel, unsigned long max_sat_pixel,
+		  double i_min, double i_max,
+		  flag (*iscale_func) (), void *iscale_info,
+		  KPixCanvasImageCache *cache_ptr) );
+STATIC_FUNCTION (flag draw_rgb_image,
+		 (MemCanvas memcanvas,
+		  int x_off, int y_off, int x_pixels, int y_pixels,
+		  CONST unsigned char *red_slice,
+		  CONST unsigned char *green_slice,
+		  CONST unsigned char *blue_slice,
+		  CONST uaddr *hoffsets, CONST uaddr *voffsets,
+		  unsigned int width, unsigned int height,
+		  KPixCanvasImageCache *cache_ptr) );
+STATIC_FUNCTION (flag draw_line, (MemCanvas memcanvas,
+				  double x0, double y0, double x1, double y1,
+				  unsigned long pixel_value) );
+STATIC_FUNCTION (flag draw_arc,
+		 (MemCanvas memcanvas,
+		  double x, double y, double width, double height,
+		  int angle1, int angle2, unsigned long pixel_value,
+		  flag fill) );
+STATIC_FUNCTION (flag draw_polygon,
+		 (MemCanvas memcanvas, double *x_arr, double *y_arr,
+		  unsigned int num_vertices, unsigned long pixel_value,
+		  flag convex, flag fill) );
+STATIC_FUNCTION (flag draw_string,
+		 (MemCanvas memcanvas, double x, double y,
+		  CONST char *string, unsigned long pixel_value,
+		  flag clear_under) );
+STATIC_FUNCTION (flag draw_rectangle,
+		 (MemCanvas memcanvas,
+		  double x, double y, double width, double height,
+		  unsigned long pixel_value, flag fill) );
+STATIC_FUNCTION (flag get_colour,
+		 (MemCanvas memcanvas, CONST char *colourname,
+		  unsigned long *pixel_value, unsigned short *red,
+		  unsigned short *green, unsigned short *blue) );
+STATIC_FUNCTION (flag query_colourmap,
+		 (MemCanvas memcanvas, unsigned long *pixels,
+		  unsigned short *reds, unsigned short *greens,
+		  unsigned short *blues, unsigned int num_colours) );
+STATIC_FUNCTION (flag set_linewidth, (MemCanvas memcanvas, double linewidth) );
+
+/*  Private functions  */
+STATIC_FUNCTION (void fill_span,
+		 (MemCanvas memcanvas, int y, int x0, int x1,
+		  unsigned long pixel_value) );
+STATIC_FUNCTION (unsigned char *get_scratch,
+		 (MemCanvas memcanvas, uaddr size) );
+STATIC_FUNCTION (void copy_indexed_image,
+		 (MemCanvas memcanvas, int x_off, int y_off,
+		  int x_pixels, int y_pixels, CONST unsigned char *image,
+		  CONST unsigned long *pixels) );
+STATIC_FUNCTION (flag parse_colour,
+		 (CONST char *colourname, unsigned char *red,
+		  unsigned char *green, unsigned char *blue) );
+STATIC_FUNCTION (MemCanvas get_root, (Kdisplay dpy_handle) );
+
+
+/*  Public functions follow  */
+
+/*EXPERIMENTAL_FUNCTION*/
+KPixCanvas kwin_create_memory (unsigned char *buffer, int width, int height,
+			       unsigned int depth, unsigned int stride)
+/*  [SUMMARY] Create a pixel canvas which draws into memory.
+    [PURPOSE] This routine will create a pixel canvas, ready for drawing, which
+    draws into a buffer in memory rather than onto a display. This allows
+    images, contours and overlays to be rendered without a display, for example
+    to generate thumbnails in batch jobs. Note that the origin of a KPixCanvas
+    is the upper-left corner.
+    <buffer> The buffer to draw into. This must remain valid for the life of
+    the canvas.
+    <width> The width of the canvas in pixels.
+    <height> The height of the canvas in pixels.
+    <depth> The depth of the canvas in bits. If this is 8 the canvas is a
+    PseudoColour canvas with one byte per pixel, each byte being an index into
+    a 256 entry colourmap. If this is 24 the canvas is a TrueColour canvas
+    with four bytes per pixel, in the order red, green, blue and alpha. The
+    alpha byte is always set to 255.
+    <stride> The number of bytes between the start of successive lines in the
+    buffer. If this is 0 the lines are packed.
+    [NOTE] For a PseudoColour canvas, colourmaps may be created with
+    [<kcmap_va_create>] by passing the display handle from
+    [<kwin_memory_get_dpy_handle>] and the <<kwin_memory_*_colours>>
+    routines.
+    [RETURNS] A pixel canvas on success, else NULL.
+*/
+{
+    KPixCanvas canvas;
+    MemCanvas memcanvas;
+    unsigned int count;
+    uaddr red_offset, green_offset, blue_offset;
+    unsigned long mask;
+    unsigned char *ch_ptr;
+    static char function_name[] = "kwin_create_memory";
+
+    if (buffer == NULL)
+    {
+	fprintf (stderr, "NULL buffer pointer passed\n");
+	a_prog_bug (function_name);
+    }
+    if ( (depth != 8) && (depth != 24) )
+    {
+	fprintf (stderr, "Depth: %u is not 8 or 24\n", depth);
+	return (NULL);
+    }
+    if ( (width < 1) || (height < 1) )
+    {
+	fprintf (stderr, "Bad canvas size: %dx%d\n", width, height);
+	return (NULL);
+    }
+    if ( ( memcanvas = (MemCanvas) m_alloc (sizeof *memcanvas) ) == NULL )
+    {
+	m_error_notify (function_name, "memory pixel canvas");
+	return (NULL);
+    }
+    m_clear ( (char *) memcanvas, sizeof *memcanvas );
+    memcanvas->root = memcanvas;
+    memcanvas->buffer = buffer;
+    memcanvas->width = width;
+    memcanvas->height = height;
+    memcanvas->bytes_per_pixel = (depth == 8) ? 1 : 4;
+    if (stride == 0) stride = width * memcanvas->bytes_per_pixel;
+    memcanvas->stride = stride;
+    memcanvas->line_width = 1;
+    memcanvas->scratch = NULL;
+    memcanvas->scratch_size = 0;
+    for (count = 0; count < 256; ++count) memcanvas->allocated[count] = FALSE;
+    if (depth == 8)
+    {
+	canvas = ( kwin_create_generic
+		   (memcanvas, 0, 0, width, height, depth,
+		    KWIN_VISUAL_PSEUDOCOLOUR, TRUE,
+		    draw_point, create_child, clear_area,
+		    KWIN_FUNC_DRAW_PC_IMAGE, draw_pc_image,
+		    KWIN_FUNC_DRAW_RGB_IMAGE, draw_rgb_image,
+		    KWIN_FUNC_DRAW_LINE, draw_line,
+		    KWIN_FUNC_DRAW_ARC, draw_arc,
+		    KWIN_FUNC_DRAW_POLYGON, draw_polygon,
+		    KWIN_FUNC_DRAW_STRING, draw_string,
+		    KWIN_FUNC_DRAW_RECTANGLE, draw_rectangle,
+		    KWIN_FUNC_GET_COLOUR, get_colour,
+		    KWIN_FUNC_QUERY_COLOURMAP, query_colourmap,
+		    KWIN_FUNC_SET_LINEWIDTH, set_linewidth,
+		    KWIN_ATT_END) );
+    }
+    else
+    {
+	/*  Compute the byte offsets of each component in a pixel value  */
+	mask = RED_MASK;
+	ch_ptr = (unsigned char *) &mask;
+	for (red_offset = 0; ch_ptr[red_offset] == 0; ++red_offset);
+	mask = GREEN_MASK;
+	for (green_offset = 0; ch_ptr[green_offset] == 0; ++green_offset);
+	mask = BLUE_MASK;
+	for (blue_offset = 0; ch_ptr[blue_offset] == 0; ++blue_offset);
+	canvas = ( kwin_create_generic
+		   (memcanvas, 0, 0, width, height, depth,
+		    KWIN_VISUAL_TRUECOLOUR, TRUE,
+		    draw_point, create_child, clear_area,
+		    KWIN_ATT_PIX_RED_MASK, (unsigned long) RED_MASK,
+		    KWIN_ATT_PIX_GREEN_MASK, (unsigned long) GREEN_MASK,
+		    KWIN_ATT_PIX_BLUE_MASK, (unsigned long) BLUE_MASK,
+		    KWIN_ATT_IM_RED_MASK, (unsigned long) RED_MASK,
+		    KWIN_ATT_IM_GREEN_MASK, (unsigned long) GREEN_MASK,
+		    KWIN_ATT_IM_BLUE_MASK, (unsigned long) BLUE_MASK,
+		    KWIN_ATT_IM_RED_OFFSET, red_offset,
+		    KWIN_ATT_IM_GREEN_OFFSET, green_offset,
+		    KWIN_ATT_IM_BLUE_OFFSET, blue_offset,
+		    KWIN_FUNC_DRAW_PC_IMAGE, draw_pc_image,
+		    KWIN_FUNC_DRAW_RGB_IMAGE, draw_rgb_image,
+		    KWIN_FUNC_DRAW_LINE, draw_line,
+		    KWIN_FUNC_DRAW_ARC, draw_arc,
+		    KWIN_FUNC_DRAW_POLYGON, draw_polygon,
+		    KWIN_FUNC_DRAW_STRING, draw_string,
+		    KWIN_FUNC_DRAW_RECTANGLE, draw_rectangle,
+		    KWIN_FUNC_GET_COLOUR, get_colour,
+		    KWIN_FUNC_QUERY_COLOURMAP, query_colourmap,
+		    KWIN_FUNC_SET_LINEWIDTH, set_linewidth,
+		    KWIN_ATT_END) );
+    }
+    if (canvas == NULL)
+    {
+	m_free ( (char *) memcanvas );
+	return (NULL);
+    }
+    memcanvas->magic_number = CANVAS_MAGIC_NUMBER;
+    memcanvas->pixcanvas = canvas;
+    return (canvas);
+}   /*  End Function kwin_create_memory  */
+
+/*EXPERIMENTAL_FUNCTION*/
+Kdisplay kwin_memory_get_dpy_handle (KPixCanvas canvas)
+/*  [SUMMARY] Get the display handle for a memory canvas.
+    [PURPOSE] This routine will get the display handle for a PseudoColour
+    memory canvas, which may be passed to [<kcmap_va_create>] along with
+    [<kwin_memory_alloc_colours>], [<kwin_memory_free_colours>],
+    [<kwin_memory_store_colours>] and [<kwin_memory_get_location>].
+    <canvas> A pixel canvas created with [<kwin_create_memory>].
+    [RETURNS] The display handle.
+*/
+{
+    MemCanvas memcanvas;
+    static char function_name[] = "kwin_memory_get_dpy_handle";
+
+    kwin_get_attributes (canvas,
+			 KWIN_ATT_LOWER_HANDLE, &memcanvas,
+			 KWIN_ATT_END);
+    VERIFY_CANVAS (memcanvas);
+    return ( (Kdisplay) memcanvas->root );
+}   /*  End Function kwin_memory_get_dpy_handle  */
+
+/*EXPERIMENTAL_FUNCTION*/
+unsigned int kwin_memory_alloc_colours (unsigned int num_cells,
+					unsigned long *pixel_values,
+					unsigned int min_cells,
+					Kdisplay dpy_handle)
+/*  [SUMMARY] Allocate colourcells in the colourmap of a memory canvas.
+    <num_cells> The number of colourcells to allocate.
+    <pixel_values> The pixel values allocated will be written here.
+    <min_cells> The minimum number of colourcells to allocate.
+    <dpy_handle> The display handle from [<kwin_memory_get_dpy_handle>].
+    [RETURNS] The number of colourcells allocated. If fewer than <<min_cells>>
+    could be allocated, none are allocated and 0 is returned.
+*/
+{
+    unsigned int count, num_allocated;
+    MemCanvas root;
+
+    root = get_root (dpy_handle);
+    for (count = 0, num_allocated = 0;
+	 (count < 256) && (num_allocated < num_cells); ++count)
+    {
+	if (root->allocated[count]) continue;
+	root->allocated[count] = TRUE;
+	pixel_values[num_allocated++] = count;
+    }
+    if (num_allocated >= min_cells) return (num_allocated);
+    for (count = 0; count < num_allocated; ++count)
+    {
+	root->allocated[pixel_values[count]] = FALSE;
+    }
+    return (0);
+}   /*  End Function kwin_memory_alloc_colours  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void kwin_memory_free_colours (unsigned int num_cells,
+			       unsigned long *pixel_values,
+			       Kdisplay dpy_handle)
+/*  [SUMMARY] Free colourcells in the colourmap of a memory canvas.
+    <num_cells> The number of colourcells to free.
+    <pixel_values> The pixel values to free.
+    <dpy_handle> The display handle from [<kwin_memory_get_dpy_handle>].
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+    MemCanvas root;
+
+    root = get_root (dpy_handle);
+    for (count = 0; count < num_cells; ++count)
+    {
+	if (pixel_values[count] < 256)
+	{
+	    root->allocated[pixel_values[count]] = FALSE;
+	}
+    }
+}   /*  End Function kwin_memory_free_colours  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void kwin_memory_store_colours (unsigned int num_cells,
+				unsigned long *pixel_values,
+				unsigned short *reds, unsigned short *greens,
+				unsigned short *blues, unsigned int stride,
+				Kdisplay dpy_handle)
+/*  [SUMMARY] Store colours in the colourmap of a memory canvas.
+    <num_cells> The number of colourcells to store.
+    <pixel_values> The pixel values.
+    <reds> The red intensity values.
+    <greens> The green intensity values.
+    <blues> The blue intensity values.
+    <stride> The stride (in unsigned shorts) between intensity values.
+    <dpy_handle> The display handle from [<kwin_memory_get_dpy_handle>].
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+    unsigned long pixel;
+    MemCanvas root;
+
+    root = get_root (dpy_handle);
+    for (count = 0; count < num_cells; ++count)
+    {
+	if ( ( pixel = pixel_values[count] ) > 255 ) continue;
+	root->reds[pixel] = reds[count * stride];
+	root->greens[pixel] = greens[count * stride];
+	root->blues[pixel] = blues[count * stride];
+    }
+}   /*  End Function kwin_memory_store_colours  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void kwin_memory_get_location (Kdisplay dpy_handle,
+			       unsigned long *serv_hostaddr,
+			       unsigned long *serv_display_num)
+/*  [SUMMARY] Get the location of a memory canvas.
+    [PURPOSE] This routine will determine the location of a memory canvas. A
+    memory canvas is not attached to any display, so the location is always
+    0.
+    <dpy_handle> The display handle from [<kwin_memory_get_dpy_handle>].
+    <serv_hostaddr> The Internet address of the host is written here.
+    <serv_display_num> The number of the display is written here.
+    [RETURNS] Nothing.
+*/
+{
+    (void) get_root (dpy_handle);
+    *serv_hostaddr = 0;
+    *serv_display_num = 0;
+}   /*  End Function kwin_memory_get_location  */
+
+
+/*  Mandatory functions follow  */
+
+static flag draw_point (MemCanvas memcanvas, double x, double y,
+			unsigned long pixel_value)
+/*  [PURPOSE] This routine will draw a point onto a memory canvas.
+    <memcanvas> The memory canvas.
+    <x> The horizontal offset of the point.
+    <y> The vertical offset of the point.
+    <pixel_value> The pixel value to use.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int ix = x;
+    int iy = y;
+    static char function_name[] = "__kwin_memory_draw_point";
+
+    VERIFY_CANVAS (memcanvas);
+    fill_span (memcanvas, iy, ix, ix, pixel_value);
+    return (TRUE);
+}   /*  End Function draw_point  */
+
+static MemCanvas create_child (MemCanvas parent, KPixCanvas child)
+/*  [PURPOSE] This routine will create a child memory canvas.
+    <parent> The parent memory canvas.
+    <child> The child pixel canvas.
+    [RETURNS] The child memory canvas on success, else NULL.
+*/
+{
+    MemCanvas memchild;
+    static char function_name[] = "__kwin_memory_create_child";
+
+    VERIFY_CANVAS (parent);
+    if ( ( memchild = (MemCanvas) m_alloc (sizeof *memchild) ) == NULL )
+    {
+	m_error_notify (function_name, "memory pixel canvas");
+	return (NULL);
+    }
+    m_copy ( (char *) memchild, (char *) parent, sizeof *memchild );
+    memchild->pixcanvas = child;
+    memchild->scratch = NULL;
+    memchild->scratch_size = 0;
+    return (memchild);
+}   /*  End Function create_child  */
+
+static flag clear_area (MemCanvas memcanvas, int x, int y,
+			int width, int height)
+/*  [PURPOSE] This routine will clear an area in a memory canvas to pixel
+    value 0 (black on a TrueColour canvas).
+    <memcanvas> The memory canvas.
+    <x> The horizontal offset of the area.
+    <y> The vertical offset of the area.
+    <width> The width of the area.
+    <height> The height of the area.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int count;
+    static char function_name[] = "__kwin_memory_clear_area";
+
+    VERIFY_CANVAS (memcanvas);
+    for (count = 0; count < height; ++count)
+    {
+	fill_span (memcanvas, y + count, x, x + width - 1, 0);
+    }
+    return (TRUE);
+}   /*  End Function clear_area  */
+
+
+/*  Optional hook functions follow  */
+
+static flag draw_pc_image (MemCanvas memcanvas, int x_off, int y_off,
+			   int x_pixels, int y_pixels, CONST char *slice,
+			   CONST uaddr *hoffsets, CONST uaddr *voffsets,
+			   unsigned int width, unsigned int height,
+			   unsigned int type, unsigned int conv_type,
+			   unsigned int num_pixels,unsigned long *pixel_values,
+			   unsigned long blank_pixel,
+			   unsigned long min_sat_pixel,
+			   unsigned long max_sat_pixel,
+			   double i_min, double i_max,
+			   flag (*iscale_func) (), void *iscale_info,
+			   KPixCanvasImageCache *cache_ptr)
+/*  [PURPOSE] This routine will draw a 2-dimensional slice of a Karma array
+    onto a memory canvas. This slice may be tiled. The slice is a PseudoColour
+    image.
+    <memcanvas> The memory canvas.
+    <x_off> The horizontal offset, relative to the top-left corner of the
+    canvas.
+    <y_off> The vertical offset, relative to the top-left corner of the canvas.
+    <x_pixels> The number of horizontal pixels to draw.
+    <y_pixels> The number of vertical pixels to draw.
+    <slice> The start of the slice image data.
+    <hoffsets> The array of horizontal byte offsets.
+    <voffsets> The array of vertical byte offsets.
+    <width> The width of the input image (in values).
+    <height> The height of the input image (in values).
+    <type> The type of the slice image data.
+    <conv_type> The input conversion type (when the input is complex).
+    <num_pixels> The number of pixels in the pixel array.
+    <pixel_values> The array of pixel values.
+    <blank_pixel> The pixel value to be used when the intensity value is an
+    undefined value.
+    <min_sat_pixel> The pixel value to be used when the intensity value is
+    below the minimum value.
+    <max_sat_pixel> The pixel value to be used when the intensity value is
+    above the maximum value.
+    <i_min> The minimum intensity value.
+    <i_max> The maximum intensity value.
+    <iscale_func> The function to be called when non-linear intensity scaling
+    is required. If NULL, linear intensity scaling is used.
+    <iscale_info> A pointer to arbitrary information for <<iscale_func>>.
+    <cache_ptr> Memory canvases do not produce cache data. If this is not NULL,
+    NULL is written here.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count;
+    unsigned char *image;
+    unsigned char indices[256];
+    unsigned long pixels[256];
+    static char function_name[] = "__kwin_memory_draw_pc_image";
+
+    VERIFY_CANVAS (memcanvas);
+    if (cache_ptr != NULL) *cache_ptr = NULL;
+    if (num_pixels > 256 - NUM_SPECIAL_PIXELS)
+    {
+	fprintf (stderr, "%s: too many pixels: %u\n", function_name,
+		 num_pixels);
+	return (FALSE);
+    }
+    if ( (x_pixels < 1) || (y_pixels < 1) ) return (TRUE);
+    /*  Draw an image of indices into the pixel array, with the special pixels
+	at the end, and then map through the pixel array  */
+    for (count = 0; count < num_pixels + NUM_SPECIAL_PIXELS; ++count)
+    {
+	indices[count] = count;
+    }
+    for (count = 0; count < num_pixels; ++count)
+    {
+	pixels[count] = pixel_values[count];
+    }
+    pixels[num_pixels] = blank_pixel;
+    pixels[num_pixels + 1] = min_sat_pixel;
+    pixels[num_pixels + 2] = max_sat_pixel;
+    if ( ( image = get_scratch (memcanvas, (uaddr) x_pixels * y_pixels) )
+	 == NULL ) return (FALSE);
+    /*  Note the casts from (uaddr *) to (iaddr *) for the offset
+	arrays. This is dodgy, but it should work.  */
+    if ( !imw_to8_lossy (image, 1, x_pixels, x_pixels, y_pixels, slice,
+			 (iaddr *) hoffsets, (iaddr *) voffsets,
+			 (int) width, (int) height, type, conv_type,
+			 num_pixels, indices,
+			 indices[num_pixels], indices[num_pixels + 1],
+			 indices[num_pixels + 2],
+			 i_min, i_max, iscale_func, iscale_info) )
+    {
+	fprintf (stderr, "Error drawing image into memory canvas\n");
+	return (FALSE);
+    }
+    copy_indexed_image (memcanvas, x_off, y_off, x_pixels, y_pixels, image,
+			pixels);
+    return (TRUE);
+}   /*  End Function draw_pc_image  */
+
+static flag draw_rgb_image (MemCanvas memcanvas,
+			    int x_off, int y_off, int x_pixels, int y_pixels,
+			    CONST unsigned char *red_slice,
+			    CONST unsigned char *green_slice,
+			    CONST unsigned char *blue_slice,
+			    CONST uaddr *hoffsets, CONST uaddr *voffsets,
+			    unsigned int width, unsigned int height,
+			    KPixCanvasImageCache *cache_ptr)
+/*  [PURPOSE] This routine will draw a 2-dimensional slice of a Karma array
+    onto a memory canvas. This slice may be tiled. The slice is a TrueColour
+    image.
+    <memcanvas> The memory canvas.
+    <x_off> The horizontal offset, relative to the top-left corner of the
+    canvas.
+    <y_off> The vertical offset, relative to the top-left corner of the canvas.
+    <x_pixels> The number of horizontal pixels to draw.
+    <y_pixels> The number of vertical pixels to draw.
+    <red_slice> The start of the red slice data.
+    <green_slice> The start of the green slice data.
+    <blue_slice> The start of the blue slice data.
+    <hoffsets> The array of horizontal byte offsets.
+    <voffsets> The array of vertical byte offsets.
+    <width> The width of the input image (in values).
+    <height> The height of the input image (in values).
+    <cache_ptr> Memory canvases do not produce cache data. If this is not NULL,
+    NULL is written here.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int x, y, out_x, out_y;
+    unsigned int count;
+    unsigned char *image, *inp, *out;
+    unsigned char pixels[256];
+    static char function_name[] = "__kwin_memory_draw_rgb_image";
+
+    VERIFY_CANVAS (memcanvas);
+    if (cache_ptr != NULL) *cache_ptr = NULL;
+    if (memcanvas->bytes_per_pixel != 4)
+    {
+	fprintf (stderr, "%s: RGB images need a TrueColour canvas\n",
+		 function_name);
+	return (FALSE);
+    }
+    if ( (x_pixels < 1) || (y_pixels < 1) ) return (TRUE);
+    if ( ( image = get_scratch (memcanvas, (uaddr) x_pixels * y_pixels * 4) )
+	 == NULL ) return (FALSE);
+    for (count = 0; count < 256; ++count) pixels[count] = count;
+    /*  Note the casts from (uaddr *) to (iaddr *) for the offset
+	arrays. This is dodgy, but it should work.  */
+    if ( !imw_to8_lossy (image, 4, x_pixels * 4, x_pixels, y_pixels,
+			 (CONST char *) red_slice,
+			 (iaddr *) hoffsets, (iaddr *) voffsets,
+			 (int) width, (int) height,
+			 K_UBYTE, KIMAGE_COMPLEX_CONV_REAL,
+			 256, pixels, 0, 0, 255, 0.0, 255.0,
+			 ( flag (*) () ) NULL, NULL) ||
+	 !imw_to8_lossy (image + 1, 4, x_pixels * 4, x_pixels, y_pixels,
+			 (CONST char *) green_slice,
+			 (iaddr *) hoffsets, (iaddr *) voffsets,
+			 (int) width, (int) height,
+			 K_UBYTE, KIMAGE_COMPLEX_CONV_REAL,
+			 256, pixels, 0, 0, 255, 0.0, 255.0,
+			 ( flag (*) () ) NULL, NULL) ||
+	 !imw_to8_lossy (image + 2, 4, x_pixels * 4, x_pixels, y_pixels,
+			 (CONST char *) blue_slice,
+			 (iaddr *) hoffsets, (iaddr *) voffsets,
+			 (int) width, (int) height,
+			 K_UBYTE, KIMAGE_COMPLEX_CONV_REAL,
+			 256, pixels, 0, 0, 255, 0.0, 255.0,
+			 ( flag (*) () ) NULL, NULL) )
+    {
+	fprintf (stderr, "Error drawing RGB image into memory canvas\n");
+	return (FALSE);
+    }
+    /*  Copy the visible part into the buffer  */
+    for (y = 0; y < y_pixels; ++y)
+    {
+	out_y = y_off + y;
+	if ( (out_y < 0) || (out_y >= memcanvas->height) ) continue;
+	inp = image + (uaddr) y * x_pixels * 4;
+	out = memcanvas->buffer + (uaddr) out_y * memcanvas->stride;
+	for (x = 0; x < x_pixels; ++x, inp += 4)
+	{
+	    out_x = x_off + x;
+	    if ( (out_x < 0) || (out_x >= memcanvas->width) ) continue;
+	    out[out_x * 4] = inp[0];
+	    out[out_x * 4 + 1] = inp[1];
+	    out[out_x * 4 + 2] = inp[2];
+	    out[out_x * 4 + 3] = 255;
+	}
+    }
+    return (TRUE);
+}   /*  End Function draw_rgb_image  */
+
+static flag draw_line (MemCanvas memcanvas,
+		       double x0, double y0, double x1, double y1,
+		       unsigned long pixel_value)
+/*  [PURPOSE] This routine will draw a line onto a memory canvas.
+    <memcanvas> The memory canvas.
+    <x0> The horizontal offset of the first point.
+    <y0> The vertical offset of the first point.
+    <x1> The horizontal offset of the second point.
+    <y1> The vertical offset of the second point.
+    <pixel_value> The pixel value to use.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int ix0 = x0;
+    int iy0 = y0;
+    int ix1 = x1;
+    int iy1 = y1;
+    int delta_x, delta_y, step_x, step_y, error, error2;
+    double length, half_width, dx, dy;
+    double x_arr[4], y_arr[4];
+    static char function_name[] = "__kwin_memory_draw_line";
+
+    VERIFY_CANVAS (memcanvas);
+    if (memcanvas->line_width > 1)
+    {
+	/*  Thick lines are drawn as filled rectangles  */
+	length = sqrt ( (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0) );
+	if (length > 0.0)
+	{
+	    half_width = 0.5 * (double) memcanvas->line_width;
+	    dx = (y0 - y1) / length * half_width;
+	    dy = (x1 - x0) / length * half_width;
+	    x_arr[0] = x0 + dx;  y_arr[0] = y0 + dy;
+	    x_arr[1] = x1 + dx;  y_arr[1] = y1 + dy;
+	    x_arr[2] = x1 - dx;  y_arr[2] = y1 - dy;
+	    x_arr[3] = x0 - dx;  y_arr[3] = y0 - dy;
+	    return ( draw_polygon (memcanvas, x_arr, y_arr, 4, pixel_value,
+				   TRUE, TRUE) );
+	}
+    }
+    /*  Bresenham's algorithm  */
+    delta_x = (ix1 > ix0) ? ix1 - ix0 : ix0 - ix1;
+    delta_y = (iy1 > iy0) ? iy0 - iy1 : iy1 - iy0;
+    step_x = (ix0 < ix1) ? 1 : -1;
+    step_y = (iy0 < iy1) ? 1 : -1;
+    error = delta_x + delta_y;
+    while (TRUE)
+    {
+	fill_span (memcanvas, iy0, ix0, ix0, pixel_value);
+	if ( (ix0 == ix1) && (iy0 == iy1) ) break;
+	error2 = 2 * error;
+	if (error2 >= delta_y)
+	{
+	    error += delta_y;
+	    ix0 += step_x;
+	}
+	if (error2 <= delta_x)
+	{
+	    error += delta_x;
+	    iy0 += step_y;
+	}
+    }
+    return (TRUE);
+}   /*  End Function draw_line  */
+
+static flag draw_arc (MemCanvas memcanvas,
+		      double x, double y, double width, double height,
+		      int angle1, int angle2, unsigned long pixel_value,
+		      flag fill)
+/*  [PURPOSE] This routine will draw an arc onto a memory canvas.
+    <memcanvas> The memory canvas.
+    <x> The horizontal co-ordinate of the bounding box of the arc.
+    <y> The vertical co-ordinate of the bounding box of the arc.
+    <width> The width of the arc.
+    <height> The height of the arc.
+    <angle1> The start angle of the arc in 64ths of a degree,
+    anticlockwise from the 3 o'clock position.
+    <angle2> The extent of the arc in 64ths of a degree.
+    <pixel_value> The pixel value to use.
+    <fill> If TRUE, the arc is filled (as a pie slice), else only the outside
+    is drawn.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    flag ok;
+    int iy, y_start, y_end;
+    unsigned int count, num_segments;
+    double cx, cy, rx, ry, dy, dx, start, extent, angle;
+    double *x_arr, *y_arr;
+    static char function_name[] = "__kwin_memory_draw_arc";
+
+    VERIFY_CANVAS (memcanvas);
+    FLAG_VERIFY (fill);
+    rx = 0.5 * width;
+    ry = 0.5 * height;
+    cx = x + rx;
+    cy = y + ry;
+    if ( (rx <= 0.0) || (ry <= 0.0) )
+    {
+	return ( draw_line (memcanvas, x, y, x + width, y + height,
+			    pixel_value) );
+    }
+    if ( fill && ( (angle2 >= 64 * 360) || (angle2 <= -64 * 360) ) )
+    {
+	/*  Full ellipse: fill with spans, sampling at pixel centres  */
+	y_start = ceil (cy - ry - 0.5);
+	y_end = floor (cy + ry - 0.5);
+	for (iy = y_start; iy <= y_end; ++iy)
+	{
+	    dy = ( (double) iy + 0.5 - cy ) / ry;
+	    if (dy * dy > 1.0) continue;
+	    dx = rx * sqrt (1.0 - dy * dy);
+	    fill_span (memcanvas, iy, (int) ceil (cx - dx - 0.5),
+		       (int) floor (cx + dx - 0.5), pixel_value);
+	}
+	return (TRUE);
+    }
+    start = (double) angle1 / 64.0 * PION180;
+    extent = (double) angle2 / 64.0 * PION180;
+    if (extent > 2.0 * PI) extent = 2.0 * PI;
+    if (extent < -2.0 * PI) extent = -2.0 * PI;
+    num_segments = fabs (extent) * (rx + ry) / 4.0;
+    if (num_segments < MIN_ARC_SEGMENTS) num_segments = MIN_ARC_SEGMENTS;
+    if (num_segments > MAX_ARC_SEGMENTS) num_segments = MAX_ARC_SEGMENTS;
+    if ( ( x_arr = (double *) m_alloc ( (num_segments + 2) * 2 *
+					sizeof *x_arr ) ) == NULL )
+    {
+	m_error_notify (function_name, "vertex array");
+	return (FALSE);
+    }
+    y_arr = x_arr + num_segments + 2;
+    for (count = 0; count <= num_segments; ++count)
+    {
+	angle = start + extent * (double) count / (double) num_segments;
+	x_arr[count] = cx + rx * cos (angle);
+	y_arr[count] = cy - ry * sin (angle);
+    }
+    if (fill)
+    {
+	x_arr[num_segments + 1] = cx;
+	y_arr[num_segments + 1] = cy;
+	ok = draw_polygon (memcanvas, x_arr, y_arr, num_segments + 2,
+			   pixel_value, FALSE, TRUE);
+    }
+    else
+    {
+	for (count = 0, ok = TRUE; ok && (count < num_segments); ++count)
+	{
+	    ok = draw_line (memcanvas, x_arr[count], y_arr[count],
+			    x_arr[count + 1], y_arr[count + 1], pixel_value);
+	}
+    }
+    m_free ( (char *) x_arr );
+    return (ok);
+}   /*  End Function draw_arc  */
+
+static flag draw_polygon (MemCanvas memcanvas, double *x_arr, double *y_arr,
+			  unsigned int num_vertices, unsigned long pixel_value,
+			  flag convex, flag fill)
+/*  [PURPOSE] This routine will draw a polygon onto a memory canvas. Filled
+    polygons use the even-odd rule, sampling at pixel centres.
+    <memcanvas> The memory canvas.
+    <x_arr> The array of x co-ordinates of vertices of the polygon.
+    <y_arr> The array of y co-ordinates of vertices of the polygon.
+    <num_vertices> The number of vertices in the polygon.
+    <pixel_value> The pixel value to use.
+    <convex> If TRUE, then the points must form a convex polygon.
+    <fill> If TRUE, the polygon will be filled.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int iy, y_start, y_end;
+    unsigned int count, next, num_crossings, pos;
+    double y_min, y_max, sample_y, tmp;
+    double *crossings;
+    static char function_name[] = "__kwin_memory_draw_polygon";
+
+    VERIFY_CANVAS (memcanvas);
+    FLAG_VERIFY (convex);
+    FLAG_VERIFY (fill);
+    if (num_vertices < 2) return (TRUE);
+    if (!fill)
+    {
+	for (count = 0; count < num_vertices; ++count)
+	{
+	    next = (count + 1) % num_vertices;
+	    (void) draw_line (memcanvas, x_arr[count], y_arr[count],
+			      x_arr[next], y_arr[next], pixel_value);
+	}
+	return (TRUE);
+    }
+    if ( ( crossings = (double *) m_alloc (num_vertices * sizeof *crossings) )
+	 == NULL )
+    {
+	m_error_notify (function_name, "crossing array");
+	return (FALSE);
+    }
+    y_min = y_arr[0];
+    y_max = y_arr[0];
+    for (count = 1; count < num_vertices; ++count)
+    {
+	if (y_arr[count] < y_min) y_min = y_arr[count];
+	if (y_arr[count] > y_max) y_max = y_arr[count];
+    }
+    y_start = ceil (y_min - 0.5);
+    if (y_start < 0) y_start = 0;
+    y_end = floor (y_max - 0.5);
+    if (y_end >= memcanvas->height) y_end = memcanvas->height - 1;
+    for (iy = y_start; iy <= y_end; ++iy)
+    {
+	sample_y = (double) iy + 0.5;
+	/*  Find and sort the crossings of the edges with this line  */
+	for (count = 0, num_crossings = 0; count < num_vertices; ++count)
+	{
+	    next = (count + 1) % num_vertices;
+	    if ( (y_arr[count] <= sample_y) == (y_arr[next] <= sample_y) )
+	    {
+		continue;
+	    }
+	    tmp = x_arr[count] + (sample_y - y_arr[count]) *
+		(x_arr[next] - x_arr[count]) / (y_arr[next] - y_arr[count]);
+	    for (pos = num_crossings;
+		 (pos > 0) && (crossings[pos - 1] > tmp); --pos)
+	    {
+		crossings[pos] = crossings[pos - 1];
+	    }
+	    crossings[pos] = tmp;
+	    ++num_crossings;
+	}
+	for (count = 0; count + 1 < num_crossings; count += 2)
+	{
+	    fill_span (memcanvas, iy, (int) ceil (crossings[count] - 0.5),
+		       (int) ceil (crossings[count + 1] - 0.5) - 1,
+		       pixel_value);
+	}
+    }
+    m_free ( (char *) crossings );
+    return (TRUE);
+}   /*  End Function draw_polygon  */
+
+static flag draw_string (MemCanvas memcanvas, double x, double y,
+			 CONST char *string, unsigned long pixel_value,
+			 flag clear_under)
+/*  [PURPOSE] This routine will draw a NULL terminated string onto a memory
+    canvas, using the Hershey stroke font.
+    <memcanvas> The memory canvas.
+    <x> The horizontal offset of the string origin.
+    <y> The vertical offset of the string origin.
+    <string> The string.
+    <pixel_value> The pixel value to use.
+    <clear_under> This is ignored.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    double width, height;
+    static char function_name[] = "__kwin_memory_draw_string";
+
+    VERIFY_CANVAS (memcanvas);
+    FLAG_VERIFY (clear_under);
+    /*  The root canvas has no offset, so the co-ordinates may be used
+	directly  */
+    return ( kwin_hersey_draw_string (memcanvas->root->pixcanvas, string,
+				      x, y, 0.0, pixel_value,
+				      &width, &height) );
+}   /*  End Function draw_string  */
+
+static flag draw_rectangle (MemCanvas memcanvas,
+			    double x, double y, double width, double height,
+			    unsigned long pixel_value, flag fill)
+/*  [PURPOSE] This routine will draw a single rectangle onto a memory canvas.
+    <memcanvas> The memory canvas.
+    <x> The horizontal offset of the rectangle.
+    <y> The vertical offset of the rectangle.
+    <width> The width of the rectangle. The point <<x + width>> is a vertex.
+    <height> The height of the rectangle. The point <<y + height>> is a vertex.
+    <pixel_value> The pixel value to use.
+    <fill> If TRUE, the rectangle is filled.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    int ix = x;
+    int iy = y;
+    int iw = width;
+    int ih = height;
+    int count;
+    static char function_name[] = "__kwin_memory_draw_rectangle";
+
+    VERIFY_CANVAS (memcanvas);
+    FLAG_VERIFY (fill);
+    if (fill)
+    {
+	for (count = 0; count <= ih; ++count)
+	{
+	    fill_span (memcanvas, iy + count, ix, ix + iw, pixel_value);
+	}
+	return (TRUE);
+    }
+    fill_span (memcanvas, iy, ix, ix + iw, pixel_value);
+    fill_span (memcanvas, iy + ih, ix, ix + iw, pixel_value);
+    for (count = 1; count < ih; ++count)
+    {
+	fill_span (memcanvas, iy + count, ix, ix, pixel_value);
+	fill_span (memcanvas, iy + count, ix + iw, ix + iw, pixel_value);
+    }
+    return (TRUE);
+}   /*  End Function draw_rectangle  */
+
+static flag get_colour (MemCanvas memcanvas, CONST char *colourname,
+			unsigned long *pixel_value, unsigned short *red,
+			unsigned short *green, unsigned short *blue)
+/*  [PURPOSE] This routine will allocate a colour for a memory canvas.
+    <memcanvas> The memory canvas.
+    <colourname> The name of the colour. This may be one of a small number of
+    common colour names or "#rrggbb" or "#rgb".
+    <pixel_value> The pixel value will be written here.
+    <red> The red intensity for the pixel will be written here. If this is
+    NULL, nothing is written here.
+    <green> The green intensity for the pixel will be written here. If this is
+    NULL, nothing is written here.
+    <blue> The blue intensity for the pixel will be written here. If this is
+    NULL, nothing is written here.
+    [RETURNS] TRUE if the colour was allocated, else FALSE.
+*/
+{
+    unsigned int count;
+    unsigned short r, g, b;
+    unsigned char red8, green8, blue8;
+    unsigned long pixel;
+    MemCanvas root;
+    static char function_name[] = "__kwin_memory_get_colour";
+
+    VERIFY_CANVAS (memcanvas);
+    if ( !parse_colour (colourname, &red8, &green8, &blue8) )
+    {
+	fprintf (stderr, "Error allocating colour: \"%s\"\n", colourname);
+	return (FALSE);
+    }
+    r = red8 * 257;
+    g = green8 * 257;
+    b = blue8 * 257;
+    root = memcanvas->root;
+    if (root->bytes_per_pixel == 4)
+    {
+	*pixel_value = PACK_RGB (red8, green8, blue8);
+    }
+    else
+    {
+	/*  Share an existing cell with the same colour, else allocate one  */
+	for (count = 0; count < 256; ++count)
+	{
+	    if (root->allocated[count] && (root->reds[count] == r) &&
+		(root->greens[count] == g) && (root->blues[count] == b) )
+	    {
+		break;
+	    }
+	}
+	if (count >= 256)
+	{
+	    if (kwin_memory_alloc_colours (1, &pixel, 1, (Kdisplay) root) < 1)
+	    {
+		fprintf (stderr, "No free colourcells for: \"%s\"\n",
+			 colourname);
+		return (FALSE);
+	    }
+	    root->reds[pixel] = r;
+	    root->greens[pixel] = g;
+	    root->blues[pixel] = b;
+	    count = pixel;
+	}
+	*pixel_value = count;
+    }
+    if (red != NULL) *red = r;
+    if (green != NULL) *green = g;
+    if (blue != NULL) *blue = b;
+    return (TRUE);
+}   /*  End Function get_colour  */
+
+static flag query_colourmap (MemCanvas memcanvas, unsigned long *pixels,
+			     unsigned short *reds, unsigned short *greens,
+			     unsigned short *blues, unsigned int num_colours)
+/*  [PURPOSE] This routine will determine the RGB components of an array of
+    colourmap entries.
+    <memcanvas> The memory canvas.
+    <pixels> The array of pixel values.
+    <reds> The red components will be written to this array.
+    <greens> The green components will be written to this array.
+    <blues> The blue components will be written to this array.
+    <num_colours> The number of colours in the arrays.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count;
+    unsigned long pixel;
+    MemCanvas root;
+    static char function_name[] = "__kwin_memory_query_colourmap";
+
+    VERIFY_CANVAS (memcanvas);
+    root = memcanvas->root;
+    for (count = 0; count < num_colours; ++count)
+    {
+	pixel = pixels[count];
+	if (root->bytes_per_pixel == 4)
+	{
+	    reds[count] = (pixel & 0xff) * 257;
+	    greens[count] = ( (pixel >> 8) & 0xff ) * 257;
+	    blues[count] = ( (pixel >> 16) & 0xff ) * 257;
+	}
+	else
+	{
+	    pixel &= 0xff;
+	    reds[count] = root->reds[pixel];
+	    greens[count] = root->greens[pixel];
+	    blues[count] = root->blues[pixel];
+	}
+    }
+    return (TRUE);
+}   /*  End Function query_colourmap  */
+
+static flag set_linewidth (MemCanvas memcanvas, double linewidth)
+/*  [SUMMARY] Set the linewidth for a canvas.
+    <memcanvas> The memory canvas.
+    <linewidth> The linewidth, in pixels.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    static char function_name[] = "__kwin_memory_set_linewidth";
+
+    VERIFY_CANVAS (memcanvas);
+    memcanvas->line_width = (linewidth < 1.0) ? 1 : (int) (linewidth + 0.5);
+    return (TRUE);
+}   /*  End Function set_linewidth  */
+
+
+/*  Private functions follow  */
+
+static void fill_span (MemCanvas memcanvas, int y, int x0, int x1,
+		       unsigned long pixel_value)
+/*  [SUMMARY] Fill a horizontal span of pixels, clipped to the buffer.
+    <memcanvas> The memory canvas.
+    <y> The vertical offset of the span.
+    <x0> The first horizontal offset.
+    <x1> The last horizontal offset.
+    <pixel_value> The pixel value to use.
+    [RETURNS] Nothing.
+*/
+{
+    int x;
+    unsigned char *ptr;
+    unsigned char pixel, red, green, blue;
+
+    if ( (y < 0) || (y >= memcanvas->height) ) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 >= memcanvas->width) x1 = memcanvas->width - 1;
+    if (x1 < x0) return;
+    ptr = memcanvas->buffer + (uaddr) y * memcanvas->stride;
+    if (memcanvas->bytes_per_pixel == 1)
+    {
+	/*  Copy first: the first byte of a long is the top byte on some hosts  */
+	pixel = pixel_value;
+	m_fill ( (char *) ptr + x0, 1, (char *) &pixel, 1, x1 - x0 + 1 );
+	return;
+    }
+    red = pixel_value & 0xff;
+    green = (pixel_value >> 8) & 0xff;
+    blue = (pixel_value >> 16) & 0xff;
+    for (x = x0, ptr += x0 * 4; x <= x1; ++x, ptr += 4)
+    {
+	ptr[0] = red;
+	ptr[1] = green;
+	ptr[2] = blue;
+	ptr[3] = 255;
+    }
+}   /*  End Function fill_span  */
+
+static unsigned char *get_scratch (MemCanvas memcanvas, uaddr size)
+/*  [SUMMARY] Get a scratch buffer for rendering images.
+    <memcanvas> The memory canvas. The buffer is kept by the root canvas.
+    <size> The minimum size of the buffer in bytes.
+    [RETURNS] The buffer on success, else NULL.
+*/
+{
+    MemCanvas root = memcanvas->root;
+    static char function_name[] = "__kwin_memory_get_scratch";
+
+    if (size <= root->scratch_size) return (root->scratch);
+    if (root->scratch != NULL) m_free ( (char *) root->scratch );
+    root->scratch_size = 0;
+    if ( ( root->scratch = (unsigned char *) m_alloc (size) ) == NULL )
+    {
+	m_error_notify (function_name, "scratch image");
+	return (NULL);
+    }
+    root->scratch_size = size;
+    return (root->scratch);
+}   /*  End Function get_scratch  */
+
+static void copy_indexed_image (MemCanvas memcanvas, int x_off, int y_off,
+				int x_pixels, int y_pixels,
+				CONST unsigned char *image,
+				CONST unsigned long *pixels)
+/*  [SUMMARY] Copy an image of indices into the buffer, clipping as needed.
+    <memcanvas> The memory canvas.
+    <x_off> The horizontal offset of the image.
+    <y_off> The vertical offset of the image.
+    <x_pixels> The width of the image.
+    <y_pixels> The height of the image.
+    <image> The image of indices, packed.
+    <pixels> The pixel values for each index.
+    [RETURNS] Nothing.
+*/
+{
+    int x, y, x_start, x_end, out_y;
+    unsigned long pixel;
+    unsigned char *out;
+    CONST unsigned char *inp;
+
+    x_start = (x_off < 0) ? -x_off : 0;
+    x_end = (x_off + x_pixels > memcanvas->width) ?
+	memcanvas->width - x_off : x_pixels;
+    for (y = 0; y < y_pixels; ++y)
+    {
+	out_y = y_off + y;
+	if ( (out_y < 0) || (out_y >= memcanvas->height) ) continue;
+	inp = image + (uaddr) y * x_pixels;
+	out = memcanvas->buffer + (uaddr) out_y * memcanvas->stride;
+	if (memcanvas->bytes_per_pixel == 1)
+	{
+	    for (x = x_start; x < x_end; ++x)
+	    {
+		out[x_off + x] = pixels[inp[x]];
+	    }
+	    continue;
+	}
+	for (x = x_start; x < x_end; ++x)
+	{
+	    pixel = pixels[inp[x]];
+	    out[(x_off + x) * 4] = pixel & 0xff;
+	    out[(x_off + x) * 4 + 1] = (pixel >> 8) & 0xff;
+	    out[(x_off + x) * 4 + 2] = (pixel >> 16) & 0xff;
+	    out[(x_off + x) * 4 + 3] = 255;
+	}
+    }
+}   /*  End Function copy_indexed_image  */
+
+static flag parse_colour (CONST char *colourname, unsigned char *red,
+			  unsigned char *green, unsigned char *blue)
+/*  [SUMMARY] Convert a colour name to RGB values.
+    <colourname> The colour name.
+    <red> The red value is written here.
+    <green> The green value is written here.
+    <blue> The blue value is written here.
+    [RETURNS] TRUE if the colour name was recognised, else FALSE.
+*/
+{
+    unsigned int count, length, digits;
+    unsigned long value;
+    char *end;
+    char name[STRING_LENGTH];
+    extern struct named_colour_type named_colours[];
+
+    if (colourname[0] == '#')
+    {
+	length = strlen (colourname + 1);
+	value = strtoul (colourname + 1, &end, 16);
+	if ( (*end != '\0') || ( (length != 3) && (length != 6) ) )
+	{
+	    return (FALSE);
+	}
+	digits = length / 3;
+	*red = (value >> (8 * digits) ) & ( (1 << 4 * digits) - 1 );
+	*green = (value >> (4 * digits) ) & ( (1 << 4 * digits) - 1 );
+	*blue = value & ( (1 << 4 * digits) - 1 );
+	if (digits == 1)
+	{
+	    *red *= 17;
+	    *green *= 17;
+	    *blue *= 17;
+	}
+	return (TRUE);
+    }
+    /*  Names are compared without case or spaces, as with X  */
+    for (count = 0, length = 0;
+	 (colourname[count] != '\0') && (length < STRING_LENGTH - 1); ++count)
+    {
+	if ( isspace (colourname[count]) ) continue;
+	name[length++] = tolower (colourname[count]);
+    }
+    name[length] = '\0';
+    for (count = 0; named_colours[count].name != NULL; ++count)
+    {
+	if (strcmp (name, named_colours[count].name) != 0) continue;
+	*red = named_colours[count].red;
+	*green = named_colours[count].green;
+	*blue = named_colours[count].blue;
+	return (TRUE);
+    }
+    return (FALSE);
+}   /*  End Function parse_colour  */
+
+static MemCanvas get_root (Kdisplay dpy_handle)
+/*  [SUMMARY] Convert a display handle to a memory canvas.
+    <dpy_handle> The display handle.
+    [RETURNS] The root memory canvas.
+*/
+{
+    MemCanvas memcanvas = (MemCanvas) dpy_handle;
+    static char function_name[] = "__kwin_memory_get_root";
+
+    VERIFY_CANVAS (memcanvas);
+    return (memcanvas->root);
+}   /*  End Function get_root  */
@@ -105,6 +105,7 @@
 
 #define MAGIC_NUMBER (unsigned int) 528762177
 #define PROTOCOL_VERSION (unsigned int) 3
+#define COORD_BUF_SIZE 1024
 
 #define OBJECT_COORD_INDEX (unsigned int) 0
 #define OBJECT_COLOURNAME_INDEX (unsigned int) 1
@@ -194,6 +195,7 @@ struct refresh_canvas_type
 {
     KWorldCanvas canvas;
     flag active;
+    flag upper_layer;
     struct refresh_canvas_type *next;
 };
 
@@ -351,6 +353,8 @@ STATIC_FUNCTION (list_entry *find_object,
 STATIC_FUNCTION (flag move_object,
 		 (KOverlayList olist, unsigned int object_id,
 		  unsigned int list_id, double dx, double dy) );
+STATIC_FUNCTION (flag refresh_associated_canvas,
+		 (struct refresh_canvas_type *cnv, flag clear) );
 
 
 /*  Public functions follow  */
@@ -547,8 +551,7 @@ flag overlay_associate_display_canvas (KOverlayList olist, KWorldCanvas canvas)
 	    cnv->active = TRUE;
 	    if (olist->list_head->length < 1) return (TRUE);
 	    /*  Display  */
-	    if ( !kwin_refresh_if_visible (canvas_get_pixcanvas (canvas),
-					   TRUE) )
+	    if ( !refresh_associated_canvas (cnv, TRUE) )
 	    {
 		fprintf (stderr, "Error refreshing canvas\n");
 		return (FALSE);
@@ -566,6 +569,11 @@ flag overlay_associate_display_canvas (KOverlayList olist, KWorldCanvas canvas)
     cnv->next = olist->refresh_canvases;
     olist->refresh_canvases = cnv;
     cnv->active = TRUE;
+    /*  Overlays registered after the lower layers are retained are drawn in
+	the upper layer, and may be refreshed without redrawing the image  */
+    canvas_get_attributes (canvas,
+			   CANVAS_ATT_LAYERS_RETAINED, &cnv->upper_layer,
+			   CANVAS_ATT_END);
     canvas_register_refresh_func (canvas,
 				  ( void (*) () ) worldcanvas_refresh_func,
 				  (void *) olist);
@@ -601,7 +609,7 @@ flag overlay_unassociate_display_canvas (KOverlayList olist,
 		cnv->active = FALSE;
 		if (olist->list_head->length < 1) return (TRUE);
 		/*  Refresh canvas  */
-		kwin_refresh_if_visible (canvas_get_pixcanvas (canvas), TRUE);
+		refresh_associated_canvas (cnv, TRUE);
 		return (TRUE);
 	    }
 	    return (FALSE);
@@ -1940,8 +1948,7 @@ static flag process_instruction (KOverlayList olist, list_entry *instruction,
 	{
 	    if (!cnv->active) continue;
 	    /*  Refresh canvas  */
-	    if ( !kwin_refresh_if_visible (canvas_get_pixcanvas (cnv->canvas),
-					   FALSE) ) return (FALSE);
+	    if ( !refresh_associated_canvas (cnv, FALSE) ) return (FALSE);
 	}
 	return (TRUE);
         /*break;*/
@@ -1993,8 +2000,7 @@ static flag process_instruction (KOverlayList olist, list_entry *instruction,
 	{
 	    if (!cnv->active) continue;
 	    /*  Refresh canvas  */
-	    if ( !kwin_refresh_if_visible (canvas_get_pixcanvas (cnv->canvas),
-					   FALSE) ) return (FALSE);
+	    if ( !refresh_associated_canvas (cnv, FALSE) ) return (FALSE);
 	}
 	return (TRUE);
 	/*break;*/
@@ -2049,8 +2055,7 @@ static flag process_instruction (KOverlayList olist, list_entry *instruction,
 	{
 	    if (!cnv->active) continue;
 	    /*  Refresh canvas  */
-	    if ( !kwin_refresh_if_visible (canvas_get_pixcanvas (cnv->canvas),
-					   FALSE) ) return (FALSE);
+	    if ( !refresh_associated_canvas (cnv, FALSE) ) return (FALSE);
 	}
 	return (TRUE);
 	/*break;*/
@@ -2492,10 +2497,12 @@ static void convert_to_pixcoords (KWorldCanvas canvas, unsigned int num_coords,
     [RETURNS] Nothing.
 */
 {
-    unsigned int count;
+    unsigned int count, block_count, num_block, num_world, type;
     double x, y, left_x, right_x, bottom_y, top_y;
     double value[2];
     double offset = 0.01;
+    char *t_ptr, *x_ptr, *y_ptr;
+    double wx[COORD_BUF_SIZE], wy[COORD_BUF_SIZE];
     static int last_x = 0;
     static int last_y = 0;
     static char function_name[] = "__overlay_convert_to_pixcoords";
@@ -2506,44 +2513,72 @@ static void convert_to_pixcoords (KWorldCanvas canvas, unsigned int num_coords,
 			   CANVAS_ATT_BOTTOM_Y, &bottom_y,
 			   CANVAS_ATT_TOP_Y, &top_y,
 			   CANVAS_ATT_END);
-    for (count = 0; count < num_coords;
-	 ++count, types += pack_size, x_arr += pack_size, y_arr += pack_size,
-	 ++px, ++py)
-    {
-	/*  Need to use the generic routine because doubles will not be
-	    aligned. Stupid Sparc processor doesn't like it.
-	*/
-	ds_get_element (x_arr, K_DOUBLE, value, (flag *) NULL);
-	x = value[0];
-	ds_get_element (y_arr, K_DOUBLE, value, (flag *) NULL);
-	y = value[0];
-	switch (*(unsigned int *) types)
+    for (count = 0; count < num_coords; count += num_block)
+    {
+	num_block = num_coords - count;
+	if (num_block > COORD_BUF_SIZE) num_block = COORD_BUF_SIZE;
+	/*  Gather the world co-ordinates in this block so that they can be
+	    converted with a single call  */
+	for (block_count = 0, num_world = 0,
+		 t_ptr = types, x_ptr = x_arr, y_ptr = y_arr;
+	     block_count < num_block;
+	     ++block_count, t_ptr += pack_size, x_ptr += pack_size,
+		 y_ptr += pack_size)
+	{
+	    type = *(unsigned int *) t_ptr;
+	    if ( (type != OVERLAY_COORD_WORLD) &&
+		 (type != OVERLAY_COORD_RELATIVE) ) continue;
+	    /*  Need to use the generic routine because doubles will not be
+		aligned. Stupid Sparc processor doesn't like it.
+	    */
+	    ds_get_element (x_ptr, K_DOUBLE, value, (flag *) NULL);
+	    x = value[0];
+	    ds_get_element (y_ptr, K_DOUBLE, value, (flag *) NULL);
+	    y = value[0];
+	    if (type == OVERLAY_COORD_RELATIVE)
+	    {
+		x = left_x + x * (right_x - left_x);
+		y = bottom_y + y * (top_y - bottom_y);
+	    }
+	    wx[num_world] = x;
+	    wy[num_world++] = y;
+	}
+	if (num_world > 0)
 	{
-	  case OVERLAY_COORD_PIXEL:
-	    *px = (x + offset);
-	    *py = (y + offset);
-	    break;
-	  case OVERLAY_COORD_RELATIVE:
-	    x = left_x + x * (right_x - left_x);
-	    y = bottom_y + y * (top_y - bottom_y);
-	  case OVERLAY_COORD_WORLD:
-	    canvas_convert_from_canvas_coords (canvas, FALSE, FALSE, 1,
-					       &x, &y, &x, &y);
-	    *px = x;
-	    *py = y;
-	    break;
-	  case OVERLAY_COORD_LAST:
-	    *px = last_x;
-	    *py = last_y;
-	    break;
-	  default:
-	    fprintf (stderr, "Illegal co-ordinate type: %u\n",
-			    *(unsigned int *) types);
-	    a_prog_bug (function_name);
-	    break;
+	    canvas_convert_from_canvas_coords (canvas, FALSE, FALSE, num_world,
+					       wx, wy, wx, wy);
+	}
+	/*  Now write out the pixel co-ordinates in order  */
+	for (block_count = 0, num_world = 0; block_count < num_block;
+	     ++block_count, types += pack_size, x_arr += pack_size,
+		 y_arr += pack_size, ++px, ++py)
+	{
+	    switch (*(unsigned int *) types)
+	    {
+	      case OVERLAY_COORD_PIXEL:
+		ds_get_element (x_arr, K_DOUBLE, value, (flag *) NULL);
+		*px = (value[0] + offset);
+		ds_get_element (y_arr, K_DOUBLE, value, (flag *) NULL);
+		*py = (value[0] + offset);
+		break;
+	      case OVERLAY_COORD_RELATIVE:
+	      case OVERLAY_COORD_WORLD:
+		*px = wx[num_world];
+		*py = wy[num_world++];
+		break;
+	      case OVERLAY_COORD_LAST:
+		*px = last_x;
+		*py = last_y;
+		break;
+	      default:
+		fprintf (stderr, "Illegal co-ordinate type: %u\n",
+			 *(unsigned int *) types);
+		a_prog_bug (function_name);
+		break;
+	    }
+	    last_x = *px;
+	    last_y = *py;
 	}
-	last_x = *px;
-	last_y = *py;
     }
 }   /*  End Function convert_to_pixcoords  */
 
@@ -3214,3 +3249,19 @@ static flag move_object (KOverlayList olist, unsigned int object_id,
     }
     return (TRUE);
 }   /*  End Function move_object  */
+
+static flag refresh_associated_canvas (struct refresh_canvas_type *cnv,
+				       flag clear)
+/*  [PURPOSE] This routine will refresh a world canvas associated with an
+    overlay list. If the overlay list is drawn in the upper layer of the
+    canvas, only the upper layers are refreshed.
+    <cnv> The canvas association.
+    <clear> If TRUE and the entire canvas is refreshed, the canvas is cleared
+    first.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    if (cnv->upper_layer) return ( canvas_refresh_upper_layers (cnv->canvas) );
+    return ( kwin_refresh_if_visible (canvas_get_pixcanvas (cnv->canvas),
+				      clear) );
+}   /*  End Function refresh_associated_canvas  */
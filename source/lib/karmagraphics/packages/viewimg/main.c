@@ -239,6 +239,7 @@
 #define NEW_WIN_SCALE
 #include <karma_viewimg.h>
 #include <karma_iarray.h>
+#include <karma_iedit.h>
 #include <karma_imc.h>
 #include <karma_ds.h>
 #include <karma_st.h>
@@ -252,6 +253,7 @@
 #define HOLDER_MAGIC_NUMBER (unsigned int) 1654545154
 
 #define DEFAULT_NUMBER_OF_COLOURS 200
+#define MAX_LEVELS 16
 
 #define VERIFY_VIMAGE(vimage) {if (vimage == NULL) \
 {fprintf (stderr, "NULL viewable image passed\n"); \
@@ -289,6 +291,10 @@ struct canvas_holder_type
     long pan_centre_y;
     int pan_magnification;
     packet_desc *old_cmap;
+    unsigned long cache_budget;  /*  Bytes allowed for image caches  */
+    unsigned long cache_clock;   /*  Incremented every time a cache is used */
+    flag precompute_ok;
+    unsigned int decimation;
 };
 
 struct sequence_holder_type
@@ -338,11 +344,18 @@ struct viewableimage_type
     int pixcanvas_height;
     SequenceHolder sequence;
     KPixCanvasImageCache cache;
+    /*  Decimated copies of the PseudoColour image, built on demand  */
+    unsigned int num_levels;
+    unsigned int level_decimation;
+    multi_array *levels[MAX_LEVELS];
+    char *level_data[MAX_LEVELS];
     unsigned int num_restrictions;
     char **restriction_names;
     double *restriction_values;
     double iscale_test[NUM_ISCALE_VALUES];
     struct canvas_override_type override;
+    unsigned long cache_size;  /*  Approximate size of image cache  */
+    unsigned long last_used;
     ViewableImage next;
     ViewableImage prev;
     struct win_scale_type win_scale;
@@ -415,9 +428,29 @@ STATIC_FUNCTION (flag coord_convert_func,
 		  CONST double *xin, CONST double *yin,
 		  double *xout, double *yout, flag to_world, void **info) );
 STATIC_FUNCTION (void initialise_vimage, (ViewableImage vimage) );
+STATIC_FUNCTION (flag test_iscale,
+		 (ViewableImage vimage, struct win_scale_type *win_scale,
+		  flag *changed) );
+STATIC_FUNCTION (void find_intensity_range,
+		 (ViewableImage vimage, long hstart, long hend,
+		  long vstart, long vend, unsigned int conv_type) );
+STATIC_FUNCTION (void note_cache_use,
+		 (CanvasHolder holder, ViewableImage vimage, int width,
+		  int height) );
 STATIC_FUNCTION (flag copy_restrictions,
 		 (ViewableImage vimage, unsigned int num_restr,
 		  CONST char **restr_names, CONST double *restr_values) );
+STATIC_FUNCTION (void select_level,
+		 (ViewableImage vimage, struct win_scale_type *win_scale,
+		  array_desc **arr_desc, char **slice,
+		  unsigned int *hdim, unsigned int *vdim,
+		  unsigned int *elem_index) );
+STATIC_FUNCTION (multi_array *decimate_image,
+		 (array_desc *arr_desc, CONST char *slice,
+		  unsigned int hdim, unsigned int vdim,
+		  unsigned int elem_index, unsigned int decimation,
+		  char **new_slice) );
+STATIC_FUNCTION (void discard_levels, (ViewableImage vimage) );
 
 
 /* Public functions follow */
@@ -1413,6 +1446,195 @@ flag viewimg_set_active (ViewableImage vimage, flag refresh)
     return (TRUE);
 }   /*  End Function viewimg_set_active  */
 
+/*EXPERIMENTAL_FUNCTION*/
+flag viewimg_precompute (ViewableImage vimage)
+/*  [SUMMARY] Compute the image cache for a viewable image in advance.
+    [PURPOSE] This routine will compute the image cache for a viewable image
+    which is not the active image, without displaying it. The cache is
+    computed using the same window scaling as the active image, so that a
+    subsequent call to [<viewimg_make_active>] need only copy the cache onto
+    the canvas. This is intended for the smooth playback of movies, where the
+    next few frames may be computed while the display is idle.
+    <vimage> The viewable image.
+    [NOTE] Nothing is done if the active image has not yet been drawn, if
+    panning is enabled, if the image is TrueColour and the canvas is
+    PseudoColour, if the image geometry differs from that of the active image
+    or if the pixel canvas cannot compute caches without displaying them.
+    [NOTE] The total size of the image caches for the canvas may be limited
+    with the VIEWIMG_ATT_CACHE_BUDGET attribute.
+    [MT-LEVEL] Unsafe.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    CanvasHolder holder;
+    ViewableImage active;
+    KPixCanvas pixcanvas;
+    flag cache_only, iscale_changed, ok;
+    long hstart, hend, vstart, vend;  /*  Inclusive co-ordinates  */
+    unsigned int visual, hdim, vdim, num_pixels, elem_index;
+    char *slice;
+    unsigned long *pixel_values;
+    array_desc *arr_desc, *active_arr_desc;
+    packet_desc *pack_desc;
+    dim_desc *hdim_desc, *vdim_desc, *active_hdim, *active_vdim;
+    struct win_scale_type win_scale;
+    static char function_name[] = "viewimg_precompute";
+
+    VERIFY_VIMAGE (vimage);
+    holder = vimage->canvas_holder;
+    active = holder->active_image;
+    if ( (active == NULL) || (vimage == active) ) return (TRUE);
+    if ( (active->cache == NULL) || active->recompute ) return (TRUE);
+    if (holder->enable_panning || !holder->precompute_ok) return (TRUE);
+    pixcanvas = canvas_get_pixcanvas (holder->canvas);
+    kwin_get_attributes (pixcanvas,
+			 KWIN_ATT_VISUAL, &visual,
+			 KWIN_ATT_END);
+    if (vimage->tc_arr_desc == NULL)
+    {
+	if (active->tc_arr_desc != NULL) return (TRUE);
+	arr_desc = vimage->pc_arr_desc;
+	hdim = vimage->pc_hdim;
+	vdim = vimage->pc_vdim;
+	active_arr_desc = active->pc_arr_desc;
+	active_hdim = active_arr_desc->dimensions[active->pc_hdim];
+	active_vdim = active_arr_desc->dimensions[active->pc_vdim];
+    }
+    else
+    {
+	if (visual == KWIN_VISUAL_PSEUDOCOLOUR) return (TRUE);
+	if (active->tc_arr_desc == NULL) return (TRUE);
+	arr_desc = vimage->tc_arr_desc;
+	hdim = vimage->tc_hdim;
+	vdim = vimage->tc_vdim;
+	active_arr_desc = active->tc_arr_desc;
+	active_hdim = active_arr_desc->dimensions[active->tc_hdim];
+	active_vdim = active_arr_desc->dimensions[active->tc_vdim];
+    }
+    hdim_desc = arr_desc->dimensions[hdim];
+    vdim_desc = arr_desc->dimensions[vdim];
+    if ( (hdim_desc->length != active_hdim->length) ||
+	 (vdim_desc->length != active_vdim->length) ||
+	 (hdim_desc->first_coord != active_hdim->first_coord) ||
+	 (hdim_desc->last_coord != active_hdim->last_coord) ||
+	 (vdim_desc->first_coord != active_vdim->first_coord) ||
+	 (vdim_desc->last_coord != active_vdim->last_coord) ) return (TRUE);
+    if (arr_desc->offsets == NULL)
+    {
+	if ( !ds_compute_array_offsets (arr_desc) )
+	{
+	    a_func_abort (function_name, "error computing array offsets");
+	    return (FALSE);
+	}
+    }
+    /*  Use the window scaling of the active image, with the intensity range
+	determined the same way as the size control function would  */
+    m_copy ( (char *) &win_scale, (char *) &active->win_scale,
+	     sizeof win_scale );
+    hstart = ds_get_coord_num (hdim_desc, win_scale.left_x,
+			       SEARCH_BIAS_CLOSEST);
+    hend = ds_get_coord_num (hdim_desc, win_scale.right_x,
+			     SEARCH_BIAS_CLOSEST);
+    vstart = ds_get_coord_num (vdim_desc, win_scale.bottom_y,
+			       SEARCH_BIAS_CLOSEST);
+    vend = ds_get_coord_num (vdim_desc, win_scale.top_y, SEARCH_BIAS_CLOSEST);
+    if ( (hstart >= hend) || (vstart >= vend) ) return (TRUE);
+    if (vimage->tc_arr_desc == NULL)
+    {
+	if (holder->auto_v)
+	{
+	    if ( (vimage->value_min >= TOOBIG) ||
+		 (vimage->value_max >= TOOBIG) )
+	    {
+		find_intensity_range (vimage, hstart, hend, vstart, vend,
+				      win_scale.conv_type);
+	    }
+	    win_scale.z_min = vimage->value_min;
+	    win_scale.z_max = vimage->value_max;
+	}
+	else
+	{
+	    if (vimage->override.value_min < TOOBIG)
+	    {
+		win_scale.z_min = vimage->override.value_min;
+	    }
+	    if (vimage->override.value_max < TOOBIG)
+	    {
+		win_scale.z_max = vimage->override.value_max;
+	    }
+	}
+    }
+    iscale_changed = FALSE;
+    if ( (vimage->tc_arr_desc == NULL) && (win_scale.iscale_func != NULL) )
+    {
+	if ( !test_iscale (vimage, &win_scale, &iscale_changed) )
+	{
+	    return (FALSE);
+	}
+    }
+    if ( (vimage->cache != NULL) && !vimage->recompute && !vimage->changed &&
+	 !iscale_changed &&
+	 m_cmp ( (char *) &win_scale, (char *) &vimage->win_scale,
+		 sizeof win_scale ) )
+    {
+	/*  Cache is already up to date  */
+	vimage->last_used = ++holder->cache_clock;
+	return (TRUE);
+    }
+    kwin_set_attributes (pixcanvas,
+			 KWIN_ATT_CACHE_ONLY, TRUE,
+			 KWIN_ATT_END);
+    kwin_get_attributes (pixcanvas,
+			 KWIN_ATT_CACHE_ONLY, &cache_only,
+			 KWIN_ATT_END);
+    if (!cache_only)
+    {
+	/*  Drawing would go to the screen: never try again  */
+	holder->precompute_ok = FALSE;
+	return (TRUE);
+    }
+    if (vimage->tc_arr_desc == NULL)
+    {
+	num_pixels = kcmap_get_pixels (canvas_get_cmap (holder->canvas),
+				       &pixel_values);
+	select_level (vimage, &win_scale, &arr_desc, &slice, &hdim, &vdim,
+		      &elem_index);
+	ok = kwin_draw_image (pixcanvas, arr_desc, slice, hdim, vdim,
+			      elem_index, num_pixels, pixel_values,
+			      &win_scale, &vimage->cache);
+    }
+    else
+    {
+	pack_desc = arr_desc->packet;
+	ok = kwin_draw_rgb_image (pixcanvas,
+				  win_scale.x_offset, win_scale.y_offset,
+				  win_scale.x_pixels, win_scale.y_pixels,
+				  (CONST unsigned char *) vimage->tc_slice +
+				  ds_get_element_offset (pack_desc,
+							 vimage->tc_red_index),
+				  (CONST unsigned char *) vimage->tc_slice +
+				  ds_get_element_offset (pack_desc,
+							 vimage->tc_green_index),
+				  (CONST unsigned char *) vimage->tc_slice +
+				  ds_get_element_offset (pack_desc,
+							 vimage->tc_blue_index),
+				  arr_desc->offsets[hdim] + hstart,
+				  arr_desc->offsets[vdim] + vstart,
+				  hend - hstart + 1, vend - vstart + 1,
+				  &vimage->cache);
+    }
+    kwin_set_attributes (pixcanvas,
+			 KWIN_ATT_CACHE_ONLY, FALSE,
+			 KWIN_ATT_END);
+    if (!ok) return (FALSE);
+    m_copy ( (char *) &vimage->win_scale, (char *) &win_scale,
+	     sizeof win_scale );
+    vimage->recompute = FALSE;
+    vimage->changed = FALSE;
+    note_cache_use (holder, vimage, win_scale.x_pixels, win_scale.y_pixels);
+    return (TRUE);
+}   /*  End Function viewimg_precompute  */
+
 /*OBSOLETE_FUNCTION*/
 void viewimg_control_autoscaling (KWorldCanvas canvas,
 				  flag auto_x, flag auto_y, flag auto_v,
@@ -1483,6 +1705,8 @@ flag viewimg_register_data_change (ViewableImage vimage)
     vimage->changed = TRUE;
     vimage->value_min = TOOBIG;
     vimage->value_max = TOOBIG;
+    viewimg_statistics_discard (vimage);
+    discard_levels (vimage);
     if (vimage == holder->active_image)
     {
 	/*  Active image: refresh  */
@@ -1511,6 +1735,8 @@ void viewimg_destroy (ViewableImage vimage)
 
     VERIFY_VIMAGE (vimage);
     holder = vimage->canvas_holder;
+    viewimg_statistics_discard (vimage);
+    discard_levels (vimage);
     kwin_free_cache_data (vimage->cache);
     ds_dealloc_multi (vimage->pc_multi_desc);
     ds_dealloc_multi (vimage->tc_multi_desc);
@@ -1737,6 +1963,93 @@ flag viewimg_fill_polygon (ViewableImage vimage, edit_coord *coords,
 	     coords, num_vertices, value) );
 }   /*  End Function viewimg_fill_polygon  */
 
+/*EXPERIMENTAL_FUNCTION*/
+flag viewimg_draw_edit_pending (ViewableImage vimage, KImageEditList ilist)
+/*  [SUMMARY] Draw new edit instructions and refresh only the affected areas.
+    [PURPOSE] This routine will draw those instructions in a managed image
+    edit instruction list which have not yet been drawn (see
+    [<iedit_draw_pending>]) into the 2-dimensional data associated with a
+    viewable image. If the viewable image is active, the areas of the canvas
+    covered by the new instructions are then refreshed with
+    [<viewimg_partial_refresh>]. Unlike [<viewimg_register_data_change>], the
+    intensity scale is not recomputed.
+    [NOTE] Only the drawing into the data is proportional to the size of the
+    new instructions. The cached image is marked for recomputation, so the
+    refresh still rebuilds the whole visible image before the affected areas
+    are copied to the canvas.
+    <vimage> The viewable image.
+    <ilist> The list of edit objects.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    KWorldCanvas canvas;
+    flag ok;
+    unsigned int count, num_drawn;
+    double abs_pad, ord_pad;
+    double x[2], y[2], px[2], py[2];
+    packet_desc *pack_desc;
+    array_desc *arr_desc;
+    dim_desc *hdim, *vdim;
+    CONST edit_instruction *drawn;
+    KPixCanvasRefreshArea *areas;
+    static char function_name[] = "viewimg_draw_edit_pending";
+
+    VERIFY_VIMAGE (vimage);
+    if (vimage->tc_arr_desc != NULL)
+    {
+	fprintf (stderr, "%s: TrueColour images not supported yet\n",
+		 function_name);
+	return (FALSE);
+    }
+    arr_desc = vimage->pc_arr_desc;
+    pack_desc = arr_desc->packet;
+    hdim = arr_desc->dimensions[vimage->pc_hdim];
+    vdim = arr_desc->dimensions[vimage->pc_vdim];
+    ok = iedit_draw_pending (ilist, vimage->pc_slice,
+			     pack_desc->element_types[vimage->pc_elem_index],
+			     hdim, vimage->pc_hstride,
+			     vdim, vimage->pc_vstride, &drawn, &num_drawn);
+    if (num_drawn < 1) return (ok);
+    /*  Data have changed: invalidate derived data but leave the intensity
+	scale alone  */
+    vimage->recompute = TRUE;
+    vimage->value_min = TOOBIG;
+    vimage->value_max = TOOBIG;
+    viewimg_statistics_discard (vimage);
+    discard_levels (vimage);
+    if (vimage != vimage->canvas_holder->active_image) return (ok);
+    /*  Pad each bounding box by one element so that partly covered elements
+	are refreshed  */
+    abs_pad = (hdim->length < 2) ? 0.0 :
+	fabs ( ds_get_coordinate (hdim, 1) - ds_get_coordinate (hdim, 0) );
+    ord_pad = (vdim->length < 2) ? 0.0 :
+	fabs ( ds_get_coordinate (vdim, 1) - ds_get_coordinate (vdim, 0) );
+    if ( ( areas = (KPixCanvasRefreshArea *)
+	   m_alloc (sizeof *areas * num_drawn) ) == NULL )
+    {
+	m_error_notify (function_name, "refresh areas");
+	return (FALSE);
+    }
+    canvas = vimage->canvas_holder->canvas;
+    for (count = 0; count < num_drawn; ++count)
+    {
+	x[0] = drawn[count].min_abscissa - abs_pad;
+	x[1] = drawn[count].max_abscissa + abs_pad;
+	y[0] = drawn[count].min_ordinate - ord_pad;
+	y[1] = drawn[count].max_ordinate + ord_pad;
+	canvas_convert_from_canvas_coords (canvas, FALSE, FALSE, 2, x, y,
+					   px, py);
+	areas[count].startx = (px[0] < px[1]) ? px[0] - 1.0 : px[1] - 1.0;
+	areas[count].endx = (px[0] < px[1]) ? px[1] + 1.0 : px[0] + 1.0;
+	areas[count].starty = (py[0] < py[1]) ? py[0] - 1.0 : py[1] - 1.0;
+	areas[count].endy = (py[0] < py[1]) ? py[1] + 1.0 : py[0] + 1.0;
+	areas[count].clear = TRUE;
+    }
+    if ( !viewimg_partial_refresh (canvas, num_drawn, areas) ) ok = FALSE;
+    m_free ( (char *) areas );
+    return (ok);
+}   /*  End Function viewimg_draw_edit_pending  */
+
 /*PUBLIC_FUNCTION*/
 void viewimg_get_canvas_attributes (KWorldCanvas canvas, ...)
 /*  [SUMMARY] Get the viewable image attributes for a world canvas.
@@ -1791,6 +2104,12 @@ void viewimg_get_canvas_attributes (KWorldCanvas canvas, ...)
 	    *( va_arg (argp, unsigned int *) ) =
 	    holder->allow_truncation;
 	    break;
+	  case VIEWIMG_ATT_CACHE_BUDGET:
+	    *( va_arg (argp, unsigned long *) ) = holder->cache_budget;
+	    break;
+	  case VIEWIMG_ATT_DECIMATION:
+	    *( va_arg (argp, unsigned int *) ) = holder->decimation;
+	    break;
 	  default:
 	    fprintf (stderr, "Illegal attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -1815,7 +2134,8 @@ void viewimg_set_canvas_attributes (KWorldCanvas canvas, ...)
     CanvasHolder holder;
     va_list argp;
     flag bool;
-    unsigned int att_key;
+    unsigned int att_key, uint_val;
+    ViewableImage vimage;
     static char function_name[] = "viewimg_set_canvas_attributes";
 
     if (canvas == NULL)
@@ -1883,6 +2203,22 @@ void viewimg_set_canvas_attributes (KWorldCanvas canvas, ...)
 	  case VIEWIMG_ATT_PAN_MAGNIFICATION:
 	    holder->pan_magnification = va_arg (argp, unsigned int);
 	    break;
+	  case VIEWIMG_ATT_CACHE_BUDGET:
+	    holder->cache_budget = va_arg (argp, unsigned long);
+	    break;
+	  case VIEWIMG_ATT_DECIMATION:
+	    uint_val = va_arg (argp, unsigned int);
+	    if (uint_val > VIEWIMG_DECIMATION_MAXIMUM)
+	    {
+		fprintf (stderr, "Illegal decimation mode: %u\n", uint_val);
+		a_prog_bug (function_name);
+	    }
+	    if (uint_val == holder->decimation) break;
+	    holder->decimation = uint_val;
+	    /*  Existing image caches were computed with the old mode  */
+	    for (vimage = holder->first_image; vimage != NULL;
+		 vimage = vimage->next) vimage->recompute = TRUE;
+	    break;
 	  default:
 	    fprintf (stderr, "Illegal attribute key: %u\n", att_key);
 	    a_prog_bug (function_name);
@@ -2398,6 +2734,10 @@ static CanvasHolder alloc_canvas_holder (KWorldCanvas canvas)
     canvas_holder->pan_centre_y = 0;
     canvas_holder->pan_magnification = 4;
     canvas_holder->old_cmap = NULL;
+    canvas_holder->cache_budget = 0;
+    canvas_holder->cache_clock = 0;
+    canvas_holder->precompute_ok = TRUE;
+    canvas_holder->decimation = VIEWIMG_DECIMATION_MEAN;
     /*  Insert at beginning of list  */
     canvas_holder->next = first_canvas_holder;
     first_canvas_holder = canvas_holder;
@@ -2446,9 +2786,8 @@ static void worldcanvas_refresh_func (KWorldCanvas canvas,
 {
     CanvasHolder holder;
     ViewableImage vimage;
-    unsigned int visual, count;
-    double iscale_values[NUM_ISCALE_VALUES];
-    IscaleFunc iscale_func;
+    flag iscale_changed;
+    unsigned int visual;
     static char function_name[] = "__viewimg_worldcanvas_refresh_func";
 
     if ( (holder = (CanvasHolder) *info) == NULL )
@@ -2517,31 +2856,8 @@ static void worldcanvas_refresh_func (KWorldCanvas canvas,
 	    of scaled values with a set previously computed. If there is a
 	    difference, the intensity scaling has changed. This is only an
 	    approximate algorithm  */
-	iscale_func = (IscaleFunc) win_scale->iscale_func;
-	/*  Compute test values  */
-	for (count = 0; count < NUM_ISCALE_VALUES; ++count)
-	{
-	    iscale_values[count] = win_scale->z_min +
-		(win_scale->z_max - win_scale->z_min) * iscale_factors[count];
-	}
-	if ( !(*iscale_func) (iscale_values, 1, iscale_values, 1,
-			      NUM_ISCALE_VALUES,
-			      win_scale->z_min, win_scale->z_max,
-			      win_scale->iscale_info) )
-	{
-	    fprintf (stderr, "%s: error scaling test values\n", function_name);
-	    return;
-	}
-	/*  Now compare  */
-	if ( (vimage->iscale_test[0] >= TOOBIG) ||
-	     !m_cmp ( (char *) vimage->iscale_test, (char *) iscale_values,
-		      sizeof *iscale_values * NUM_ISCALE_VALUES ) )
-	{
-	    /*  Old values not consistent: copy and force recompute  */
-	    m_copy ( (char *) vimage->iscale_test, (char *) iscale_values,
-		     sizeof *iscale_values * NUM_ISCALE_VALUES );
-	    vimage->recompute = TRUE;
-	}
+	if ( !test_iscale (vimage, win_scale, &iscale_changed) ) return;
+	if (iscale_changed) vimage->recompute = TRUE;
     }
     if (vimage->recompute)
     {
@@ -2579,6 +2895,7 @@ static void worldcanvas_refresh_func (KWorldCanvas canvas,
 	return;
     }
     /*  No significant changes: use image cache  */
+    vimage->last_used = ++holder->cache_clock;
     if (holder->enable_panning && !holder->auto_v)
     {
 	draw_subcache (holder, vimage, width, height);
@@ -2623,7 +2940,8 @@ static void recompute_image (CanvasHolder holder, int width, int height,
 */
 {
     Kcolourmap kcmap;
-    unsigned int num_pixels, elem_index;
+    unsigned int num_pixels, elem_index, hdim_index, vdim_index;
+    char *slice;
     array_desc *arr_desc;
     packet_desc *pack_desc;
     unsigned long *pixel_values;
@@ -2715,18 +3033,20 @@ static void recompute_image (CanvasHolder holder, int width, int height,
 	}
 	/*  Now draw the desired part of this huge image cache  */
 	draw_subcache (holder, vimage, width, height);
+	note_cache_use (holder, vimage,
+			hdim->length * holder->pan_magnification,
+			vdim->length * holder->pan_magnification);
     }
     else
     {
 	/*  Compute image over region defined by world canvas  */
 	if (vimage->pc_arr_desc != NULL)
 	{
-	    if ( !canvas_draw_image (holder->canvas,
-				     vimage->pc_arr_desc,
-				     vimage->pc_slice,
-				     vimage->pc_hdim,
-				     vimage->pc_vdim,
-				     vimage->pc_elem_index,
+	    /*  Draw from a decimated copy of the image if zoomed out  */
+	    select_level (vimage, win_scale, &arr_desc, &slice, &hdim_index,
+			  &vdim_index, &elem_index);
+	    if ( !canvas_draw_image (holder->canvas, arr_desc, slice,
+				     hdim_index, vdim_index, elem_index,
 				     &vimage->cache) )
 	    {
 		fprintf (stderr, "Error drawing image onto world canvas\n");
@@ -2747,6 +3067,8 @@ static void recompute_image (CanvasHolder holder, int width, int height,
 		return;
 	    }
 	}
+	note_cache_use (holder, vimage, win_scale->x_pixels,
+			win_scale->y_pixels);
     }
     vimage->recompute = FALSE;
     /*  Also need to clear the changed flag because the size control function
@@ -2782,7 +3104,6 @@ static void worldcanvas_size_control_func (KWorldCanvas canvas,
     long hstart, hend, vstart, vend;  /*  Inclusive co-ordinates  */
     unsigned int canvas_visual, canvas_depth;
     flag scale_changed = FALSE;
-    uaddr *hoffsets, *voffsets;
     char *cmap_packet;
     array_desc *arr_desc;
     packet_desc *pack_desc;
@@ -2823,16 +3144,12 @@ static void worldcanvas_size_control_func (KWorldCanvas canvas,
 	arr_desc = vimage->pc_arr_desc;
 	hdim = arr_desc->dimensions[vimage->pc_hdim];
 	vdim = arr_desc->dimensions[vimage->pc_vdim];
-	hoffsets = arr_desc->offsets[vimage->pc_hdim];
-	voffsets = arr_desc->offsets[vimage->pc_vdim];
     }
     else
     {
 	arr_desc = vimage->tc_arr_desc;
 	hdim = arr_desc->dimensions[vimage->tc_hdim];
 	vdim = arr_desc->dimensions[vimage->tc_vdim];
-	hoffsets = arr_desc->offsets[vimage->tc_hdim];
-	voffsets = arr_desc->offsets[vimage->tc_vdim];
     }
     pack_desc = arr_desc->packet;
 #ifdef DEBUG
@@ -2970,40 +3287,8 @@ static void worldcanvas_size_control_func (KWorldCanvas canvas,
 	     (vimage->value_max >= TOOBIG) )
 	{
 	    /*  Must compute minimum and maximum values  */
-	    vimage->value_min = TOOBIG;
-	    vimage->value_max = -TOOBIG;
-	    if ( !ds_find_2D_extremes (vimage->pc_slice,
-				       vend - vstart + 1, voffsets + vstart,
-				       hend - hstart + 1, hoffsets + hstart,
-				       pack_desc->element_types[vimage->pc_elem_index],
-				       win_scale->conv_type,
-				       &vimage->value_min,&vimage->value_max) )
-	    {
-		fprintf (stderr, "Error getting data range\n");
-		a_prog_bug (function_name);
-	    }
-	    vimage->changed = FALSE;
-	    /*Image intensity range has changed: cached image no longer valid*/
-	    vimage->recompute = TRUE;
-	    /*  Ensure ranges are sensible  */
-	    if (vimage->value_min >= vimage->value_max)
-	    {
-		if (vimage->value_min < 0.0)
-		{
-		    vimage->value_min *= 2.0;
-		    vimage->value_max = 0.0;
-		}
-		else if (vimage->value_min > 0.0)
-		{
-		    vimage->value_min = 0.0;
-		    vimage->value_max *= 2.0;
-		}
-		else
-		{
-		    vimage->value_min = -1.0;
-		    vimage->value_max = 1.0;
-		}
-	    }
+	    find_intensity_range (vimage, hstart, hend, vstart, vend,
+				  win_scale->conv_type);
 	}
 	/*  World canvas intensity scale has changed  */
 	win_scale->z_min = vimage->value_min;
@@ -3870,6 +4155,8 @@ static void initialise_vimage (ViewableImage vimage)
     vimage->pixcanvas_width = -1;
     vimage->pixcanvas_height = -1;
     vimage->cache = NULL;
+    vimage->num_levels = 0;
+    vimage->level_decimation = VIEWIMG_DECIMATION_NONE;
     /*  Compute strides  */
     vimage->pc_hstride = 0;
     vimage->pc_vstride = 0;
@@ -3883,6 +4170,8 @@ static void initialise_vimage (ViewableImage vimage)
     canvas_init_win_scale (&vimage->win_scale, K_WIN_SCALE_MAGIC_NUMBER);
     vimage->override.value_min = TOOBIG;
     vimage->override.value_max = TOOBIG;
+    vimage->cache_size = 0;
+    vimage->last_used = 0;
     vimage->prev = NULL;
     vimage->next = NULL;
 }   /*  End Function initialise_vimage  */
@@ -3934,3 +4223,403 @@ static flag copy_restrictions (ViewableImage vimage, unsigned int num_restr,
     vimage->num_restrictions = num_restr;
     return (TRUE);
 }   /*  End Function copy_restrictions  */
+
+static flag test_iscale (ViewableImage vimage,
+			 struct win_scale_type *win_scale, flag *changed)
+/*  [SUMMARY] Test if the intensity scaling function has changed.
+    [PURPOSE] This routine will compare a set of values scaled by the
+    intensity scaling function with a set previously computed for a viewable
+    image. If there is a difference, the intensity scaling has changed and the
+    new values are saved. This is only an approximate algorithm.
+    <vimage> The ViewableImage.
+    <win_scale> The window scaling information.
+    <changed> The value TRUE is written here if the scaling has changed, else
+    FALSE is written here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int count;
+    double iscale_values[NUM_ISCALE_VALUES];
+    IscaleFunc iscale_func;
+    static char function_name[] = "__viewimg_test_iscale";
+
+    *changed = FALSE;
+    iscale_func = (IscaleFunc) win_scale->iscale_func;
+    /*  Compute test values  */
+    for (count = 0; count < NUM_ISCALE_VALUES; ++count)
+    {
+	iscale_values[count] = win_scale->z_min +
+	    (win_scale->z_max - win_scale->z_min) * iscale_factors[count];
+    }
+    if ( !(*iscale_func) (iscale_values, 1, iscale_values, 1,
+			  NUM_ISCALE_VALUES,
+			  win_scale->z_min, win_scale->z_max,
+			  win_scale->iscale_info) )
+    {
+	fprintf (stderr, "%s: error scaling test values\n", function_name);
+	return (FALSE);
+    }
+    /*  Now compare  */
+    if ( (vimage->iscale_test[0] >= TOOBIG) ||
+	 !m_cmp ( (char *) vimage->iscale_test, (char *) iscale_values,
+		  sizeof *iscale_values * NUM_ISCALE_VALUES ) )
+    {
+	/*  Old values not consistent: copy  */
+	m_copy ( (char *) vimage->iscale_test, (char *) iscale_values,
+		 sizeof *iscale_values * NUM_ISCALE_VALUES );
+	*changed = TRUE;
+    }
+    return (TRUE);
+}   /*  End Function test_iscale  */
+
+static void find_intensity_range (ViewableImage vimage, long hstart, long hend,
+				  long vstart, long vend,
+				  unsigned int conv_type)
+/*  [SUMMARY] Find the intensity range of a PseudoColour viewable image.
+    [PURPOSE] This routine will compute the minimum and maximum values in a
+    region of a PseudoColour viewable image, ensuring the range is sensible.
+    The image cache is marked as needing recomputation.
+    <vimage> The ViewableImage.
+    <hstart> The first horizontal co-ordinate index.
+    <hend> The last horizontal co-ordinate index (inclusive).
+    <vstart> The first vertical co-ordinate index.
+    <vend> The last vertical co-ordinate index (inclusive).
+    <conv_type> The complex conversion type.
+    [RETURNS] Nothing.
+*/
+{
+    array_desc *arr_desc;
+    static char function_name[] = "__viewimg_find_intensity_range";
+
+    arr_desc = vimage->pc_arr_desc;
+    vimage->value_min = TOOBIG;
+    vimage->value_max = -TOOBIG;
+    if ( !ds_find_2D_extremes (vimage->pc_slice,
+			       vend - vstart + 1,
+			       arr_desc->offsets[vimage->pc_vdim] + vstart,
+			       hend - hstart + 1,
+			       arr_desc->offsets[vimage->pc_hdim] + hstart,
+			       arr_desc->packet->element_types[vimage->pc_elem_index],
+			       conv_type,
+			       &vimage->value_min, &vimage->value_max) )
+    {
+	fprintf (stderr, "Error getting data range\n");
+	a_prog_bug (function_name);
+    }
+    vimage->changed = FALSE;
+    /*  Image intensity range has changed: cached image no longer valid  */
+    vimage->recompute = TRUE;
+    /*  Ensure ranges are sensible  */
+    if (vimage->value_min >= vimage->value_max)
+    {
+	if (vimage->value_min < 0.0)
+	{
+	    vimage->value_min *= 2.0;
+	    vimage->value_max = 0.0;
+	}
+	else if (vimage->value_min > 0.0)
+	{
+	    vimage->value_min = 0.0;
+	    vimage->value_max *= 2.0;
+	}
+	else
+	{
+	    vimage->value_min = -1.0;
+	    vimage->value_max = 1.0;
+	}
+    }
+}   /*  End Function find_intensity_range  */
+
+static void note_cache_use (CanvasHolder holder, ViewableImage vimage,
+			    int width, int height)
+/*  [SUMMARY] Record that an image cache was computed.
+    [PURPOSE] This routine will record the size and time of use of the image
+    cache for a viewable image. If the total size of the image caches for the
+    canvas exceeds the cache budget, the least recently used caches (other
+    than those for the active image and <<vimage>>) are freed.
+    <holder> The canvas holder.
+    <vimage> The ViewableImage.
+    <width> The width of the image cache in pixels.
+    <height> The height of the image cache in pixels.
+    [RETURNS] Nothing.
+*/
+{
+    ViewableImage curr, oldest;
+    unsigned int depth;
+    unsigned long total;
+
+    if (vimage->cache == NULL) return;
+    kwin_get_attributes (canvas_get_pixcanvas (holder->canvas),
+			 KWIN_ATT_DEPTH, &depth,
+			 KWIN_ATT_END);
+    vimage->cache_size = (unsigned long) width * (unsigned long) height;
+    if (depth > 8) vimage->cache_size *= 4;
+    vimage->last_used = ++holder->cache_clock;
+    if (holder->cache_budget < 1) return;
+    for (total = 0, curr = holder->first_image; curr != NULL;
+	 curr = curr->next)
+    {
+	if (curr->cache != NULL) total += curr->cache_size;
+    }
+    while (total > holder->cache_budget)
+    {
+	for (oldest = NULL, curr = holder->first_image; curr != NULL;
+	     curr = curr->next)
+	{
+	    if ( (curr->cache == NULL) || (curr == vimage) ||
+		 (curr == holder->active_image) ) continue;
+	    if ( (oldest == NULL) || (curr->last_used < oldest->last_used) )
+	    {
+		oldest = curr;
+	    }
+	}
+	if (oldest == NULL) return;
+	kwin_free_cache_data (oldest->cache);
+	oldest->cache = NULL;
+	oldest->recompute = TRUE;
+	total -= oldest->cache_size;
+    }
+}   /*  End Function note_cache_use  */
+
+static void select_level (ViewableImage vimage,
+			  struct win_scale_type *win_scale,
+			  array_desc **arr_desc, char **slice,
+			  unsigned int *hdim, unsigned int *vdim,
+			  unsigned int *elem_index)
+/*  [SUMMARY] Select the PseudoColour image data to draw.
+    [PURPOSE] This routine will choose between the PseudoColour image data and
+    one of its decimated copies, based on how many data values will be drawn
+    into each screen pixel. The decimated copies are computed when first
+    needed. Each level halves the image size in both dimensions, and the level
+    chosen is the smallest one which still has at least one data value per
+    screen pixel, so the cost of drawing a zoomed-out image scales with the
+    window size rather than the image size.
+    <vimage> The viewable image.
+    <win_scale> The window scaling information.
+    <arr_desc> The array descriptor to draw is written here.
+    <slice> The start of the image data to draw is written here.
+    <hdim> The horizontal dimension index is written here.
+    <vdim> The vertical dimension index is written here.
+    <elem_index> The element index is written here.
+    [RETURNS] Nothing.
+*/
+{
+    CanvasHolder holder = vimage->canvas_holder;
+    unsigned int level, num_levels, factor, hfactor, vfactor;
+    unsigned long hstart, hend, vstart, vend;
+    char *new_slice;
+    multi_array *multi_desc;
+    array_desc *level_arr_desc;
+    packet_desc *pack_desc;
+    dim_desc *hdim_desc, *vdim_desc;
+
+    *arr_desc = vimage->pc_arr_desc;
+    *slice = vimage->pc_slice;
+    *hdim = vimage->pc_hdim;
+    *vdim = vimage->pc_vdim;
+    *elem_index = vimage->pc_elem_index;
+    /*  Compressed TrueColour images have colour indices, not data values  */
+    if ( (vimage->tc_arr_desc != NULL) ||
+	 (holder->decimation == VIEWIMG_DECIMATION_NONE) ) return;
+    if (vimage->level_decimation != holder->decimation)
+    {
+	discard_levels (vimage);
+    }
+    pack_desc = (*arr_desc)->packet;
+    if ( ds_element_is_complex (pack_desc->element_types[*elem_index]) )
+    {
+	return;
+    }
+    hdim_desc = (*arr_desc)->dimensions[*hdim];
+    vdim_desc = (*arr_desc)->dimensions[*vdim];
+    /*  Decimated copies can only have regularly spaced co-ordinates  */
+    if ( (hdim_desc->coordinates != NULL) || (vdim_desc->coordinates != NULL) )
+    {
+	return;
+    }
+    if ( (win_scale->x_pixels < 1) || (win_scale->y_pixels < 1) ) return;
+    hstart = ds_get_coord_num (hdim_desc, win_scale->left_x,
+			       SEARCH_BIAS_CLOSEST);
+    hend = ds_get_coord_num (hdim_desc, win_scale->right_x,
+			     SEARCH_BIAS_CLOSEST);
+    vstart = ds_get_coord_num (vdim_desc, win_scale->bottom_y,
+			       SEARCH_BIAS_CLOSEST);
+    vend = ds_get_coord_num (vdim_desc, win_scale->top_y,
+			     SEARCH_BIAS_CLOSEST);
+    if ( (hstart >= hend) || (vstart >= vend) ) return;
+    hfactor = (hend - hstart + 1) / win_scale->x_pixels;
+    vfactor = (vend - vstart + 1) / win_scale->y_pixels;
+    factor = (hfactor < vfactor) ? hfactor : vfactor;
+    for (num_levels = 0;
+	 (num_levels < MAX_LEVELS) && ( (2 << num_levels) <= factor );
+	 ++num_levels);
+    /*  Compute any missing levels, each from the one before it  */
+    while (vimage->num_levels < num_levels)
+    {
+	if (vimage->num_levels > 0)
+	{
+	    level = vimage->num_levels - 1;
+	    level_arr_desc = (array_desc *)
+		vimage->levels[level]->headers[0]->element_desc[0];
+	    hdim_desc = level_arr_desc->dimensions[1];
+	    vdim_desc = level_arr_desc->dimensions[0];
+	    if ( (hdim_desc->length < 4) || (vdim_desc->length < 4) ) break;
+	    multi_desc = decimate_image (level_arr_desc,
+					 vimage->level_data[level], 1, 0, 0,
+					 holder->decimation, &new_slice);
+	}
+	else
+	{
+	    if ( (hdim_desc->length < 4) || (vdim_desc->length < 4) ) break;
+	    multi_desc = decimate_image (*arr_desc, *slice, *hdim, *vdim,
+					 *elem_index, holder->decimation,
+					 &new_slice);
+	}
+	if (multi_desc == NULL) break;
+	vimage->level_data[vimage->num_levels] = new_slice;
+	vimage->levels[vimage->num_levels++] = multi_desc;
+	vimage->level_decimation = holder->decimation;
+    }
+    level = vimage->num_levels;
+    if (num_levels < level) level = num_levels;
+    if (level < 1) return;
+    multi_desc = vimage->levels[level - 1];
+    *arr_desc = (array_desc *) multi_desc->headers[0]->element_desc[0];
+    *slice = vimage->level_data[level - 1];
+    *hdim = 1;
+    *vdim = 0;
+    *elem_index = 0;
+}   /*  End Function select_level  */
+
+static multi_array *decimate_image (array_desc *arr_desc, CONST char *slice,
+				    unsigned int hdim, unsigned int vdim,
+				    unsigned int elem_index,
+				    unsigned int decimation, char **new_slice)
+/*  [SUMMARY] Shrink an image by a factor of two in each dimension.
+    [PURPOSE] This routine will compute a K_FLOAT image where each value is
+    computed from a block of 2x2 values in the input image. Blank values are
+    ignored.
+    <arr_desc> The array descriptor for the input image.
+    <slice> The start of the input image data.
+    <hdim> The horizontal dimension index.
+    <vdim> The vertical dimension index.
+    <elem_index> The element index.
+    <decimation> The decimation mode. See [<VIEWIMG_DECIMATION_MODES>].
+    <new_slice> The start of the new image data is written here.
+    [RETURNS] A multi_array descriptor containing the new image on success,
+    else NULL. The horizontal dimension is dimension 1.
+*/
+{
+    unsigned int num_rows, row, x, xout, yout, count, num_values;
+    uaddr lengths[2];
+    double step, value, total, maximum;
+    float *out;
+    CONST char *data;
+    char *new_data;
+    uaddr *hoffsets, *voffsets;
+    double *values, *row_values[2];
+    dim_desc *hdim_desc, *vdim_desc;
+    multi_array *multi_desc;
+    array_desc *new_arr_desc;
+    double first_arr[2], last_arr[2];
+    CONST char *names[2];
+    unsigned int elem_type = arr_desc->packet->element_types[elem_index];
+    static char function_name[] = "__viewimg_decimate_image";
+
+    hdim_desc = arr_desc->dimensions[hdim];
+    vdim_desc = arr_desc->dimensions[vdim];
+    hoffsets = arr_desc->offsets[hdim];
+    voffsets = arr_desc->offsets[vdim];
+    data = slice + ds_get_element_offset (arr_desc->packet, elem_index);
+    lengths[0] = (vdim_desc->length + 1) / 2;
+    lengths[1] = (hdim_desc->length + 1) / 2;
+    /*  The co-ordinate of a new value is the centre of its block  */
+    step = (vdim_desc->last_coord - vdim_desc->first_coord) /
+	(double) (vdim_desc->length - 1);
+    first_arr[0] = vdim_desc->first_coord + 0.5 * step;
+    last_arr[0] = first_arr[0] + 2.0 * step * (double) (lengths[0] - 1);
+    step = (hdim_desc->last_coord - hdim_desc->first_coord) /
+	(double) (hdim_desc->length - 1);
+    first_arr[1] = hdim_desc->first_coord + 0.5 * step;
+    last_arr[1] = first_arr[1] + 2.0 * step * (double) (lengths[1] - 1);
+    names[0] = vdim_desc->name;
+    names[1] = hdim_desc->name;
+    new_data = ds_easy_alloc_array (&multi_desc, 2, lengths, first_arr,
+				    last_arr, names, K_FLOAT,
+				    arr_desc->packet->element_desc[elem_index]);
+    if (new_data == NULL)
+    {
+	m_error_notify (function_name, "decimated image");
+	return (NULL);
+    }
+    new_arr_desc = (array_desc *) multi_desc->headers[0]->element_desc[0];
+    if ( !ds_compute_array_offsets (new_arr_desc) )
+    {
+	m_error_notify (function_name, "array offsets");
+	ds_dealloc_multi (multi_desc);
+	return (NULL);
+    }
+    if ( ( values = (double *) m_alloc (sizeof *values * 4 *
+					hdim_desc->length) ) == NULL )
+    {
+	m_error_notify (function_name, "row values");
+	ds_dealloc_multi (multi_desc);
+	return (NULL);
+    }
+    row_values[0] = values;
+    row_values[1] = values + 2 * hdim_desc->length;
+    out = (float *) new_data;
+    for (yout = 0; yout < lengths[0]; ++yout)
+    {
+	row = yout * 2;
+	num_rows = (row + 1 < vdim_desc->length) ? 2 : 1;
+	ds_get_scattered_elements (data + voffsets[row], elem_type, hoffsets,
+				   row_values[0], NULL, hdim_desc->length);
+	if (num_rows > 1)
+	{
+	    ds_get_scattered_elements (data + voffsets[row + 1], elem_type,
+				       hoffsets, row_values[1], NULL,
+				       hdim_desc->length);
+	}
+	for (xout = 0; xout < lengths[1]; ++xout, ++out)
+	{
+	    num_values = (xout * 2 + 1 < hdim_desc->length) ? 2 : 1;
+	    total = 0.0;
+	    maximum = -TOOBIG;
+	    count = 0;
+	    for (row = 0; row < num_rows; ++row)
+	    {
+		/*  Values are (real, imaginary) pairs  */
+		for (x = xout * 2; x < xout * 2 + num_values; ++x)
+		{
+		    if ( ( value = row_values[row][x * 2] ) >= TOOBIG )
+		    {
+			continue;
+		    }
+		    total += value;
+		    if (value > maximum) maximum = value;
+		    ++count;
+		}
+	    }
+	    if (count < 1) *out = TOOBIG;
+	    else if (decimation == VIEWIMG_DECIMATION_MAXIMUM) *out = maximum;
+	    else *out = total / (double) count;
+	}
+    }
+    m_free ( (char *) values );
+    *new_slice = new_data;
+    return (multi_desc);
+}   /*  End Function decimate_image  */
+
+static void discard_levels (ViewableImage vimage)
+/*  [SUMMARY] Discard the decimated copies of a viewable image.
+    <vimage> The viewable image.
+    [RETURNS] Nothing.
+*/
+{
+    while (vimage->num_levels > 0)
+    {
+	ds_dealloc_multi (vimage->levels[--vimage->num_levels]);
+    }
+    vimage->level_decimation = VIEWIMG_DECIMATION_NONE;
+}   /*  End Function discard_levels  */
@@ -46,16 +46,63 @@
 #include <k_event_codes.h>
 #include <karma_viewimg.h>
 #include <karma_ds.h>
+#include <karma_m.h>
 #include <karma_a.h>
 
 
 #define swap(a,b) {tmp = a; a = b; b = tmp;}
 
+#define TILE_SIZE 32
+
 
 /*  Private structures  */
 
+/*  A statistics table holds the sums over TILE_SIZE*TILE_SIZE tiles of an
+    image as a summed-area table, so that the sum, sum of squares and number
+    of points of any block of whole tiles is found with four lookups. The tile
+    minima and maxima are kept in a pyramid, each level reducing 2x2 cells of
+    the level below. Only the partial tiles around the edge of a region need
+    to be read from the image.  */
+typedef struct stats_table_type
+{
+    ViewableImage vimage;
+    array_desc *arr_desc;
+    char *slice;
+    unsigned int hdim;
+    unsigned int vdim;
+    unsigned int elem_index;
+    unsigned int num_htiles;
+    unsigned int num_vtiles;
+    double *sum;               /*  Summed-area tables: one extra row and  */
+    double *sumsq;             /*  column of zeros at the start           */
+    double *npoints;
+    unsigned int num_levels;
+    double **minima;
+    double **maxima;
+    struct stats_table_type *next;
+} *StatsTable;
+
+
+/*  Private data  */
+static StatsTable first_table = NULL;
+
 
 /*  Private functions  */
+STATIC_FUNCTION (StatsTable get_table, (ViewableImage vimage) );
+STATIC_FUNCTION (void destroy_table, (StatsTable table) );
+STATIC_FUNCTION (void query_extremes,
+		 (StatsTable table, unsigned int level,
+		  unsigned int hcell, unsigned int vcell,
+		  unsigned int htile0, unsigned int htile1,
+		  unsigned int vtile0, unsigned int vtile1,
+		  double *min, double *max) );
+STATIC_FUNCTION (flag add_region,
+		 (CONST char *array, array_desc *arr_desc, unsigned int type,
+		  unsigned int hdim, unsigned int vdim,
+		  unsigned int hstart, unsigned int hend,
+		  unsigned int vstart, unsigned int vend,
+		  double *min, double *max, double *sum, double *sumsq,
+		  unsigned long *npoints) );
 
 
 /*  Public functions follow  */
@@ -123,58 +170,21 @@ flag viewimg_statistics_compute (ViewableImage vimage,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    unsigned int hstart, hend, hlength, vstart, vend, vlength, tmp;
-    unsigned int hdim, vdim, elem_index;
+    unsigned int elem_index;
     unsigned long npoints;
-    double min, max, mean, stddev, sum, sumsq, scale, offset, unit_scale;
-    char *array;
-    uaddr *hoffsets, *voffsets;
+    double min, max, mean, stddev, sum, sumsq, unit_scale;
     array_desc *arr_desc;
     packet_desc *pack_desc;
-    dim_desc *hdim_desc, *vdim_desc;
     char unit[STRING_LENGTH];
 
+    if ( !viewimg_statistics_find (vimage, lx0, ly0, lx1, ly1, &min, &max,
+				   &mean, &stddev, &sum, &sumsq, &npoints) )
+	return (FALSE);
     viewimg_get_attributes (vimage,
 			    VIEWIMG_VATT_ARRAY_DESC, &arr_desc,
-			    VIEWIMG_VATT_SLICE, &array,
-			    VIEWIMG_VATT_HDIM, &hdim,
-			    VIEWIMG_VATT_VDIM, &vdim,
 			    VIEWIMG_VATT_PSEUDO_INDEX, &elem_index,
-			    VIEWIMG_VATT_DATA_SCALE, &scale,
-			    VIEWIMG_VATT_DATA_OFFSET, &offset,
 			    VIEWIMG_VATT_END);
-    hoffsets = arr_desc->offsets[hdim];
-    voffsets = arr_desc->offsets[vdim];
-    hdim_desc = arr_desc->dimensions[hdim];
-    vdim_desc = arr_desc->dimensions[vdim];
     pack_desc = arr_desc->packet;
-    /*  Determine start and stop co-ordinates along each dimension  */
-    hstart = ds_get_coord_num (hdim_desc, lx0, SEARCH_BIAS_CLOSEST);
-    hend = ds_get_coord_num (hdim_desc, lx1, SEARCH_BIAS_CLOSEST);
-    if (hstart >= hend) swap (hstart, hend);
-    hlength = hend - hstart + 1;
-    vstart = ds_get_coord_num (vdim_desc, ly0, SEARCH_BIAS_CLOSEST);
-    vend = ds_get_coord_num (vdim_desc, ly1, SEARCH_BIAS_CLOSEST);
-    if (vstart >= vend) swap (vstart, vend);
-    vlength = vend - vstart + 1;
-    array += ds_get_element_offset (pack_desc, elem_index);
-    min = TOOBIG;
-    max = -TOOBIG;
-    if ( !ds_find_2D_stats (array, vlength, voffsets + vstart,
-			    hlength, hoffsets + hstart,
-			    pack_desc->element_types[elem_index],
-			    CONV_CtoR_REAL,
-			    &min, &max, &mean, &stddev, &sum, &sumsq,
-			    &npoints) )
-	return (FALSE);
-    /*  Apply data scaling to the results  */
-    min = min * scale + offset;
-    max = max * scale + offset;
-    sumsq = scale * scale * sumsq + 2.0 * scale * offset * sum +
-	(double) npoints * offset * offset;
-    mean = scale * sum / (double) npoints + offset;
-    sum = scale * sum + (double) npoints * offset;
-    stddev = sqrt (sumsq / (double) npoints - mean * mean);
     /*  Apply unit scale to the results  */
     ds_format_unit (unit, &unit_scale, pack_desc->element_desc[elem_index]);
     min *= unit_scale;
@@ -191,3 +201,466 @@ flag viewimg_statistics_compute (ViewableImage vimage,
 	     npoints, mean, stddev, min, max, sum);
     return (TRUE);
 }   /*  End Function viewimg_statistics_compute  */
+
+/*EXPERIMENTAL_FUNCTION*/
+flag viewimg_statistics_find (ViewableImage vimage,
+			      double lx0, double ly0, double lx1, double ly1,
+			      double *min, double *max, double *mean,
+			      double *stddev, double *sum, double *sumsq,
+			      unsigned long *npoints)
+/*  [SUMMARY] Compute statistics for a subimage.
+    [PURPOSE] This routine will compute statistics for a rectangular region of
+    a PseudoColour viewable image. The first time this is called for an image
+    a table of tile sums is built, after which the cost of a query depends on
+    the perimeter of the region rather than its area. This is fast enough to
+    track the region under the cursor on large images.
+    <vimage> The viewable image.
+    <lx0> The first horizontal linear world co-ordinate.
+    <ly0> The first vertical linear world co-ordinate.
+    <lx1> The second horizontal linear world co-ordinate.
+    <ly1> The second vertical linear world co-ordinate.
+    <min> The minimum value will be written here.
+    <max> The maximum value will be written here.
+    <mean> The mean value will be written here.
+    <stddev> The standard deviation will be written here.
+    <sum> The total of all values will be written here.
+    <sumsq> The total of the squares of all values will be written here.
+    <npoints> The number of (non-blank) values will be written here.
+    [NOTE] The data scaling of the image is applied to the results.
+    [NOTE] The table must be discarded with [<viewimg_statistics_discard>] if
+    the image data are changed. This is done by
+    [<viewimg_register_data_change>].
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned int hstart, hend, hlength, vstart, vend, vlength, tmp;
+    unsigned int htile0, htile1, vtile0, vtile1, row_len, type;
+    unsigned int hpix0, hpix1, vpix0, vpix1;
+    unsigned long np;
+    double scale, offset, s, ssq;
+    double *tab;
+    char *array;
+    StatsTable table;
+    array_desc *arr_desc;
+    packet_desc *pack_desc;
+    dim_desc *hdim_desc, *vdim_desc;
+
+    if ( ( table = get_table (vimage) ) == NULL ) return (FALSE);
+    viewimg_get_attributes (vimage,
+			    VIEWIMG_VATT_DATA_SCALE, &scale,
+			    VIEWIMG_VATT_DATA_OFFSET, &offset,
+			    VIEWIMG_VATT_END);
+    arr_desc = table->arr_desc;
+    array = table->slice;
+    hdim_desc = arr_desc->dimensions[table->hdim];
+    vdim_desc = arr_desc->dimensions[table->vdim];
+    pack_desc = arr_desc->packet;
+    type = pack_desc->element_types[table->elem_index];
+    /*  Determine start and stop co-ordinates along each dimension  */
+    hstart = ds_get_coord_num (hdim_desc, lx0, SEARCH_BIAS_CLOSEST);
+    hend = ds_get_coord_num (hdim_desc, lx1, SEARCH_BIAS_CLOSEST);
+    if (hstart >= hend) swap (hstart, hend);
+    hlength = hdim_desc->length;
+    vstart = ds_get_coord_num (vdim_desc, ly0, SEARCH_BIAS_CLOSEST);
+    vend = ds_get_coord_num (vdim_desc, ly1, SEARCH_BIAS_CLOSEST);
+    if (vstart >= vend) swap (vstart, vend);
+    vlength = vdim_desc->length;
+    *min = TOOBIG;
+    *max = -TOOBIG;
+    s = 0.0;
+    ssq = 0.0;
+    np = 0;
+    /*  Find the tiles lying wholly inside the region  */
+    htile0 = (hstart + TILE_SIZE - 1) / TILE_SIZE;
+    htile1 = (hend + 1 >= hlength) ? table->num_htiles : (hend + 1) / TILE_SIZE;
+    vtile0 = (vstart + TILE_SIZE - 1) / TILE_SIZE;
+    vtile1 = (vend + 1 >= vlength) ? table->num_vtiles : (vend + 1) / TILE_SIZE;
+    if ( (htile0 >= htile1) || (vtile0 >= vtile1) )
+    {
+	/*  No whole tiles: read the region  */
+	if ( !add_region (array, arr_desc, type, table->hdim, table->vdim,
+			  hstart, hend, vstart, vend,
+			  min, max, &s, &ssq, &np) ) return (FALSE);
+    }
+    else
+    {
+	/*  Whole tiles from the tables (<<htile1>> etc. are exclusive)  */
+	row_len = table->num_htiles + 1;
+	tab = table->sum;
+	s = tab[vtile1 * row_len + htile1] - tab[vtile0 * row_len + htile1] -
+	    tab[vtile1 * row_len + htile0] + tab[vtile0 * row_len + htile0];
+	tab = table->sumsq;
+	ssq = tab[vtile1 * row_len + htile1] - tab[vtile0 * row_len + htile1]-
+	    tab[vtile1 * row_len + htile0] + tab[vtile0 * row_len + htile0];
+	tab = table->npoints;
+	np = tab[vtile1 * row_len + htile1] - tab[vtile0 * row_len + htile1] -
+	    tab[vtile1 * row_len + htile0] + tab[vtile0 * row_len + htile0] +
+	    0.5;
+	query_extremes (table, table->num_levels - 1, 0, 0,
+			htile0, htile1 - 1, vtile0, vtile1 - 1, min, max);
+	/*  Partial tiles around the edges  */
+	hpix0 = htile0 * TILE_SIZE;
+	hpix1 = htile1 * TILE_SIZE;
+	if (hpix1 > hlength) hpix1 = hlength;
+	vpix0 = vtile0 * TILE_SIZE;
+	vpix1 = vtile1 * TILE_SIZE;
+	if (vpix1 > vlength) vpix1 = vlength;
+	if ( (vstart < vpix0) &&
+	     !add_region (array, arr_desc, type, table->hdim, table->vdim,
+			  hstart, hend, vstart, vpix0 - 1,
+			  min, max, &s, &ssq, &np) ) return (FALSE);
+	if ( (vpix1 <= vend) &&
+	     !add_region (array, arr_desc, type, table->hdim, table->vdim,
+			  hstart, hend, vpix1, vend,
+			  min, max, &s, &ssq, &np) ) return (FALSE);
+	if ( (hstart < hpix0) &&
+	     !add_region (array, arr_desc, type, table->hdim, table->vdim,
+			  hstart, hpix0 - 1, vpix0, vpix1 - 1,
+			  min, max, &s, &ssq, &np) ) return (FALSE);
+	if ( (hpix1 <= hend) &&
+	     !add_region (array, arr_desc, type, table->hdim, table->vdim,
+			  hpix1, hend, vpix0, vpix1 - 1,
+			  min, max, &s, &ssq, &np) ) return (FALSE);
+    }
+    /*  Apply data scaling to the results  */
+    *min = *min * scale + offset;
+    *max = *max * scale + offset;
+    *sumsq = scale * scale * ssq + 2.0 * scale * offset * s +
+	(double) np * offset * offset;
+    *mean = scale * s / (double) np + offset;
+    *sum = scale * s + (double) np * offset;
+    *stddev = sqrt (*sumsq / (double) np - *mean * *mean);
+    *npoints = np;
+    return (TRUE);
+}   /*  End Function viewimg_statistics_find  */
+
+/*EXPERIMENTAL_FUNCTION*/
+void viewimg_statistics_discard (ViewableImage vimage)
+/*  [SUMMARY] Discard the statistics table for a viewable image.
+    [PURPOSE] This routine will discard the table of tile sums built by
+    [<viewimg_statistics_find>] for a viewable image, if any. It is rebuilt on
+    the next query.
+    <vimage> The viewable image.
+    [RETURNS] Nothing.
+*/
+{
+    StatsTable table, prev;
+
+    for (table = first_table, prev = NULL; table != NULL;
+	 prev = table, table = table->next)
+    {
+	if (table->vimage != vimage) continue;
+	if (prev == NULL) first_table = table->next;
+	else prev->next = table->next;
+	destroy_table (table);
+	return;
+    }
+}   /*  End Function viewimg_statistics_discard  */
+
+
+/*  Private functions follow  */
+
+static StatsTable get_table (ViewableImage vimage)
+/*  [SUMMARY] Get the statistics table for a viewable image.
+    [PURPOSE] This routine will find the statistics table for a viewable
+    image, building it if needed.
+    <vimage> The viewable image.
+    [RETURNS] The table on success, else NULL.
+*/
+{
+    flag truecolour;
+    unsigned int hdim, vdim, elem_index, type, level, lhlen, lvlen;
+    unsigned int htile, vtile, hpix, vpix, hlen, vlen, row_len, index, cell;
+    unsigned int hlength, vlength, count, plhlen, plvlen, child;
+    unsigned long np;
+    double min, max, mean, stddev, s, ssq;
+    char *slice;
+    StatsTable table;
+    array_desc *arr_desc;
+    packet_desc *pack_desc;
+    uaddr *hoffsets, *voffsets;
+    static char function_name[] = "__viewimg_statistics_get_table";
+
+    viewimg_get_attributes (vimage,
+			    VIEWIMG_VATT_TRUECOLOUR, &truecolour,
+			    VIEWIMG_VATT_END);
+    if (truecolour)
+    {
+	fprintf (stderr, "%s: TrueColour images not supported\n",
+		 function_name);
+	return (NULL);
+    }
+    viewimg_get_attributes (vimage,
+			    VIEWIMG_VATT_ARRAY_DESC, &arr_desc,
+			    VIEWIMG_VATT_SLICE, &slice,
+			    VIEWIMG_VATT_HDIM, &hdim,
+			    VIEWIMG_VATT_VDIM, &vdim,
+			    VIEWIMG_VATT_PSEUDO_INDEX, &elem_index,
+			    VIEWIMG_VATT_END);
+    pack_desc = arr_desc->packet;
+    slice += ds_get_element_offset (pack_desc, elem_index);
+    for (table = first_table; table != NULL; table = table->next)
+    {
+	if (table->vimage != vimage) continue;
+	if ( (table->arr_desc == arr_desc) && (table->slice == slice) &&
+	     (table->hdim == hdim) && (table->vdim == vdim) &&
+	     (table->elem_index == elem_index) ) return (table);
+	/*  Stale table  */
+	viewimg_statistics_discard (vimage);
+	break;
+    }
+    /*  Build a new table  */
+    if ( ( table = (StatsTable) m_alloc (sizeof *table) ) == NULL )
+    {
+	m_error_notify (function_name, "statistics table");
+	return (NULL);
+    }
+    m_clear ( (char *) table, sizeof *table );
+    table->vimage = vimage;
+    table->arr_desc = arr_desc;
+    table->slice = slice;
+    table->hdim = hdim;
+    table->vdim = vdim;
+    table->elem_index = elem_index;
+    hlength = arr_desc->dimensions[hdim]->length;
+    vlength = arr_desc->dimensions[vdim]->length;
+    table->num_htiles = (hlength + TILE_SIZE - 1) / TILE_SIZE;
+    table->num_vtiles = (vlength + TILE_SIZE - 1) / TILE_SIZE;
+    row_len = table->num_htiles + 1;
+    count = row_len * (table->num_vtiles + 1);
+    /*  Find the number of pyramid levels  */
+    for (table->num_levels = 1, lhlen = table->num_htiles,
+	     lvlen = table->num_vtiles; (lhlen > 1) || (lvlen > 1);
+	 ++table->num_levels, lhlen = (lhlen + 1) / 2,
+	     lvlen = (lvlen + 1) / 2);
+    if ( ( ( table->sum = (double *) m_alloc (sizeof *table->sum * count) )
+	   == NULL ) ||
+	 ( ( table->sumsq = (double *) m_alloc (sizeof *table->sumsq * count) )
+	   == NULL ) ||
+	 ( ( table->npoints = (double *)
+	     m_alloc (sizeof *table->npoints * count) ) == NULL ) ||
+	 ( ( table->minima = (double **)
+	     m_alloc (sizeof *table->minima * table->num_levels) ) == NULL ) ||
+	 ( ( table->maxima = (double **)
+	     m_alloc (sizeof *table->maxima * table->num_levels) ) == NULL ) )
+    {
+	m_error_notify (function_name, "statistics table");
+	destroy_table (table);
+	return (NULL);
+    }
+    m_clear ( (char *) table->minima,
+	      sizeof *table->minima * table->num_levels );
+    m_clear ( (char *) table->maxima,
+	      sizeof *table->maxima * table->num_levels );
+    for (level = 0, lhlen = table->num_htiles, lvlen = table->num_vtiles;
+	 level < table->num_levels;
+	 ++level, lhlen = (lhlen + 1) / 2, lvlen = (lvlen + 1) / 2)
+    {
+	if ( ( ( table->minima[level] = (double *)
+		 m_alloc (sizeof **table->minima * lhlen * lvlen) ) == NULL ) ||
+	     ( ( table->maxima[level] = (double *)
+		 m_alloc (sizeof **table->maxima * lhlen * lvlen) ) == NULL ) )
+	{
+	    m_error_notify (function_name, "statistics pyramid");
+	    destroy_table (table);
+	    return (NULL);
+	}
+    }
+    /*  Compute the tile statistics and the summed-area tables  */
+    hoffsets = arr_desc->offsets[hdim];
+    voffsets = arr_desc->offsets[vdim];
+    type = pack_desc->element_types[elem_index];
+    for (htile = 0; htile < row_len; ++htile)
+    {
+	table->sum[htile] = 0.0;
+	table->sumsq[htile] = 0.0;
+	table->npoints[htile] = 0.0;
+    }
+    for (vtile = 0; vtile < table->num_vtiles; ++vtile)
+    {
+	vpix = vtile * TILE_SIZE;
+	vlen = (vpix + TILE_SIZE > vlength) ? vlength - vpix : TILE_SIZE;
+	index = (vtile + 1) * row_len;
+	table->sum[index] = 0.0;
+	table->sumsq[index] = 0.0;
+	table->npoints[index] = 0.0;
+	for (htile = 0; htile < table->num_htiles; ++htile)
+	{
+	    hpix = htile * TILE_SIZE;
+	    hlen = (hpix + TILE_SIZE > hlength) ? hlength - hpix : TILE_SIZE;
+	    min = TOOBIG;
+	    max = -TOOBIG;
+	    if ( !ds_find_2D_stats (slice, vlen, voffsets + vpix,
+				    hlen, hoffsets + hpix, type,
+				    CONV_CtoR_REAL, &min, &max, &mean, &stddev,
+				    &s, &ssq, &np) )
+	    {
+		destroy_table (table);
+		return (NULL);
+	    }
+	    cell = vtile * table->num_htiles + htile;
+	    table->minima[0][cell] = min;
+	    table->maxima[0][cell] = max;
+	    index = (vtile + 1) * row_len + htile + 1;
+	    table->sum[index] = s + table->sum[index - row_len] +
+		table->sum[index - 1] - table->sum[index - row_len - 1];
+	    table->sumsq[index] = ssq + table->sumsq[index - row_len] +
+		table->sumsq[index - 1] - table->sumsq[index - row_len - 1];
+	    table->npoints[index] = (double) np +
+		table->npoints[index - row_len] + table->npoints[index - 1] -
+		table->npoints[index - row_len - 1];
+	}
+    }
+    /*  Reduce the minima and maxima  */
+    for (level = 1, plhlen = table->num_htiles, plvlen = table->num_vtiles;
+	 level < table->num_levels;
+	 ++level, plhlen = lhlen, plvlen = lvlen)
+    {
+	lhlen = (plhlen + 1) / 2;
+	lvlen = (plvlen + 1) / 2;
+	for (vtile = 0; vtile < lvlen; ++vtile)
+	    for (htile = 0; htile < lhlen; ++htile)
+	{
+	    min = TOOBIG;
+	    max = -TOOBIG;
+	    for (count = 0; count < 4; ++count)
+	    {
+		hpix = htile * 2 + (count & 1);
+		vpix = vtile * 2 + (count >> 1);
+		if ( (hpix >= plhlen) || (vpix >= plvlen) ) continue;
+		child = vpix * plhlen + hpix;
+		if (table->minima[level - 1][child] < min)
+		    min = table->minima[level - 1][child];
+		if (table->maxima[level - 1][child] > max)
+		    max = table->maxima[level - 1][child];
+	    }
+	    table->minima[level][vtile * lhlen + htile] = min;
+	    table->maxima[level][vtile * lhlen + htile] = max;
+	}
+    }
+    table->next = first_table;
+    first_table = table;
+    return (table);
+}   /*  End Function get_table  */
+
+static void destroy_table (StatsTable table)
+/*  [SUMMARY] Destroy a statistics table.
+    <table> The table. This must not be in the list of tables.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int level;
+
+    if (table->sum != NULL) m_free ( (char *) table->sum );
+    if (table->sumsq != NULL) m_free ( (char *) table->sumsq );
+    if (table->npoints != NULL) m_free ( (char *) table->npoints );
+    for (level = 0; level < table->num_levels; ++level)
+    {
+	if ( (table->minima != NULL) && (table->minima[level] != NULL) )
+	{
+	    m_free ( (char *) table->minima[level] );
+	}
+	if ( (table->maxima != NULL) && (table->maxima[level] != NULL) )
+	{
+	    m_free ( (char *) table->maxima[level] );
+	}
+    }
+    if (table->minima != NULL) m_free ( (char *) table->minima );
+    if (table->maxima != NULL) m_free ( (char *) table->maxima );
+    m_free ( (char *) table );
+}   /*  End Function destroy_table  */
+
+static void query_extremes (StatsTable table, unsigned int level,
+			    unsigned int hcell, unsigned int vcell,
+			    unsigned int htile0, unsigned int htile1,
+			    unsigned int vtile0, unsigned int vtile1,
+			    double *min, double *max)
+/*  [SUMMARY] Find the extremes of a block of tiles from the pyramid.
+    <table> The statistics table.
+    <level> The pyramid level of the cell.
+    <hcell> The horizontal index of the cell in the level.
+    <vcell> The vertical index of the cell in the level.
+    <htile0> The first horizontal tile in the block.
+    <htile1> The last horizontal tile in the block.
+    <vtile0> The first vertical tile in the block.
+    <vtile1> The last vertical tile in the block.
+    <min> The minimum is updated here.
+    <max> The maximum is updated here.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int lo_h, hi_h, lo_v, hi_v, lhlen, lvlen;
+    double val;
+
+    lhlen = ( (table->num_htiles - 1) >> level ) + 1;
+    lvlen = ( (table->num_vtiles - 1) >> level ) + 1;
+    if ( (hcell >= lhlen) || (vcell >= lvlen) ) return;
+    lo_h = hcell << level;
+    hi_h = ( (hcell + 1) << level ) - 1;
+    if (hi_h >= table->num_htiles) hi_h = table->num_htiles - 1;
+    lo_v = vcell << level;
+    hi_v = ( (vcell + 1) << level ) - 1;
+    if (hi_v >= table->num_vtiles) hi_v = table->num_vtiles - 1;
+    if ( (hi_h < htile0) || (lo_h > htile1) || (hi_v < vtile0) ||
+	 (lo_v > vtile1) ) return;
+    if ( (lo_h >= htile0) && (hi_h <= htile1) && (lo_v >= vtile0) &&
+	 (hi_v <= vtile1) )
+    {
+	/*  Cell is wholly inside the block  */
+	if ( ( val = table->minima[level][vcell * lhlen + hcell] ) < *min )
+	    *min = val;
+	if ( ( val = table->maxima[level][vcell * lhlen + hcell] ) > *max )
+	    *max = val;
+	return;
+    }
+    /*  Cell straddles the block edge: descend (level 0 cells cannot)  */
+    query_extremes (table, level - 1, hcell * 2, vcell * 2,
+		    htile0, htile1, vtile0, vtile1, min, max);
+    query_extremes (table, level - 1, hcell * 2 + 1, vcell * 2,
+		    htile0, htile1, vtile0, vtile1, min, max);
+    query_extremes (table, level - 1, hcell * 2, vcell * 2 + 1,
+		    htile0, htile1, vtile0, vtile1, min, max);
+    query_extremes (table, level - 1, hcell * 2 + 1, vcell * 2 + 1,
+		    htile0, htile1, vtile0, vtile1, min, max);
+}   /*  End Function query_extremes  */
+
+static flag add_region (CONST char *array, array_desc *arr_desc,
+			unsigned int type, unsigned int hdim,
+			unsigned int vdim,
+			unsigned int hstart, unsigned int hend,
+			unsigned int vstart, unsigned int vend,
+			double *min, double *max, double *sum, double *sumsq,
+			unsigned long *npoints)
+/*  [SUMMARY] Add the statistics of a region of an image.
+    <array> The start of the image data.
+    <arr_desc> The array descriptor.
+    <type> The type of the data.
+    <hdim> The horizontal dimension index.
+    <vdim> The vertical dimension index.
+    <hstart> The first horizontal pixel.
+    <hend> The last horizontal pixel.
+    <vstart> The first vertical pixel.
+    <vend> The last vertical pixel.
+    <min> The minimum is updated here.
+    <max> The maximum is updated here.
+    <sum> The sum is updated here.
+    <sumsq> The sum of squares is updated here.
+    <npoints> The number of points is updated here.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    unsigned long np;
+    double mean, stddev, s, ssq;
+
+    if ( !ds_find_2D_stats (array, vend - vstart + 1,
+			    arr_desc->offsets[vdim] + vstart,
+			    hend - hstart + 1,
+			    arr_desc->offsets[hdim] + hstart,
+			    type, CONV_CtoR_REAL,
+			    min, max, &mean, &stddev, &s, &ssq, &np) )
+	return (FALSE);
+    *sum += s;
+    *sumsq += ssq;
+    *npoints += np;
+    return (TRUE);
+}   /*  End Function add_region  */
@@ -71,6 +71,7 @@
 #include <math.h>
 #include <varargs.h>
 #include <sys/wait.h>
+#include <sys/time.h>
 #include <signal.h>
 #include <X11/Xos.h>
 #include <X11/IntrinsicP.h>
@@ -127,6 +128,14 @@ STATIC_FUNCTION (void refresh_func,
 		  flag cmap_resize, void **info, PostScriptPage pspage) );
 STATIC_FUNCTION (void set_limits_cbk, (Widget w, XtPointer client_data,
 				       XtPointer call_data) );
+STATIC_FUNCTION (int step_frame,
+		 (AnimateControlWidget top, int frame_number, int *direction) );
+STATIC_FUNCTION (void update_rate,
+		 (AnimateControlWidget top, struct timeval *now) );
+STATIC_FUNCTION (void start_precompute, (AnimateControlWidget top) );
+STATIC_FUNCTION (Boolean precompute_work, (XtPointer client_data) );
+STATIC_FUNCTION (long time_diff_us, (struct timeval *a, struct timeval *b) );
+STATIC_FUNCTION (void add_time_us, (struct timeval *tv, long us) );
 
 
 #define MODE_FORWARD_SPIN 0
@@ -152,6 +161,10 @@ static XtResource AnimateControlResources[] =
      offset (endFrame), XtRImmediate, (XtPointer) 0},
     {XkwNnewFrameCallback, XtCCallback, XtRCallback, sizeof (caddr_t),
      offset (newFrameCallback), XtRCallback, (caddr_t) NULL},
+    {XkwNprecomputeCallback, XtCCallback, XtRCallback, sizeof (caddr_t),
+     offset (precomputeCallback), XtRCallback, (caddr_t) NULL},
+    {XkwNprecomputeFrames, XkwCPrecomputeFrames, XtRInt, sizeof (int),
+     offset (precomputeFrames), XtRImmediate, (XtPointer) 0},
 };
 
 #undef TheOffset
@@ -231,6 +244,10 @@ static void AnimateControl__Initialise (Widget Request, Widget New)
     new->animateControl.spin_mode = MODE_FORWARD_SPIN;
     new->animateControl.direction = 1;
     new->animateControl.position_wc = NULL;
+    new->animateControl.frames_shown = 0;
+    new->animateControl.frames_dropped = 0;
+    new->animateControl.num_precomputed = 0;
+    new->animateControl.precompute_active = FALSE;
     form = XtVaCreateManagedWidget ("form", formWidgetClass, New,
 				    XtNborderWidth, 0,
 				    NULL);
@@ -346,6 +363,13 @@ static void AnimateControl__Initialise (Widget Request, Widget New)
 				 NULL);
     new->animateControl.end_frame_sld = w;
     XtAddCallback (w, XkwNvalueChangeCallback, set_limits_cbk,(XtPointer) new);
+    w = XtVaCreateManagedWidget ("rateLabel", labelWidgetClass, form,
+				 XtNlabel,
+				 "Frame rate:                            ",
+				 XtNborderWidth, 0,
+				 XtNfromVert, w,
+				 NULL);
+    new->animateControl.rate_lbl = w;
 }   /*  End Function Initialise  */
 
 static void cnv_realise_cbk (w, client_data, call_data)
@@ -456,6 +480,7 @@ XtPointer call_data;
 {
     AnimateControlWidget top = (AnimateControlWidget) client_data;
     XtAppContext app_context;
+    static struct timezone tz = {0, 0};
 
     if (top->animateControl.running_movie)
     {
@@ -468,6 +493,15 @@ XtPointer call_data;
 	return;
     }
     top->animateControl.running_movie = TRUE;
+    (void) gettimeofday (&top->animateControl.deadline, &tz);
+    m_copy ( (char *) &top->animateControl.stats_start,
+	     (char *) &top->animateControl.deadline,
+	     sizeof top->animateControl.stats_start );
+    add_time_us (&top->animateControl.deadline,
+		 (long) top->animateControl.interval_ms * 1000);
+    top->animateControl.frames_shown = 0;
+    top->animateControl.frames_dropped = 0;
+    start_precompute (top);
     app_context = XtWidgetToApplicationContext (w);
     XtAppAddTimeOut (app_context,
 		     (unsigned long) top->animateControl.interval_ms + 1,
@@ -567,12 +601,18 @@ XtPointer call_data;
 }   /*  End Function store_cbk   */
 
 static void timer_cbk (XtPointer client_data, XtIntervalId *id)
-/*  This is the interval timer callback.
+/*  This is the interval timer callback. Frames are scheduled against a
+    deadline rather than a fixed delay, so that the time taken to draw a frame
+    does not slow the movie. If the display falls more than a frame interval
+    behind, frames are dropped to catch up.
 */
 {
-    int frame_number, jump;
+    int frame_number, count, num_late;
+    long interval_us, late_us;
+    struct timeval now;
     AnimateControlWidget top = (AnimateControlWidget) client_data;
     XtAppContext app_context;
+    static struct timezone tz = {0, 0};
 
     if (!top->animateControl.running_movie) return;
     switch (top->animateControl.spin_mode)
@@ -584,35 +624,21 @@ static void timer_cbk (XtPointer client_data, XtIntervalId *id)
 	top->animateControl.direction = -1;
 	break;
     }
-    jump = top->animateControl.inc_factor * top->animateControl.direction;
-    frame_number = top->animateControl.currentFrame + jump;
-    if (frame_number < top->animateControl.startFrame)
+    interval_us = (long) top->animateControl.interval_ms * 1000;
+    (void) gettimeofday (&now, &tz);
+    late_us = time_diff_us (&now, &top->animateControl.deadline);
+    num_late = 0;
+    if ( (interval_us > 0) && (late_us >= interval_us) )
     {
-	switch (top->animateControl.spin_mode)
-	{
-	  case MODE_FORWARD_SPIN:
-	  case MODE_REVERSE_SPIN:
-	    frame_number = top->animateControl.endFrame;
-	    break;
-	  case MODE_ROCKnROLL:
-	    frame_number = top->animateControl.startFrame;
-	    top->animateControl.direction = -top->animateControl.direction;
-	    break;
-	}
+	num_late = late_us / interval_us;
+	add_time_us (&top->animateControl.deadline, num_late * interval_us);
+	top->animateControl.frames_dropped += num_late;
     }
-    else if (frame_number > top->animateControl.endFrame)
+    frame_number = top->animateControl.currentFrame;
+    for (count = 0; count <= num_late; ++count)
     {
-	switch (top->animateControl.spin_mode)
-	{
-	  case MODE_FORWARD_SPIN:
-	  case MODE_REVERSE_SPIN:
-	    frame_number = top->animateControl.startFrame;
-	    break;
-	  case MODE_ROCKnROLL:
-	    frame_number = top->animateControl.endFrame;
-	    top->animateControl.direction = -top->animateControl.direction;
-	    break;
-	}
+	frame_number = step_frame (top, frame_number,
+				   &top->animateControl.direction);
     }
     top->animateControl.currentFrame = frame_number;
     /*  Prevent updating the current frame at an excessive rate  */
@@ -628,10 +654,17 @@ static void timer_cbk (XtPointer client_data, XtIntervalId *id)
     }
     XtCallCallbacks ( (Widget) top, XkwNnewFrameCallback,
 		     (XtPointer) &frame_number );
+    ++top->animateControl.frames_shown;
+    update_rate (top, &now);
+    /*  Schedule the next frame relative to when this one was due  */
+    add_time_us (&top->animateControl.deadline, interval_us);
+    (void) gettimeofday (&now, &tz);
+    late_us = time_diff_us (&top->animateControl.deadline, &now);
+    if (late_us < 1000) late_us = 1000;
     app_context = XtWidgetToApplicationContext ( (Widget) top );
-    XtAppAddTimeOut (app_context,
-		     (unsigned long) top->animateControl.interval_ms + 1,
+    XtAppAddTimeOut (app_context, (unsigned long) late_us / 1000,
 		     timer_cbk, (XtPointer) top);
+    start_precompute (top);
 }   /*  End Function timer_cbk  */
 
 static void goto_frame_cbk (w, client_data, call_data)
@@ -790,3 +823,143 @@ XtPointer call_data;
 			   CANVAS_ATT_END);
     (void) canvas_resize (top->animateControl.position_wc, NULL, TRUE);
 }   /*  End Function set_limits_cbk   */
+
+static int step_frame (AnimateControlWidget top, int frame_number,
+		       int *direction)
+/*  [SUMMARY] Compute the frame following a frame.
+    <top> The AnimateControl widget.
+    <frame_number> The current frame number.
+    <direction> The direction of the movie. This is reversed when a
+    Rock & Roll movie reaches either end.
+    [RETURNS] The next frame number.
+*/
+{
+    frame_number += top->animateControl.inc_factor * *direction;
+    if (frame_number < top->animateControl.startFrame)
+    {
+	switch (top->animateControl.spin_mode)
+	{
+	  case MODE_FORWARD_SPIN:
+	  case MODE_REVERSE_SPIN:
+	    frame_number = top->animateControl.endFrame;
+	    break;
+	  case MODE_ROCKnROLL:
+	    frame_number = top->animateControl.startFrame;
+	    *direction = -*direction;
+	    break;
+	}
+    }
+    else if (frame_number > top->animateControl.endFrame)
+    {
+	switch (top->animateControl.spin_mode)
+	{
+	  case MODE_FORWARD_SPIN:
+	  case MODE_REVERSE_SPIN:
+	    frame_number = top->animateControl.startFrame;
+	    break;
+	  case MODE_ROCKnROLL:
+	    frame_number = top->animateControl.endFrame;
+	    *direction = -*direction;
+	    break;
+	}
+    }
+    return (frame_number);
+}   /*  End Function step_frame  */
+
+static void update_rate (AnimateControlWidget top, struct timeval *now)
+/*  [SUMMARY] Show the achieved frame rate and the number of dropped frames.
+    [PURPOSE] The label is updated at most once per second.
+    <top> The AnimateControl widget.
+    <now> The current time.
+    [RETURNS] Nothing.
+*/
+{
+    long elapsed_us;
+    char txt[STRING_LENGTH];
+
+    elapsed_us = time_diff_us (now, &top->animateControl.stats_start);
+    if (elapsed_us < 1000000) return;
+    (void) sprintf (txt, "Frame rate: %.1f fps  Dropped: %d",
+		    (double) top->animateControl.frames_shown * 1e6 /
+		    (double) elapsed_us,
+		    top->animateControl.frames_dropped);
+    XtVaSetValues (top->animateControl.rate_lbl,
+		   XtNlabel, txt,
+		   NULL);
+    m_copy ( (char *) &top->animateControl.stats_start, (char *) now,
+	     sizeof *now );
+    top->animateControl.frames_shown = 0;
+    top->animateControl.frames_dropped = 0;
+}   /*  End Function update_rate  */
+
+static void start_precompute (AnimateControlWidget top)
+/*  [SUMMARY] Start precomputing the frames which will be shown next.
+    [PURPOSE] The frames are precomputed by an Xt work procedure, so that they
+    are only computed when the application is idle.
+    <top> The AnimateControl widget.
+    [RETURNS] Nothing.
+*/
+{
+    XtAppContext app_context;
+
+    if (top->animateControl.precomputeFrames < 1) return;
+    if (XtHasCallbacks ( (Widget) top, XkwNprecomputeCallback ) !=
+	XtCallbackHasSome) return;
+    top->animateControl.num_precomputed = 0;
+    if (top->animateControl.precompute_active) return;
+    app_context = XtWidgetToApplicationContext ( (Widget) top );
+    (void) XtAppAddWorkProc (app_context, precompute_work,
+			     (XtPointer) top);
+    top->animateControl.precompute_active = TRUE;
+}   /*  End Function start_precompute  */
+
+static Boolean precompute_work (XtPointer client_data)
+/*  This is the work procedure which precomputes upcoming frames, one frame per
+    call.
+*/
+{
+    int frame_number, direction, count;
+    AnimateControlWidget top = (AnimateControlWidget) client_data;
+
+    if ( !top->animateControl.running_movie ||
+	 (top->animateControl.num_precomputed >=
+	  top->animateControl.precomputeFrames) )
+    {
+	top->animateControl.precompute_active = FALSE;
+	return (True);
+    }
+    frame_number = top->animateControl.currentFrame;
+    direction = top->animateControl.direction;
+    for (count = 0; count <= top->animateControl.num_precomputed; ++count)
+    {
+	frame_number = step_frame (top, frame_number, &direction);
+    }
+    ++top->animateControl.num_precomputed;
+    XtCallCallbacks ( (Widget) top, XkwNprecomputeCallback,
+		     (XtPointer) &frame_number );
+    return (False);
+}   /*  End Function precompute_work  */
+
+static long time_diff_us (struct timeval *a, struct timeval *b)
+/*  [SUMMARY] Compute the difference between two times.
+    [RETURNS] The time <<a>> - <<b>> in microseconds.
+*/
+{
+    return ( (a->tv_sec - b->tv_sec) * 1000000 + (a->tv_usec - b->tv_usec) );
+}   /*  End Function time_diff_us  */
+
+static void add_time_us (struct timeval *tv, long us)
+/*  [SUMMARY] Add an interval to a time.
+    <tv> The time to modify.
+    <us> The interval in microseconds.
+    [RETURNS] Nothing.
+*/
+{
+    tv->tv_sec += us / 1000000;
+    tv->tv_usec += us % 1000000;
+    if (tv->tv_usec >= 1000000)
+    {
+	++tv->tv_sec;
+	tv->tv_usec -= 1000000;
+    }
+}   /*  End Function add_time_us  */
@@ -323,6 +323,7 @@ static void Dataclip__Initialise (Widget Request, Widget New)
 	m_abort (function_name, "array of maxima");
     }
     new->dataclip.num_regions = 0;
+    new->dataclip.histogram = NULL;
     new->dataclip.histogram_array = NULL;
     new->dataclip.hist_arr_length = 0;
     new->dataclip.hist_buf_length = 0;
@@ -575,6 +576,11 @@ static Boolean Dataclip__SetValues (Widget Current, Widget Request, Widget New)
 	new->dataclip.data_min = TOOBIG;
 	new->dataclip.data_max = -TOOBIG;
 	new->dataclip.hist_arr_length = 0;
+	if (new->dataclip.histogram != NULL)
+	{
+	    iarray_histogram_destroy (new->dataclip.histogram);
+	    new->dataclip.histogram = NULL;
+	}
 	/*  Force computation and display of histogram if new data available,
 	    else clear canvas  */
 	if (new->dataclip.popped_up)
@@ -843,12 +849,14 @@ static void size_control_func (KWorldCanvas canvas, int width, int height,
     The routine should return nothing.
 */
 {
-    flag verbose;
+    flag verbose, fixed_range;
     int array_len = width / 2;
     unsigned int count;
     unsigned long hpeak, hmode;
     double frac;
     double min, max, scale, offset;
+    double bin_width, binned_min, binned_max;
+    KHistogram histogram;
     DataclipWidget w = (DataclipWidget) *info;
     char txt[STRING_LENGTH];
     unsigned long *hist_array;
@@ -858,14 +866,26 @@ static void size_control_func (KWorldCanvas canvas, int width, int height,
     if (w->dataclip.array == NULL) return;
     if (w->dataclip.data_min >= TOOBIG)
     {
-	/*  Recompute the minimum and maximum  */
-	if ( !iarray_min_max (w->dataclip.array, CONV1_REAL, &min, &max) )
+	/*  Build the histogram, which also yields the minimum and maximum  */
+	if (w->dataclip.histogram != NULL)
+	{
+	    iarray_histogram_destroy (w->dataclip.histogram);
+	}
+	if ( ( w->dataclip.histogram =
+	       iarray_histogram_create (w->dataclip.array, CONV1_REAL, 1) )
+	     == NULL )
 	{
 	    fprintf (stderr, "Error getting image range\n");
 	    return;
 	}
+	iarray_histogram_get_attributes (w->dataclip.histogram,
+					 IARRAY_HIST_ATT_MIN, &min,
+					 IARRAY_HIST_ATT_MAX, &max,
+					 IARRAY_HIST_ATT_END);
 	if (min >= max)
 	{
+	    iarray_histogram_destroy (w->dataclip.histogram);
+	    w->dataclip.histogram = NULL;
 	    w->dataclip.array = NULL;
 	    return;
 	}
@@ -884,6 +904,40 @@ static void size_control_func (KWorldCanvas canvas, int width, int height,
 	win_scale->right_x = w->dataclip.data_max;
     }
     if (array_len == w->dataclip.hist_arr_length) return;
+    histogram = w->dataclip.histogram;
+    iarray_histogram_get_attributes (histogram,
+				     IARRAY_HIST_ATT_FIXED_RANGE, &fixed_range,
+				     IARRAY_HIST_ATT_BINNED_MIN, &binned_min,
+				     IARRAY_HIST_ATT_BINNED_MAX, &binned_max,
+				     IARRAY_HIST_ATT_END);
+    if ( fixed_range && ( (win_scale->left_x < binned_min) ||
+			  (win_scale->right_x > binned_max) ) )
+    {
+	/*  Zoomed out of a refined histogram: bin the full range again  */
+	iarray_histogram_destroy (histogram);
+	if ( ( histogram = iarray_histogram_create (w->dataclip.array,
+						    CONV1_REAL, 1) ) == NULL )
+	{
+	    m_abort (function_name, "histogram");
+	}
+	w->dataclip.histogram = histogram;
+    }
+    iarray_histogram_get_attributes (histogram,
+				     IARRAY_HIST_ATT_BIN_WIDTH, &bin_width,
+				     IARRAY_HIST_ATT_END);
+    if ( (array_len > 1) &&
+	 (bin_width > (win_scale->right_x - win_scale->left_x) /
+	  (double) (array_len - 1) ) )
+    {
+	/*  Zoomed in beyond the resolution of the histogram  */
+	if (verbose) fprintf (stderr, "Refining histogram\n");
+	if ( !iarray_histogram_refine (histogram, w->dataclip.array,
+				       win_scale->left_x, win_scale->right_x) )
+	{
+	    fprintf (stderr, "Error computing histogram\n");
+	    a_prog_bug (function_name);
+	}
+    }
     if ( ( hist_array = (unsigned long *)
 	   m_alloc_scratch (sizeof *hist_array * array_len, function_name) )
 	 == NULL )
@@ -912,10 +966,9 @@ static void size_control_func (KWorldCanvas canvas, int width, int height,
     w->dataclip.hist_arr_length = array_len;
     hpeak = 0;
     hmode = 0;
-    if ( !iarray_compute_histogram (w->dataclip.array,
-				    win_scale->conv_type,
-				    win_scale->left_x, win_scale->right_x,
-				    array_len, hist_array, &hpeak, &hmode) )
+    if ( !iarray_histogram_rebin (histogram,
+				  win_scale->left_x, win_scale->right_x,
+				  array_len, hist_array, &hpeak, &hmode) )
     {
 	fprintf (stderr, "Error computing histogram\n");
 	a_prog_bug (function_name);
@@ -978,6 +1031,11 @@ static void iarr_destroy_callback (iarray arr, DataclipWidget top)
 {
     top->dataclip.array = NULL;
     top->dataclip.iarr_destroy_callback = NULL;
+    if (top->dataclip.histogram != NULL)
+    {
+	iarray_histogram_destroy (top->dataclip.histogram);
+	top->dataclip.histogram = NULL;
+    }
     if (top->dataclip.autoPopdown) XtPopdown ( (Widget) top );
 }   /*  End Function iarr_destroy_callback  */
 
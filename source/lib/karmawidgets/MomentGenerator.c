@@ -385,132 +385,47 @@ static flag compute_moments (iarray mom0, iarray mom1, iarray cube,
     [RETURNS] TRUE on success, else FALSE.
 */
 {
-    int x, y, z, xlen, ylen, zlen;
-    float val, weighted_sum, sum, half_mom0_val, index;
-    float mom0_val = 0;  /*  Initialised to keep compiler happy  */
-    double velocity;
-    /*char txt[STRING_LENGTH];*/
-    /*extern char module_name[STRING_LENGTH + 1];*/
-    /*static char function_name[] = "MomentGeneratorWidget::compute_moments";*/
-
-    xlen = iarray_dim_length (cube, 2);
-    ylen = iarray_dim_length (cube, 1);
+    flag ok;
+    unsigned int count, zlen;
+    double min, max;
+    double *velocities = NULL;
+    static char function_name[] = "MomentGeneratorWidget::compute_moments";
+
     zlen = iarray_dim_length (cube, 0);
-    *mom0_min = TOOBIG;
-    *mom0_max = -TOOBIG;
-#ifdef dummy
-    /*  Append a bit of history  */
-    sprintf (txt, "%s: 1st moment map  low clip %e  high clip %e",
-	     module_name, lower_clip);
-    iarray_append_history_string (mom1, txt, TRUE);
-    sprintf (txt, "%s: sum_clip: %e  algorithm: %s",
-	     module_name, sum_clip,
-	     mom1_algorithm_alternatives[mom1_algorithm]);
-    iarray_append_history_string (mom1, txt, TRUE);
-#endif
-    /*  Loop through image pixels  */
-    for (y = 0; y < ylen; ++y) for (x = 0; x < xlen; ++x)
+    if (cube_ap != NULL)
     {
-	switch (mom1_algorithm)
+	/*  Convert every channel to velocity once, not every pixel  */
+	if ( ( velocities = (double *) m_alloc (sizeof *velocities * zlen) )
+	     == NULL )
 	{
-	  case MOM1_ALGORITHM_WEIGHTED_MEAN:
-	    mom0_val = 0.0;
-	    weighted_sum = 0.0;
-	    for (z = 0; z < zlen; ++z)
-	    {
-		if ( ( val = F3 (cube, z, y, x) ) >= TOOBIG ) continue;
-		if (val < lower_clip) continue;
-		mom0_val += val;
-		weighted_sum += val * (float) z;
-	    }
-	    if (mom0_val < lower_clip)
-	    {
-		F2 (mom0, y, x) = TOOBIG;
-		F2 (mom1, y, x) = TOOBIG;
-	    }
-	    else
-	    {
-		F2 (mom0, y, x) = mom0_val;
-		if (mom0_val < sum_clip) F2 (mom1, y, x) = TOOBIG;
-		else
-		{
-		    z = (weighted_sum / mom0_val);
-		    if (z < 0) z = 0;
-		    else if (z > zlen - 1) z = zlen - 1;
-		    if (cube_ap == NULL)
-		    {
-			F2 (mom1, y, x) = iarray_get_coordinate (cube, 0, z);
-		    }
-		    else
-		    {
-			velocity = z;
-			wcs_astro_transform (cube_ap, 1,
-					     NULL, FALSE, NULL, FALSE,
-					     &velocity, FALSE,
-					     0, NULL, NULL);
-			F2 (mom1, y, x) = velocity;
-		    }
-		}
-	    }
-	    break;
-	  case MOM1_ALGORITHM_MEDIAN:
-	    /*  First compute 0th moment  */
-	    mom0_val = 0.0;
-	    for (z = 0; z < zlen; ++z)
-	    {
-		if ( ( val = F3 (cube, z, y, x) ) >= TOOBIG ) continue;
-		if (val < lower_clip) continue;
-		mom0_val += val;
-	    }
-	    if (mom0_val < lower_clip)
-	    {
-		F2 (mom0, y, x) = TOOBIG;
-		F2 (mom1, y, x) = TOOBIG;
-		continue;
-	    }
-	    else F2 (mom0, y, x) = mom0_val;
-	    /*  Now compute 1st moment  */
-	    if (mom0_val < sum_clip)
-	    {
-		F2 (mom1, y, x) = TOOBIG;
-		continue;
-	    }
-	    half_mom0_val = mom0_val * 0.5;
-	    sum = 0.0;
-	    index = -1.0;
-	    for (z = 0; z < zlen; ++z)
-	    {
-		if ( ( val = F3 (cube, z, y, x) ) >= TOOBIG ) continue;
-		if (val < lower_clip) continue;
-		sum += val;
-		if (sum >= half_mom0_val)
-		{
-		    index = (float) z + (half_mom0_val - sum + val) /val - 0.5;
-		    if (cube_ap == NULL)
-		    {
-			F2 (mom1, y, x) = iarray_get_coordinate (cube, 0,
-								 index);
-		    }
-		    else
-		    {
-			velocity = index;
-			wcs_astro_transform (cube_ap, 1,
-					     NULL, FALSE, NULL, FALSE,
-					     &velocity, FALSE,
-					     0, NULL, NULL);
-			F2 (mom1, y, x) = velocity;
-		    }
-		    break;
-		}
-	    }
-	    if (index < 0.0) F2 (mom1, y, x) = TOOBIG;
-	    break;
-	  default:
-	    break;
+	    m_error_notify (function_name, "velocity table");
+	    return (FALSE);
 	}
-	if (mom0_val < *mom0_min) *mom0_min = mom0_val;
-	if (mom0_val > *mom0_max) *mom0_max = mom0_val;
+	for (count = 0; count < zlen; ++count) velocities[count] = count;
+	wcs_astro_transform (cube_ap, zlen,
+			     NULL, FALSE, NULL, FALSE,
+			     velocities, FALSE,
+			     0, NULL, NULL);
+    }
+    switch (mom1_algorithm)
+    {
+      case MOM1_ALGORITHM_WEIGHTED_MEAN:
+	ok = iarray_compute_moments (cube, mom0, mom1, NULL, NULL, NULL,
+				     velocities, lower_clip, sum_clip);
+	break;
+      case MOM1_ALGORITHM_MEDIAN:
+	ok = iarray_compute_moments (cube, mom0, NULL, NULL, NULL, mom1,
+				     velocities, lower_clip, sum_clip);
+	break;
+      default:
+	ok = FALSE;
+	break;
     }
+    if (velocities != NULL) m_free ( (char *) velocities );
+    if (!ok) return (FALSE);
+    if ( !iarray_min_max (mom0, CONV1_REAL, &min, &max) ) return (FALSE);
+    *mom0_min = min;
+    *mom0_max = max;
     return (TRUE);
 }   /*  End Function compute_moments  */
 
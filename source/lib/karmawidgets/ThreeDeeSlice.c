@@ -124,6 +124,7 @@
 
 STATIC_FUNCTION (void ThreeDeeSlice__Initialise,
 		 (Widget request, Widget new) );
+STATIC_FUNCTION (void ThreeDeeSlice__Destroy, (Widget w) );
 STATIC_FUNCTION (Boolean ThreeDeeSlice__SetValues,
 		 (Widget current, Widget request, Widget new) );
 STATIC_FUNCTION (void realise_cbk, (Widget w, XtPointer client_data,
@@ -150,6 +151,9 @@ STATIC_FUNCTION (void move_cursor,
 		  struct XkwThreeDeeSliceCursor new_cursor) );
 STATIC_FUNCTION (void refresh_canvas,
 		 (KWorldCanvas canvas, double lx, double ly) );
+STATIC_FUNCTION (void schedule_refresh_flush, (ThreeDeeSliceWidget top) );
+STATIC_FUNCTION (void flush_refresh_cbk,
+		 (XtPointer client_data, XtIntervalId *id) );
 STATIC_FUNCTION (flag xy_pos_consumer,
 		 (ViewableImage vimage, double x, double y,
 		  void *value, unsigned int event_code,
@@ -179,6 +183,9 @@ STATIC_FUNCTION (flag dummy_pos_consumer,
 STATIC_FUNCTION (void free_data, (ThreeDeeSliceWidget top) );
 
 
+/*  Cursor motion refreshes are merged over this many milliseconds  */
+#define REFRESH_INTERVAL 20
+
 #define offset(field) XtOffsetOf(ThreeDeeSliceRec, threeDeeSlice.field)
 #define XkwRKcoord_3d "Kcoord_3d"
 
@@ -224,7 +231,7 @@ ThreeDeeSliceClassRec threeDeeSliceClassRec =
 	TRUE,                           /*  compress_exposure      */
 	TRUE,                           /*  compress_enterleave    */
 	TRUE,                           /*  visible_interest       */
-	NULL,                           /*  destroy                */
+	ThreeDeeSlice__Destroy,         /*  destroy                */
 	XtInheritResize,                /*  resize                 */
 	NULL,                           /*  expose                 */
 	(XtSetValuesFunc) ThreeDeeSlice__SetValues, /*  set_values */
@@ -297,6 +304,7 @@ static void ThreeDeeSlice__Initialise (Widget Request, Widget New)
     new->threeDeeSlice.z_mag = 1;
     new->threeDeeSlice.iarr_destroy_func = NULL;
     new->threeDeeSlice.ap = NULL;
+    new->threeDeeSlice.refresh_timer = 0;
     w = XtVaCreateManagedWidget ("slider", valueWidgetClass, New,
 				 XtNlabel, "X Magnification",
 				 XtNorientation, XtorientHorizontal,
@@ -368,6 +376,17 @@ static void ThreeDeeSlice__Initialise (Widget Request, Widget New)
     XtAddCallback (canvas, XkwNrealiseCallback, realise_cbk, (XtPointer) new);
 }   /*  End Function Initialise  */
 
+static void ThreeDeeSlice__Destroy (Widget W)
+{
+    ThreeDeeSliceWidget w = (ThreeDeeSliceWidget) W;
+
+    if (w->threeDeeSlice.refresh_timer != 0)
+    {
+	XtRemoveTimeOut (w->threeDeeSlice.refresh_timer);
+	w->threeDeeSlice.refresh_timer = 0;
+    }
+}   /*  End Function Destroy  */
+
 static Boolean ThreeDeeSlice__SetValues (Widget Current, Widget Request,
 					 Widget New)
 {
@@ -451,6 +470,10 @@ static void realise_cbk (Widget w, XtPointer client_data, XtPointer call_data)
     }
     kwin_register_position_event_func (top->threeDeeSlice.xy_pixcanvas,
 				       dummy_pos_consumer, top);
+    kwin_set_attributes (top->threeDeeSlice.xy_pixcanvas,
+			 KWIN_ATT_REFRESH_INTERVAL,
+			 (unsigned long) REFRESH_INTERVAL,
+			 KWIN_ATT_END);
     if ( ( top->threeDeeSlice.xz_pixcanvas =
 	   kwin_create_child (parent, 0, 0, 3, 3, TRUE) ) == NULL )
     {
@@ -458,6 +481,10 @@ static void realise_cbk (Widget w, XtPointer client_data, XtPointer call_data)
     }
     kwin_register_position_event_func (top->threeDeeSlice.xz_pixcanvas,
 				       dummy_pos_consumer, top);
+    kwin_set_attributes (top->threeDeeSlice.xz_pixcanvas,
+			 KWIN_ATT_REFRESH_INTERVAL,
+			 (unsigned long) REFRESH_INTERVAL,
+			 KWIN_ATT_END);
     if ( ( top->threeDeeSlice.zy_pixcanvas =
 	   kwin_create_child (parent, 0, 0, 3, 3, TRUE) ) == NULL )
     {
@@ -465,6 +492,10 @@ static void realise_cbk (Widget w, XtPointer client_data, XtPointer call_data)
     }
     kwin_register_position_event_func (top->threeDeeSlice.zy_pixcanvas,
 				       dummy_pos_consumer, top);
+    kwin_set_attributes (top->threeDeeSlice.zy_pixcanvas,
+			 KWIN_ATT_REFRESH_INTERVAL,
+			 (unsigned long) REFRESH_INTERVAL,
+			 KWIN_ATT_END);
     canvas_init_win_scale (&win_scale, K_WIN_SCALE_MAGIC_NUMBER);
     /*  Get saturation pixels  */
     if (XAllocNamedColor (XtDisplay (w), xcmap, "Black", &scrn_def,
@@ -824,11 +855,15 @@ static void move_cursor (ThreeDeeSliceWidget top,
     else
     {
 	/*  X index has changed, so we need a new ZY image  */
-	if ( !viewimg_make_active
-	     (top->threeDeeSlice.zy_frames[(long) new_cursor.pixel.x]) )
+	if ( !viewimg_set_active
+	     (top->threeDeeSlice.zy_frames[(long) new_cursor.pixel.x],
+	      FALSE) )
 	{
 	    fprintf (stderr, "Error making ViewableImage active\n");
 	}
+	/*  All frames are the same size, so no need to clear. This refresh is
+	    throttled, unlike the one from <viewimg_make_active>  */
+	kwin_refresh_if_visible (top->threeDeeSlice.zy_pixcanvas, FALSE);
     }
     if ( (long) old_cursor.pixel.y == (long) new_cursor.pixel.y )
     {
@@ -840,11 +875,15 @@ static void move_cursor (ThreeDeeSliceWidget top,
     else
     {
 	/*  Y index has changed, so we need a new XZ image  */
-	if ( !viewimg_make_active
-	     (top->threeDeeSlice.xz_frames[(long) new_cursor.pixel.y]) )
+	if ( !viewimg_set_active
+	     (top->threeDeeSlice.xz_frames[(long) new_cursor.pixel.y],
+	      FALSE) )
 	{
 	    fprintf (stderr, "Error making ViewableImage active\n");
 	}
+	/*  All frames are the same size, so no need to clear. This refresh is
+	    throttled, unlike the one from <viewimg_make_active>  */
+	kwin_refresh_if_visible (top->threeDeeSlice.xz_pixcanvas, FALSE);
     }
     if ( (long) old_cursor.pixel.z == (long) new_cursor.pixel.z )
     {
@@ -856,12 +895,17 @@ static void move_cursor (ThreeDeeSliceWidget top,
     else
     {
 	/*  Z index has changed, so we need a new XY image  */
-	if ( !viewimg_make_active
-	     (top->threeDeeSlice.xy_frames[(long) new_cursor.pixel.z]) )
+	if ( !viewimg_set_active
+	     (top->threeDeeSlice.xy_frames[(long) new_cursor.pixel.z],
+	      FALSE) )
 	{
 	    fprintf (stderr, "Error making ViewableImage active\n");
 	}
+	/*  All frames are the same size, so no need to clear. This refresh is
+	    throttled, unlike the one from <viewimg_make_active>  */
+	kwin_refresh_if_visible (top->threeDeeSlice.xy_pixcanvas, FALSE);
     }
+    schedule_refresh_flush (top);
 }   /*  End Function move_cursor  */
 
 static void refresh_canvas (KWorldCanvas canvas, double lx, double ly)
@@ -909,6 +953,48 @@ static void refresh_canvas (KWorldCanvas canvas, double lx, double ly)
     viewimg_partial_refresh (canvas, 2, areas);
 }   /*  End Function refresh_canvas  */
 
+static void schedule_refresh_flush (ThreeDeeSliceWidget top)
+/*  [PURPOSE] This routine will arrange for any refreshes which were queued
+    by the pixel canvases to be performed once the refresh interval has
+    elapsed.
+    <top> The ThreeDeeSlice widget.
+    [RETURNS] Nothing.
+*/
+{
+    flag xy_pending, xz_pending, zy_pending;
+
+    if (top->threeDeeSlice.refresh_timer != 0) return;
+    kwin_get_attributes (top->threeDeeSlice.xy_pixcanvas,
+			 KWIN_ATT_REFRESH_PENDING, &xy_pending,
+			 KWIN_ATT_END);
+    kwin_get_attributes (top->threeDeeSlice.xz_pixcanvas,
+			 KWIN_ATT_REFRESH_PENDING, &xz_pending,
+			 KWIN_ATT_END);
+    kwin_get_attributes (top->threeDeeSlice.zy_pixcanvas,
+			 KWIN_ATT_REFRESH_PENDING, &zy_pending,
+			 KWIN_ATT_END);
+    if (!xy_pending && !xz_pending && !zy_pending) return;
+    top->threeDeeSlice.refresh_timer =
+	XtAppAddTimeOut (XtWidgetToApplicationContext ( (Widget) top ),
+			 (unsigned long) REFRESH_INTERVAL, flush_refresh_cbk,
+			 (XtPointer) top);
+}   /*  End Function schedule_refresh_flush  */
+
+static void flush_refresh_cbk (XtPointer client_data, XtIntervalId *id)
+/*  [PURPOSE] This routine is called when the refresh flush timer expires.
+    <client_data> The ThreeDeeSlice widget.
+    <id> The timer ID.
+    [RETURNS] Nothing.
+*/
+{
+    ThreeDeeSliceWidget top = (ThreeDeeSliceWidget) client_data;
+
+    top->threeDeeSlice.refresh_timer = 0;
+    kwin_flush_refresh (top->threeDeeSlice.xy_pixcanvas);
+    kwin_flush_refresh (top->threeDeeSlice.xz_pixcanvas);
+    kwin_flush_refresh (top->threeDeeSlice.zy_pixcanvas);
+}   /*  End Function flush_refresh_cbk  */
+
 static flag xy_pos_consumer (ViewableImage vimage, double x, double y,
 			     void *value, unsigned int event_code,
 			     void *e_info, void **f_info,
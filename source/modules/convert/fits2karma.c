@@ -153,6 +153,7 @@ int main (int argc, char **argv)
     extern flag sanitise;
     extern flag convert_to_float;
     extern flag tile, allow_truncation;
+    extern unsigned int num_jobs;
     static char function_name[] = "main";
 
     im_register_lib_version (KARMA_VERSION);
@@ -175,6 +176,9 @@ int main (int argc, char **argv)
     panel_add_item (panel, "allow_truncation", "shrink axes to allow tiling",
 		    PIT_FLAG, &allow_truncation,
 		    PIA_END);
+    panel_add_item (panel, "jobs", "number of files to read at once", K_UINT,
+		    &num_jobs,
+		    PIA_END);
     panel_push_onto_stack (panel);
     module_run (argc, argv, "fits2karma", VERSION, command_parse, -1, 0,
 		FALSE);
@@ -281,6 +285,8 @@ void generate_file (char *fits_filename, char *arrayfile)
 	if ( !foreign_fits_read_data (fits_ch, multi_desc, buffer, num_values,
 				      FA_FITS_READ_DATA_NUM_BLANKS,
 				      &toobig_count_tmp,
+				      FA_FITS_READ_DATA_FIRST_INDEX,
+				      (uaddr) array_count,
 				      FA_FITS_READ_DATA_END) )
 	{
 	    fprintf (stderr, "Error reading FITS file\n");
@@ -324,7 +330,7 @@ void generate_file (char *fits_filename, char *arrayfile)
 /*  Put globals here to force functions to be explicit  */
 flag ignore_excess = FALSE;
 flag sanitise = TRUE;
-flag convert_to_float = TRUE;
 char *default_extension = ".kf";
 flag tile = TRUE;
 flag allow_truncation = TRUE;
+unsigned int num_jobs = 1;
@@ -62,6 +62,7 @@ int main (int argc, char **argv)
     KControlPanel panel;
     extern flag sanitise;
     extern flag tile, allow_truncation;
+    extern unsigned int num_jobs;
     static char function_name[] = "main";
 
     im_register_lib_version (KARMA_VERSION);
@@ -77,6 +78,9 @@ int main (int argc, char **argv)
     panel_add_item (panel, "allow_truncation", "shrink axes to allow tiling",
 		    PIT_FLAG, &allow_truncation,
 		    PIA_END);
+    panel_add_item (panel, "jobs", "number of files to read at once", K_UINT,
+		    &num_jobs,
+		    PIA_END);
     panel_push_onto_stack (panel);
     module_run (argc, argv, "gipsy2karma", VERSION, command_parse, -1, 0,
 		FALSE);
@@ -231,3 +235,4 @@ flag sanitise = TRUE;
 char *default_extension = ".kf";
 flag tile = TRUE;
 flag allow_truncation = TRUE;
+unsigned int num_jobs = 1;
@@ -24,7 +24,7 @@
 */
 
 /*  This Karma module will read in a Karma data file and convert the image into
-    a PostScript file.
+    a PostScript or PDF file.
 
 
     Written by      Richard Gooch   10-MAY-1994
@@ -67,10 +67,20 @@ STATIC_FUNCTION (unsigned short *get_cmap, (multi_array *multi_desc,
 static flag portrait = TRUE;
 static flag encapsulated_postscript = FALSE;
 static flag iscale_for_ubyte = TRUE;
+static flag pdf = FALSE;
 static double hoffset = 1.0;
 static double voffset = 1.0;
 static double hsize = 18.0;
 static double vsize = 18.0;
+#define NUM_ENCODINGS 4
+static char *encoding_alternatives[NUM_ENCODINGS] =
+{
+    "hex",
+    "ascii85",
+    "runlength",
+    "flate"
+};
+static int image_encoding = PSW_ENCODING_RUNLENGTH;
 
 #define VERSION "1.1"
 
@@ -80,6 +90,8 @@ int main (int argc, char **argv)
     extern flag portrait;
     extern flag encapsulated_postscript;
     extern flag iscale_for_ubyte;
+    extern flag pdf;
+    extern int image_encoding;
     extern double hoffset;
     extern double voffset;
     extern double hsize;
@@ -106,6 +118,13 @@ int main (int argc, char **argv)
 		    PIA_END);
     panel_add_item (panel, "portrait", "flag", PIT_FLAG, &portrait,
 		    PIA_END);
+    panel_add_item (panel, "pdf", "flag", PIT_FLAG, &pdf,
+		    PIA_END);
+    panel_add_item (panel, "image_encoding", "choice", PIT_CHOICE_INDEX,
+		    &image_encoding,
+		    PIA_NUM_CHOICE_STRINGS, NUM_ENCODINGS,
+		    PIA_CHOICE_STRINGS, encoding_alternatives,
+		    PIA_END);
     panel_push_onto_stack (panel);
     module_run (argc, argv, "karma2ps", VERSION, karma2ps, -1, -1, FALSE);
     return (RV_OK);
@@ -121,6 +140,8 @@ FILE *fp;
     char *inp_filename, *out_filename;
     extern flag portrait;
     extern flag encapsulated_postscript;
+    extern flag pdf;
+    extern int image_encoding;
     extern double hoffset;
     extern double voffset;
     extern double hsize;
@@ -159,8 +180,21 @@ FILE *fp;
 	ds_dealloc_multi (multi_desc);
 	return (TRUE);
     }
-    if ( ( pspage = psw_create (out, hoffset, voffset, hsize, vsize,
-				portrait) ) != NULL)
+    if (pdf)
+    {
+	pspage = psw_va_create_pdf (out, hoffset, voffset, hsize, vsize,
+				    portrait,
+				    PSW_ATT_IMAGE_ENCODING, image_encoding,
+				    PSW_ATT_END);
+    }
+    else
+    {
+	pspage = psw_va_create (out, hoffset, voffset, hsize, vsize, portrait,
+				encapsulated_postscript,
+				PSW_ATT_IMAGE_ENCODING, image_encoding,
+				PSW_ATT_END);
+    }
+    if (pspage != NULL)
     {
 	if ( write_array (pspage, multi_desc) )
 	{
@@ -176,7 +210,8 @@ FILE *fp;
 	else
 	{
 	    (void) psw_finish (pspage, encapsulated_postscript, FALSE, FALSE);
-	    (void) fprintf (stderr, "Error converting to PostScript\n");
+	    (void) fprintf (stderr, "Error converting to %s\n",
+			    pdf ? "PDF" : "PostScript");
 	}
     }
     (void) ch_close (out);
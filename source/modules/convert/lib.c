@@ -68,15 +68,63 @@ EXTERN_FUNCTION (void generate_file, (char *fits_filename, char *arrayfile) );
 
 STATIC_FUNCTION (char *convert_object_to_filename, (CONST char *object_name) );
 STATIC_FUNCTION (Channel open_file, (CONST char *arrayfile) );
+STATIC_FUNCTION (flag generate_files,
+		 (CONST char **infiles, char **arrayfiles,
+		  unsigned int num_files) );
+STATIC_FUNCTION (flag write_file,
+		 (void *info, unsigned int index, CONST char *infile,
+		  multi_array *multi_desc, unsigned int ftype) );
+
 
 
 /*  Public functions follow  */
 
 flag command_parse (char *p, FILE *fp)
 {
+    unsigned int num_files, count;
     char *arrayfile;
     char *input_filename;
+    char *ptr;
+    char **infiles, **arrayfiles;
+    extern unsigned int num_jobs;
+    static char function_name[] = "command_parse";
 
+    if (num_jobs > 1)
+    {
+	/*  Collect the filename pairs and convert them in parallel  */
+	for (num_files = 0, ptr = p; ptr; ptr = ex_word_skip (ptr))
+	{
+	    ++num_files;
+	}
+	num_files /= 2;
+	if ( ( infiles = (char **) m_alloc (sizeof *infiles * num_files * 2) )
+	     == NULL )
+	{
+	    m_error_notify (function_name, "filename list");
+	    return (TRUE);
+	}
+	arrayfiles = infiles + num_files;
+	for (count = 0; count < num_files; ++count)
+	{
+	    infiles[count] = ex_str (p, &p);
+	    arrayfiles[count] = ex_str (p, &p);
+	    if ( (infiles[count] == NULL) || (arrayfiles[count] == NULL) )
+	    {
+		fprintf (stderr, "Error extracting filenames\n");
+		if (infiles[count] != NULL) m_free (infiles[count]);
+		num_files = count;
+		break;
+	    }
+	}
+	generate_files ( (CONST char **) infiles, arrayfiles, num_files );
+	for (count = 0; count < num_files; ++count)
+	{
+	    m_free (infiles[count]);
+	    m_free (arrayfiles[count]);
+	}
+	m_free ( (char *) infiles );
+	return (TRUE);
+    }
     for ( ; p; p = ex_word_skip (p) )
     {
 	if ( ( input_filename = ex_str (p, &p) ) == NULL )
@@ -517,3 +565,70 @@ static Channel open_file (CONST char *arrayfile)
     m_free (filename);
     return (channel);
 }   /*  End Function open_file  */
+
+static flag generate_files (CONST char **infiles, char **arrayfiles,
+			    unsigned int num_files)
+/*  [SUMMARY] Convert many files, reading several at once.
+    <infiles> The array of input filenames.
+    <arrayfiles> The array of output Karma filenames.
+    <num_files> The number of files.
+    [RETURNS] TRUE on success, else FALSE.
+*/
+{
+    extern flag convert_to_float, sanitise;
+    extern unsigned int num_jobs;
+
+    return ( foreign_guess_and_read_many (infiles, num_files,
+					  K_CH_MAP_NEVER, FALSE, num_jobs,
+					  write_file, (void *) arrayfiles,
+					  FA_GUESS_READ_FITS_TO_FLOAT,
+					  convert_to_float,
+					  FA_GUESS_READ_SANITISE, sanitise,
+					  FA_GUESS_READ_END) );
+}   /*  End Function generate_files  */
+
+static flag write_file (void *info, unsigned int index, CONST char *infile,
+			multi_array *multi_desc, unsigned int ftype)
+/*  [SUMMARY] Write a file which has been read to a Karma arrayfile.
+    <info> The array of output Karma filenames.
+    <index> The index of the file.
+    <infile> The input filename.
+    <multi_desc> The multi_array descriptor. This is deallocated. If this is
+    NULL the input file could not be read.
+    <ftype> The type of the input file.
+    [RETURNS] TRUE, so that the remaining files are converted.
+*/
+{
+    Channel karma_ch;
+    uaddr *dim_lengths, *coords;
+    char *data;
+    CONST char *arrayfile = ( (char **) info )[index];
+    extern flag tile, allow_truncation;
+
+    if (multi_desc == NULL) return (TRUE);
+    data = *(char **) multi_desc->data[0];
+    if ( !setup_for_writing (multi_desc, tile, allow_truncation, &dim_lengths,
+			     &coords, &karma_ch, arrayfile) )
+    {
+	ds_dealloc_multi (multi_desc);
+	return (TRUE);
+    }
+    /*  When tiling a new array has been linked into the data structure: the
+	original array is freed once it has been copied  */
+    if ( write_blocks (karma_ch, multi_desc, dim_lengths, coords, data,
+		       ds_get_array_size ( (array_desc *)
+					   multi_desc->headers[0]
+					   ->element_desc[0] ) ) )
+    {
+	write_tail (karma_ch, multi_desc, infile, arrayfile);
+    }
+    if (dim_lengths != NULL) m_free (data);
+    cleanup (karma_ch, dim_lengths, coords);
+    ds_dealloc_multi (multi_desc);
+    return (TRUE);
+}   /*  End Function write_file  */
+
+
+/*  Put globals here to force functions to be explicit  */
+/*  Only used when converting FITS files  */
+flag convert_to_float = TRUE;
@@ -106,6 +106,8 @@ STATIC_FUNCTION (track_canvas_event,
 		  double x_lin, double y_lin, unsigned int value_type) );
 STATIC_FUNCTION (void new_frame_cbk, (Widget w, XtPointer client_data,
 				      XtPointer call_data) );
+STATIC_FUNCTION (void precompute_cbk, (Widget w, XtPointer client_data,
+				       XtPointer call_data) );
 
 
 /*  Private data  */
@@ -257,6 +259,11 @@ int main (int argc, char **argv)
 					   NULL);
     XtRealizeWidget (main_shell);
     XtAddCallback (animate_control, XkwNnewFrameCallback, new_frame_cbk, NULL);
+    XtAddCallback (animate_control, XkwNprecomputeCallback, precompute_cbk,
+		   NULL);
+    XtVaSetValues (animate_control,
+		   XkwNprecomputeFrames, 2,
+		   NULL);
     XtVaGetValues (image_display,
 		   XkwNpseudoColourCanvas, &wc_pseudo,
 		   XkwNdirectColourCanvas, &wc_direct,
@@ -297,6 +304,9 @@ int main (int argc, char **argv)
 	fprintf (stderr, "Creating overlay list...\n");
 	olist = overlay_create_list ( (void *) NULL );
 	overlay_specify_canvas (olist, wc_pseudo);
+	/*  Keep the image and contours in an off-screen image, so that changes
+	    to the overlay list do not redraw them  */
+	canvas_retain_lower_layers (wc_pseudo);
 	overlay_associate_display_canvas (olist, wc_pseudo);
     }
     trace_winpopup = XtVaCreatePopupShell ("tracewinpopup",
@@ -615,3 +625,23 @@ static void new_frame_cbk (Widget w, XtPointer client_data,
     }
     XkwImageDisplayRefresh (image_display, FALSE);
 }   /*  End Function new_frame_cbk   */
+
+static void precompute_cbk (Widget w, XtPointer client_data,
+			    XtPointer call_data)
+/*  This is the callback for precomputing a frame which will be shown soon.
+*/
+{
+    int frame_number = *(int *) call_data;
+    extern unsigned int num_vimages;
+    extern ViewableImage *movie, *magnified_movie;
+
+    if (frame_number >= num_vimages) return;
+    if ( (movie != NULL) && (movie[frame_number] != NULL) )
+    {
+	(void) viewimg_precompute (movie[frame_number]);
+    }
+    if ( (magnified_movie != NULL) && (magnified_movie[frame_number] != NULL) )
+    {
+	(void) viewimg_precompute (magnified_movie[frame_number]);
+    }
+}   /*  End Function precompute_cbk   */
@@ -401,11 +401,15 @@ static void integrate_ellipses (KWorldCanvas canvas,
     int startx, endx, starty, endy, xlen, ylen, zlen, x, y, z;
     int num_radii_bins, val_rad;
     unsigned int vel_axis;
+    unsigned long num_pixels, count;
     float val;
     float toobig = TOOBIG;
     double sq_radius, distance, wx, wy, rad_scale;
     dim_desc *dim;
+    char *plane;
     char txt[STRING_LENGTH];
+    int *pix_bins;
+    uaddr *pix_offsets;
     unsigned long dim_lengths[2];
     double dx[2], dy[2];
     double crval[2], crpix[2], cdelt[2];
@@ -516,6 +520,20 @@ static void integrate_ellipses (KWorldCanvas canvas,
     {
 	m_abort (function_name, "count array");
     }
+    /*  Find the pixels within the ellipse and their radius bins once, so that
+	each channel plane can then be read in memory order  */
+    num_pixels = (endy - starty + 1) * (endx - startx + 1);
+    if ( ( pix_offsets = (uaddr *) m_alloc (sizeof *pix_offsets * num_pixels) )
+	 == NULL )
+    {
+	m_abort (function_name, "pixel offset array");
+    }
+    if ( ( pix_bins = (int *) m_alloc (sizeof *pix_bins * num_pixels) )
+	 == NULL )
+    {
+	m_abort (function_name, "pixel bin array");
+    }
+    num_pixels = 0;
     sq_radius = radius * radius;
     for (y = starty; y <= endy; ++y) for (x = startx; x <= endx; ++x)
     {
@@ -526,16 +544,25 @@ static void integrate_ellipses (KWorldCanvas canvas,
 	distance = wx * wx + wy * wy;
 	if (distance > sq_radius) continue;
 	distance = sqrt (distance);
-	val_rad = (distance * rad_scale);
-	/*  Loop through channels  */
-	for (z = 0; z < zlen; ++z)
+	pix_offsets[num_pixels] = cube_arr->offsets[1][y] +
+	    cube_arr->offsets[2][x];
+	pix_bins[num_pixels++] = (distance * rad_scale);
+    }
+    /*  Loop through channels  */
+    for (z = 0; z < zlen; ++z)
+    {
+	plane = cube_arr->data + cube_arr->offsets[0][z];
+	for (count = 0; count < num_pixels; ++count)
 	{
-	    val = F3 (cube_arr, z, y, x);
+	    val = *(float *) (plane + pix_offsets[count]);
 	    if (val >= toobig) continue;
+	    val_rad = pix_bins[count];
 	    F2 (image_arr, z, val_rad) += val;
 	    ++UI2 (count_arr, z, val_rad);
 	}
     }
+    m_free ( (char *) pix_offsets );
+    m_free ( (char *) pix_bins );
     /*  Divide sums by counts (average computation)  */
     for (y = 0; y < zlen; ++y) for (x = 0; x < num_radii_bins; ++x)
     {
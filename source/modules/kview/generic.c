@@ -68,6 +68,7 @@
 #include <karma_conn.h>
 #include <karma_wcs.h>
 #include <karma_ds.h>
+#include <karma_ch.h>
 #include <karma_a.h>
 #include <karma_m.h>
 #include <karma_r.h>
@@ -220,6 +221,8 @@ flag display_file (CONST char *inp_filename,
     astro_projection = wcs_astro_setup (multi_desc->headers[0],
 					multi_desc->data[0]);
     fprintf (stderr, "astro_projection: %p\n", astro_projection);
+    /*  Prefetches of the old data must complete before it is unmapped  */
+    ch_wait_async (NULL);
     if (*pseudo_arr != NULL) iarray_dealloc (*pseudo_arr);
     *pseudo_arr = NULL;
     destroy_all_vimages (image, movie, magnified_image, magnified_movie,
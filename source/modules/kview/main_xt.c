@@ -126,11 +126,13 @@
 #include <karma_wcs.h>
 #include <karma_dir.h>
 #include <karma_chx.h>
+#include <karma_ch.h>
 #include <karma_ds.h>
 #include <karma_im.h>
 #include <karma_hi.h>
 #include <karma_xc.h>
 #include <karma_ic.h>
+#include <karma_m.h>
 #include <karma_a.h>
 #include <Xkw/ImageDisplay.h>
 #include <Xkw/Filewin.h>
@@ -141,6 +143,8 @@
 
 #define VERSION "1.5.5"
 
+#define PREFETCH_FRAMES 4
+
 
 /*  External functions  */
 /*  File: generic.c  */
@@ -172,6 +176,10 @@ STATIC_FUNCTION (track_canvas_event,
 		  double x_lin, double y_lin, unsigned int value_type) );
 STATIC_FUNCTION (void new_frame_cbk, (Widget w, XtPointer client_data,
 				      XtPointer call_data) );
+STATIC_FUNCTION (void precompute_cbk, (Widget w, XtPointer client_data,
+				       XtPointer call_data) );
+STATIC_FUNCTION (void prefetch_frames, (int frame_number) );
+STATIC_FUNCTION (void prefetch_done, (void *info) );
 
 
 /*  Private data  */
@@ -231,6 +239,8 @@ static unsigned int num_frames = 0;
 static double pseudo_scale = 1.0;
 static double pseudo_offset = 0.0;
 static Widget trace_winpopup = NULL;
+static flag *prefetch_pending = NULL;
+static unsigned int num_prefetch_flags = 0;
 
 
 int main (int argc, char **argv)
@@ -263,6 +273,8 @@ int main (int argc, char **argv)
     conn_register_managers ( ( flag (*) () ) chx_manage,
 			     ( void (*) () ) chx_unmanage,
 			     ( void (*) () ) NULL );
+    ch_register_async_managers ( ( flag (*) () ) chx_manage,
+				 ( void (*) () ) chx_unmanage );
     dpy = XtDisplay (main_shell);
     setup_comms (dpy);
     XtVaSetValues (main_shell,
@@ -287,6 +299,11 @@ int main (int argc, char **argv)
 				     (Widget) filepopup);
     XtRealizeWidget (main_shell);
     XtAddCallback (animate_control, XkwNnewFrameCallback, new_frame_cbk, NULL);
+    XtAddCallback (animate_control, XkwNprecomputeCallback, precompute_cbk,
+		   NULL);
+    XtVaSetValues (animate_control,
+		   XkwNprecomputeFrames, 2,
+		   NULL);
     XtVaGetValues (image_display,
 		   XkwNpseudoColourCanvas, &wc_pseudo,
 		   XkwNdirectColourCanvas, &wc_direct,
@@ -346,7 +363,10 @@ void load_and_setup (CONST char *filename)
     extern unsigned int num_frames;
     extern Widget main_shell, image_display;
     extern Widget trace_winpopup;
+    extern flag *prefetch_pending;
+    extern unsigned int num_prefetch_flags;
     extern char title_name[STRING_LENGTH];
+    static char function_name[] = "load_and_setup";
 
     strcpy (stripped_filename, filename);
     if ( ( ptr = strrchr (stripped_filename, '.') ) != NULL )
@@ -371,6 +391,24 @@ void load_and_setup (CONST char *filename)
 			&pseudo_arr, &image, &movie,
 			&magnified_image, &magnified_movie,
 			&num_frames, &min, &max) ) return;
+    /*  Outstanding prefetches were waited for when the old data was freed  */
+    if (prefetch_pending != NULL) m_free ( (char *) prefetch_pending );
+    prefetch_pending = NULL;
+    num_prefetch_flags = 0;
+    if (num_frames > 0)
+    {
+	if ( ( prefetch_pending = (flag *)
+	       m_alloc (num_frames * sizeof *prefetch_pending) ) == NULL )
+	{
+	    m_error_notify (function_name, "prefetch flags");
+	}
+	else
+	{
+	    m_clear ( (char *) prefetch_pending,
+		      num_frames * sizeof *prefetch_pending );
+	    num_prefetch_flags = num_frames;
+	}
+    }
     sprintf (title, "%s  file: %s\n", title_name, filename);
     XtVaSetValues (main_shell,
 		   XtNtitle, title,
@@ -547,4 +585,93 @@ static void new_frame_cbk (Widget w, XtPointer client_data,
     {
 	viewimg_make_active (magnified_movie[frame_number]);
     }
+    prefetch_frames (frame_number);
 }   /*  End Function new_frame_cbk   */
+
+static void precompute_cbk (Widget w, XtPointer client_data,
+			    XtPointer call_data)
+/*  This is the callback for precomputing a frame which will be shown soon.
+*/
+{
+    int frame_number = *(int *) call_data;
+    extern ViewableImage *movie, *magnified_movie;
+
+    if ( (movie != NULL) && (movie[frame_number] != NULL) )
+    {
+	(void) viewimg_precompute (movie[frame_number]);
+    }
+    if ( (magnified_movie != NULL) && (magnified_movie[frame_number] != NULL) )
+    {
+	(void) viewimg_precompute (magnified_movie[frame_number]);
+    }
+}   /*  End Function precompute_cbk   */
+
+static void prefetch_frames (int frame_number)
+/*  [SUMMARY] Page in the data for the frames after a frame.
+    [PURPOSE] This routine will start paging in the data for the next few
+    frames of the movie, so that playing a memory mapped cube does not stall
+    on disc reads. Frames already being paged in are skipped.
+    <frame_number> The current frame number.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count, frame, hdim, vdim, elem_size;
+    uaddr offset, min_h, max_h, min_v, max_v;
+    char *slice;
+    array_desc *arr_desc;
+    extern flag *prefetch_pending;
+    extern unsigned int num_prefetch_flags;
+    extern ViewableImage *movie;
+
+    if ( (movie == NULL) || (num_prefetch_flags < 2) ) return;
+    for (count = 1; (count <= PREFETCH_FRAMES) && (count < num_prefetch_flags);
+	 ++count)
+    {
+	frame = (frame_number + count) % num_prefetch_flags;
+	if (prefetch_pending[frame] || (movie[frame] == NULL) ) continue;
+	viewimg_get_attributes (movie[frame],
+				VIEWIMG_VATT_ARRAY_DESC, &arr_desc,
+				VIEWIMG_VATT_SLICE, &slice,
+				VIEWIMG_VATT_HDIM, &hdim,
+				VIEWIMG_VATT_VDIM, &vdim,
+				VIEWIMG_VATT_END);
+	if (arr_desc->offsets == NULL) continue;
+	/*  Find the extent of the plane from the dimension offsets  */
+	min_h = max_h = arr_desc->offsets[hdim][0];
+	for (offset = 1; offset < arr_desc->dimensions[hdim]->length; ++offset)
+	{
+	    if (arr_desc->offsets[hdim][offset] < min_h)
+		min_h = arr_desc->offsets[hdim][offset];
+	    if (arr_desc->offsets[hdim][offset] > max_h)
+		max_h = arr_desc->offsets[hdim][offset];
+	}
+	min_v = max_v = arr_desc->offsets[vdim][0];
+	for (offset = 1; offset < arr_desc->dimensions[vdim]->length; ++offset)
+	{
+	    if (arr_desc->offsets[vdim][offset] < min_v)
+		min_v = arr_desc->offsets[vdim][offset];
+	    if (arr_desc->offsets[vdim][offset] > max_v)
+		max_v = arr_desc->offsets[vdim][offset];
+	}
+	elem_size = ds_get_packet_size (arr_desc->packet);
+	if ( ch_prefetch_async (slice + min_h + min_v,
+				max_h + max_v - min_h - min_v + elem_size,
+				prefetch_done, (void *) (iaddr) frame) )
+	{
+	    prefetch_pending[frame] = TRUE;
+	}
+    }
+}   /*  End Function prefetch_frames  */
+
+static void prefetch_done (void *info)
+/*  [SUMMARY] Prefetch completion callback.
+    <info> The frame number.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int frame = (iaddr) info;
+    extern flag *prefetch_pending;
+    extern unsigned int num_prefetch_flags;
+
+    if (frame < num_prefetch_flags) prefetch_pending[frame] = FALSE;
+}   /*  End Function prefetch_done  */
@@ -0,0 +1,816 @@
+/*  kbench.c
+
+    Source file for  kbench  (benchmark the rendering pipeline).
+
+    Copyright (C) 1996  Richard Gooch
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This Karma module will time the stages of the rendering pipeline: image
+  refreshes, zooming and panning, contour refreshes, overlay redraws, volume
+  rendering and colourmap changes. Synthetic images and cubes are generated
+  and drawn onto memory canvases, so no display is needed and the results
+  are reproducible. One line is written to the standard output for each stage
+  with the number of iterations, the total and per-iteration time in
+  milliseconds and the throughput, separated by tabs.
+
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <karma.h>
+#include <karma_module.h>
+#include <karma_panel.h>
+#include <karma_viewimg.h>
+#include <karma_contour.h>
+#include <karma_overlay.h>
+#include <karma_vrender.h>
+#include <karma_canvas.h>
+#include <karma_kcmap.h>
+#include <karma_kwin.h>
+#include <karma_iarray.h>
+#include <karma_ds.h>
+#include <karma_ex.h>
+#include <karma_st.h>
+#include <karma_im.h>
+#include <karma_m.h>
+#include <karma_n.h>
+#include <karma_a.h>
+
+#define VERSION "1.0"
+
+#define COLOURMAP_NAME "Greyscale1"
+#define NUM_COLOURS 200
+#define SHADER_NAME "kbench-MIP"
+#define NUM_BLOBS 5
+#define NUM_OVERLAY_COLOURS 4
+#define SEED 1
+
+STATIC_FUNCTION (flag kbench, (char *command, FILE *fp) );
+STATIC_FUNCTION (void run_stage, (CONST char *name) );
+STATIC_FUNCTION (void bench_image_refresh, () );
+STATIC_FUNCTION (void bench_zoom_pan, () );
+STATIC_FUNCTION (void bench_contour_refresh, () );
+STATIC_FUNCTION (void bench_overlay_redraw, () );
+STATIC_FUNCTION (void bench_vrender, () );
+STATIC_FUNCTION (void bench_colourmap, () );
+STATIC_FUNCTION (flag get_canvas, (KWorldCanvas *canvas) );
+STATIC_FUNCTION (iarray get_image, () );
+STATIC_FUNCTION (iarray get_cube, () );
+STATIC_FUNCTION (double blob_value, (double x, double y, double z) );
+STATIC_FUNCTION (double elapsed_ms, (struct timeval *start) );
+STATIC_FUNCTION (void report,
+		 (CONST char *stage, unsigned int num_iterations, double ms,
+		  double work, CONST char *units) );
+STATIC_FUNCTION (void shade_slow,
+		 (signed char **planes, uaddr *v_offsets, uaddr *h_offsets,
+		  float ray_start_d, float ray_start_v, float ray_start_h,
+		  float ray_direction_d, float ray_direction_v,
+		  float ray_direction_h, float one_on_ray_direction_d,
+		  float min_d, float max_d,
+		  double *minimum_image_value, double *maximum_image_value,
+		  char *pixel_ptr) );
+STATIC_FUNCTION (void shade_fast,
+		 (signed char *ray, int length,
+		  double *minimum_image_value, double *maximum_image_value,
+		  void *pixel_ptr) );
+
+
+/*  Private data  */
+static int canvas_width = 512;
+static int canvas_height = 512;
+static unsigned int image_size = 1024;
+static unsigned int cube_size = 64;
+static unsigned int num_iterations = 20;
+static unsigned int num_levels = 8;
+static unsigned int num_objects = 1000;
+static iarray image = NULL;
+static iarray cube = NULL;
+static KWorldCanvas image_canvas = NULL;
+static KWorldCanvas zoom_canvas = NULL;
+static KWorldCanvas contour_canvas = NULL;
+static KWorldCanvas overlay_canvas = NULL;
+static KWorldCanvas colourmap_canvas = NULL;
+static KOverlayList overlay_list = NULL;
+static KVolumeRenderContext vrender_context = NULL;
+static flag header_written = FALSE;
+static double blob_x[NUM_BLOBS] = {0.3, 0.7, 0.5, 0.2, 0.8};
+static double blob_y[NUM_BLOBS] = {0.3, 0.6, 0.5, 0.8, 0.2};
+static double blob_z[NUM_BLOBS] = {0.5, 0.3, 0.6, 0.4, 0.7};
+static double blob_width[NUM_BLOBS] = {0.05, 0.08, 0.2, 0.03, 0.1};
+static double blob_amplitude[NUM_BLOBS] = {1.0, 0.6, 0.3, 0.8, 0.5};
+static char *overlay_colours[NUM_OVERLAY_COLOURS] =
+{
+    "red", "green", "yellow", "cyan"
+};
+
+static struct
+{
+    char *name;
+    void (*func) ();
+} stages[] =
+{
+    {"image_refresh", bench_image_refresh},
+    {"zoom_pan", bench_zoom_pan},
+    {"contour_refresh", bench_contour_refresh},
+    {"overlay_redraw", bench_overlay_redraw},
+    {"vrender", bench_vrender},
+    {"colourmap", bench_colourmap},
+    {NULL, NULL}
+};
+
+
+int main (int argc, char **argv)
+{
+    KControlPanel panel;
+    static char function_name[] = "main";
+
+    if ( ( panel = panel_create (FALSE) ) == NULL )
+    {
+	m_abort (function_name, "control panel");
+    }
+    panel_add_item (panel, "num_objects", "overlay objects", K_UINT,
+		    &num_objects,
+		    PIA_END);
+    panel_add_item (panel, "num_levels", "contour levels", K_UINT,
+		    &num_levels,
+		    PIA_END);
+    panel_add_item (panel, "num_iterations", "per stage", K_UINT,
+		    &num_iterations,
+		    PIA_END);
+    panel_add_item (panel, "cube_size", "voxels", K_UINT, &cube_size,
+		    PIA_END);
+    panel_add_item (panel, "image_size", "pixels", K_UINT, &image_size,
+		    PIA_END);
+    panel_add_item (panel, "canvas_height", "pixels", K_INT, &canvas_height,
+		    PIA_END);
+    panel_add_item (panel, "canvas_width", "pixels", K_INT, &canvas_width,
+		    PIA_END);
+    panel_push_onto_stack (panel);
+    im_register_lib_version (KARMA_VERSION);
+    module_run (argc, argv, "kbench", VERSION, kbench, -1, -1, FALSE);
+    return (RV_OK);
+}   /*  End Function main   */
+
+static flag kbench (char *p, FILE *fp)
+{
+    unsigned int count;
+    char *name;
+
+    for ( ; p; p = ex_command_skip (p) )
+    {
+	if ( ( name = ex_str (p, &p) ) == NULL )
+	{
+	    fprintf (fp, "Error extracting stage name\n");
+	    return (TRUE);
+	}
+	if (strcmp (name, "all") == 0)
+	{
+	    for (count = 0; stages[count].name != NULL; ++count)
+	    {
+		run_stage (stages[count].name);
+	    }
+	}
+	else run_stage (name);
+	m_free (name);
+    }
+    return (TRUE);
+}   /*  End Function kbench  */
+
+static void run_stage (CONST char *name)
+/*  [SUMMARY] Run a benchmark stage.
+    <name> The name of the stage.
+    [RETURNS] Nothing.
+*/
+{
+    unsigned int count;
+
+    for (count = 0; stages[count].name != NULL; ++count)
+    {
+	if (strcmp (name, stages[count].name) != 0) continue;
+	(*stages[count].func) ();
+	return;
+    }
+    fprintf (stderr, "Unknown stage: \"%s\", known stages are:", name);
+    for (count = 0; stages[count].name != NULL; ++count)
+    {
+	fprintf (stderr, " %s", stages[count].name);
+    }
+    fprintf (stderr, " all\n");
+}   /*  End Function run_stage  */
+
+
+/*  Benchmark stages follow  */
+
+static void bench_image_refresh ()
+/*  [SUMMARY] Time full refreshes of an image.
+    [RETURNS] Nothing.
+*/
+{
+    KWorldCanvas canvas;
+    ViewableImage vimage;
+    unsigned int count;
+    double ms;
+    struct timeval start;
+    static char function_name[] = "bench_image_refresh";
+
+    if ( get_canvas (&image_canvas) ) viewimg_init (image_canvas);
+    canvas = image_canvas;
+    if ( ( vimage = viewimg_create_from_iarray (canvas, get_image (), FALSE) )
+	 == NULL )
+    {
+	m_abort (function_name, "viewable image");
+    }
+    viewimg_make_active (vimage);
+    gettimeofday (&start, NULL);
+    for (count = 0; count < num_iterations; ++count)
+    {
+	kwin_resize (canvas_get_pixcanvas (canvas), TRUE, 0, 0, -1, -1);
+    }
+    ms = elapsed_ms (&start);
+    report ("image_refresh", num_iterations, ms,
+	    (double) canvas_width * (double) canvas_height * 1e-6, "Mpixel");
+    viewimg_destroy (vimage);
+}   /*  End Function bench_image_refresh  */
+
+static void bench_zoom_pan ()
+/*  [SUMMARY] Time zooming and panning over an image.
+    [RETURNS] Nothing.
+*/
+{
+    KWorldCanvas canvas;
+    ViewableImage vimage;
+    unsigned int count;
+    double ms;
+    struct timeval start;
+    static char function_name[] = "bench_zoom_pan";
+
+    if ( get_canvas (&zoom_canvas) ) viewimg_init (zoom_canvas);
+    canvas = zoom_canvas;
+    if ( ( vimage = viewimg_create_from_iarray (canvas, get_image (), FALSE) )
+	 == NULL )
+    {
+	m_abort (function_name, "viewable image");
+    }
+    viewimg_make_active (vimage);
+    gettimeofday (&start, NULL);
+    for (count = 0; count < num_iterations; ++count)
+    {
+	/*  Sweep the centre along the diagonal, zooming in and out  */
+	viewimg_set_canvas_attributes
+	    (canvas,
+	     VIEWIMG_ATT_ENABLE_PANNING, TRUE,
+	     VIEWIMG_ATT_PAN_CENTRE_X,
+	     (unsigned long) image_size * (count + 1) / (num_iterations + 1),
+	     VIEWIMG_ATT_PAN_CENTRE_Y,
+	     (unsigned long) image_size * (count + 1) / (num_iterations + 1),
+	     VIEWIMG_ATT_PAN_MAGNIFICATION, (unsigned int) 1 << (count % 4),
+	     VIEWIMG_ATT_END);
+	kwin_resize (canvas_get_pixcanvas (canvas), TRUE, 0, 0, -1, -1);
+    }
+    ms = elapsed_ms (&start);
+    report ("zoom_pan", num_iterations, ms,
+	    (double) canvas_width * (double) canvas_height * 1e-6, "Mpixel");
+    viewimg_destroy (vimage);
+}   /*  End Function bench_zoom_pan  */
+
+static void bench_contour_refresh ()
+/*  [SUMMARY] Time refreshes of a contoured image.
+    [RETURNS] Nothing.
+*/
+{
+    KWorldCanvas canvas;
+    KContourImage cimage;
+    unsigned int count;
+    double ms;
+    double *levels;
+    struct timeval start;
+    static char function_name[] = "bench_contour_refresh";
+
+    if ( get_canvas (&contour_canvas) )
+    {
+	contour_init (contour_canvas,
+		      CONTOUR_CANVAS_ATT_COLOURNAME, "green",
+		      CONTOUR_CANVAS_ATT_END);
+    }
+    canvas = contour_canvas;
+    canvas_set_attributes (canvas,
+			   CANVAS_ATT_LEFT_X, 0.0,
+			   CANVAS_ATT_RIGHT_X, (double) (image_size - 1),
+			   CANVAS_ATT_BOTTOM_Y, 0.0,
+			   CANVAS_ATT_TOP_Y, (double) (image_size - 1),
+			   CANVAS_ATT_END);
+    if (num_levels < 1) num_levels = 1;
+    if ( ( levels = (double *) m_alloc (sizeof *levels * num_levels) )
+	 == NULL )
+    {
+	m_abort (function_name, "contour levels");
+    }
+    for (count = 0; count < num_levels; ++count)
+    {
+	levels[count] = (double) (count + 1) / (double) (num_levels + 1);
+    }
+    if ( ( cimage = contour_create_from_iarray (canvas, get_image (), FALSE,
+						num_levels, levels) )
+	 == NULL )
+    {
+	m_abort (function_name, "contour image");
+    }
+    m_free ( (char *) levels );
+    contour_set_active (cimage, TRUE, TRUE, FALSE, TRUE);
+    gettimeofday (&start, NULL);
+    for (count = 0; count < num_iterations; ++count)
+    {
+	kwin_resize (canvas_get_pixcanvas (canvas), TRUE, 0, 0, -1, -1);
+    }
+    ms = elapsed_ms (&start);
+    report ("contour_refresh", num_iterations, ms,
+	    (double) image_size * (double) image_size * 1e-6, "Mvalue");
+    contour_destroy (cimage);
+}   /*  End Function bench_contour_refresh  */
+
+static void bench_overlay_redraw ()
+/*  [SUMMARY] Time redraws of an overlay list.
+    [RETURNS] Nothing.
+*/
+{
+    KWorldCanvas canvas;
+    KOverlayList olist;
+    ViewableImage vimage;
+    unsigned int count;
+    double ms, x, y, size;
+    char *colour;
+    struct timeval start;
+    static char function_name[] = "bench_overlay_redraw";
+
+    if ( get_canvas (&overlay_canvas) )
+    {
+	viewimg_init (overlay_canvas);
+	if ( ( overlay_list == NULL ) &&
+	     ( ( overlay_list = overlay_create_list (NULL) ) == NULL ) )
+	{
+	    m_abort (function_name, "overlay list");
+	}
+	overlay_specify_canvas (overlay_list, overlay_canvas);
+    }
+    canvas = overlay_canvas;
+    olist = overlay_list;
+    if ( ( vimage = viewimg_create_from_iarray (canvas, get_image (), FALSE) )
+	 == NULL )
+    {
+	m_abort (function_name, "viewable image");
+    }
+    viewimg_make_active (vimage);
+    /*  Mix lines, vectors and ellipses in world co-ordinates. Seed first so
+	that every run places the same objects  */
+    n_set_seed (SEED);
+    for (count = 0; count < num_objects; ++count)
+    {
+	x = n_uniform () * (double) image_size;
+	y = n_uniform () * (double) image_size;
+	size = n_uniform () * 0.05 * (double) image_size;
+	colour = overlay_colours[count % NUM_OVERLAY_COLOURS];
+	switch (count % 4)
+	{
+	  case 0:
+	    overlay_line (olist, OVERLAY_COORD_WORLD, x, y,
+			  OVERLAY_COORD_WORLD, x + size, y + size, colour);
+	    break;
+	  case 1:
+	    overlay_vector (olist, OVERLAY_COORD_WORLD, x, y,
+			    OVERLAY_COORD_WORLD, size, -size, colour);
+	    break;
+	  case 2:
+	    overlay_ellipse (olist, OVERLAY_COORD_WORLD, x, y,
+			     OVERLAY_COORD_WORLD, size, size * 0.5, colour,
+			     FALSE);
+	    break;
+	  case 3:
+	    overlay_ellipse (olist, OVERLAY_COORD_WORLD, x, y,
+			     OVERLAY_COORD_WORLD, size * 0.5, size, colour,
+			     TRUE);
+	    break;
+	}
+    }
+    gettimeofday (&start, NULL);
+    for (count = 0; count < num_iterations; ++count)
+    {
+	if ( !overlay_redraw_on_canvas (olist, canvas) )
+	{
+	    fprintf (stderr, "%s: error redrawing overlays\n", function_name);
+	    break;
+	}
+    }
+    ms = elapsed_ms (&start);
+    report ("overlay_redraw", num_iterations, ms,
+	    (double) num_objects * 1e-3, "Kobject");
+    overlay_remove_objects (olist, 0);
+    viewimg_destroy (vimage);
+}   /*  End Function bench_overlay_redraw  */
+
+static void bench_vrender ()
+/*  [SUMMARY] Time volume rendering a cube from a rotating viewpoint.
+    [RETURNS] Nothing.
+*/
+{
+    KVolumeRenderContext context;
+    unsigned int count;
+    double ms, angle, min, max;
+    float centre, distance;
+    char *buffer;
+    array_desc *arr_desc;
+    packet_desc *pack_desc;
+    view_specification view;
+    struct timeval start;
+    static flag registered = FALSE;
+    static char blank = -128;
+    static char function_name[] = "bench_vrender";
+
+    if (!registered)
+    {
+	if ( ( pack_desc = ds_alloc_packet_desc (1) ) == NULL )
+	{
+	    m_abort (function_name, "packet descriptor");
+	}
+	pack_desc->element_types[0] = K_BYTE;
+	if ( ( pack_desc->element_desc[0] = st_dup ("Data Value") ) == NULL )
+	{
+	    m_abort (function_name, "element name");
+	}
+	vrender_register_shader ( ( void (*) () ) shade_slow,
+				 ( void (*) () ) shade_fast, SHADER_NAME,
+				 pack_desc, &blank, NULL, FALSE);
+	ds_dealloc_packet (pack_desc, NULL);
+	registered = TRUE;
+    }
+    centre = 0.5 * (float) (cube_size - 1);
+    distance = 4.0 * (float) cube_size;
+    view.position.x = centre;
+    view.position.y = centre;
+    view.position.z = centre - distance;
+    view.focus.x = centre;
+    view.focus.y = centre;
+    view.focus.z = centre;
+    view.vertical.x = 0.0;
+    view.vertical.y = 1.0;
+    view.vertical.z = 0.0;
+    /*  Contexts cannot be destroyed, so one is kept for later runs  */
+    if (vrender_context == NULL)
+    {
+	if ( ( vrender_context =
+	       vrender_create_context (NULL,
+				       VRENDER_CONTEXT_ATT_SHADER, SHADER_NAME,
+				       VRENDER_CONTEXT_ATT_END) ) == NULL )
+	{
+	    m_abort (function_name, "volume rendering context");
+	}
+    }
+    context = vrender_context;
+    vrender_set_context_attributes (context,
+				    VRENDER_CONTEXT_ATT_CUBE, get_cube (),
+				    VRENDER_CONTEXT_ATT_VIEW, &view,
+				    VRENDER_CONTEXT_ATT_END);
+    vrender_get_context_attributes (context,
+				    VRENDER_CONTEXT_ATT_IMAGE_DESC, &arr_desc,
+				    VRENDER_CONTEXT_ATT_END);
+    if ( ( buffer = m_alloc (ds_get_array_size (arr_desc) *
+			     ds_get_packet_size (arr_desc->packet) ) )
+	 == NULL )
+    {
+	m_abort (function_name, "image buffer");
+    }
+    gettimeofday (&start, NULL);
+    for (count = 0; count < num_iterations; ++count)
+    {
+	/*  Orbit around the vertical axis  */
+	angle = 2.0 * PI * (double) count / (double) num_iterations;
+	view.position.x = centre + distance * sin (angle);
+	view.position.z = centre - distance * cos (angle);
+	vrender_set_context_attributes (context,
+					VRENDER_CONTEXT_ATT_VIEW, &view,
+					VRENDER_CONTEXT_ATT_END);
+	if ( !vrender_to_buffer (context, buffer, NULL, &min, &max,
+				 ( void (*) () ) NULL, NULL) )
+	{
+	    fprintf (stderr, "%s: error rendering\n", function_name);
+	    break;
+	}
+    }
+    ms = elapsed_ms (&start);
+    report ("vrender", num_iterations, ms,
+	    (double) cube_size * (double) cube_size * (double) cube_size *
+	    1e-6, "Mvoxel");
+    m_free (buffer);
+}   /*  End Function bench_vrender  */
+
+static void bench_colourmap ()
+/*  [SUMMARY] Time changing and modifying the colourmap of an image.
+    [RETURNS] Nothing.
+*/
+{
+    KWorldCanvas canvas;
+    ViewableImage vimage;
+    Kcolourmap cmap;
+    unsigned int count, num_funcs;
+    double ms, x;
+    CONST char **funcs;
+    struct timeval start;
+    static char function_name[] = "bench_colourmap";
+
+    if ( get_canvas (&colourmap_canvas) ) viewimg_init (colourmap_canvas);
+    canvas = colourmap_canvas;
+    cmap = canvas_get_cmap (canvas);
+    if ( ( vimage = viewimg_create_from_iarray (canvas, get_image (), FALSE) )
+	 == NULL )
+    {
+	m_abort (function_name, "viewable image");
+    }
+    viewimg_make_active (vimage);
+    funcs = kcmap_list_funcs ();
+    for (num_funcs = 0; funcs[num_funcs] != NULL; ++num_funcs);
+    gettimeofday (&start, NULL);
+    for (count = 0; count < num_iterations; ++count)
+    {
+	/*  Switch functions and then drag the colourmap, as a user would  */
+	kcmap_change (cmap, funcs[count % num_funcs], 0, FALSE);
+	x = (double) (count + 1) / (double) (num_iterations + 1);
+	kcmap_modify (cmap, x, 1.0 - x, NULL);
+    }
+    ms = elapsed_ms (&start);
+    report ("colourmap", num_iterations, ms, 1e-3, "Kchange");
+    viewimg_destroy (vimage);
+}   /*  End Function bench_colourmap  */
+
+
+/*  Private functions follow  */
+
+static flag get_canvas (KWorldCanvas *canvas)
+/*  [SUMMARY] Get the world canvas for a stage, creating it if needed.
+    [PURPOSE] This routine will get a world canvas on a PseudoColour memory
+    canvas. World canvases, pixel canvases and colourmaps cannot be destroyed,
+    so each stage keeps its canvas for later runs. A new canvas is created if
+    the canvas size has changed.
+    <canvas> The canvas for the stage. This is read and the new canvas is
+    written here.
+    [RETURNS] TRUE if a new canvas was created, else FALSE. On failure the
+    process aborts.
+*/
+{
+    KPixCanvas pixcanvas;
+    Kcolourmap kcmap;
+    int width, height;
+    unsigned char *buffer;
+    struct win_scale_type win_scale;
+    static char function_name[] = "get_canvas";
+
+    if (*canvas != NULL)
+    {
+	kwin_get_size (canvas_get_pixcanvas (*canvas), &width, &height);
+	if ( (width == canvas_width) && (height == canvas_height) )
+	{
+	    return (FALSE);
+	}
+    }
+    if ( ( buffer = (unsigned char *) m_alloc (canvas_width * canvas_height) )
+	 == NULL )
+    {
+	m_abort (function_name, "canvas buffer");
+    }
+    if ( ( pixcanvas = kwin_create_memory (buffer, canvas_width, canvas_height,
+					   8, 0) ) == NULL )
+    {
+	m_abort (function_name, "memory canvas");
+    }
+    if ( ( kcmap = kcmap_va_create (COLOURMAP_NAME, NUM_COLOURS, TRUE,
+				    kwin_memory_get_dpy_handle (pixcanvas),
+				    kwin_memory_alloc_colours,
+				    kwin_memory_free_colours,
+				    kwin_memory_store_colours,
+				    kwin_memory_get_location,
+				    KCMAP_ATT_END) ) == NULL )
+    {
+	m_abort (function_name, "colourmap");
+    }
+    canvas_init_win_scale (&win_scale, K_WIN_SCALE_MAGIC_NUMBER);
+    if ( ( *canvas = canvas_create (pixcanvas, kcmap, &win_scale) ) == NULL )
+    {
+	m_abort (function_name, "world canvas");
+    }
+    return (TRUE);
+}   /*  End Function get_canvas  */
+
+static iarray get_image ()
+/*  [SUMMARY] Get the synthetic image, creating it if needed.
+    [PURPOSE] This routine will get a floating point image of Gaussian blobs
+    with added noise. The image is regenerated if the size has changed.
+    [RETURNS] The image. On failure the process aborts.
+*/
+{
+    unsigned long x, y;
+    float *data;
+    static char function_name[] = "get_image";
+
+    if ( (image != NULL) && (iarray_dim_length (image, 0) == image_size) )
+    {
+	return (image);
+    }
+    if (image != NULL) iarray_dealloc (image);
+    if ( ( image = iarray_create_2D (image_size, image_size, K_FLOAT) )
+	 == NULL )
+    {
+	m_abort (function_name, "image");
+    }
+    n_set_seed (SEED);
+    data = (float *) image->data;
+    for (y = 0; y < image_size; ++y)
+    {
+	for (x = 0; x < image_size; ++x, ++data)
+	{
+	    *data = blob_value ( (double) x / (double) image_size,
+				 (double) y / (double) image_size, -1.0 ) +
+		0.05 * n_gaussian ();
+	}
+    }
+    return (image);
+}   /*  End Function get_image  */
+
+static iarray get_cube ()
+/*  [SUMMARY] Get the synthetic cube, creating it if needed.
+    [PURPOSE] This routine will get a byte cube of Gaussian blobs with added
+    noise. The cube is regenerated if the size has changed.
+    [RETURNS] The cube. On failure the process aborts.
+*/
+{
+    unsigned long x, y, z;
+    double value;
+    char *data;
+    static char function_name[] = "get_cube";
+
+    if ( (cube != NULL) && (iarray_dim_length (cube, 0) == cube_size) )
+    {
+	return (cube);
+    }
+    if (cube != NULL) iarray_dealloc (cube);
+    if ( ( cube = iarray_create_3D (cube_size, cube_size, cube_size,
+				    K_BYTE) ) == NULL )
+    {
+	m_abort (function_name, "cube");
+    }
+    n_set_seed (SEED);
+    data = cube->data;
+    for (z = 0; z < cube_size; ++z) for (y = 0; y < cube_size; ++y)
+    {
+	for (x = 0; x < cube_size; ++x, ++data)
+	{
+	    value = 120.0 * blob_value ( (double) x / (double) cube_size,
+					 (double) y / (double) cube_size,
+					 (double) z / (double) cube_size ) +
+		5.0 * n_gaussian ();
+	    if (value < -127.0) value = -127.0;
+	    if (value > 127.0) value = 127.0;
+	    *data = (int) value;
+	}
+    }
+    return (cube);
+}   /*  End Function get_cube  */
+
+static double blob_value (double x, double y, double z)
+/*  [SUMMARY] Compute the sum of the Gaussian blobs at a position.
+    <x> The horizontal position, in the range 0.0 to 1.0.
+    <y> The vertical position, in the range 0.0 to 1.0.
+    <z> The depth position, in the range 0.0 to 1.0. If this is less than 0.0
+    the blobs are two-dimensional.
+    [RETURNS] The value.
+*/
+{
+    unsigned int count;
+    double dx, dy, dz, value;
+
+    for (count = 0, value = 0.0; count < NUM_BLOBS; ++count)
+    {
+	dx = x - blob_x[count];
+	dy = y - blob_y[count];
+	dz = (z < 0.0) ? 0.0 : z - blob_z[count];
+	value += blob_amplitude[count] *
+	    exp ( -(dx * dx + dy * dy + dz * dz) /
+		  (2.0 * blob_width[count] * blob_width[count]) );
+    }
+    return (value);
+}   /*  End Function blob_value  */
+
+static double elapsed_ms (struct timeval *start)
+/*  [SUMMARY] Compute the time elapsed since a starting time.
+    <start> The starting time.
+    [RETURNS] The elapsed time in milliseconds.
+*/
+{
+    struct timeval stop;
+
+    gettimeofday (&stop, NULL);
+    return (1e3 * (double) (stop.tv_sec - start->tv_sec) +
+	    1e-3 * (double) (stop.tv_usec - start->tv_usec) );
+}   /*  End Function elapsed_ms  */
+
+static void report (CONST char *stage, unsigned int num_iterations,
+		    double ms, double work, CONST char *units)
+/*  [SUMMARY] Report the time taken for a stage.
+    <stage> The name of the stage.
+    <num_iterations> The number of iterations.
+    <ms> The total time taken in milliseconds.
+    <work> The amount of work done per iteration, in <<units>>.
+    <units> The units of work.
+    [RETURNS] Nothing.
+*/
+{
+    double seconds;
+
+    if (!header_written)
+    {
+	printf ("#kbench %s\tcanvas %dx%d\timage %u\tcube %u\n",
+		VERSION, canvas_width, canvas_height, image_size, cube_size);
+	printf ("#stage\titerations\ttotal_ms\tms_per_iteration\tthroughput\t"
+		"units\n");
+	header_written = TRUE;
+    }
+    if (num_iterations < 1) num_iterations = 1;
+    seconds = (ms > 0.0) ? ms * 1e-3 : 1e-6;
+    printf ("%s\t%u\t%.3f\t%.3f\t%.3f\t%s/s\n",
+	    stage, num_iterations, ms, ms / (double) num_iterations,
+	    work * (double) num_iterations / seconds, units);
+    fflush (stdout);
+}   /*  End Function report  */
+
+
+/*  Shader functions follow  */
+
+static void shade_slow (signed char **planes, uaddr *v_offsets,
+			uaddr *h_offsets,
+			float ray_start_d, float ray_start_v,
+			float ray_start_h,
+			float ray_direction_d, float ray_direction_v,
+			float ray_direction_h, float one_on_ray_direction_d,
+			float min_d, float max_d,
+			double *minimum_image_value,
+			double *maximum_image_value,
+			char *pixel_ptr)
+/*  [SUMMARY] Maximum intensity projection shader, sampling each plane.
+    [RETURNS] Nothing.
+*/
+{
+    int plane, end_plane, max_value, voxel;
+    float t;
+
+    max_value = -128;
+    end_plane = max_d;
+    for (plane = min_d; plane < end_plane; ++plane)
+    {
+	t = ( (float) plane - ray_start_d ) * one_on_ray_direction_d;
+	voxel = planes[plane][v_offsets[(int) (ray_start_v +
+					       t * ray_direction_v + 0.01)] +
+			      h_offsets[(int) (ray_start_h +
+					       t * ray_direction_h + 0.01)]];
+	if (voxel > max_value) max_value = voxel;
+    }
+    *pixel_ptr = max_value;
+    if (max_value < -127) return;
+    if (max_value < *minimum_image_value) *minimum_image_value = max_value;
+    if (max_value > *maximum_image_value) *maximum_image_value = max_value;
+}   /*  End Function shade_slow  */
+
+static void shade_fast (signed char *ray, int length,
+			double *minimum_image_value,
+			double *maximum_image_value, void *pixel_ptr)
+/*  [SUMMARY] Maximum intensity projection shader for re-ordered rays.
+    [RETURNS] Nothing.
+*/
+{
+    int count, max_value;
+
+    for (count = 0, max_value = -128; count < length; ++count)
+    {
+	if (ray[count] > max_value) max_value = ray[count];
+    }
+    *(signed char *) pixel_ptr = max_value;
+    if (max_value < -127) return;
+    if (max_value < *minimum_image_value) *minimum_image_value = max_value;
+    if (max_value > *maximum_image_value) *maximum_image_value = max_value;
+}   /*  End Function shade_fast  */
@@ -46,16 +46,32 @@
 #include <karma_ex.h>
 #include <karma_m.h>
 #include <karma_n.h>
+#include <karma_mt.h>
 #include <karma_a.h>
 
 
 #define VERSION "1.0"
 
 #define MAX_DIMENSIONS (unsigned int) 100
+#define BUFFER_LENGTH 1024
+
+/*  A range of elements to be generated by one job. The stream is created
+    before the job is launched, since m_alloc() is not thread-safe  */
+typedef struct
+{
+    uaddr first;
+    uaddr num_elements;
+    KRandomStream stream;
+} chunk_type;
 
 STATIC_FUNCTION (flag knoise, (char *command, FILE *fp) );
 STATIC_FUNCTION (void generate_file,
 		 (char *arrayname, unsigned int elem_type) );
+STATIC_FUNCTION (void generate_job,
+		 (void *pool_info,
+		  void *call_info1, void *call_info2,
+		  void *call_info3, void *call_info4,
+		  void *thread_info) );
 
 
 /*  Private data  */
@@ -70,6 +86,7 @@ static double lower_range = -1.0;
 static double upper_range = 1.0;
 static double mean = 0.0;
 static double variance = 1.0;
+static unsigned long seed = 0;
 
 #define DISTRIBUTION_UNIFORM  0
 #define DISTRIBUTION_GAUSSIAN 1
@@ -127,6 +144,8 @@ int main (int argc, char **argv)
 		    PIA_END);
     panel_add_item (panel, "mean", "absolute", K_DOUBLE, &mean,
 		    PIA_END);
+    panel_add_item (panel, "seed", "0 means seed from time", K_ULONG, &seed,
+		    PIA_END);
     panel_add_item (panel, "distribution", "", PIT_CHOICE_INDEX, &distribution,
 		    PIA_NUM_CHOICE_STRINGS, NUM_DISTRIBUTIONS,
 		    PIA_CHOICE_STRINGS, distribution_alternatives,
@@ -186,17 +205,18 @@ static void generate_file (char *arrayname, unsigned int elem_type)
     The routine returns nothing.
 */
 {
-    unsigned int array_size;
-    unsigned int elem_count;
-    unsigned int dim_count;
-    double factor = 0.0;  /*  Initialised to keep compiler happy  */
-    double value[2];
+    KThreadPool pool;
+    unsigned int dim_count, num_chunks, chunk_count, num_used;
+    uaddr array_size, chunk_size;
+    unsigned long stream_seed;
     char *array;
+    chunk_type *chunks;
     multi_array *multi_desc;
+    struct timeval tv;
+    struct timezone tz;
     extern unsigned int num_dimensions;
     extern unsigned int distribution;
-    extern double lower_range, upper_range;
-    extern double mean, variance;
+    extern unsigned long seed;
     extern unsigned long lengths[MAX_DIMENSIONS];
     extern double minima[MAX_DIMENSIONS];
     extern double maxima[MAX_DIMENSIONS];
@@ -215,7 +235,14 @@ static void generate_file (char *arrayname, unsigned int elem_type)
 			    dim_count, lengths[dim_count]);
 	    return;
 	}
-	array_size *= (unsigned int) lengths[dim_count];
+	array_size *= lengths[dim_count];
+    }
+    if ( (distribution != DISTRIBUTION_UNIFORM) &&
+	 (distribution != DISTRIBUTION_GAUSSIAN) )
+    {
+	(void) fprintf (stderr, "Illegal distribution: %u\n",
+			distribution);
+	a_prog_bug (function_name);
     }
     if ( ( array = ds_easy_alloc_array (&multi_desc,
 					(unsigned int) num_dimensions,
@@ -228,42 +255,50 @@ static void generate_file (char *arrayname, unsigned int elem_type)
 			"NULL return value from function: ds_easy_alloc_array\n");
 	return;
     }
-    switch (distribution)
+    if (seed == 0)
     {
-      case DISTRIBUTION_UNIFORM:
-	factor = upper_range - lower_range;
-	break;
-      case DISTRIBUTION_GAUSSIAN:
-	break;
-      default:
-	(void) fprintf (stderr, "Illegal distribution: %u\n",
-			distribution);
-	a_prog_bug (function_name);
-	break;
+	gettimeofday (&tv, &tz);
+	stream_seed = tv.tv_sec ^ tv.tv_usec;
+    }
+    else stream_seed = seed;
+    /*  Each chunk has a copy of the same stream, seeked to its start, so the
+	values do not depend on the number of threads  */
+    pool = mt_get_shared_pool ();
+    num_chunks = mt_num_threads (pool);
+    if ( ( chunks = (chunk_type *) m_alloc (sizeof *chunks * num_chunks) )
+	 == NULL )
+    {
+	m_abort (function_name, "chunk array");
     }
-    value[1] = 0.0;
-    for (elem_count = 0; elem_count < array_size; ++elem_count)
+    chunk_size = (array_size + num_chunks - 1) / num_chunks;
+    for (num_used = 0; num_used < num_chunks; ++num_used)
     {
-	switch (distribution)
+	chunks[num_used].first = chunk_size * num_used;
+	if (chunks[num_used].first >= array_size) break;
+	chunks[num_used].num_elements = array_size - chunks[num_used].first;
+	if (chunks[num_used].num_elements > chunk_size)
 	{
-	  case DISTRIBUTION_UNIFORM:
-	    value[0] = lower_range + n_uniform () * factor;
-	    break;
-	  case DISTRIBUTION_GAUSSIAN:
-	    value[0] = mean + n_gaussian () * variance;
-	    break;
-	  default:
-	    (void) fprintf (stderr, "Illegal distribution: %u\n",
-			    distribution);
-	    a_prog_bug (function_name);
-	    break;
+	    chunks[num_used].num_elements = chunk_size;
 	}
-	if ( ( array = ds_put_element (array, elem_type, value) ) == NULL )
+	if ( ( chunks[num_used].stream = n_create_stream (stream_seed, 0) )
+	     == NULL )
 	{
-	    (void) fprintf (stderr, "Error writing element!\n");
-	    a_prog_bug (function_name);
+	    m_abort (function_name, "random stream");
 	}
+	n_stream_seek (chunks[num_used].stream, chunks[num_used].first);
+    }
+    for (chunk_count = 0; chunk_count < num_used; ++chunk_count)
+    {
+	mt_launch_job (pool, generate_job, (void *) array,
+		       (void *) (chunks + chunk_count), NULL,
+		       (void *) &elem_type);
     }
+    mt_wait_for_all_jobs (pool);
+    for (chunk_count = 0; chunk_count < num_used; ++chunk_count)
+    {
+	n_destroy_stream (chunks[chunk_count].stream);
+    }
+    m_free ( (char *) chunks );
     /*  Write to arrayfile  */
     if (dsxfr_put_multi (arrayname, multi_desc) != TRUE)
     {
@@ -277,3 +312,67 @@ static void generate_file (char *arrayname, unsigned int elem_type)
 #endif
     ds_dealloc_multi (multi_desc);
 }   /*  End Function generate_file  */
+
+static void generate_job (void *pool_info,
+			  void *call_info1, void *call_info2,
+			  void *call_info3, void *call_info4,
+			  void *thread_info)
+/*  This routine will generate noise values for a range of elements.
+    The pool information is ignored.
+    The array data must be pointed to by  call_info1  .
+    The range of elements and its stream must be pointed to by  call_info2  .
+    The  call_info3  parameter is ignored.
+    The element type must be pointed to by  call_info4  .
+    The thread information is ignored.
+    The routine returns nothing.
+*/
+{
+    unsigned int elem_type = *(unsigned int *) call_info4;
+    unsigned int elem_size, count, num_values;
+    uaddr remaining;
+    double factor;
+    char *array = (char *) call_info1;
+    chunk_type *chunk = (chunk_type *) call_info2;
+    KRandomStream stream = chunk->stream;
+    double values[BUFFER_LENGTH];
+    double buffer[BUFFER_LENGTH * 2];  /*  Complex values  */
+    extern unsigned int distribution;
+    extern double lower_range, upper_range;
+    extern double mean, variance;
+    extern char host_type_sizes[NUMTYPES];
+    static char function_name[] = "generate_job";
+
+    elem_size = host_type_sizes[elem_type];
+    array += chunk->first * elem_size;
+    factor = upper_range - lower_range;
+    for (remaining = chunk->num_elements; remaining > 0;
+	 remaining -= num_values)
+    {
+	num_values = (remaining > BUFFER_LENGTH) ? BUFFER_LENGTH : remaining;
+	if (distribution == DISTRIBUTION_UNIFORM)
+	{
+	    n_fill_uniform (stream, values, num_values);
+	    for (count = 0; count < num_values; ++count)
+	    {
+		buffer[count * 2] = lower_range + values[count] * factor;
+		buffer[count * 2 + 1] = 0.0;
+	    }
+	}
+	else
+	{
+	    n_fill_gaussian (stream, values, num_values);
+	    for (count = 0; count < num_values; ++count)
+	    {
+		buffer[count * 2] = mean + values[count] * variance;
+		buffer[count * 2 + 1] = 0.0;
+	    }
+	}
+	if ( !ds_put_elements (array, elem_type, elem_size, buffer,
+			       num_values) )
+	{
+	    (void) fprintf (stderr, "Error writing elements!\n");
+	    a_prog_bug (function_name);
+	}
+	array += num_values * elem_size;
+    }
+}   /*  End Function generate_job  */
@@ -0,0 +1,207 @@
+/*  kreadspeed.c
+
+    Source file for  kreadspeed  (measure the speed of reading disc files).
+
+    Copyright (C) 1996  Richard Gooch
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    Richard Gooch may be reached by email at  karma-request@atnf.csiro.au
+    The postal address is:
+      Richard Gooch, c/o ATNF, P. O. Box 76, Epping, N.S.W., 2121, Australia.
+*/
+
+/*  This Karma module will time reading files as big-endian floating point
+  data with <pio_read_floats>, using the default channel buffers, large
+  buffers with sequential access advice, direct I/O and memory mapping.
+
+
+*/
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <karma.h>
+#include <karma_module.h>
+#include <karma_panel.h>
+#include <karma_pio.h>
+#include <karma_ch.h>
+#include <karma_ex.h>
+#include <karma_m.h>
+#include <karma_a.h>
+
+#define VERSION "1.0"
+
+#define NUM_VALUES 262144
+
+#define METHOD_DEFAULT (unsigned int) 0
+#define METHOD_SEQUENTIAL (unsigned int) 1
+#define METHOD_DIRECT (unsigned int) 2
+#define METHOD_MMAP (unsigned int) 3
+#define NUM_METHODS (unsigned int) 4
+
+STATIC_FUNCTION (flag kreadspeed, (char *command, FILE *fp) );
+STATIC_FUNCTION (void process_file, (CONST char *infile) );
+STATIC_FUNCTION (Channel open_file,
+		 (CONST char *infile, unsigned int method, flag *ok) );
+STATIC_FUNCTION (void drop_cache, (CONST char *infile) );
+
+
+/*  Private data  */
+static unsigned int buffer_size = 1048576;
+static flag cold = TRUE;
+static char *method_names[NUM_METHODS] =
+{
+    "default buffer", "sequential", "direct I/O", "memory mapped"
+};
+
+
+int main (int argc, char **argv)
+{
+    KControlPanel panel;
+    static char function_name[] = "main";
+
+    if ( ( panel = panel_create (FALSE) ) == NULL )
+    {
+	m_abort (function_name, "control panel");
+    }
+    panel_add_item (panel, "cold", "discard cached file data before reading",
+		    PIT_FLAG, &cold,
+		    PIA_END);
+    panel_add_item (panel, "buffer_size", "bytes", K_UINT, &buffer_size,
+		    PIA_END);
+    panel_push_onto_stack (panel);
+    module_run (argc, argv, "kreadspeed", VERSION, kreadspeed, -1, -1, FALSE);
+    return (RV_OK);
+}   /*  End Function main   */
+
+static flag kreadspeed (char *p, FILE *fp)
+{
+    char *infile;
+
+    for ( ; p; p = ex_command_skip (p) )
+    {
+	if ( ( infile = ex_str (p, &p) ) == NULL )
+	{
+	    fprintf (fp, "Error extracting infile name\n");
+	    return (TRUE);
+	}
+	process_file (infile);
+	m_free (infile);
+    }
+    return (TRUE);
+}   /*  End Function kreadspeed  */
+
+static void process_file (CONST char *infile)
+/*  [SUMMARY] Time reading a file with each method.
+    <infile> The name of the input file.
+    [RETURNS] Nothing.
+*/
+{
+    Channel channel;
+    flag ok;
+    unsigned int method;
+    uaddr num_values, num_read, num_nan, total;
+    double seconds;
+    struct stat statbuf;
+    struct timeval start, stop;
+    float *data;
+    static char function_name[] = "process_file";
+
+    if (stat (infile, &statbuf) != 0)
+    {
+	fprintf (stderr, "Error getting stats on: \"%s\"\n", infile);
+	return;
+    }
+    num_values = statbuf.st_size / sizeof *data;
+
+    if ( ( data = (float *) m_alloc (sizeof *data * NUM_VALUES) ) == NULL )
+    {
+	m_abort (function_name, "data buffer");
+    }
+    for (method = 0; method < NUM_METHODS; ++method)
+    {
+	if (cold) drop_cache (infile);
+	gettimeofday (&start, NULL);
+	if ( ( channel = open_file (infile, method, &ok) ) == NULL )
+	{
+	    fprintf (stderr, "Error opening: \"%s\"\n", infile);
+	    break;
+	}
+	for (total = 0; total < num_values; total += num_read)
+	{
+	    num_read = num_values - total;
+	    if (num_read > NUM_VALUES) num_read = NUM_VALUES;
+	    if (pio_read_floats (channel, num_read, data, &num_nan) < num_read)
+	    {
+		break;
+	    }
+	}
+	ch_close (channel);
+	gettimeofday (&stop, NULL);
+	seconds = (double) (stop.tv_sec - start.tv_sec) +
+	    1e-6 * (double) (stop.tv_usec - start.tv_usec);
+	if (seconds <= 0.0) seconds = 1e-6;
+	fprintf (stderr, "%-16s %10lu values  %8.3f s  %9.2f MB/s%s\n",
+		 method_names[method], (unsigned long) total, seconds,
+		 (double) total * sizeof *data / seconds / 1048576.0,
+		 ok ? "" : "  (not supported)");
+    }
+    m_free ( (char *) data );
+}   /*  End Function process_file  */
+
+static Channel open_file (CONST char *infile, unsigned int method, flag *ok)
+/*  [SUMMARY] Open a file for reading.
+    <infile> The name of the input file.
+    <method> The method used to read the file.
+    <ok> If the method is not available this is set to FALSE, else it is set
+    to TRUE.
+    [RETURNS] The channel on success, else NULL.
+*/
+{
+    Channel channel;
+
+    *ok = TRUE;
+    if (method == METHOD_MMAP)
+    {
+	if ( ( channel = ch_map_disc (infile, K_CH_MAP_IF_AVAILABLE, FALSE,
+				      FALSE) ) == NULL ) return (NULL);
+	if ( !ch_test_for_mmap (channel) ) *ok = FALSE;
+	if ( !ch_advise (channel, K_CH_ADVISE_SEQUENTIAL, 0, 0) ) *ok = FALSE;
+	return (channel);
+    }
+    if ( ( channel = ch_open_file (infile, "r") ) == NULL ) return (NULL);
+    if (method == METHOD_DEFAULT) return (channel);
+    if ( !ch_set_disc_buffer (channel, buffer_size,
+			      (method == METHOD_DIRECT) ? TRUE : FALSE) )
+    {
+	*ok = FALSE;
+    }
+    if ( !ch_advise (channel, K_CH_ADVISE_SEQUENTIAL, 0, 0) ) *ok = FALSE;
+    return (channel);
+}   /*  End Function open_file  */
+
+static void drop_cache (CONST char *infile)
+/*  [SUMMARY] Discard cached data for a file.
+    <infile> The name of the file.
+    [RETURNS] Nothing.
+*/
+{
+    Channel channel;
+
+    if ( ( channel = ch_open_file (infile, "r") ) == NULL ) return;
+    ch_advise (channel, K_CH_ADVISE_DONTNEED, 0, 0);
+    ch_close (channel);
+}   /*  End Function drop_cache  */